@@ -0,0 +1,921 @@
+//
+//  AdBlobStore.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdBlobStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <CommonCrypto/CommonDigest.h>
+#endif
+
+#define kAdBlobJournalName          "journal"
+#define kAdBlobJournalTemporaryName "journal.tmp"
+#define kAdBlobMinSlots             64
+#define kAdBlobCompactionSlack      256     /* dead journal records tolerated before compacting on open */
+
+enum {
+    kAdBlobSlotEmpty,
+    kAdBlobSlotUsed,
+    kAdBlobSlotDeleted
+};
+
+typedef struct {
+    AdBlobHash hash;
+    uint64_t size;
+    uint64_t *owners;
+    uint32_t ownerCount;
+    uint32_t ownerCapacity;
+    uint8_t state;
+} AdBlob;
+
+typedef struct {
+    char *url;
+    char *etag;             /* NULL without ETag */
+    AdBlobHash hash;
+    uint8_t state;
+} AdBlobURL;
+
+struct AdBlobStore {
+    char *directory;
+    int journal;
+    int replaying;          /* set while the journal is read, so that nothing is written back */
+    uint64_t journalRecords;
+    unsigned temporaryCounter;
+
+    AdBlob *blobs;
+    uint32_t blobCapacity;  /* a power of two, at least twice the used and deleted slots */
+    uint32_t blobCount;
+    uint32_t blobDeleted;
+
+    AdBlobURL *urls;
+    uint32_t urlCapacity;
+    uint32_t urlCount;
+    uint32_t urlDeleted;
+
+    AdBlobStoreStatistics counters;     /* only the counters since the open are kept here */
+};
+
+// Hash
+
+#ifndef __APPLE__
+
+static const uint32_t kAdBlobSHA256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define AdBlobRotate(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void AdBlobSHA256Block(uint32_t state[8], const uint8_t *block)
+{
+    uint32_t w[64], a, b, c, d, e, f, g, h;
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = AdBlobRotate(w[i - 15], 7) ^ AdBlobRotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = AdBlobRotate(w[i - 2], 17) ^ AdBlobRotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (AdBlobRotate(e, 6) ^ AdBlobRotate(e, 11) ^ AdBlobRotate(e, 25)) + ((e & f) ^ (~e & g)) + kAdBlobSHA256K[i] + w[i];
+        uint32_t t2 = (AdBlobRotate(a, 2) ^ AdBlobRotate(a, 13) ^ AdBlobRotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#endif
+
+void AdBlobHashCompute(const void *bytes, size_t length, AdBlobHash *hash)
+{
+#ifdef __APPLE__
+    // CommonCrypto uses the SHA extensions of the CPU. Its lengths are 32 bits, hence the chunks.
+    CC_SHA256_CTX context;
+    const uint8_t *p = bytes;
+
+    CC_SHA256_Init(&context);
+    while (length > 0) {
+        CC_LONG chunk = length > (1u << 30) ? (1u << 30) : (CC_LONG)length;
+        CC_SHA256_Update(&context, p, chunk);
+        p += chunk;
+        length -= chunk;
+    }
+    CC_SHA256_Final(hash->bytes, &context);
+#else
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    const uint8_t *p = bytes;
+    uint64_t bits = (uint64_t)length * 8;
+    uint8_t tail[128];
+    size_t rest, tailLength;
+
+    for (; length >= 64; p += 64, length -= 64) {
+        AdBlobSHA256Block(state, p);
+    }
+    rest = length;
+    memset(tail, 0, sizeof(tail));
+    if (rest > 0) {
+        memcpy(tail, p, rest);
+    }
+    tail[rest] = 0x80;
+    tailLength = rest < 56 ? 64 : 128;
+    for (int i = 0; i < 8; i++) {
+        tail[tailLength - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    AdBlobSHA256Block(state, tail);
+    if (tailLength == 128) {
+        AdBlobSHA256Block(state, tail + 64);
+    }
+    for (int i = 0; i < 8; i++) {
+        hash->bytes[4 * i] = (uint8_t)(state[i] >> 24);
+        hash->bytes[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        hash->bytes[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        hash->bytes[4 * i + 3] = (uint8_t)state[i];
+    }
+#endif
+}
+
+void AdBlobHashGetString(const AdBlobHash *hash, char *string)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (int i = 0; i < kAdBlobHashLength; i++) {
+        string[2 * i] = digits[hash->bytes[i] >> 4];
+        string[2 * i + 1] = digits[hash->bytes[i] & 15];
+    }
+    string[2 * kAdBlobHashLength] = '\0';
+}
+
+static int AdBlobHashParse(const char *string, AdBlobHash *hash)
+{
+    for (int i = 0; i < 2 * kAdBlobHashLength; i++) {
+        char c = string[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (digit < 0) {
+            return -1;
+        }
+        hash->bytes[i / 2] = (uint8_t)(i % 2 ? (hash->bytes[i / 2] | digit) : digit << 4);
+    }
+    return string[2 * kAdBlobHashLength] == '\0' ? 0 : -1;
+}
+
+static uint32_t AdBlobHashSlot(const AdBlobHash *hash)
+{
+    uint32_t slot;
+
+    // The hash is uniform already.
+    memcpy(&slot, hash->bytes, sizeof(slot));
+    return slot;
+}
+
+static uint32_t AdBlobStringSlot(const char *string)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *p = (const unsigned char *)string; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+static int AdBlobIsField(const char *string)
+{
+    return string && strpbrk(string, "\t\n\r") == NULL;
+}
+
+// Tables
+
+static uint32_t AdBlobCapacityFor(uint32_t count)
+{
+    uint32_t capacity = kAdBlobMinSlots;
+
+    while (capacity < 4 * count) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+static AdBlob *AdBlobStoreFindBlob(const AdBlobStore *store, const AdBlobHash *hash)
+{
+    uint32_t mask = store->blobCapacity - 1;
+
+    for (uint32_t i = AdBlobHashSlot(hash) & mask; ; i = (i + 1) & mask) {
+        AdBlob *blob = &store->blobs[i];
+        if (blob->state == kAdBlobSlotEmpty) {
+            return NULL;
+        }
+        if (blob->state == kAdBlobSlotUsed && memcmp(&blob->hash, hash, sizeof(AdBlobHash)) == 0) {
+            return blob;
+        }
+    }
+}
+
+static AdBlob *AdBlobStoreInsertBlob(AdBlobStore *store, const AdBlobHash *hash, uint64_t size)
+{
+    uint32_t mask;
+    AdBlob *blob;
+
+    if (2 * (store->blobCount + store->blobDeleted + 1) > store->blobCapacity) {
+        uint32_t capacity = AdBlobCapacityFor(store->blobCount + 1);
+        AdBlob *blobs = calloc(capacity, sizeof(AdBlob));
+
+        if (blobs == NULL) {
+            return NULL;
+        }
+        for (uint32_t i = 0; i < store->blobCapacity; i++) {
+            if (store->blobs[i].state == kAdBlobSlotUsed) {
+                uint32_t j = AdBlobHashSlot(&store->blobs[i].hash) & (capacity - 1);
+                while (blobs[j].state != kAdBlobSlotEmpty) {
+                    j = (j + 1) & (capacity - 1);
+                }
+                blobs[j] = store->blobs[i];
+            }
+        }
+        free(store->blobs);
+        store->blobs = blobs;
+        store->blobCapacity = capacity;
+        store->blobDeleted = 0;
+    }
+
+    mask = store->blobCapacity - 1;
+    for (uint32_t i = AdBlobHashSlot(hash) & mask; ; i = (i + 1) & mask) {
+        blob = &store->blobs[i];
+        if (blob->state != kAdBlobSlotUsed) {
+            break;
+        }
+    }
+    if (blob->state == kAdBlobSlotDeleted) {
+        store->blobDeleted--;
+    }
+    memset(blob, 0, sizeof(AdBlob));
+    blob->hash = *hash;
+    blob->size = size;
+    blob->state = kAdBlobSlotUsed;
+    store->blobCount++;
+    return blob;
+}
+
+static AdBlobURL *AdBlobStoreFindURL(const AdBlobStore *store, const char *url)
+{
+    uint32_t mask = store->urlCapacity - 1;
+
+    for (uint32_t i = AdBlobStringSlot(url) & mask; ; i = (i + 1) & mask) {
+        AdBlobURL *entry = &store->urls[i];
+        if (entry->state == kAdBlobSlotEmpty) {
+            return NULL;
+        }
+        if (entry->state == kAdBlobSlotUsed && strcmp(entry->url, url) == 0) {
+            return entry;
+        }
+    }
+}
+
+static AdBlobURL *AdBlobStoreInsertURL(AdBlobStore *store, const char *url)
+{
+    uint32_t mask;
+    AdBlobURL *entry;
+    char *copy;
+
+    if (2 * (store->urlCount + store->urlDeleted + 1) > store->urlCapacity) {
+        uint32_t capacity = AdBlobCapacityFor(store->urlCount + 1);
+        AdBlobURL *urls = calloc(capacity, sizeof(AdBlobURL));
+
+        if (urls == NULL) {
+            return NULL;
+        }
+        for (uint32_t i = 0; i < store->urlCapacity; i++) {
+            if (store->urls[i].state == kAdBlobSlotUsed) {
+                uint32_t j = AdBlobStringSlot(store->urls[i].url) & (capacity - 1);
+                while (urls[j].state != kAdBlobSlotEmpty) {
+                    j = (j + 1) & (capacity - 1);
+                }
+                urls[j] = store->urls[i];
+            }
+        }
+        free(store->urls);
+        store->urls = urls;
+        store->urlCapacity = capacity;
+        store->urlDeleted = 0;
+    }
+
+    copy = strdup(url);
+    if (copy == NULL) {
+        return NULL;
+    }
+    mask = store->urlCapacity - 1;
+    for (uint32_t i = AdBlobStringSlot(url) & mask; ; i = (i + 1) & mask) {
+        entry = &store->urls[i];
+        if (entry->state != kAdBlobSlotUsed) {
+            break;
+        }
+    }
+    if (entry->state == kAdBlobSlotDeleted) {
+        store->urlDeleted--;
+    }
+    memset(entry, 0, sizeof(AdBlobURL));
+    entry->url = copy;
+    entry->state = kAdBlobSlotUsed;
+    store->urlCount++;
+    return entry;
+}
+
+static void AdBlobStoreRemoveURL(AdBlobStore *store, AdBlobURL *entry)
+{
+    free(entry->url);
+    free(entry->etag);
+    entry->url = NULL;
+    entry->etag = NULL;
+    entry->state = kAdBlobSlotDeleted;
+    store->urlCount--;
+    store->urlDeleted++;
+}
+
+/** Removes the URLs whose blob is gone. */
+static void AdBlobStoreSweepURLs(AdBlobStore *store)
+{
+    for (uint32_t i = 0; i < store->urlCapacity; i++) {
+        if (store->urls[i].state == kAdBlobSlotUsed && AdBlobStoreFindBlob(store, &store->urls[i].hash) == NULL) {
+            AdBlobStoreRemoveURL(store, &store->urls[i]);
+        }
+    }
+}
+
+// Journal
+
+static void AdBlobStoreJournal(AdBlobStore *store, const char *format, ...)
+{
+    char buffer[1024];
+    char *line = buffer;
+    va_list arguments;
+    int length;
+
+    if (store->replaying || store->journal < 0) {
+        return;
+    }
+    va_start(arguments, format);
+    length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+    if (length < 0) {
+        return;
+    }
+    if ((size_t)length >= sizeof(buffer)) {
+        line = malloc((size_t)length + 1);
+        if (line == NULL) {
+            return;
+        }
+        va_start(arguments, format);
+        vsnprintf(line, (size_t)length + 1, format, arguments);
+        va_end(arguments);
+    }
+    // One write per record with O_APPEND: a crash leaves at most a torn last line, which the replay skips.
+    if (write(store->journal, line, (size_t)length) == length) {
+        store->journalRecords++;
+    }
+    if (line != buffer) {
+        free(line);
+    }
+}
+
+static int AdBlobAddOwner(AdBlob *blob, uint64_t owner)
+{
+    for (uint32_t i = 0; i < blob->ownerCount; i++) {
+        if (blob->owners[i] == owner) {
+            return 0;
+        }
+    }
+    if (blob->ownerCount == blob->ownerCapacity) {
+        uint32_t capacity = blob->ownerCapacity ? 2 * blob->ownerCapacity : 4;
+        uint64_t *owners = realloc(blob->owners, capacity * sizeof(uint64_t));
+        if (owners == NULL) {
+            return -1;
+        }
+        blob->owners = owners;
+        blob->ownerCapacity = capacity;
+    }
+    blob->owners[blob->ownerCount++] = owner;
+    return 1;
+}
+
+static int AdBlobRemoveOwner(AdBlob *blob, uint64_t owner)
+{
+    for (uint32_t i = 0; i < blob->ownerCount; i++) {
+        if (blob->owners[i] == owner) {
+            blob->owners[i] = blob->owners[--blob->ownerCount];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int AdBlobStoreMapURL(AdBlobStore *store, const char *url, const char *etag, const AdBlobHash *hash)
+{
+    AdBlobURL *entry = AdBlobStoreFindURL(store, url);
+    char hex[kAdBlobHashStringLength];
+
+    if (entry && memcmp(&entry->hash, hash, sizeof(AdBlobHash)) == 0 &&
+        ((etag == NULL && entry->etag == NULL) || (etag && entry->etag && strcmp(etag, entry->etag) == 0))) {
+        return 0;
+    }
+    if (entry == NULL) {
+        entry = AdBlobStoreInsertURL(store, url);
+        if (entry == NULL) {
+            return -1;
+        }
+    }
+    free(entry->etag);
+    entry->etag = etag ? strdup(etag) : NULL;
+    entry->hash = *hash;
+    AdBlobHashGetString(hash, hex);
+    AdBlobStoreJournal(store, "U\t%s\t%s\t%s\n", url, hex, etag ? etag : "");
+    return 0;
+}
+
+static void AdBlobStoreApply(AdBlobStore *store, char *line)
+{
+    char *fields[4] = { NULL, NULL, NULL, NULL };
+    int count = 0;
+    AdBlobHash hash;
+    AdBlob *blob;
+
+    for (char *field = line; field && count < 4; count++) {
+        fields[count] = field;
+        field = strchr(field, '\t');
+        if (field) {
+            *field++ = '\0';
+        }
+    }
+    if (count < 2 || strlen(fields[0]) != 1) {
+        return;
+    }
+    switch (fields[0][0]) {
+        case 'B':
+            if (count == 3 && AdBlobHashParse(fields[1], &hash) == 0 && AdBlobStoreFindBlob(store, &hash) == NULL) {
+                AdBlobStoreInsertBlob(store, &hash, strtoull(fields[2], NULL, 10));
+            }
+            break;
+        case 'U':
+            if (count == 4 && AdBlobHashParse(fields[2], &hash) == 0 && AdBlobStoreFindBlob(store, &hash)) {
+                AdBlobStoreMapURL(store, fields[1], fields[3][0] ? fields[3] : NULL, &hash);
+            }
+            break;
+        case 'R':
+        case 'D':
+            if (count == 3 && AdBlobHashParse(fields[1], &hash) == 0 && (blob = AdBlobStoreFindBlob(store, &hash))) {
+                if (fields[0][0] == 'R') {
+                    AdBlobAddOwner(blob, strtoull(fields[2], NULL, 10));
+                } else {
+                    AdBlobRemoveOwner(blob, strtoull(fields[2], NULL, 10));
+                }
+            }
+            break;
+        case 'X':
+            if (AdBlobHashParse(fields[1], &hash) == 0 && (blob = AdBlobStoreFindBlob(store, &hash))) {
+                free(blob->owners);
+                blob->owners = NULL;
+                blob->state = kAdBlobSlotDeleted;
+                store->blobCount--;
+                store->blobDeleted++;
+            }
+            break;
+    }
+}
+
+static char *AdBlobStorePath(const AdBlobStore *store, const char *name)
+{
+    size_t length = strlen(store->directory) + strlen(name) + 2;
+    char *path = malloc(length);
+
+    if (path) {
+        snprintf(path, length, "%s/%s", store->directory, name);
+    }
+    return path;
+}
+
+static int AdBlobStoreReplay(AdBlobStore *store, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    char *contents, *line;
+    ssize_t length = 0;
+
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if (fstat(fd, &info) != 0 || (contents = malloc((size_t)info.st_size + 1)) == NULL) {
+        close(fd);
+        return -1;
+    }
+    while (length < info.st_size) {
+        ssize_t count = read(fd, contents + length, (size_t)(info.st_size - length));
+        if (count <= 0) {
+            break;
+        }
+        length += count;
+    }
+    close(fd);
+    contents[length] = '\0';
+
+    store->replaying = 1;
+    for (line = contents; ; ) {
+        char *end = strchr(line, '\n');
+        if (end == NULL) {
+            break;
+        }
+        *end = '\0';
+        AdBlobStoreApply(store, line);
+        store->journalRecords++;
+        line = end + 1;
+    }
+    store->replaying = 0;
+    free(contents);
+    return 0;
+}
+
+/** Rewrites the journal with the live records only, aside and renamed into place. */
+static int AdBlobStoreCompact(AdBlobStore *store)
+{
+    char *path = AdBlobStorePath(store, kAdBlobJournalName);
+    char *temporaryPath = AdBlobStorePath(store, kAdBlobJournalTemporaryName);
+    char hex[kAdBlobHashStringLength];
+    FILE *file;
+    int status = -1;
+    uint64_t records = 0;
+
+    if (path == NULL || temporaryPath == NULL || (file = fopen(temporaryPath, "w")) == NULL) {
+        free(path);
+        free(temporaryPath);
+        return -1;
+    }
+    for (uint32_t i = 0; i < store->blobCapacity; i++) {
+        AdBlob *blob = &store->blobs[i];
+        if (blob->state == kAdBlobSlotUsed) {
+            AdBlobHashGetString(&blob->hash, hex);
+            fprintf(file, "B\t%s\t%llu\n", hex, (unsigned long long)blob->size);
+            for (uint32_t j = 0; j < blob->ownerCount; j++) {
+                fprintf(file, "R\t%s\t%llu\n", hex, (unsigned long long)blob->owners[j]);
+            }
+            records += 1 + blob->ownerCount;
+        }
+    }
+    for (uint32_t i = 0; i < store->urlCapacity; i++) {
+        AdBlobURL *entry = &store->urls[i];
+        if (entry->state == kAdBlobSlotUsed) {
+            AdBlobHashGetString(&entry->hash, hex);
+            fprintf(file, "U\t%s\t%s\t%s\n", entry->url, hex, entry->etag ? entry->etag : "");
+            records++;
+        }
+    }
+    if (fflush(file) == 0 && fsync(fileno(file)) == 0 && fclose(file) == 0) {
+        file = NULL;
+        if (rename(temporaryPath, path) == 0) {
+            if (store->journal >= 0) {
+                close(store->journal);
+            }
+            store->journal = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+            store->journalRecords = records;
+            status = store->journal >= 0 ? 0 : -1;
+        }
+    }
+    if (file) {
+        fclose(file);
+    }
+    free(path);
+    free(temporaryPath);
+    return status;
+}
+
+// Store
+
+AdBlobStore *AdBlobStoreOpen(const char *directory)
+{
+    AdBlobStore *store = calloc(1, sizeof(AdBlobStore));
+    char *path = NULL;
+    uint64_t liveRecords = 0;
+    int missing = 0;
+
+    if (store == NULL) {
+        return NULL;
+    }
+    store->journal = -1;
+    store->directory = strdup(directory);
+    store->blobCapacity = kAdBlobMinSlots;
+    store->blobs = calloc(kAdBlobMinSlots, sizeof(AdBlob));
+    store->urlCapacity = kAdBlobMinSlots;
+    store->urls = calloc(kAdBlobMinSlots, sizeof(AdBlobURL));
+    if (store->directory == NULL || store->blobs == NULL || store->urls == NULL || (path = AdBlobStorePath(store, kAdBlobJournalName)) == NULL) {
+        AdBlobStoreClose(store);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (AdBlobStoreReplay(store, path) != 0) {
+        int error = errno;
+        free(path);
+        AdBlobStoreClose(store);
+        errno = error;
+        return NULL;
+    }
+
+    // The system may purge Caches under the store: forget the blobs whose file is gone.
+    for (uint32_t i = 0; i < store->blobCapacity; i++) {
+        AdBlob *blob = &store->blobs[i];
+        char blobPath[1024];
+        struct stat info;
+
+        if (blob->state != kAdBlobSlotUsed) {
+            continue;
+        }
+        if (AdBlobStoreGetPath(store, &blob->hash, blobPath, sizeof(blobPath)) != 0 || stat(blobPath, &info) != 0) {
+            free(blob->owners);
+            blob->owners = NULL;
+            blob->state = kAdBlobSlotDeleted;
+            store->blobCount--;
+            store->blobDeleted++;
+            missing = 1;
+        } else {
+            liveRecords += 1 + blob->ownerCount;
+        }
+    }
+    AdBlobStoreSweepURLs(store);
+    liveRecords += store->urlCount;
+
+    if (missing || store->journalRecords > 2 * liveRecords + kAdBlobCompactionSlack) {
+        AdBlobStoreCompact(store);
+    }
+    if (store->journal < 0) {
+        store->journal = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    }
+    free(path);
+    if (store->journal < 0) {
+        int error = errno;
+        AdBlobStoreClose(store);
+        errno = error;
+        return NULL;
+    }
+    return store;
+}
+
+void AdBlobStoreClose(AdBlobStore *store)
+{
+    if (store == NULL) {
+        return;
+    }
+    if (store->journal >= 0) {
+        close(store->journal);
+    }
+    for (uint32_t i = 0; store->blobs && i < store->blobCapacity; i++) {
+        free(store->blobs[i].owners);
+    }
+    for (uint32_t i = 0; store->urls && i < store->urlCapacity; i++) {
+        free(store->urls[i].url);
+        free(store->urls[i].etag);
+    }
+    free(store->blobs);
+    free(store->urls);
+    free(store->directory);
+    free(store);
+}
+
+int AdBlobStoreGetPath(const AdBlobStore *store, const AdBlobHash *hash, char *path, size_t capacity)
+{
+    char hex[kAdBlobHashStringLength];
+    int length;
+
+    AdBlobHashGetString(hash, hex);
+    length = snprintf(path, capacity, "%s/%s", store->directory, hex);
+    return length >= 0 && (size_t)length < capacity ? 0 : -1;
+}
+
+/** Writes the blob aside and renames it into place, so a blob file is always complete. */
+static int AdBlobStoreWriteFile(AdBlobStore *store, const AdBlobHash *hash, const void *bytes, size_t length)
+{
+    char path[1024], temporaryPath[1024];
+    const char *p = bytes;
+    int fd, error;
+
+    if (AdBlobStoreGetPath(store, hash, path, sizeof(path)) != 0 ||
+        snprintf(temporaryPath, sizeof(temporaryPath), "%s/.tmp-%d-%u", store->directory, (int)getpid(), store->temporaryCounter++) >= (int)sizeof(temporaryPath)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fd = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    while (length > 0) {
+        ssize_t count = write(fd, p, length);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        p += count;
+        length -= (size_t)count;
+    }
+    error = length > 0 ? errno : 0;
+    if (close(fd) != 0 && error == 0) {
+        error = errno;
+    }
+    if (error == 0 && rename(temporaryPath, path) != 0) {
+        error = errno;
+    }
+    if (error) {
+        unlink(temporaryPath);
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int AdBlobStorePut(AdBlobStore *store, const char *url, const char *etag, const void *bytes, size_t length, AdBlobHash *hash)
+{
+    AdBlobHash computed;
+    AdBlob *blob;
+
+    AdBlobHashCompute(bytes, length, &computed);
+    if (hash) {
+        *hash = computed;
+    }
+    store->counters.puts++;
+    blob = AdBlobStoreFindBlob(store, &computed);
+    if (blob) {
+        store->counters.dedupedPuts++;
+        store->counters.dedupedBytes += length;
+    } else {
+        char hex[kAdBlobHashStringLength];
+
+        if (AdBlobStoreWriteFile(store, &computed, bytes, length) != 0) {
+            return -1;
+        }
+        if (AdBlobStoreInsertBlob(store, &computed, length) == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        AdBlobHashGetString(&computed, hex);
+        AdBlobStoreJournal(store, "B\t%s\t%llu\n", hex, (unsigned long long)length);
+    }
+    // A URL or an ETag that does not fit in the journal is not remembered, the content is stored all the same.
+    if (AdBlobIsField(url)) {
+        AdBlobStoreMapURL(store, url, AdBlobIsField(etag) && etag[0] ? etag : NULL, &computed);
+    }
+    return 0;
+}
+
+int AdBlobStoreLookupURL(const AdBlobStore *store, const char *url, AdBlobHash *hash, const char **etag)
+{
+    AdBlobURL *entry = url ? AdBlobStoreFindURL(store, url) : NULL;
+
+    if (entry == NULL) {
+        return -1;
+    }
+    if (hash) {
+        *hash = entry->hash;
+    }
+    if (etag) {
+        *etag = entry->etag;
+    }
+    return 0;
+}
+
+int AdBlobStoreRevalidated(AdBlobStore *store, const char *url, AdBlobHash *hash)
+{
+    AdBlobURL *entry = url ? AdBlobStoreFindURL(store, url) : NULL;
+    AdBlob *blob = entry ? AdBlobStoreFindBlob(store, &entry->hash) : NULL;
+
+    if (blob == NULL) {
+        return -1;
+    }
+    if (hash) {
+        *hash = entry->hash;
+    }
+    store->counters.revalidations++;
+    store->counters.revalidatedBytes += blob->size;
+    return 0;
+}
+
+int AdBlobStoreRetain(AdBlobStore *store, const AdBlobHash *hash, uint64_t owner)
+{
+    AdBlob *blob = AdBlobStoreFindBlob(store, hash);
+    int added;
+
+    if (blob == NULL || (added = AdBlobAddOwner(blob, owner)) < 0) {
+        return -1;
+    }
+    if (added) {
+        char hex[kAdBlobHashStringLength];
+        AdBlobHashGetString(hash, hex);
+        AdBlobStoreJournal(store, "R\t%s\t%llu\n", hex, (unsigned long long)owner);
+    }
+    return 0;
+}
+
+int AdBlobStoreRelease(AdBlobStore *store, const AdBlobHash *hash, uint64_t owner)
+{
+    AdBlob *blob = AdBlobStoreFindBlob(store, hash);
+    char hex[kAdBlobHashStringLength];
+
+    if (blob == NULL || AdBlobRemoveOwner(blob, owner) != 0) {
+        return -1;
+    }
+    AdBlobHashGetString(hash, hex);
+    AdBlobStoreJournal(store, "D\t%s\t%llu\n", hex, (unsigned long long)owner);
+    return 0;
+}
+
+uint32_t AdBlobStoreReleaseOwner(AdBlobStore *store, uint64_t owner)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < store->blobCapacity; i++) {
+        AdBlob *blob = &store->blobs[i];
+        if (blob->state == kAdBlobSlotUsed && AdBlobRemoveOwner(blob, owner) == 0) {
+            char hex[kAdBlobHashStringLength];
+            AdBlobHashGetString(&blob->hash, hex);
+            AdBlobStoreJournal(store, "D\t%s\t%llu\n", hex, (unsigned long long)owner);
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t AdBlobStoreGetReferenceCount(const AdBlobStore *store, const AdBlobHash *hash)
+{
+    AdBlob *blob = AdBlobStoreFindBlob(store, hash);
+
+    return blob ? blob->ownerCount : 0;
+}
+
+uint32_t AdBlobStoreCollectGarbage(AdBlobStore *store)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < store->blobCapacity; i++) {
+        AdBlob *blob = &store->blobs[i];
+        char path[1024], hex[kAdBlobHashStringLength];
+
+        if (blob->state != kAdBlobSlotUsed || blob->ownerCount > 0) {
+            continue;
+        }
+        AdBlobHashGetString(&blob->hash, hex);
+        AdBlobStoreJournal(store, "X\t%s\n", hex);
+        if (AdBlobStoreGetPath(store, &blob->hash, path, sizeof(path)) == 0) {
+            unlink(path);
+        }
+        free(blob->owners);
+        blob->owners = NULL;
+        blob->state = kAdBlobSlotDeleted;
+        store->blobCount--;
+        store->blobDeleted++;
+        count++;
+    }
+    if (count > 0) {
+        AdBlobStoreSweepURLs(store);
+    }
+    return count;
+}
+
+AdBlobStoreStatistics AdBlobStoreGetStatistics(const AdBlobStore *store)
+{
+    AdBlobStoreStatistics statistics = store->counters;
+
+    statistics.blobCount = store->blobCount;
+    statistics.URLCount = store->urlCount;
+    statistics.storedBytes = 0;
+    statistics.logicalBytes = 0;
+    for (uint32_t i = 0; i < store->blobCapacity; i++) {
+        if (store->blobs[i].state == kAdBlobSlotUsed) {
+            statistics.storedBytes += store->blobs[i].size;
+        }
+    }
+    for (uint32_t i = 0; i < store->urlCapacity; i++) {
+        if (store->urls[i].state == kAdBlobSlotUsed) {
+            AdBlob *blob = AdBlobStoreFindBlob(store, &store->urls[i].hash);
+            statistics.logicalBytes += blob ? blob->size : 0;
+        }
+    }
+    return statistics;
+}
@@ -0,0 +1,102 @@
+//
+//  AdBlobStore.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Content addressed store of creative assets: images, videos and HTML scripts.
+
+ Insertions often reuse the same file under different URLs. Each blob is stored once, in a file named
+ after the SHA-256 of its content, and each URL maps to the blob it last returned, with its ETag:
+
+ - a download whose content is already stored only adds the URL mapping (dedupe on write);
+ - the next download of a known URL sends If-None-Match with the ETag, and a 304 reuses the blob.
+
+ Cached ads hold references on the blobs of their creatives, one per owner (the insertionId), so a
+ blob shared by several insertions stays until the last of them releases it. Blobs without owners
+ are deleted by AdBlobStoreCollectGarbage, with the URLs that map to them.
+
+ The URL mappings and the references are kept in memory and written ahead to a journal, replayed and
+ compacted when the store is opened. The blob files are written aside and renamed into place.
+
+ This file is plain C. A store is not thread safe, callers serialize access.
+ */
+
+#ifndef DemoSmart_AdBlobStore_h
+#define DemoSmart_AdBlobStore_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdBlobHashLength       32
+#define kAdBlobHashStringLength (2 * kAdBlobHashLength + 1)
+
+typedef struct {
+    uint8_t bytes[kAdBlobHashLength];
+} AdBlobHash;
+
+typedef struct {
+    uint32_t blobCount;
+    uint32_t URLCount;
+    uint64_t storedBytes;       /* the size of the blob files */
+    uint64_t logicalBytes;      /* the size of what the URLs map to, as if every URL had its own copy */
+    uint64_t puts;              /* since the store was opened */
+    uint64_t dedupedPuts;       /* puts whose content was already stored */
+    uint64_t dedupedBytes;
+    uint64_t revalidations;     /* 304 answers */
+    uint64_t revalidatedBytes;  /* the size of the blobs they reused */
+} AdBlobStoreStatistics;
+
+typedef struct AdBlobStore AdBlobStore;
+
+/** The SHA-256 of the bytes. */
+void AdBlobHashCompute(const void *bytes, size_t length, AdBlobHash *hash);
+
+/** Writes the lowercase hexadecimal form of the hash, kAdBlobHashStringLength bytes with the NUL. */
+void AdBlobHashGetString(const AdBlobHash *hash, char *string);
+
+/** Opens or creates the store in an existing directory. Returns NULL and sets errno on failure. */
+AdBlobStore *AdBlobStoreOpen(const char *directory);
+void AdBlobStoreClose(AdBlobStore *store);
+
+/** Stores the content downloaded from a URL, unless it is already stored, and maps the URL to it.
+
+ @param etag The ETag of the response, may be NULL.
+ @param hash Set to the hash of the content, may be NULL.
+ @return 0 on success, -1 with errno set if the blob could not be written.
+ */
+int AdBlobStorePut(AdBlobStore *store, const char *url, const char *etag, const void *bytes, size_t length, AdBlobHash *hash);
+
+/** Finds the blob a URL mapped to, for a conditional request.
+
+ @param etag Set to the ETag to send in If-None-Match, NULL if there was none. Valid until the next call that modifies the store. May be NULL.
+ @return 0 if the URL is known, -1 otherwise.
+ */
+int AdBlobStoreLookupURL(const AdBlobStore *store, const char *url, AdBlobHash *hash, const char **etag);
+
+/** Records a 304 answer for a known URL. Returns 0, or -1 if the URL is not known. */
+int AdBlobStoreRevalidated(AdBlobStore *store, const char *url, AdBlobHash *hash);
+
+/** Writes the path of the blob file. Returns 0, or -1 if the blob is not stored or the path does not fit. */
+int AdBlobStoreGetPath(const AdBlobStore *store, const AdBlobHash *hash, char *path, size_t capacity);
+
+/** Adds the reference of an owner on a blob, once per owner. Returns 0, or -1 if the blob is not stored. */
+int AdBlobStoreRetain(AdBlobStore *store, const AdBlobHash *hash, uint64_t owner);
+
+/** Removes the reference of an owner. Returns 0, or -1 if the owner held none. */
+int AdBlobStoreRelease(AdBlobStore *store, const AdBlobHash *hash, uint64_t owner);
+
+/** Removes the references of an owner on every blob. Returns the number removed. */
+uint32_t AdBlobStoreReleaseOwner(AdBlobStore *store, uint64_t owner);
+
+uint32_t AdBlobStoreGetReferenceCount(const AdBlobStore *store, const AdBlobHash *hash);
+
+/** Deletes the blobs nobody references, and the URLs mapping to them. Returns the number of blobs deleted. */
+uint32_t AdBlobStoreCollectGarbage(AdBlobStore *store);
+
+AdBlobStoreStatistics AdBlobStoreGetStatistics(const AdBlobStore *store);
+
+#endif
@@ -0,0 +1,147 @@
+//
+//  AdBridge.js
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+// Script side of AdBridgeChannel, injected in the web view of a creative by AdMRAIDBridge.
+//
+// The native state is mirrored here, so AdBridge.get("heading") and the MRAID getters it backs
+// never leave the web view. Calls to the native code are queued, and the native side drains them
+// with AdBridge.exchange(message) once per frame, in the same crossing that brings the state that
+// changed and the results of the previous calls. A single adbridge:// navigation per batch tells
+// the native side that calls are waiting.
+
+(function (window) {
+    if (window.AdBridge) {
+        return;
+    }
+
+    var state = {};
+    var queue = [];
+    var callbacks = {};
+    var listeners = {};
+    var nextCallId = 1;
+    var signaled = false;
+    var lastSequence = 0;
+
+    function signal() {
+        var frame;
+
+        if (signaled || !window.document || !window.document.documentElement) {
+            return;
+        }
+        signaled = true;
+        frame = window.document.createElement("iframe");
+        frame.style.display = "none";
+        frame.src = "adbridge://flush";
+        window.document.documentElement.appendChild(frame);
+        window.document.documentElement.removeChild(frame);
+    }
+
+    function fire(name, value) {
+        var list = listeners[name] || [];
+
+        for (var i = 0; i < list.length; i++) {
+            try {
+                list[i](value);
+            } catch (error) {
+                // A listener of the creative does not stop the others.
+            }
+        }
+    }
+
+    var AdBridge = {
+        get: function (name) {
+            return state[name];
+        },
+
+        addEventListener: function (name, listener) {
+            (listeners[name] = listeners[name] || []).push(listener);
+        },
+
+        removeEventListener: function (name, listener) {
+            var list = listeners[name] || [];
+            var index = list.indexOf(listener);
+
+            if (index >= 0) {
+                list.splice(index, 1);
+            }
+        },
+
+        // Queues a call of a native method. The callback, if any, gets the result with a later frame.
+        call: function (method, argument, callback) {
+            var callId = nextCallId++;
+
+            if (callback) {
+                callbacks[callId] = callback;
+            }
+            queue.push(callId + "\t" + method + "\t" + encodeURIComponent(argument === undefined ? "" : String(argument)));
+            signal();
+            return callId;
+        },
+
+        // Called by the native side: applies the message, returns the queued calls.
+        exchange: function (message) {
+            var drained = queue.length ? queue.join("\n") + "\n" : "";
+            var changed = [];
+            var results;
+
+            queue = [];
+            signaled = false;
+            if (message && message.seq > lastSequence) {
+                lastSequence = message.seq;
+                for (var name in message.state) {
+                    if (message.state.hasOwnProperty(name)) {
+                        state[name] = message.state[name];
+                        changed.push(name);
+                    }
+                }
+                results = message.results || [];
+                for (var i = 0; i < results.length; i++) {
+                    var callback = callbacks[results[i][0]];
+
+                    delete callbacks[results[i][0]];
+                    if (callback) {
+                        try {
+                            callback(results[i][1]);
+                        } catch (error) {
+                        }
+                    }
+                }
+                for (var j = 0; j < changed.length; j++) {
+                    fire(changed[j], state[changed[j]]);
+                }
+                if (changed.length) {
+                    fire("change", changed);
+                }
+            }
+            return drained;
+        }
+    };
+
+    // The MRAID and ORMMA getters of the SDK cross to the native code on every call; these read the mirror.
+    function backMRAIDGetters() {
+        var mraid = window.mraid;
+        var ormma = window.ormma;
+
+        if (mraid) {
+            mraid.isViewable = function () {
+                return state.exposure > 0;
+            };
+        }
+        if (ormma) {
+            ormma.getHeading = function () {
+                return state.heading;
+            };
+        }
+    }
+
+    window.AdBridge = AdBridge;
+    backMRAIDGetters();
+    if (!window.mraid && window.addEventListener) {
+        window.addEventListener("load", backMRAIDGetters, false);
+    }
+})(window);
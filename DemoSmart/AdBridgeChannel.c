@@ -0,0 +1,371 @@
+//
+//  AdBridgeChannel.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdBridgeChannel.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kAdBridgeMethodMaxLength    63
+
+enum {
+    AdBridgeFieldWidth          = 1 << 0,
+    AdBridgeFieldHeight         = 1 << 1,
+    AdBridgeFieldOrientation    = 1 << 2,
+    AdBridgeFieldHeading        = 1 << 3,
+    AdBridgeFieldExposure       = 1 << 4,
+    AdBridgeFieldAll            = (1 << 5) - 1
+};
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} AdBridgeBuffer;
+
+struct AdBridgeChannel {
+    AdBridgeState state;
+    AdBridgeState sent;
+    int hasSent;                /* the script has a mirror of sent */
+    uint32_t sequence;
+    AdBridgeBuffer results;     /* the queued results, "[id,\"value\"]" separated by commas */
+    AdBridgeBuffer message;
+    AdBridgeBuffer argument;
+    AdBridgeChannelStatistics statistics;
+};
+
+// Buffers
+
+static int AdBridgeAppend(AdBridgeBuffer *buffer, const char *bytes, size_t length)
+{
+    if (buffer->length + length + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        char *grown;
+
+        while (capacity < buffer->length + length + 1) {
+            capacity *= 2;
+        }
+        grown = realloc(buffer->bytes, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        buffer->bytes = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+    buffer->bytes[buffer->length] = '\0';
+    return 0;
+}
+
+static int AdBridgeAppendFormat(AdBridgeBuffer *buffer, const char *format, double value)
+{
+    char string[32];
+    int length = snprintf(string, sizeof(string), format, value);
+
+    return AdBridgeAppend(buffer, string, (size_t)length);
+}
+
+/** Appends a JSON string. The message is evaluated as script source, where U+2028 and U+2029 end a line. */
+static int AdBridgeAppendString(AdBridgeBuffer *buffer, const char *string)
+{
+    const unsigned char *cursor = (const unsigned char *)string, *run = cursor;
+    int failed = AdBridgeAppend(buffer, "\"", 1);
+
+    for (; *cursor && !failed; cursor++) {
+        char escape[8];
+        size_t escapeLength;
+
+        if (*cursor == '"' || *cursor == '\\') {
+            escape[0] = '\\';
+            escape[1] = (char)*cursor;
+            escapeLength = 2;
+        } else if (*cursor < 0x20) {
+            snprintf(escape, sizeof(escape), "\\u%04x", *cursor);
+            escapeLength = 6;
+        } else if (cursor[0] == 0xE2 && cursor[1] == 0x80 && (cursor[2] == 0xA8 || cursor[2] == 0xA9)) {
+            memcpy(escape, cursor[2] == 0xA8 ? "\\u2028" : "\\u2029", 6);
+            escapeLength = 6;
+        } else {
+            continue;
+        }
+        // The bytes before the escape are copied at once.
+        failed = AdBridgeAppend(buffer, (const char *)run, (size_t)(cursor - run)) || AdBridgeAppend(buffer, escape, escapeLength);
+        if (escapeLength == 6 && *cursor == 0xE2) {
+            cursor += 2;
+        }
+        run = cursor + 1;
+    }
+    if (failed || AdBridgeAppend(buffer, (const char *)run, (size_t)(cursor - run)) != 0) {
+        return -1;
+    }
+    return AdBridgeAppend(buffer, "\"", 1);
+}
+
+// Channel
+
+AdBridgeChannel *AdBridgeChannelCreate(void)
+{
+    AdBridgeChannel *channel = calloc(1, sizeof(AdBridgeChannel));
+
+    if (channel) {
+        channel->state.heading = -1;
+    }
+    return channel;
+}
+
+void AdBridgeChannelRelease(AdBridgeChannel *channel)
+{
+    if (channel == NULL) {
+        return;
+    }
+    free(channel->results.bytes);
+    free(channel->message.bytes);
+    free(channel->argument.bytes);
+    free(channel);
+}
+
+void AdBridgeChannelSetState(AdBridgeChannel *channel, const AdBridgeState *state)
+{
+    channel->state = *state;
+    channel->statistics.stateUpdates++;
+}
+
+void AdBridgeChannelReset(AdBridgeChannel *channel)
+{
+    channel->hasSent = 0;
+    channel->results.length = 0;
+}
+
+/** The fields that differ from the mirror of the script. */
+static uint32_t AdBridgeChangedFields(const AdBridgeChannel *channel)
+{
+    const AdBridgeState *state = &channel->state, *sent = &channel->sent;
+    uint32_t fields = 0;
+
+    if (!channel->hasSent) {
+        return AdBridgeFieldAll;
+    }
+    if (state->width != sent->width) {
+        fields |= AdBridgeFieldWidth;
+    }
+    if (state->height != sent->height) {
+        fields |= AdBridgeFieldHeight;
+    }
+    if (state->orientation != sent->orientation) {
+        fields |= AdBridgeFieldOrientation;
+    }
+    if ((state->heading < 0) != (sent->heading < 0)) {
+        fields |= AdBridgeFieldHeading;
+    } else if (state->heading >= 0) {
+        double delta = fabs(state->heading - sent->heading);
+
+        // 359 and 0 are one degree apart.
+        if (delta > 180) {
+            delta = 360 - delta;
+        }
+        if (delta >= kAdBridgeHeadingResolution) {
+            fields |= AdBridgeFieldHeading;
+        }
+    }
+    if (state->exposure != sent->exposure) {
+        fields |= AdBridgeFieldExposure;
+    }
+    return fields;
+}
+
+int AdBridgeChannelHasPendingMessage(const AdBridgeChannel *channel)
+{
+    return channel->results.length > 0 || AdBridgeChangedFields(channel) != 0;
+}
+
+const char *AdBridgeChannelFlush(AdBridgeChannel *channel, size_t *length)
+{
+    const AdBridgeState *state = &channel->state;
+    uint32_t fields = AdBridgeChangedFields(channel);
+    AdBridgeBuffer *message = &channel->message;
+    const char *separator = "";
+    int failed;
+
+    if (fields == 0 && channel->results.length == 0) {
+        return NULL;
+    }
+    message->length = 0;
+    failed = AdBridgeAppendFormat(message, "{\"seq\":%.0f", ++channel->sequence);
+    if (fields) {
+        failed |= AdBridgeAppend(message, ",\"state\":{", 10);
+        if (fields & AdBridgeFieldWidth) {
+            failed |= AdBridgeAppendFormat(message, "\"width\":%g", state->width);
+            separator = ",";
+        }
+        if (fields & AdBridgeFieldHeight) {
+            failed |= AdBridgeAppend(message, separator, strlen(separator));
+            failed |= AdBridgeAppendFormat(message, "\"height\":%g", state->height);
+            separator = ",";
+        }
+        if (fields & AdBridgeFieldOrientation) {
+            failed |= AdBridgeAppend(message, separator, strlen(separator));
+            failed |= AdBridgeAppendFormat(message, "\"orientation\":%.0f", state->orientation);
+            separator = ",";
+        }
+        if (fields & AdBridgeFieldHeading) {
+            failed |= AdBridgeAppend(message, separator, strlen(separator));
+            failed |= AdBridgeAppendFormat(message, "\"heading\":%.0f", state->heading < 0 ? -1 : state->heading);
+            separator = ",";
+        }
+        if (fields & AdBridgeFieldExposure) {
+            failed |= AdBridgeAppend(message, separator, strlen(separator));
+            failed |= AdBridgeAppendFormat(message, "\"exposure\":%.0f", state->exposure);
+        }
+        failed |= AdBridgeAppend(message, "}", 1);
+    }
+    if (channel->results.length > 0) {
+        failed |= AdBridgeAppend(message, ",\"results\":[", 12);
+        failed |= AdBridgeAppend(message, channel->results.bytes, channel->results.length);
+        failed |= AdBridgeAppend(message, "]", 1);
+    }
+    failed |= AdBridgeAppend(message, "}", 1);
+    if (failed) {
+        return NULL;
+    }
+
+    // The heading only moves the mirror when it is sent, so that slow turns add up.
+    if (fields & AdBridgeFieldHeading) {
+        channel->sent.heading = state->heading;
+    }
+    channel->sent.width = state->width;
+    channel->sent.height = state->height;
+    channel->sent.orientation = state->orientation;
+    channel->sent.exposure = state->exposure;
+    channel->hasSent = 1;
+    channel->results.length = 0;
+    for (uint32_t field = fields; field; field &= field - 1) {
+        channel->statistics.fieldsSent++;
+    }
+    channel->statistics.messages++;
+    channel->statistics.bytesSent += message->length;
+    if (length) {
+        *length = message->length;
+    }
+    return message->bytes;
+}
+
+// Calls
+
+static int AdBridgeHexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/** Decodes the percent-encoded argument of a call into the argument buffer. Returns -1 when out of memory. */
+static int AdBridgeDecodeArgument(AdBridgeChannel *channel, const char *start, const char *end)
+{
+    AdBridgeBuffer *argument = &channel->argument;
+
+    argument->length = 0;
+    if (AdBridgeAppend(argument, "", 0) != 0) {
+        return -1;
+    }
+    while (start < end) {
+        const char *escape = memchr(start, '%', (size_t)(end - start));
+        const char *stop = escape ? escape : end;
+        char byte;
+
+        if (AdBridgeAppend(argument, start, (size_t)(stop - start)) != 0) {
+            return -1;
+        }
+        if (escape == NULL) {
+            break;
+        }
+        if (end - escape >= 3 && AdBridgeHexValue(escape[1]) >= 0 && AdBridgeHexValue(escape[2]) >= 0) {
+            byte = (char)(AdBridgeHexValue(escape[1]) << 4 | AdBridgeHexValue(escape[2]));
+            start = escape + 3;
+        } else {
+            byte = '%';
+            start = escape + 1;
+        }
+        if (AdBridgeAppend(argument, &byte, 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int AdBridgeChannelReceive(AdBridgeChannel *channel, const char *batch, size_t length, AdBridgeCallHandler handler, void *info)
+{
+    const char *cursor = batch, *end = batch + length;
+    char result[kAdBridgeResultMaxLength];
+    int handled = 0;
+
+    channel->statistics.batches++;
+    while (cursor < end) {
+        const char *lineEnd = memchr(cursor, '\n', (size_t)(end - cursor));
+        const char *idEnd = cursor, *methodStart, *methodEnd, *argumentStart;
+        char method[kAdBridgeMethodMaxLength + 1];
+        uint64_t callId = 0;
+
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+        // The batch is not NUL terminated, so the id is parsed by hand.
+        while (idEnd < lineEnd && *idEnd >= '0' && *idEnd <= '9' && callId <= UINT32_MAX) {
+            callId = callId * 10 + (uint64_t)(*idEnd++ - '0');
+        }
+        methodStart = idEnd + 1;
+        methodEnd = methodStart < lineEnd ? memchr(methodStart, '\t', (size_t)(lineEnd - methodStart)) : NULL;
+        if (idEnd == cursor || idEnd >= lineEnd || *idEnd != '\t' || callId > UINT32_MAX || methodEnd == NULL || methodEnd == methodStart
+            || (size_t)(methodEnd - methodStart) > kAdBridgeMethodMaxLength) {
+            if (lineEnd > cursor) {
+                channel->statistics.malformedCalls++;
+            }
+            cursor = lineEnd + 1;
+            continue;
+        }
+        memcpy(method, methodStart, (size_t)(methodEnd - methodStart));
+        method[methodEnd - methodStart] = '\0';
+        argumentStart = methodEnd + 1;
+        if (AdBridgeDecodeArgument(channel, argumentStart, lineEnd) != 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        channel->statistics.calls++;
+        handled++;
+        if (handler && handler(info, (uint32_t)callId, method, channel->argument.bytes, result, sizeof(result)) == 1) {
+            char item[16];
+            int itemLength = snprintf(item, sizeof(item), "%s[%u,", channel->results.length > 0 ? "," : "", (unsigned)callId);
+
+            result[sizeof(result) - 1] = '\0';
+            if (AdBridgeAppend(&channel->results, item, (size_t)itemLength) != 0 || AdBridgeAppendString(&channel->results, result) != 0
+                || AdBridgeAppend(&channel->results, "]", 1) != 0) {
+                errno = ENOMEM;
+                return -1;
+            }
+            channel->statistics.results++;
+        }
+        cursor = lineEnd + 1;
+    }
+    return handled;
+}
+
+void AdBridgeChannelGetStatistics(const AdBridgeChannel *channel, AdBridgeChannelStatistics *statistics)
+{
+    *statistics = channel->statistics;
+}
@@ -0,0 +1,95 @@
+//
+//  AdBridgeChannel.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Native side of a batched message channel between the app and the script of an MRAID creative.
+
+ A creative calling the native code one property at a time (getHeading(), getSize(), isViewable()
+ from a requestAnimationFrame loop) costs a web view round trip per call. With the channel, the
+ crossings are at most one per frame, in both directions at once:
+
+ - the native state (size, orientation, heading, viewability) is set as often as it is sampled,
+   and only the fields that changed since the last message are sent. The heading is sent when it
+   moved by at least kAdBridgeHeadingResolution. The script keeps a mirror of the state, so the
+   getters read it without crossing;
+ - the calls of the script are queued on its side and drained together by the same exchange,
+   as lines of "id\tmethod\targument\n" with the argument percent-encoded. Their results go
+   back with the next message.
+
+ A message is a JSON object: {"seq":n,"state":{"width":320,...},"results":[[id,"value"],...]},
+ both members being optional. AdBridge.js is the script side; tools/adbridgebench drives the
+ channel with a C stand-in for it.
+
+ This file is plain C. A channel is not thread safe, callers serialize access.
+ */
+
+#ifndef DemoSmart_AdBridgeChannel_h
+#define DemoSmart_AdBridgeChannel_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdBridgeHeadingResolution  1.0     /* degrees */
+#define kAdBridgeResultMaxLength    4096
+
+typedef struct {
+    double width;           /* points */
+    double height;
+    int32_t orientation;    /* degrees: 0, 90, -90 or 180 */
+    double heading;         /* degrees from the north, -1 when unknown */
+    int32_t exposure;       /* percent of the web view on screen, 0 to 100 */
+} AdBridgeState;
+
+typedef struct {
+    uint64_t stateUpdates;      /* AdBridgeChannelSetState calls */
+    uint64_t fieldsSent;
+    uint64_t messages;
+    uint64_t bytesSent;
+    uint64_t batches;           /* AdBridgeChannelReceive calls */
+    uint64_t calls;
+    uint64_t malformedCalls;
+    uint64_t results;
+} AdBridgeChannelStatistics;
+
+/** Handles a call of the script. Returns 1 with a NUL-terminated result written for the script, 0 when the call has no result.
+
+ @param argument Decoded, NUL terminated. "" when there is none.
+ @param capacity The size of result, kAdBridgeResultMaxLength.
+ */
+typedef int (*AdBridgeCallHandler)(void *info, uint32_t callId, const char *method, const char *argument, char *result, size_t capacity);
+
+typedef struct AdBridgeChannel AdBridgeChannel;
+
+/** Returns NULL when out of memory. */
+AdBridgeChannel *AdBridgeChannelCreate(void);
+void AdBridgeChannelRelease(AdBridgeChannel *channel);
+
+/** Sets the current native state. Nothing is sent until the next flush, and only what changed. */
+void AdBridgeChannelSetState(AdBridgeChannel *channel, const AdBridgeState *state);
+
+/** Forgets what the script has, after it lost its mirror (the page was reloaded): the next flush sends every field. */
+void AdBridgeChannelReset(AdBridgeChannel *channel);
+
+/** Whether a flush would return a message: a field changed, or a result is waiting. */
+int AdBridgeChannelHasPendingMessage(const AdBridgeChannel *channel);
+
+/** The message to send, NUL terminated and valid until the next call on the channel, or NULL when there is nothing to send.
+
+ The changed fields and the queued results are then considered sent.
+ */
+const char *AdBridgeChannelFlush(AdBridgeChannel *channel, size_t *length);
+
+/** Handles a batch of calls drained from the script. Returns the number of calls handled, -1 when out of memory.
+
+ Malformed lines are skipped and counted.
+ */
+int AdBridgeChannelReceive(AdBridgeChannel *channel, const char *batch, size_t length, AdBridgeCallHandler handler, void *info);
+
+void AdBridgeChannelGetStatistics(const AdBridgeChannel *channel, AdBridgeChannelStatistics *statistics);
+
+#endif
@@ -0,0 +1,869 @@
+//
+//  AdCache.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdCache.h"
+#include "AdPlacementHash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kAdCacheLogMagic        0x4c434153u     /* "SACL" */
+#define kAdCacheEntryMagic      0x45434153u     /* "SACE" */
+#define kAdCacheIndexMagic      0x49434153u     /* "SACI" */
+#define kAdCacheVersion         1
+#define kAdCacheLogChunk        (1024 * 1024)
+#define kAdCacheMinSlots        1024
+
+#define kAdCacheSlotEmpty       0
+#define kAdCacheSlotDeleted     1
+
+#define AdCacheAlign(x) (((x) + 7) & ~(uint64_t)7)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;    /* bumped by every compaction */
+    uint64_t length;        /* used bytes, header included */
+    uint64_t deadLength;
+} AdCacheLogHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t entryLength;   /* header, key and record, padded to 8 bytes */
+    uint64_t hash;
+    int64_t formatId;
+    double expirationDate;
+    uint32_t pageIdLength;  /* the key strings follow the header, NUL terminated */
+    uint32_t targetLength;
+    uint32_t recordOffset;  /* from the start of the entry */
+    uint32_t recordLength;
+} AdCacheEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;      /* number of slots, a power of two */
+    uint32_t count;
+    uint32_t deleted;
+    uint32_t reserved;
+    uint64_t generation;    /* generation of the log this index describes */
+    uint64_t indexedLength; /* log bytes reflected in the index */
+} AdCacheIndexHeader;
+
+typedef struct {
+    uint64_t hash;          /* kAdCacheSlotEmpty, kAdCacheSlotDeleted or a key hash */
+    uint64_t offset;
+    double expirationDate;
+} AdCacheSlot;
+
+struct AdCache {
+    char *logPath;
+    char *indexPath;
+    int logFd;
+    int indexFd;
+    char *log;
+    size_t logCapacity;
+    char *index;
+    size_t indexLength;
+
+    uint32_t *heap;         /* slot numbers ordered by expiration date */
+    uint32_t *heapPositions;
+    uint32_t heapCount;
+
+    uint32_t maxEntries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+};
+
+static AdCacheLogHeader *AdCacheLog(const AdCache *cache)
+{
+    return (AdCacheLogHeader *)cache->log;
+}
+
+static AdCacheIndexHeader *AdCacheIndex(const AdCache *cache)
+{
+    return (AdCacheIndexHeader *)cache->index;
+}
+
+static AdCacheSlot *AdCacheSlots(const AdCache *cache)
+{
+    return (AdCacheSlot *)(cache->index + sizeof(AdCacheIndexHeader));
+}
+
+static char *AdCachePath(const char *directory, const char *name)
+{
+    size_t length = strlen(directory) + strlen(name) + 2;
+    char *path = malloc(length);
+    if (path) {
+        snprintf(path, length, "%s/%s", directory, name);
+    }
+    return path;
+}
+
+// Keys
+
+static uint64_t AdCacheHashKey(int64_t formatId, const char *pageId, const char *target)
+{
+    uint64_t hash = AdPlacementHash(formatId, pageId, target);
+
+    return hash <= kAdCacheSlotDeleted ? hash + 2 : hash;
+}
+
+static const AdCacheEntry *AdCacheEntryAt(const AdCache *cache, uint64_t offset)
+{
+    const AdCacheEntry *entry;
+
+    if (offset < sizeof(AdCacheLogHeader) || offset + sizeof(AdCacheEntry) > AdCacheLog(cache)->length || (offset & 7) != 0) {
+        return NULL;
+    }
+    entry = (const AdCacheEntry *)(cache->log + offset);
+    if (entry->magic != kAdCacheEntryMagic || offset + entry->entryLength > AdCacheLog(cache)->length
+        || entry->entryLength < sizeof(AdCacheEntry) + entry->pageIdLength + entry->targetLength + 2
+        || (uint64_t)entry->recordOffset + entry->recordLength > entry->entryLength) {
+        return NULL;
+    }
+    return entry;
+}
+
+static const char *AdCacheEntryPageId(const AdCacheEntry *entry)
+{
+    return (const char *)(entry + 1);
+}
+
+static const char *AdCacheEntryTarget(const AdCacheEntry *entry)
+{
+    return AdCacheEntryPageId(entry) + entry->pageIdLength + 1;
+}
+
+static int AdCacheEntryMatches(const AdCacheEntry *entry, int64_t formatId, const char *pageId, const char *target)
+{
+    return entry->formatId == formatId
+        && strcmp(AdCacheEntryPageId(entry), pageId) == 0
+        && strcmp(AdCacheEntryTarget(entry), target) == 0;
+}
+
+// Expiration heap
+
+static double AdCacheHeapKey(const AdCache *cache, uint32_t slot)
+{
+    double expirationDate = AdCacheSlots(cache)[slot].expirationDate;
+    return expirationDate > 0 ? expirationDate : HUGE_VAL;
+}
+
+static void AdCacheHeapSwap(AdCache *cache, uint32_t a, uint32_t b)
+{
+    uint32_t slot = cache->heap[a];
+    cache->heap[a] = cache->heap[b];
+    cache->heap[b] = slot;
+    cache->heapPositions[cache->heap[a]] = a;
+    cache->heapPositions[cache->heap[b]] = b;
+}
+
+static void AdCacheHeapUp(AdCache *cache, uint32_t position)
+{
+    while (position > 0) {
+        uint32_t parent = (position - 1) / 2;
+        if (AdCacheHeapKey(cache, cache->heap[parent]) <= AdCacheHeapKey(cache, cache->heap[position])) {
+            break;
+        }
+        AdCacheHeapSwap(cache, parent, position);
+        position = parent;
+    }
+}
+
+static void AdCacheHeapDown(AdCache *cache, uint32_t position)
+{
+    for (;;) {
+        uint32_t smallest = position;
+        uint32_t left = 2 * position + 1;
+        uint32_t right = left + 1;
+        if (left < cache->heapCount && AdCacheHeapKey(cache, cache->heap[left]) < AdCacheHeapKey(cache, cache->heap[smallest])) {
+            smallest = left;
+        }
+        if (right < cache->heapCount && AdCacheHeapKey(cache, cache->heap[right]) < AdCacheHeapKey(cache, cache->heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == position) {
+            break;
+        }
+        AdCacheHeapSwap(cache, smallest, position);
+        position = smallest;
+    }
+}
+
+static void AdCacheHeapPush(AdCache *cache, uint32_t slot)
+{
+    cache->heap[cache->heapCount] = slot;
+    cache->heapPositions[slot] = cache->heapCount;
+    cache->heapCount++;
+    AdCacheHeapUp(cache, cache->heapCount - 1);
+}
+
+static void AdCacheHeapRemove(AdCache *cache, uint32_t slot)
+{
+    uint32_t position = cache->heapPositions[slot];
+    uint32_t last = cache->heapCount - 1;
+
+    if (position != last) {
+        AdCacheHeapSwap(cache, position, last);
+    }
+    cache->heapCount--;
+    cache->heapPositions[slot] = UINT32_MAX;
+    if (position < cache->heapCount) {
+        AdCacheHeapUp(cache, position);
+        AdCacheHeapDown(cache, position);
+    }
+}
+
+static int AdCacheHeapRebuild(AdCache *cache)
+{
+    uint32_t capacity = AdCacheIndex(cache)->capacity;
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    uint32_t *heap = realloc(cache->heap, capacity * sizeof(uint32_t));
+    uint32_t *positions = heap ? realloc(cache->heapPositions, capacity * sizeof(uint32_t)) : NULL;
+
+    if (heap) {
+        cache->heap = heap;
+    }
+    if (positions == NULL) {
+        return -1;
+    }
+    cache->heapPositions = positions;
+    cache->heapCount = 0;
+    for (uint32_t i = 0; i < capacity; i++) {
+        positions[i] = UINT32_MAX;
+        if (slots[i].hash > kAdCacheSlotDeleted) {
+            heap[cache->heapCount] = i;
+            positions[i] = cache->heapCount++;
+        }
+    }
+    for (uint32_t i = cache->heapCount / 2; i-- > 0;) {
+        AdCacheHeapDown(cache, i);
+    }
+    return 0;
+}
+
+// Files
+
+static void AdCacheUnmapLog(AdCache *cache)
+{
+    if (cache->log) {
+        munmap(cache->log, cache->logCapacity);
+        cache->log = NULL;
+    }
+}
+
+static int AdCacheMapLog(AdCache *cache, size_t capacity)
+{
+    void *map;
+
+    AdCacheUnmapLog(cache);
+    if (ftruncate(cache->logFd, (off_t)capacity) != 0) {
+        return -1;
+    }
+    map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, cache->logFd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    cache->log = map;
+    cache->logCapacity = capacity;
+    return 0;
+}
+
+static int AdCacheReserveLog(AdCache *cache, size_t extra)
+{
+    uint64_t needed = AdCacheLog(cache)->length + extra;
+    size_t capacity = cache->logCapacity;
+
+    if (needed <= capacity) {
+        return 0;
+    }
+    while (capacity < needed) {
+        capacity = capacity < 64 * kAdCacheLogChunk ? capacity * 2 : capacity + 64 * kAdCacheLogChunk;
+    }
+    return AdCacheMapLog(cache, capacity);
+}
+
+static int AdCacheOpenLog(AdCache *cache)
+{
+    struct stat info;
+    AdCacheLogHeader *header;
+
+    cache->logFd = open(cache->logPath, O_RDWR | O_CREAT, 0644);
+    if (cache->logFd < 0 || fstat(cache->logFd, &info) != 0) {
+        return -1;
+    }
+    if (AdCacheMapLog(cache, info.st_size >= (off_t)kAdCacheLogChunk ? (size_t)info.st_size : kAdCacheLogChunk) != 0) {
+        return -1;
+    }
+    header = AdCacheLog(cache);
+    if (header->magic != kAdCacheLogMagic || header->version != kAdCacheVersion
+        || header->length < sizeof(AdCacheLogHeader) || header->length > cache->logCapacity) {
+        uint64_t generation = header->magic == kAdCacheLogMagic ? header->generation + 1 : 1;
+        memset(header, 0, sizeof(AdCacheLogHeader));
+        header->magic = kAdCacheLogMagic;
+        header->version = kAdCacheVersion;
+        header->generation = generation;
+        header->length = sizeof(AdCacheLogHeader);
+    }
+    return 0;
+}
+
+static int AdCacheMapIndex(AdCache *cache, int fd, size_t length)
+{
+    void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    if (cache->index) {
+        munmap(cache->index, cache->indexLength);
+    }
+    if (cache->indexFd >= 0) {
+        close(cache->indexFd);
+    }
+    cache->index = map;
+    cache->indexLength = length;
+    cache->indexFd = fd;
+    return 0;
+}
+
+/** Replaces the index with an empty one of the given capacity, written aside and renamed into place. */
+static int AdCacheCreateIndex(AdCache *cache, uint32_t capacity)
+{
+    size_t length = sizeof(AdCacheIndexHeader) + (size_t)capacity * sizeof(AdCacheSlot);
+    size_t pathLength = strlen(cache->indexPath) + 5;
+    char *temporaryPath = malloc(pathLength);
+    AdCacheIndexHeader *header;
+    int fd;
+
+    if (temporaryPath == NULL) {
+        return -1;
+    }
+    snprintf(temporaryPath, pathLength, "%s.tmp", cache->indexPath);
+    fd = open(temporaryPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)length) != 0 || rename(temporaryPath, cache->indexPath) != 0
+        || AdCacheMapIndex(cache, fd, length) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(temporaryPath);
+        return -1;
+    }
+    free(temporaryPath);
+
+    header = AdCacheIndex(cache);
+    header->magic = kAdCacheIndexMagic;
+    header->version = kAdCacheVersion;
+    header->capacity = capacity;
+    header->generation = AdCacheLog(cache)->generation;
+    header->indexedLength = sizeof(AdCacheLogHeader);
+    return 0;
+}
+
+// Index
+
+static int64_t AdCacheFindSlot(const AdCache *cache, uint64_t hash, int64_t formatId, const char *pageId, const char *target)
+{
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    uint32_t mask = AdCacheIndex(cache)->capacity - 1;
+    uint32_t i = (uint32_t)hash & mask;
+
+    for (uint32_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask) {
+        if (slots[i].hash == kAdCacheSlotEmpty) {
+            return -1;
+        }
+        if (slots[i].hash == hash) {
+            const AdCacheEntry *entry = AdCacheEntryAt(cache, slots[i].offset);
+            if (entry && AdCacheEntryMatches(entry, formatId, pageId, target)) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static uint32_t AdCacheFreeSlot(const AdCache *cache, uint64_t hash)
+{
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    uint32_t mask = AdCacheIndex(cache)->capacity - 1;
+    uint32_t i = (uint32_t)hash & mask;
+
+    while (slots[i].hash > kAdCacheSlotDeleted) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void AdCacheDropSlot(AdCache *cache, uint32_t slot)
+{
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    const AdCacheEntry *entry = AdCacheEntryAt(cache, slots[slot].offset);
+
+    if (entry) {
+        AdCacheLog(cache)->deadLength += entry->entryLength;
+    }
+    AdCacheHeapRemove(cache, slot);
+    slots[slot].hash = kAdCacheSlotDeleted;
+    AdCacheIndex(cache)->count--;
+    AdCacheIndex(cache)->deleted++;
+}
+
+/** Points the key of the entry at offset, which must be newer than whatever the index holds for that key. */
+static void AdCacheIndexEntry(AdCache *cache, const AdCacheEntry *entry, uint64_t offset)
+{
+    AdCacheIndexHeader *header = AdCacheIndex(cache);
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    int64_t existing = AdCacheFindSlot(cache, entry->hash, entry->formatId, AdCacheEntryPageId(entry), AdCacheEntryTarget(entry));
+
+    if (entry->recordOffset == 0) {
+        // A removal marker is dead as soon as it has been applied.
+        if (existing >= 0) {
+            AdCacheDropSlot(cache, (uint32_t)existing);
+        }
+        AdCacheLog(cache)->deadLength += entry->entryLength;
+    } else if (existing >= 0) {
+        const AdCacheEntry *previous = AdCacheEntryAt(cache, slots[existing].offset);
+        if (previous) {
+            AdCacheLog(cache)->deadLength += previous->entryLength;
+        }
+        slots[existing].offset = offset;
+        slots[existing].expirationDate = entry->expirationDate;
+        AdCacheHeapUp(cache, cache->heapPositions[existing]);
+        AdCacheHeapDown(cache, cache->heapPositions[existing]);
+    } else {
+        uint32_t slot = AdCacheFreeSlot(cache, entry->hash);
+        if (slots[slot].hash == kAdCacheSlotDeleted) {
+            header->deleted--;
+        }
+        slots[slot].hash = entry->hash;
+        slots[slot].offset = offset;
+        slots[slot].expirationDate = entry->expirationDate;
+        header->count++;
+        AdCacheHeapPush(cache, slot);
+    }
+}
+
+/** Appends an entry for the key, or a removal marker when record is NULL. Returns the offset of the entry or 0. */
+static uint64_t AdCacheAppendEntry(AdCache *cache, int64_t formatId, const char *pageId, const char *target,
+                                   const void *record, size_t length, double expirationDate)
+{
+    size_t pageIdLength = strlen(pageId);
+    size_t targetLength = strlen(target);
+    size_t keyLength = AdCacheAlign(sizeof(AdCacheEntry) + pageIdLength + targetLength + 2);
+    size_t entryLength = AdCacheAlign(keyLength + (record ? length : 0));
+    uint64_t offset;
+    AdCacheEntry *entry;
+    char *key;
+
+    if (entryLength > UINT32_MAX || AdCacheReserveLog(cache, entryLength) != 0) {
+        return 0;
+    }
+    offset = AdCacheLog(cache)->length;
+    entry = (AdCacheEntry *)(cache->log + offset);
+    memset(entry, 0, entryLength);
+    entry->magic = kAdCacheEntryMagic;
+    entry->entryLength = (uint32_t)entryLength;
+    entry->hash = AdCacheHashKey(formatId, pageId, target);
+    entry->formatId = formatId;
+    entry->expirationDate = expirationDate;
+    entry->pageIdLength = (uint32_t)pageIdLength;
+    entry->targetLength = (uint32_t)targetLength;
+    key = (char *)(entry + 1);
+    memcpy(key, pageId, pageIdLength + 1);
+    memcpy(key + pageIdLength + 1, target, targetLength + 1);
+    if (record) {
+        entry->recordOffset = (uint32_t)keyLength;
+        entry->recordLength = (uint32_t)length;
+        memcpy((char *)entry + keyLength, record, length);
+    }
+
+    // The entry is complete before the log length covers it, and the index only follows the log.
+    AdCacheLog(cache)->length = offset + entryLength;
+    return offset;
+}
+
+/** Drops a live entry and logs the removal, so that a rebuild of the index does not bring it back. */
+static void AdCacheRemoveSlot(AdCache *cache, uint32_t slot)
+{
+    const AdCacheEntry *entry = AdCacheEntryAt(cache, AdCacheSlots(cache)[slot].offset);
+    uint64_t offset = 0;
+
+    if (entry) {
+        size_t keyLength = entry->pageIdLength + entry->targetLength + 2;
+        char *key = malloc(keyLength);
+        if (key) {
+            // The append may remap the log, copy the key out first.
+            memcpy(key, AdCacheEntryPageId(entry), keyLength);
+            offset = AdCacheAppendEntry(cache, entry->formatId, key, key + entry->pageIdLength + 1, NULL, 0, 0);
+            free(key);
+        }
+    }
+    AdCacheDropSlot(cache, slot);
+    if (offset) {
+        AdCacheLog(cache)->deadLength += AdCacheEntryAt(cache, offset)->entryLength;
+        AdCacheIndex(cache)->indexedLength = AdCacheLog(cache)->length;
+    }
+}
+
+static int AdCacheResizeIndex(AdCache *cache, uint32_t capacity)
+{
+    uint32_t oldCapacity = AdCacheIndex(cache)->capacity;
+    uint64_t indexedLength = AdCacheIndex(cache)->indexedLength;
+    size_t length = (size_t)oldCapacity * sizeof(AdCacheSlot);
+    AdCacheSlot *live = malloc(length);
+
+    if (live == NULL) {
+        return -1;
+    }
+    memcpy(live, AdCacheSlots(cache), length);
+    if (AdCacheCreateIndex(cache, capacity) != 0) {
+        free(live);
+        return -1;
+    }
+    for (uint32_t i = 0; i < oldCapacity; i++) {
+        if (live[i].hash > kAdCacheSlotDeleted) {
+            uint32_t slot = AdCacheFreeSlot(cache, live[i].hash);
+            AdCacheSlots(cache)[slot] = live[i];
+            AdCacheIndex(cache)->count++;
+        }
+    }
+    AdCacheIndex(cache)->indexedLength = indexedLength;
+    free(live);
+    return AdCacheHeapRebuild(cache);
+}
+
+static int AdCacheReserveSlot(AdCache *cache)
+{
+    AdCacheIndexHeader *header = AdCacheIndex(cache);
+    uint32_t capacity = header->capacity;
+
+    if ((uint64_t)(header->count + header->deleted + 1) * 10 <= (uint64_t)capacity * 7) {
+        return 0;
+    }
+    // Only grow when live entries need it, otherwise rehashing drops the tombstones.
+    if ((uint64_t)(header->count + 1) * 10 > (uint64_t)capacity * 5) {
+        capacity *= 2;
+    }
+    return AdCacheResizeIndex(cache, capacity);
+}
+
+/** Indexes the log entries appended since the index was last updated, or the whole log when rebuilding. */
+static int AdCacheReplayLog(AdCache *cache, uint64_t from)
+{
+    uint64_t offset = from;
+    uint64_t length = AdCacheLog(cache)->length;
+
+    while (offset < length) {
+        const AdCacheEntry *entry = AdCacheEntryAt(cache, offset);
+        if (entry == NULL) {
+            // A torn append, the log ends with the last complete entry.
+            AdCacheLog(cache)->length = offset;
+            break;
+        }
+        if (AdCacheReserveSlot(cache) != 0) {
+            return -1;
+        }
+        AdCacheIndexEntry(cache, entry, offset);
+        offset += entry->entryLength;
+    }
+    AdCacheIndex(cache)->indexedLength = AdCacheLog(cache)->length;
+    return 0;
+}
+
+static int AdCacheOpenIndex(AdCache *cache)
+{
+    struct stat info;
+    AdCacheIndexHeader *header;
+    int fd = open(cache->indexPath, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size > sizeof(AdCacheIndexHeader) && AdCacheMapIndex(cache, fd, (size_t)info.st_size) == 0) {
+        header = AdCacheIndex(cache);
+        if (header->magic == kAdCacheIndexMagic && header->version == kAdCacheVersion
+            && header->capacity >= kAdCacheMinSlots && (header->capacity & (header->capacity - 1)) == 0
+            && sizeof(AdCacheIndexHeader) + (size_t)header->capacity * sizeof(AdCacheSlot) <= cache->indexLength
+            && header->generation == AdCacheLog(cache)->generation
+            && header->indexedLength >= sizeof(AdCacheLogHeader) && header->indexedLength <= AdCacheLog(cache)->length) {
+            if (AdCacheHeapRebuild(cache) != 0) {
+                return -1;
+            }
+            return AdCacheReplayLog(cache, header->indexedLength);
+        }
+    } else {
+        close(fd);
+    }
+
+    // Missing, damaged or stale: rebuild from a full scan of the log.
+    AdCacheLog(cache)->deadLength = 0;
+    if (AdCacheCreateIndex(cache, kAdCacheMinSlots) != 0 || AdCacheHeapRebuild(cache) != 0) {
+        return -1;
+    }
+    return AdCacheReplayLog(cache, sizeof(AdCacheLogHeader));
+}
+
+// Public API
+
+AdCache *AdCacheOpen(const char *directory, uint32_t maxEntries)
+{
+    AdCache *cache = calloc(1, sizeof(AdCache));
+
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->logFd = -1;
+    cache->indexFd = -1;
+    cache->maxEntries = maxEntries;
+    cache->logPath = AdCachePath(directory, "ads.log");
+    cache->indexPath = AdCachePath(directory, "ads.idx");
+    if (cache->logPath == NULL || cache->indexPath == NULL || AdCacheOpenLog(cache) != 0 || AdCacheOpenIndex(cache) != 0) {
+        int error = errno;
+        AdCacheClose(cache);
+        errno = error;
+        return NULL;
+    }
+    return cache;
+}
+
+void AdCacheClose(AdCache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    if (cache->log) {
+        // Give back the unused tail of the last chunk.
+        uint64_t length = AdCacheLog(cache)->length;
+        AdCacheUnmapLog(cache);
+        if (ftruncate(cache->logFd, (off_t)length) != 0) {
+            // The file keeps its reserved capacity, which is harmless.
+        }
+    }
+    if (cache->index) {
+        munmap(cache->index, cache->indexLength);
+    }
+    if (cache->logFd >= 0) {
+        close(cache->logFd);
+    }
+    if (cache->indexFd >= 0) {
+        close(cache->indexFd);
+    }
+    free(cache->heap);
+    free(cache->heapPositions);
+    free(cache->logPath);
+    free(cache->indexPath);
+    free(cache);
+}
+
+int AdCachePut(AdCache *cache, int64_t formatId, const char *pageId, const char *target,
+               const void *record, size_t length, double expirationDate)
+{
+    uint64_t offset;
+
+    if (record == NULL || AdCacheReserveSlot(cache) != 0) {
+        return -1;
+    }
+    offset = AdCacheAppendEntry(cache, formatId, pageId ? pageId : "", target ? target : "", record, length, expirationDate);
+    if (offset == 0) {
+        return -1;
+    }
+    AdCacheIndexEntry(cache, AdCacheEntryAt(cache, offset), offset);
+    AdCacheIndex(cache)->indexedLength = AdCacheLog(cache)->length;
+    cache->insertions++;
+
+    while (cache->maxEntries > 0 && AdCacheIndex(cache)->count > cache->maxEntries) {
+        AdCacheRemoveSlot(cache, cache->heap[0]);
+        cache->evictions++;
+    }
+    return 0;
+}
+
+/** A peek neither counts a hit or a miss nor drops the entry it finds expired or damaged. */
+static const AdRecordHeader *AdCacheLookup(AdCache *cache, int64_t formatId, const char *pageId, const char *target, double now, int peeking)
+{
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    const AdCacheEntry *entry;
+    const AdRecordHeader *record;
+    int64_t slot;
+
+    pageId = pageId ? pageId : "";
+    target = target ? target : "";
+    slot = AdCacheFindSlot(cache, AdCacheHashKey(formatId, pageId, target), formatId, pageId, target);
+    if (slot < 0) {
+        cache->misses += !peeking;
+        return NULL;
+    }
+    if (slots[slot].expirationDate > 0 && slots[slot].expirationDate <= now) {
+        if (!peeking) {
+            AdCacheDropSlot(cache, (uint32_t)slot);
+            cache->evictions++;
+            cache->misses++;
+        }
+        return NULL;
+    }
+    entry = AdCacheEntryAt(cache, slots[slot].offset);
+    record = entry ? AdRecordValidate((const char *)entry + entry->recordOffset, entry->recordLength) : NULL;
+    if (record == NULL) {
+        if (!peeking) {
+            AdCacheDropSlot(cache, (uint32_t)slot);
+            cache->misses++;
+        }
+        return NULL;
+    }
+    cache->hits += !peeking;
+    return record;
+}
+
+const AdRecordHeader *AdCacheGet(AdCache *cache, int64_t formatId, const char *pageId, const char *target, double now)
+{
+    return AdCacheLookup(cache, formatId, pageId, target, now, 0);
+}
+
+const AdRecordHeader *AdCachePeek(AdCache *cache, int64_t formatId, const char *pageId, const char *target, double now)
+{
+    return AdCacheLookup(cache, formatId, pageId, target, now, 1);
+}
+
+int AdCacheRemove(AdCache *cache, int64_t formatId, const char *pageId, const char *target)
+{
+    int64_t slot;
+
+    pageId = pageId ? pageId : "";
+    target = target ? target : "";
+    slot = AdCacheFindSlot(cache, AdCacheHashKey(formatId, pageId, target), formatId, pageId, target);
+    if (slot < 0) {
+        return -1;
+    }
+    AdCacheRemoveSlot(cache, (uint32_t)slot);
+    return 0;
+}
+
+uint32_t AdCacheEvictExpired(AdCache *cache, double now)
+{
+    uint32_t evicted = 0;
+
+    while (cache->heapCount > 0 && AdCacheHeapKey(cache, cache->heap[0]) <= now) {
+        AdCacheDropSlot(cache, cache->heap[0]);
+        evicted++;
+    }
+    cache->evictions += evicted;
+    return evicted;
+}
+
+double AdCacheNextExpiration(const AdCache *cache)
+{
+    if (cache->heapCount == 0) {
+        return 0;
+    }
+    return AdCacheSlots(cache)[cache->heap[0]].expirationDate;
+}
+
+int AdCacheCompact(AdCache *cache)
+{
+    AdCacheSlot *slots = AdCacheSlots(cache);
+    uint32_t capacity = AdCacheIndex(cache)->capacity;
+    uint64_t liveLength = AdCacheLog(cache)->length - AdCacheLog(cache)->deadLength;
+    size_t pathLength = strlen(cache->logPath) + 5;
+    char *temporaryPath = malloc(pathLength);
+    AdCacheLogHeader *header;
+    char *map;
+    uint64_t length = sizeof(AdCacheLogHeader);
+    size_t mapLength;
+    int fd;
+
+    if (temporaryPath == NULL) {
+        return -1;
+    }
+    snprintf(temporaryPath, pathLength, "%s.tmp", cache->logPath);
+    mapLength = liveLength > kAdCacheLogChunk ? (size_t)liveLength : kAdCacheLogChunk;
+    fd = open(temporaryPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)mapLength) != 0
+        || (map = mmap(NULL, mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(temporaryPath);
+        free(temporaryPath);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < capacity; i++) {
+        const AdCacheEntry *entry;
+        if (slots[i].hash <= kAdCacheSlotDeleted || (entry = AdCacheEntryAt(cache, slots[i].offset)) == NULL) {
+            continue;
+        }
+        if (length + entry->entryLength > mapLength) {
+            break;
+        }
+        memcpy(map + length, entry, entry->entryLength);
+        length += entry->entryLength;
+    }
+    header = (AdCacheLogHeader *)map;
+    header->magic = kAdCacheLogMagic;
+    header->version = kAdCacheVersion;
+    header->generation = AdCacheLog(cache)->generation + 1;
+    header->length = length;
+    msync(map, mapLength, MS_SYNC);
+    munmap(map, mapLength);
+
+    // Once renamed, the index is stale by generation and a crash before the rebuild below is recovered on open.
+    if (rename(temporaryPath, cache->logPath) != 0) {
+        close(fd);
+        unlink(temporaryPath);
+        free(temporaryPath);
+        return -1;
+    }
+    free(temporaryPath);
+    AdCacheUnmapLog(cache);
+    close(cache->logFd);
+    cache->logFd = fd;
+    if (AdCacheMapLog(cache, mapLength) != 0 || AdCacheCreateIndex(cache, capacity) != 0 || AdCacheHeapRebuild(cache) != 0) {
+        return -1;
+    }
+    return AdCacheReplayLog(cache, sizeof(AdCacheLogHeader));
+}
+
+int AdCacheSync(AdCache *cache)
+{
+    if (msync(cache->log, (size_t)AdCacheLog(cache)->length, MS_SYNC) != 0) {
+        return -1;
+    }
+    return msync(cache->index, cache->indexLength, MS_SYNC);
+}
+
+AdCacheStatistics AdCacheGetStatistics(const AdCache *cache)
+{
+    AdCacheStatistics statistics;
+
+    statistics.hits = cache->hits;
+    statistics.misses = cache->misses;
+    statistics.insertions = cache->insertions;
+    statistics.evictions = cache->evictions;
+    statistics.count = AdCacheIndex(cache)->count;
+    statistics.logLength = AdCacheLog(cache)->length;
+    statistics.deadLength = AdCacheLog(cache)->deadLength;
+    return statistics;
+}
+
+void AdCacheResetCounters(AdCache *cache)
+{
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->insertions = 0;
+    cache->evictions = 0;
+}
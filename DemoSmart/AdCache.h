@@ -0,0 +1,83 @@
+//
+//  AdCache.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Offline ad store built on AdRecord.
+
+ The store is two files in one directory:
+
+ - ads.log, an append-only log of AdRecord entries, mmap'd so that records are read in place;
+ - ads.idx, an mmap'd open addressing table keyed by the hash of (formatId, pageId, target),
+   pointing into the log and carrying the expiration date of every live entry.
+
+ Opening a store maps both files and only replays log entries appended after the last index
+ update, so cold-start lookups never parse the whole log. A min-heap on the expiration dates is
+ rebuilt from the index and gives O(log n) eviction of the soonest expiring entry.
+
+ This file is plain C. An AdCache is not thread safe, callers serialize access.
+ */
+
+#ifndef DemoSmart_AdCache_h
+#define DemoSmart_AdCache_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AdRecord.h"
+
+typedef struct AdCache AdCache;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;     /* expired entries and entries dropped to honour the entry limit */
+    uint32_t count;         /* live entries */
+    uint64_t logLength;     /* bytes used in ads.log, live and dead */
+    uint64_t deadLength;    /* bytes held by replaced or evicted entries, reclaimed by AdCacheCompact */
+} AdCacheStatistics;
+
+/** Opens or creates the store in an existing directory. Returns NULL and sets errno on failure.
+
+ @param maxEntries The number of live entries above which the soonest expiring entries are evicted, 0 for no limit.
+ */
+AdCache *AdCacheOpen(const char *directory, uint32_t maxEntries);
+void AdCacheClose(AdCache *cache);
+
+/** Appends a record for the key, replacing any previous entry. Returns 0 on success. */
+int AdCachePut(AdCache *cache, int64_t formatId, const char *pageId, const char *target,
+               const void *record, size_t length, double expirationDate);
+
+/** Returns the record stored for the key, read in place from the log.
+
+ The pointer stays valid until the next call that modifies the cache. An entry that expired
+ before now is evicted and counted as a miss.
+ */
+const AdRecordHeader *AdCacheGet(AdCache *cache, int64_t formatId, const char *pageId, const char *target, double now);
+
+/** Like AdCacheGet, for the bookkeeping lookups of the app: counts neither a hit nor a miss, and leaves expired entries in place. */
+const AdRecordHeader *AdCachePeek(AdCache *cache, int64_t formatId, const char *pageId, const char *target, double now);
+
+int AdCacheRemove(AdCache *cache, int64_t formatId, const char *pageId, const char *target);
+
+/** Evicts every entry that expired before now. Returns the number of evicted entries. */
+uint32_t AdCacheEvictExpired(AdCache *cache, double now);
+
+/** The expiration date of the soonest expiring entry, or 0 if the cache is empty. */
+double AdCacheNextExpiration(const AdCache *cache);
+
+/** Rewrites the log without its dead entries. Returns 0 on success. */
+int AdCacheCompact(AdCache *cache);
+
+/** Flushes both maps to disk. */
+int AdCacheSync(AdCache *cache);
+
+AdCacheStatistics AdCacheGetStatistics(const AdCache *cache);
+void AdCacheResetCounters(AdCache *cache);
+
+#endif
@@ -0,0 +1,332 @@
+//
+//  AdCallURL.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdCallURL.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Room for every number and parameter name of a call, on top of the prefix, page id and target. */
+#define kAdCallURLFixedLength   192
+
+typedef struct {
+    char *string;
+    char *escaped;
+    size_t escapedLength;
+    uint32_t hash;
+} AdCallURLTarget;
+
+struct AdCallURLBuilder {
+    char *baseURL;
+    int64_t siteId;
+    char *prefix;
+    size_t prefixLength;
+
+    AdCallURLTarget *targets;   /* targets[handle - 1] */
+    uint32_t targetCount;
+    uint32_t targetCapacity;
+    uint32_t *table;            /* open addressing, handles, 0 for empty slots */
+    uint32_t tableMask;
+
+    char *buffer;
+    size_t bufferCapacity;
+};
+
+// Formatting
+
+static char *AdCallURLAppend(char *cursor, const char *bytes, size_t length)
+{
+    memcpy(cursor, bytes, length);
+    return cursor + length;
+}
+
+#define AdCallURLAppendLiteral(cursor, literal) AdCallURLAppend(cursor, literal, sizeof(literal) - 1)
+
+static char *AdCallURLAppendUnsigned(char *cursor, uint64_t value)
+{
+    char digits[20];
+    int count = 0;
+
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        *cursor++ = digits[--count];
+    }
+    return cursor;
+}
+
+static char *AdCallURLAppendSigned(char *cursor, int64_t value)
+{
+    if (value < 0) {
+        *cursor++ = '-';
+        return AdCallURLAppendUnsigned(cursor, 0 - (uint64_t)value);
+    }
+    return AdCallURLAppendUnsigned(cursor, (uint64_t)value);
+}
+
+/** Appends a value with a fixed number of decimals, as %.<decimals>f would for values of a reasonable magnitude. */
+static char *AdCallURLAppendFixed(char *cursor, double value, unsigned decimals)
+{
+    static const uint64_t scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+    uint64_t scale = scales[decimals], scaled, fraction;
+
+    if (value < 0) {
+        *cursor++ = '-';
+        value = -value;
+    }
+    scaled = (uint64_t)(value * scale + 0.5);
+    cursor = AdCallURLAppendUnsigned(cursor, scaled / scale);
+    if (decimals > 0) {
+        *cursor++ = '.';
+        fraction = scaled % scale;
+        for (uint64_t digit = scale / 10; digit > 0; digit /= 10) {
+            *cursor++ = (char)('0' + fraction / digit % 10);
+        }
+    }
+    return cursor;
+}
+
+static int AdCallURLIsUnreserved(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+size_t AdCallURLEscape(char *output, const char *string, size_t length)
+{
+    static const char hexadecimal[] = "0123456789ABCDEF";
+    char *cursor = output;
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)string[i];
+        if (AdCallURLIsUnreserved(c)) {
+            *cursor++ = (char)c;
+        } else {
+            *cursor++ = '%';
+            *cursor++ = hexadecimal[c >> 4];
+            *cursor++ = hexadecimal[c & 15];
+        }
+    }
+    *cursor = '\0';
+    return (size_t)(cursor - output);
+}
+
+// Builder
+
+static int AdCallURLBuilderReserve(AdCallURLBuilder *builder, size_t capacity)
+{
+    char *buffer;
+
+    if (capacity <= builder->bufferCapacity) {
+        return 0;
+    }
+    buffer = realloc(builder->buffer, capacity);
+    if (buffer == NULL) {
+        return -1;
+    }
+    builder->buffer = buffer;
+    builder->bufferCapacity = capacity;
+    return 0;
+}
+
+static int AdCallURLBuilderFormatPrefix(AdCallURLBuilder *builder, const char *hashedIdentifier)
+{
+    size_t identifierLength = hashedIdentifier ? strlen(hashedIdentifier) : 0;
+    size_t capacity = strlen(builder->baseURL) + 64 + 3 * identifierLength;
+    char *prefix = malloc(capacity), *cursor;
+
+    if (prefix == NULL) {
+        return -1;
+    }
+    cursor = AdCallURLAppend(prefix, builder->baseURL, strlen(builder->baseURL));
+    cursor = AdCallURLAppendLiteral(cursor, "/ac?siteid=");
+    cursor = AdCallURLAppendSigned(cursor, builder->siteId);
+    if (identifierLength > 0) {
+        cursor = AdCallURLAppendLiteral(cursor, "&uid=");
+        cursor += AdCallURLEscape(cursor, hashedIdentifier, identifierLength);
+    }
+    *cursor = '\0';
+
+    free(builder->prefix);
+    builder->prefix = prefix;
+    builder->prefixLength = (size_t)(cursor - prefix);
+    return 0;
+}
+
+AdCallURLBuilder *AdCallURLBuilderCreate(const char *baseURL, int64_t siteId)
+{
+    AdCallURLBuilder *builder = calloc(1, sizeof(AdCallURLBuilder));
+
+    if (builder == NULL) {
+        return NULL;
+    }
+    builder->baseURL = strdup(baseURL ? baseURL : "");
+    builder->siteId = siteId;
+    builder->table = calloc(16, sizeof(uint32_t));
+    builder->tableMask = 15;
+    if (builder->baseURL == NULL || builder->table == NULL || AdCallURLBuilderFormatPrefix(builder, NULL) != 0) {
+        AdCallURLBuilderRelease(builder);
+        return NULL;
+    }
+    return builder;
+}
+
+void AdCallURLBuilderRelease(AdCallURLBuilder *builder)
+{
+    if (builder == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < builder->targetCount; i++) {
+        free(builder->targets[i].string);
+        free(builder->targets[i].escaped);
+    }
+    free(builder->targets);
+    free(builder->table);
+    free(builder->buffer);
+    free(builder->prefix);
+    free(builder->baseURL);
+    free(builder);
+}
+
+int AdCallURLBuilderSetIdentifier(AdCallURLBuilder *builder, const char *hashedIdentifier)
+{
+    return AdCallURLBuilderFormatPrefix(builder, hashedIdentifier);
+}
+
+// Targets
+
+static uint32_t AdCallURLHash(const char *string)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*string) {
+        hash = (hash ^ (unsigned char)*string++) * 16777619u;
+    }
+    return hash;
+}
+
+static int AdCallURLBuilderGrowTable(AdCallURLBuilder *builder)
+{
+    uint32_t mask = builder->tableMask * 2 + 1;
+    uint32_t *table = calloc((size_t)mask + 1, sizeof(uint32_t));
+
+    if (table == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < builder->targetCount; i++) {
+        uint32_t slot = builder->targets[i].hash & mask;
+        while (table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = i + 1;
+    }
+    free(builder->table);
+    builder->table = table;
+    builder->tableMask = mask;
+    return 0;
+}
+
+AdCallTarget AdCallURLBuilderInternTarget(AdCallURLBuilder *builder, const char *target)
+{
+    AdCallURLTarget *entry;
+    uint32_t hash, slot;
+    size_t length;
+
+    if (target == NULL || target[0] == '\0') {
+        return kAdCallTargetNone;
+    }
+    hash = AdCallURLHash(target);
+    for (slot = hash & builder->tableMask; builder->table[slot] != 0; slot = (slot + 1) & builder->tableMask) {
+        entry = &builder->targets[builder->table[slot] - 1];
+        if (entry->hash == hash && strcmp(entry->string, target) == 0) {
+            return builder->table[slot];
+        }
+    }
+
+    // Keeps the table at most half full.
+    if ((builder->targetCount + 1) * 2 > builder->tableMask + 1 && AdCallURLBuilderGrowTable(builder) != 0) {
+        return kAdCallTargetNone;
+    }
+    if (builder->targetCount == builder->targetCapacity) {
+        uint32_t capacity = builder->targetCapacity ? builder->targetCapacity * 2 : 8;
+        AdCallURLTarget *targets = realloc(builder->targets, capacity * sizeof(AdCallURLTarget));
+        if (targets == NULL) {
+            return kAdCallTargetNone;
+        }
+        builder->targets = targets;
+        builder->targetCapacity = capacity;
+    }
+    length = strlen(target);
+    entry = &builder->targets[builder->targetCount];
+    entry->string = strdup(target);
+    entry->escaped = malloc(3 * length + 1);
+    if (entry->string == NULL || entry->escaped == NULL) {
+        free(entry->string);
+        free(entry->escaped);
+        return kAdCallTargetNone;
+    }
+    entry->escapedLength = AdCallURLEscape(entry->escaped, target, length);
+    entry->hash = hash;
+    builder->targetCount++;
+
+    slot = hash & builder->tableMask;
+    while (builder->table[slot] != 0) {
+        slot = (slot + 1) & builder->tableMask;
+    }
+    builder->table[slot] = builder->targetCount;
+    return builder->targetCount;
+}
+
+// Calls
+
+const char *AdCallURLBuild(AdCallURLBuilder *builder, const AdCallParameters *parameters, size_t *length)
+{
+    const char *pageId = parameters->pageId ? parameters->pageId : "";
+    size_t pageIdLength = strlen(pageId);
+    const AdCallURLTarget *target = NULL;
+    char *cursor;
+
+    if (parameters->target != kAdCallTargetNone && parameters->target <= builder->targetCount) {
+        target = &builder->targets[parameters->target - 1];
+    }
+    if (AdCallURLBuilderReserve(builder, builder->prefixLength + 3 * pageIdLength + (target ? target->escapedLength : 0) + kAdCallURLFixedLength) != 0) {
+        return NULL;
+    }
+
+    cursor = AdCallURLAppend(builder->buffer, builder->prefix, builder->prefixLength);
+    cursor = AdCallURLAppendLiteral(cursor, "&pgid=");
+    cursor += AdCallURLEscape(cursor, pageId, pageIdLength);
+    cursor = AdCallURLAppendLiteral(cursor, "&fmtid=");
+    cursor = AdCallURLAppendSigned(cursor, parameters->formatId);
+    cursor = parameters->master ? AdCallURLAppendLiteral(cursor, "&visit=M") : AdCallURLAppendLiteral(cursor, "&visit=S");
+    cursor = AdCallURLAppendLiteral(cursor, "&tmstp=");
+    cursor = AdCallURLAppendUnsigned(cursor, parameters->timestamp);
+    if (target) {
+        cursor = AdCallURLAppendLiteral(cursor, "&tgt=");
+        cursor = AdCallURLAppend(cursor, target->escaped, target->escapedLength);
+    }
+    // Coordinates beyond their range would not fit the fixed room of the buffer, and are not sent.
+    if (parameters->hasLocation && fabs(parameters->latitude) <= 90 && fabs(parameters->longitude) <= 180) {
+        cursor = AdCallURLAppendLiteral(cursor, "&lat=");
+        cursor = AdCallURLAppendFixed(cursor, parameters->latitude, 6);
+        cursor = AdCallURLAppendLiteral(cursor, "&long=");
+        cursor = AdCallURLAppendFixed(cursor, parameters->longitude, 6);
+    }
+    if (parameters->heading >= 0 && parameters->heading <= 360) {
+        cursor = AdCallURLAppendLiteral(cursor, "&hdg=");
+        cursor = AdCallURLAppendFixed(cursor, parameters->heading, 1);
+    }
+    *cursor = '\0';
+
+    if (length) {
+        *length = (size_t)(cursor - builder->buffer);
+    }
+    return builder->buffer;
+}
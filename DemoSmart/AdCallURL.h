@@ -0,0 +1,71 @@
+//
+//  AdCallURL.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Builds the ad call URLs of loadFormatId:pageId:master:target: from a precompiled template.
+
+    <baseURL>/ac?siteid=<siteId>[&uid=<hashed identifier>]&pgid=<pageId>&fmtid=<formatId>&visit=<M|S>
+        &tmstp=<timestamp>[&tgt=<target>][&lat=<latitude>&long=<longitude>][&hdg=<heading>]
+
+ The part that only depends on the site (base URL, site id and hashed identifier) is formatted
+ once, when the builder is created or the identifier changes. Targets are percent escaped once
+ and interned: AdCallURLBuilderInternTarget returns a small handle that later calls pass instead
+ of the string. A call then only copies the prefix and appends the dynamic parts, with integer
+ formatting, into a buffer that the builder reuses, without allocating.
+
+ This file is plain C. A builder is not thread safe, callers serialize access or use a builder
+ per thread.
+ */
+
+#ifndef DemoSmart_AdCallURL_h
+#define DemoSmart_AdCallURL_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdCallTargetNone   0
+
+/** A target interned by AdCallURLBuilderInternTarget, kAdCallTargetNone for no target. */
+typedef uint32_t AdCallTarget;
+
+typedef struct {
+    int64_t formatId;
+    const char *pageId;
+    int master;                 /* the first call of a page, the others are slaves */
+    AdCallTarget target;
+    uint64_t timestamp;         /* also a cache buster, the same for the master and slaves of a page */
+    int hasLocation;
+    double latitude;
+    double longitude;
+    double heading;             /* degrees, negative when unknown */
+} AdCallParameters;
+
+typedef struct AdCallURLBuilder AdCallURLBuilder;
+
+/** Returns NULL when out of memory. The base URL has no ending slash, as for setSiteID:baseURL:. */
+AdCallURLBuilder *AdCallURLBuilderCreate(const char *baseURL, int64_t siteId);
+void AdCallURLBuilderRelease(AdCallURLBuilder *builder);
+
+/** Sets the hashed identifier sent with every call, NULL when identifier hashing is disabled. Returns 0 on success. */
+int AdCallURLBuilderSetIdentifier(AdCallURLBuilder *builder, const char *hashedIdentifier);
+
+/** Escapes and interns a target, or finds it if it was interned before. Returns kAdCallTargetNone
+ for NULL or empty targets and when out of memory. Handles stay valid until the builder is released. */
+AdCallTarget AdCallURLBuilderInternTarget(AdCallURLBuilder *builder, const char *target);
+
+/** Returns the URL, NUL terminated, valid until the next call with the builder. NULL when out of memory.
+
+ @param length Set to the length of the URL, may be NULL.
+ */
+const char *AdCallURLBuild(AdCallURLBuilder *builder, const AdCallParameters *parameters, size_t *length);
+
+/** Percent escapes everything but the unreserved characters of RFC 3986. Returns the length of the
+ escaped string, output needs 3 * length + 1 bytes. */
+size_t AdCallURLEscape(char *output, const char *string, size_t length);
+
+#endif
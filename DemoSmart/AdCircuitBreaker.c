@@ -0,0 +1,333 @@
+//
+//  AdCircuitBreaker.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdCircuitBreaker.h"
+#include "AdPlacementHash.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kAdCircuitInitialCapacity   16      /* placements, a power of two */
+
+/** Counts for the placement and in the totals. */
+#define AdCircuitCount(breaker, placement, counter) ((placement)->statistics.counter++, (breaker)->statistics.counter++)
+
+const AdCircuitBreakerConfiguration AdCircuitBreakerDefaultConfiguration = { 3, 10, 600, 60, 30, 0.5 };
+
+typedef struct {
+    uint64_t hash;                  /* 0 for an empty slot */
+    int64_t formatId;
+    char *key;                      /* pageId, 0x1f, target */
+    AdCircuitState state;           /* as last set, see AdCircuitEffectiveState */
+    double until;                   /* the end of the no-fill or of the backoff */
+    double probeDate;               /* of the probe in flight, 0 when there is none */
+    uint32_t consecutiveFailures;
+    uint32_t failedProbes;          /* since the breaker last closed, doubles the backoff */
+    AdCircuitStatistics statistics;
+} AdCircuitPlacement;
+
+struct AdCircuitBreaker {
+    AdCircuitBreakerConfiguration configuration;
+    AdCircuitPlacement *placements;
+    size_t capacity;
+    size_t count;
+    uint64_t random;
+    AdCircuitStatistics statistics;
+};
+
+// Placements
+
+static uint64_t AdCircuitHash(int64_t formatId, const char *pageId, const char *target)
+{
+    uint64_t hash = AdPlacementHash(formatId, pageId, target);
+
+    // 0 marks an empty slot.
+    return hash == 0 ? 1 : hash;
+}
+
+static int AdCircuitMatches(const AdCircuitPlacement *placement, int64_t formatId, const char *pageId, const char *target)
+{
+    size_t pageLength = strlen(pageId);
+
+    return placement->formatId == formatId && strncmp(placement->key, pageId, pageLength) == 0
+        && placement->key[pageLength] == 0x1f && strcmp(placement->key + pageLength + 1, target) == 0;
+}
+
+static AdCircuitPlacement *AdCircuitFind(const AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target)
+{
+    uint64_t hash = AdCircuitHash(formatId, pageId, target);
+    size_t mask = breaker->capacity - 1;
+
+    for (size_t i = (size_t)hash & mask; breaker->placements[i].hash != 0; i = (i + 1) & mask) {
+        if (breaker->placements[i].hash == hash && AdCircuitMatches(&breaker->placements[i], formatId, pageId, target)) {
+            return &breaker->placements[i];
+        }
+    }
+    return NULL;
+}
+
+static int AdCircuitGrow(AdCircuitBreaker *breaker)
+{
+    size_t capacity = breaker->capacity * 2, mask = capacity - 1;
+    AdCircuitPlacement *placements = calloc(capacity, sizeof(AdCircuitPlacement));
+
+    if (placements == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < breaker->capacity; i++) {
+        if (breaker->placements[i].hash != 0) {
+            size_t slot = (size_t)breaker->placements[i].hash & mask;
+
+            while (placements[slot].hash != 0) {
+                slot = (slot + 1) & mask;
+            }
+            placements[slot] = breaker->placements[i];
+        }
+    }
+    free(breaker->placements);
+    breaker->placements = placements;
+    breaker->capacity = capacity;
+    return 0;
+}
+
+/** The placement of the key, added Closed when it is new. Returns NULL with errno set to ENOMEM. */
+static AdCircuitPlacement *AdCircuitFindOrAdd(AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target)
+{
+    AdCircuitPlacement *placement = AdCircuitFind(breaker, formatId, pageId, target);
+    size_t pageLength = strlen(pageId), targetLength = strlen(target), mask, slot;
+    uint64_t hash;
+    char *key;
+
+    if (placement) {
+        return placement;
+    }
+    // At most three quarters full, so that the probes stay short.
+    if ((breaker->count + 1) * 4 > breaker->capacity * 3 && AdCircuitGrow(breaker) != 0) {
+        return NULL;
+    }
+    key = malloc(pageLength + targetLength + 2);
+    if (key == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(key, pageId, pageLength);
+    key[pageLength] = 0x1f;
+    memcpy(key + pageLength + 1, target, targetLength + 1);
+    hash = AdCircuitHash(formatId, pageId, target);
+    mask = breaker->capacity - 1;
+    for (slot = (size_t)hash & mask; breaker->placements[slot].hash != 0; slot = (slot + 1) & mask) {
+    }
+    placement = &breaker->placements[slot];
+    memset(placement, 0, sizeof(*placement));
+    placement->hash = hash;
+    placement->formatId = formatId;
+    placement->key = key;
+    placement->state = AdCircuitClosed;
+    breaker->count++;
+    return placement;
+}
+
+// States
+
+/** The interval shortened by a random share of up to the jitter. */
+static double AdCircuitJitter(AdCircuitBreaker *breaker, double interval)
+{
+    uint64_t x = breaker->random;
+
+    // xorshift64*
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    breaker->random = x;
+    return interval * (1 - breaker->configuration.jitter * (double)((x * 2685821657736338717ULL) >> 11) / 9007199254740992.0);
+}
+
+/** The state at now: the no-fills and backoffs that ended, the probes given up. Sets the date from which a call may go. */
+static AdCircuitState AdCircuitEffectiveState(const AdCircuitBreaker *breaker, const AdCircuitPlacement *placement, double now, double *retryDate)
+{
+    *retryDate = now;
+    switch (placement->state) {
+        case AdCircuitNoFill:
+        case AdCircuitOpen:
+            if (now < placement->until) {
+                *retryDate = placement->until;
+                return placement->state;
+            }
+            return placement->state == AdCircuitNoFill ? AdCircuitClosed : AdCircuitHalfOpen;
+        case AdCircuitHalfOpen:
+            if (placement->probeDate > 0 && now < placement->probeDate + breaker->configuration.probeTimeout) {
+                *retryDate = placement->probeDate + breaker->configuration.probeTimeout;
+            }
+            return AdCircuitHalfOpen;
+        default:
+            return AdCircuitClosed;
+    }
+}
+
+// Breaker
+
+AdCircuitBreaker *AdCircuitBreakerCreate(const AdCircuitBreakerConfiguration *configuration, uint64_t seed)
+{
+    AdCircuitBreaker *breaker;
+
+    if (configuration == NULL) {
+        configuration = &AdCircuitBreakerDefaultConfiguration;
+    }
+    if (configuration->failureThreshold == 0
+        || !(configuration->openInterval >= 0 && configuration->openInterval <= configuration->maximumOpenInterval)
+        || !isfinite(configuration->maximumOpenInterval)
+        || !(configuration->noFillInterval >= 0 && isfinite(configuration->noFillInterval))
+        || !(configuration->probeTimeout > 0 && isfinite(configuration->probeTimeout))
+        || !(configuration->jitter >= 0 && configuration->jitter <= 1)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    breaker = calloc(1, sizeof(AdCircuitBreaker));
+    if (breaker == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    breaker->placements = calloc(kAdCircuitInitialCapacity, sizeof(AdCircuitPlacement));
+    if (breaker->placements == NULL) {
+        free(breaker);
+        errno = ENOMEM;
+        return NULL;
+    }
+    breaker->configuration = *configuration;
+    breaker->capacity = kAdCircuitInitialCapacity;
+    breaker->random = seed ? seed : 0x9e3779b97f4a7c15ULL;     // xorshift never leaves 0
+    return breaker;
+}
+
+void AdCircuitBreakerRelease(AdCircuitBreaker *breaker)
+{
+    if (breaker == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < breaker->capacity; i++) {
+        free(breaker->placements[i].key);
+    }
+    free(breaker->placements);
+    free(breaker);
+}
+
+AdCircuitState AdCircuitBreakerGetState(const AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target,
+                                        double now, double *retryDate)
+{
+    const AdCircuitPlacement *placement = AdCircuitFind(breaker, formatId, pageId ? pageId : "", target ? target : "");
+    double date = now;
+    AdCircuitState state = placement ? AdCircuitEffectiveState(breaker, placement, now, &date) : AdCircuitClosed;
+
+    if (retryDate) {
+        *retryDate = date;
+    }
+    return state;
+}
+
+int AdCircuitBreakerAllow(AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target, double now)
+{
+    AdCircuitPlacement *placement = AdCircuitFindOrAdd(breaker, formatId, pageId ? pageId : "", target ? target : "");
+    AdCircuitState state;
+    double retryDate;
+
+    if (placement == NULL) {
+        return -1;
+    }
+    state = AdCircuitEffectiveState(breaker, placement, now, &retryDate);
+    if (retryDate > now) {
+        AdCircuitCount(breaker, placement, shortCircuits);
+        return 0;
+    }
+    if (state == AdCircuitHalfOpen) {
+        placement->probeDate = now;
+    }
+    placement->state = state;
+    AdCircuitCount(breaker, placement, calls);
+    return 1;
+}
+
+int AdCircuitBreakerReport(AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target,
+                           AdCallOutcome outcome, double now)
+{
+    AdCircuitPlacement *placement = AdCircuitFindOrAdd(breaker, formatId, pageId ? pageId : "", target ? target : "");
+    const AdCircuitBreakerConfiguration *configuration = &breaker->configuration;
+
+    if (placement == NULL) {
+        return -1;
+    }
+    switch (outcome) {
+        case AdCallFilled:
+            AdCircuitCount(breaker, placement, fills);
+            placement->state = AdCircuitClosed;
+            placement->consecutiveFailures = placement->failedProbes = 0;
+            break;
+        case AdCallNoFill:
+            // The server answered: whatever failed before is over, the placement has nothing to show for a while.
+            AdCircuitCount(breaker, placement, noFills);
+            placement->state = AdCircuitNoFill;
+            placement->until = now + AdCircuitJitter(breaker, configuration->noFillInterval);
+            placement->consecutiveFailures = placement->failedProbes = 0;
+            break;
+        default:
+            AdCircuitCount(breaker, placement, failures);
+            placement->consecutiveFailures++;
+            if (placement->state == AdCircuitHalfOpen) {
+                placement->failedProbes++;
+            } else if (placement->state == AdCircuitOpen || placement->consecutiveFailures < configuration->failureThreshold) {
+                break;      // already open, by a call that went before; or not enough failures yet
+            }
+            AdCircuitCount(breaker, placement, opens);
+            placement->state = AdCircuitOpen;
+            placement->until = now + AdCircuitJitter(breaker, fmin(configuration->openInterval * ldexp(1, (int)(placement->failedProbes < 30 ? placement->failedProbes : 30)),
+                                                                   configuration->maximumOpenInterval));
+            break;
+    }
+    placement->probeDate = 0;
+    return 0;
+}
+
+AdCircuitStatistics AdCircuitBreakerGetStatistics(const AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target)
+{
+    const AdCircuitPlacement *placement;
+    AdCircuitStatistics none;
+
+    if (pageId == NULL) {
+        return breaker->statistics;
+    }
+    placement = AdCircuitFind(breaker, formatId, pageId, target ? target : "");
+    if (placement) {
+        return placement->statistics;
+    }
+    memset(&none, 0, sizeof(none));
+    return none;
+}
+
+void AdCircuitBreakerReset(AdCircuitBreaker *breaker)
+{
+    for (size_t i = 0; i < breaker->capacity; i++) {
+        AdCircuitPlacement *placement = &breaker->placements[i];
+
+        placement->state = AdCircuitClosed;
+        placement->until = placement->probeDate = 0;
+        placement->consecutiveFailures = placement->failedProbes = 0;
+    }
+}
+
+const char *AdCircuitStateName(AdCircuitState state)
+{
+    switch (state) {
+        case AdCircuitClosed: return "closed";
+        case AdCircuitNoFill: return "no fill";
+        case AdCircuitOpen: return "open";
+        case AdCircuitHalfOpen: return "half open";
+        default: return "?";
+    }
+}
@@ -0,0 +1,112 @@
+//
+//  AdCircuitBreaker.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Skips the ad calls of placements that will not fill or keep failing, instead of retrying them at every screen.
+
+ A placement is a (formatId, pageId, target) key, as in AdCache. Its state is known before the
+ call is made, so a doomed call is skipped entirely, with its radio wake-up:
+
+    state       entered when                    calls
+    Closed      a call filled                   go
+    NoFill      a call did not fill             skipped until the no-fill expires
+    Open        failureThreshold calls failed   skipped until the backoff elapses
+    HalfOpen    the backoff elapsed             one probe goes, the others are skipped
+
+ A no-fill is a negative result cached for noFillInterval: the server answered, it has nothing to
+ show for the placement now. Failures (timeouts, no network) open the breaker for openInterval,
+ doubled at each failed probe up to maximumOpenInterval. The probe that fills or does not fill
+ closes it; a probe that never reports is given up after probeTimeout. Each interval is shortened
+ by a random share of up to jitter, so that the placements failing together, on a network outage,
+ are not all probed at once.
+
+ The counters give the fill rate of each placement and the calls the breaker saved.
+
+ This file is plain C. A breaker is not thread safe, callers serialize access. The dates are in
+ seconds, on any clock that does not go back.
+ */
+
+#ifndef DemoSmart_AdCircuitBreaker_h
+#define DemoSmart_AdCircuitBreaker_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t failureThreshold;      /* consecutive failures that open the breaker */
+    double openInterval;            /* seconds */
+    double maximumOpenInterval;
+    double noFillInterval;
+    double probeTimeout;
+    double jitter;                  /* from 0, the intervals as given, to 1 */
+} AdCircuitBreakerConfiguration;
+
+/** 3 failures, open for 10 s to 10 minutes, no-fills cached for 60 s, probes given up after 30 s, jitter of 0.5. */
+extern const AdCircuitBreakerConfiguration AdCircuitBreakerDefaultConfiguration;
+
+typedef enum {
+    AdCircuitClosed,
+    AdCircuitNoFill,
+    AdCircuitOpen,
+    AdCircuitHalfOpen
+} AdCircuitState;
+
+typedef enum {
+    AdCallFilled,
+    AdCallNoFill,
+    AdCallFailed
+} AdCallOutcome;
+
+typedef struct {
+    uint64_t calls;                 /* let through */
+    uint64_t fills;
+    uint64_t noFills;
+    uint64_t failures;
+    uint64_t shortCircuits;         /* skipped */
+    uint64_t opens;
+} AdCircuitStatistics;
+
+typedef struct AdCircuitBreaker AdCircuitBreaker;
+
+/** Returns NULL with errno set to EINVAL for a bad configuration, ENOMEM when out of memory. NULL uses the default configuration.
+
+ @param seed Of the jitter, the same seed draws the same intervals.
+ */
+AdCircuitBreaker *AdCircuitBreakerCreate(const AdCircuitBreakerConfiguration *configuration, uint64_t seed);
+
+void AdCircuitBreakerRelease(AdCircuitBreaker *breaker);
+
+/** The state of the placement at now, without changing it: a no-fill that expired reads Closed, an elapsed backoff HalfOpen.
+
+ retryDate, when not NULL, is set to the date from which a call may go: now when it may go at once.
+ A target may be NULL, as "".
+ */
+AdCircuitState AdCircuitBreakerGetState(const AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target,
+                                        double now, double *retryDate);
+
+/** Whether to make the call, counted either way.
+
+ Returns 1 when the call may go, and its outcome is then to be reported; in HalfOpen, that call is
+ the probe. Returns 0 when it is to be skipped, -1 with errno set to ENOMEM when the placement cannot
+ be tracked, in which case the call goes.
+ */
+int AdCircuitBreakerAllow(AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target, double now);
+
+/** Reports the outcome of a call let through. Returns 0, or -1 with errno set to ENOMEM. */
+int AdCircuitBreakerReport(AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target,
+                           AdCallOutcome outcome, double now);
+
+/** The counters of the placement, or of every placement when pageId is NULL. */
+AdCircuitStatistics AdCircuitBreakerGetStatistics(const AdCircuitBreaker *breaker, int64_t formatId, const char *pageId, const char *target);
+
+/** Closes every placement and forgets the failures and no-fills, but not the counters: when the network comes back, say. */
+void AdCircuitBreakerReset(AdCircuitBreaker *breaker);
+
+const char *AdCircuitStateName(AdCircuitState state);
+
+#endif
@@ -0,0 +1,366 @@
+//
+//  AdConnectionPool.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdConnectionPool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+const AdConnectionPoolConfiguration AdConnectionPoolDefaultConfiguration = { 2, 8, 30 };
+
+typedef struct {
+    int fd;
+    uint16_t port;
+    double since;                   /* given back at */
+    char host[kAdConnectionHostLength];
+} AdConnectionIdle;
+
+struct AdConnectionPool {
+    AdConnectionPoolConfiguration configuration;
+    AdConnectionIdle *idle;         /* maxIdle, the first count are used, in no order */
+    uint32_t count;
+    AdConnectionPoolStatistics statistics;
+};
+
+// Clock
+
+/** Seconds, for the durations of the phases only. */
+static double AdConnectionNow(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+// Connections
+
+/** Connects fd to address within timeout seconds. Returns 0, or -1 with errno set. */
+static int AdConnectionConnect(int fd, const struct sockaddr *address, socklen_t length, double timeout)
+{
+    int flags = fcntl(fd, F_GETFL), error = 0;
+    socklen_t errorLength = sizeof(error);
+    struct pollfd polled = { fd, POLLOUT, 0 };
+    int status;
+
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return -1;
+    }
+    if (connect(fd, address, length) != 0) {
+        if (errno != EINPROGRESS) {
+            return -1;
+        }
+        do {
+            status = poll(&polled, 1, (int)ceil(timeout * 1000));
+        } while (status < 0 && errno == EINTR);     // the timeout starts over, a signal is rare
+        if (status == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (status < 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0) {
+            return -1;
+        }
+        if (error != 0) {
+            errno = error;
+            return -1;
+        }
+    }
+    return fcntl(fd, F_SETFL, flags);
+}
+
+/** Resolves host into *addresses, filling the resolve time and the canonical name. Returns 0, or the errno of the failure. */
+static int AdConnectionGetAddresses(const char *host, uint16_t port, AdConnectionTimings *measured, struct addrinfo **addresses)
+{
+    struct addrinfo hints;
+    char service[8];
+    double start = AdConnectionNow();
+    int status;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_CANONNAME | AI_NUMERICSERV;
+    snprintf(service, sizeof(service), "%u", port);
+    *addresses = NULL;
+    status = getaddrinfo(host, service, &hints, addresses);
+    measured->resolve = AdConnectionNow() - start;
+    snprintf(measured->canonicalName, sizeof(measured->canonicalName), "%s",
+             status == 0 && (*addresses)->ai_canonname ? (*addresses)->ai_canonname : host);
+    if (status != 0) {
+        *addresses = NULL;
+        return status == EAI_SYSTEM ? errno : EHOSTUNREACH;
+    }
+    return 0;
+}
+
+int AdConnectionResolve(const char *host, uint16_t port, AdConnectionTimings *timings)
+{
+    struct addrinfo *addresses;
+    AdConnectionTimings measured;
+    int error;
+
+    memset(&measured, 0, sizeof(measured));
+    error = AdConnectionGetAddresses(host, port, &measured, &addresses);
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    if (timings) {
+        *timings = measured;
+    }
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int AdConnectionOpen(const char *host, uint16_t port, double timeout, AdConnectionTimings *timings)
+{
+    struct addrinfo *addresses;
+    AdConnectionTimings measured;
+    double start = AdConnectionNow(), resolved;
+    int fd = -1, error;
+
+    memset(&measured, 0, sizeof(measured));
+    error = AdConnectionGetAddresses(host, port, &measured, &addresses);
+    resolved = AdConnectionNow();
+    if (error == 0) {
+        error = ETIMEDOUT;
+    }
+    for (struct addrinfo *address = addresses; address; address = address->ai_next) {
+        double remaining = timeout - (AdConnectionNow() - start);
+        int on = 1;
+
+        if (remaining <= 0) {
+            error = ETIMEDOUT;
+            break;
+        }
+        measured.addresses++;
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            error = errno;
+            continue;
+        }
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        if (AdConnectionConnect(fd, address->ai_addr, address->ai_addrlen, remaining) == 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            break;
+        }
+        error = errno;
+        close(fd);
+        fd = -1;
+    }
+    measured.connect = AdConnectionNow() - resolved;
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    if (timings) {
+        *timings = measured;
+    }
+    if (fd < 0) {
+        errno = error;
+    }
+    return fd;
+}
+
+/** Whether the server has not closed the connection, nor written to it: a response nobody asked for is as bad. */
+static int AdConnectionIsOpen(int fd)
+{
+    char byte;
+    ssize_t count;
+
+    do {
+        count = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    } while (count < 0 && errno == EINTR);
+    return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// Pool
+
+AdConnectionPool *AdConnectionPoolCreate(const AdConnectionPoolConfiguration *configuration)
+{
+    AdConnectionPool *pool;
+
+    if (configuration == NULL) {
+        configuration = &AdConnectionPoolDefaultConfiguration;
+    }
+    if (configuration->maxIdle == 0 || configuration->maxIdlePerOrigin == 0 || configuration->maxIdlePerOrigin > configuration->maxIdle
+        || !(configuration->idleTimeout > 0 && isfinite(configuration->idleTimeout))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    pool = calloc(1, sizeof(AdConnectionPool));
+    if (pool == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pool->idle = calloc(configuration->maxIdle, sizeof(AdConnectionIdle));
+    if (pool->idle == NULL) {
+        free(pool);
+        errno = ENOMEM;
+        return NULL;
+    }
+    pool->configuration = *configuration;
+    return pool;
+}
+
+void AdConnectionPoolRelease(AdConnectionPool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < pool->count; i++) {
+        close(pool->idle[i].fd);
+    }
+    free(pool->idle);
+    free(pool);
+}
+
+static void AdConnectionPoolRemove(AdConnectionPool *pool, uint32_t index, int closing)
+{
+    if (closing) {
+        close(pool->idle[index].fd);
+    }
+    pool->idle[index] = pool->idle[--pool->count];
+}
+
+/** The index of the oldest connection of the origin, or of any origin when host is NULL; count when there is none. */
+static uint32_t AdConnectionPoolOldest(const AdConnectionPool *pool, const char *host, uint16_t port)
+{
+    uint32_t oldest = pool->count;
+
+    for (uint32_t i = 0; i < pool->count; i++) {
+        const AdConnectionIdle *idle = &pool->idle[i];
+
+        if ((host == NULL || (idle->port == port && strcmp(idle->host, host) == 0))
+            && (oldest == pool->count || idle->since < pool->idle[oldest].since)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+int AdConnectionPoolTake(AdConnectionPool *pool, const char *host, uint16_t port, double now)
+{
+    for (;;) {
+        uint32_t latest = pool->count;
+        int fd;
+
+        for (uint32_t i = 0; i < pool->count; i++) {
+            const AdConnectionIdle *idle = &pool->idle[i];
+
+            if (idle->port == port && strcmp(idle->host, host) == 0 && (latest == pool->count || idle->since > pool->idle[latest].since)) {
+                latest = i;
+            }
+        }
+        if (latest == pool->count) {
+            pool->statistics.misses++;
+            errno = ENOENT;
+            return -1;
+        }
+        fd = pool->idle[latest].fd;
+        if (now - pool->idle[latest].since >= pool->configuration.idleTimeout) {
+            pool->statistics.idleEvictions++;
+        } else if (!AdConnectionIsOpen(fd)) {
+            pool->statistics.serverCloses++;
+        } else {
+            AdConnectionPoolRemove(pool, latest, 0);
+            pool->statistics.reuses++;
+            return fd;
+        }
+        AdConnectionPoolRemove(pool, latest, 1);
+    }
+}
+
+int AdConnectionPoolGive(AdConnectionPool *pool, int fd, const char *host, uint16_t port, double now)
+{
+    uint32_t ofOrigin = 0;
+    AdConnectionIdle *idle;
+
+    if (fd < 0 || strlen(host) >= kAdConnectionHostLength) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (uint32_t i = 0; i < pool->count; i++) {
+        if (pool->idle[i].port == port && strcmp(pool->idle[i].host, host) == 0) {
+            ofOrigin++;
+        }
+    }
+    if (ofOrigin >= pool->configuration.maxIdlePerOrigin) {
+        AdConnectionPoolRemove(pool, AdConnectionPoolOldest(pool, host, port), 1);
+        pool->statistics.overflows++;
+    } else if (pool->count == pool->configuration.maxIdle) {
+        AdConnectionPoolRemove(pool, AdConnectionPoolOldest(pool, NULL, 0), 1);
+        pool->statistics.overflows++;
+    }
+    idle = &pool->idle[pool->count++];
+    idle->fd = fd;
+    idle->port = port;
+    idle->since = now;
+    strcpy(idle->host, host);
+    pool->statistics.gives++;
+    return 0;
+}
+
+uint32_t AdConnectionPoolEvict(AdConnectionPool *pool, double now)
+{
+    uint32_t evicted = 0;
+
+    for (uint32_t i = 0; i < pool->count; ) {
+        if (now - pool->idle[i].since >= pool->configuration.idleTimeout) {
+            pool->statistics.idleEvictions++;
+        } else if (!AdConnectionIsOpen(pool->idle[i].fd)) {
+            pool->statistics.serverCloses++;
+        } else {
+            i++;
+            continue;
+        }
+        AdConnectionPoolRemove(pool, i, 1);
+        evicted++;
+    }
+    return evicted;
+}
+
+double AdConnectionPoolGetEvictionDate(const AdConnectionPool *pool)
+{
+    uint32_t oldest = AdConnectionPoolOldest(pool, NULL, 0);
+
+    return oldest < pool->count ? pool->idle[oldest].since + pool->configuration.idleTimeout : 0;
+}
+
+AdConnectionPoolStatistics AdConnectionPoolGetStatistics(const AdConnectionPool *pool)
+{
+    AdConnectionPoolStatistics statistics = pool->statistics;
+
+    statistics.idle = pool->count;
+    return statistics;
+}
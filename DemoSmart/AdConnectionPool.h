@@ -0,0 +1,116 @@
+//
+//  AdConnectionPool.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Opens TCP connections to the ad hosts ahead of the requests, and keeps them alive in a small pool.
+
+ A cold request pays the resolution of its host and the TCP handshake before its first byte goes
+ out, and a TLS handshake on top for https; on a cellular network that is several round trips of
+ 100 ms or more. AdConnectionOpen resolves and connects, and measures each phase:
+
+    AdConnectionTimings timings;
+    int fd = AdConnectionOpen("mobile.smartadserver.com", 80, 5, &timings);
+    // timings.resolve, timings.connect, timings.canonicalName
+
+ The pool holds the connections between requests, by origin (host and port), so that the next
+ request to the origin reuses one instead of opening its own:
+
+    int fd = AdConnectionPoolTake(pool, host, port, now);
+    if (fd < 0) {
+        fd = AdConnectionOpen(host, port, timeout, &timings);
+    }
+    // the request and its whole response
+    AdConnectionPoolGive(pool, fd, host, port, now);     // when the response allows keep-alive
+
+ A connection idle for idleTimeout is closed, before the server closes it on its side, and so is a
+ connection the server closed or wrote to unasked: Take never returns one of those. The pool keeps
+ at most maxIdlePerOrigin connections of an origin and maxIdle in all, closing the oldest first.
+
+ This file is plain C. AdConnectionOpen blocks and is thread safe; a pool is not, callers serialize
+ access. The dates are in seconds, on any clock that does not go back.
+ */
+
+#ifndef DemoSmart_AdConnectionPool_h
+#define DemoSmart_AdConnectionPool_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdConnectionHostLength 256
+
+typedef struct {
+    uint32_t maxIdlePerOrigin;
+    uint32_t maxIdle;               /* of every origin */
+    double idleTimeout;             /* seconds, below the keep-alive timeout of the servers */
+} AdConnectionPoolConfiguration;
+
+/** 2 connections by origin, 8 in all, closed after 30 s without a request. */
+extern const AdConnectionPoolConfiguration AdConnectionPoolDefaultConfiguration;
+
+typedef struct {
+    double resolve;                 /* seconds in the resolver */
+    double connect;                 /* seconds in the TCP handshakes, the failed addresses included */
+    uint32_t addresses;             /* tried, 1 when the first one answered */
+    char canonicalName[kAdConnectionHostLength];    /* the end of the CNAME chain, the host itself when it has none */
+} AdConnectionTimings;
+
+typedef struct {
+    uint64_t gives;
+    uint64_t reuses;                /* takes that found a connection */
+    uint64_t misses;                /* takes that did not */
+    uint64_t idleEvictions;         /* closed after idleTimeout */
+    uint64_t serverCloses;          /* found closed by the server */
+    uint64_t overflows;             /* closed to keep the limits */
+    uint32_t idle;                  /* now in the pool */
+} AdConnectionPoolStatistics;
+
+typedef struct AdConnectionPool AdConnectionPool;
+
+/** Resolves host and connects to its addresses in turn until one answers, within timeout seconds in all.
+
+ Returns the connected socket, blocking, with TCP_NODELAY, or -1 with errno set to EHOSTUNREACH when
+ the host does not resolve, ETIMEDOUT when no address answered in time, or the error of the last
+ address (ECONNREFUSED, ENETUNREACH...). timings, when not NULL, is filled either way.
+ */
+int AdConnectionOpen(const char *host, uint16_t port, double timeout, AdConnectionTimings *timings);
+
+/** Resolves host only, which leaves its answer and the CNAME chain in the resolver cache for the next connection.
+
+ Returns 0, or -1 with errno set to EHOSTUNREACH when the host does not resolve. timings, when not NULL,
+ is filled either way, with the resolve time and the canonical name only.
+ */
+int AdConnectionResolve(const char *host, uint16_t port, AdConnectionTimings *timings);
+
+/** Returns NULL with errno set to EINVAL for a bad configuration, ENOMEM when out of memory. NULL uses the default configuration. */
+AdConnectionPool *AdConnectionPoolCreate(const AdConnectionPoolConfiguration *configuration);
+
+/** Closes the connections of the pool. */
+void AdConnectionPoolRelease(AdConnectionPool *pool);
+
+/** A connection of the origin that is still open, the latest given first, removed from the pool.
+
+ Returns -1 with errno set to ENOENT when the pool has none: open one.
+ */
+int AdConnectionPoolTake(AdConnectionPool *pool, const char *host, uint16_t port, double now);
+
+/** Puts a connection in the pool, once the response it carried has been read whole and was not Connection: close.
+
+ The pool owns the connection from then on, and closes it when it is full of the origin or in all.
+ Returns 0, or -1 with errno set to EINVAL for a bad socket or a host longer than kAdConnectionHostLength.
+ */
+int AdConnectionPoolGive(AdConnectionPool *pool, int fd, const char *host, uint16_t port, double now);
+
+/** Closes the connections idle for idleTimeout at now and those the server closed. Returns how many. */
+uint32_t AdConnectionPoolEvict(AdConnectionPool *pool, double now);
+
+/** The date at which the oldest connection is to be evicted, 0 when the pool is empty. */
+double AdConnectionPoolGetEvictionDate(const AdConnectionPool *pool);
+
+AdConnectionPoolStatistics AdConnectionPoolGetStatistics(const AdConnectionPool *pool);
+
+#endif
@@ -0,0 +1,93 @@
+//
+//  AdConnectionWarmer.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SmartAdServerAd.h"
+
+/**
+ Resolves and connects to the ad server and to the hosts of the creatives and pixels before the ad calls, so that they do not pay the DNS, TCP and TLS setup.
+
+ Warm up the base URL given to +setSiteID:baseURL: as soon as it is set:
+
+    [SmartAdServerView setSiteID:51901 baseURL:kAdBaseURL];
+    [[AdConnectionWarmer sharedWarmer] warmUpBaseURL:kAdBaseURL];
+
+ The SDK opens its connections through the URL loading system, which cannot be handed a socket, so
+ the warm-up goes through what the SDK draws from. Each origin is warmed in the background, all at
+ once: AdConnectionResolve resolves its host, which leaves the whole CNAME chain in the resolver
+ cache and times the DNS alone; then a HEAD / through NSURLConnection, the only connection opened,
+ leaves a keep-alive connection, with its TLS session for https, in the pool of the URL loading
+ system, where the first request of the SDK to the origin finds it.
+
+ The origins are the base URL and those of the creatives and pixels of the latest ads, which
+ addHostsOfAd: remembers across launches: an origin not seen in an ad for originLifetime is
+ forgotten, and only the maximumOrigins most recently seen are warmed. The URL loading system
+ closes its idle connections after a while and in the background, so call warmUp again when the app
+ comes back to the foreground; warm-ups closer than minimumInterval are skipped.
+
+ The timings of each origin are logged (AdLogEventConnectionWarmed) and kept, see timings.
+ Use the warmer from the main thread.
+ */
+
+@interface AdConnectionWarmer : NSObject
+
++ (AdConnectionWarmer *)sharedWarmer;
+
+/** Of the ads, 6 by default.
+
+ */
+
+@property (nonatomic) NSUInteger maximumOrigins;
+
+/** 7 days by default.
+
+ */
+
+@property (nonatomic) NSTimeInterval originLifetime;
+
+/** 30 s by default.
+
+ */
+
+@property (nonatomic) NSTimeInterval minimumInterval;
+
+/** Sets the base URL, as given to the SDK: "www.smartadserver.com" is http, and warms up.
+
+ */
+
+- (void)warmUpBaseURL:(NSString *)baseURL;
+
+/** Warms up the base URL and the origins of the latest ads, unless the last warm-up was less than minimumInterval ago. Does nothing before warmUpBaseURL:.
+
+ */
+
+- (void)warmUp;
+
+/** Remembers the origins of the creatives and pixels of the ad, for the next warm-ups.
+
+ */
+
+- (void)addHostsOfAd:(SmartAdServerAd *)ad;
+
+/** The timings of the last warm-up of each origin, by "scheme://host:port".
+
+ Each is a dictionary of "resolve" and "request" (the HEAD, with the TCP and TLS handshakes and the
+ cached DNS answer) in seconds, "canonicalName", and "error" when it failed.
+
+ */
+
+- (NSDictionary *)timings;
+
+/** The origins warmUp warms, the base URL first.
+
+ */
+
+- (NSArray *)origins;
+
+@end
@@ -0,0 +1,193 @@
+//
+//  AdConnectionWarmer.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdConnectionWarmer.h"
+#import "AdConnectionPool.h"
+#import "AdLog.h"
+
+#include <errno.h>
+
+static NSString * const kAdConnectionWarmerOriginsDefaultsKey = @"AdConnectionWarmerOrigins";
+static const NSTimeInterval kAdConnectionWarmerTimeout = 10;
+
+@implementation AdConnectionWarmer
+{
+    NSString *_baseOrigin;
+    NSMutableDictionary *_originDates;  // of the ads: origin -> date last seen
+    NSMutableDictionary *_timings;      // under @synchronized(self), set from the warm-ups
+    NSOperationQueue *_requestQueue;
+    CFAbsoluteTime _lastWarmUp;
+}
+
++ (AdConnectionWarmer *)sharedWarmer
+{
+    static AdConnectionWarmer *sharedWarmer = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedWarmer = [[AdConnectionWarmer alloc] init];
+    });
+    return sharedWarmer;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _maximumOrigins = 6;
+        _originLifetime = 7 * 24 * 3600;
+        _minimumInterval = 30;
+        _originDates = [[[NSUserDefaults standardUserDefaults] dictionaryForKey:kAdConnectionWarmerOriginsDefaultsKey] mutableCopy] ?: [NSMutableDictionary dictionary];
+        _timings = [NSMutableDictionary dictionary];
+        _requestQueue = [[NSOperationQueue alloc] init];
+        _requestQueue.name = @"AdConnectionWarmer";
+    }
+    return self;
+}
+
+/** "scheme://host:port", or nil when the URL is not http or https. */
++ (NSString *)originOfURL:(NSURL *)URL
+{
+    NSString *scheme = [[URL scheme] lowercaseString];
+    NSString *host = [[URL host] lowercaseString];
+
+    if ([host length] == 0 || !([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"])) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@://%@:%@", scheme, host, [URL port] ?: ([scheme isEqualToString:@"https"] ? @443 : @80)];
+}
+
+#pragma mark - Origins
+
+- (void)warmUpBaseURL:(NSString *)baseURL
+{
+    NSString *string = [baseURL rangeOfString:@"://"].location == NSNotFound ? [@"http://" stringByAppendingString:baseURL] : baseURL;
+
+    _baseOrigin = [AdConnectionWarmer originOfURL:[NSURL URLWithString:string]];
+    if (_baseOrigin == nil) {
+        NSLog(@"AdConnectionWarmer: cannot warm up %@, not an http URL", baseURL);
+        return;
+    }
+    _lastWarmUp = 0;
+    [self warmUp];
+}
+
+- (NSArray *)origins
+{
+    NSDate *oldest = [NSDate dateWithTimeIntervalSinceNow:-self.originLifetime];
+    NSMutableArray *origins = [NSMutableArray array];
+    NSArray *recent = [_originDates keysSortedByValueUsingComparator:^NSComparisonResult(NSDate *date, NSDate *otherDate) {
+        return [otherDate compare:date];
+    }];
+
+    if (_baseOrigin) {
+        [origins addObject:_baseOrigin];
+    }
+    for (NSString *origin in recent) {
+        if ([origins count] == self.maximumOrigins + (_baseOrigin ? 1 : 0) || [_originDates[origin] compare:oldest] == NSOrderedAscending) {
+            break;
+        }
+        if (![origin isEqualToString:_baseOrigin]) {
+            [origins addObject:origin];
+        }
+    }
+    return origins;
+}
+
+- (void)addHostsOfAd:(SmartAdServerAd *)ad
+{
+    // Not the redirections, they open in a browser, nor the count URLs, only fetched on a click.
+    id candidates[] = { ad.creativeURL, ad.creativeLandscapeUrl, ad.creativeScriptURL, ad.impPixel, ad.impLandscapePixel };
+    NSMutableArray *URLs = [NSMutableArray arrayWithArray:ad.agencyPortraitPixels ?: @[]];
+    NSDate *now = [NSDate date];
+    NSArray *origins;
+
+    [URLs addObjectsFromArray:ad.agencyLandscapePixels ?: @[]];
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        if (candidates[i]) {
+            [URLs addObject:candidates[i]];
+        }
+    }
+    for (id URL in URLs) {
+        NSString *origin = [AdConnectionWarmer originOfURL:[URL isKindOfClass:[NSURL class]] ? URL : [NSURL URLWithString:[URL description]]];
+
+        if (origin && ![origin isEqualToString:_baseOrigin]) {
+            _originDates[origin] = now;
+        }
+    }
+    // Only what the next warm-up would use is kept.
+    origins = [self origins];
+    for (NSString *origin in [_originDates allKeys]) {
+        if (![origins containsObject:origin]) {
+            [_originDates removeObjectForKey:origin];
+        }
+    }
+    [[NSUserDefaults standardUserDefaults] setObject:_originDates forKey:kAdConnectionWarmerOriginsDefaultsKey];
+}
+
+#pragma mark - Warming up
+
+- (void)warmUp
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    if (_baseOrigin == nil || (_lastWarmUp > 0 && now - _lastWarmUp < self.minimumInterval)) {
+        return;
+    }
+    _lastWarmUp = now;
+    for (NSString *origin in [self origins]) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [self warmUpOrigin:origin];
+        });
+    }
+}
+
+/** Resolves, then leaves a connection in the pool of the URL loading system with a HEAD, its only handshake. Blocks. */
+- (void)warmUpOrigin:(NSString *)origin
+{
+    NSURL *URL = [NSURL URLWithString:[origin stringByAppendingString:@"/"]];
+    AdConnectionTimings timings;
+    int status = AdConnectionResolve([[URL host] UTF8String], (uint16_t)[[URL port] unsignedIntValue], &timings), resolveError = errno;
+    NSMutableDictionary *result = [@{ @"resolve": @(timings.resolve), @"canonicalName": @(timings.canonicalName) } mutableCopy];
+    NSMutableURLRequest *request;
+    CFAbsoluteTime start;
+
+    if (status != 0) {
+        result[@"error"] = @(strerror(resolveError));
+        NSLog(@"AdConnectionWarmer: cannot resolve %@: %@", origin, result[@"error"]);
+        [self setTimings:result forOrigin:origin];
+        return;
+    }
+    request = [NSMutableURLRequest requestWithURL:URL cachePolicy:NSURLRequestReloadIgnoringLocalCacheData timeoutInterval:kAdConnectionWarmerTimeout];
+    [request setHTTPMethod:@"HEAD"];
+    start = CFAbsoluteTimeGetCurrent();
+    [NSURLConnection sendAsynchronousRequest:request queue:_requestQueue completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+        result[@"request"] = @(CFAbsoluteTimeGetCurrent() - start);
+        if (error) {
+            result[@"error"] = [error localizedDescription];
+        }
+        [self setTimings:result forOrigin:origin];
+        AdLogWrite(AdLogEventConnectionWarmed, (uint64_t)(timings.resolve * 1e6), (uint64_t)([result[@"request"] doubleValue] * 1e6), 0,
+                   [[URL host] UTF8String]);
+    }];
+}
+
+- (void)setTimings:(NSDictionary *)timings forOrigin:(NSString *)origin
+{
+    @synchronized(self) {
+        _timings[origin] = timings;
+    }
+}
+
+- (NSDictionary *)timings
+{
+    @synchronized(self) {
+        return [_timings copy];
+    }
+}
+
+@end
@@ -0,0 +1,115 @@
+//
+//  AdCreativePipeline.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+#import "SmartAdServerAd.h"
+#import "AdPipeline.h"
+#import "AdBlobStore.h"
+
+typedef enum {
+    AdCreativePipelineStatusFetchFailed = 1,
+    AdCreativePipelineStatusInvalid,
+    AdCreativePipelineStatusDecodeFailed
+} AdCreativePipelineStatus;
+
+/**
+ Prefetches the creative assets of an ad before it is displayed.
+
+ Every asset (portrait image, landscape image, HTML script) goes through an AdPipeline with four
+ stages: fetch, verify (status, length and content signature), decode and store. The portrait and
+ landscape assets of an ad are separate items, so they download concurrently on the fetch workers.
+ With decodesImages, images are decoded off the main thread and redrawn at the exact imageSize /
+ landscapeImageSize of the ad, so that displaying one only swaps a pointer. The SDK downloads and
+ draws the creatives itself, so the app leaves it off: only the scripts are decoded, for AdHTMLPreprocessor.
+
+ The stored assets are kept in memory and the raw responses are put in the shared NSURLCache,
+ where the SDK finds them when it loads the creative. The raw responses also go to an AdBlobStore in
+ Library/Caches/AdBlobs, which keeps one copy of a file reused by several insertions and revalidates
+ known URLs with their ETag. The ad referencing a blob is its insertionId.
+ */
+
+@interface AdCreativePipeline : NSObject
+
+/** A pipeline with 4 fetch workers and 2 decode workers.
+
+ */
+
++ (AdCreativePipeline *)sharedPipeline;
+
+/** Creates the pipeline and starts its workers.
+
+ @param capacity The number of assets each stage queues. Prefetching waits (off the main thread) while the fetch queue is full.
+
+ */
+
+- (id)initWithFetchWorkers:(NSUInteger)fetchWorkers decodeWorkers:(NSUInteger)decodeWorkers capacity:(NSUInteger)capacity;
+
+/** Whether images are decoded and kept for imageForURL:, NO by default. Set it before the first prefetch.
+
+ */
+
+@property (nonatomic, assign) BOOL decodesImages;
+
+/** Queues the creative assets of the ad that are not stored yet.
+
+ @param completion Called on the main thread once every asset is stored or has failed, success is NO if one failed.
+
+ */
+
+- (void)prefetchAd:(SmartAdServerAd *)ad completion:(void (^)(BOOL success))completion;
+
+/** The decoded image stored for a creative URL, nil if it has not been prefetched or images are not decoded.
+
+ */
+
+- (UIImage *)imageForURL:(NSURL *)URL;
+
+- (NSString *)scriptForURL:(NSURL *)URL;
+
+/** Whether every creative asset of the ad is stored in memory or in the shared NSURLCache,
+ so that the ad can be displayed without waiting for the network.
+
+ */
+
+- (BOOL)hasCreativesForAd:(SmartAdServerAd *)ad;
+
+/** Waits until every queued asset is stored or has failed.
+
+ */
+
+- (void)waitUntilIdle;
+
+- (AdPipelineStatistics)statistics;
+
+/** Releases the blobs of the creatives of an ad that is no longer cached, and deletes those no other ad references.
+
+ */
+
+- (void)releaseCreativesOfAd:(SmartAdServerAd *)ad;
+
+- (AdBlobStoreStatistics)blobStatistics;
+
+/** The bytes of the decoded images held in memory, and of the scripts.
+
+ */
+
+- (NSUInteger)decodedImageCost;
+- (NSUInteger)scriptCost;
+
+/** Releases the oldest decoded images (or scripts) until at most cost bytes are held. Returns the bytes freed.
+
+ The raw responses stay in the shared NSURLCache, so a released asset can be decoded again.
+
+ */
+
+- (NSUInteger)trimDecodedImagesToCost:(NSUInteger)cost;
+- (NSUInteger)trimScriptsToCost:(NSUInteger)cost;
+
+@end
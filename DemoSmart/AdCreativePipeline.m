@@ -0,0 +1,560 @@
+//
+//  AdCreativePipeline.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdCreativePipeline.h"
+#import "AdBlobStore.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+static const NSTimeInterval kAdCreativeFetchTimeout = 15;
+
+@class AdCreativeBatch;
+
+@interface AdCreativeAsset : NSObject
+
+@property (nonatomic, strong) NSURL *URL;
+@property (nonatomic, assign) CGSize size;      // CGSizeZero keeps the size of the image
+@property (nonatomic, assign) BOOL isScript;
+@property (nonatomic, strong) AdCreativeBatch *batch;
+
+@property (nonatomic, strong) NSURLRequest *request;
+@property (nonatomic, strong) NSURLResponse *response;
+@property (nonatomic, strong) NSData *data;
+@property (nonatomic, strong) id decoded;
+@property (nonatomic, assign) NSUInteger cost;
+@property (nonatomic, assign) BOOL revalidated;    // a 304 reused the stored blob
+@property (nonatomic, assign) AdBlobHash blobHash;
+
+@end
+
+@implementation AdCreativeAsset
+
+@end
+
+/** What is left of a stored asset, for the memory accounting: the asset itself is only held by the NSCache. */
+@interface AdCreativeStoredAsset : NSObject
+
+@property (nonatomic, strong) NSURL *URL;
+@property (nonatomic, assign) NSUInteger cost;
+@property (nonatomic, assign) BOOL isScript;
+
+@end
+
+@implementation AdCreativeStoredAsset
+
+@end
+
+@interface AdCreativeBatch : NSObject
+
+@property (nonatomic, copy) void (^completion)(BOOL success);
+@property (nonatomic, assign) uint64_t owner;       // the insertionId of the ad
+@property (nonatomic, assign) NSUInteger pending;
+@property (nonatomic, assign) BOOL failed;
+
+@end
+
+@implementation AdCreativeBatch
+
+@end
+
+@interface AdCreativePipeline ()
+
+- (int)fetchAsset:(AdCreativeAsset *)asset;
+- (int)verifyAsset:(AdCreativeAsset *)asset;
+- (int)decodeAsset:(AdCreativeAsset *)asset;
+- (int)storeAsset:(AdCreativeAsset *)asset;
+- (void)finishAsset:(AdCreativeAsset *)asset status:(int)status;
+
+@end
+
+// Stage functions, the context is the AdCreativePipeline and the item a retained AdCreativeAsset.
+
+static int AdCreativeFetch(void *item, void *context)
+{
+    return [(__bridge AdCreativePipeline *)context fetchAsset:(__bridge AdCreativeAsset *)item];
+}
+
+static int AdCreativeVerify(void *item, void *context)
+{
+    return [(__bridge AdCreativePipeline *)context verifyAsset:(__bridge AdCreativeAsset *)item];
+}
+
+static int AdCreativeDecode(void *item, void *context)
+{
+    return [(__bridge AdCreativePipeline *)context decodeAsset:(__bridge AdCreativeAsset *)item];
+}
+
+static int AdCreativeStore(void *item, void *context)
+{
+    return [(__bridge AdCreativePipeline *)context storeAsset:(__bridge AdCreativeAsset *)item];
+}
+
+static void AdCreativeComplete(void *item, int status, void *context)
+{
+    [(__bridge AdCreativePipeline *)context finishAsset:CFBridgingRelease(item) status:status];
+}
+
+@implementation AdCreativePipeline
+{
+    AdPipeline *_pipeline;
+    dispatch_queue_t _feeder;   // submissions wait here instead of on the main thread
+    NSCache *_assets;           // URL -> UIImage or NSString
+    NSMutableArray *_storedAssets;  // AdCreativeStoredAsset, oldest first
+    AdBlobStore *_blobStore;    // used by the fetch and store workers, under @synchronized(self)
+    CGFloat _scale;
+}
+
++ (AdCreativePipeline *)sharedPipeline
+{
+    static AdCreativePipeline *sharedPipeline = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPipeline = [[AdCreativePipeline alloc] initWithFetchWorkers:4 decodeWorkers:2 capacity:8];
+    });
+    return sharedPipeline;
+}
+
+- (id)initWithFetchWorkers:(NSUInteger)fetchWorkers decodeWorkers:(NSUInteger)decodeWorkers capacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        AdPipelineStage stages[] = {
+            { AdCreativeFetch, (__bridge void *)self, (uint32_t)fetchWorkers, (uint32_t)capacity },
+            { AdCreativeVerify, (__bridge void *)self, 1, (uint32_t)capacity },
+            { AdCreativeDecode, (__bridge void *)self, (uint32_t)decodeWorkers, (uint32_t)capacity },
+            { AdCreativeStore, (__bridge void *)self, 1, (uint32_t)capacity },
+        };
+
+        _assets = [[NSCache alloc] init];
+        _assets.totalCostLimit = 32 * 1024 * 1024;
+        _storedAssets = [NSMutableArray array];
+        _scale = [UIScreen mainScreen].scale;
+        _feeder = dispatch_queue_create("com.mobvalue.DemoSmart.AdCreativePipeline", DISPATCH_QUEUE_SERIAL);
+        _blobStore = [self openBlobStore];
+        _pipeline = AdPipelineCreate(stages, sizeof(stages) / sizeof(stages[0]), AdCreativeComplete, (__bridge void *)self);
+        if (_pipeline == NULL) {
+            NSLog(@"AdCreativePipeline: cannot start the workers: %s", strerror(errno));
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    AdPipelineRelease(_pipeline);
+    AdBlobStoreClose(_blobStore);
+}
+
+- (AdBlobStore *)openBlobStore
+{
+    NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+    NSString *directory = [caches stringByAppendingPathComponent:@"AdBlobs"];
+    AdBlobStore *store;
+
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    store = AdBlobStoreOpen([directory fileSystemRepresentation]);
+    if (store == NULL) {
+        // Prefetching still works, without dedupe nor revalidation.
+        NSLog(@"AdCreativePipeline: cannot open the blob store in %@: %s", directory, strerror(errno));
+    }
+    return store;
+}
+
+#pragma mark - Prefetching
+
+- (void)prefetchAd:(SmartAdServerAd *)ad completion:(void (^)(BOOL success))completion
+{
+    AdCreativeBatch *batch = [[AdCreativeBatch alloc] init];
+    NSMutableArray *assets = [NSMutableArray array];
+    uint64_t owner = (uint64_t)ad.insertionId;
+
+    if (ad.creativeType == CreativeTypeImage) {
+        [self addAssetWithURL:ad.creativeURL size:ad.imageSize isScript:NO owner:owner toAssets:assets];
+        [self addAssetWithURL:ad.creativeLandscapeUrl size:ad.landscapeImageSize isScript:NO owner:owner toAssets:assets];
+    } else if (ad.creativeType == CreativeTypeHtml || ad.creativeType == CreativeTypeModalHtml) {
+        [self addAssetWithURL:ad.creativeScriptURL size:CGSizeZero isScript:YES owner:owner toAssets:assets];
+    }
+
+    if ([assets count] == 0) {
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(YES);
+            });
+        }
+        return;
+    }
+
+    batch.completion = completion;
+    batch.owner = owner;
+    batch.pending = [assets count];
+    for (AdCreativeAsset *asset in assets) {
+        asset.batch = batch;
+    }
+    dispatch_async(_feeder, ^{
+        for (AdCreativeAsset *asset in assets) {
+            AdPipelineSubmit(_pipeline, (__bridge_retained void *)asset);
+        }
+    });
+}
+
+- (void)addAssetWithURL:(NSURL *)URL size:(CGSize)size isScript:(BOOL)isScript owner:(uint64_t)owner toAssets:(NSMutableArray *)assets
+{
+    AdCreativeAsset *asset;
+
+    if (URL == nil || [[assets valueForKey:@"URL"] containsObject:URL]) {
+        return;
+    }
+    if ([_assets objectForKey:URL]
+        || (!isScript && !self.decodesImages && [[NSURLCache sharedURLCache] cachedResponseForRequest:[NSURLRequest requestWithURL:URL]])) {
+        // Already stored for another insertion, the new one references the same blob.
+        [self retainBlobForURL:URL owner:owner];
+        return;
+    }
+    asset = [[AdCreativeAsset alloc] init];
+    asset.URL = URL;
+    asset.size = size;
+    asset.isScript = isScript;
+    [assets addObject:asset];
+}
+
+- (UIImage *)imageForURL:(NSURL *)URL
+{
+    id asset = URL ? [_assets objectForKey:URL] : nil;
+    return [asset isKindOfClass:[UIImage class]] ? asset : nil;
+}
+
+- (NSString *)scriptForURL:(NSURL *)URL
+{
+    id asset = URL ? [_assets objectForKey:URL] : nil;
+    return [asset isKindOfClass:[NSString class]] ? asset : nil;
+}
+
+- (BOOL)hasCreativesForAd:(SmartAdServerAd *)ad
+{
+    NSMutableArray *URLs = [NSMutableArray array];
+
+    if (ad.creativeType == CreativeTypeImage && ad.creativeURL) {
+        [URLs addObject:ad.creativeURL];
+        if (ad.creativeLandscapeUrl) {
+            [URLs addObject:ad.creativeLandscapeUrl];
+        }
+    } else if (ad.creativeType == CreativeTypeHtml || ad.creativeType == CreativeTypeModalHtml) {
+        if (ad.creativeScriptURL) {
+            [URLs addObject:ad.creativeScriptURL];
+        } else if (ad.creativeScript == nil) {
+            return NO;
+        }
+    } else {
+        return NO;
+    }
+    for (NSURL *URL in URLs) {
+        if ([_assets objectForKey:URL] == nil && [[NSURLCache sharedURLCache] cachedResponseForRequest:[NSURLRequest requestWithURL:URL]] == nil) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (void)waitUntilIdle
+{
+    dispatch_sync(_feeder, ^{});
+    AdPipelineDrain(_pipeline);
+}
+
+- (AdPipelineStatistics)statistics
+{
+    return AdPipelineGetStatistics(_pipeline);
+}
+
+#pragma mark - Blobs
+
+- (void)releaseCreativesOfAd:(SmartAdServerAd *)ad
+{
+    @synchronized(self) {
+        if (_blobStore && AdBlobStoreReleaseOwner(_blobStore, (uint64_t)ad.insertionId) > 0) {
+            AdBlobStoreCollectGarbage(_blobStore);
+        }
+    }
+}
+
+- (AdBlobStoreStatistics)blobStatistics
+{
+    @synchronized(self) {
+        return _blobStore ? AdBlobStoreGetStatistics(_blobStore) : (AdBlobStoreStatistics){ 0 };
+    }
+}
+
+- (void)retainBlobForURL:(NSURL *)URL owner:(uint64_t)owner
+{
+    AdBlobHash hash;
+
+    @synchronized(self) {
+        if (_blobStore && AdBlobStoreLookupURL(_blobStore, [[URL absoluteString] UTF8String], &hash, NULL) == 0) {
+            AdBlobStoreRetain(_blobStore, &hash, owner);
+        }
+    }
+}
+
+/** The ETag to revalidate the stored blob of the URL with, nil if there is none. */
+- (NSString *)blobETagForURL:(NSURL *)URL
+{
+    AdBlobHash hash;
+    const char *etag = NULL;
+
+    @synchronized(self) {
+        if (_blobStore && AdBlobStoreLookupURL(_blobStore, [[URL absoluteString] UTF8String], &hash, &etag) == 0 && etag) {
+            return @(etag);
+        }
+    }
+    return nil;
+}
+
+/** Loads the stored blob of an asset the server answered 304 for, and makes up the 200 response it stands for. */
+- (int)reuseBlobForAsset:(AdCreativeAsset *)asset response:(NSHTTPURLResponse *)response
+{
+    NSMutableDictionary *headerFields = [[response allHeaderFields] mutableCopy];
+    AdBlobHash hash;
+    char path[PATH_MAX];
+
+    @synchronized(self) {
+        if (AdBlobStoreRevalidated(_blobStore, [[asset.URL absoluteString] UTF8String], &hash) != 0
+            || AdBlobStoreGetPath(_blobStore, &hash, path, sizeof(path)) != 0) {
+            return AdCreativePipelineStatusFetchFailed;
+        }
+    }
+    asset.data = [NSData dataWithContentsOfFile:@(path) options:NSDataReadingMappedIfSafe error:NULL];
+    if (asset.data == nil) {
+        return AdCreativePipelineStatusFetchFailed;
+    }
+    asset.blobHash = hash;
+    asset.revalidated = YES;
+    [headerFields removeObjectForKey:@"Content-Encoding"];
+    headerFields[@"Content-Length"] = [NSString stringWithFormat:@"%lu", (unsigned long)[asset.data length]];
+    asset.response = [[NSHTTPURLResponse alloc] initWithURL:asset.URL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+    return 0;
+}
+
+/** Puts a downloaded asset in the blob store, unless it came from there, and references it for the ad. */
+- (void)storeBlobForAsset:(AdCreativeAsset *)asset
+{
+    AdBlobHash hash = asset.blobHash;
+    NSString *etag = nil;
+
+    if ([asset.response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSDictionary *headerFields = [(NSHTTPURLResponse *)asset.response allHeaderFields];
+        // CFNetwork canonicalizes the name to "Etag".
+        etag = headerFields[@"Etag"] ?: headerFields[@"ETag"];
+    }
+    @synchronized(self) {
+        if (_blobStore == NULL) {
+            return;
+        }
+        if (!asset.revalidated && AdBlobStorePut(_blobStore, [[asset.URL absoluteString] UTF8String], [etag UTF8String],
+                                                 [asset.data bytes], [asset.data length], &hash) != 0) {
+            NSLog(@"AdCreativePipeline: cannot store the blob of %@: %s", asset.URL, strerror(errno));
+            return;
+        }
+        AdBlobStoreRetain(_blobStore, &hash, asset.batch.owner);
+    }
+}
+
+#pragma mark - Memory
+
+/** Forgets the assets the NSCache evicted on its own, and returns the cost of the others of the kind. */
+- (NSUInteger)costOfAssets:(BOOL)scripts
+{
+    NSUInteger cost = 0;
+
+    @synchronized(_storedAssets) {
+        for (AdCreativeStoredAsset *storedAsset in [_storedAssets copy]) {
+            if ([_assets objectForKey:storedAsset.URL] == nil) {
+                [_storedAssets removeObject:storedAsset];
+            } else if (storedAsset.isScript == scripts) {
+                cost += storedAsset.cost;
+            }
+        }
+    }
+    return cost;
+}
+
+- (NSUInteger)trimAssets:(BOOL)scripts toCost:(NSUInteger)cost
+{
+    NSUInteger total = [self costOfAssets:scripts];
+    NSUInteger freed = 0;
+
+    @synchronized(_storedAssets) {
+        for (AdCreativeStoredAsset *storedAsset in [_storedAssets copy]) {
+            if (total - freed <= cost) {
+                break;
+            }
+            if (storedAsset.isScript == scripts) {
+                [_assets removeObjectForKey:storedAsset.URL];
+                [_storedAssets removeObject:storedAsset];
+                freed += storedAsset.cost;
+            }
+        }
+    }
+    return freed;
+}
+
+- (NSUInteger)decodedImageCost
+{
+    return [self costOfAssets:NO];
+}
+
+- (NSUInteger)trimDecodedImagesToCost:(NSUInteger)cost
+{
+    return [self trimAssets:NO toCost:cost];
+}
+
+- (NSUInteger)scriptCost
+{
+    return [self costOfAssets:YES];
+}
+
+- (NSUInteger)trimScriptsToCost:(NSUInteger)cost
+{
+    return [self trimAssets:YES toCost:cost];
+}
+
+#pragma mark - Stages
+
+- (int)fetchAsset:(AdCreativeAsset *)asset
+{
+    @autoreleasepool {
+        NSURLResponse *response = nil;
+        NSError *error = nil;
+        NSString *etag = [self blobETagForURL:asset.URL];
+        NSMutableURLRequest *request;
+
+        asset.request = [NSURLRequest requestWithURL:asset.URL cachePolicy:NSURLRequestUseProtocolCachePolicy timeoutInterval:kAdCreativeFetchTimeout];
+        request = [asset.request mutableCopy];
+        if (etag) {
+            // The blob is the cached copy: ask the server, not the URL cache, whether it is still current.
+            request.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+            [request setValue:etag forHTTPHeaderField:@"If-None-Match"];
+        }
+        asset.data = [NSURLConnection sendSynchronousRequest:request returningResponse:&response error:&error];
+        if (etag && [response isKindOfClass:[NSHTTPURLResponse class]] && [(NSHTTPURLResponse *)response statusCode] == 304) {
+            return [self reuseBlobForAsset:asset response:(NSHTTPURLResponse *)response];
+        }
+        asset.response = response;
+        return asset.data ? 0 : AdCreativePipelineStatusFetchFailed;
+    }
+}
+
+- (int)verifyAsset:(AdCreativeAsset *)asset
+{
+    const uint8_t *bytes = [asset.data bytes];
+    NSUInteger length = [asset.data length];
+
+    if (length == 0) {
+        return AdCreativePipelineStatusInvalid;
+    }
+    if ([asset.response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSHTTPURLResponse *response = (NSHTTPURLResponse *)asset.response;
+        NSInteger statusCode = [response statusCode];
+
+        if (statusCode < 200 || statusCode >= 300) {
+            return AdCreativePipelineStatusInvalid;
+        }
+        // The expected length is the encoded one when the body was compressed.
+        if (response.expectedContentLength != NSURLResponseUnknownLength && [response allHeaderFields][@"Content-Encoding"] == nil
+            && (NSUInteger)response.expectedContentLength != length) {
+            return AdCreativePipelineStatusInvalid;
+        }
+    }
+    if (!asset.isScript) {
+        BOOL png = length >= 4 && bytes[0] == 0x89 && bytes[1] == 'P' && bytes[2] == 'N' && bytes[3] == 'G';
+        BOOL jpeg = length >= 3 && bytes[0] == 0xff && bytes[1] == 0xd8 && bytes[2] == 0xff;
+        BOOL gif = length >= 4 && memcmp(bytes, "GIF8", 4) == 0;
+
+        if (!png && !jpeg && !gif) {
+            return AdCreativePipelineStatusInvalid;
+        }
+    }
+    return 0;
+}
+
+- (int)decodeAsset:(AdCreativeAsset *)asset
+{
+    @autoreleasepool {
+        if (asset.isScript) {
+            NSString *script = [[NSString alloc] initWithData:asset.data encoding:NSUTF8StringEncoding];
+            asset.decoded = script;
+            asset.cost = [asset.data length];
+            return script ? 0 : AdCreativePipelineStatusDecodeFailed;
+        }
+        if (!self.decodesImages) {
+            return 0;
+        }
+
+        UIImage *image = [UIImage imageWithData:asset.data];
+        CGSize size = CGSizeEqualToSize(asset.size, CGSizeZero) ? image.size : asset.size;
+
+        if (image == nil || size.width <= 0 || size.height <= 0) {
+            return AdCreativePipelineStatusDecodeFailed;
+        }
+        // Drawing forces the decompression here rather than on the first display, at the size it is displayed at.
+        UIGraphicsBeginImageContextWithOptions(size, NO, _scale);
+        [image drawInRect:CGRectMake(0, 0, size.width, size.height)];
+        asset.decoded = UIGraphicsGetImageFromCurrentImageContext();
+        UIGraphicsEndImageContext();
+        asset.cost = (NSUInteger)(size.width * _scale) * (NSUInteger)(size.height * _scale) * 4;
+        return asset.decoded ? 0 : AdCreativePipelineStatusDecodeFailed;
+    }
+}
+
+- (int)storeAsset:(AdCreativeAsset *)asset
+{
+    AdCreativeStoredAsset *storedAsset = [[AdCreativeStoredAsset alloc] init];
+
+    [self storeBlobForAsset:asset];
+    if ([asset.response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSCachedURLResponse *cachedResponse = [[NSCachedURLResponse alloc] initWithResponse:asset.response data:asset.data];
+        [[NSURLCache sharedURLCache] storeCachedResponse:cachedResponse forRequest:asset.request];
+    }
+    storedAsset.URL = asset.URL;
+    storedAsset.cost = asset.cost;
+    storedAsset.isScript = asset.isScript;
+    @synchronized(_storedAssets) {
+        for (AdCreativeStoredAsset *previous in [_storedAssets copy]) {
+            if ([previous.URL isEqual:asset.URL]) {
+                [_storedAssets removeObject:previous];
+            }
+        }
+        if (asset.decoded) {
+            [_assets setObject:asset.decoded forKey:asset.URL cost:asset.cost];
+            [_storedAssets addObject:storedAsset];
+        }
+    }
+    return 0;
+}
+
+- (void)finishAsset:(AdCreativeAsset *)asset status:(int)status
+{
+    AdCreativeBatch *batch = asset.batch;
+    BOOL finished;
+
+    // The raw bytes are not needed once the asset is stored.
+    asset.data = nil;
+    @synchronized(batch) {
+        batch.failed = batch.failed || status != 0;
+        finished = --batch.pending == 0;
+    }
+    if (finished && batch.completion) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            batch.completion(!batch.failed);
+        });
+    }
+}
+
+@end
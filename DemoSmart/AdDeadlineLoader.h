@@ -0,0 +1,94 @@
+//
+//  AdDeadlineLoader.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SASAdView.h"
+#import "SmartAdServerAd.h"
+
+/** Creates and configures (frame, loader, delegate) an ad view, which the loader then adds to the container.
+
+ */
+
+typedef SASAdView *(^AdDeadlineLoaderViewFactory)(void);
+
+/**
+ Loads an ad under an end-to-end time budget, so that something is shown before the budget elapses.
+
+ The budget is split in two phases the SDK lets us observe: the ad call (DNS, connect and the call
+ itself, until adView:didDownloadAdData:) and the creative download (until adViewDidLoad:).
+
+ - When the ad call has not answered after the p95 of the recently observed ad call latencies,
+   a hedged duplicate call is sent on a second ad view (without the master flag, so that no extra
+   page view is counted). The first view to load wins and the other one is dismissed. The hedged
+   call counts among the calls of the AdPlacementBreaker.
+ - When nothing has loaded shortly before the deadline, the best non expired ad of the OfflineAdCache
+   is displayed instead. The calls still in flight are dismissed, and reported to the breaker as failed.
+ - When the AdPlacementBreaker skips the placement, after a no-fill or failures, no call is made
+   and the cached ad is displayed at once, if there is one.
+
+ The calls are loaded through the AdPageCoordinator, with the other placements of the page registered
+ in the same run loop turn.
+
+ The ad views keep the delegate the factory gave them. That delegate forwards the load callbacks
+ listed below, and only handles them itself when they return YES.
+ */
+
+@interface AdDeadlineLoader : NSObject
+
+- (id)initWithFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target budget:(NSTimeInterval)budget;
+
+/** Share of the budget given to the ad call, 0.6 by default. Past it, a call is hedged even without history.
+
+ */
+
+@property (nonatomic, assign) double adCallShare;
+
+/** Time kept at the end of the budget to display the cached ad, 0.25 seconds by default.
+
+ */
+
+@property (nonatomic, assign) NSTimeInterval displayMargin;
+
+@property (nonatomic, assign) BOOL hedgingEnabled;
+
+/** The ad view that won, nil until an ad has been loaded or the cached ad has been displayed.
+
+ */
+
+@property (nonatomic, readonly) SASAdView *adView;
+
+/** Whether the displayed ad came from the offline cache.
+
+ */
+
+@property (nonatomic, readonly) BOOL usedCachedAd;
+
+/** Whether the AdPlacementBreaker skipped the ad call. Only the cached ad is loaded then, if there is one.
+
+ */
+
+@property (nonatomic, readonly) BOOL shortCircuited;
+
+- (void)loadInView:(UIView *)container viewFactory:(AdDeadlineLoaderViewFactory)factory;
+
+- (void)cancel;
+
+// Delegate callbacks to forward.
+
+- (BOOL)adView:(SASAdView *)adView didDownloadAdData:(SmartAdServerAd *)adData;
+- (BOOL)adViewDidLoad:(SASAdView *)adView;
+- (BOOL)adView:(SASAdView *)adView didFailToLoadWithError:(NSError *)error;
+
+/** The p95 of the ad call latencies recently observed for a format, or 0 without history.
+
+ */
+
++ (NSTimeInterval)p95AdCallLatencyForFormatId:(NSInteger)formatId;
+
+@end
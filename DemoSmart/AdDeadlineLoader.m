@@ -0,0 +1,275 @@
+//
+//  AdDeadlineLoader.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdDeadlineLoader.h"
+#import "AdLifecycleMetrics.h"
+#import "AdLog.h"
+#import "AdPageCoordinator.h"
+#import "AdPlacementBreaker.h"
+#import "OfflineAdCache.h"
+
+static NSString * const kAdDeadlineLatenciesDefaultsKey = @"AdDeadlineLoaderAdCallLatencies";
+static const NSUInteger kAdDeadlineLatencySamples = 50;
+static const NSUInteger kAdDeadlineMinimumSamples = 5;
+
+@implementation AdDeadlineLoader
+{
+    NSInteger _formatId;
+    NSString *_pageId;
+    NSString *_target;
+    NSTimeInterval _budget;
+
+    UIView *_container;
+    AdDeadlineLoaderViewFactory _factory;
+    NSMutableArray *_contenders;
+    NSMutableDictionary *_callStarts;   // view pointer -> call start
+    CFAbsoluteTime _start;
+    BOOL _adDataReceived;
+    BOOL _outcomeReported;              // to the breaker, once per load
+    BOOL _finished;
+}
+
+- (id)initWithFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target budget:(NSTimeInterval)budget
+{
+    self = [super init];
+    if (self) {
+        _formatId = formatId;
+        _pageId = [pageId copy];
+        _target = [target copy];
+        _budget = budget;
+        _contenders = [NSMutableArray array];
+        _callStarts = [NSMutableDictionary dictionary];
+        self.adCallShare = 0.6;
+        self.displayMargin = 0.25;
+        self.hedgingEnabled = YES;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self cancel];
+}
+
+#pragma mark - Latency history
+
++ (NSTimeInterval)p95AdCallLatencyForFormatId:(NSInteger)formatId
+{
+    NSDictionary *latencies = [[NSUserDefaults standardUserDefaults] dictionaryForKey:kAdDeadlineLatenciesDefaultsKey];
+    NSArray *samples = [latencies[[@(formatId) stringValue]] sortedArrayUsingSelector:@selector(compare:)];
+
+    if ([samples count] < kAdDeadlineMinimumSamples) {
+        return 0;
+    }
+    return [samples[(NSUInteger)ceil(0.95 * [samples count]) - 1] doubleValue];
+}
+
++ (void)recordAdCallLatency:(NSTimeInterval)latency formatId:(NSInteger)formatId
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSMutableDictionary *latencies = [[defaults dictionaryForKey:kAdDeadlineLatenciesDefaultsKey] mutableCopy] ?: [NSMutableDictionary dictionary];
+    NSString *key = [@(formatId) stringValue];
+    NSMutableArray *samples = [latencies[key] mutableCopy] ?: [NSMutableArray array];
+
+    [samples addObject:@(latency)];
+    if ([samples count] > kAdDeadlineLatencySamples) {
+        [samples removeObjectAtIndex:0];
+    }
+    latencies[key] = samples;
+    [defaults setObject:latencies forKey:kAdDeadlineLatenciesDefaultsKey];
+}
+
+#pragma mark - Loading
+
+- (void)loadInView:(UIView *)container viewFactory:(AdDeadlineLoaderViewFactory)factory
+{
+    NSTimeInterval p95 = [AdDeadlineLoader p95AdCallLatencyForFormatId:_formatId];
+    NSTimeInterval adCallDeadline = _budget * self.adCallShare;
+    NSTimeInterval hedgeDelay = p95 > 0 ? MIN(p95, adCallDeadline) : adCallDeadline;
+    NSTimeInterval fallbackDelay = MAX(_budget - self.displayMargin, 0);
+
+    _container = container;
+    _factory = [factory copy];
+    _start = CFAbsoluteTimeGetCurrent();
+
+    // A placement that did not fill or failed lately is not called again before its retry date.
+    if (![[AdPlacementBreaker sharedBreaker] shouldLoadFormatId:_formatId pageId:_pageId target:_target]) {
+        NSDate *retryDate;
+        AdCircuitState state = [[AdPlacementBreaker sharedBreaker] stateForFormatId:_formatId pageId:_pageId target:_target retryDate:&retryDate];
+
+        _shortCircuited = YES;
+        AdLogWrite(AdLogEventAdCallSkipped, (uint64_t)_formatId, state, (uint64_t)MAX(0, [retryDate timeIntervalSinceNow] * 1000), NULL);
+        if (![self fallBackToCachedAd]) {
+            _finished = YES;
+        }
+        return;
+    }
+    [self startCallWithMaster:YES];
+
+    if (self.hedgingEnabled && hedgeDelay < fallbackDelay) {
+        [self performAfter:hedgeDelay selector:@selector(hedge)];
+    }
+    [self performAfter:fallbackDelay selector:@selector(fallBackToCachedAd)];
+}
+
+- (void)performAfter:(NSTimeInterval)delay selector:(SEL)selector
+{
+    __weak AdDeadlineLoader *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        AdDeadlineLoader *loader = weakSelf;
+        if (loader && !loader->_finished) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Warc-performSelector-leaks"
+            [loader performSelector:selector];
+#pragma clang diagnostic pop
+        }
+    });
+}
+
+- (SASAdView *)addView
+{
+    SASAdView *adView = _factory();
+    [_container addSubview:adView];
+    return adView;
+}
+
+- (void)startCallWithMaster:(BOOL)master
+{
+    SASAdView *adView = [self addView];
+    float remaining = (float)(_budget - (CFAbsoluteTimeGetCurrent() - _start));
+
+    [_contenders addObject:adView];
+    _callStarts[[NSValue valueWithNonretainedObject:adView]] = @(CFAbsoluteTimeGetCurrent());
+    [[AdLifecycleMetrics sharedMetrics] adView:adView didStartLoadingFormatId:_formatId pageId:_pageId];
+    // Sent with the other placements of the page, the hedged call without the master flag.
+    // The SDK timeout backs the budget up in case our own timers are late.
+    if (master) {
+        [[AdPageCoordinator sharedCoordinator] loadAdView:adView formatId:_formatId pageId:_pageId target:_target timeout:MAX(remaining, 0.1f)];
+    } else {
+        [[AdPageCoordinator sharedCoordinator] loadRepeatedAdView:adView formatId:_formatId pageId:_pageId target:_target timeout:MAX(remaining, 0.1f)];
+    }
+    AdLogWrite(AdLogEventAdCallStarted, (uint64_t)_formatId, !master, 0, NULL);
+}
+
+- (void)hedge
+{
+    // Once the ad call answered, only the creative is missing and a second call would not get it sooner.
+    if (_adDataReceived || [_contenders count] != 1) {
+        return;
+    }
+    // Nor while the placement is probed: the probe alone tells whether it works again. Closed, the breaker counts it among the calls.
+    if ([[AdPlacementBreaker sharedBreaker] stateForFormatId:_formatId pageId:_pageId target:_target retryDate:NULL] != AdCircuitClosed
+        || ![[AdPlacementBreaker sharedBreaker] shouldLoadFormatId:_formatId pageId:_pageId target:_target]) {
+        return;
+    }
+    [self startCallWithMaster:NO];
+}
+
+- (BOOL)fallBackToCachedAd
+{
+    SmartAdServerAd *ad = [[OfflineAdCache sharedCache] adForFormatId:_formatId pageId:_pageId target:_target];
+    SASAdView *adView;
+
+    if (ad == nil) {
+        return NO;
+    }
+    adView = [self addView];
+    _usedCachedAd = YES;
+    // The calls in flight are discarded without a delegate, their timeout would never be reported: offline, the breaker would never open.
+    if ([_contenders count] > 0 && !_outcomeReported) {
+        _outcomeReported = YES;
+        [[AdPlacementBreaker sharedBreaker] reportOutcome:AdCallFailed forFormatId:_formatId pageId:_pageId target:_target];
+    }
+    AdLogWrite(AdLogEventCachedAdDisplayed, (uint64_t)_formatId, (uint64_t)ad.insertionId, 0, NULL);
+    [self finishWithAdView:adView];
+    [[AdLifecycleMetrics sharedMetrics] adView:adView didStartLoadingFormatId:_formatId pageId:_pageId];
+    [adView displayThisAd:ad];
+    return YES;
+}
+
+- (void)finishWithAdView:(SASAdView *)winner
+{
+    _finished = YES;
+    _adView = winner;
+    for (SASAdView *adView in _contenders) {
+        if (adView != winner) {
+            [self discardAdView:adView];
+        }
+    }
+    [_contenders removeAllObjects];
+}
+
+- (void)discardAdView:(SASAdView *)adView
+{
+    [[AdPageCoordinator sharedCoordinator] removeAdView:adView];
+    adView.delegate = nil;
+    [adView dismiss];
+    [adView removeFromSuperview];
+}
+
+- (void)cancel
+{
+    if (!_finished) {
+        [self finishWithAdView:nil];
+    }
+}
+
+#pragma mark - Delegate callbacks
+
+- (BOOL)adView:(SASAdView *)adView didDownloadAdData:(SmartAdServerAd *)adData
+{
+    NSNumber *callStart = _callStarts[[NSValue valueWithNonretainedObject:adView]];
+
+    if (callStart) {
+        [AdDeadlineLoader recordAdCallLatency:CFAbsoluteTimeGetCurrent() - [callStart doubleValue] formatId:_formatId];
+        [_callStarts removeObjectForKey:[NSValue valueWithNonretainedObject:adView]];
+        if (!_outcomeReported) {
+            _outcomeReported = YES;
+            [[AdPlacementBreaker sharedBreaker] reportOutcome:AdCallFilled forFormatId:_formatId pageId:_pageId target:_target];
+        }
+    }
+    _adDataReceived = YES;
+    return _finished ? adView == _adView : [_contenders containsObject:adView];
+}
+
+- (BOOL)adViewDidLoad:(SASAdView *)adView
+{
+    if (_finished) {
+        if (adView != _adView) {
+            [self discardAdView:adView];
+            return NO;
+        }
+        return YES;
+    }
+    [self finishWithAdView:adView];
+    return YES;
+}
+
+- (BOOL)adView:(SASAdView *)adView didFailToLoadWithError:(NSError *)error
+{
+    if (_finished) {
+        return adView == _adView;
+    }
+    [_contenders removeObject:adView];
+    [adView removeFromSuperview];
+    if ([_contenders count] > 0) {
+        return NO;
+    }
+    if (!_adDataReceived && !_outcomeReported) {
+        _outcomeReported = YES;
+        [[AdPlacementBreaker sharedBreaker] reportError:error forFormatId:_formatId pageId:_pageId target:_target];
+    }
+    // Every call failed before the deadline, the cached ad is still better than nothing.
+    if ([self fallBackToCachedAd]) {
+        return NO;
+    }
+    _finished = YES;
+    return YES;
+}
+
+@end
@@ -0,0 +1,75 @@
+//
+//  AdHTMLPreprocessor.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SmartAdServerAd.h"
+
+/**
+ Prepares the document of an HTML or MRAID creative when the ad is received, so that displaying it
+ loads nothing from the network.
+
+ The creative script is fetched (or taken from the ad, or from AdCreativePipeline), then processed
+ once with AdHTMLProcessor: its images, stylesheets, scripts and videos are downloaded into
+ Library/Caches/AdCreatives/<insertionId>/ and the document points at these files, the
+ <script src="mraid.js"> reference is replaced by MRAIDBootstrap, and the markup is minified.
+ The result is kept as index.html next to the assets, and in memory for the latest ads.
+
+    [[AdHTMLPreprocessor sharedPreprocessor] preprocessAd:ad completion:nil];
+    ...
+    [adView displayThisAd:[[AdHTMLPreprocessor sharedPreprocessor] adWithProcessedCreative:ad]];
+
+ An asset that cannot be downloaded keeps its remote URL, so a document is always usable.
+ */
+
+@interface AdHTMLPreprocessor : NSObject
+
++ (AdHTMLPreprocessor *)sharedPreprocessor;
+
+/** The script inlined in place of mraid.js, mraid.js from the main bundle by default.
+
+ When nil, the reference is left for the SDK, which provides MRAID to the web view itself.
+
+ */
+
+@property (nonatomic, copy) NSString *MRAIDBootstrap;
+
+/** Processes the creative of the ad and downloads its assets, nothing if the ad is not HTML or is already processed.
+
+ @param completion Called on the main thread, success is NO if the creative script could not be fetched. May be nil.
+
+ */
+
+- (void)preprocessAd:(SmartAdServerAd *)ad completion:(void (^)(BOOL success))completion;
+
+/** Whether the processed document of the ad is ready.
+
+ */
+
+- (BOOL)hasDocumentForAd:(SmartAdServerAd *)ad;
+
+/** A copy of the ad whose creativeScript is the processed document, or the ad itself if there is none.
+
+ */
+
+- (SmartAdServerAd *)adWithProcessedCreative:(SmartAdServerAd *)ad;
+
+/** Deletes the document and the assets of an ad that is no longer cached.
+
+ */
+
+- (void)removeDocumentForAd:(SmartAdServerAd *)ad;
+
+/** The documents processed since the launch, and the bytes minifying removed from them.
+
+ */
+
+- (NSUInteger)processedCount;
+- (unsigned long long)savedBytes;
+
+@end
@@ -0,0 +1,312 @@
+//
+//  AdHTMLPreprocessor.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdHTMLPreprocessor.h"
+#import "AdBlobStore.h"
+#import "AdCreativePipeline.h"
+#import "AdHTMLProcessor.h"
+#import "AdLog.h"
+
+#include <string.h>
+
+static NSString *const kAdHTMLDocumentName = @"index.html";
+static const NSTimeInterval kAdHTMLFetchTimeout = 20;
+static const NSUInteger kAdHTMLMaxAssets = 32;
+static const NSUInteger kAdHTMLMaxAssetLength = 2 * 1024 * 1024;
+static const NSUInteger kAdHTMLCachedDocuments = 8;
+
+/** The assets of a document: the URLs as written in it, and the local files they are rewritten to. */
+@interface AdHTMLAssets : NSObject
+
+@property (nonatomic, strong) NSURL *baseURL;
+@property (nonatomic, strong) NSMutableDictionary *URLs;    // URL as written -> absolute NSURL
+@property (nonatomic, strong) NSMutableDictionary *files;   // URL as written -> file URL string
+
+@end
+
+@implementation AdHTMLAssets
+
+@end
+
+static const char *AdHTMLCollectAsset(void *info, const char *url, size_t length)
+{
+    AdHTMLAssets *assets = (__bridge AdHTMLAssets *)info;
+    NSString *written = [[NSString alloc] initWithBytes:url length:length encoding:NSUTF8StringEncoding];
+    NSURL *URL = written ? [NSURL URLWithString:written relativeToURL:assets.baseURL] : nil;
+    NSString *scheme = [[URL scheme] lowercaseString];
+
+    // data: URIs are already inline, and a relative URL without a base cannot be fetched.
+    if (([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"]) && [assets.URLs count] < kAdHTMLMaxAssets) {
+        assets.URLs[written] = [URL absoluteURL];
+    }
+    return NULL;
+}
+
+static const char *AdHTMLRewriteAsset(void *info, const char *url, size_t length)
+{
+    AdHTMLAssets *assets = (__bridge AdHTMLAssets *)info;
+    NSString *written = [[NSString alloc] initWithBytes:url length:length encoding:NSUTF8StringEncoding];
+    NSString *file = written ? assets.files[written] : nil;
+
+    return [file UTF8String];
+}
+
+@implementation AdHTMLPreprocessor
+{
+    dispatch_queue_t _queue;
+    NSOperationQueue *_connectionQueue;
+    NSString *_directory;
+    NSCache *_documents;                // insertionId -> NSString
+    NSMutableSet *_processing;          // insertionIds
+    NSUInteger _processedCount;
+    unsigned long long _savedBytes;
+}
+
++ (AdHTMLPreprocessor *)sharedPreprocessor
+{
+    static AdHTMLPreprocessor *sharedPreprocessor = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPreprocessor = [[AdHTMLPreprocessor alloc] init];
+    });
+    return sharedPreprocessor;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+        NSString *bootstrapPath = [[NSBundle mainBundle] pathForResource:@"mraid" ofType:@"js"];
+
+        _MRAIDBootstrap = bootstrapPath ? [NSString stringWithContentsOfFile:bootstrapPath encoding:NSUTF8StringEncoding error:NULL] : nil;
+        _queue = dispatch_queue_create("com.mobvalue.DemoSmart.AdHTMLPreprocessor", DISPATCH_QUEUE_SERIAL);
+        _connectionQueue = [[NSOperationQueue alloc] init];
+        _connectionQueue.maxConcurrentOperationCount = 4;
+        _directory = [caches stringByAppendingPathComponent:@"AdCreatives"];
+        _documents = [[NSCache alloc] init];
+        _documents.countLimit = kAdHTMLCachedDocuments;
+        _processing = [NSMutableSet set];
+        [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    return self;
+}
+
+#pragma mark - Documents
+
+- (void)preprocessAd:(SmartAdServerAd *)ad completion:(void (^)(BOOL success))completion
+{
+    NSNumber *insertionId = @(ad.insertionId);
+    NSURL *scriptURL = ad.creativeScriptURL;
+    NSString *script = ad.creativeScript ?: (scriptURL ? [[AdCreativePipeline sharedPipeline] scriptForURL:scriptURL] : nil);
+    NSString *bootstrap = self.MRAIDBootstrap;
+
+    if (![self isHTMLAd:ad] || [self hasDocumentForAd:ad] || [_processing containsObject:insertionId] || (script == nil && scriptURL == nil)) {
+        if (completion) {
+            completion([self hasDocumentForAd:ad]);
+        }
+        return;
+    }
+    [_processing addObject:insertionId];
+
+    void (^process)(NSString *) = ^(NSString *fetchedScript) {
+        dispatch_async(_queue, ^{
+            [self processScript:fetchedScript baseURL:scriptURL insertionId:insertionId bootstrap:bootstrap completion:^(BOOL success) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [_processing removeObject:insertionId];
+                    if (completion) {
+                        completion(success);
+                    }
+                });
+            }];
+        });
+    };
+
+    if (script) {
+        process(script);
+        return;
+    }
+    NSURLRequest *request = [NSURLRequest requestWithURL:scriptURL cachePolicy:NSURLRequestUseProtocolCachePolicy timeoutInterval:kAdHTMLFetchTimeout];
+    [NSURLConnection sendAsynchronousRequest:request queue:_connectionQueue completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+        NSString *fetchedScript = data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : nil;
+
+        if (fetchedScript == nil || ([response isKindOfClass:[NSHTTPURLResponse class]] && [(NSHTTPURLResponse *)response statusCode] != 200)) {
+            NSLog(@"AdHTMLPreprocessor: cannot fetch %@: %@", scriptURL, error ?: response);
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [_processing removeObject:insertionId];
+                if (completion) {
+                    completion(NO);
+                }
+            });
+            return;
+        }
+        process(fetchedScript);
+    }];
+}
+
+- (BOOL)hasDocumentForAd:(SmartAdServerAd *)ad
+{
+    NSNumber *insertionId = @(ad.insertionId);
+
+    return [_documents objectForKey:insertionId] != nil
+        || [[NSFileManager defaultManager] fileExistsAtPath:[[self directoryForInsertionId:insertionId] stringByAppendingPathComponent:kAdHTMLDocumentName]];
+}
+
+- (SmartAdServerAd *)adWithProcessedCreative:(SmartAdServerAd *)ad
+{
+    NSNumber *insertionId = @(ad.insertionId);
+    NSString *document = [self isHTMLAd:ad] ? [_documents objectForKey:insertionId] : nil;
+    SmartAdServerAd *processedAd;
+
+    if (document == nil && [self isHTMLAd:ad]) {
+        document = [NSString stringWithContentsOfFile:[[self directoryForInsertionId:insertionId] stringByAppendingPathComponent:kAdHTMLDocumentName]
+                                             encoding:NSUTF8StringEncoding error:NULL];
+        if (document) {
+            [_documents setObject:document forKey:insertionId cost:[document length]];
+        }
+    }
+    if (document == nil) {
+        return ad;
+    }
+    processedAd = [ad copy];
+    processedAd.creativeScript = document;
+    processedAd.creativeScriptURL = nil;
+    return processedAd;
+}
+
+- (void)removeDocumentForAd:(SmartAdServerAd *)ad
+{
+    NSNumber *insertionId = @(ad.insertionId);
+
+    [_documents removeObjectForKey:insertionId];
+    dispatch_async(_queue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:[self directoryForInsertionId:insertionId] error:NULL];
+    });
+}
+
+- (NSUInteger)processedCount
+{
+    __block NSUInteger count;
+    dispatch_sync(_queue, ^{
+        count = _processedCount;
+    });
+    return count;
+}
+
+- (unsigned long long)savedBytes
+{
+    __block unsigned long long bytes;
+    dispatch_sync(_queue, ^{
+        bytes = _savedBytes;
+    });
+    return bytes;
+}
+
+#pragma mark - Processing
+
+- (BOOL)isHTMLAd:(SmartAdServerAd *)ad
+{
+    return ad.creativeType == CreativeTypeHtml || ad.creativeType == CreativeTypeModalHtml || ad.creativeType == CreativeTypeMRAIDAdSecondPart;
+}
+
+- (NSString *)directoryForInsertionId:(NSNumber *)insertionId
+{
+    return [_directory stringByAppendingPathComponent:[insertionId stringValue]];
+}
+
+/** On the queue: lists the assets, downloads them, then writes the processed document. */
+- (void)processScript:(NSString *)script baseURL:(NSURL *)baseURL insertionId:(NSNumber *)insertionId bootstrap:(NSString *)bootstrap
+           completion:(void (^)(BOOL success))completion
+{
+    NSData *html = [script dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *directory = [self directoryForInsertionId:insertionId];
+    AdHTMLAssets *assets = [[AdHTMLAssets alloc] init];
+    AdHTMLProcessing processing = { AdHTMLProcessRewriteURLs, NULL, 0, AdHTMLCollectAsset, (__bridge void *)assets };
+    dispatch_group_t group = dispatch_group_create();
+    char *output;
+
+    assets.baseURL = baseURL;
+    assets.URLs = [NSMutableDictionary dictionary];
+    assets.files = [NSMutableDictionary dictionary];
+    output = AdHTMLProcess([html bytes], [html length], &processing, NULL, NULL);
+    free(output);
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+
+    [assets.URLs enumerateKeysAndObjectsUsingBlock:^(NSString *written, NSURL *URL, BOOL *stop) {
+        NSURLRequest *request = [NSURLRequest requestWithURL:URL cachePolicy:NSURLRequestUseProtocolCachePolicy timeoutInterval:kAdHTMLFetchTimeout];
+
+        dispatch_group_enter(group);
+        [NSURLConnection sendAsynchronousRequest:request queue:_connectionQueue completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+            NSString *path = [self pathForAssetURL:URL inDirectory:directory];
+            BOOL valid = data && [data length] <= kAdHTMLMaxAssetLength
+                && (![response isKindOfClass:[NSHTTPURLResponse class]] || [(NSHTTPURLResponse *)response statusCode] == 200);
+
+            if (valid && [data writeToFile:path atomically:YES]) {
+                dispatch_async(_queue, ^{
+                    assets.files[written] = [[NSURL fileURLWithPath:path] absoluteString];
+                    dispatch_group_leave(group);
+                });
+            } else {
+                NSLog(@"AdHTMLPreprocessor: keeping the remote %@: %@", URL, error ?: response);
+                dispatch_group_leave(group);
+            }
+        }];
+    }];
+
+    dispatch_group_notify(group, _queue, ^{
+        AdHTMLProcessing rewriting = { AdHTMLProcessMinify | AdHTMLProcessRewriteURLs, NULL, 0, AdHTMLRewriteAsset, (__bridge void *)assets };
+        NSData *bootstrapData = [bootstrap dataUsingEncoding:NSUTF8StringEncoding];
+        AdHTMLStatistics statistics;
+        NSString *document = nil;
+        size_t length;
+        char *processed;
+
+        if (bootstrapData) {
+            rewriting.options |= AdHTMLProcessInlineMRAID;
+            rewriting.MRAIDBootstrap = [bootstrapData bytes];
+            rewriting.MRAIDBootstrapLength = [bootstrapData length];
+        }
+        processed = AdHTMLProcess([html bytes], [html length], &rewriting, &length, &statistics);
+        if (processed) {
+            document = [[NSString alloc] initWithBytesNoCopy:processed length:length encoding:NSUTF8StringEncoding freeWhenDone:YES];
+            if (document == nil) {
+                free(processed);
+            }
+        }
+        if (document == nil || ![document writeToFile:[directory stringByAppendingPathComponent:kAdHTMLDocumentName] atomically:YES
+                                              encoding:NSUTF8StringEncoding error:NULL]) {
+            completion(NO);
+            return;
+        }
+        [_documents setObject:document forKey:insertionId cost:[document length]];
+        _processedCount++;
+        // The bootstrap is added on purpose, only what minifying removed is saved.
+        if (statistics.inputLength + statistics.inlinedScripts * [bootstrapData length] > statistics.outputLength) {
+            _savedBytes += statistics.inputLength + statistics.inlinedScripts * [bootstrapData length] - statistics.outputLength;
+        }
+        AdLogWrite(AdLogEventCreativePreprocessed, [insertionId unsignedLongLongValue], [assets.files count], statistics.outputLength, NULL);
+        completion(YES);
+    });
+}
+
+/** An asset is named after the SHA-256 of its URL, with its extension so that the web view picks its type. */
+- (NSString *)pathForAssetURL:(NSURL *)URL inDirectory:(NSString *)directory
+{
+    const char *string = [[URL absoluteString] UTF8String];
+    NSString *extension = [[URL path] pathExtension];
+    char name[kAdBlobHashStringLength];
+    AdBlobHash hash;
+    NSString *path;
+
+    AdBlobHashCompute(string, strlen(string), &hash);
+    AdBlobHashGetString(&hash, name);
+    path = [directory stringByAppendingPathComponent:@(name)];
+    return [extension length] > 0 ? [path stringByAppendingPathExtension:extension] : path;
+}
+
+@end
@@ -0,0 +1,427 @@
+//
+//  AdHTMLProcessor.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdHTMLProcessor.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define kAdHTMLMaxAttributes    32
+#define kAdHTMLMaxURLLength     2048
+#define kAdHTMLMRAIDScriptName  "mraid.js"
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+    int failed;
+} AdHTMLOutput;
+
+typedef struct {
+    const char *name;
+    size_t nameLength;
+    const char *value;      /* NULL for an attribute without value */
+    size_t valueLength;
+    char quote;             /* '"', '\'' or 0 when unquoted */
+} AdHTMLAttribute;
+
+typedef struct {
+    const char *html;
+    const char *end;
+    const AdHTMLProcessing *processing;
+    AdHTMLOutput output;
+    AdHTMLStatistics statistics;
+} AdHTMLState;
+
+// Output
+
+static void AdHTMLAppend(AdHTMLOutput *output, const char *bytes, size_t length)
+{
+    if (output->failed) {
+        return;
+    }
+    if (output->length + length + 1 > output->capacity) {
+        size_t capacity = output->capacity ? output->capacity : 1024;
+        char *grown;
+
+        while (capacity < output->length + length + 1) {
+            capacity *= 2;
+        }
+        grown = realloc(output->bytes, capacity);
+        if (grown == NULL) {
+            output->failed = 1;
+            return;
+        }
+        output->bytes = grown;
+        output->capacity = capacity;
+    }
+    memcpy(output->bytes + output->length, bytes, length);
+    output->length += length;
+    output->bytes[output->length] = '\0';
+}
+
+static void AdHTMLAppendString(AdHTMLOutput *output, const char *string)
+{
+    AdHTMLAppend(output, string, strlen(string));
+}
+
+// Scanning
+
+static int AdHTMLIsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static int AdHTMLIsLetter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int AdHTMLNameIs(const char *name, size_t length, const char *expected)
+{
+    return strlen(expected) == length && strncasecmp(name, expected, length) == 0;
+}
+
+/** The first occurrence of a string, ignoring the case, or NULL. */
+static const char *AdHTMLFind(const char *start, const char *end, const char *string)
+{
+    size_t length = strlen(string);
+
+    for (const char *cursor = start; cursor + length <= end; cursor++) {
+        if (strncasecmp(cursor, string, length) == 0) {
+            return cursor;
+        }
+    }
+    return NULL;
+}
+
+/** Whether the last path component of the URL, before its query, is mraid.js. */
+static int AdHTMLIsMRAIDScript(const char *url, size_t length)
+{
+    const char *end = url + length;
+    const char *name;
+
+    for (const char *cursor = url; cursor < end; cursor++) {
+        if (*cursor == '?' || *cursor == '#') {
+            end = cursor;
+            break;
+        }
+    }
+    for (name = end; name > url && name[-1] != '/'; name--) {
+    }
+    return AdHTMLNameIs(name, (size_t)(end - name), kAdHTMLMRAIDScriptName);
+}
+
+// Tags
+
+static const AdHTMLAttribute *AdHTMLFindAttribute(const AdHTMLAttribute *attributes, unsigned count, const char *name)
+{
+    for (unsigned i = 0; i < count; i++) {
+        if (AdHTMLNameIs(attributes[i].name, attributes[i].nameLength, name)) {
+            return &attributes[i];
+        }
+    }
+    return NULL;
+}
+
+static int AdHTMLIsAssetAttribute(const char *tag, size_t tagLength, const AdHTMLAttribute *attribute)
+{
+    if (attribute->value == NULL || attribute->valueLength == 0) {
+        return 0;
+    }
+    if (AdHTMLNameIs(attribute->name, attribute->nameLength, "src")) {
+        // mraid.js is not an asset of the creative, the SDK provides it.
+        return !AdHTMLIsMRAIDScript(attribute->value, attribute->valueLength);
+    }
+    if (AdHTMLNameIs(attribute->name, attribute->nameLength, "poster")
+        || AdHTMLNameIs(attribute->name, attribute->nameLength, "background")) {
+        return 1;
+    }
+    return AdHTMLNameIs(attribute->name, attribute->nameLength, "href") && AdHTMLNameIs(tag, tagLength, "link");
+}
+
+/** Writes an attribute value, through the rewrite callback for the assets. */
+static void AdHTMLWriteValue(AdHTMLState *state, const char *tag, size_t tagLength, const AdHTMLAttribute *attribute)
+{
+    const AdHTMLProcessing *processing = state->processing;
+    const char *replacement = NULL;
+    char quote;
+
+    if ((processing->options & AdHTMLProcessRewriteURLs) && processing->rewrite && AdHTMLIsAssetAttribute(tag, tagLength, attribute)
+        && attribute->valueLength < kAdHTMLMaxURLLength) {
+        char url[kAdHTMLMaxURLLength];
+        size_t length = 0;
+
+        for (size_t i = 0; i < attribute->valueLength; i++) {
+            url[length++] = attribute->value[i];
+            if (i + 5 <= attribute->valueLength && strncmp(attribute->value + i, "&amp;", 5) == 0) {
+                i += 4;
+            }
+        }
+        state->statistics.assetURLs++;
+        replacement = processing->rewrite(processing->info, url, length);
+    }
+
+    if (replacement == NULL) {
+        if (attribute->quote) {
+            AdHTMLAppend(&state->output, &attribute->quote, 1);
+        }
+        AdHTMLAppend(&state->output, attribute->value, attribute->valueLength);
+        if (attribute->quote) {
+            AdHTMLAppend(&state->output, &attribute->quote, 1);
+        }
+        return;
+    }
+
+    quote = attribute->quote ? attribute->quote : '"';
+    AdHTMLAppend(&state->output, &quote, 1);
+    state->statistics.rewrittenURLs++;
+    for (const char *cursor = replacement; *cursor; cursor++) {
+        if (*cursor == '&') {
+            AdHTMLAppendString(&state->output, "&amp;");
+        } else if (*cursor == quote) {
+            AdHTMLAppendString(&state->output, quote == '"' ? "&quot;" : "&#39;");
+        } else {
+            AdHTMLAppend(&state->output, cursor, 1);
+        }
+    }
+    AdHTMLAppend(&state->output, &quote, 1);
+}
+
+/** Copies the content of a raw text element (script, style, pre, textarea) as it is, up to its end tag. */
+static const char *AdHTMLCopyRawText(AdHTMLState *state, const char *cursor, const char *tag, size_t tagLength)
+{
+    char endTag[16];
+    const char *close;
+
+    endTag[0] = '<';
+    endTag[1] = '/';
+    memcpy(endTag + 2, tag, tagLength);
+    endTag[2 + tagLength] = '\0';
+    close = AdHTMLFind(cursor, state->end, endTag);
+    if (close == NULL) {
+        AdHTMLAppend(&state->output, cursor, (size_t)(state->end - cursor));
+        return state->end;
+    }
+    AdHTMLAppend(&state->output, cursor, (size_t)(close - cursor));
+    return close;
+}
+
+/** Processes a start or end tag at cursor, a '<' followed by a letter or '/'. Returns where the text resumes. */
+static const char *AdHTMLProcessTag(AdHTMLState *state, const char *cursor)
+{
+    const AdHTMLProcessing *processing = state->processing;
+    const int minify = processing->options & AdHTMLProcessMinify;
+    AdHTMLAttribute attributes[kAdHTMLMaxAttributes];
+    unsigned count = 0;
+    const char *start = cursor, *tag, *end = state->end;
+    const AdHTMLAttribute *source;
+    size_t tagLength;
+    int closing = 0, selfClosing = 0;
+
+    cursor++;
+    if (*cursor == '/') {
+        closing = 1;
+        cursor++;
+    }
+    tag = cursor;
+    while (cursor < end && !AdHTMLIsSpace(*cursor) && *cursor != '>' && *cursor != '/') {
+        cursor++;
+    }
+    tagLength = (size_t)(cursor - tag);
+
+    // Attributes: name, name=value, name="value" or name='value'.
+    while (cursor < end && *cursor != '>') {
+        AdHTMLAttribute attribute = { cursor, 0, NULL, 0, 0 };
+
+        if (AdHTMLIsSpace(*cursor)) {
+            cursor++;
+            continue;
+        }
+        if (*cursor == '/') {
+            selfClosing = cursor + 1 < end && cursor[1] == '>';
+            cursor++;
+            continue;
+        }
+        while (cursor < end && !AdHTMLIsSpace(*cursor) && *cursor != '=' && *cursor != '>' && !(*cursor == '/' && cursor + 1 < end && cursor[1] == '>')) {
+            cursor++;
+        }
+        attribute.nameLength = (size_t)(cursor - attribute.name);
+        while (cursor < end && AdHTMLIsSpace(*cursor)) {
+            cursor++;
+        }
+        if (cursor < end && *cursor == '=') {
+            cursor++;
+            while (cursor < end && AdHTMLIsSpace(*cursor)) {
+                cursor++;
+            }
+            if (cursor < end && (*cursor == '"' || *cursor == '\'')) {
+                const char *close = memchr(cursor + 1, *cursor, (size_t)(end - cursor - 1));
+
+                if (close == NULL) {
+                    break;
+                }
+                attribute.quote = *cursor;
+                attribute.value = cursor + 1;
+                attribute.valueLength = (size_t)(close - cursor - 1);
+                cursor = close + 1;
+            } else {
+                attribute.value = cursor;
+                while (cursor < end && !AdHTMLIsSpace(*cursor) && *cursor != '>') {
+                    cursor++;
+                }
+                attribute.valueLength = (size_t)(cursor - attribute.value);
+            }
+        }
+        if (count == kAdHTMLMaxAttributes || attribute.nameLength == 0) {
+            break;
+        }
+        attributes[count++] = attribute;
+    }
+    if (cursor >= end || *cursor != '>') {
+        // Unterminated, or more attributes than expected: the tag is kept as it is.
+        cursor = memchr(start, '>', (size_t)(end - start));
+        cursor = cursor ? cursor + 1 : end;
+        AdHTMLAppend(&state->output, start, (size_t)(cursor - start));
+        return cursor;
+    }
+    cursor++;
+
+    // <script src=".../mraid.js"></script> becomes the bootstrap itself.
+    source = AdHTMLFindAttribute(attributes, count, "src");
+    if (!closing && (processing->options & AdHTMLProcessInlineMRAID) && processing->MRAIDBootstrap && AdHTMLNameIs(tag, tagLength, "script")
+        && source && source->value && AdHTMLIsMRAIDScript(source->value, source->valueLength)) {
+        const char *close = AdHTMLFind(cursor, end, "</script");
+        const char *closeEnd = close ? memchr(close, '>', (size_t)(end - close)) : NULL;
+
+        if (closeEnd) {
+            AdHTMLAppendString(&state->output, "<script>");
+            AdHTMLAppend(&state->output, processing->MRAIDBootstrap, processing->MRAIDBootstrapLength);
+            AdHTMLAppendString(&state->output, "</script>");
+            state->statistics.inlinedScripts++;
+            return closeEnd + 1;
+        }
+    }
+
+    if (!minify && !(processing->options & AdHTMLProcessRewriteURLs)) {
+        AdHTMLAppend(&state->output, start, (size_t)(cursor - start));
+    } else if (!minify) {
+        // Only the asset values change, everything around them is copied.
+        const char *copied = start;
+
+        for (unsigned i = 0; i < count; i++) {
+            if (AdHTMLIsAssetAttribute(tag, tagLength, &attributes[i])) {
+                const char *valueStart = attributes[i].value - (attributes[i].quote ? 1 : 0);
+
+                AdHTMLAppend(&state->output, copied, (size_t)(valueStart - copied));
+                AdHTMLWriteValue(state, tag, tagLength, &attributes[i]);
+                copied = attributes[i].value + attributes[i].valueLength + (attributes[i].quote ? 1 : 0);
+            }
+        }
+        AdHTMLAppend(&state->output, copied, (size_t)(cursor - copied));
+    } else {
+        size_t written = state->output.length;
+
+        AdHTMLAppendString(&state->output, closing ? "</" : "<");
+        AdHTMLAppend(&state->output, tag, tagLength);
+        for (unsigned i = 0; i < count; i++) {
+            AdHTMLAppend(&state->output, " ", 1);
+            AdHTMLAppend(&state->output, attributes[i].name, attributes[i].nameLength);
+            if (attributes[i].value) {
+                AdHTMLAppend(&state->output, "=", 1);
+                AdHTMLWriteValue(state, tag, tagLength, &attributes[i]);
+            }
+        }
+        AdHTMLAppendString(&state->output, selfClosing ? "/>" : ">");
+        written = state->output.length - written;
+        if ((size_t)(cursor - start) > written) {
+            state->statistics.whitespaceRemoved += (size_t)(cursor - start) - written;
+        }
+    }
+
+    if (!closing && !selfClosing && (AdHTMLNameIs(tag, tagLength, "script") || AdHTMLNameIs(tag, tagLength, "style")
+                                     || AdHTMLNameIs(tag, tagLength, "pre") || AdHTMLNameIs(tag, tagLength, "textarea"))) {
+        return AdHTMLCopyRawText(state, cursor, tag, tagLength);
+    }
+    return cursor;
+}
+
+// Document
+
+char *AdHTMLProcess(const char *html, size_t length, const AdHTMLProcessing *processing, size_t *outputLength, AdHTMLStatistics *statistics)
+{
+    AdHTMLState state;
+    const char *cursor = html;
+    const int minify = processing->options & AdHTMLProcessMinify;
+
+    memset(&state, 0, sizeof(state));
+    state.html = html;
+    state.end = html + length;
+    state.processing = processing;
+    state.statistics.inputLength = length;
+    AdHTMLAppend(&state.output, "", 0);
+
+    while (cursor < state.end && !state.output.failed) {
+        const char *next;
+
+        if (*cursor == '<' && cursor + 4 <= state.end && strncmp(cursor, "<!--", 4) == 0) {
+            const char *close = AdHTMLFind(cursor + 4, state.end, "-->");
+
+            next = close ? close + 3 : state.end;
+            // Conditional comments are code for old Internet Explorer, they stay.
+            if (minify && strncmp(cursor + 4, "[if", 3) != 0) {
+                state.statistics.commentsRemoved++;
+            } else {
+                AdHTMLAppend(&state.output, cursor, (size_t)(next - cursor));
+            }
+            cursor = next;
+        } else if (*cursor == '<' && cursor + 1 < state.end && (cursor[1] == '!' || cursor[1] == '?')) {
+            next = memchr(cursor, '>', (size_t)(state.end - cursor));
+            next = next ? next + 1 : state.end;
+            AdHTMLAppend(&state.output, cursor, (size_t)(next - cursor));
+            cursor = next;
+        } else if (*cursor == '<' && cursor + 2 < state.end && (AdHTMLIsLetter(cursor[1]) || (cursor[1] == '/' && AdHTMLIsLetter(cursor[2])))) {
+            cursor = AdHTMLProcessTag(&state, cursor);
+        } else if (minify && AdHTMLIsSpace(*cursor)) {
+            next = cursor;
+            while (next < state.end && AdHTMLIsSpace(*next)) {
+                next++;
+            }
+            // A removed comment can leave two runs next to each other.
+            if (state.output.length > 0 && state.output.bytes[state.output.length - 1] == ' ') {
+                state.statistics.whitespaceRemoved += (size_t)(next - cursor);
+            } else {
+                AdHTMLAppend(&state.output, " ", 1);
+                state.statistics.whitespaceRemoved += (size_t)(next - cursor) - 1;
+            }
+            cursor = next;
+        } else {
+            // Text up to the next tag or, when minifying, the next whitespace.
+            next = cursor + 1;
+            while (next < state.end && *next != '<' && !(minify && AdHTMLIsSpace(*next))) {
+                next++;
+            }
+            AdHTMLAppend(&state.output, cursor, (size_t)(next - cursor));
+            cursor = next;
+        }
+    }
+
+    if (state.output.failed) {
+        free(state.output.bytes);
+        return NULL;
+    }
+    state.statistics.outputLength = state.output.length;
+    if (outputLength) {
+        *outputLength = state.output.length;
+    }
+    if (statistics) {
+        *statistics = state.statistics;
+    }
+    return state.output.bytes;
+}
@@ -0,0 +1,70 @@
+//
+//  AdHTMLProcessor.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Prepares the document of an HTML or MRAID creative once, so that displaying it needs nothing else.
+
+ In a single pass over the document, without building a tree, it can:
+
+ - inline the MRAID bootstrap: a <script src=".../mraid.js"></script> becomes <script>bootstrap</script>;
+ - rewrite the asset URLs (src and poster, background, and the href of <link>) through a callback,
+   to point them at local copies. Links (<a href>) are left alone, they are the click-through;
+ - minify: comments are dropped (conditional comments kept), whitespace runs in text and tags
+   become a single space. The content of <script>, <style>, <pre> and <textarea> is kept as it is,
+   minifying scripts safely would need a JavaScript parser.
+
+ The callback also lists the assets: a first pass whose callback returns NULL collects the URLs to
+ download, a second pass rewrites them.
+
+ This file is plain C. It keeps no state between calls and is thread safe.
+ */
+
+#ifndef DemoSmart_AdHTMLProcessor_h
+#define DemoSmart_AdHTMLProcessor_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    AdHTMLProcessMinify         = 1 << 0,
+    AdHTMLProcessInlineMRAID    = 1 << 1,
+    AdHTMLProcessRewriteURLs    = 1 << 2
+};
+
+/** Returns the URL to write in place of an asset URL, NUL terminated, or NULL to keep it.
+
+ @param url The URL as written in the document, with &amp; decoded. Not NUL terminated.
+ */
+typedef const char *(*AdHTMLRewriteCallback)(void *info, const char *url, size_t length);
+
+typedef struct {
+    uint32_t options;               /* AdHTMLProcess flags */
+    const char *MRAIDBootstrap;     /* inlined by AdHTMLProcessInlineMRAID, the reference is kept when NULL */
+    size_t MRAIDBootstrapLength;
+    AdHTMLRewriteCallback rewrite;  /* called by AdHTMLProcessRewriteURLs */
+    void *info;
+} AdHTMLProcessing;
+
+typedef struct {
+    size_t inputLength;
+    size_t outputLength;
+    uint32_t commentsRemoved;
+    size_t whitespaceRemoved;       /* bytes */
+    uint32_t assetURLs;             /* passed to the callback */
+    uint32_t rewrittenURLs;
+    uint32_t inlinedScripts;
+} AdHTMLStatistics;
+
+/** Processes a document.
+
+ @param statistics Filled in, may be NULL.
+ @return The processed document, NUL terminated, to free(). NULL when out of memory.
+ */
+char *AdHTMLProcess(const char *html, size_t length, const AdHTMLProcessing *processing, size_t *outputLength, AdHTMLStatistics *statistics);
+
+#endif
@@ -0,0 +1,211 @@
+//
+//  AdHistogram.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdHistogram.h"
+
+#include <string.h>
+
+#define kAdHistogramSubBuckets  (1u << kAdHistogramSubBucketBits)
+#define kAdHistogramLinearLimit (2u * kAdHistogramSubBuckets)
+
+// Buckets
+
+static unsigned AdHistogramMostSignificantBit(uint64_t value)
+{
+    unsigned bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+static uint32_t AdHistogramBucketIndex(uint64_t value)
+{
+    unsigned shift;
+
+    if (value < kAdHistogramLinearLimit) {
+        return (uint32_t)value;
+    }
+    shift = AdHistogramMostSignificantBit(value) - kAdHistogramSubBucketBits;
+    return kAdHistogramLinearLimit + (shift - 1) * kAdHistogramSubBuckets + (uint32_t)(value >> shift) - kAdHistogramSubBuckets;
+}
+
+/** The largest value that falls in the bucket. */
+static uint64_t AdHistogramBucketHighestValue(uint32_t index)
+{
+    uint32_t shift, subBucket;
+
+    if (index < kAdHistogramLinearLimit) {
+        return index;
+    }
+    shift = (index - kAdHistogramLinearLimit) / kAdHistogramSubBuckets + 1;
+    subBucket = (index - kAdHistogramLinearLimit) % kAdHistogramSubBuckets + kAdHistogramSubBuckets;
+    return ((uint64_t)subBucket << shift) + (UINT64_C(1) << shift) - 1;
+}
+
+// Recording
+
+void AdHistogramInit(AdHistogram *histogram)
+{
+    memset(histogram, 0, sizeof(AdHistogram));
+}
+
+void AdHistogramRecord(AdHistogram *histogram, uint64_t value)
+{
+    if (value > kAdHistogramMaxValue) {
+        value = kAdHistogramMaxValue;
+    }
+    if (histogram->count == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->count++;
+    histogram->sum += value;
+    histogram->counts[AdHistogramBucketIndex(value)]++;
+}
+
+void AdHistogramMerge(AdHistogram *histogram, const AdHistogram *other)
+{
+    if (other->count == 0) {
+        return;
+    }
+    if (histogram->count == 0 || other->min < histogram->min) {
+        histogram->min = other->min;
+    }
+    if (other->max > histogram->max) {
+        histogram->max = other->max;
+    }
+    histogram->count += other->count;
+    histogram->sum += other->sum;
+    for (uint32_t i = 0; i < kAdHistogramBucketCount; i++) {
+        histogram->counts[i] += other->counts[i];
+    }
+}
+
+uint64_t AdHistogramValueAtPercentile(const AdHistogram *histogram, double percentile)
+{
+    uint64_t rank, seen = 0;
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+    if (percentile <= 0) {
+        return histogram->min;
+    }
+    rank = (uint64_t)(percentile / 100 * histogram->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (uint32_t i = 0; i < kAdHistogramBucketCount; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t value = AdHistogramBucketHighestValue(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double AdHistogramMean(const AdHistogram *histogram)
+{
+    return histogram->count ? (double)histogram->sum / histogram->count : 0;
+}
+
+// Encoding
+
+static size_t AdHistogramWriteVarint(uint8_t *buffer, uint64_t value)
+{
+    size_t length = 0;
+
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+static size_t AdHistogramReadVarint(const uint8_t *bytes, size_t length, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < length && i < 10; i++) {
+        result |= (uint64_t)(bytes[i] & 0x7f) << (7 * i);
+        if ((bytes[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t AdHistogramEncode(const AdHistogram *histogram, uint8_t *buffer)
+{
+    size_t length = 0;
+    uint64_t buckets = 0;
+    uint32_t next = 0;
+
+    for (uint32_t i = 0; i < kAdHistogramBucketCount; i++) {
+        buckets += histogram->counts[i] != 0;
+    }
+    length += AdHistogramWriteVarint(buffer + length, buckets);
+    length += AdHistogramWriteVarint(buffer + length, histogram->min);
+    length += AdHistogramWriteVarint(buffer + length, histogram->max);
+    length += AdHistogramWriteVarint(buffer + length, histogram->sum);
+
+    // Each bucket as the number of empty buckets skipped since the previous one, and its count.
+    for (uint32_t i = 0; i < kAdHistogramBucketCount; i++) {
+        if (histogram->counts[i]) {
+            length += AdHistogramWriteVarint(buffer + length, i - next);
+            length += AdHistogramWriteVarint(buffer + length, histogram->counts[i]);
+            next = i + 1;
+        }
+    }
+    return length;
+}
+
+size_t AdHistogramDecode(AdHistogram *histogram, const uint8_t *bytes, size_t length)
+{
+    uint64_t header[4], skipped, count;
+    size_t offset = 0, used;
+    uint64_t next = 0;
+
+    AdHistogramInit(histogram);
+    for (int i = 0; i < 4; i++) {
+        used = AdHistogramReadVarint(bytes + offset, length - offset, &header[i]);
+        if (used == 0) {
+            return 0;
+        }
+        offset += used;
+    }
+    if (header[0] > kAdHistogramBucketCount) {
+        return 0;
+    }
+    for (uint64_t bucket = 0; bucket < header[0]; bucket++) {
+        used = AdHistogramReadVarint(bytes + offset, length - offset, &skipped);
+        if (used == 0 || skipped >= kAdHistogramBucketCount - next) {
+            return 0;
+        }
+        offset += used;
+        used = AdHistogramReadVarint(bytes + offset, length - offset, &count);
+        if (used == 0 || count > UINT32_MAX) {
+            return 0;
+        }
+        offset += used;
+        next += skipped;
+        histogram->counts[next] = (uint32_t)count;
+        histogram->count += count;
+        next++;
+    }
+    histogram->min = header[1];
+    histogram->max = header[2];
+    histogram->sum = header[3];
+    return offset;
+}
@@ -0,0 +1,63 @@
+//
+//  AdHistogram.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Fixed size latency histogram with log-linear buckets, in the manner of HdrHistogram.
+
+ Values below 64 have a bucket each. Above, every power of two is split in 32 buckets, so a
+ recorded value is known within 1/32 (about 3%) whatever its magnitude. Values are meant to be
+ microseconds and are clamped to kAdHistogramMaxValue (about 19 hours).
+
+ Recording is O(1) and allocation free. A histogram encodes to a few dozen bytes, only the
+ non empty buckets are written, as varints.
+
+ This file is plain C. A histogram is not thread safe, callers serialize access.
+ */
+
+#ifndef DemoSmart_AdHistogram_h
+#define DemoSmart_AdHistogram_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdHistogramSubBucketBits   5
+#define kAdHistogramMaxValueBits    36
+#define kAdHistogramMaxValue        ((UINT64_C(1) << kAdHistogramMaxValueBits) - 1)
+#define kAdHistogramBucketCount     ((kAdHistogramMaxValueBits - kAdHistogramSubBucketBits + 1) << kAdHistogramSubBucketBits)
+
+/** Enough for any histogram: the header varints and one (delta, count) pair per bucket. */
+#define kAdHistogramMaxEncodedLength (4 * 10 + kAdHistogramBucketCount * (2 + 5))
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint32_t counts[kAdHistogramBucketCount];
+} AdHistogram;
+
+void AdHistogramInit(AdHistogram *histogram);
+
+void AdHistogramRecord(AdHistogram *histogram, uint64_t value);
+
+/** Adds the counts of a histogram to another. */
+void AdHistogramMerge(AdHistogram *histogram, const AdHistogram *other);
+
+/** The smallest value such that percentile % of the recorded values are below or equal to it,
+ within the precision of the buckets. 0 for an empty histogram. */
+uint64_t AdHistogramValueAtPercentile(const AdHistogram *histogram, double percentile);
+
+double AdHistogramMean(const AdHistogram *histogram);
+
+/** Encodes the histogram in buffer, which needs kAdHistogramMaxEncodedLength bytes at most. Returns the encoded length. */
+size_t AdHistogramEncode(const AdHistogram *histogram, uint8_t *buffer);
+
+/** Decodes a histogram written by AdHistogramEncode. Returns the number of bytes read, or 0 if the bytes are damaged. */
+size_t AdHistogramDecode(AdHistogram *histogram, const uint8_t *bytes, size_t length);
+
+#endif
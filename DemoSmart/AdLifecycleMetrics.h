@@ -0,0 +1,77 @@
+//
+//  AdLifecycleMetrics.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SASAdView.h"
+#import "AdHistogram.h"
+
+typedef enum {
+    AdLifecyclePhaseRequestToDownload,      // ad call until adView:didDownloadAdData:
+    AdLifecyclePhaseDownloadToDisplay,      // ad data until adViewDidLoad:
+    AdLifecyclePhaseDisplayToDismiss,       // adViewDidLoad: until adViewDidDisappear:
+    AdLifecyclePhaseRequestToFailure,       // ad call until adView:didFailToLoadWithError:
+    AdLifecyclePhaseExpanded,               // adView:didExpandWithFrame: until adView:didCloseExpandWithFrame:
+    AdLifecyclePhaseResized,                // adView:didResizeWithFrame: until adView:didCloseResizeWithFrame:
+    AdLifecyclePhaseCount
+} AdLifecyclePhase;
+
+/**
+ Latency histograms of the ad lifecycle, per placement (formatId, pageId) and phase.
+
+ Every ad view is timestamped when its ad call starts and at each delegate callback, and the time
+ spent between two transitions is recorded in microseconds in an AdHistogram. The delegate of the
+ ad views forwards its callbacks to the matching methods below.
+
+ snapshot returns every histogram as a compact binary property list, to be sent with the other
+ app statistics. summaryOfSnapshot: turns one back into p50 / p90 / p99 values.
+ All methods are thread safe.
+ */
+
+@interface AdLifecycleMetrics : NSObject
+
++ (AdLifecycleMetrics *)sharedMetrics;
+
+/** Starts the lifecycle of an ad view, called when its ad call leaves.
+
+ */
+
+- (void)adView:(SASAdView *)adView didStartLoadingFormatId:(NSInteger)formatId pageId:(NSString *)pageId;
+
+- (void)adViewDidDownloadAdData:(SASAdView *)adView;
+- (void)adViewDidLoad:(SASAdView *)adView;
+- (void)adViewDidFailToLoad:(SASAdView *)adView;
+- (void)adViewDidDisappear:(SASAdView *)adView;
+- (void)adViewDidExpand:(SASAdView *)adView;
+- (void)adViewDidCloseExpand:(SASAdView *)adView;
+- (void)adViewDidResize:(SASAdView *)adView;
+- (void)adViewDidCloseResize:(SASAdView *)adView;
+
+/** Copies the histogram of a placement and phase. Returns NO if nothing was recorded for it.
+
+ */
+
+- (BOOL)getHistogram:(AdHistogram *)histogram formatId:(NSInteger)formatId pageId:(NSString *)pageId phase:(AdLifecyclePhase)phase;
+
+/** The histograms recorded since launch or the last reset, encoded as a binary property list.
+
+ */
+
+- (NSData *)snapshot;
+
+/** Decodes a snapshot to a dictionary keyed by "formatId/pageId/phase", with "count", "p50", "p90", "p99" and "max" in milliseconds.
+
+ */
+
++ (NSDictionary *)summaryOfSnapshot:(NSData *)snapshot;
+
+- (void)reset;
+
+@end
+
+extern NSString * const AdLifecyclePhaseNames[AdLifecyclePhaseCount];
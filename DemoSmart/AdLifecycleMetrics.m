@@ -0,0 +1,240 @@
+//
+//  AdLifecycleMetrics.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdLifecycleMetrics.h"
+
+static const NSInteger kAdLifecycleSnapshotVersion = 1;
+
+NSString * const AdLifecyclePhaseNames[AdLifecyclePhaseCount] = {
+    @"requestToDownload",
+    @"downloadToDisplay",
+    @"displayToDismiss",
+    @"requestToFailure",
+    @"expanded",
+    @"resized",
+};
+
+@interface AdLifecycleState : NSObject
+
+@property (nonatomic, assign) NSInteger formatId;
+@property (nonatomic, copy) NSString *pageId;
+@property (nonatomic, assign) CFAbsoluteTime requestTime;
+@property (nonatomic, assign) CFAbsoluteTime downloadTime;
+@property (nonatomic, assign) CFAbsoluteTime displayTime;
+@property (nonatomic, assign) CFAbsoluteTime expandTime;
+@property (nonatomic, assign) CFAbsoluteTime resizeTime;
+
+@end
+
+@implementation AdLifecycleState
+
+@end
+
+@implementation AdLifecycleMetrics
+{
+    NSMapTable *_states;                // SASAdView (weak) -> AdLifecycleState
+    NSMutableDictionary *_histograms;   // "formatId/pageId/phase" -> NSMutableData holding an AdHistogram
+}
+
++ (AdLifecycleMetrics *)sharedMetrics
+{
+    static AdLifecycleMetrics *sharedMetrics = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedMetrics = [[AdLifecycleMetrics alloc] init];
+    });
+    return sharedMetrics;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _states = [NSMapTable weakToStrongObjectsMapTable];
+        _histograms = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - Transitions
+
+- (void)adView:(SASAdView *)adView didStartLoadingFormatId:(NSInteger)formatId pageId:(NSString *)pageId
+{
+    AdLifecycleState *state = [[AdLifecycleState alloc] init];
+
+    state.formatId = formatId;
+    state.pageId = pageId ?: @"";
+    state.requestTime = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        [_states setObject:state forKey:adView];
+    }
+}
+
+/** Records the time since a previous transition, if that transition happened, for the placement of the view. */
+- (void)recordPhase:(AdLifecyclePhase)phase since:(CFAbsoluteTime)start state:(AdLifecycleState *)state now:(CFAbsoluteTime)now
+{
+    NSString *key;
+    NSMutableData *histogram;
+
+    if (start == 0 || now < start) {
+        return;
+    }
+    key = [NSString stringWithFormat:@"%ld/%@/%@", (long)state.formatId, state.pageId, AdLifecyclePhaseNames[phase]];
+    histogram = _histograms[key];
+    if (histogram == nil) {
+        histogram = [NSMutableData dataWithLength:sizeof(AdHistogram)];
+        AdHistogramInit([histogram mutableBytes]);
+        _histograms[key] = histogram;
+    }
+    AdHistogramRecord([histogram mutableBytes], (uint64_t)((now - start) * 1e6));
+}
+
+- (void)adViewDidDownloadAdData:(SASAdView *)adView
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        [self recordPhase:AdLifecyclePhaseRequestToDownload since:state.requestTime state:state now:now];
+        state.downloadTime = now;
+    }
+}
+
+- (void)adViewDidLoad:(SASAdView *)adView
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        [self recordPhase:AdLifecyclePhaseDownloadToDisplay since:state.downloadTime state:state now:now];
+        state.displayTime = now;
+    }
+}
+
+- (void)adViewDidFailToLoad:(SASAdView *)adView
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        [self recordPhase:AdLifecyclePhaseRequestToFailure since:state.requestTime state:state now:now];
+        [_states removeObjectForKey:adView];
+    }
+}
+
+- (void)adViewDidDisappear:(SASAdView *)adView
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        [self recordPhase:AdLifecyclePhaseDisplayToDismiss since:state.displayTime state:state now:now];
+        [_states removeObjectForKey:adView];
+    }
+}
+
+- (void)adViewDidExpand:(SASAdView *)adView
+{
+    @synchronized(self) {
+        [[_states objectForKey:adView] setExpandTime:CFAbsoluteTimeGetCurrent()];
+    }
+}
+
+- (void)adViewDidCloseExpand:(SASAdView *)adView
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        [self recordPhase:AdLifecyclePhaseExpanded since:state.expandTime state:state now:now];
+        state.expandTime = 0;
+    }
+}
+
+- (void)adViewDidResize:(SASAdView *)adView
+{
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        // Resizing again before closing keeps the time of the first resize.
+        if (state.resizeTime == 0) {
+            state.resizeTime = CFAbsoluteTimeGetCurrent();
+        }
+    }
+}
+
+- (void)adViewDidCloseResize:(SASAdView *)adView
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized(self) {
+        AdLifecycleState *state = [_states objectForKey:adView];
+        [self recordPhase:AdLifecyclePhaseResized since:state.resizeTime state:state now:now];
+        state.resizeTime = 0;
+    }
+}
+
+#pragma mark - Export
+
+- (BOOL)getHistogram:(AdHistogram *)histogram formatId:(NSInteger)formatId pageId:(NSString *)pageId phase:(AdLifecyclePhase)phase
+{
+    NSString *key = [NSString stringWithFormat:@"%ld/%@/%@", (long)formatId, pageId ?: @"", AdLifecyclePhaseNames[phase]];
+    @synchronized(self) {
+        NSData *data = _histograms[key];
+        if (data == nil) {
+            return NO;
+        }
+        memcpy(histogram, [data bytes], sizeof(AdHistogram));
+        return YES;
+    }
+}
+
+- (NSData *)snapshot
+{
+    NSMutableDictionary *histograms = [NSMutableDictionary dictionary];
+    uint8_t *buffer = malloc(kAdHistogramMaxEncodedLength);
+
+    @synchronized(self) {
+        [_histograms enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSData *histogram, BOOL *stop) {
+            size_t length = AdHistogramEncode([histogram bytes], buffer);
+            histograms[key] = [NSData dataWithBytes:buffer length:length];
+        }];
+    }
+    free(buffer);
+
+    return [NSPropertyListSerialization dataWithPropertyList:@{ @"version": @(kAdLifecycleSnapshotVersion),
+                                                                @"date": [NSDate date],
+                                                                @"histograms": histograms }
+                                                      format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+}
+
++ (NSDictionary *)summaryOfSnapshot:(NSData *)snapshot
+{
+    NSDictionary *plist = [NSPropertyListSerialization propertyListWithData:snapshot options:NSPropertyListImmutable format:NULL error:NULL];
+    NSMutableDictionary *summary = [NSMutableDictionary dictionary];
+    AdHistogram *histogram;
+
+    if (![plist isKindOfClass:[NSDictionary class]] || [plist[@"version"] integerValue] != kAdLifecycleSnapshotVersion) {
+        return nil;
+    }
+    histogram = malloc(sizeof(AdHistogram));
+    [plist[@"histograms"] enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSData *data, BOOL *stop) {
+        if (![data isKindOfClass:[NSData class]] || AdHistogramDecode(histogram, [data bytes], [data length]) == 0) {
+            return;
+        }
+        summary[key] = @{ @"count": @(histogram->count),
+                          @"p50": @(AdHistogramValueAtPercentile(histogram, 50) / 1e3),
+                          @"p90": @(AdHistogramValueAtPercentile(histogram, 90) / 1e3),
+                          @"p99": @(AdHistogramValueAtPercentile(histogram, 99) / 1e3),
+                          @"max": @(histogram->max / 1e3) };
+    }];
+    free(histogram);
+    return summary;
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        [_histograms removeAllObjects];
+    }
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  AdLocalizedStrings.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "AdStringTable.h"
+
+/**
+ The strings of sas.bundle for the prompts of the app, from the tables compiled at build time.
+
+ The "Compile string tables" build phase writes a Localizable.adstrings next to each
+ Localizable.strings of the built sas.bundle (see tools/adstrings.c). The tables are mapped once,
+ in the order of the user's preferred languages then English, and a string is looked up in the
+ first table that has it, without parsing a .strings file:
+
+    NSString *title = [[AdLocalizedStrings sharedStrings] stringForKey:@"Leave Application?"];
+
+ When the tables are missing, a build without the phase, the strings are read from sas.bundle by
+ NSBundle. The strings can be looked up from any thread.
+ */
+
+@interface AdLocalizedStrings : NSObject
+
++ (AdLocalizedStrings *)sharedStrings;
+
+/** Maps the tables at the paths, looked up in their order. Missing or invalid ones are skipped.
+
+ */
+
+- (id)initWithTablePaths:(NSArray *)paths;
+
+/** The localizations of the tables, in lookup order.
+
+ */
+
+@property (nonatomic, readonly) NSArray *localizations;
+
+/** The string for the key, the key itself when no table has it.
+
+ */
+
+- (NSString *)stringForKey:(NSString *)key;
+
+/** The string for the key, NUL terminated and valid as long as the object, or NULL. Allocates nothing.
+
+ */
+
+- (const char *)UTF8StringForKey:(const char *)key;
+
+@end
@@ -0,0 +1,110 @@
+//
+//  AdLocalizedStrings.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdLocalizedStrings.h"
+
+#include <errno.h>
+#include <string.h>
+
+static NSString *const kAdStringsBundleName = @"sas.bundle";
+static NSString *const kAdStringsTableName = @"Localizable.adstrings";
+static NSString *const kAdStringsFallbackLocalization = @"en";
+
+@implementation AdLocalizedStrings
+{
+    AdStringTable **_tables;
+    NSUInteger _tableCount;
+    NSBundle *_fallbackBundle;      // sas.bundle, when no table could be mapped
+}
+
++ (AdLocalizedStrings *)sharedStrings
+{
+    static AdLocalizedStrings *sharedStrings = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *directory = [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:kAdStringsBundleName];
+        NSMutableArray *available = [NSMutableArray array];
+        NSMutableArray *localizations, *paths = [NSMutableArray array];
+
+        for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:NULL]) {
+            if ([[name pathExtension] isEqualToString:@"lproj"]
+                && [[NSFileManager defaultManager] fileExistsAtPath:[[directory stringByAppendingPathComponent:name] stringByAppendingPathComponent:kAdStringsTableName]]) {
+                [available addObject:[name stringByDeletingPathExtension]];
+            }
+        }
+        localizations = [[NSBundle preferredLocalizationsFromArray:available forPreferences:[NSLocale preferredLanguages]] mutableCopy];
+        if (![localizations containsObject:kAdStringsFallbackLocalization] && [available containsObject:kAdStringsFallbackLocalization]) {
+            [localizations addObject:kAdStringsFallbackLocalization];
+        }
+        for (NSString *localization in localizations) {
+            [paths addObject:[[directory stringByAppendingPathComponent:[localization stringByAppendingPathExtension:@"lproj"]]
+                              stringByAppendingPathComponent:kAdStringsTableName]];
+        }
+        sharedStrings = [[AdLocalizedStrings alloc] initWithTablePaths:paths];
+        if (sharedStrings->_tableCount == 0) {
+            sharedStrings->_fallbackBundle = [NSBundle bundleWithPath:directory];
+        }
+    });
+    return sharedStrings;
+}
+
+- (id)initWithTablePaths:(NSArray *)paths
+{
+    self = [super init];
+    if (self) {
+        NSMutableArray *localizations = [NSMutableArray array];
+
+        _tables = calloc([paths count] + 1, sizeof(AdStringTable *));
+        if (_tables == NULL) {
+            return nil;
+        }
+        for (NSString *path in paths) {
+            AdStringTable *table = AdStringTableOpen([path fileSystemRepresentation]);
+
+            if (table == NULL) {
+                NSLog(@"AdLocalizedStrings: cannot open %@: %s", path, strerror(errno));
+                continue;
+            }
+            _tables[_tableCount++] = table;
+            [localizations addObject:[[[path stringByDeletingLastPathComponent] lastPathComponent] stringByDeletingPathExtension]];
+        }
+        _localizations = [localizations copy];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for (NSUInteger i = 0; i < _tableCount; i++) {
+        AdStringTableClose(_tables[i]);
+    }
+    free(_tables);
+}
+
+- (const char *)UTF8StringForKey:(const char *)key
+{
+    return AdStringTableLookupInTables((const AdStringTable *const *)_tables, _tableCount, key, strlen(key), NULL);
+}
+
+- (NSString *)stringForKey:(NSString *)key
+{
+    const char *UTF8Key = [key UTF8String];
+    const char *value;
+    size_t length;
+
+    if (_fallbackBundle) {
+        return [_fallbackBundle localizedStringForKey:key value:key table:nil];
+    }
+    value = UTF8Key ? AdStringTableLookupInTables((const AdStringTable *const *)_tables, _tableCount, UTF8Key, strlen(UTF8Key), &length) : NULL;
+    if (value == NULL) {
+        return key;
+    }
+    return [[NSString alloc] initWithBytes:value length:length encoding:NSUTF8StringEncoding];
+}
+
+@end
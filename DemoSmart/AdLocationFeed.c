@@ -0,0 +1,270 @@
+//
+//  AdLocationFeed.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdLocationFeed.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kAdLocationEarthRadius      6371008.8   /* meters, mean */
+#define kAdLocationMetersPerDegree  111320.0    /* along a meridian */
+#define kAdLocationSnapshotWords    (sizeof(AdLocationSnapshot) / sizeof(uint64_t))
+
+const AdLocationFeedConfiguration AdLocationFeedDefaultConfiguration = { 3, 1, 100, 10, 1 };
+
+struct AdLocationFeed {
+    AdLocationFeedConfiguration configuration;
+    double step;                        /* degrees between two quantized coordinates */
+    AdLocationSnapshot published;       /* the writer's copy */
+    int hasPublished;
+    int hasPendingLocation;
+    int hasPendingHeading;
+    double pendingLatitude;
+    double pendingLongitude;
+    double pendingAccuracy;
+    double pendingHeading;
+    AdLocationFeedStatistics statistics;
+
+    // Read by any thread: odd while the words are being written.
+    uint64_t sequence;
+    uint64_t words[kAdLocationSnapshotWords];
+};
+
+// Snapshot
+
+/** Writes the snapshot under the sequence counter. There is a single writer, the sequence is its own. */
+static void AdLocationFeedPublishSnapshot(AdLocationFeed *feed, const AdLocationSnapshot *snapshot)
+{
+    uint64_t words[kAdLocationSnapshotWords];
+    uint64_t sequence = feed->sequence;
+
+    memcpy(words, snapshot, sizeof(words));
+    __atomic_store_n(&feed->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < kAdLocationSnapshotWords; i++) {
+        __atomic_store_n(&feed->words[i], words[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&feed->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void AdLocationFeedRead(const AdLocationFeed *feed, AdLocationSnapshot *snapshot)
+{
+    uint64_t words[kAdLocationSnapshotWords];
+    uint64_t before, after;
+
+    do {
+        before = __atomic_load_n(&feed->sequence, __ATOMIC_ACQUIRE);
+        for (size_t i = 0; i < kAdLocationSnapshotWords; i++) {
+            words[i] = __atomic_load_n(&feed->words[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&feed->sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) != 0 || before != after);
+    memcpy(snapshot, words, sizeof(words));
+}
+
+uint64_t AdLocationFeedGetVersion(const AdLocationFeed *feed)
+{
+    // While a snapshot is written the sequence is odd, and still gives the previous version.
+    return __atomic_load_n(&feed->sequence, __ATOMIC_ACQUIRE) / 2;
+}
+
+// Quantization
+
+static double AdLocationQuantize(double value, double step)
+{
+    return round(value / step) * step;
+}
+
+static double AdLocationDistance(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+    double radians = M_PI / 180;
+    double sinLatitude = sin((latitude2 - latitude1) * radians / 2);
+    double sinLongitude = sin((longitude2 - longitude1) * radians / 2);
+    double a = sinLatitude * sinLatitude + cos(latitude1 * radians) * cos(latitude2 * radians) * sinLongitude * sinLongitude;
+
+    return 2 * kAdLocationEarthRadius * asin(fmin(1, sqrt(a)));
+}
+
+static double AdLocationAngle(double heading1, double heading2)
+{
+    double angle = fabs(heading1 - heading2);
+
+    return angle > 180 ? 360 - angle : angle;
+}
+
+// Feed
+
+AdLocationFeed *AdLocationFeedCreate(const AdLocationFeedConfiguration *configuration)
+{
+    AdLocationFeed *feed;
+
+    if (configuration == NULL) {
+        configuration = &AdLocationFeedDefaultConfiguration;
+    }
+    if (configuration->coordinateDecimals < 0 || configuration->coordinateDecimals > 6
+        || !(configuration->headingResolution > 0 && configuration->headingResolution <= 90)
+        || !(configuration->minimumDistance >= 0 && isfinite(configuration->minimumDistance))
+        || !(configuration->minimumHeadingChange >= 0 && configuration->minimumHeadingChange <= 180)
+        || !(configuration->maximumRate >= 0 && isfinite(configuration->maximumRate))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    feed = calloc(1, sizeof(AdLocationFeed));
+    if (feed == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    feed->configuration = *configuration;
+    feed->step = pow(10, -configuration->coordinateDecimals);
+    feed->published.heading = -1;
+    // Version 0, nobody reads the feed yet.
+    memcpy(feed->words, &feed->published, sizeof(feed->words));
+    return feed;
+}
+
+void AdLocationFeedRelease(AdLocationFeed *feed)
+{
+    free(feed);
+}
+
+/** The earliest time of the next publication. */
+static double AdLocationFeedNextPublication(const AdLocationFeed *feed)
+{
+    if (!feed->hasPublished || feed->configuration.maximumRate == 0) {
+        return -INFINITY;
+    }
+    return feed->published.timestamp + 1 / feed->configuration.maximumRate;
+}
+
+static void AdLocationFeedPublishPending(AdLocationFeed *feed, double now)
+{
+    AdLocationSnapshot *snapshot = &feed->published;
+
+    if (feed->hasPendingLocation) {
+        snapshot->hasLocation = 1;
+        snapshot->latitude = feed->pendingLatitude;
+        snapshot->longitude = feed->pendingLongitude;
+        snapshot->accuracy = feed->pendingAccuracy;
+        feed->statistics.forwarded++;
+    }
+    if (feed->hasPendingHeading) {
+        snapshot->heading = feed->pendingHeading;
+        feed->statistics.forwarded++;
+    }
+    feed->hasPendingLocation = 0;
+    feed->hasPendingHeading = 0;
+    snapshot->version++;
+    snapshot->timestamp = now;
+    feed->hasPublished = 1;
+    feed->statistics.snapshots++;
+    AdLocationFeedPublishSnapshot(feed, snapshot);
+}
+
+/** Publishes the pending updates now, or leaves them for the deadline. */
+static int AdLocationFeedPublishOrDefer(AdLocationFeed *feed, double now)
+{
+    if (now < AdLocationFeedNextPublication(feed)) {
+        return 0;
+    }
+    AdLocationFeedPublishPending(feed, now);
+    return 1;
+}
+
+int AdLocationFeedUpdateLocation(AdLocationFeed *feed, double latitude, double longitude, double accuracy, double now)
+{
+    const AdLocationSnapshot *published = &feed->published;
+    double quantizedLatitude, quantizedLongitude;
+    uint64_t *suppressed = NULL;
+
+    feed->statistics.locationUpdates++;
+    if (!(fabs(latitude) <= 90 && fabs(longitude) <= 180 && accuracy >= 0 && isfinite(accuracy) && isfinite(now))) {
+        feed->statistics.invalid++;
+        errno = EINVAL;
+        return -1;
+    }
+    quantizedLatitude = AdLocationQuantize(latitude, feed->step);
+    quantizedLongitude = AdLocationQuantize(longitude, feed->step);
+    if (published->hasLocation && quantizedLatitude == published->latitude && quantizedLongitude == published->longitude) {
+        suppressed = &feed->statistics.suppressedQuantized;
+    } else if (published->hasLocation
+               && AdLocationDistance(published->latitude, published->longitude, quantizedLatitude, quantizedLongitude) < feed->configuration.minimumDistance) {
+        suppressed = &feed->statistics.suppressedDistance;
+    }
+
+    // A deferred fix is outdated either way: by this one, or by the published one this one is back to.
+    if (feed->hasPendingLocation) {
+        feed->statistics.suppressedRate++;
+        feed->hasPendingLocation = 0;
+    }
+    if (suppressed) {
+        (*suppressed)++;
+        return 0;
+    }
+    feed->hasPendingLocation = 1;
+    feed->pendingLatitude = quantizedLatitude;
+    feed->pendingLongitude = quantizedLongitude;
+    // Half the diagonal of a quantization cell, at most.
+    feed->pendingAccuracy = fmax(accuracy, feed->step * kAdLocationMetersPerDegree * M_SQRT1_2);
+    return AdLocationFeedPublishOrDefer(feed, now);
+}
+
+int AdLocationFeedUpdateHeading(AdLocationFeed *feed, double heading, double now)
+{
+    const AdLocationSnapshot *published = &feed->published;
+    double quantized;
+    uint64_t *suppressed = NULL;
+
+    feed->statistics.headingUpdates++;
+    if (!(heading >= 0 && heading <= 360 && isfinite(now))) {
+        feed->statistics.invalid++;
+        errno = EINVAL;
+        return -1;
+    }
+    quantized = fmod(AdLocationQuantize(heading, feed->configuration.headingResolution), 360);
+    if (published->heading >= 0 && quantized == published->heading) {
+        suppressed = &feed->statistics.suppressedQuantized;
+    } else if (published->heading >= 0 && AdLocationAngle(published->heading, quantized) < feed->configuration.minimumHeadingChange) {
+        suppressed = &feed->statistics.suppressedHeading;
+    }
+
+    if (feed->hasPendingHeading) {
+        feed->statistics.suppressedRate++;
+        feed->hasPendingHeading = 0;
+    }
+    if (suppressed) {
+        (*suppressed)++;
+        return 0;
+    }
+    feed->hasPendingHeading = 1;
+    feed->pendingHeading = quantized;
+    return AdLocationFeedPublishOrDefer(feed, now);
+}
+
+int AdLocationFeedPoll(AdLocationFeed *feed, double now)
+{
+    if (!feed->hasPendingLocation && !feed->hasPendingHeading) {
+        return 0;
+    }
+    return AdLocationFeedPublishOrDefer(feed, now);
+}
+
+double AdLocationFeedGetDeadline(const AdLocationFeed *feed)
+{
+    if (!feed->hasPendingLocation && !feed->hasPendingHeading) {
+        return 0;
+    }
+    return AdLocationFeedNextPublication(feed);
+}
+
+void AdLocationFeedGetStatistics(const AdLocationFeed *feed, AdLocationFeedStatistics *statistics)
+{
+    *statistics = feed->statistics;
+}
@@ -0,0 +1,102 @@
+//
+//  AdLocationFeed.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Location stage between CoreLocation and the ad layer.
+
+ CoreLocation delivers fixes and headings many times per second, each slightly different from the
+ previous one, while ad targeting only uses a coarse position. Every update pushed to the SDK may
+ rebuild the ad requests for nothing. The feed keeps only the updates that matter:
+
+ - coordinates are rounded to coordinateDecimals decimal places (3 by default, about 110 m), the
+   precision used for targeting, and headings to headingResolution degrees;
+ - a position closer than minimumDistance meters to the published one, or a heading less than
+   minimumHeadingChange degrees away from it, is suppressed;
+ - at most maximumRate snapshots are published per second. An update arriving sooner is deferred
+   to the deadline returned by AdLocationFeedGetDeadline rather than dropped, a later one
+   replacing it, so the last position is always published in the end.
+
+ A published snapshot is versioned, and readable from any thread without a lock: it is written
+ under a sequence counter that readers check before and after their copy, retrying when it moved.
+
+ This file is plain C. Updates, polls and statistics come from one thread at a time, the callers
+ serialize them; AdLocationFeedRead and AdLocationFeedGetVersion may be called from any thread.
+ */
+
+#ifndef DemoSmart_AdLocationFeed_h
+#define DemoSmart_AdLocationFeed_h
+
+#include <stdint.h>
+
+typedef struct {
+    int coordinateDecimals;         /* 0 to 6 */
+    double headingResolution;       /* degrees */
+    double minimumDistance;         /* meters */
+    double minimumHeadingChange;    /* degrees */
+    double maximumRate;             /* snapshots per second, 0 for no limit */
+} AdLocationFeedConfiguration;
+
+/** 3 decimals, headings to the degree, 100 m, 10 degrees and a snapshot per second. */
+extern const AdLocationFeedConfiguration AdLocationFeedDefaultConfiguration;
+
+typedef struct {
+    uint64_t version;       /* 0 until the first publication, then one more at each */
+    double latitude;        /* quantized */
+    double longitude;
+    double accuracy;        /* meters, at least the error of the quantization */
+    double heading;         /* quantized degrees from the north, -1 when unknown */
+    double timestamp;       /* of the publication, on the clock of the updates */
+    int hasLocation;
+} AdLocationSnapshot;
+
+/** Every update ends up forwarded or in one of the suppressed counters, but the ones still deferred. */
+typedef struct {
+    uint64_t locationUpdates;
+    uint64_t headingUpdates;
+    uint64_t snapshots;             /* published, a location and a heading may share one */
+    uint64_t forwarded;             /* updates in a snapshot */
+    uint64_t suppressedQuantized;   /* same value as published once rounded */
+    uint64_t suppressedDistance;    /* closer than minimumDistance */
+    uint64_t suppressedHeading;     /* turned less than minimumHeadingChange */
+    uint64_t suppressedRate;        /* deferred then replaced by a later update */
+    uint64_t invalid;               /* out of range, or a negative accuracy */
+} AdLocationFeedStatistics;
+
+typedef struct AdLocationFeed AdLocationFeed;
+
+/** Returns NULL with errno set to EINVAL for a bad configuration, ENOMEM when out of memory. NULL uses the default configuration. */
+AdLocationFeed *AdLocationFeedCreate(const AdLocationFeedConfiguration *configuration);
+
+/** No thread may still be reading the feed. */
+void AdLocationFeedRelease(AdLocationFeed *feed);
+
+/** A fix, with its horizontal accuracy in meters, at now seconds.
+
+ Returns 1 when a snapshot was published, 0 when the fix was suppressed or deferred, -1 with
+ errno set to EINVAL when it is invalid.
+ */
+int AdLocationFeedUpdateLocation(AdLocationFeed *feed, double latitude, double longitude, double accuracy, double now);
+
+/** A heading in degrees from the north, at now seconds. Returns as AdLocationFeedUpdateLocation. */
+int AdLocationFeedUpdateHeading(AdLocationFeed *feed, double heading, double now);
+
+/** Publishes the deferred update when its deadline has come. Returns 1 when a snapshot was published. */
+int AdLocationFeedPoll(AdLocationFeed *feed, double now);
+
+/** When to poll for the deferred update, or 0 when there is none. */
+double AdLocationFeedGetDeadline(const AdLocationFeed *feed);
+
+/** Copies the last published snapshot. Lock free, from any thread. */
+void AdLocationFeedRead(const AdLocationFeed *feed, AdLocationSnapshot *snapshot);
+
+/** The version of the last published snapshot, to tell cheaply whether it changed. From any thread. */
+uint64_t AdLocationFeedGetVersion(const AdLocationFeed *feed);
+
+void AdLocationFeedGetStatistics(const AdLocationFeed *feed, AdLocationFeedStatistics *statistics);
+
+#endif
@@ -0,0 +1,56 @@
+//
+//  AdLocationForwarder.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+#import "AdLocationFeed.h"
+
+/**
+ Forwards the updates of CoreLocation to the SDK through an AdLocationFeed.
+
+ The SDK asks for +[SASAdView setLocation:] and +setHeading: to be called as often as possible,
+ and every call may rebuild the ad requests. The forwarder passes on only the updates the feed
+ publishes: quantized to the targeting precision, past the distance and angle thresholds, and at
+ most once per second. A deferred update is forwarded at its deadline. In a CLLocationManagerDelegate:
+
+    - (void)locationManager:(CLLocationManager *)manager didUpdateLocations:(NSArray *)locations {
+        [[AdLocationForwarder sharedForwarder] setLocation:[locations lastObject]];
+    }
+
+ The heading goes through +[AdMRAIDBridge setHeading:], to the SDK and the batched bridges.
+ Use the forwarder from the main thread; its snapshot can be read from any thread.
+ */
+
+@interface AdLocationForwarder : NSObject
+
++ (AdLocationForwarder *)sharedForwarder;
+
+/** Uses the configuration for its feed, AdLocationFeedDefaultConfiguration for the shared forwarder.
+
+ */
+
+- (id)initWithConfiguration:(const AdLocationFeedConfiguration *)configuration;
+
+- (void)setLocation:(CLLocation *)location;
+
+/** A heading in degrees from the north, negative ones (invalid for CoreLocation) are ignored.
+
+ */
+
+- (void)setHeading:(CLLocationDirection)heading;
+
+/** The last forwarded location and heading, without a lock.
+
+ */
+
+- (AdLocationSnapshot)snapshot;
+
+- (AdLocationFeedStatistics)statistics;
+
+@end
@@ -0,0 +1,138 @@
+//
+//  AdLocationForwarder.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdLocationForwarder.h"
+#import "AdMRAIDBridge.h"
+#import "SASAdView.h"
+
+@implementation AdLocationForwarder
+{
+    AdLocationFeed *_feed;
+    AdLocationSnapshot _forwarded;      // the snapshot last passed to the SDK
+    CLLocation *_lastLocation;          // for the altitude and the date of the forwarded one
+    BOOL _pollScheduled;
+}
+
++ (AdLocationForwarder *)sharedForwarder
+{
+    static AdLocationForwarder *sharedForwarder = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedForwarder = [[AdLocationForwarder alloc] initWithConfiguration:&AdLocationFeedDefaultConfiguration];
+    });
+    return sharedForwarder;
+}
+
+- (id)init
+{
+    return [self initWithConfiguration:&AdLocationFeedDefaultConfiguration];
+}
+
+- (id)initWithConfiguration:(const AdLocationFeedConfiguration *)configuration
+{
+    self = [super init];
+    if (self) {
+        _feed = AdLocationFeedCreate(configuration);
+        if (_feed == NULL) {
+            return nil;
+        }
+        AdLocationFeedRead(_feed, &_forwarded);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    AdLocationFeedRelease(_feed);
+}
+
+- (void)setLocation:(CLLocation *)location
+{
+    if (location == nil) {
+        return;
+    }
+    _lastLocation = location;
+    [self didUpdate:AdLocationFeedUpdateLocation(_feed, location.coordinate.latitude, location.coordinate.longitude,
+                                                 location.horizontalAccuracy, CFAbsoluteTimeGetCurrent())];
+}
+
+- (void)setHeading:(CLLocationDirection)heading
+{
+    [self didUpdate:AdLocationFeedUpdateHeading(_feed, heading, CFAbsoluteTimeGetCurrent())];
+}
+
+- (AdLocationSnapshot)snapshot
+{
+    AdLocationSnapshot snapshot;
+    AdLocationFeedRead(_feed, &snapshot);
+    return snapshot;
+}
+
+- (AdLocationFeedStatistics)statistics
+{
+    AdLocationFeedStatistics statistics;
+    AdLocationFeedGetStatistics(_feed, &statistics);
+    return statistics;
+}
+
+#pragma mark - Forwarding
+
+- (void)didUpdate:(int)published
+{
+    if (published > 0) {
+        [self forward];
+    } else if (published == 0) {
+        [self schedulePoll];
+    }
+}
+
+- (void)schedulePoll
+{
+    double deadline = AdLocationFeedGetDeadline(_feed);
+    __weak AdLocationForwarder *weakSelf = self;
+
+    if (deadline == 0 || _pollScheduled) {
+        return;
+    }
+    _pollScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)((deadline - CFAbsoluteTimeGetCurrent()) * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [weakSelf poll];
+    });
+}
+
+- (void)poll
+{
+    _pollScheduled = NO;
+    if (AdLocationFeedPoll(_feed, CFAbsoluteTimeGetCurrent()) > 0) {
+        [self forward];
+    } else {
+        // Early by a rounding of the timer, or the update was dropped meanwhile.
+        [self schedulePoll];
+    }
+}
+
+/** Passes on what changed in the published snapshot. */
+- (void)forward
+{
+    AdLocationSnapshot snapshot;
+
+    AdLocationFeedRead(_feed, &snapshot);
+    if (snapshot.hasLocation && (!_forwarded.hasLocation || snapshot.latitude != _forwarded.latitude || snapshot.longitude != _forwarded.longitude)) {
+        CLLocationCoordinate2D coordinate = CLLocationCoordinate2DMake(snapshot.latitude, snapshot.longitude);
+
+        [SASAdView setLocation:[[CLLocation alloc] initWithCoordinate:coordinate altitude:_lastLocation.altitude
+                                                   horizontalAccuracy:snapshot.accuracy verticalAccuracy:_lastLocation.verticalAccuracy
+                                                            timestamp:_lastLocation.timestamp ?: [NSDate date]]];
+    }
+    if (snapshot.heading != _forwarded.heading) {
+        [AdMRAIDBridge setHeading:snapshot.heading];
+    }
+    _forwarded = snapshot;
+}
+
+@end
@@ -0,0 +1,592 @@
+//
+//  AdLog.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdLog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+#define kAdLogRingCapacity      1024    /* records, a power of two */
+#define kAdLogDrainInterval     100     /* milliseconds */
+#define kAdLogCacheLine         64
+#define kAdLogEventNamePrefix   "AdLogEvent"
+
+#define AdLogAlign(x) (((x) + 7) & ~(size_t)7)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordLength;
+    uint32_t eventCount;
+    double openDate;        /* wall clock time of timestamp 0, in seconds since 1970 */
+    uint64_t reserved;
+} AdLogFileHeader;
+
+/** Followed by the name and the format, NUL terminated, padded to 8 bytes. */
+typedef struct {
+    uint16_t event;
+    uint8_t level;
+    uint8_t reserved;
+    uint16_t nameLength;
+    uint16_t formatLength;
+} AdLogFileEvent;
+
+/** Single producer (the owning thread), single consumer (the drain). head and tail only grow. */
+typedef struct AdLogRing {
+    uint64_t head;
+    char headPadding[kAdLogCacheLine - sizeof(uint64_t)];
+    uint64_t tail;
+    char tailPadding[kAdLogCacheLine - sizeof(uint64_t)];
+    uint64_t dropped;
+    uint32_t thread;
+    int abandoned;          /* set when the thread exits, the drain frees the ring once it is empty */
+    struct AdLogRing *next;
+    AdLogRecord records[kAdLogRingCapacity];
+} AdLogRing;
+
+#define AdLogEventLevelEntry(name, level, format) level,
+#define AdLogEventNameEntry(name, level, format) #name,
+#define AdLogEventFormatEntry(name, level, format) format,
+
+static const uint8_t AdLogEventLevels[] = { AdLogEventTable(AdLogEventLevelEntry) };
+static const char *const AdLogEventNames[] = { AdLogEventTable(AdLogEventNameEntry) };
+static const char *const AdLogEventFormats[] = { AdLogEventTable(AdLogEventFormatEntry) };
+
+static pthread_once_t AdLogOnce = PTHREAD_ONCE_INIT;
+
+static struct {
+    pthread_mutex_t lock;   /* everything below but open and level, which writers read without it,
+                               and rings and threads, which AdLogCreateRing updates atomically */
+    pthread_cond_t wake;
+    pthread_key_t ringKey;
+    int open;
+    int level;
+
+    AdLogRing *rings;
+    pthread_t drainThread;
+    int running;
+    char *directory;
+    size_t maxFileSize;
+    unsigned maxFiles;
+    int fd;
+    uint64_t fileLength;
+    uint64_t start;
+    double openDate;
+
+    uint32_t threads;
+    uint64_t written;
+    uint64_t freedDropped;  /* dropped events of the rings already freed */
+    uint64_t bytes;
+    uint32_t rotations;
+} AdLogState = { .fd = -1, .level = AdLogLevelInfo };
+
+// Clock
+
+static uint64_t AdLogNow(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+// Rings
+
+static void AdLogAbandonRing(void *value)
+{
+    AdLogRing *ring = value;
+    __atomic_store_n(&ring->abandoned, 1, __ATOMIC_RELEASE);
+}
+
+static void AdLogInitialize(void)
+{
+    pthread_mutex_init(&AdLogState.lock, NULL);
+    pthread_cond_init(&AdLogState.wake, NULL);
+    pthread_key_create(&AdLogState.ringKey, AdLogAbandonRing);
+}
+
+static AdLogRing *AdLogCreateRing(void)
+{
+    AdLogRing *ring = calloc(1, sizeof(AdLogRing));
+
+    if (ring == NULL) {
+        return NULL;
+    }
+    // Pushed without the lock, which the drain holds while it writes: a thread's first event never waits.
+    ring->thread = __atomic_add_fetch(&AdLogState.threads, 1, __ATOMIC_RELAXED);
+    ring->next = __atomic_load_n(&AdLogState.rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&AdLogState.rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    pthread_setspecific(AdLogState.ringKey, ring);
+    return ring;
+}
+
+// Files
+
+static void AdLogFilePath(char *path, size_t size, unsigned index)
+{
+    if (index == 0) {
+        snprintf(path, size, "%s/AdLog.bin", AdLogState.directory);
+    } else {
+        snprintf(path, size, "%s/AdLog.%u.bin", AdLogState.directory, index);
+    }
+}
+
+static int AdLogWriteAll(const void *bytes, size_t length)
+{
+    const char *cursor = bytes;
+
+    while (length > 0) {
+        ssize_t written = write(AdLogState.fd, cursor, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        cursor += written;
+        length -= (size_t)written;
+        AdLogState.fileLength += (uint64_t)written;
+        AdLogState.bytes += (uint64_t)written;
+    }
+    return 0;
+}
+
+static int AdLogCreateFileLocked(void)
+{
+    char path[PATH_MAX];
+    AdLogFileHeader header = { kAdLogMagic, kAdLogVersion, sizeof(AdLogRecord), AdLogEventCount, AdLogState.openDate, 0 };
+    static const char padding[8];
+
+    AdLogFilePath(path, sizeof(path), 0);
+    AdLogState.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (AdLogState.fd < 0) {
+        return -1;
+    }
+    AdLogState.fileLength = 0;
+    if (AdLogWriteAll(&header, sizeof(header)) != 0) {
+        return -1;
+    }
+    for (uint16_t event = 0; event < AdLogEventCount; event++) {
+        const char *name = AdLogEventNames[event] + strlen(kAdLogEventNamePrefix);
+        const char *format = AdLogEventFormats[event];
+        AdLogFileEvent entry = { event, AdLogEventLevels[event], 0, (uint16_t)strlen(name), (uint16_t)strlen(format) };
+        size_t length = sizeof(entry) + entry.nameLength + 1 + entry.formatLength + 1;
+
+        if (AdLogWriteAll(&entry, sizeof(entry)) != 0 || AdLogWriteAll(name, entry.nameLength + 1u) != 0
+            || AdLogWriteAll(format, entry.formatLength + 1u) != 0 || AdLogWriteAll(padding, AdLogAlign(length) - length) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/** Shifts AdLog.bin to AdLog.1.bin and so on, dropping the oldest file, then starts a new AdLog.bin. */
+static int AdLogRotateLocked(void)
+{
+    char from[PATH_MAX], to[PATH_MAX];
+
+    if (AdLogState.fd >= 0) {
+        close(AdLogState.fd);
+        AdLogState.fd = -1;
+    }
+    if (AdLogState.maxFiles <= 1) {
+        AdLogFilePath(from, sizeof(from), 0);
+        unlink(from);
+    }
+    for (unsigned index = AdLogState.maxFiles - 1; index >= 1; index--) {
+        AdLogFilePath(from, sizeof(from), index - 1);
+        AdLogFilePath(to, sizeof(to), index);
+        rename(from, to);
+    }
+    AdLogState.rotations++;
+    return AdLogCreateFileLocked();
+}
+
+// Drain
+
+/** Unlinks a ring and returns the link that now points to the ring after it. Only the head of the
+ list, where AdLogCreateRing pushes without the lock, can change under the drain.
+ */
+static AdLogRing **AdLogUnlinkRingLocked(AdLogRing **link, AdLogRing *ring)
+{
+    AdLogRing *previous = ring;
+
+    if (link == &AdLogState.rings) {
+        if (__atomic_compare_exchange_n(link, &previous, ring->next, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return link;
+        }
+        // Rings were pushed in front of it since, previous is the new head.
+        while (previous->next != ring) {
+            previous = previous->next;
+        }
+        link = &previous->next;
+    }
+    *link = ring->next;
+    return link;
+}
+
+static void AdLogDrainLocked(void)
+{
+    AdLogRing **link = &AdLogState.rings;
+    AdLogRing *ring;
+
+    while ((ring = __atomic_load_n(link, __ATOMIC_ACQUIRE)) != NULL) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t tail = ring->tail;
+
+        while (tail < head && AdLogState.fd >= 0) {
+            uint64_t count = head - tail;
+            uint64_t contiguous = kAdLogRingCapacity - (tail & (kAdLogRingCapacity - 1));
+
+            if (count > contiguous) {
+                count = contiguous;
+            }
+            if (AdLogWriteAll(&ring->records[tail & (kAdLogRingCapacity - 1)], (size_t)count * sizeof(AdLogRecord)) != 0) {
+                break;
+            }
+            tail += count;
+            AdLogState.written += count;
+            if (AdLogState.fileLength >= AdLogState.maxFileSize && AdLogRotateLocked() != 0) {
+                break;
+            }
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        if (__atomic_load_n(&ring->abandoned, __ATOMIC_ACQUIRE) && tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+            AdLogState.freedDropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+            link = AdLogUnlinkRingLocked(link, ring);
+            free(ring);
+            continue;
+        }
+        link = &ring->next;
+    }
+}
+
+static void *AdLogDrainMain(void *unused)
+{
+    (void)unused;
+    pthread_mutex_lock(&AdLogState.lock);
+    while (AdLogState.running) {
+        struct timeval now;
+        struct timespec deadline;
+
+        gettimeofday(&now, NULL);
+        deadline.tv_sec = now.tv_sec;
+        deadline.tv_nsec = (long)now.tv_usec * 1000 + kAdLogDrainInterval * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&AdLogState.wake, &AdLogState.lock, &deadline);
+        AdLogDrainLocked();
+    }
+    pthread_mutex_unlock(&AdLogState.lock);
+    return NULL;
+}
+
+// Public API
+
+int AdLogOpen(const char *directory, size_t maxFileSize, unsigned maxFiles)
+{
+    char path[PATH_MAX];
+    struct timeval now;
+    int error;
+
+    pthread_once(&AdLogOnce, AdLogInitialize);
+    pthread_mutex_lock(&AdLogState.lock);
+    if (AdLogState.running) {
+        pthread_mutex_unlock(&AdLogState.lock);
+        errno = EBUSY;
+        return -1;
+    }
+    AdLogState.directory = strdup(directory);
+    AdLogState.maxFileSize = maxFileSize;
+    AdLogState.maxFiles = maxFiles > 0 ? maxFiles : 1;
+    gettimeofday(&now, NULL);
+    AdLogState.start = AdLogNow();
+    AdLogState.openDate = now.tv_sec + now.tv_usec / 1e6;
+
+    // A file holds a single session, the timestamps of the previous one have another origin.
+    AdLogFilePath(path, sizeof(path), 0);
+    if (AdLogState.directory == NULL || (access(path, F_OK) == 0 ? AdLogRotateLocked() : AdLogCreateFileLocked()) != 0) {
+        goto fail;
+    }
+
+    // Events written while the log was closed are discarded.
+    for (AdLogRing *ring = __atomic_load_n(&AdLogState.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        __atomic_store_n(&ring->tail, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+
+    AdLogState.running = 1;
+    error = pthread_create(&AdLogState.drainThread, NULL, AdLogDrainMain, NULL);
+    if (error != 0) {
+        AdLogState.running = 0;
+        errno = error;
+        goto fail;
+    }
+    __atomic_store_n(&AdLogState.open, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&AdLogState.lock);
+    return 0;
+
+fail:
+    error = errno;
+    if (AdLogState.fd >= 0) {
+        close(AdLogState.fd);
+        AdLogState.fd = -1;
+    }
+    free(AdLogState.directory);
+    AdLogState.directory = NULL;
+    pthread_mutex_unlock(&AdLogState.lock);
+    errno = error;
+    return -1;
+}
+
+void AdLogClose(void)
+{
+    pthread_once(&AdLogOnce, AdLogInitialize);
+    pthread_mutex_lock(&AdLogState.lock);
+    if (!AdLogState.running) {
+        pthread_mutex_unlock(&AdLogState.lock);
+        return;
+    }
+    __atomic_store_n(&AdLogState.open, 0, __ATOMIC_RELEASE);
+    AdLogState.running = 0;
+    pthread_cond_signal(&AdLogState.wake);
+    pthread_mutex_unlock(&AdLogState.lock);
+    pthread_join(AdLogState.drainThread, NULL);
+
+    // The rings stay allocated, their threads may still be running.
+    pthread_mutex_lock(&AdLogState.lock);
+    AdLogDrainLocked();
+    if (AdLogState.fd >= 0) {
+        close(AdLogState.fd);
+        AdLogState.fd = -1;
+    }
+    free(AdLogState.directory);
+    AdLogState.directory = NULL;
+    pthread_mutex_unlock(&AdLogState.lock);
+}
+
+void AdLogFlush(void)
+{
+    pthread_once(&AdLogOnce, AdLogInitialize);
+    pthread_mutex_lock(&AdLogState.lock);
+    if (AdLogState.running) {
+        AdLogDrainLocked();
+    }
+    pthread_mutex_unlock(&AdLogState.lock);
+}
+
+void AdLogSetLevel(AdLogLevel level)
+{
+    __atomic_store_n(&AdLogState.level, (int)level, __ATOMIC_RELAXED);
+}
+
+void AdLogWrite(AdLogEvent event, uint64_t a, uint64_t b, uint64_t c, const char *string)
+{
+    AdLogRing *ring;
+    AdLogRecord *record;
+    uint64_t head, tail;
+
+    if (!__atomic_load_n(&AdLogState.open, __ATOMIC_ACQUIRE) || (unsigned)event >= AdLogEventCount
+        || AdLogEventLevels[event] < __atomic_load_n(&AdLogState.level, __ATOMIC_RELAXED)) {
+        return;
+    }
+    ring = pthread_getspecific(AdLogState.ringKey);
+    if (ring == NULL && (ring = AdLogCreateRing()) == NULL) {
+        return;
+    }
+
+    head = ring->head;
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail == kAdLogRingCapacity) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    record = &ring->records[head & (kAdLogRingCapacity - 1)];
+    record->timestamp = AdLogNow() - AdLogState.start;
+    record->thread = ring->thread;
+    record->event = (uint16_t)event;
+    record->arguments[0] = a;
+    record->arguments[1] = b;
+    record->arguments[2] = c;
+    record->stringLength = 0;
+    if (string) {
+        size_t length = strlen(string);
+        record->stringLength = (uint16_t)(length < kAdLogStringLength ? length : kAdLogStringLength);
+        memcpy(record->string, string, record->stringLength);
+    }
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    // Signalled without the mutex: a missed wake-up only delays the drain to its next interval.
+    if (head + 1 - tail == kAdLogRingCapacity / 2) {
+        pthread_cond_signal(&AdLogState.wake);
+    }
+}
+
+AdLogStatistics AdLogGetStatistics(void)
+{
+    AdLogStatistics statistics;
+
+    pthread_once(&AdLogOnce, AdLogInitialize);
+    pthread_mutex_lock(&AdLogState.lock);
+    statistics.written = AdLogState.written;
+    statistics.dropped = AdLogState.freedDropped;
+    for (AdLogRing *ring = __atomic_load_n(&AdLogState.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        statistics.dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    }
+    statistics.bytes = AdLogState.bytes;
+    statistics.rotations = AdLogState.rotations;
+    statistics.threads = __atomic_load_n(&AdLogState.threads, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&AdLogState.lock);
+    return statistics;
+}
+
+// Decoding
+
+static void AdLogPrintRecord(FILE *output, const AdLogRecord *record, const char *format)
+{
+    unsigned argument = 0;
+
+    for (const char *cursor = format; *cursor; cursor++) {
+        uint64_t value;
+        double number;
+
+        if (*cursor != '%' || cursor[1] == '\0') {
+            fputc(*cursor, output);
+            continue;
+        }
+        cursor++;
+        if (*cursor == '%') {
+            fputc('%', output);
+            continue;
+        }
+        if (*cursor == 's') {
+            fwrite(record->string, 1, record->stringLength <= kAdLogStringLength ? record->stringLength : kAdLogStringLength, output);
+            continue;
+        }
+        value = argument < 3 ? record->arguments[argument] : 0;
+        argument++;
+        switch (*cursor) {
+            case 'd':
+                fprintf(output, "%lld", (long long)(int64_t)value);
+                break;
+            case 'u':
+                fprintf(output, "%llu", (unsigned long long)value);
+                break;
+            case 'x':
+                fprintf(output, "%llx", (unsigned long long)value);
+                break;
+            case 'f':
+                memcpy(&number, &value, sizeof(number));
+                fprintf(output, "%f", number);
+                break;
+            default:
+                fputc('%', output);
+                fputc(*cursor, output);
+                break;
+        }
+    }
+}
+
+long AdLogDecodeFile(const char *path, FILE *output)
+{
+    static const char levels[] = "DIWE";
+    FILE *file = fopen(path, "rb");
+    AdLogFileHeader header;
+    char **names = NULL, **formats = NULL;
+    uint8_t *eventLevels = NULL;
+    AdLogRecord record;
+    long count = -1;
+    uint32_t loaded = 0;
+
+    if (file == NULL) {
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != kAdLogMagic || header.version != kAdLogVersion
+        || header.recordLength != sizeof(AdLogRecord)) {
+        goto done;
+    }
+    names = calloc(header.eventCount + 1, sizeof(char *));
+    formats = calloc(header.eventCount + 1, sizeof(char *));
+    eventLevels = calloc(header.eventCount + 1, 1);
+    if (names == NULL || formats == NULL || eventLevels == NULL) {
+        goto done;
+    }
+    for (; loaded < header.eventCount; loaded++) {
+        AdLogFileEvent entry;
+        size_t length;
+        char *strings;
+
+        if (fread(&entry, sizeof(entry), 1, file) != 1 || entry.event >= header.eventCount) {
+            goto done;
+        }
+        length = AdLogAlign(sizeof(entry) + entry.nameLength + 1 + entry.formatLength + 1) - sizeof(entry);
+        strings = malloc(length);
+        if (strings == NULL || fread(strings, length, 1, file) != 1) {
+            free(strings);
+            goto done;
+        }
+        strings[entry.nameLength] = '\0';
+        strings[entry.nameLength + 1 + entry.formatLength] = '\0';
+        free(names[entry.event]);
+        names[entry.event] = strings;
+        formats[entry.event] = strings + entry.nameLength + 1;
+        eventLevels[entry.event] = entry.level;
+    }
+
+    count = 0;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        double date = header.openDate + record.timestamp / 1e9;
+        time_t seconds = (time_t)date;
+        struct tm local;
+        char stamp[32];
+
+        localtime_r(&seconds, &local);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+        fprintf(output, "%s.%06d T%u ", stamp, (int)((date - (double)seconds) * 1e6), record.thread);
+        if (record.event < header.eventCount && names[record.event]) {
+            fprintf(output, "%c %s: ", levels[eventLevels[record.event] & 3], names[record.event]);
+            AdLogPrintRecord(output, &record, formats[record.event]);
+        } else {
+            fprintf(output, "? event %u", record.event);
+        }
+        fputc('\n', output);
+        count++;
+    }
+
+done:
+    if (names) {
+        for (uint32_t i = 0; i <= header.eventCount; i++) {
+            free(names[i]);
+        }
+    }
+    free(names);
+    free(formats);
+    free(eventLevels);
+    fclose(file);
+    return count;
+}
@@ -0,0 +1,99 @@
+//
+//  AdLog.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Low overhead binary event log, cheap enough to stay enabled in production.
+
+ Writing an event copies a fixed 64 byte record (event id, timestamp, thread, three integer
+ arguments and a short string) into a ring buffer owned by the calling thread. There is no lock
+ and no formatting on that path: each ring has a single producer, its thread, and a single
+ consumer, the drain thread. When a ring is full the event is dropped and counted, writers never
+ wait.
+
+ The drain thread moves the records to AdLog.bin in the log directory every 100 ms, or earlier
+ when a ring is half full, and rotates the file to AdLog.1.bin, AdLog.2.bin... when it grows past
+ its maximum size. Every file starts with the event table, so AdLogDecodeFile (and the
+ tools/adlogdecode command) can format it back to text without the app.
+
+ This file is plain C.
+ */
+
+#ifndef DemoSmart_AdLog_h
+#define DemoSmart_AdLog_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "AdLogEvents.h"
+
+#define kAdLogMagic         0x474c4153u     /* "SALG" */
+#define kAdLogVersion       1
+#define kAdLogStringLength  24
+
+typedef enum {
+    AdLogLevelDebug,
+    AdLogLevelInfo,
+    AdLogLevelWarning,
+    AdLogLevelError
+} AdLogLevel;
+
+typedef struct {
+    uint64_t timestamp;                 /* nanoseconds since the log was opened */
+    uint32_t thread;                    /* sequential number of the writing thread */
+    uint16_t event;
+    uint16_t stringLength;
+    uint64_t arguments[3];
+    char string[kAdLogStringLength];    /* not NUL terminated when full */
+} AdLogRecord;
+
+typedef struct {
+    uint64_t written;
+    uint64_t dropped;       /* events lost because the ring of their thread was full */
+    uint64_t bytes;         /* bytes written to the files, headers included */
+    uint32_t rotations;
+    uint32_t threads;       /* threads that wrote at least one event */
+} AdLogStatistics;
+
+/** Opens the log in an existing directory and starts the drain thread. Returns 0 on success.
+
+ @param maxFileSize The size above which AdLog.bin is rotated.
+ @param maxFiles The number of files kept, AdLog.bin included.
+ */
+int AdLogOpen(const char *directory, size_t maxFileSize, unsigned maxFiles);
+
+/** Drains the rings, stops the drain thread and closes the file. */
+void AdLogClose(void);
+
+/** Writes every pending record to the file before returning. */
+void AdLogFlush(void);
+
+/** Events below the level are not recorded, AdLogLevelInfo by default. */
+void AdLogSetLevel(AdLogLevel level);
+
+/** Records an event. Does nothing when the log is closed or the event is below the level.
+
+ @param string Copied inline, truncated to kAdLogStringLength bytes. May be NULL.
+ */
+void AdLogWrite(AdLogEvent event, uint64_t a, uint64_t b, uint64_t c, const char *string);
+
+/** Passes a double as an argument, for the %f conversions. */
+static inline uint64_t AdLogDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+AdLogStatistics AdLogGetStatistics(void);
+
+/** Formats a binary log file as one line of text per event. Returns the number of events, or -1 if the file is not a log. */
+long AdLogDecodeFile(const char *path, FILE *output);
+
+#endif
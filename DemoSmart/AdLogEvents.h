@@ -0,0 +1,46 @@
+//
+//  AdLogEvents.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ The events written to the AdLog.
+
+ Every event has a level and a format. The format is only applied when the log is decoded: it may
+ use %d, %u and %x for the integer arguments, %f for an argument passed through AdLogDouble(),
+ and a single %s for the short inline string. Arguments are consumed in order.
+
+ New events are added at the end, the identifiers are stored in the log files.
+ */
+
+#ifndef DemoSmart_AdLogEvents_h
+#define DemoSmart_AdLogEvents_h
+
+#define AdLogEventTable(X) \
+    X(AdLogEventMessage,            AdLogLevelDebug,    "%s %d %d %d") \
+    X(AdLogEventLaunchPhase,        AdLogLevelInfo,     "launch phase %s at %u us") \
+    X(AdLogEventAdCallStarted,      AdLogLevelInfo,     "ad call started, format %u, hedged %u") \
+    X(AdLogEventAdDataReceived,     AdLogLevelInfo,     "ad data received, format %u, insertion %u") \
+    X(AdLogEventAdLoaded,           AdLogLevelInfo,     "ad loaded, format %u") \
+    X(AdLogEventAdFailed,           AdLogLevelWarning,  "ad failed, format %u, error %d (%s)") \
+    X(AdLogEventCachedAdDisplayed,  AdLogLevelInfo,     "cached ad displayed, format %u, insertion %u") \
+    X(AdLogEventBeaconDropped,      AdLogLevelWarning,  "beacon dropped, insertion %u, kind %u, after %u attempts") \
+    X(AdLogEventMemoryPressure,     AdLogLevelWarning,  "memory pressure %u, freed %u of %u bytes") \
+    X(AdLogEventVideoStopped,       AdLogLevelInfo,     "video stopped, insertion %u, %u of %u bytes fetched") \
+    X(AdLogEventCreativePreprocessed, AdLogLevelInfo,   "creative preprocessed, insertion %u, %u local assets, %u bytes") \
+    X(AdLogEventAdCallSkipped,      AdLogLevelInfo,     "ad call skipped, format %u, circuit %u, retry in %u ms") \
+    X(AdLogEventConnectionWarmed,   AdLogLevelInfo,     "connection warmed to %s, resolve %u us, request %u us")
+
+#define AdLogEventEnumerator(name, level, format) name,
+
+typedef enum {
+    AdLogEventTable(AdLogEventEnumerator)
+    AdLogEventCount
+} AdLogEvent;
+
+#undef AdLogEventEnumerator
+
+#endif
@@ -0,0 +1,76 @@
+//
+//  AdMRAIDBridge.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+#import <CoreLocation/CoreLocation.h>
+
+#import "AdBridgeChannel.h"
+
+/**
+ Batched message channel between the app and an MRAID creative, next to the bridge of the SDK.
+
+ The bridge injects AdBridge.js in the web view of the creative and exchanges with it through an
+ AdBridgeChannel, at most once per frame: the native state (size, orientation, heading and
+ exposure of the web view) is sampled, and only what changed is pushed, together with the
+ results of the calls the script queued since the previous exchange. The script answers the
+ getters of the state from its mirror, so a chatty creative costs one crossing per frame
+ instead of one per call.
+
+    _bridge = [[AdMRAIDBridge alloc] initWithWebView:[AdMRAIDBridge webViewInView:adView]];
+    [_bridge setHandler:^NSString *(NSString *argument) { ... } forMethod:@"share"];
+    ...
+    [_bridge invalidate];
+
+ While nothing happens, the state is sampled a few times per second without calling the script.
+ Use the bridge from the main thread.
+ */
+
+@interface AdMRAIDBridge : NSObject
+
+/** The first web view in the hierarchy of the view, the one of the creative in an ad view.
+
+ */
+
++ (UIWebView *)webViewInView:(UIView *)view;
+
+/** The heading sent to the creatives, as +[SASAdView setHeading:], to which it is forwarded.
+
+ */
+
++ (void)setHeading:(CLLocationDirection)heading;
+
+/** Injects the script and starts exchanging with it.
+
+ */
+
+- (id)initWithWebView:(UIWebView *)webView;
+
+/** Handles the calls of a method made with AdBridge.call(method, argument, callback).
+
+ @param handler Returns the result passed to the callback of the script, or nil for none.
+
+ */
+
+- (void)setHandler:(NSString *(^)(NSString *argument))handler forMethod:(NSString *)method;
+
+/** Exchanges with the script on the next frame, after a change the sampling would find late.
+
+ */
+
+- (void)setNeedsUpdate;
+
+/** Stops exchanging. The display link of the bridge retains it until then.
+
+ */
+
+- (void)invalidate;
+
+- (AdBridgeChannelStatistics)statistics;
+
+@end
@@ -0,0 +1,274 @@
+//
+//  AdMRAIDBridge.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdMRAIDBridge.h"
+#import "SASAdView.h"
+
+#import <QuartzCore/QuartzCore.h>
+
+static NSString *const kAdBridgeScheme = @"adbridge";
+static NSString *const kAdBridgeMissingScript = @"-";
+static const NSInteger kAdBridgeIdleFrameInterval = 15;    // 4 samples per second at 60 Hz
+static const NSUInteger kAdBridgeActiveFrames = 30;         // sampled every frame after an exchange
+
+static CLLocationDirection AdBridgeHeading = -1;
+
+/** Answers the adbridge:// navigations of the script, which only tell that calls are waiting. */
+@interface AdBridgeURLProtocol : NSURLProtocol
+
+@end
+
+@interface AdMRAIDBridge ()
+
+- (void)scriptDidSignal;
+
+@end
+
+static NSHashTable *AdBridgeActiveBridges(void)
+{
+    static NSHashTable *bridges = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        bridges = [NSHashTable weakObjectsHashTable];
+    });
+    return bridges;
+}
+
+@implementation AdBridgeURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request
+{
+    return [[[[request URL] scheme] lowercaseString] isEqualToString:kAdBridgeScheme];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
+- (void)startLoading
+{
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[self.request URL] statusCode:204 HTTPVersion:@"HTTP/1.1" headerFields:nil];
+
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocolDidFinishLoading:self];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        // The navigation does not say which web view it comes from, every bridge drains its script.
+        for (AdMRAIDBridge *bridge in [AdBridgeActiveBridges() allObjects]) {
+            [bridge scriptDidSignal];
+        }
+    });
+}
+
+- (void)stopLoading
+{
+}
+
+@end
+
+static int AdBridgeHandleCall(void *info, uint32_t callId, const char *method, const char *argument, char *result, size_t capacity)
+{
+    NSDictionary *handlers = (__bridge NSDictionary *)info;
+    NSString *(^handler)(NSString *) = handlers[@(method)];
+    NSString *value;
+
+    if (handler == nil) {
+        NSLog(@"AdMRAIDBridge: no handler for %s", method);
+        return 0;
+    }
+    value = handler(@(argument) ?: @"");
+    if (value == nil) {
+        return 0;
+    }
+    strlcpy(result, [value UTF8String], capacity);
+    return 1;
+}
+
+@implementation AdMRAIDBridge
+{
+    UIWebView *__weak _webView;
+    AdBridgeChannel *_channel;
+    CADisplayLink *_displayLink;
+    NSMutableDictionary *_handlers;     // method -> block
+    BOOL _signaled;                     // exchange on the next frame even without a change
+    NSUInteger _activeFrames;           // left at every frame before going back to sampling
+}
+
++ (void)initialize
+{
+    if (self == [AdMRAIDBridge class]) {
+        [NSURLProtocol registerClass:[AdBridgeURLProtocol class]];
+    }
+}
+
++ (UIWebView *)webViewInView:(UIView *)view
+{
+    if ([view isKindOfClass:[UIWebView class]]) {
+        return (UIWebView *)view;
+    }
+    for (UIView *subview in view.subviews) {
+        UIWebView *webView = [self webViewInView:subview];
+
+        if (webView) {
+            return webView;
+        }
+    }
+    return nil;
+}
+
++ (void)setHeading:(CLLocationDirection)heading
+{
+    AdBridgeHeading = heading;
+    [SASAdView setHeading:heading];
+}
+
+/** The script, read once from the main bundle. */
++ (NSString *)script
+{
+    static NSString *script = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *path = [[NSBundle mainBundle] pathForResource:@"AdBridge" ofType:@"js"];
+
+        script = path ? [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL] : nil;
+    });
+    return script;
+}
+
+- (id)initWithWebView:(UIWebView *)webView
+{
+    self = [super init];
+    if (self) {
+        _channel = AdBridgeChannelCreate();
+        if (webView == nil || _channel == NULL || [[self class] script] == nil) {
+            return nil;
+        }
+        _webView = webView;
+        _handlers = [NSMutableDictionary dictionary];
+        [_webView stringByEvaluatingJavaScriptFromString:[[self class] script]];
+        [AdBridgeActiveBridges() addObject:self];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(setNeedsUpdate)
+                                                     name:UIApplicationDidChangeStatusBarOrientationNotification object:nil];
+        _displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayDidRefresh:)];
+        [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+        [self setNeedsUpdate];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    AdBridgeChannelRelease(_channel);
+}
+
+- (void)setHandler:(NSString *(^)(NSString *argument))handler forMethod:(NSString *)method
+{
+    if (handler) {
+        _handlers[method] = [handler copy];
+    } else {
+        [_handlers removeObjectForKey:method];
+    }
+}
+
+- (void)setNeedsUpdate
+{
+    _signaled = YES;
+    _activeFrames = kAdBridgeActiveFrames;
+    _displayLink.frameInterval = 1;
+}
+
+- (void)scriptDidSignal
+{
+    [self setNeedsUpdate];
+}
+
+- (void)invalidate
+{
+    [_displayLink invalidate];
+    _displayLink = nil;
+    [AdBridgeActiveBridges() removeObject:self];
+}
+
+- (AdBridgeChannelStatistics)statistics
+{
+    AdBridgeChannelStatistics statistics;
+    AdBridgeChannelGetStatistics(_channel, &statistics);
+    return statistics;
+}
+
+#pragma mark - Exchange
+
+- (void)displayDidRefresh:(CADisplayLink *)displayLink
+{
+    UIWebView *webView = _webView;
+    AdBridgeState state;
+    const char *message;
+    NSString *batch;
+
+    if (webView == nil) {
+        [self invalidate];
+        return;
+    }
+    [self sampleState:&state ofWebView:webView];
+    AdBridgeChannelSetState(_channel, &state);
+
+    // Sampling alone does not cross to the script: only a change, a result or a signal of the script does.
+    if (AdBridgeChannelHasPendingMessage(_channel) || _signaled) {
+        message = AdBridgeChannelFlush(_channel, NULL);
+        batch = [webView stringByEvaluatingJavaScriptFromString:
+                 [NSString stringWithFormat:@"window.AdBridge ? AdBridge.exchange(%@) : \"%@\"", message ? @(message) : @"null", kAdBridgeMissingScript]];
+        _signaled = NO;
+        _activeFrames = kAdBridgeActiveFrames;
+        if ([batch isEqualToString:kAdBridgeMissingScript]) {
+            // The page was reloaded: the script and its mirror are gone.
+            [webView stringByEvaluatingJavaScriptFromString:[[self class] script]];
+            AdBridgeChannelReset(_channel);
+        } else if ([batch length] > 0) {
+            const char *calls = [batch UTF8String];
+
+            // Their results go with the next frame.
+            AdBridgeChannelReceive(_channel, calls, strlen(calls), AdBridgeHandleCall, (__bridge void *)_handlers);
+        }
+    } else if (_activeFrames > 0) {
+        _activeFrames--;
+    }
+    displayLink.frameInterval = _activeFrames > 0 ? 1 : kAdBridgeIdleFrameInterval;
+}
+
+- (void)sampleState:(AdBridgeState *)state ofWebView:(UIWebView *)webView
+{
+    UIWindow *window = webView.window;
+    CGRect frame = window ? [webView convertRect:webView.bounds toView:window] : CGRectZero;
+    CGRect visible = window ? CGRectIntersection(frame, window.bounds) : CGRectNull;
+    CGFloat area = frame.size.width * frame.size.height;
+
+    state->width = webView.bounds.size.width;
+    state->height = webView.bounds.size.height;
+    switch ([[UIApplication sharedApplication] statusBarOrientation]) {
+        case UIInterfaceOrientationLandscapeLeft:
+            state->orientation = -90;
+            break;
+        case UIInterfaceOrientationLandscapeRight:
+            state->orientation = 90;
+            break;
+        case UIInterfaceOrientationPortraitUpsideDown:
+            state->orientation = 180;
+            break;
+        default:
+            state->orientation = 0;
+            break;
+    }
+    state->heading = AdBridgeHeading;
+    state->exposure = 0;
+    if (!webView.hidden && webView.alpha > 0 && !CGRectIsNull(visible) && area > 0) {
+        state->exposure = (int32_t)lround(100 * visible.size.width * visible.size.height / area);
+    }
+}
+
+@end
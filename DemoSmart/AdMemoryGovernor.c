@@ -0,0 +1,133 @@
+//
+//  AdMemoryGovernor.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdMemoryGovernor.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kAdMemoryPressureCount  (AdMemoryPressureCritical + 1)
+
+struct AdMemoryGovernor {
+    AdMemoryConsumer consumers[kAdMemoryGovernorMaxConsumers];
+    uint32_t count;
+    uint64_t freedTotal;
+    uint32_t responseCounts[kAdMemoryPressureCount];
+};
+
+// Policy
+
+/** The share of the bytes held to free, in percent. */
+static const unsigned kAdMemoryGoalPercent[kAdMemoryPressureCount] = { 0, 25, 50, 100 };
+
+static const AdMemoryTier kAdMemoryDeepestTier[kAdMemoryPressureCount] = {
+    AdMemoryTierDecodedImages, AdMemoryTierPrefetchedAds, AdMemoryTierPooledViews, AdMemoryTierPooledViews
+};
+
+// Governor
+
+AdMemoryGovernor *AdMemoryGovernorCreate(void)
+{
+    return calloc(1, sizeof(AdMemoryGovernor));
+}
+
+void AdMemoryGovernorRelease(AdMemoryGovernor *governor)
+{
+    free(governor);
+}
+
+static int AdMemoryGovernorFind(const AdMemoryGovernor *governor, const char *name)
+{
+    for (uint32_t i = 0; i < governor->count; i++) {
+        if (strcmp(governor->consumers[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int AdMemoryGovernorAddConsumer(AdMemoryGovernor *governor, const AdMemoryConsumer *consumer)
+{
+    if (governor->count == kAdMemoryGovernorMaxConsumers || consumer->tier >= AdMemoryTierCount ||
+        AdMemoryGovernorFind(governor, consumer->name) >= 0) {
+        return -1;
+    }
+    governor->consumers[governor->count++] = *consumer;
+    return 0;
+}
+
+int AdMemoryGovernorRemoveConsumer(AdMemoryGovernor *governor, const char *name)
+{
+    int index = AdMemoryGovernorFind(governor, name);
+
+    if (index < 0) {
+        return -1;
+    }
+    memmove(&governor->consumers[index], &governor->consumers[index + 1], (governor->count - (uint32_t)index - 1) * sizeof(AdMemoryConsumer));
+    governor->count--;
+    return 0;
+}
+
+size_t AdMemoryGovernorGetCost(const AdMemoryGovernor *governor, AdMemoryTier tier)
+{
+    size_t cost = 0;
+
+    for (uint32_t i = 0; i < governor->count; i++) {
+        const AdMemoryConsumer *consumer = &governor->consumers[i];
+        if (tier == AdMemoryTierCount || consumer->tier == tier) {
+            cost += consumer->cost(consumer->info);
+        }
+    }
+    return cost;
+}
+
+AdMemoryResponse AdMemoryGovernorRespond(AdMemoryGovernor *governor, AdMemoryPressure pressure)
+{
+    AdMemoryResponse response;
+
+    memset(&response, 0, sizeof(response));
+    if (pressure > AdMemoryPressureCritical) {
+        pressure = AdMemoryPressureCritical;
+    }
+    response.pressure = pressure;
+    if (pressure == AdMemoryPressureNone) {
+        return response;
+    }
+    response.costBefore = AdMemoryGovernorGetCost(governor, AdMemoryTierCount);
+    response.goal = (size_t)((uint64_t)response.costBefore * kAdMemoryGoalPercent[pressure] / 100);
+
+    for (AdMemoryTier tier = AdMemoryTierDecodedImages; tier <= kAdMemoryDeepestTier[pressure] && response.freed < response.goal; tier++) {
+        for (uint32_t i = 0; i < governor->count && response.freed < response.goal; i++) {
+            AdMemoryConsumer *consumer = &governor->consumers[i];
+            size_t cost, remaining, freed;
+
+            if (consumer->tier != tier) {
+                continue;
+            }
+            cost = consumer->cost(consumer->info);
+            remaining = response.goal - response.freed;
+            freed = consumer->trim(consumer->info, cost > remaining ? cost - remaining : 0);
+            response.freed += freed;
+            response.freedByTier[tier] += freed;
+        }
+    }
+
+    governor->freedTotal += response.freed;
+    governor->responseCounts[pressure]++;
+    return response;
+}
+
+uint64_t AdMemoryGovernorGetFreedTotal(const AdMemoryGovernor *governor)
+{
+    return governor->freedTotal;
+}
+
+uint32_t AdMemoryGovernorGetResponseCount(const AdMemoryGovernor *governor, AdMemoryPressure pressure)
+{
+    return pressure <= AdMemoryPressureCritical ? governor->responseCounts[pressure] : 0;
+}
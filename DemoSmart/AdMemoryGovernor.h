@@ -0,0 +1,92 @@
+//
+//  AdMemoryGovernor.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Frees the memory held by the ad caches in tiers, as much as the memory pressure calls for.
+
+ Every cache registers as a consumer, with a tier, a function returning the bytes it holds and a
+ function releasing memory down to a given number of bytes. On pressure, the governor sets a goal,
+ a share of the bytes held by every consumer, and trims the tiers in order until the goal is met:
+
+ 1. decoded bitmaps, which are decoded again from the stored responses when needed;
+ 2. prefetched ad payloads that were not shown, which are downloaded again;
+ 3. pooled ad views, which are created again.
+
+ Within a tier, consumers are trimmed in the order they were added. Each level of pressure asks for
+ more and may go one tier deeper:
+
+    level       goal    deepest tier
+    Warning     25%     prefetched ads
+    Urgent      50%     pooled views
+    Critical    100%    pooled views
+
+ This file is plain C. A governor is not thread safe, callers serialize access; consumers are called
+ on the caller's thread.
+ */
+
+#ifndef DemoSmart_AdMemoryGovernor_h
+#define DemoSmart_AdMemoryGovernor_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdMemoryGovernorMaxConsumers   16
+
+typedef enum {
+    AdMemoryPressureNone,
+    AdMemoryPressureWarning,
+    AdMemoryPressureUrgent,
+    AdMemoryPressureCritical
+} AdMemoryPressure;
+
+typedef enum {
+    AdMemoryTierDecodedImages,
+    AdMemoryTierPrefetchedAds,
+    AdMemoryTierPooledViews,
+    AdMemoryTierCount
+} AdMemoryTier;
+
+typedef struct {
+    const char *name;       /* not copied, must outlive the governor */
+    AdMemoryTier tier;
+    void *info;
+    /** The bytes held. */
+    size_t (*cost)(void *info);
+    /** Releases memory until at most cost bytes are held. Returns the bytes freed. */
+    size_t (*trim)(void *info, size_t cost);
+} AdMemoryConsumer;
+
+typedef struct {
+    AdMemoryPressure pressure;
+    size_t costBefore;
+    size_t goal;
+    size_t freed;
+    size_t freedByTier[AdMemoryTierCount];
+} AdMemoryResponse;
+
+typedef struct AdMemoryGovernor AdMemoryGovernor;
+
+/** Returns NULL when out of memory. */
+AdMemoryGovernor *AdMemoryGovernorCreate(void);
+void AdMemoryGovernorRelease(AdMemoryGovernor *governor);
+
+/** Returns 0 on success, -1 when kAdMemoryGovernorMaxConsumers are registered or the name is taken. */
+int AdMemoryGovernorAddConsumer(AdMemoryGovernor *governor, const AdMemoryConsumer *consumer);
+int AdMemoryGovernorRemoveConsumer(AdMemoryGovernor *governor, const char *name);
+
+/** The bytes held by the consumers of a tier, or by every consumer for AdMemoryTierCount. */
+size_t AdMemoryGovernorGetCost(const AdMemoryGovernor *governor, AdMemoryTier tier);
+
+/** Trims the consumers for a level of pressure. AdMemoryPressureNone frees nothing. */
+AdMemoryResponse AdMemoryGovernorRespond(AdMemoryGovernor *governor, AdMemoryPressure pressure);
+
+/** The sum of the responses since the governor was created: freed bytes and count per level. */
+uint64_t AdMemoryGovernorGetFreedTotal(const AdMemoryGovernor *governor);
+uint32_t AdMemoryGovernorGetResponseCount(const AdMemoryGovernor *governor, AdMemoryPressure pressure);
+
+#endif
@@ -0,0 +1,49 @@
+//
+//  AdMemoryMonitor.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "AdMemoryGovernor.h"
+
+/**
+ Registers the ad caches of the app with an AdMemoryGovernor and drives it from the app events.
+
+ The consumers are the decoded images of AdCreativePipeline, then its scripts and the memory of the
+ shared NSURLCache where prefetched creatives wait to be shown, then the idle views of AdViewPool.
+
+ A memory warning is urgent pressure, and critical when it follows another one by less than a
+ minute. It then empties AdViewPool with -[AdViewPool didReceiveMemoryWarning], whatever the tiers
+ above freed. Entering the background is a warning, so a suspended app holds less and is less likely to
+ be killed. Every response is written to the AdLog with the bytes freed.
+
+ Use the monitor from the main thread.
+ */
+
+@interface AdMemoryMonitor : NSObject
+
++ (AdMemoryMonitor *)sharedMonitor;
+
+/** Responds to a memory warning, see above for the level.
+
+ */
+
+- (AdMemoryResponse)didReceiveMemoryWarning;
+
+- (AdMemoryResponse)respondToPressure:(AdMemoryPressure)pressure;
+
+/** The bytes held by the consumers of a tier, or by all of them for AdMemoryTierCount.
+
+ */
+
+- (NSUInteger)costOfTier:(AdMemoryTier)tier;
+
+- (AdMemoryResponse)lastResponse;
+
+- (unsigned long long)freedTotal;
+
+@end
@@ -0,0 +1,160 @@
+//
+//  AdMemoryMonitor.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+#import "AdMemoryMonitor.h"
+#import "AdCreativePipeline.h"
+#import "AdLog.h"
+#import "AdViewPool.h"
+
+static const NSTimeInterval kAdMemoryWarningEscalationInterval = 60;
+
+// Consumers, the info is unused: they trim the shared instances.
+
+static size_t AdMemoryDecodedImagesCost(void *info)
+{
+    return [[AdCreativePipeline sharedPipeline] decodedImageCost];
+}
+
+static size_t AdMemoryDecodedImagesTrim(void *info, size_t cost)
+{
+    return [[AdCreativePipeline sharedPipeline] trimDecodedImagesToCost:cost];
+}
+
+static size_t AdMemoryScriptsCost(void *info)
+{
+    return [[AdCreativePipeline sharedPipeline] scriptCost];
+}
+
+static size_t AdMemoryScriptsTrim(void *info, size_t cost)
+{
+    return [[AdCreativePipeline sharedPipeline] trimScriptsToCost:cost];
+}
+
+static size_t AdMemoryURLCacheCost(void *info)
+{
+    return [[NSURLCache sharedURLCache] currentMemoryUsage];
+}
+
+/** Lowering the memory capacity evicts responses from memory, they stay on disk. */
+static size_t AdMemoryURLCacheTrim(void *info, size_t cost)
+{
+    NSURLCache *cache = [NSURLCache sharedURLCache];
+    NSUInteger capacity = [cache memoryCapacity];
+    NSUInteger usage = [cache currentMemoryUsage];
+
+    [cache setMemoryCapacity:cost];
+    [cache setMemoryCapacity:capacity];
+    return usage > [cache currentMemoryUsage] ? usage - [cache currentMemoryUsage] : 0;
+}
+
+static size_t AdMemoryViewPoolCost(void *info)
+{
+    return [[AdViewPool sharedPool] cost];
+}
+
+static size_t AdMemoryViewPoolTrim(void *info, size_t cost)
+{
+    return [[AdViewPool sharedPool] trimToCost:cost];
+}
+
+@implementation AdMemoryMonitor
+{
+    AdMemoryGovernor *_governor;
+    AdMemoryResponse _lastResponse;
+    CFAbsoluteTime _lastWarningDate;
+}
+
++ (AdMemoryMonitor *)sharedMonitor
+{
+    static AdMemoryMonitor *sharedMonitor = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedMonitor = [[AdMemoryMonitor alloc] init];
+    });
+    return sharedMonitor;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        AdMemoryConsumer consumers[] = {
+            { "decodedImages", AdMemoryTierDecodedImages, NULL, AdMemoryDecodedImagesCost, AdMemoryDecodedImagesTrim },
+            { "scripts", AdMemoryTierPrefetchedAds, NULL, AdMemoryScriptsCost, AdMemoryScriptsTrim },
+            { "URLCache", AdMemoryTierPrefetchedAds, NULL, AdMemoryURLCacheCost, AdMemoryURLCacheTrim },
+            { "viewPool", AdMemoryTierPooledViews, NULL, AdMemoryViewPoolCost, AdMemoryViewPoolTrim },
+        };
+
+        _governor = AdMemoryGovernorCreate();
+        if (_governor == NULL) {
+            return nil;
+        }
+        for (size_t i = 0; i < sizeof(consumers) / sizeof(consumers[0]); i++) {
+            AdMemoryGovernorAddConsumer(_governor, &consumers[i]);
+        }
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidEnterBackground:)
+                                                     name:UIApplicationDidEnterBackgroundNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    AdMemoryGovernorRelease(_governor);
+}
+
+#pragma mark - Pressure
+
+- (AdMemoryResponse)didReceiveMemoryWarning
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    BOOL repeated = _lastWarningDate != 0 && now - _lastWarningDate < kAdMemoryWarningEscalationInterval;
+    AdMemoryResponse response;
+
+    _lastWarningDate = now;
+    response = [self respondToPressure:repeated ? AdMemoryPressureCritical : AdMemoryPressureUrgent];
+    // The pool is emptied even when the goal was met by the tiers above, and stops warming views that would undo the response.
+    [[AdViewPool sharedPool] didReceiveMemoryWarning];
+    return response;
+}
+
+- (void)applicationDidEnterBackground:(NSNotification *)notification
+{
+    [self respondToPressure:AdMemoryPressureWarning];
+}
+
+- (AdMemoryResponse)respondToPressure:(AdMemoryPressure)pressure
+{
+    _lastResponse = AdMemoryGovernorRespond(_governor, pressure);
+    if (pressure != AdMemoryPressureNone) {
+        AdLogWrite(AdLogEventMemoryPressure, pressure, _lastResponse.freed, _lastResponse.costBefore, NULL);
+    }
+    return _lastResponse;
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)costOfTier:(AdMemoryTier)tier
+{
+    return AdMemoryGovernorGetCost(_governor, tier);
+}
+
+- (AdMemoryResponse)lastResponse
+{
+    return _lastResponse;
+}
+
+- (unsigned long long)freedTotal
+{
+    return AdMemoryGovernorGetFreedTotal(_governor);
+}
+
+@end
@@ -0,0 +1,67 @@
+//
+//  AdPageCoordinator.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SASAdView.h"
+
+/**
+ Coalesces the ad calls of every placement of a page.
+
+ Instead of calling loadFormatId:pageId:master:target: on each ad view, register the views with
+ the coordinator. Every view registered for a pageId during the same run loop turn is loaded at the
+ end of that turn as one page display: the first registered view carries the master flag, so exactly
+ one page view is counted, and all calls leave back to back so that they fan out in parallel on the
+ keep-alive connections to the ad server instead of being spread over several turns.
+
+ Each ad view still receives its own response through its delegate.
+ */
+
+@interface AdPageCoordinator : NSObject
+
++ (AdPageCoordinator *)sharedCoordinator;
+
+/** Registers an ad view to be loaded with the other placements of its page.
+
+ @param pageId May be nil: the views without a pageId make one page.
+ @param timeout The timeout passed to loadFormatId:pageId:master:target:timeout:, a negative value disables it.
+
+ */
+
+- (void)loadAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target timeout:(float)timeout;
+
+- (void)loadAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Registers an ad view that repeats a call of a page already counted, such as a hedged call.
+
+ It leaves with the other calls of the turn but never carries the master flag, so no page view is counted for it.
+
+ */
+
+- (void)loadRepeatedAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target timeout:(float)timeout;
+
+/** Forgets an ad view registered during this turn, whose call is no longer needed.
+
+ */
+
+- (void)removeAdView:(SASAdView *)adView;
+
+/** Sends the pending calls now instead of at the end of the run loop turn.
+
+ */
+
+- (void)flush;
+
+/** Number of pages and ad calls sent since launch. The master flag is set on one call per page, pages of repeated calls only are not counted.
+
+ */
+
+@property (nonatomic, readonly) NSUInteger pageCount;
+@property (nonatomic, readonly) NSUInteger callCount;
+
+@end
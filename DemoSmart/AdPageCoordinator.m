@@ -0,0 +1,158 @@
+//
+//  AdPageCoordinator.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdPageCoordinator.h"
+
+@interface AdPageRequest : NSObject
+
+@property (nonatomic, strong) SASAdView *adView;
+@property (nonatomic, assign) NSInteger formatId;
+@property (nonatomic, copy) NSString *pageId;
+@property (nonatomic, copy) NSString *target;
+@property (nonatomic, assign) float timeout;
+@property (nonatomic, assign) BOOL repeated;
+
+@end
+
+@implementation AdPageRequest
+
+@end
+
+@implementation AdPageCoordinator
+{
+    NSMutableDictionary *_pendingPages;     // pageId, @"" for nil -> NSMutableArray of AdPageRequest
+    NSMutableArray *_pageOrder;
+    CFRunLoopObserverRef _observer;
+}
+
++ (AdPageCoordinator *)sharedCoordinator
+{
+    static AdPageCoordinator *sharedCoordinator = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCoordinator = [[AdPageCoordinator alloc] init];
+    });
+    return sharedCoordinator;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _pendingPages = [NSMutableDictionary dictionary];
+        _pageOrder = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_observer) {
+        CFRunLoopObserverInvalidate(_observer);
+        CFRelease(_observer);
+    }
+}
+
+- (void)loadAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    [self loadAdView:adView formatId:formatId pageId:pageId target:target timeout:-1];
+}
+
+- (void)loadAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target timeout:(float)timeout
+{
+    [self loadAdView:adView formatId:formatId pageId:pageId target:target timeout:timeout repeated:NO];
+}
+
+- (void)loadRepeatedAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target timeout:(float)timeout
+{
+    [self loadAdView:adView formatId:formatId pageId:pageId target:target timeout:timeout repeated:YES];
+}
+
+- (void)loadAdView:(SASAdView *)adView formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target timeout:(float)timeout repeated:(BOOL)repeated
+{
+    NSAssert([NSThread isMainThread], @"Ad views are loaded from the main thread");
+
+    AdPageRequest *request = [[AdPageRequest alloc] init];
+    NSString *page = pageId ?: @"";
+    NSMutableArray *requests = _pendingPages[page];
+
+    request.adView = adView;
+    request.formatId = formatId;
+    request.pageId = pageId;
+    request.target = target;
+    request.timeout = timeout;
+    request.repeated = repeated;
+
+    if (requests == nil) {
+        requests = [NSMutableArray array];
+        _pendingPages[page] = requests;
+        [_pageOrder addObject:page];
+    }
+    [requests addObject:request];
+    [self scheduleFlush];
+}
+
+- (void)removeAdView:(SASAdView *)adView
+{
+    for (NSString *page in [_pageOrder copy]) {
+        NSMutableArray *requests = _pendingPages[page];
+
+        [requests filterUsingPredicate:[NSPredicate predicateWithFormat:@"adView != %@", adView]];
+        if ([requests count] == 0) {
+            [_pendingPages removeObjectForKey:page];
+            [_pageOrder removeObject:page];
+        }
+    }
+}
+
+/** Flushes when the main run loop is about to sleep, once every source of the current turn has run. */
+- (void)scheduleFlush
+{
+    if (_observer) {
+        return;
+    }
+    __weak AdPageCoordinator *weakSelf = self;
+    _observer = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting | kCFRunLoopExit, false, 0,
+                                                   ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+        [weakSelf flush];
+    });
+    CFRunLoopAddObserver(CFRunLoopGetMain(), _observer, kCFRunLoopCommonModes);
+}
+
+- (void)flush
+{
+    NSArray *pageOrder = _pageOrder;
+    NSDictionary *pendingPages = _pendingPages;
+
+    if (_observer) {
+        CFRunLoopObserverInvalidate(_observer);
+        CFRelease(_observer);
+        _observer = NULL;
+    }
+    _pageOrder = [NSMutableArray array];
+    _pendingPages = [NSMutableDictionary dictionary];
+
+    for (NSString *page in pageOrder) {
+        BOOL counted = NO;
+        for (AdPageRequest *request in pendingPages[page]) {
+            BOOL master = !counted && !request.repeated;
+            if (request.timeout >= 0) {
+                [request.adView loadFormatId:request.formatId pageId:request.pageId master:master target:request.target timeout:request.timeout];
+            } else {
+                [request.adView loadFormatId:request.formatId pageId:request.pageId master:master target:request.target];
+            }
+            counted |= master;
+            _callCount++;
+        }
+        if (counted) {
+            _pageCount++;
+        }
+    }
+}
+
+@end
@@ -0,0 +1,298 @@
+//
+//  AdPipeline.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdPipeline.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct {
+    AdPipeline *pipeline;
+    uint32_t index;
+    AdPipelineStage stage;
+
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    void **items;           /* ring of stage.capacity items */
+    uint32_t head;
+    uint32_t count;
+    int stopping;
+
+    pthread_t *threads;
+    uint32_t threadCount;
+} AdPipelineQueue;
+
+struct AdPipeline {
+    AdPipelineQueue *queues;
+    uint32_t stageCount;
+    AdPipelineCompletion completion;
+    void *context;
+
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    uint32_t inFlight;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t stalls;
+};
+
+// Queues
+
+static void AdPipelineCountStall(AdPipeline *pipeline)
+{
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->stalls++;
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void AdPipelineQueuePush(AdPipelineQueue *queue, void *item)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->stage.capacity) {
+        AdPipelineCountStall(queue->pipeline);
+        while (queue->count == queue->stage.capacity) {
+            pthread_cond_wait(&queue->notFull, &queue->lock);
+        }
+    }
+    queue->items[(queue->head + queue->count) % queue->stage.capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static int AdPipelineQueueTryPush(AdPipelineQueue *queue, void *item)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->stage.capacity) {
+        pthread_mutex_unlock(&queue->lock);
+        return EAGAIN;
+    }
+    queue->items[(queue->head + queue->count) % queue->stage.capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+/** Returns 0 and the next item, or -1 once the queue is stopping and empty. */
+static int AdPipelineQueuePop(AdPipelineQueue *queue, void **item)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->stopping) {
+        pthread_cond_wait(&queue->notEmpty, &queue->lock);
+    }
+    if (queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+    *item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->stage.capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->notFull);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+// Workers
+
+static void AdPipelineFinish(AdPipeline *pipeline, void *item, int status)
+{
+    if (pipeline->completion) {
+        pipeline->completion(item, status, pipeline->context);
+    }
+    pthread_mutex_lock(&pipeline->lock);
+    if (status == 0) {
+        pipeline->completed++;
+    } else {
+        pipeline->failed++;
+    }
+    if (--pipeline->inFlight == 0) {
+        pthread_cond_broadcast(&pipeline->idle);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void *AdPipelineWorker(void *argument)
+{
+    AdPipelineQueue *queue = argument;
+    AdPipeline *pipeline = queue->pipeline;
+    void *item;
+
+    while (AdPipelineQueuePop(queue, &item) == 0) {
+        int status = queue->stage.function(item, queue->stage.context);
+
+        if (status == 0 && queue->index + 1 < pipeline->stageCount) {
+            AdPipelineQueuePush(&pipeline->queues[queue->index + 1], item);
+        } else {
+            AdPipelineFinish(pipeline, item, status);
+        }
+    }
+    return NULL;
+}
+
+static void AdPipelineStop(AdPipeline *pipeline)
+{
+    for (uint32_t i = 0; i < pipeline->stageCount; i++) {
+        AdPipelineQueue *queue = &pipeline->queues[i];
+
+        pthread_mutex_lock(&queue->lock);
+        queue->stopping = 1;
+        pthread_cond_broadcast(&queue->notEmpty);
+        pthread_mutex_unlock(&queue->lock);
+    }
+    for (uint32_t i = 0; i < pipeline->stageCount; i++) {
+        AdPipelineQueue *queue = &pipeline->queues[i];
+
+        for (uint32_t t = 0; t < queue->threadCount; t++) {
+            pthread_join(queue->threads[t], NULL);
+        }
+        free(queue->threads);
+        free(queue->items);
+        pthread_cond_destroy(&queue->notEmpty);
+        pthread_cond_destroy(&queue->notFull);
+        pthread_mutex_destroy(&queue->lock);
+    }
+    free(pipeline->queues);
+    pthread_cond_destroy(&pipeline->idle);
+    pthread_mutex_destroy(&pipeline->lock);
+    free(pipeline);
+}
+
+// Public API
+
+AdPipeline *AdPipelineCreate(const AdPipelineStage *stages, uint32_t stageCount,
+                             AdPipelineCompletion completion, void *context)
+{
+    AdPipeline *pipeline;
+
+    if (stages == NULL || stageCount == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    pipeline = calloc(1, sizeof(AdPipeline));
+    if (pipeline == NULL) {
+        return NULL;
+    }
+    pipeline->completion = completion;
+    pipeline->context = context;
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->idle, NULL);
+    pipeline->queues = calloc(stageCount, sizeof(AdPipelineQueue));
+    if (pipeline->queues == NULL) {
+        pthread_cond_destroy(&pipeline->idle);
+        pthread_mutex_destroy(&pipeline->lock);
+        free(pipeline);
+        return NULL;
+    }
+
+    // Every queue is initialized before any thread starts, a worker may hand off to the next stage at once.
+    for (uint32_t i = 0; i < stageCount; i++) {
+        AdPipelineQueue *queue = &pipeline->queues[i];
+
+        queue->pipeline = pipeline;
+        queue->index = i;
+        queue->stage = stages[i];
+        if (queue->stage.workers == 0) {
+            queue->stage.workers = 1;
+        }
+        if (queue->stage.capacity == 0) {
+            queue->stage.capacity = queue->stage.workers;
+        }
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->notEmpty, NULL);
+        pthread_cond_init(&queue->notFull, NULL);
+        pipeline->stageCount++;
+        queue->items = malloc(queue->stage.capacity * sizeof(void *));
+        queue->threads = calloc(queue->stage.workers, sizeof(pthread_t));
+        if (queue->stage.function == NULL || queue->items == NULL || queue->threads == NULL) {
+            int error = queue->stage.function == NULL ? EINVAL : ENOMEM;
+            AdPipelineStop(pipeline);
+            errno = error;
+            return NULL;
+        }
+    }
+    for (uint32_t i = 0; i < stageCount; i++) {
+        AdPipelineQueue *queue = &pipeline->queues[i];
+
+        for (; queue->threadCount < queue->stage.workers; queue->threadCount++) {
+            int error = pthread_create(&queue->threads[queue->threadCount], NULL, AdPipelineWorker, queue);
+            if (error != 0) {
+                AdPipelineStop(pipeline);
+                errno = error;
+                return NULL;
+            }
+        }
+    }
+    return pipeline;
+}
+
+void AdPipelineRelease(AdPipeline *pipeline)
+{
+    if (pipeline == NULL) {
+        return;
+    }
+    AdPipelineDrain(pipeline);
+    AdPipelineStop(pipeline);
+}
+
+static void AdPipelineEnter(AdPipeline *pipeline)
+{
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->inFlight++;
+    pipeline->submitted++;
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+int AdPipelineSubmit(AdPipeline *pipeline, void *item)
+{
+    AdPipelineEnter(pipeline);
+    AdPipelineQueuePush(&pipeline->queues[0], item);
+    return 0;
+}
+
+int AdPipelineTrySubmit(AdPipeline *pipeline, void *item)
+{
+    // Counted first so that a fast item cannot complete before it was counted in flight.
+    AdPipelineEnter(pipeline);
+    if (AdPipelineQueueTryPush(&pipeline->queues[0], item) != 0) {
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->submitted--;
+        if (--pipeline->inFlight == 0) {
+            pthread_cond_broadcast(&pipeline->idle);
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+        return EAGAIN;
+    }
+    return 0;
+}
+
+void AdPipelineDrain(AdPipeline *pipeline)
+{
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->inFlight > 0) {
+        pthread_cond_wait(&pipeline->idle, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+AdPipelineStatistics AdPipelineGetStatistics(AdPipeline *pipeline)
+{
+    AdPipelineStatistics statistics;
+
+    pthread_mutex_lock(&pipeline->lock);
+    statistics.submitted = pipeline->submitted;
+    statistics.completed = pipeline->completed;
+    statistics.failed = pipeline->failed;
+    statistics.stalls = pipeline->stalls;
+    statistics.inFlight = pipeline->inFlight;
+    pthread_mutex_unlock(&pipeline->lock);
+    return statistics;
+}
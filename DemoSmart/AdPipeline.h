@@ -0,0 +1,68 @@
+//
+//  AdPipeline.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Bounded multi-stage work pipeline.
+
+ Items flow through a fixed list of stages (for the creatives: fetch, verify, decode, store).
+ Every stage has its own pool of worker threads and a bounded input queue. A worker that finishes
+ an item hands it to the next stage and blocks while that stage's queue is full, so a slow stage
+ holds back the stages before it instead of letting items pile up in memory. Submitting blocks the
+ same way when the first queue is full (back-pressure), AdPipelineTrySubmit fails instead.
+
+ This file is plain C on top of pthreads.
+ */
+
+#ifndef DemoSmart_AdPipeline_h
+#define DemoSmart_AdPipeline_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct AdPipeline AdPipeline;
+
+/** Processes an item. Returns 0 to pass it to the next stage, any other value ends the item with that status. */
+typedef int (*AdPipelineStageFunction)(void *item, void *context);
+
+/** Called once per item, on the worker thread of the stage that finished it. */
+typedef void (*AdPipelineCompletion)(void *item, int status, void *context);
+
+typedef struct {
+    AdPipelineStageFunction function;
+    void *context;
+    uint32_t workers;
+    uint32_t capacity;      /* slots of the input queue */
+} AdPipelineStage;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;     /* items that went through every stage */
+    uint64_t failed;        /* items ended by a non zero status */
+    uint64_t stalls;        /* hand-offs that had to wait for room in a full queue */
+    uint32_t inFlight;
+} AdPipelineStatistics;
+
+/** Starts the worker threads. Returns NULL and sets errno on failure. The stages are copied. */
+AdPipeline *AdPipelineCreate(const AdPipelineStage *stages, uint32_t stageCount,
+                             AdPipelineCompletion completion, void *context);
+
+/** Waits for the items in flight, then stops and joins the workers. */
+void AdPipelineRelease(AdPipeline *pipeline);
+
+/** Queues an item in the first stage, waiting for room if the queue is full. Returns 0 on success. */
+int AdPipelineSubmit(AdPipeline *pipeline, void *item);
+
+/** Queues an item if the first stage has room. Returns 0 on success, EAGAIN when the queue is full. */
+int AdPipelineTrySubmit(AdPipeline *pipeline, void *item);
+
+/** Waits until every submitted item has completed. */
+void AdPipelineDrain(AdPipeline *pipeline);
+
+AdPipelineStatistics AdPipelineGetStatistics(AdPipeline *pipeline);
+
+#endif
@@ -0,0 +1,84 @@
+//
+//  AdPlacementBreaker.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "AdCircuitBreaker.h"
+
+/**
+ Keeps the ad calls of placements that do not fill or keep failing from going out, through an AdCircuitBreaker.
+
+ Ask before -loadFormatId:pageId:master:target: whether the call may go, and report how it ended:
+
+    if ([[AdPlacementBreaker sharedBreaker] shouldLoadFormatId:formatId pageId:pageId target:target]) {
+        [adView loadFormatId:formatId pageId:pageId master:YES target:target];
+    }
+    // adView:didDownloadAdData:
+    [[AdPlacementBreaker sharedBreaker] reportOutcome:AdCallFilled forFormatId:formatId pageId:pageId target:target];
+    // adView:didFailToLoadWithError:, before the ad data
+    [[AdPlacementBreaker sharedBreaker] reportError:error forFormatId:formatId pageId:pageId target:target];
+
+ The SDK reports a no-fill and an error of the ad server with the same callback: only the errors of
+ the URL loading system (no network, timeouts) count as failures, the others as no-fills. The
+ state is kept for the life of the app, a placement is tried again at the next launch.
+ Thread safe.
+ */
+
+@interface AdPlacementBreaker : NSObject
+
+/** The breaker of AdDeadlineLoader, with AdCircuitBreakerDefaultConfiguration.
+
+ */
+
++ (AdPlacementBreaker *)sharedBreaker;
+
+- (id)initWithConfiguration:(const AdCircuitBreakerConfiguration *)configuration;
+
+/** The state of the placement, without counting a call or a short circuit.
+
+ @param retryDate Set to the date from which a call may go, now when it may go at once. May be NULL.
+
+ */
+
+- (AdCircuitState)stateForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target retryDate:(NSDate **)retryDate;
+
+/** Whether to make the call. When it returns YES, report its outcome.
+
+ */
+
+- (BOOL)shouldLoadFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+- (void)reportOutcome:(AdCallOutcome)outcome forFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Reports a failure or a no-fill, see outcomeForError:.
+
+ */
+
+- (void)reportError:(NSError *)error forFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** The counters of the placement, of every placement when pageId is nil.
+
+ */
+
+- (AdCircuitStatistics)statisticsForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** The share of the answered calls that filled, 1 before the first answer.
+
+ */
+
+- (double)fillRateForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Closes every placement, when the network comes back for example.
+
+ */
+
+- (void)reset;
+
++ (AdCallOutcome)outcomeForError:(NSError *)error;
+
+@end
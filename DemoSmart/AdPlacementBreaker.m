@@ -0,0 +1,108 @@
+//
+//  AdPlacementBreaker.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdPlacementBreaker.h"
+
+@implementation AdPlacementBreaker
+{
+    AdCircuitBreaker *_breaker;     // under @synchronized(self)
+}
+
++ (AdPlacementBreaker *)sharedBreaker
+{
+    static AdPlacementBreaker *sharedBreaker = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedBreaker = [[AdPlacementBreaker alloc] initWithConfiguration:&AdCircuitBreakerDefaultConfiguration];
+    });
+    return sharedBreaker;
+}
+
+- (id)init
+{
+    return [self initWithConfiguration:&AdCircuitBreakerDefaultConfiguration];
+}
+
+- (id)initWithConfiguration:(const AdCircuitBreakerConfiguration *)configuration
+{
+    self = [super init];
+    if (self) {
+        _breaker = AdCircuitBreakerCreate(configuration, ((uint64_t)arc4random() << 32) | arc4random());
+        if (_breaker == NULL) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    AdCircuitBreakerRelease(_breaker);
+}
+
++ (AdCallOutcome)outcomeForError:(NSError *)error
+{
+    return [[error domain] isEqualToString:NSURLErrorDomain] ? AdCallFailed : AdCallNoFill;
+}
+
+- (AdCircuitState)stateForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target retryDate:(NSDate **)retryDate
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    AdCircuitState state;
+    double date;
+
+    @synchronized(self) {
+        state = AdCircuitBreakerGetState(_breaker, formatId, [pageId UTF8String] ?: "", [target UTF8String], now, &date);
+    }
+    if (retryDate) {
+        *retryDate = [NSDate dateWithTimeIntervalSinceReferenceDate:date];
+    }
+    return state;
+}
+
+- (BOOL)shouldLoadFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        return AdCircuitBreakerAllow(_breaker, formatId, [pageId UTF8String] ?: "", [target UTF8String], CFAbsoluteTimeGetCurrent()) != 0;
+    }
+}
+
+- (void)reportOutcome:(AdCallOutcome)outcome forFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        AdCircuitBreakerReport(_breaker, formatId, [pageId UTF8String] ?: "", [target UTF8String], outcome, CFAbsoluteTimeGetCurrent());
+    }
+}
+
+- (void)reportError:(NSError *)error forFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    [self reportOutcome:[AdPlacementBreaker outcomeForError:error] forFormatId:formatId pageId:pageId target:target];
+}
+
+- (AdCircuitStatistics)statisticsForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        return AdCircuitBreakerGetStatistics(_breaker, formatId, [pageId UTF8String], [target UTF8String]);
+    }
+}
+
+- (double)fillRateForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    AdCircuitStatistics statistics = [self statisticsForFormatId:formatId pageId:pageId target:target];
+
+    return statistics.fills + statistics.noFills > 0 ? (double)statistics.fills / (statistics.fills + statistics.noFills) : 1;
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        AdCircuitBreakerReset(_breaker);
+    }
+}
+
+@end
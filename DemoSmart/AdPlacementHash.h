@@ -0,0 +1,45 @@
+//
+//  AdPlacementHash.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ The hash of a placement, shared by the tables keyed by (formatId, pageId, target).
+
+ 64-bit FNV-1a over the 8 bytes of the format ID, least significant first, the page ID, a 0x1f
+ separator and the target. AdCache stores it in its index file, so it must not change.
+
+ This file is plain C.
+ */
+
+#ifndef DemoSmart_AdPlacementHash_h
+#define DemoSmart_AdPlacementHash_h
+
+#include <stdint.h>
+
+#define kAdPlacementHashOffsetBasis     14695981039346656037ULL
+#define kAdPlacementHashPrime           1099511628211ULL
+
+/** Hashes a placement. pageId and target are not NULL, an absent target is the empty string. Callers map the values they reserve. */
+static inline uint64_t AdPlacementHash(int64_t formatId, const char *pageId, const char *target)
+{
+    uint64_t hash = kAdPlacementHashOffsetBasis;
+    uint64_t value = (uint64_t)formatId;
+
+    for (int i = 0; i < 8; i++) {
+        hash = (hash ^ ((value >> (i * 8)) & 0xff)) * kAdPlacementHashPrime;
+    }
+    for (const unsigned char *p = (const unsigned char *)pageId; *p; p++) {
+        hash = (hash ^ *p) * kAdPlacementHashPrime;
+    }
+    hash = (hash ^ 0x1f) * kAdPlacementHashPrime;
+    for (const unsigned char *p = (const unsigned char *)target; *p; p++) {
+        hash = (hash ^ *p) * kAdPlacementHashPrime;
+    }
+    return hash;
+}
+
+#endif
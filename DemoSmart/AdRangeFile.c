@@ -0,0 +1,386 @@
+//
+//  AdRangeFile.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdRangeFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kAdRangeMapSuffix           ".ranges"
+#define kAdRangeMapTemporarySuffix  ".ranges.tmp"
+#define kAdRangeMapMagic            "AdRangeFile 1"
+#define kAdRangeValidatorMaxLength  255
+
+struct AdRangeFile {
+    int fd;
+    char *mapPath;
+    char *temporaryPath;
+    char validator[kAdRangeValidatorMaxLength + 1];
+    uint64_t length;
+    uint64_t cachedBytes;
+    AdRange *ranges;            /* sorted, neither overlapping nor adjacent */
+    uint32_t rangeCount;
+    uint32_t rangeCapacity;
+};
+
+static char *AdRangeCopyPath(const char *path, const char *suffix)
+{
+    size_t length = strlen(path), suffixLength = strlen(suffix);
+    char *copy = malloc(length + suffixLength + 1);
+
+    if (copy) {
+        memcpy(copy, path, length);
+        memcpy(copy + length, suffix, suffixLength + 1);
+    }
+    return copy;
+}
+
+// Ranges
+
+/** The index of the first range ending after offset, rangeCount if there is none. */
+static uint32_t AdRangeFind(const AdRangeFile *file, uint64_t offset)
+{
+    uint32_t low = 0, high = file->rangeCount;
+
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+
+        if (file->ranges[middle].end <= offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static int AdRangeInsert(AdRangeFile *file, uint64_t start, uint64_t end)
+{
+    uint32_t first, last;
+
+    // The ranges merged with [start, end) are those that overlap it or touch it.
+    first = start > 0 ? AdRangeFind(file, start - 1) : 0;
+    last = first;
+    while (last < file->rangeCount && file->ranges[last].start <= end) {
+        last++;
+    }
+
+    if (first == last) {
+        if (file->rangeCount == file->rangeCapacity) {
+            uint32_t capacity = file->rangeCapacity ? file->rangeCapacity * 2 : 8;
+            AdRange *ranges = realloc(file->ranges, capacity * sizeof(AdRange));
+
+            if (ranges == NULL) {
+                return -1;
+            }
+            file->ranges = ranges;
+            file->rangeCapacity = capacity;
+        }
+        memmove(file->ranges + first + 1, file->ranges + first, (file->rangeCount - first) * sizeof(AdRange));
+        file->ranges[first].start = start;
+        file->ranges[first].end = end;
+        file->rangeCount++;
+        file->cachedBytes += end - start;
+        return 0;
+    }
+
+    for (uint32_t i = first; i < last; i++) {
+        file->cachedBytes -= file->ranges[i].end - file->ranges[i].start;
+    }
+    if (file->ranges[first].start < start) {
+        start = file->ranges[first].start;
+    }
+    if (file->ranges[last - 1].end > end) {
+        end = file->ranges[last - 1].end;
+    }
+    file->ranges[first].start = start;
+    file->ranges[first].end = end;
+    file->cachedBytes += end - start;
+    memmove(file->ranges + first + 1, file->ranges + last, (file->rangeCount - last) * sizeof(AdRange));
+    file->rangeCount -= last - first - 1;
+    return 0;
+}
+
+// Map
+
+static int AdRangeWriteMap(AdRangeFile *file)
+{
+    FILE *stream = fopen(file->temporaryPath, "w");
+    int failed;
+
+    if (stream == NULL) {
+        return -1;
+    }
+    fprintf(stream, "%s\n%" PRIu64 "\n%s\n", kAdRangeMapMagic, file->length, file->validator);
+    for (uint32_t i = 0; i < file->rangeCount; i++) {
+        fprintf(stream, "%" PRIu64 " %" PRIu64 "\n", file->ranges[i].start, file->ranges[i].end);
+    }
+    failed = ferror(stream);
+    if (fclose(stream) != 0 || failed || rename(file->temporaryPath, file->mapPath) != 0) {
+        unlink(file->temporaryPath);
+        return -1;
+    }
+    return 0;
+}
+
+/** Reads the map, keeping only the ranges the data file still holds. A missing or damaged map leaves the file empty. */
+static void AdRangeReadMap(AdRangeFile *file)
+{
+    FILE *stream = fopen(file->mapPath, "r");
+    char line[kAdRangeValidatorMaxLength + 2];
+    struct stat info;
+    uint64_t start, end;
+
+    if (stream == NULL) {
+        return;
+    }
+    if (fgets(line, sizeof(line), stream) == NULL || strncmp(line, kAdRangeMapMagic "\n", sizeof(kAdRangeMapMagic)) != 0
+        || fgets(line, sizeof(line), stream) == NULL || sscanf(line, "%" SCNu64, &file->length) != 1
+        || fgets(line, sizeof(line), stream) == NULL) {
+        file->length = 0;
+        fclose(stream);
+        return;
+    }
+    line[strcspn(line, "\n")] = '\0';
+    memcpy(file->validator, line, strlen(line) + 1);
+
+    // The data file may have been purged or truncated behind the map.
+    if (fstat(file->fd, &info) != 0) {
+        info.st_size = 0;
+    }
+    while (fscanf(stream, "%" SCNu64 " %" SCNu64 "\n", &start, &end) == 2) {
+        if (end > (uint64_t)info.st_size) {
+            end = (uint64_t)info.st_size;
+        }
+        if (start < end && (file->length == 0 || end <= file->length) && AdRangeInsert(file, start, end) != 0) {
+            break;
+        }
+    }
+    fclose(stream);
+}
+
+/** Forgets the cached bytes, and gives their blocks back. */
+static void AdRangeDiscard(AdRangeFile *file)
+{
+    file->rangeCount = 0;
+    file->cachedBytes = 0;
+    file->length = 0;
+    if (ftruncate(file->fd, 0) != 0) {
+        // The map no longer lists the bytes, they are unreachable either way.
+    }
+}
+
+// File
+
+AdRangeFile *AdRangeFileOpen(const char *path)
+{
+    AdRangeFile *file = calloc(1, sizeof(AdRangeFile));
+
+    if (file == NULL) {
+        return NULL;
+    }
+    file->mapPath = AdRangeCopyPath(path, kAdRangeMapSuffix);
+    file->temporaryPath = AdRangeCopyPath(path, kAdRangeMapTemporarySuffix);
+    file->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (file->mapPath == NULL || file->temporaryPath == NULL || file->fd < 0) {
+        int error = file->fd < 0 ? errno : ENOMEM;
+
+        AdRangeFileClose(file);
+        errno = error;
+        return NULL;
+    }
+    AdRangeReadMap(file);
+    return file;
+}
+
+void AdRangeFileClose(AdRangeFile *file)
+{
+    if (file == NULL) {
+        return;
+    }
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    free(file->mapPath);
+    free(file->temporaryPath);
+    free(file->ranges);
+    free(file);
+}
+
+void AdRangeFileRemove(const char *path)
+{
+    char *mapPath = AdRangeCopyPath(path, kAdRangeMapSuffix);
+
+    unlink(path);
+    if (mapPath) {
+        unlink(mapPath);
+        free(mapPath);
+    }
+}
+
+int AdRangeFileSetValidator(AdRangeFile *file, const char *validator)
+{
+    size_t length = validator ? strlen(validator) : 0;
+    int discarded = 0;
+
+    if (length > kAdRangeValidatorMaxLength) {
+        length = kAdRangeValidatorMaxLength;
+    }
+    if (length == strlen(file->validator) && (length == 0 || memcmp(file->validator, validator, length) == 0)) {
+        return 0;
+    }
+    // Without a previous validator the cached bytes cannot be told apart, they are kept.
+    if (file->validator[0] != '\0') {
+        AdRangeDiscard(file);
+        discarded = 1;
+    }
+    if (length > 0) {
+        memcpy(file->validator, validator, length);
+    }
+    file->validator[length] = '\0';
+    AdRangeWriteMap(file);
+    return discarded;
+}
+
+const char *AdRangeFileGetValidator(const AdRangeFile *file)
+{
+    return file->validator;
+}
+
+int AdRangeFileSetLength(AdRangeFile *file, uint64_t length)
+{
+    int discarded = 0;
+
+    if (length == file->length) {
+        return 0;
+    }
+    if (file->length != 0 || (file->rangeCount > 0 && file->ranges[file->rangeCount - 1].end > length)) {
+        AdRangeDiscard(file);
+        discarded = 1;
+    }
+    // The file takes its full size at once; the gaps stay holes until they are written.
+    if (ftruncate(file->fd, (off_t)length) != 0) {
+        return -1;
+    }
+    file->length = length;
+    return AdRangeWriteMap(file) == 0 ? discarded : -1;
+}
+
+uint64_t AdRangeFileGetLength(const AdRangeFile *file)
+{
+    return file->length;
+}
+
+int AdRangeFileWrite(AdRangeFile *file, uint64_t offset, const void *bytes, size_t length)
+{
+    const uint8_t *cursor = bytes;
+    size_t written = 0;
+
+    if (file->length != 0 && (offset > file->length || length > file->length - offset)) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (written < length) {
+        ssize_t count = pwrite(file->fd, cursor + written, length - written, (off_t)(offset + written));
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        written += (size_t)count;
+    }
+    if (length == 0) {
+        return 0;
+    }
+    if (AdRangeInsert(file, offset, offset + length) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return AdRangeWriteMap(file);
+}
+
+ssize_t AdRangeFileRead(AdRangeFile *file, uint64_t offset, void *bytes, size_t length)
+{
+    uint64_t available = AdRangeFileGetAvailable(file, offset);
+    size_t read = 0;
+
+    if (available < length) {
+        length = (size_t)available;
+    }
+    while (read < length) {
+        ssize_t count = pread(file->fd, (uint8_t *)bytes + read, length - read, (off_t)(offset + read));
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return count < 0 ? -1 : (ssize_t)read;
+        }
+        read += (size_t)count;
+    }
+    return (ssize_t)read;
+}
+
+uint64_t AdRangeFileGetAvailable(const AdRangeFile *file, uint64_t offset)
+{
+    uint32_t index = AdRangeFind(file, offset);
+
+    if (index == file->rangeCount || file->ranges[index].start > offset) {
+        return 0;
+    }
+    return file->ranges[index].end - offset;
+}
+
+int AdRangeFileGetNextMissing(const AdRangeFile *file, uint64_t start, uint64_t end, uint64_t maxLength, AdRange *range)
+{
+    uint32_t index;
+
+    if (file->length != 0 && end > file->length) {
+        end = file->length;
+    }
+    index = AdRangeFind(file, start);
+    if (index < file->rangeCount && file->ranges[index].start <= start) {
+        start = file->ranges[index].end;
+        index++;
+    }
+    if (start >= end || maxLength == 0) {
+        return -1;
+    }
+    if (index < file->rangeCount && file->ranges[index].start < end) {
+        end = file->ranges[index].start;
+    }
+    if (end - start > maxLength) {
+        end = start + maxLength;
+    }
+    range->start = start;
+    range->end = end;
+    return 0;
+}
+
+uint64_t AdRangeFileGetCachedBytes(const AdRangeFile *file)
+{
+    return file->cachedBytes;
+}
+
+uint32_t AdRangeFileGetRangeCount(const AdRangeFile *file)
+{
+    return file->rangeCount;
+}
+
+int AdRangeFileIsComplete(const AdRangeFile *file)
+{
+    return file->length != 0 && file->cachedBytes == file->length;
+}
@@ -0,0 +1,80 @@
+//
+//  AdRangeFile.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Sparse file cache of one video creative, filled by HTTP range requests.
+
+ A video is downloaded in pieces: its first seconds when the ad is prefetched, then the next chunks
+ while it plays, and nothing more once it is skipped. The pieces are written at their offset in a
+ sparse file, and the ranges that are cached are kept sorted and merged in a small map next to it
+ (the path followed by ".ranges"), rewritten and renamed into place after each write, so that the
+ cache survives relaunches. A range is recorded once its bytes are written.
+
+ The map also holds the length of the video and its validator (the ETag, or else Last-Modified):
+ a different length or validator means the creative changed and discards the cached bytes.
+
+ This file is plain C. A range file is not thread safe, callers serialize access.
+ */
+
+#ifndef DemoSmart_AdRangeFile_h
+#define DemoSmart_AdRangeFile_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;           /* excluded */
+} AdRange;
+
+typedef struct AdRangeFile AdRangeFile;
+
+/** Opens or creates the file and its map. Returns NULL and sets errno on failure. */
+AdRangeFile *AdRangeFileOpen(const char *path);
+void AdRangeFileClose(AdRangeFile *file);
+
+/** Deletes the file and its map. */
+void AdRangeFileRemove(const char *path);
+
+/** Sets the validator of the response. Returns 1 if it differed from the stored one and the cached bytes were discarded, 0 otherwise. */
+int AdRangeFileSetValidator(AdRangeFile *file, const char *validator);
+
+/** The stored validator, "" if there is none. */
+const char *AdRangeFileGetValidator(const AdRangeFile *file);
+
+/** Sets the length of the video, the total of a Content-Range. Returns 1 if the cached bytes were discarded, 0 otherwise, -1 on failure. */
+int AdRangeFileSetLength(AdRangeFile *file, uint64_t length);
+
+/** The length of the video, 0 while it is not known. */
+uint64_t AdRangeFileGetLength(const AdRangeFile *file);
+
+/** Writes downloaded bytes at their offset and records their range. Returns 0, or -1 with errno set (EINVAL past the length). */
+int AdRangeFileWrite(AdRangeFile *file, uint64_t offset, const void *bytes, size_t length);
+
+/** Reads cached bytes from an offset, up to the first byte that is not cached. Returns the number read, 0 if the offset is not cached, -1 on failure. */
+ssize_t AdRangeFileRead(AdRangeFile *file, uint64_t offset, void *bytes, size_t length);
+
+/** The number of cached bytes that follow an offset without a gap. */
+uint64_t AdRangeFileGetAvailable(const AdRangeFile *file, uint64_t offset);
+
+/** Finds the first bytes of [start, end) that are not cached, at most maxLength of them, to request next.
+
+ end is clipped to the length when it is known.
+
+ @return 0 and sets range, or -1 if [start, end) is entirely cached.
+ */
+int AdRangeFileGetNextMissing(const AdRangeFile *file, uint64_t start, uint64_t end, uint64_t maxLength, AdRange *range);
+
+uint64_t AdRangeFileGetCachedBytes(const AdRangeFile *file);
+uint32_t AdRangeFileGetRangeCount(const AdRangeFile *file);
+
+/** Whether the length is known and every byte is cached. */
+int AdRangeFileIsComplete(const AdRangeFile *file);
+
+#endif
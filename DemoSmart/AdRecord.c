@@ -0,0 +1,284 @@
+//
+//  AdRecord.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdRecord.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define AdRecordAlign(x) (((x) + (kAdRecordAlignment - 1)) & ~(size_t)(kAdRecordAlignment - 1))
+
+typedef struct {
+    uint32_t list;
+    uint32_t offset;    /* in the string heap */
+    uint32_t length;
+} AdRecordPendingItem;
+
+struct AdRecordBuilder {
+    AdRecordHeader header;
+
+    char *heap;
+    size_t heapLength;
+    size_t heapCapacity;
+
+    AdRecordPendingItem *items;
+    uint32_t itemCount;
+    uint32_t itemCapacity;
+
+    char *output;
+    size_t outputCapacity;
+};
+
+// Reading
+
+static int AdRecordSliceIsValid(const AdRecordSlot *slot, size_t length)
+{
+    if (slot->offset == 0 && slot->length == 0) {
+        return 1;
+    }
+    return slot->offset >= sizeof(AdRecordHeader)
+        && (uint64_t)slot->offset + slot->length < length;
+}
+
+const AdRecordHeader *AdRecordValidate(const void *bytes, size_t length)
+{
+    const AdRecordHeader *record = bytes;
+    const char *base = bytes;
+
+    if (bytes == NULL || length < sizeof(AdRecordHeader) || ((uintptr_t)bytes & (kAdRecordAlignment - 1)) != 0) {
+        return NULL;
+    }
+    if (record->magic != kAdRecordMagic || record->version == 0 || record->version > kAdRecordVersion) {
+        return NULL;
+    }
+    if (record->headerLength < sizeof(AdRecordHeader) || record->totalLength > length || record->totalLength < record->headerLength) {
+        return NULL;
+    }
+    length = record->totalLength;
+
+    for (int i = 0; i < AdRecordStringCount; i++) {
+        const AdRecordSlot *slot = &record->strings[i];
+        if (!AdRecordSliceIsValid(slot, length) || (slot->offset != 0 && base[slot->offset + slot->length] != '\0')) {
+            return NULL;
+        }
+    }
+    for (int i = 0; i < AdRecordListCount; i++) {
+        const AdRecordSlot *list = &record->lists[i];
+        const AdRecordSlot *items;
+        if (list->length == 0) {
+            continue;
+        }
+        if (list->offset < sizeof(AdRecordHeader) || (list->offset & 3) != 0
+            || (uint64_t)list->offset + (uint64_t)list->length * sizeof(AdRecordSlot) > length) {
+            return NULL;
+        }
+        items = (const AdRecordSlot *)(base + list->offset);
+        for (uint32_t j = 0; j < list->length; j++) {
+            if (items[j].offset == 0 || !AdRecordSliceIsValid(&items[j], length) || base[items[j].offset + items[j].length] != '\0') {
+                return NULL;
+            }
+        }
+    }
+    return record;
+}
+
+static AdRecordSlice AdRecordSliceMake(const AdRecordHeader *record, const AdRecordSlot *slot)
+{
+    AdRecordSlice slice = { NULL, 0 };
+    if (slot->offset != 0) {
+        slice.bytes = (const char *)record + slot->offset;
+        slice.length = slot->length;
+    }
+    return slice;
+}
+
+AdRecordSlice AdRecordGetString(const AdRecordHeader *record, AdRecordString field)
+{
+    return AdRecordSliceMake(record, &record->strings[field]);
+}
+
+uint32_t AdRecordGetListCount(const AdRecordHeader *record, AdRecordList list)
+{
+    return record->lists[list].length;
+}
+
+AdRecordSlice AdRecordGetListItem(const AdRecordHeader *record, AdRecordList list, uint32_t index)
+{
+    AdRecordSlice empty = { NULL, 0 };
+    const AdRecordSlot *items;
+
+    if (index >= record->lists[list].length) {
+        return empty;
+    }
+    items = (const AdRecordSlot *)((const char *)record + record->lists[list].offset);
+    return AdRecordSliceMake(record, &items[index]);
+}
+
+// Building
+
+AdRecordBuilder *AdRecordBuilderCreate(void)
+{
+    return calloc(1, sizeof(AdRecordBuilder));
+}
+
+void AdRecordBuilderRelease(AdRecordBuilder *builder)
+{
+    if (builder == NULL) {
+        return;
+    }
+    free(builder->heap);
+    free(builder->items);
+    free(builder->output);
+    free(builder);
+}
+
+void AdRecordBuilderReset(AdRecordBuilder *builder)
+{
+    memset(&builder->header, 0, sizeof(builder->header));
+    builder->heapLength = 0;
+    builder->itemCount = 0;
+}
+
+AdRecordHeader *AdRecordBuilderGetHeader(AdRecordBuilder *builder)
+{
+    return &builder->header;
+}
+
+static int AdRecordBuilderAppend(AdRecordBuilder *builder, const char *bytes, size_t length, uint32_t *offset)
+{
+    size_t needed = builder->heapLength + length + 1;
+
+    if (length > UINT32_MAX / 2 || needed > UINT32_MAX / 2) {
+        return -1;
+    }
+    if (needed > builder->heapCapacity) {
+        size_t capacity = builder->heapCapacity ? builder->heapCapacity * 2 : 1024;
+        char *heap;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        heap = realloc(builder->heap, capacity);
+        if (heap == NULL) {
+            return -1;
+        }
+        builder->heap = heap;
+        builder->heapCapacity = capacity;
+    }
+    *offset = (uint32_t)builder->heapLength;
+    if (length > 0) {
+        memcpy(builder->heap + builder->heapLength, bytes, length);
+    }
+    builder->heap[builder->heapLength + length] = '\0';
+    builder->heapLength = needed;
+    return 0;
+}
+
+int AdRecordBuilderSetString(AdRecordBuilder *builder, AdRecordString field, const char *bytes, size_t length)
+{
+    uint32_t offset;
+
+    if (bytes == NULL) {
+        builder->header.strings[field].offset = 0;
+        builder->header.strings[field].length = 0;
+        return 0;
+    }
+    if (AdRecordBuilderAppend(builder, bytes, length, &offset) != 0) {
+        return -1;
+    }
+    // Heap offsets are biased by one until the layout is known, zero means "not set".
+    builder->header.strings[field].offset = offset + 1;
+    builder->header.strings[field].length = (uint32_t)length;
+    return 0;
+}
+
+int AdRecordBuilderAddListItem(AdRecordBuilder *builder, AdRecordList list, const char *bytes, size_t length)
+{
+    AdRecordPendingItem *item;
+    uint32_t offset;
+
+    if (bytes == NULL) {
+        return -1;
+    }
+    if (builder->itemCount == builder->itemCapacity) {
+        uint32_t capacity = builder->itemCapacity ? builder->itemCapacity * 2 : 16;
+        AdRecordPendingItem *items = realloc(builder->items, capacity * sizeof(AdRecordPendingItem));
+        if (items == NULL) {
+            return -1;
+        }
+        builder->items = items;
+        builder->itemCapacity = capacity;
+    }
+    if (AdRecordBuilderAppend(builder, bytes, length, &offset) != 0) {
+        return -1;
+    }
+    item = &builder->items[builder->itemCount++];
+    item->list = list;
+    item->offset = offset;
+    item->length = (uint32_t)length;
+    return 0;
+}
+
+const void *AdRecordBuilderFinish(AdRecordBuilder *builder, size_t *length)
+{
+    AdRecordHeader *header;
+    size_t slotsOffset = sizeof(AdRecordHeader);
+    size_t heapOffset = AdRecordAlign(slotsOffset + builder->itemCount * sizeof(AdRecordSlot));
+    size_t total = AdRecordAlign(heapOffset + builder->heapLength);
+    uint32_t counts[AdRecordListCount] = { 0 };
+    uint32_t next[AdRecordListCount];
+
+    if (total > UINT32_MAX) {
+        return NULL;
+    }
+    if (total > builder->outputCapacity) {
+        char *output = realloc(builder->output, total);
+        if (output == NULL) {
+            return NULL;
+        }
+        builder->output = output;
+        builder->outputCapacity = total;
+    }
+    memset(builder->output, 0, total);
+
+    header = (AdRecordHeader *)builder->output;
+    *header = builder->header;
+    header->magic = kAdRecordMagic;
+    header->version = kAdRecordVersion;
+    header->headerLength = sizeof(AdRecordHeader);
+    header->totalLength = (uint32_t)total;
+
+    for (int l = 0; l < AdRecordStringCount; l++) {
+        if (header->strings[l].offset != 0) {
+            header->strings[l].offset += (uint32_t)heapOffset - 1;
+        }
+    }
+
+    // Items of a list are contiguous in the slot table, in the order they were added.
+    for (uint32_t i = 0; i < builder->itemCount; i++) {
+        counts[builder->items[i].list]++;
+    }
+    for (int l = 0; l < AdRecordListCount; l++) {
+        next[l] = (uint32_t)slotsOffset;
+        header->lists[l].offset = counts[l] ? (uint32_t)slotsOffset : 0;
+        header->lists[l].length = counts[l];
+        slotsOffset += counts[l] * sizeof(AdRecordSlot);
+    }
+    for (uint32_t i = 0; i < builder->itemCount; i++) {
+        const AdRecordPendingItem *item = &builder->items[i];
+        AdRecordSlot *slot = (AdRecordSlot *)(builder->output + next[item->list]);
+        slot->offset = (uint32_t)heapOffset + item->offset;
+        slot->length = item->length;
+        next[item->list] += sizeof(AdRecordSlot);
+    }
+
+    if (builder->heapLength > 0) {
+        memcpy(builder->output + heapOffset, builder->heap, builder->heapLength);
+    }
+    *length = total;
+    return builder->output;
+}
@@ -0,0 +1,137 @@
+//
+//  AdRecord.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Versioned flat binary layout for the fields of a SmartAdServerAd.
+
+ A record is a fixed AdRecordHeader followed by the list slot tables and the string bytes.
+ Every string is stored as NUL terminated UTF-8 and is addressed by an (offset, length) slot
+ relative to the start of the record, so a validated record can be read in place from an
+ mmap'd buffer without any copy or allocation.
+
+ Records are little-endian and padded to 8 bytes, so they can be concatenated in a log.
+ This file is plain C and has no dependency on Foundation.
+ */
+
+#ifndef DemoSmart_AdRecord_h
+#define DemoSmart_AdRecord_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdRecordMagic      0x52444153u   /* "SADR" read as a little-endian uint32 */
+#define kAdRecordVersion    1
+#define kAdRecordAlignment  8
+
+typedef enum {
+    AdRecordStringCreativeURL,
+    AdRecordStringCreativeLandscapeURL,
+    AdRecordStringRedirectURL,
+    AdRecordStringRedirectLandscapeURL,
+    AdRecordStringCountURL,
+    AdRecordStringCountLandscapeURL,
+    AdRecordStringImpPixel,
+    AdRecordStringImpLandscapePixel,
+    AdRecordStringText,
+    AdRecordStringCreativeScript,
+    AdRecordStringCreativeScriptURL,
+    AdRecordStringCount
+} AdRecordString;
+
+typedef enum {
+    AdRecordListAgencyPortraitPixels,
+    AdRecordListAgencyLandscapePixels,
+    AdRecordListCount
+} AdRecordList;
+
+typedef enum {
+    AdRecordFlagExpandedAtInit                  = 1 << 0,
+    AdRecordFlagExpand                          = 1 << 1,
+    AdRecordFlagNavigationHasControls           = 1 << 2,
+    AdRecordFlagFromTop                         = 1 << 3,
+    AdRecordFlagTransparentBackground           = 1 << 4,
+    AdRecordFlagAskConfirmationBeforeClosingApp = 1 << 5,
+    AdRecordFlagVideoAutoPlay                   = 1 << 6,
+    AdRecordFlagSkip                            = 1 << 7,
+    AdRecordFlagRedirectsToThirdParty           = 1 << 8,
+    AdRecordFlagIsSkipPositionDefined           = 1 << 9,
+    AdRecordFlagIsOffline                       = 1 << 10,
+    AdRecordFlagIsConnectionNeeded              = 1 << 11,
+    AdRecordFlagAddStandardTrigger              = 1 << 12,
+    AdRecordFlagHasBackgroundColor              = 1 << 13,
+    AdRecordFlagHasTextColor                    = 1 << 14,
+    AdRecordFlagHasExpirationDate               = 1 << 15,
+    AdRecordFlagAgencyPixelsAreStrings          = 1 << 16   /* the pixel lists held NSString rather than NSURL items */
+} AdRecordFlag;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} AdRecordSlot;
+
+typedef struct {
+    const char *bytes;      /* NUL terminated, NULL when the field is not set */
+    uint32_t length;
+} AdRecordSlice;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerLength;          /* lets newer versions append fields to the header */
+    uint32_t totalLength;
+    uint32_t flags;                 /* AdRecordFlag */
+
+    int64_t insertionId;
+    double expirationDate;          /* seconds since 1970 */
+
+    float duration;
+    uint32_t creativeType;
+    uint32_t skipPosition;
+    float expandedHeight;
+    float expandedLandscapeHeight;
+    float triggerHeight;
+    float triggerLandscapeHeight;
+    float imageSize[2];
+    float landscapeImageSize[2];
+    float videoSize[2];
+    float backgroundColor[4];       /* RGBA */
+    float textColor[4];             /* RGBA */
+
+    AdRecordSlot strings[AdRecordStringCount];
+    AdRecordSlot lists[AdRecordListCount];  /* offset of a slot table, length is the item count */
+} AdRecordHeader;
+
+/** Returns the header if the bytes hold a complete record of a supported version, NULL otherwise.
+
+ All slots are bounds checked, so accessors never read outside of the first length bytes.
+ */
+const AdRecordHeader *AdRecordValidate(const void *bytes, size_t length);
+
+AdRecordSlice AdRecordGetString(const AdRecordHeader *record, AdRecordString field);
+uint32_t AdRecordGetListCount(const AdRecordHeader *record, AdRecordList list);
+AdRecordSlice AdRecordGetListItem(const AdRecordHeader *record, AdRecordList list, uint32_t index);
+
+/** Accumulates fields and lays them out as a record. Strings are copied when set. */
+typedef struct AdRecordBuilder AdRecordBuilder;
+
+AdRecordBuilder *AdRecordBuilderCreate(void);
+void AdRecordBuilderRelease(AdRecordBuilder *builder);
+
+/** Clears every field so that the builder and its buffers can be reused for another record. */
+void AdRecordBuilderReset(AdRecordBuilder *builder);
+
+/** The scalar part of the record. Offsets, lengths, magic and version are filled in by the builder. */
+AdRecordHeader *AdRecordBuilderGetHeader(AdRecordBuilder *builder);
+
+int AdRecordBuilderSetString(AdRecordBuilder *builder, AdRecordString field, const char *bytes, size_t length);
+int AdRecordBuilderAddListItem(AdRecordBuilder *builder, AdRecordList list, const char *bytes, size_t length);
+
+/** Lays out the record and returns it. The bytes are owned by the builder until its next reset. */
+const void *AdRecordBuilderFinish(AdRecordBuilder *builder, size_t *length);
+
+#endif
@@ -0,0 +1,95 @@
+//
+//  AdRefreshScheduler.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SASBannerView.h"
+
+/**
+ Refreshes SASBannerView objects at their interval, only while the user can see them.
+
+ Every banner shares one timer wheel with a tick of a second, driven by a single timer on the main
+ queue, so banners due in the same second refresh in one wake-up and the system is given leeway to
+ coalesce it with other work. When a banner is due but not visible (out of a window, hidden, or less
+ than minimumVisibleFraction of it on screen, scrolled away for example) or the app is not active,
+ the refresh is skipped and the banner is checked again every few seconds: it refreshes as soon as
+ it shows up again rather than a full interval later.
+
+ Intervals are stretched while the battery is low or the device is on a cellular network, and the
+ refreshes saved by skipping and stretching are counted.
+
+    [[AdRefreshScheduler sharedScheduler] scheduleBanner:bannerView interval:60];
+
+ Banners are held weakly, a deallocated banner is forgotten. Use the scheduler from the main thread.
+ */
+
+@interface AdRefreshScheduler : NSObject
+
++ (AdRefreshScheduler *)sharedScheduler;
+
+/** Interval multiplier while the battery is below 20% and unplugged, or in low power mode, 2 by default.
+
+ */
+
+@property (nonatomic, assign) double lowBatteryStretch;
+
+/** Interval multiplier while on a cellular network, 1.5 by default.
+
+ */
+
+@property (nonatomic, assign) double meteredNetworkStretch;
+
+/** The part of a banner that must be on screen for it to refresh, 0.5 by default.
+
+ */
+
+@property (nonatomic, assign) CGFloat minimumVisibleFraction;
+
+/** Refreshes the banner every interval seconds, the first time an interval from now. Scheduling a banner again changes its interval.
+
+ */
+
+- (void)scheduleBanner:(SASBannerView *)banner interval:(NSTimeInterval)interval;
+
+- (void)unscheduleBanner:(SASBannerView *)banner;
+
+/** Call after showing a banner again, to refresh it right away if it missed its refresh while hidden.
+
+ */
+
+- (void)bannerVisibilityDidChange:(SASBannerView *)banner;
+
+- (NSUInteger)bannerCount;
+
+- (NSUInteger)refreshCount;
+
+/** Refreshes skipped because the banner was not visible, once per missed interval.
+
+ */
+
+- (NSUInteger)hiddenSkipCount;
+
+/** Refreshes skipped because the app was not active, once per missed interval.
+
+ */
+
+- (NSUInteger)backgroundSkipCount;
+
+/** Refreshes saved by stretched intervals: an interval stretched by 2 saves one refresh.
+
+ */
+
+- (NSUInteger)stretchSavingCount;
+
+/** The sum of the skipped refreshes and of the stretch savings.
+
+ */
+
+- (NSUInteger)savedRefreshCount;
+
+@end
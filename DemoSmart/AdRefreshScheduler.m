@@ -0,0 +1,348 @@
+//
+//  AdRefreshScheduler.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdRefreshScheduler.h"
+#import "AdTimerWheel.h"
+
+#import <SystemConfiguration/SystemConfiguration.h>
+#import <netinet/in.h>
+
+#include <math.h>
+
+static const uint32_t kAdRefreshWheelSlots = 64;
+static const NSTimeInterval kAdRefreshRecheckInterval = 5;
+static const NSTimeInterval kAdRefreshMinimumLeeway = 0.5;
+static const float kAdRefreshLowBatteryLevel = 0.2f;
+
+@interface AdRefreshEntry : NSObject
+
+@property (nonatomic, weak) SASBannerView *banner;
+@property (nonatomic, assign) NSTimeInterval interval;
+@property (nonatomic, assign) AdTimer timer;
+/** The date of the next refresh. Past it, the banner is overdue and refreshes as soon as it is visible. */
+@property (nonatomic, assign) CFAbsoluteTime dueDate;
+/** The date past which one more skipped refresh is counted. */
+@property (nonatomic, assign) CFAbsoluteTime skipDate;
+
+@end
+
+@implementation AdRefreshEntry
+
+@end
+
+@implementation AdRefreshScheduler
+{
+    AdTimerWheel *_wheel;
+    CFAbsoluteTime _startDate;
+    dispatch_source_t _timer;
+    NSMapTable *_entriesByBanner;
+    NSMutableSet *_entries;
+    SCNetworkReachabilityRef _reachability;
+
+    NSUInteger _refreshCount;
+    NSUInteger _hiddenSkipCount;
+    NSUInteger _backgroundSkipCount;
+    double _stretchSavings;
+}
+
+static void AdRefreshSchedulerTimerDidExpire(void *info, AdTimer timer, void *context)
+{
+    [(__bridge AdRefreshScheduler *)info entryIsDue:(__bridge AdRefreshEntry *)context];
+}
+
++ (AdRefreshScheduler *)sharedScheduler
+{
+    static AdRefreshScheduler *sharedScheduler = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedScheduler = [[AdRefreshScheduler alloc] init];
+    });
+    return sharedScheduler;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        struct sockaddr_in address = { .sin_len = sizeof(struct sockaddr_in), .sin_family = AF_INET };
+
+        _wheel = AdTimerWheelCreate(kAdRefreshWheelSlots);
+        if (_wheel == NULL) {
+            return nil;
+        }
+        _startDate = CFAbsoluteTimeGetCurrent();
+        _entriesByBanner = [NSMapTable weakToStrongObjectsMapTable];
+        _entries = [NSMutableSet set];
+        _reachability = SCNetworkReachabilityCreateWithAddress(kCFAllocatorDefault, (const struct sockaddr *)&address);
+
+        self.lowBatteryStretch = 2;
+        self.meteredNetworkStretch = 1.5;
+        self.minimumVisibleFraction = 0.5;
+
+        [UIDevice currentDevice].batteryMonitoringEnabled = YES;
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidBecomeActive:)
+                                                     name:UIApplicationDidBecomeActiveNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+    if (_reachability) {
+        CFRelease(_reachability);
+    }
+    AdTimerWheelRelease(_wheel);
+}
+
+#pragma mark - Banners
+
+- (void)scheduleBanner:(SASBannerView *)banner interval:(NSTimeInterval)interval
+{
+    AdRefreshEntry *entry = [_entriesByBanner objectForKey:banner];
+
+    if (entry == nil) {
+        entry = [[AdRefreshEntry alloc] init];
+        entry.banner = banner;
+        [_entriesByBanner setObject:entry forKey:banner];
+        [_entries addObject:entry];
+    }
+    entry.interval = MAX(interval, 1);
+    [self scheduleEntry:entry dueDate:CFAbsoluteTimeGetCurrent() + entry.interval * [self stretch]];
+}
+
+- (void)unscheduleBanner:(SASBannerView *)banner
+{
+    AdRefreshEntry *entry = [_entriesByBanner objectForKey:banner];
+
+    if (entry) {
+        [self removeEntry:entry];
+        [self armTimer];
+    }
+}
+
+- (void)bannerVisibilityDidChange:(SASBannerView *)banner
+{
+    AdRefreshEntry *entry = [_entriesByBanner objectForKey:banner];
+
+    if (entry && entry.dueDate <= CFAbsoluteTimeGetCurrent()) {
+        [self checkEntryNow:entry];
+    }
+}
+
+- (void)applicationDidBecomeActive:(NSNotification *)notification
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    for (AdRefreshEntry *entry in [_entries allObjects]) {
+        if (entry.dueDate <= now) {
+            [self checkEntryNow:entry];
+        }
+    }
+}
+
+- (void)removeEntry:(AdRefreshEntry *)entry
+{
+    AdTimerWheelCancel(_wheel, entry.timer);
+    if (entry.banner) {
+        [_entriesByBanner removeObjectForKey:entry.banner];
+    }
+    [_entries removeObject:entry];
+}
+
+#pragma mark - Refresh
+
+/** Whether the user can see the banner: in a window, not hidden by it or an ancestor, and mostly within the clipping ancestors. */
+- (BOOL)isBannerVisible:(SASBannerView *)banner
+{
+    UIWindow *window = banner.window;
+    CGRect frame = [banner convertRect:banner.bounds toView:nil];
+    CGRect visible = frame;
+
+    if (window == nil || window.hidden || CGRectIsEmpty(frame)) {
+        return NO;
+    }
+    for (UIView *view = banner; view; view = view.superview) {
+        if (view.hidden || view.alpha < 0.01) {
+            return NO;
+        }
+        if (view.clipsToBounds || view == window) {
+            visible = CGRectIntersection(visible, [view convertRect:view.bounds toView:nil]);
+        }
+    }
+    if (CGRectIsNull(visible)) {
+        return NO;
+    }
+    return visible.size.width * visible.size.height >= self.minimumVisibleFraction * frame.size.width * frame.size.height;
+}
+
+- (BOOL)isBatteryLow
+{
+    UIDevice *device = [UIDevice currentDevice];
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+
+    // Low power mode only exists on iOS 9 and later.
+    if ([processInfo respondsToSelector:NSSelectorFromString(@"isLowPowerModeEnabled")] && [[processInfo valueForKey:@"lowPowerModeEnabled"] boolValue]) {
+        return YES;
+    }
+    return device.batteryState == UIDeviceBatteryStateUnplugged && device.batteryLevel >= 0 && device.batteryLevel < kAdRefreshLowBatteryLevel;
+}
+
+- (BOOL)isNetworkMetered
+{
+    SCNetworkReachabilityFlags flags = 0;
+
+    return _reachability && SCNetworkReachabilityGetFlags(_reachability, &flags) && (flags & kSCNetworkReachabilityFlagsIsWWAN);
+}
+
+- (double)stretch
+{
+    double stretch = 1;
+
+    if ([self isBatteryLow]) {
+        stretch *= MAX(self.lowBatteryStretch, 1);
+    }
+    if ([self isNetworkMetered]) {
+        stretch *= MAX(self.meteredNetworkStretch, 1);
+    }
+    return stretch;
+}
+
+- (void)entryIsDue:(AdRefreshEntry *)entry
+{
+    SASBannerView *banner = entry.banner;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    BOOL active = [UIApplication sharedApplication].applicationState == UIApplicationStateActive;
+    double stretch;
+
+    entry.timer = kAdTimerNone;
+    if (banner == nil) {
+        [_entries removeObject:entry];
+        return;
+    }
+    if (!active || ![self isBannerVisible:banner]) {
+        // Each interval spent out of sight counts one skipped refresh.
+        while (entry.skipDate <= now) {
+            if (active) {
+                _hiddenSkipCount++;
+            } else {
+                _backgroundSkipCount++;
+            }
+            entry.skipDate += entry.interval;
+        }
+        [self scheduleTimerForEntry:entry date:now + kAdRefreshRecheckInterval];
+        return;
+    }
+
+    [banner refresh];
+    _refreshCount++;
+    stretch = [self stretch];
+    _stretchSavings += stretch - 1;
+    [self scheduleEntry:entry dueDate:now + entry.interval * stretch];
+}
+
+- (void)checkEntryNow:(AdRefreshEntry *)entry
+{
+    AdTimerWheelCancel(_wheel, entry.timer);
+    entry.timer = kAdTimerNone;
+    [self entryIsDue:entry];
+    [self armTimer];
+}
+
+- (void)scheduleEntry:(AdRefreshEntry *)entry dueDate:(CFAbsoluteTime)dueDate
+{
+    entry.dueDate = dueDate;
+    entry.skipDate = dueDate;
+    [self scheduleTimerForEntry:entry date:dueDate];
+    [self armTimer];
+}
+
+- (void)scheduleTimerForEntry:(AdRefreshEntry *)entry date:(CFAbsoluteTime)date
+{
+    uint64_t tick = (uint64_t)ceil(MAX(date - _startDate, 0));
+    uint64_t now = AdTimerWheelGetTime(_wheel);
+
+    AdTimerWheelCancel(_wheel, entry.timer);
+    // The entry is retained by _entries while its timer is pending.
+    entry.timer = AdTimerWheelSchedule(_wheel, tick > now ? tick - now : 1, (__bridge void *)entry);
+}
+
+#pragma mark - Timer
+
+/** Arms the single timer for the next expiration of the wheel. */
+- (void)armTimer
+{
+    uint64_t next = AdTimerWheelNextExpiration(_wheel);
+    NSTimeInterval delay;
+
+    if (_timer == nil) {
+        __weak AdRefreshScheduler *weakSelf = self;
+        _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        dispatch_source_set_event_handler(_timer, ^{
+            [weakSelf timerDidFire];
+        });
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(_timer);
+    }
+    if (next == kAdTimerWheelNoTimer) {
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+    delay = MAX(_startDate + (double)(AdTimerWheelGetTime(_wheel) + next) - CFAbsoluteTimeGetCurrent(), 0);
+    // Refreshes are not exact to the second, the leeway lets the system coalesce this wake-up with others.
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                              DISPATCH_TIME_FOREVER, (uint64_t)(MAX(delay * 0.1, kAdRefreshMinimumLeeway) * NSEC_PER_SEC));
+}
+
+- (void)timerDidFire
+{
+    uint64_t elapsed = (uint64_t)floor(MAX(CFAbsoluteTimeGetCurrent() - _startDate, 0));
+    uint64_t now = AdTimerWheelGetTime(_wheel);
+
+    if (elapsed > now) {
+        AdTimerWheelAdvance(_wheel, elapsed - now, AdRefreshSchedulerTimerDidExpire, (__bridge void *)self);
+    }
+    [self armTimer];
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)bannerCount
+{
+    return [_entries count];
+}
+
+- (NSUInteger)refreshCount
+{
+    return _refreshCount;
+}
+
+- (NSUInteger)hiddenSkipCount
+{
+    return _hiddenSkipCount;
+}
+
+- (NSUInteger)backgroundSkipCount
+{
+    return _backgroundSkipCount;
+}
+
+- (NSUInteger)stretchSavingCount
+{
+    return (NSUInteger)_stretchSavings;
+}
+
+- (NSUInteger)savedRefreshCount
+{
+    return _hiddenSkipCount + _backgroundSkipCount + [self stretchSavingCount];
+}
+
+@end
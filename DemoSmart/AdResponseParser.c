@@ -0,0 +1,800 @@
+//
+//  AdResponseParser.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdResponseParser.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The header and list slot tables of the record come first in the buffer, the received bytes after. */
+#define kAdResponseListTableLength  (AdRecordListCount * kAdResponseMaxListItems * sizeof(AdRecordSlot))
+#define kAdResponseDataOffset       ((sizeof(AdRecordHeader) + kAdResponseListTableLength + 7) & ~(size_t)7)
+#define kAdResponseMaxNumberLength  64
+
+typedef enum {
+    AdResponseStateStart,
+    AdResponseStateKeyOrEnd,        /* after { */
+    AdResponseStateKey,             /* after , in an object */
+    AdResponseStateColon,
+    AdResponseStateValue,
+    AdResponseStateValueOrEnd,      /* after [ */
+    AdResponseStateCommaOrEnd,
+    AdResponseStateString
+} AdResponseState;
+
+typedef enum {
+    AdResponseFieldString,
+    AdResponseFieldList,
+    AdResponseFieldFlag,
+    AdResponseFieldInteger,
+    AdResponseFieldDate,
+    AdResponseFieldFloat,
+    AdResponseFieldEnum,
+    AdResponseFieldSize,
+    AdResponseFieldColor
+} AdResponseFieldKind;
+
+typedef struct {
+    const char *key;
+    uint8_t length;
+    uint8_t kind;
+    uint16_t offset;    /* in the header, or the string or list index */
+    uint32_t flag;
+} AdResponseField;
+
+#define AdResponseKey(key)  key, sizeof(key) - 1
+
+static const AdResponseField AdResponseFields[] = {
+    { AdResponseKey("insertionId"), AdResponseFieldInteger, offsetof(AdRecordHeader, insertionId), 0 },
+    { AdResponseKey("expirationDate"), AdResponseFieldDate, offsetof(AdRecordHeader, expirationDate), AdRecordFlagHasExpirationDate },
+    { AdResponseKey("duration"), AdResponseFieldFloat, offsetof(AdRecordHeader, duration), 0 },
+    { AdResponseKey("creativeType"), AdResponseFieldEnum, offsetof(AdRecordHeader, creativeType), 0 },
+    { AdResponseKey("skipPosition"), AdResponseFieldEnum, offsetof(AdRecordHeader, skipPosition), 0 },
+    { AdResponseKey("expandedHeight"), AdResponseFieldFloat, offsetof(AdRecordHeader, expandedHeight), 0 },
+    { AdResponseKey("expandedLandscapeHeight"), AdResponseFieldFloat, offsetof(AdRecordHeader, expandedLandscapeHeight), 0 },
+    { AdResponseKey("triggerHeight"), AdResponseFieldFloat, offsetof(AdRecordHeader, triggerHeight), 0 },
+    { AdResponseKey("triggerLandscapeHeight"), AdResponseFieldFloat, offsetof(AdRecordHeader, triggerLandscapeHeight), 0 },
+    { AdResponseKey("imageSize"), AdResponseFieldSize, offsetof(AdRecordHeader, imageSize), 0 },
+    { AdResponseKey("landscapeImageSize"), AdResponseFieldSize, offsetof(AdRecordHeader, landscapeImageSize), 0 },
+    { AdResponseKey("videoSize"), AdResponseFieldSize, offsetof(AdRecordHeader, videoSize), 0 },
+    { AdResponseKey("backgroundColor"), AdResponseFieldColor, offsetof(AdRecordHeader, backgroundColor), AdRecordFlagHasBackgroundColor },
+    { AdResponseKey("textColor"), AdResponseFieldColor, offsetof(AdRecordHeader, textColor), AdRecordFlagHasTextColor },
+
+    { AdResponseKey("creativeURL"), AdResponseFieldString, AdRecordStringCreativeURL, 0 },
+    { AdResponseKey("creativeLandscapeUrl"), AdResponseFieldString, AdRecordStringCreativeLandscapeURL, 0 },
+    { AdResponseKey("redirectURL"), AdResponseFieldString, AdRecordStringRedirectURL, 0 },
+    { AdResponseKey("redirectLandscapeURL"), AdResponseFieldString, AdRecordStringRedirectLandscapeURL, 0 },
+    { AdResponseKey("countURL"), AdResponseFieldString, AdRecordStringCountURL, 0 },
+    { AdResponseKey("countLandscapeURL"), AdResponseFieldString, AdRecordStringCountLandscapeURL, 0 },
+    { AdResponseKey("impPixel"), AdResponseFieldString, AdRecordStringImpPixel, 0 },
+    { AdResponseKey("impLandscapePixel"), AdResponseFieldString, AdRecordStringImpLandscapePixel, 0 },
+    { AdResponseKey("text"), AdResponseFieldString, AdRecordStringText, 0 },
+    { AdResponseKey("creativeScript"), AdResponseFieldString, AdRecordStringCreativeScript, 0 },
+    { AdResponseKey("creativeScriptURL"), AdResponseFieldString, AdRecordStringCreativeScriptURL, 0 },
+    { AdResponseKey("agencyPortraitPixels"), AdResponseFieldList, AdRecordListAgencyPortraitPixels, 0 },
+    { AdResponseKey("agencyLandscapePixels"), AdResponseFieldList, AdRecordListAgencyLandscapePixels, 0 },
+
+    { AdResponseKey("expandedAtInit"), AdResponseFieldFlag, 0, AdRecordFlagExpandedAtInit },
+    { AdResponseKey("expand"), AdResponseFieldFlag, 0, AdRecordFlagExpand },
+    { AdResponseKey("navigationHasControls"), AdResponseFieldFlag, 0, AdRecordFlagNavigationHasControls },
+    { AdResponseKey("fromTop"), AdResponseFieldFlag, 0, AdRecordFlagFromTop },
+    { AdResponseKey("transparentBackground"), AdResponseFieldFlag, 0, AdRecordFlagTransparentBackground },
+    { AdResponseKey("askConfirmationBeforeClosingApp"), AdResponseFieldFlag, 0, AdRecordFlagAskConfirmationBeforeClosingApp },
+    { AdResponseKey("videoAutoPlay"), AdResponseFieldFlag, 0, AdRecordFlagVideoAutoPlay },
+    { AdResponseKey("skip"), AdResponseFieldFlag, 0, AdRecordFlagSkip },
+    { AdResponseKey("redirectsToThirdParty"), AdResponseFieldFlag, 0, AdRecordFlagRedirectsToThirdParty },
+    { AdResponseKey("isSkipPositionDefined"), AdResponseFieldFlag, 0, AdRecordFlagIsSkipPositionDefined },
+    { AdResponseKey("isOffline"), AdResponseFieldFlag, 0, AdRecordFlagIsOffline },
+    { AdResponseKey("isConnectionNeeded"), AdResponseFieldFlag, 0, AdRecordFlagIsConnectionNeeded },
+    { AdResponseKey("addStandardTrigger"), AdResponseFieldFlag, 0, AdRecordFlagAddStandardTrigger },
+};
+
+struct AdResponseParser {
+    char *buffer;
+    size_t length;          /* of the buffer, the received bytes start at kAdResponseDataOffset */
+    size_t capacity;
+    size_t cursor;          /* the next byte to parse */
+    AdResponseStatus status;
+    size_t errorOffset;
+
+    AdResponseState state;
+    char containers[kAdResponseMaxDepth];
+    unsigned depth;
+    const AdResponseField *field;   /* of the last key of the response object */
+    uint32_t index;                 /* of the next item of an array of the response object */
+
+    int stringIsKey;
+    size_t stringStart;
+    size_t stringWrite;     /* strings are unescaped in place, behind the cursor */
+};
+
+static AdRecordHeader *AdResponseParserHeader(const AdResponseParser *parser)
+{
+    return (AdRecordHeader *)parser->buffer;
+}
+
+static AdRecordSlot *AdResponseParserListItems(const AdResponseParser *parser, uint32_t list)
+{
+    return (AdRecordSlot *)(parser->buffer + sizeof(AdRecordHeader)) + list * kAdResponseMaxListItems;
+}
+
+static AdResponseStatus AdResponseParserFail(AdResponseParser *parser)
+{
+    parser->status = AdResponseStatusError;
+    parser->errorOffset = parser->cursor - kAdResponseDataOffset;
+    return AdResponseStatusError;
+}
+
+// Lifecycle
+
+AdResponseParser *AdResponseParserCreate(void)
+{
+    AdResponseParser *parser = calloc(1, sizeof(AdResponseParser));
+
+    if (parser == NULL) {
+        return NULL;
+    }
+    parser->capacity = kAdResponseDataOffset + 4096;
+    parser->buffer = malloc(parser->capacity);
+    if (parser->buffer == NULL) {
+        free(parser);
+        return NULL;
+    }
+    AdResponseParserReset(parser);
+    return parser;
+}
+
+void AdResponseParserRelease(AdResponseParser *parser)
+{
+    if (parser) {
+        free(parser->buffer);
+        free(parser);
+    }
+}
+
+void AdResponseParserReset(AdResponseParser *parser)
+{
+    memset(parser->buffer, 0, kAdResponseDataOffset);
+    parser->length = kAdResponseDataOffset;
+    parser->cursor = kAdResponseDataOffset;
+    parser->status = AdResponseStatusNeedMore;
+    parser->errorOffset = 0;
+    parser->state = AdResponseStateStart;
+    parser->depth = 0;
+    parser->field = NULL;
+    parser->index = 0;
+}
+
+AdResponseStatus AdResponseParserGetStatus(const AdResponseParser *parser)
+{
+    return parser->status;
+}
+
+size_t AdResponseParserGetErrorOffset(const AdResponseParser *parser)
+{
+    return parser->errorOffset;
+}
+
+const AdRecordHeader *AdResponseParserGetRecord(const AdResponseParser *parser, size_t *length)
+{
+    if (parser->status != AdResponseStatusComplete) {
+        return NULL;
+    }
+    if (length) {
+        *length = AdResponseParserHeader(parser)->totalLength;
+    }
+    return AdResponseParserHeader(parser);
+}
+
+// Values
+
+/** The field a value sets: the value of a key of the response object, or an item of an array value of a key. */
+static const AdResponseField *AdResponseParserValueField(AdResponseParser *parser, int *item)
+{
+    if (parser->depth == 1) {
+        *item = 0;
+        return parser->field;
+    }
+    if (parser->depth == 2 && parser->containers[1] == '[') {
+        *item = 1;
+        return parser->field;
+    }
+    return NULL;
+}
+
+static int AdResponseHexDigit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/** Parses "#RRGGBB" or "#RRGGBBAA". */
+static int AdResponseParseColor(const char *bytes, size_t length, float rgba[4])
+{
+    if (length > 0 && bytes[0] == '#') {
+        bytes++;
+        length--;
+    }
+    if (length != 6 && length != 8) {
+        return 0;
+    }
+    rgba[3] = 1;
+    for (size_t i = 0; i < length; i += 2) {
+        int high = AdResponseHexDigit(bytes[i]), low = AdResponseHexDigit(bytes[i + 1]);
+        if (high < 0 || low < 0) {
+            return 0;
+        }
+        rgba[i / 2] = (float)(high * 16 + low) / 255;
+    }
+    return 1;
+}
+
+static int AdResponseParserStringValue(AdResponseParser *parser, size_t start, size_t length)
+{
+    AdRecordHeader *header = AdResponseParserHeader(parser);
+    int item;
+    const AdResponseField *field = AdResponseParserValueField(parser, &item);
+
+    if (field == NULL) {
+        return 0;
+    }
+    if (item) {
+        parser->index++;
+        if (field->kind == AdResponseFieldList) {
+            AdRecordSlot *slot = &header->lists[field->offset];
+            if (slot->length == kAdResponseMaxListItems) {
+                return -1;
+            }
+            AdResponseParserListItems(parser, field->offset)[slot->length].offset = (uint32_t)start;
+            AdResponseParserListItems(parser, field->offset)[slot->length].length = (uint32_t)length;
+            slot->length++;
+        }
+    } else if (field->kind == AdResponseFieldString) {
+        header->strings[field->offset].offset = (uint32_t)start;
+        header->strings[field->offset].length = (uint32_t)length;
+    } else if (field->kind == AdResponseFieldColor) {
+        float rgba[4];
+        if (AdResponseParseColor(parser->buffer + start, length, rgba)) {
+            memcpy((char *)header + field->offset, rgba, sizeof(rgba));
+            header->flags |= field->flag;
+        }
+    }
+    return 0;
+}
+
+static float AdResponseFloat(double value)
+{
+    return (float)(value > FLT_MAX ? FLT_MAX : value < -FLT_MAX ? -FLT_MAX : value);
+}
+
+static void AdResponseParserNumberValue(AdResponseParser *parser, double value, int64_t integer)
+{
+    AdRecordHeader *header = AdResponseParserHeader(parser);
+    char *base = (char *)header;
+    int item;
+    const AdResponseField *field = AdResponseParserValueField(parser, &item);
+    float number;
+
+    if (field == NULL) {
+        return;
+    }
+    if (item) {
+        if (field->kind == AdResponseFieldSize && parser->index < 2) {
+            number = AdResponseFloat(value);
+            memcpy(base + field->offset + parser->index * sizeof(float), &number, sizeof(float));
+        }
+        parser->index++;
+        return;
+    }
+    switch (field->kind) {
+        case AdResponseFieldInteger:
+            memcpy(base + field->offset, &integer, sizeof(int64_t));
+            break;
+        case AdResponseFieldDate:
+            memcpy(base + field->offset, &value, sizeof(double));
+            header->flags |= field->flag;
+            break;
+        case AdResponseFieldFloat:
+            number = AdResponseFloat(value);
+            memcpy(base + field->offset, &number, sizeof(float));
+            break;
+        case AdResponseFieldEnum: {
+            uint32_t enumeration = value >= 0 && value <= UINT32_MAX ? (uint32_t)value : 0;
+            memcpy(base + field->offset, &enumeration, sizeof(uint32_t));
+            break;
+        }
+        case AdResponseFieldFlag:
+            header->flags = value != 0 ? header->flags | field->flag : header->flags & ~field->flag;
+            break;
+        default:
+            break;
+    }
+}
+
+static void AdResponseParserBooleanValue(AdResponseParser *parser, int value)
+{
+    int item;
+    const AdResponseField *field = AdResponseParserValueField(parser, &item);
+
+    if (field && (item || field->kind == AdResponseFieldFlag)) {
+        AdResponseParserNumberValue(parser, value, value);
+    }
+}
+
+static const AdResponseField *AdResponseFieldForKey(const char *key, size_t length)
+{
+    for (size_t i = 0; i < sizeof(AdResponseFields) / sizeof(AdResponseFields[0]); i++) {
+        if (AdResponseFields[i].length == length && memcmp(AdResponseFields[i].key, key, length) == 0) {
+            return &AdResponseFields[i];
+        }
+    }
+    return NULL;
+}
+
+// Tokens
+
+static int AdResponseIsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/** Parses a JSON number. Returns 0 if the bytes are not one. */
+static int AdResponseParseNumber(const char *bytes, size_t length, double *value, int64_t *integer)
+{
+    uint64_t mantissa = 0;
+    int negative = 0, exponent = 0, isInteger = 1;
+    size_t i = 0;
+
+    if (bytes[i] == '-') {
+        negative = 1;
+        i++;
+    }
+    if (i == length || !AdResponseIsDigit(bytes[i]) || (bytes[i] == '0' && i + 1 < length && AdResponseIsDigit(bytes[i + 1]))) {
+        return 0;
+    }
+    // Digits past 18 do not fit the mantissa and only scale it.
+    for (; i < length && AdResponseIsDigit(bytes[i]); i++) {
+        if (mantissa < UINT64_C(100000000000000000)) {
+            mantissa = mantissa * 10 + (uint64_t)(bytes[i] - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (i < length && bytes[i] == '.') {
+        isInteger = 0;
+        if (++i == length || !AdResponseIsDigit(bytes[i])) {
+            return 0;
+        }
+        for (; i < length && AdResponseIsDigit(bytes[i]); i++) {
+            if (mantissa < UINT64_C(100000000000000000)) {
+                mantissa = mantissa * 10 + (uint64_t)(bytes[i] - '0');
+                exponent--;
+            }
+        }
+    }
+    if (i < length && (bytes[i] == 'e' || bytes[i] == 'E')) {
+        int sign = 1, digits = 0;
+        isInteger = 0;
+        if (++i < length && (bytes[i] == '+' || bytes[i] == '-')) {
+            sign = bytes[i++] == '-' ? -1 : 1;
+        }
+        if (i == length || !AdResponseIsDigit(bytes[i])) {
+            return 0;
+        }
+        for (; i < length && AdResponseIsDigit(bytes[i]); i++) {
+            if (digits < 1000) {
+                digits = digits * 10 + (bytes[i] - '0');
+            }
+        }
+        exponent += sign * digits;
+    }
+    if (i != length) {
+        return 0;
+    }
+
+    *value = exponent == 0 ? (double)mantissa : (double)mantissa * pow(10, exponent);
+    if (negative) {
+        *value = -*value;
+    }
+    if (isInteger && exponent == 0) {
+        *integer = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+    } else {
+        *integer = *value >= 9.2e18 ? INT64_MAX : *value <= -9.2e18 ? INT64_MIN : (int64_t)*value;
+    }
+    return 1;
+}
+
+/** Returns 1 when the token was parsed, 0 when more bytes are needed, -1 on error. */
+static int AdResponseParserNumber(AdResponseParser *parser)
+{
+    const char *bytes = parser->buffer + parser->cursor;
+    size_t available = parser->length - parser->cursor, length = 0;
+    double value;
+    int64_t integer;
+
+    while (length < available && (AdResponseIsDigit(bytes[length]) || bytes[length] == '-' || bytes[length] == '+'
+                                  || bytes[length] == '.' || bytes[length] == 'e' || bytes[length] == 'E')) {
+        length++;
+    }
+    if (length > kAdResponseMaxNumberLength) {
+        return -1;
+    }
+    // A number only ends at the byte after it, which has not arrived yet.
+    if (length == available) {
+        return 0;
+    }
+    if (!AdResponseParseNumber(bytes, length, &value, &integer)) {
+        return -1;
+    }
+    AdResponseParserNumberValue(parser, value, integer);
+    parser->cursor += length;
+    return 1;
+}
+
+static int AdResponseParserLiteral(AdResponseParser *parser)
+{
+    static const char *const literals[] = { "true", "false", "null" };
+    const char *bytes = parser->buffer + parser->cursor;
+    size_t available = parser->length - parser->cursor;
+
+    for (int i = 0; i < 3; i++) {
+        size_t length = strlen(literals[i]);
+        if (bytes[0] != literals[i][0]) {
+            continue;
+        }
+        if (memcmp(bytes, literals[i], available < length ? available : length) != 0) {
+            return -1;
+        }
+        if (available < length) {
+            return 0;
+        }
+        if (i < 2) {
+            AdResponseParserBooleanValue(parser, i == 0);
+        } else {
+            int item;
+            if (AdResponseParserValueField(parser, &item) && item) {
+                parser->index++;
+            }
+        }
+        parser->cursor += length;
+        return 1;
+    }
+    return -1;
+}
+
+static size_t AdResponseWriteUTF8(char *output, uint32_t codePoint)
+{
+    if (codePoint < 0x80) {
+        output[0] = (char)codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        output[0] = (char)(0xC0 | (codePoint >> 6));
+        output[1] = (char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        output[0] = (char)(0xE0 | (codePoint >> 12));
+        output[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        output[2] = (char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    output[0] = (char)(0xF0 | (codePoint >> 18));
+    output[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+    output[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+    output[3] = (char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+/** Reads the 4 hexadecimal digits of a \u escape. Returns -1 if they are not. */
+static long AdResponseReadCodeUnit(const char *bytes)
+{
+    long unit = 0;
+
+    for (int i = 0; i < 4; i++) {
+        int digit = AdResponseHexDigit(bytes[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        unit = unit * 16 + digit;
+    }
+    return unit;
+}
+
+/** Decodes the escape at read. Returns the number of bytes read, 0 when more bytes are needed, -1 on error. */
+static long AdResponseUnescape(const char *bytes, size_t available, char *output, size_t *written)
+{
+    long unit, low;
+
+    if (available < 2) {
+        return 0;
+    }
+    switch (bytes[1]) {
+        case '"': case '\\': case '/':
+            *output = bytes[1]; *written = 1; return 2;
+        case 'b': *output = '\b'; *written = 1; return 2;
+        case 'f': *output = '\f'; *written = 1; return 2;
+        case 'n': *output = '\n'; *written = 1; return 2;
+        case 'r': *output = '\r'; *written = 1; return 2;
+        case 't': *output = '\t'; *written = 1; return 2;
+        case 'u':
+            break;
+        default:
+            return -1;
+    }
+    if (available < 6) {
+        return 0;
+    }
+    if ((unit = AdResponseReadCodeUnit(bytes + 2)) < 0) {
+        return -1;
+    }
+    if (unit >= 0xD800 && unit <= 0xDBFF) {
+        // A high surrogate takes the low one of the next escape, if there is one.
+        if ((available > 6 && bytes[6] != '\\') || (available > 7 && bytes[7] != 'u')) {
+            *written = AdResponseWriteUTF8(output, 0xFFFD);
+            return 6;
+        }
+        if (available < 12) {
+            return 0;
+        }
+        low = AdResponseReadCodeUnit(bytes + 8);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            *written = AdResponseWriteUTF8(output, 0x10000 + (((uint32_t)unit - 0xD800) << 10) + ((uint32_t)low - 0xDC00));
+            return 12;
+        }
+        *written = AdResponseWriteUTF8(output, 0xFFFD);
+        return 6;
+    }
+    if (unit >= 0xDC00 && unit <= 0xDFFF) {
+        unit = 0xFFFD;
+    }
+    *written = AdResponseWriteUTF8(output, (uint32_t)unit);
+    return 6;
+}
+
+/** Scans the string at the cursor. Returns 1 when the string is closed, 0 when more bytes are needed, -1 on error. */
+static int AdResponseParserScanString(AdResponseParser *parser)
+{
+    char *bytes = parser->buffer;
+    size_t read = parser->cursor, write = parser->stringWrite, end = parser->length;
+
+    while (read < end) {
+        size_t span = read;
+        unsigned char c;
+
+        // Plain runs are skipped, or moved back over the room freed by the escapes before them.
+        while (span < end && (c = (unsigned char)bytes[span]) != '"' && c != '\\' && c >= 0x20) {
+            span++;
+        }
+        if (write != read) {
+            memmove(bytes + write, bytes + read, span - read);
+        }
+        write += span - read;
+        read = span;
+        if (read == end) {
+            break;
+        }
+
+        c = (unsigned char)bytes[read];
+        if (c == '"') {
+            bytes[write] = '\0';
+            parser->cursor = read + 1;
+            parser->stringWrite = write;
+            return 1;
+        }
+        if (c == '\\') {
+            size_t written;
+            long consumed = AdResponseUnescape(bytes + read, end - read, bytes + write, &written);
+            if (consumed == 0) {
+                break;
+            }
+            if (consumed < 0) {
+                parser->cursor = read;
+                return -1;
+            }
+            read += (size_t)consumed;
+            write += written;
+            continue;
+        }
+        parser->cursor = read;
+        return -1;
+    }
+    parser->cursor = read;
+    parser->stringWrite = write;
+    return 0;
+}
+
+// Parsing
+
+static int AdResponseParserPush(AdResponseParser *parser, char container)
+{
+    if (parser->depth == kAdResponseMaxDepth) {
+        return -1;
+    }
+    parser->containers[parser->depth++] = container;
+    parser->state = container == '{' ? AdResponseStateKeyOrEnd : AdResponseStateValueOrEnd;
+    if (parser->depth == 2) {
+        parser->index = 0;
+    }
+    parser->cursor++;
+    return 1;
+}
+
+static void AdResponseParserComplete(AdResponseParser *parser)
+{
+    AdRecordHeader *header = AdResponseParserHeader(parser);
+
+    for (uint32_t list = 0; list < AdRecordListCount; list++) {
+        if (header->lists[list].length > 0) {
+            header->lists[list].offset = (uint32_t)((char *)AdResponseParserListItems(parser, list) - parser->buffer);
+        }
+    }
+    header->magic = kAdRecordMagic;
+    header->version = kAdRecordVersion;
+    header->headerLength = sizeof(AdRecordHeader);
+    header->totalLength = (uint32_t)parser->cursor;
+    parser->status = AdResponseStatusComplete;
+}
+
+static int AdResponseParserClose(AdResponseParser *parser)
+{
+    parser->cursor++;
+    if (--parser->depth == 0) {
+        AdResponseParserComplete(parser);
+        return 1;
+    }
+    // An array or object item of an array of the response object.
+    if (parser->depth == 2 && parser->containers[1] == '[') {
+        parser->index++;
+    }
+    parser->state = AdResponseStateCommaOrEnd;
+    return 1;
+}
+
+static int AdResponseParserStartString(AdResponseParser *parser, int isKey)
+{
+    parser->stringIsKey = isKey;
+    parser->stringStart = parser->stringWrite = ++parser->cursor;
+    parser->state = AdResponseStateString;
+    return 1;
+}
+
+static int AdResponseParserEndString(AdResponseParser *parser)
+{
+    size_t start = parser->stringStart, length = parser->stringWrite - start;
+
+    if (parser->stringIsKey) {
+        if (parser->depth == 1) {
+            parser->field = AdResponseFieldForKey(parser->buffer + start, length);
+        }
+        parser->state = AdResponseStateColon;
+        return 1;
+    }
+    parser->state = AdResponseStateCommaOrEnd;
+    return AdResponseParserStringValue(parser, start, length) == 0 ? 1 : -1;
+}
+
+/** Parses the token at the cursor. Returns 1 when it was parsed, 0 when more bytes are needed, -1 on error. */
+static int AdResponseParserStep(AdResponseParser *parser)
+{
+    char c = parser->buffer[parser->cursor];
+    int result;
+
+    if (parser->state == AdResponseStateString) {
+        result = AdResponseParserScanString(parser);
+        return result == 1 ? AdResponseParserEndString(parser) : result;
+    }
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        parser->cursor++;
+        return 1;
+    }
+
+    switch (parser->state) {
+        case AdResponseStateStart:
+            return c == '{' ? AdResponseParserPush(parser, '{') : -1;
+
+        case AdResponseStateKeyOrEnd:
+            if (c == '}') {
+                return AdResponseParserClose(parser);
+            }
+            return c == '"' ? AdResponseParserStartString(parser, 1) : -1;
+
+        case AdResponseStateKey:
+            return c == '"' ? AdResponseParserStartString(parser, 1) : -1;
+
+        case AdResponseStateColon:
+            if (c != ':') {
+                return -1;
+            }
+            parser->state = AdResponseStateValue;
+            parser->cursor++;
+            return 1;
+
+        case AdResponseStateValueOrEnd:
+            if (c == ']') {
+                return AdResponseParserClose(parser);
+            }
+            parser->state = AdResponseStateValue;
+            return 1;
+
+        case AdResponseStateValue:
+            if (c == '{' || c == '[') {
+                return AdResponseParserPush(parser, c);
+            }
+            if (c == '"') {
+                return AdResponseParserStartString(parser, 0);
+            }
+            if (c == '-' || AdResponseIsDigit(c)) {
+                result = AdResponseParserNumber(parser);
+            } else if (c == 't' || c == 'f' || c == 'n') {
+                result = AdResponseParserLiteral(parser);
+            } else {
+                return -1;
+            }
+            if (result == 1) {
+                parser->state = AdResponseStateCommaOrEnd;
+            }
+            return result;
+
+        case AdResponseStateCommaOrEnd:
+            if (c == ',') {
+                parser->state = parser->containers[parser->depth - 1] == '{' ? AdResponseStateKey : AdResponseStateValue;
+                parser->cursor++;
+                return 1;
+            }
+            if ((c == '}' && parser->containers[parser->depth - 1] == '{') || (c == ']' && parser->containers[parser->depth - 1] == '[')) {
+                return AdResponseParserClose(parser);
+            }
+            return -1;
+
+        default:
+            return -1;
+    }
+}
+
+AdResponseStatus AdResponseParserFeed(AdResponseParser *parser, const void *bytes, size_t length)
+{
+    if (parser->status != AdResponseStatusNeedMore) {
+        return parser->status;
+    }
+    if (length > kAdResponseMaxLength - (parser->length - kAdResponseDataOffset)) {
+        parser->cursor = parser->length;
+        return AdResponseParserFail(parser);
+    }
+    if (parser->length + length > parser->capacity) {
+        size_t capacity = parser->capacity * 2;
+        char *buffer;
+
+        while (capacity < parser->length + length) {
+            capacity *= 2;
+        }
+        buffer = realloc(parser->buffer, capacity);
+        if (buffer == NULL) {
+            return AdResponseParserFail(parser);
+        }
+        parser->buffer = buffer;
+        parser->capacity = capacity;
+    }
+    memcpy(parser->buffer + parser->length, bytes, length);
+    parser->length += length;
+
+    while (parser->cursor < parser->length && parser->status == AdResponseStatusNeedMore) {
+        int result = AdResponseParserStep(parser);
+        if (result < 0) {
+            return AdResponseParserFail(parser);
+        }
+        if (result == 0) {
+            break;
+        }
+    }
+    return parser->status;
+}
@@ -0,0 +1,84 @@
+//
+//  AdResponseParser.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Incremental parser of ad server responses, fed with the bytes as they arrive from the socket.
+
+ A response is a JSON object whose keys are the property names of SmartAdServerAd:
+
+    {"insertionId": 4242, "creativeType": 0, "creativeURL": "http://...", "imageSize": [320, 480],
+     "backgroundColor": "#3F7FBFFF", "skip": true, "agencyPortraitPixels": ["http://...", ...], ...}
+
+ Sizes are [width, height] arrays, colors are "#RRGGBB" or "#RRGGBBAA" strings, the expiration
+ date is in seconds since 1970. Unknown keys and values of an unexpected type are skipped.
+
+ The parser keeps the received bytes in a buffer laid out as an AdRecord: the header and the list
+ slot tables come first, then the bytes. Each chunk is parsed as soon as it is fed, scalars go to
+ the header and strings are unescaped in place, so a string is a slot pointing into the received
+ bytes rather than a copy. Once the closing brace arrives, the buffer is a valid record that
+ +[SmartAdServerAd adWithAdRecord:] or AdCachePut take as is: there is no work left after the
+ last byte. The buffer is kept across AdResponseParserReset, so a parser reused for the responses
+ of a page does not allocate once it has grown to the largest of them.
+
+    - (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data
+    {
+        if (AdResponseParserFeed(_parser, [data bytes], [data length]) == AdResponseStatusComplete) {
+            SmartAdServerAd *ad = [SmartAdServerAd adWithAdRecord:AdResponseParserGetRecord(_parser, NULL)];
+        }
+    }
+
+ This file is plain C. A parser is not thread safe.
+ */
+
+#ifndef DemoSmart_AdResponseParser_h
+#define DemoSmart_AdResponseParser_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AdRecord.h"
+
+#define kAdResponseMaxListItems     32
+#define kAdResponseMaxDepth         32
+#define kAdResponseMaxLength        (16 * 1024 * 1024)
+
+typedef enum {
+    AdResponseStatusNeedMore,
+    AdResponseStatusComplete,
+    AdResponseStatusError
+} AdResponseStatus;
+
+typedef struct AdResponseParser AdResponseParser;
+
+/** Returns NULL when out of memory. */
+AdResponseParser *AdResponseParserCreate(void);
+void AdResponseParserRelease(AdResponseParser *parser);
+
+/** Forgets the current response, keeping the buffer for the next one. */
+void AdResponseParserReset(AdResponseParser *parser);
+
+/** Parses the next bytes of the response.
+
+ Returns AdResponseStatusComplete once the response object is closed, bytes fed after that are
+ ignored. An error is final until the next reset: the response is malformed, nested too deeply,
+ has more than kAdResponseMaxListItems pixels in a list, or is longer than kAdResponseMaxLength.
+ */
+AdResponseStatus AdResponseParserFeed(AdResponseParser *parser, const void *bytes, size_t length);
+
+AdResponseStatus AdResponseParserGetStatus(const AdResponseParser *parser);
+
+/** The offset in the response of the byte that could not be parsed, for an error. */
+size_t AdResponseParserGetErrorOffset(const AdResponseParser *parser);
+
+/** Returns the record of a complete response, NULL before. It stays valid until the next feed or reset.
+
+ @param length Set to the length of the record, may be NULL.
+ */
+const AdRecordHeader *AdResponseParserGetRecord(const AdResponseParser *parser, size_t *length);
+
+#endif
@@ -0,0 +1,424 @@
+//
+//  AdSpriteAtlas.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdSpriteAtlas.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kAdSpriteAtlasMagic         0x41534441u     /* "ADSA" */
+#define kAdSpriteAtlasHeaderLength  64
+#define kAdSpriteAtlasEntryLength   24
+#define kAdSpriteAtlasMaximumSide   4096
+#define kAdSpriteAtlasRowAlignment  64              /* the rows Core Animation copies fastest */
+
+enum {
+    kHeaderMagic, kHeaderVersion, kHeaderScale, kHeaderWidth, kHeaderHeight, kHeaderBytesPerRow,
+    kHeaderCount, kHeaderNamesLength, kHeaderPixelsOffset, kHeaderPixelsLength
+};
+
+enum {
+    kEntryNameOffset, kEntryNameLength, kEntryX, kEntryY, kEntryWidth, kEntryHeight
+};
+
+struct AdSpriteAtlas {
+    const uint8_t *bytes;
+    size_t length;
+    uint32_t scale;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesPerRow;
+    uint32_t count;
+    const uint8_t *entries;
+    const char *names;
+    const uint8_t *pixels;
+};
+
+static uint32_t AdSpriteAtlasRead32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static void AdSpriteAtlasWrite32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+// Packing
+
+typedef struct {
+    const AdSpriteSource *source;
+    uint32_t x;
+    uint32_t y;
+} AdSpritePlacement;
+
+static int AdSpritePlacementCompareNames(const void *a, const void *b)
+{
+    return strcmp(((const AdSpritePlacement *)a)->source->name, ((const AdSpritePlacement *)b)->source->name);
+}
+
+static int AdSpritePlacementCompareHeights(const void *a, const void *b)
+{
+    const AdSpriteSource *first = ((const AdSpritePlacement *)a)->source, *second = ((const AdSpritePlacement *)b)->source;
+
+    if (first->height != second->height) {
+        return first->height > second->height ? -1 : 1;
+    }
+    if (first->width != second->width) {
+        return first->width > second->width ? -1 : 1;
+    }
+    return strcmp(first->name, second->name);
+}
+
+/** Places the sprites, tallest first, on shelves of the width. Returns the height used. */
+static uint32_t AdSpriteAtlasPackShelves(AdSpritePlacement *placements, size_t count, uint32_t width, uint32_t padding)
+{
+    uint32_t x = 0, y = 0, shelfHeight = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t spriteWidth = placements[i].source->width + 2 * padding;
+
+        if (x + spriteWidth > width) {
+            y += shelfHeight;
+            x = 0;
+            shelfHeight = 0;
+        }
+        placements[i].x = x + padding;
+        placements[i].y = y + padding;
+        x += spriteWidth;
+        if (placements[i].source->height + 2 * padding > shelfHeight) {
+            shelfHeight = placements[i].source->height + 2 * padding;
+        }
+    }
+    return y + shelfHeight;
+}
+
+/** Packs with the width, a power of two, that gives the smallest bitmap. Leaves the placements in the order of the names. */
+static int AdSpriteAtlasPack(AdSpritePlacement *placements, size_t count, uint32_t padding, uint32_t *width, uint32_t *height)
+{
+    uint32_t widest = 1, bestWidth = 0, bestHeight = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (placements[i].source->width + 2 * padding > widest) {
+            widest = placements[i].source->width + 2 * padding;
+        }
+    }
+    if (count > 1) {
+        qsort(placements, count, sizeof(*placements), AdSpritePlacementCompareHeights);
+    }
+    for (uint32_t candidate = 1; candidate <= kAdSpriteAtlasMaximumSide; candidate *= 2) {
+        uint32_t candidateHeight;
+
+        if (candidate < widest) {
+            continue;
+        }
+        candidateHeight = AdSpriteAtlasPackShelves(placements, count, candidate, padding);
+        if (candidateHeight <= kAdSpriteAtlasMaximumSide
+            && (bestWidth == 0 || (uint64_t)candidate * candidateHeight < (uint64_t)bestWidth * bestHeight)) {
+            bestWidth = candidate;
+            bestHeight = candidateHeight;
+        }
+    }
+    if (bestWidth == 0) {
+        errno = EFBIG;
+        return -1;
+    }
+    AdSpriteAtlasPackShelves(placements, count, bestWidth, padding);
+    if (count > 1) {
+        qsort(placements, count, sizeof(*placements), AdSpritePlacementCompareNames);
+    }
+    *width = bestWidth;
+    *height = bestHeight > 0 ? bestHeight : 1;
+    return 0;
+}
+
+// Writing
+
+int AdSpriteAtlasWrite(const char *path, const AdSpriteSource *sources, size_t count, uint32_t scale, uint32_t padding)
+{
+    AdSpritePlacement *placements;
+    uint32_t width, height, bytesPerRow, namesLength = 0, pixelsOffset;
+    size_t length;
+    uint8_t *bytes;
+    char temporary[4096];
+    FILE *file;
+    int error;
+
+    if (path == NULL || (sources == NULL && count > 0) || count > kAdSpriteAtlasMaximumSide || scale == 0 || padding > 16) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (sources[i].name == NULL || sources[i].pixels == NULL || sources[i].width == 0 || sources[i].height == 0
+            || sources[i].width > kAdSpriteAtlasMaximumSide || sources[i].height > kAdSpriteAtlasMaximumSide) {
+            errno = EINVAL;
+            return -1;
+        }
+        namesLength += (uint32_t)strlen(sources[i].name) + 1;
+    }
+    placements = calloc(count + 1, sizeof(*placements));
+    if (placements == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        placements[i].source = &sources[i];
+    }
+    if (AdSpriteAtlasPack(placements, count, padding, &width, &height) != 0) {
+        free(placements);
+        return -1;
+    }
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(placements[i - 1].source->name, placements[i].source->name) == 0) {
+            free(placements);
+            errno = EEXIST;
+            return -1;
+        }
+    }
+
+    bytesPerRow = (width * 4 + kAdSpriteAtlasRowAlignment - 1) / kAdSpriteAtlasRowAlignment * kAdSpriteAtlasRowAlignment;
+    pixelsOffset = kAdSpriteAtlasHeaderLength + (uint32_t)count * kAdSpriteAtlasEntryLength + namesLength;
+    pixelsOffset = (pixelsOffset + kAdSpriteAtlasPageSize - 1) / kAdSpriteAtlasPageSize * kAdSpriteAtlasPageSize;
+    length = (size_t)pixelsOffset + (size_t)height * bytesPerRow;
+    bytes = calloc(1, length);
+    if (bytes == NULL) {
+        free(placements);
+        return -1;
+    }
+
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderMagic, kAdSpriteAtlasMagic);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderVersion, kAdSpriteAtlasVersion);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderScale, scale);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderWidth, width);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderHeight, height);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderBytesPerRow, bytesPerRow);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderCount, (uint32_t)count);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderNamesLength, namesLength);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderPixelsOffset, pixelsOffset);
+    AdSpriteAtlasWrite32(bytes + 4 * kHeaderPixelsLength, height * bytesPerRow);
+
+    {
+        uint8_t *entry = bytes + kAdSpriteAtlasHeaderLength;
+        char *names = (char *)entry + count * kAdSpriteAtlasEntryLength;
+        uint32_t nameOffset = 0;
+
+        for (size_t i = 0; i < count; i++, entry += kAdSpriteAtlasEntryLength) {
+            const AdSpriteSource *source = placements[i].source;
+            uint32_t nameLength = (uint32_t)strlen(source->name);
+
+            AdSpriteAtlasWrite32(entry + 4 * kEntryNameOffset, nameOffset);
+            AdSpriteAtlasWrite32(entry + 4 * kEntryNameLength, nameLength);
+            AdSpriteAtlasWrite32(entry + 4 * kEntryX, placements[i].x);
+            AdSpriteAtlasWrite32(entry + 4 * kEntryY, placements[i].y);
+            AdSpriteAtlasWrite32(entry + 4 * kEntryWidth, source->width);
+            AdSpriteAtlasWrite32(entry + 4 * kEntryHeight, source->height);
+            memcpy(names + nameOffset, source->name, nameLength + 1);
+            nameOffset += nameLength + 1;
+
+            for (uint32_t row = 0; row < source->height; row++) {
+                memcpy(bytes + pixelsOffset + (size_t)(placements[i].y + row) * bytesPerRow + (size_t)placements[i].x * 4,
+                       (const uint8_t *)source->pixels + (size_t)row * source->width * 4, (size_t)source->width * 4);
+            }
+        }
+    }
+    free(placements);
+
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    file = fopen(temporary, "wb");
+    if (file == NULL) {
+        error = errno;
+        free(bytes);
+        errno = error;
+        return -1;
+    }
+    if (fwrite(bytes, 1, length, file) != length || fclose(file) != 0) {
+        error = errno ? errno : EIO;
+        remove(temporary);
+        free(bytes);
+        errno = error;
+        return -1;
+    }
+    free(bytes);
+    return rename(temporary, path);
+}
+
+// Reading
+
+static int AdSpriteAtlasValidate(AdSpriteAtlas *atlas)
+{
+    const uint8_t *bytes = atlas->bytes;
+    uint32_t namesLength, pixelsOffset, pixelsLength;
+    const char *previous = NULL;
+
+    if (atlas->length < kAdSpriteAtlasHeaderLength
+        || AdSpriteAtlasRead32(bytes + 4 * kHeaderMagic) != kAdSpriteAtlasMagic
+        || AdSpriteAtlasRead32(bytes + 4 * kHeaderVersion) != kAdSpriteAtlasVersion) {
+        return -1;
+    }
+    atlas->scale = AdSpriteAtlasRead32(bytes + 4 * kHeaderScale);
+    atlas->width = AdSpriteAtlasRead32(bytes + 4 * kHeaderWidth);
+    atlas->height = AdSpriteAtlasRead32(bytes + 4 * kHeaderHeight);
+    atlas->bytesPerRow = AdSpriteAtlasRead32(bytes + 4 * kHeaderBytesPerRow);
+    atlas->count = AdSpriteAtlasRead32(bytes + 4 * kHeaderCount);
+    namesLength = AdSpriteAtlasRead32(bytes + 4 * kHeaderNamesLength);
+    pixelsOffset = AdSpriteAtlasRead32(bytes + 4 * kHeaderPixelsOffset);
+    pixelsLength = AdSpriteAtlasRead32(bytes + 4 * kHeaderPixelsLength);
+
+    if (atlas->scale == 0 || atlas->width == 0 || atlas->width > kAdSpriteAtlasMaximumSide
+        || atlas->height == 0 || atlas->height > kAdSpriteAtlasMaximumSide
+        || atlas->bytesPerRow < atlas->width * 4 || atlas->count > kAdSpriteAtlasMaximumSide
+        || pixelsOffset % kAdSpriteAtlasPageSize != 0
+        || (uint64_t)kAdSpriteAtlasHeaderLength + (uint64_t)atlas->count * kAdSpriteAtlasEntryLength + namesLength > pixelsOffset
+        || (uint64_t)atlas->height * atlas->bytesPerRow != pixelsLength
+        || (uint64_t)pixelsOffset + pixelsLength > atlas->length) {
+        return -1;
+    }
+    atlas->entries = bytes + kAdSpriteAtlasHeaderLength;
+    atlas->names = (const char *)atlas->entries + (size_t)atlas->count * kAdSpriteAtlasEntryLength;
+    atlas->pixels = bytes + pixelsOffset;
+
+    for (uint32_t i = 0; i < atlas->count; i++) {
+        const uint8_t *entry = atlas->entries + (size_t)i * kAdSpriteAtlasEntryLength;
+        uint32_t nameOffset = AdSpriteAtlasRead32(entry + 4 * kEntryNameOffset);
+        uint32_t nameLength = AdSpriteAtlasRead32(entry + 4 * kEntryNameLength);
+        uint32_t x = AdSpriteAtlasRead32(entry + 4 * kEntryX), y = AdSpriteAtlasRead32(entry + 4 * kEntryY);
+        uint32_t width = AdSpriteAtlasRead32(entry + 4 * kEntryWidth), height = AdSpriteAtlasRead32(entry + 4 * kEntryHeight);
+
+        if ((uint64_t)nameOffset + nameLength >= namesLength || atlas->names[nameOffset + nameLength] != '\0'
+            || strlen(atlas->names + nameOffset) != nameLength
+            || (previous != NULL && strcmp(previous, atlas->names + nameOffset) >= 0)
+            || width == 0 || height == 0 || (uint64_t)x + width > atlas->width || (uint64_t)y + height > atlas->height) {
+            return -1;
+        }
+        previous = atlas->names + nameOffset;
+    }
+    return 0;
+}
+
+AdSpriteAtlas *AdSpriteAtlasOpen(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    void *map = MAP_FAILED;
+    AdSpriteAtlas *atlas;
+    int error;
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0) {
+        error = errno;
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+    if (info.st_size >= kAdSpriteAtlasHeaderLength) {
+        map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    error = map == MAP_FAILED && info.st_size >= kAdSpriteAtlasHeaderLength ? errno : EINVAL;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = error;
+        return NULL;
+    }
+    atlas = calloc(1, sizeof(*atlas));
+    if (atlas == NULL) {
+        munmap(map, (size_t)info.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    atlas->bytes = map;
+    atlas->length = (size_t)info.st_size;
+    if (AdSpriteAtlasValidate(atlas) != 0) {
+        AdSpriteAtlasClose(atlas);
+        errno = EINVAL;
+        return NULL;
+    }
+    return atlas;
+}
+
+void AdSpriteAtlasClose(AdSpriteAtlas *atlas)
+{
+    if (atlas == NULL) {
+        return;
+    }
+    munmap((void *)atlas->bytes, atlas->length);
+    free(atlas);
+}
+
+uint32_t AdSpriteAtlasGetScale(const AdSpriteAtlas *atlas)
+{
+    return atlas->scale;
+}
+
+const void *AdSpriteAtlasGetPixels(const AdSpriteAtlas *atlas, uint32_t *width, uint32_t *height, size_t *bytesPerRow)
+{
+    if (width) {
+        *width = atlas->width;
+    }
+    if (height) {
+        *height = atlas->height;
+    }
+    if (bytesPerRow) {
+        *bytesPerRow = atlas->bytesPerRow;
+    }
+    return atlas->pixels;
+}
+
+size_t AdSpriteAtlasGetCount(const AdSpriteAtlas *atlas)
+{
+    return atlas->count;
+}
+
+const char *AdSpriteAtlasGetSprite(const AdSpriteAtlas *atlas, size_t index, AdSpriteRect *rect)
+{
+    const uint8_t *entry;
+
+    if (index >= atlas->count) {
+        return NULL;
+    }
+    entry = atlas->entries + index * kAdSpriteAtlasEntryLength;
+    if (rect) {
+        rect->x = AdSpriteAtlasRead32(entry + 4 * kEntryX);
+        rect->y = AdSpriteAtlasRead32(entry + 4 * kEntryY);
+        rect->width = AdSpriteAtlasRead32(entry + 4 * kEntryWidth);
+        rect->height = AdSpriteAtlasRead32(entry + 4 * kEntryHeight);
+    }
+    return atlas->names + AdSpriteAtlasRead32(entry + 4 * kEntryNameOffset);
+}
+
+int AdSpriteAtlasFind(const AdSpriteAtlas *atlas, const char *name, AdSpriteRect *rect)
+{
+    size_t low = 0, high = atlas->count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const char *candidate = AdSpriteAtlasGetSprite(atlas, middle, NULL);
+        int order = strcmp(name, candidate);
+
+        if (order == 0) {
+            AdSpriteAtlasGetSprite(atlas, middle, rect);
+            return 0;
+        }
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    errno = ENOENT;
+    return -1;
+}
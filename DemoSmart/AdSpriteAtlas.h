@@ -0,0 +1,86 @@
+//
+//  AdSpriteAtlas.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Sprite atlases: the small images of sas.bundle packed together, decoded at build time.
+
+ sas.bundle/images holds 14 PNGs (skip, mute and unmute, the MRAID close button, back and
+ forward, the loader), each at 1x and 2x, each opened and decoded the first time it is drawn. At
+ build time, tools/adatlas packs the images of a scale into one atlas: the pixels of every
+ sprite, already decoded, in one bitmap, with a manifest of their names and rectangles. At run
+ time the atlas is mapped once and a sprite is a rectangle of the mapping, handed out without
+ copying its pixels.
+
+ The bitmap is premultiplied BGRA, 32 bits little endian per pixel (kCGImageAlphaPremultipliedFirst
+ | kCGBitmapByteOrder32Little), the format Core Animation draws without converting. The sprites
+ are separated by transparent padding, so that filtering at their edges does not take their
+ neighbours' pixels.
+
+ Layout, little endian:
+
+    header      magic "ADSA", version, scale, width, height, bytesPerRow, count, namesLength,
+                pixelsOffset, pixelsLength, 0, 0, 0, 0, 0, 0
+    sprites     { nameOffset, nameLength, x, y, width, height }[count], sorted by name
+    names       namesLength bytes, each name NUL terminated
+    pixels      at pixelsOffset, a multiple of kAdSpriteAtlasPageSize, height rows of bytesPerRow
+
+ This file is plain C. An open atlas is read only and may be used from any thread.
+ */
+
+#ifndef DemoSmart_AdSpriteAtlas_h
+#define DemoSmart_AdSpriteAtlas_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdSpriteAtlasVersion   1
+#define kAdSpriteAtlasPageSize  16384   /* the pages of arm64, a multiple of the others */
+
+typedef struct {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} AdSpriteRect;
+
+/** An image to pack, decoded. */
+typedef struct {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+    const void *pixels;     /* premultiplied BGRA, rows of width * 4 bytes */
+} AdSpriteSource;
+
+/** Packs the images into an atlas file, written to a temporary file then renamed. Returns 0, or -1 with errno set.
+
+ @param padding Transparent pixels around each sprite.
+ */
+int AdSpriteAtlasWrite(const char *path, const AdSpriteSource *sources, size_t count, uint32_t scale, uint32_t padding);
+
+typedef struct AdSpriteAtlas AdSpriteAtlas;
+
+/** Maps an atlas. Returns NULL with errno set, EINVAL when the file is not a valid atlas. */
+AdSpriteAtlas *AdSpriteAtlasOpen(const char *path);
+
+/** Unmaps the atlas. Its pixels must no longer be used. */
+void AdSpriteAtlasClose(AdSpriteAtlas *atlas);
+
+uint32_t AdSpriteAtlasGetScale(const AdSpriteAtlas *atlas);
+
+/** The bitmap of the atlas, in the mapping. */
+const void *AdSpriteAtlasGetPixels(const AdSpriteAtlas *atlas, uint32_t *width, uint32_t *height, size_t *bytesPerRow);
+
+size_t AdSpriteAtlasGetCount(const AdSpriteAtlas *atlas);
+
+/** The name of a sprite, in the order of the names, and its rectangle in the bitmap. */
+const char *AdSpriteAtlasGetSprite(const AdSpriteAtlas *atlas, size_t index, AdSpriteRect *rect);
+
+/** The rectangle of the sprite in the bitmap. Returns 0, or -1 with errno set to ENOENT. */
+int AdSpriteAtlasFind(const AdSpriteAtlas *atlas, const char *name, AdSpriteRect *rect);
+
+#endif
@@ -0,0 +1,49 @@
+//
+//  AdSpriteImages.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+#import "AdSpriteAtlas.h"
+
+/**
+ The images of sas.bundle, from the sprite atlases packed at build time.
+
+ The "Pack sprite atlases" build phase writes sprites.adatlas and sprites@2x.adatlas next to the
+ PNGs of the built sas.bundle/images (see tools/adatlas.c). The atlas of the screen's scale is
+ mapped once, as the pixels of one CGImage; an image is a rectangle of it, shown without decoding
+ a PNG or copying pixels:
+
+    UIImage *skip = [[AdSpriteImages sharedImages] imageNamed:@"skip-button"];
+
+ When the atlases are missing, a build without the phase, the images are read from the PNGs.
+ Images can be asked for from any thread.
+ */
+
+@interface AdSpriteImages : NSObject
+
++ (AdSpriteImages *)sharedImages;
+
+/** Maps the atlas of the scale in the directory, else of the closest scale it has.
+
+ */
+
+- (id)initWithDirectory:(NSString *)directory scale:(CGFloat)scale;
+
+/** The scale of the mapped atlas, 0 when the images are read from the PNGs.
+
+ */
+
+@property (nonatomic, readonly) CGFloat scale;
+
+/** The image named as its PNG without scale nor extension, nil when there is none.
+
+ */
+
+- (UIImage *)imageNamed:(NSString *)name;
+
+@end
@@ -0,0 +1,123 @@
+//
+//  AdSpriteImages.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdSpriteImages.h"
+
+#include <errno.h>
+#include <string.h>
+
+static NSString *const kAdSpriteImagesDirectory = @"sas.bundle/images";
+static const NSUInteger kAdSpriteImagesMaximumScale = 3;
+
+/** The data provider owns the atlas: it is unmapped when the last image cut from it is released. */
+static void AdSpriteImagesReleaseAtlas(void *info, const void *data, size_t size)
+{
+    AdSpriteAtlasClose(info);
+}
+
+@implementation AdSpriteImages
+{
+    NSString *_directory;
+    AdSpriteAtlas *_atlas;          // owned by the provider of _atlasImage
+    CGImageRef _atlasImage;
+    NSMutableDictionary *_images;   // name -> UIImage, under @synchronized(self)
+}
+
++ (AdSpriteImages *)sharedImages
+{
+    static AdSpriteImages *sharedImages = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedImages = [[AdSpriteImages alloc] initWithDirectory:[[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:kAdSpriteImagesDirectory]
+                                                           scale:[[UIScreen mainScreen] scale]];
+    });
+    return sharedImages;
+}
+
+- (id)initWithDirectory:(NSString *)directory scale:(CGFloat)scale
+{
+    self = [super init];
+    if (self) {
+        NSUInteger wanted = MAX(1, MIN(kAdSpriteImagesMaximumScale, (NSUInteger)lround(scale)));
+
+        _directory = [directory copy];
+        _images = [NSMutableDictionary dictionary];
+        // The scale asked for, then the sharper ones, downscaled when drawn, then the blurrier ones.
+        for (NSUInteger i = 0; i < kAdSpriteImagesMaximumScale && _atlas == NULL; i++) {
+            NSUInteger candidate = wanted + i <= kAdSpriteImagesMaximumScale ? wanted + i : kAdSpriteImagesMaximumScale - i;
+            NSString *name = candidate == 1 ? @"sprites.adatlas" : [NSString stringWithFormat:@"sprites@%lux.adatlas", (unsigned long)candidate];
+            NSString *path = [directory stringByAppendingPathComponent:name];
+
+            if ([[NSFileManager defaultManager] fileExistsAtPath:path]) {
+                _atlas = AdSpriteAtlasOpen([path fileSystemRepresentation]);
+                if (_atlas == NULL) {
+                    NSLog(@"AdSpriteImages: cannot open %@: %s", path, strerror(errno));
+                }
+            }
+        }
+        if (_atlas) {
+            uint32_t width, height;
+            size_t bytesPerRow;
+            const void *pixels = AdSpriteAtlasGetPixels(_atlas, &width, &height, &bytesPerRow);
+            CGDataProviderRef provider = CGDataProviderCreateWithData(_atlas, pixels, height * bytesPerRow, AdSpriteImagesReleaseAtlas);
+            CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+
+            _atlasImage = CGImageCreate(width, height, 8, 32, bytesPerRow, colorSpace,
+                                        kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little, provider, NULL, false, kCGRenderingIntentDefault);
+            CGColorSpaceRelease(colorSpace);
+            CGDataProviderRelease(provider);
+            if (_atlasImage == NULL) {
+                _atlas = NULL;      // closed with the provider
+            } else {
+                _scale = AdSpriteAtlasGetScale(_atlas);
+            }
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    CGImageRelease(_atlasImage);
+}
+
+- (UIImage *)imageNamed:(NSString *)name
+{
+    UIImage *image;
+    AdSpriteRect rect;
+    CGImageRef sprite;
+
+    if (name == nil) {
+        return nil;
+    }
+    @synchronized(self) {
+        image = _images[name];
+    }
+    if (image) {
+        return image;
+    }
+    if (_atlasImage == NULL) {
+        image = [UIImage imageWithContentsOfFile:[_directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"png"]]];
+    } else if (AdSpriteAtlasFind(_atlas, [name UTF8String], &rect) == 0) {
+        // A rectangle of the atlas image: it shares the mapped pixels instead of copying them.
+        sprite = CGImageCreateWithImageInRect(_atlasImage, CGRectMake(rect.x, rect.y, rect.width, rect.height));
+        if (sprite) {
+            image = [UIImage imageWithCGImage:sprite scale:_scale orientation:UIImageOrientationUp];
+            CGImageRelease(sprite);
+        }
+    }
+    if (image == nil) {
+        return nil;
+    }
+    @synchronized(self) {
+        _images[name] = image;
+    }
+    return image;
+}
+
+@end
@@ -0,0 +1,857 @@
+//
+//  AdStringTable.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdStringTable.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define kAdStringTableMagic             0x54534441u     /* "ADST" */
+#define kAdStringTableHeaderLength      32
+#define kAdStringTableKeysPerBucket     4
+#define kAdStringTableMaxDisplacement   (1u << 24)
+
+struct AdStringTable {
+    const unsigned char *bytes;
+    size_t length;
+    int mapped;
+    uint32_t count;
+    uint32_t bucketCount;
+    uint32_t duplicateCount;
+    const uint32_t *buckets;
+    const uint32_t *entries;        /* 4 words each */
+    const uint32_t *duplicates;
+    const char *strings;
+};
+
+// Hashing
+
+static uint64_t AdStringTableHash(const char *key, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/** The slot of a key of the hash in a bucket with the displacement: the hash, displaced then mixed. */
+static uint32_t AdStringTableSlot(uint64_t hash, uint32_t displacement, uint32_t count)
+{
+    uint64_t x = hash ^ ((uint64_t)displacement * 0x9e3779b97f4a7c15ull);
+
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (uint32_t)(x % count);
+}
+
+static uint32_t AdStringTableBucket(uint64_t hash, uint32_t bucketCount)
+{
+    return (uint32_t)(hash >> 32) % bucketCount;
+}
+
+// Source
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} AdStringBuffer;
+
+typedef struct {
+    uint32_t keyOffset;
+    uint32_t keyLength;
+    uint32_t valueOffset;
+    uint32_t valueLength;
+    unsigned line;
+} AdStringSourceEntry;
+
+typedef struct {
+    const char *text;           /* UTF-8, NUL terminated */
+    size_t length;
+    size_t position;
+    unsigned line;
+    AdStringBuffer strings;     /* keys and values, NUL terminated */
+    AdStringSourceEntry *entries;
+    size_t count;
+    size_t capacity;
+} AdStringParser;
+
+static int AdStringBufferReserve(AdStringBuffer *buffer, size_t length)
+{
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+        char *grown;
+
+        while (capacity < buffer->length + length) {
+            capacity *= 2;
+        }
+        grown = realloc(buffer->bytes, capacity);
+        if (grown == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        buffer->bytes = grown;
+        buffer->capacity = capacity;
+    }
+    return 0;
+}
+
+static int AdStringBufferAppend(AdStringBuffer *buffer, const void *bytes, size_t length)
+{
+    if (length == 0) {
+        return 0;
+    }
+    if (AdStringBufferReserve(buffer, length) != 0) {
+        return -1;
+    }
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+    return 0;
+}
+
+static size_t AdStringEncodeUTF8(uint32_t character, char *bytes)
+{
+    if (character < 0x80) {
+        bytes[0] = (char)character;
+        return 1;
+    } else if (character < 0x800) {
+        bytes[0] = (char)(0xc0 | character >> 6);
+        bytes[1] = (char)(0x80 | (character & 0x3f));
+        return 2;
+    } else if (character < 0x10000) {
+        bytes[0] = (char)(0xe0 | character >> 12);
+        bytes[1] = (char)(0x80 | (character >> 6 & 0x3f));
+        bytes[2] = (char)(0x80 | (character & 0x3f));
+        return 3;
+    }
+    bytes[0] = (char)(0xf0 | character >> 18);
+    bytes[1] = (char)(0x80 | (character >> 12 & 0x3f));
+    bytes[2] = (char)(0x80 | (character >> 6 & 0x3f));
+    bytes[3] = (char)(0x80 | (character & 0x3f));
+    return 4;
+}
+
+/** The source as UTF-8, NUL terminated: transcoded from UTF-16 when it has a byte order mark, copied otherwise. */
+static char *AdStringDecodeSource(const unsigned char *source, size_t length, size_t *textLength)
+{
+    int bigEndian = length >= 2 && source[0] == 0xfe && source[1] == 0xff;
+    char *text, *cursor;
+
+    if (!bigEndian && !(length >= 2 && source[0] == 0xff && source[1] == 0xfe)) {
+        if (length >= 3 && source[0] == 0xef && source[1] == 0xbb && source[2] == 0xbf) {
+            source += 3;
+            length -= 3;
+        }
+        if ((text = malloc(length + 1)) == NULL) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        memcpy(text, source, length);
+        text[length] = '\0';
+        *textLength = length;
+        return text;
+    }
+
+    // A unit is at most 3 bytes of UTF-8, a surrogate pair 4.
+    if ((text = malloc(length / 2 * 3 + 1)) == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    cursor = text;
+    for (size_t i = 2; i + 1 < length; i += 2) {
+        uint32_t unit = bigEndian ? (uint32_t)source[i] << 8 | source[i + 1] : (uint32_t)source[i + 1] << 8 | source[i];
+
+        if (unit >= 0xd800 && unit < 0xdc00 && i + 3 < length) {
+            uint32_t low = bigEndian ? (uint32_t)source[i + 2] << 8 | source[i + 3] : (uint32_t)source[i + 3] << 8 | source[i + 2];
+
+            if (low >= 0xdc00 && low < 0xe000) {
+                unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                i += 2;
+            }
+        }
+        if (unit >= 0xd800 && unit < 0xe000) {
+            unit = 0xfffd;
+        }
+        cursor += AdStringEncodeUTF8(unit, cursor);
+    }
+    *cursor = '\0';
+    *textLength = (size_t)(cursor - text);
+    return text;
+}
+
+/** Skips white space and comments. Returns -1 on an unterminated comment. */
+static int AdStringParserSkip(AdStringParser *parser)
+{
+    const char *text = parser->text;
+
+    while (parser->position < parser->length) {
+        char c = text[parser->position];
+
+        if (c == '\n') {
+            parser->line++;
+            parser->position++;
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            parser->position++;
+        } else if (c == '/' && text[parser->position + 1] == '/') {
+            while (parser->position < parser->length && text[parser->position] != '\n') {
+                parser->position++;
+            }
+        } else if (c == '/' && text[parser->position + 1] == '*') {
+            parser->position += 2;
+            while (parser->position < parser->length && !(text[parser->position] == '*' && text[parser->position + 1] == '/')) {
+                parser->line += text[parser->position] == '\n';
+                parser->position++;
+            }
+            if (parser->position >= parser->length) {
+                return -1;
+            }
+            parser->position += 2;
+        } else {
+            break;
+        }
+    }
+    return 0;
+}
+
+static int AdStringHexDigit(char c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+static int AdStringIsUnquoted(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c != '\0' && strchr("_$.:/-", c) != NULL);
+}
+
+/** The UTF-16 unit of the \Uxxxx escape at the position, or -1. */
+static int32_t AdStringParserUnicodeEscape(const AdStringParser *parser, size_t position)
+{
+    int32_t unit = 0;
+
+    if (position + 6 > parser->length || parser->text[position] != '\\' || (parser->text[position + 1] != 'U' && parser->text[position + 1] != 'u')) {
+        return -1;
+    }
+    for (size_t i = position + 2; i < position + 6; i++) {
+        int digit = AdStringHexDigit(parser->text[i]);
+
+        if (digit < 0) {
+            return -1;
+        }
+        unit = unit << 4 | digit;
+    }
+    return unit;
+}
+
+/** Reads a quoted or an unquoted string into the strings, NUL terminated. Returns -1 on a syntax error. */
+static int AdStringParserToken(AdStringParser *parser, uint32_t *offset, uint32_t *length)
+{
+    const char *text = parser->text;
+    AdStringBuffer *strings = &parser->strings;
+    size_t start = strings->length;
+
+    if (text[parser->position] != '"') {
+        size_t run = parser->position;
+
+        // Unquoted strings of the old-style property lists.
+        while (run < parser->length && AdStringIsUnquoted(text[run])) {
+            run++;
+        }
+        if (run == parser->position || AdStringBufferAppend(strings, text + parser->position, run - parser->position) != 0) {
+            return -1;
+        }
+        parser->position = run;
+    } else {
+        parser->position++;
+        for (;;) {
+            size_t run = parser->position;
+            char escaped[4];
+            size_t escapedLength = 1;
+
+            while (run < parser->length && text[run] != '"' && text[run] != '\\') {
+                parser->line += text[run] == '\n';
+                run++;
+            }
+            if (AdStringBufferAppend(strings, text + parser->position, run - parser->position) != 0 || run >= parser->length) {
+                return -1;
+            }
+            parser->position = run + 1;
+            if (text[run] == '"') {
+                break;
+            }
+            if (parser->position >= parser->length) {
+                return -1;
+            }
+            switch (text[parser->position]) {
+                case 'n': escaped[0] = '\n'; break;
+                case 't': escaped[0] = '\t'; break;
+                case 'r': escaped[0] = '\r'; break;
+                case 'a': escaped[0] = '\a'; break;
+                case 'b': escaped[0] = '\b'; break;
+                case 'f': escaped[0] = '\f'; break;
+                case 'v': escaped[0] = '\v'; break;
+                case 'U':
+                case 'u': {
+                    int32_t unit = AdStringParserUnicodeEscape(parser, run);
+                    int32_t low = unit >= 0xd800 && unit < 0xdc00 ? AdStringParserUnicodeEscape(parser, run + 6) : -1;
+
+                    if (unit < 0) {
+                        return -1;
+                    }
+                    if (low >= 0xdc00 && low < 0xe000) {
+                        unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                        parser->position += 6;
+                    } else if (unit >= 0xd800 && unit < 0xe000) {
+                        unit = 0xfffd;
+                    }
+                    escapedLength = AdStringEncodeUTF8((uint32_t)unit, escaped);
+                    parser->position += 4;
+                    break;
+                }
+                default:
+                    if (text[parser->position] >= '0' && text[parser->position] <= '7') {
+                        unsigned value = 0;
+
+                        for (int i = 0; i < 3 && parser->position < parser->length && text[parser->position] >= '0' && text[parser->position] <= '7'; i++) {
+                            value = value * 8 + (unsigned)(text[parser->position++] - '0');
+                        }
+                        escaped[0] = (char)value;
+                        parser->position--;
+                    } else {
+                        // \" \\ \' and any other character stand for themselves.
+                        parser->line += text[parser->position] == '\n';
+                        escaped[0] = text[parser->position];
+                    }
+                    break;
+            }
+            parser->position++;
+            if (AdStringBufferAppend(strings, escaped, escapedLength) != 0) {
+                return -1;
+            }
+        }
+    }
+    if (strings->length - start > UINT32_MAX - 1 || AdStringBufferAppend(strings, "", 1) != 0) {
+        return -1;
+    }
+    *offset = (uint32_t)start;
+    *length = (uint32_t)(strings->length - start - 1);
+    return 0;
+}
+
+/** Parses every "key" = "value"; of the source. Returns -1 on a syntax error, at parser->line, or when out of memory. */
+static int AdStringParserRun(AdStringParser *parser)
+{
+    while (AdStringParserSkip(parser) == 0) {
+        AdStringSourceEntry entry;
+
+        if (parser->position >= parser->length) {
+            return 0;
+        }
+        entry.line = parser->line;
+        if (AdStringParserToken(parser, &entry.keyOffset, &entry.keyLength) != 0 || AdStringParserSkip(parser) != 0) {
+            return -1;
+        }
+        if (parser->text[parser->position] == ';') {
+            // "key"; is "key" = "key";
+            entry.valueOffset = entry.keyOffset;
+            entry.valueLength = entry.keyLength;
+        } else if (parser->text[parser->position] == '=') {
+            parser->position++;
+            if (AdStringParserSkip(parser) != 0 || AdStringParserToken(parser, &entry.valueOffset, &entry.valueLength) != 0
+                || AdStringParserSkip(parser) != 0 || parser->text[parser->position] != ';') {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+        parser->position++;
+
+        if (parser->count == parser->capacity) {
+            size_t capacity = parser->capacity ? parser->capacity * 2 : 64;
+            AdStringSourceEntry *entries = realloc(parser->entries, capacity * sizeof(AdStringSourceEntry));
+
+            if (entries == NULL) {
+                errno = ENOMEM;
+                return -1;
+            }
+            parser->entries = entries;
+            parser->capacity = capacity;
+        }
+        parser->entries[parser->count++] = entry;
+    }
+    return -1;
+}
+
+// Compilation
+
+static const char *AdStringSortStrings;
+
+/** By key, then by line: the definitions of a key end up together, in the order of the source. */
+static int AdStringCompareEntries(const void *a, const void *b)
+{
+    const AdStringSourceEntry *entry1 = a, *entry2 = b;
+    uint32_t length = entry1->keyLength < entry2->keyLength ? entry1->keyLength : entry2->keyLength;
+    int order = memcmp(AdStringSortStrings + entry1->keyOffset, AdStringSortStrings + entry2->keyOffset, length);
+
+    if (order != 0) {
+        return order;
+    }
+    if (entry1->keyLength != entry2->keyLength) {
+        return entry1->keyLength < entry2->keyLength ? -1 : 1;
+    }
+    return entry1->line < entry2->line ? -1 : entry1->line > entry2->line;
+}
+
+static int AdStringSameString(const char *strings, uint32_t offset1, uint32_t length1, uint32_t offset2, uint32_t length2)
+{
+    return length1 == length2 && memcmp(strings + offset1, strings + offset2, length1) == 0;
+}
+
+/** Keeps the last definition of each key, reporting the others. Returns the number of keys; *duplicates gets the indices of the duplicated ones. */
+static size_t AdStringRemoveDuplicates(AdStringParser *parser, AdStringTableDuplicateHandler handler, void *info, uint32_t *duplicates, size_t *duplicateCount)
+{
+    const char *strings = parser->strings.bytes;
+    AdStringSourceEntry *entries = parser->entries;
+    size_t count = 0;
+
+    *duplicateCount = 0;
+    // The entries are parsed into one buffer, qsort has no context argument everywhere: one compilation at a time.
+    AdStringSortStrings = strings;
+    if (parser->count > 1) {
+        qsort(entries, parser->count, sizeof(AdStringSourceEntry), AdStringCompareEntries);
+    }
+    for (size_t i = 0; i < parser->count; ) {
+        size_t end = i + 1;
+        uint32_t conflict = 0;
+
+        while (end < parser->count && AdStringSameString(strings, entries[i].keyOffset, entries[i].keyLength, entries[end].keyOffset, entries[end].keyLength)) {
+            int sameValue = AdStringSameString(strings, entries[end - 1].valueOffset, entries[end - 1].valueLength, entries[end].valueOffset, entries[end].valueLength);
+
+            if (handler) {
+                handler(info, strings + entries[end].keyOffset, entries[end].line, entries[i].line, sameValue);
+            }
+            conflict |= sameValue ? 0 : kAdStringTableConflict;
+            end++;
+        }
+        if (end - i > 1) {
+            duplicates[(*duplicateCount)++] = (uint32_t)count | conflict;
+        }
+        entries[count++] = entries[end - 1];
+        i = end;
+    }
+    return count;
+}
+
+static void AdStringTablePut32(unsigned char *bytes, uint32_t value)
+{
+    bytes[0] = (unsigned char)value;
+    bytes[1] = (unsigned char)(value >> 8);
+    bytes[2] = (unsigned char)(value >> 16);
+    bytes[3] = (unsigned char)(value >> 24);
+}
+
+static size_t AdStringBucketSize(const uint32_t *bucketStarts, uint32_t bucket)
+{
+    return bucketStarts[bucket + 1] - bucketStarts[bucket];
+}
+
+static const uint32_t *AdStringSortBucketStarts;
+
+static int AdStringCompareBuckets(const void *a, const void *b)
+{
+    size_t size1 = AdStringBucketSize(AdStringSortBucketStarts, *(const uint32_t *)a);
+    size_t size2 = AdStringBucketSize(AdStringSortBucketStarts, *(const uint32_t *)b);
+
+    return size1 > size2 ? -1 : size1 < size2;
+}
+
+/** Finds a displacement per bucket, the largest buckets first, such that every key gets a slot of its own.
+
+ @param slots Receives the entry of each slot.
+ */
+static int AdStringBuildPerfectHash(const uint64_t *hashes, uint32_t count, uint32_t bucketCount, uint32_t *displacements, uint32_t *slots)
+{
+    uint32_t *bucketStarts = calloc(bucketCount + 1, sizeof(uint32_t));
+    uint32_t *bucketKeys = malloc(count * sizeof(uint32_t) + 1);
+    uint32_t *order = malloc(bucketCount * sizeof(uint32_t));
+    unsigned char *used = calloc(count + 1, 1);
+    uint32_t candidates[64];
+    int result = -1;
+
+    if (bucketStarts == NULL || bucketKeys == NULL || order == NULL || used == NULL) {
+        errno = ENOMEM;
+        goto done;
+    }
+    // Counting sort of the keys by bucket.
+    for (uint32_t i = 0; i < count; i++) {
+        bucketStarts[AdStringTableBucket(hashes[i], bucketCount) + 1]++;
+    }
+    for (uint32_t b = 0; b < bucketCount; b++) {
+        bucketStarts[b + 1] += bucketStarts[b];
+        order[b] = b;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        bucketKeys[bucketStarts[AdStringTableBucket(hashes[i], bucketCount)]++] = i;
+    }
+    for (uint32_t b = bucketCount; b > 0; b--) {
+        bucketStarts[b] = bucketStarts[b - 1];
+    }
+    bucketStarts[0] = 0;
+    AdStringSortBucketStarts = bucketStarts;
+    qsort(order, bucketCount, sizeof(uint32_t), AdStringCompareBuckets);
+
+    for (uint32_t b = 0; b < bucketCount; b++) {
+        uint32_t bucket = order[b];
+        size_t size = AdStringBucketSize(bucketStarts, bucket);
+        const uint32_t *keys = bucketKeys + bucketStarts[bucket];
+        uint32_t displacement;
+
+        if (size > sizeof(candidates) / sizeof(candidates[0])) {
+            errno = EINVAL;
+            goto done;
+        }
+        for (displacement = 0; displacement < kAdStringTableMaxDisplacement; displacement++) {
+            size_t placed = 0;
+
+            for (; placed < size; placed++) {
+                uint32_t slot = AdStringTableSlot(hashes[keys[placed]], displacement, count);
+
+                if (used[slot]) {
+                    break;
+                }
+                used[slot] = 1;
+                candidates[placed] = slot;
+            }
+            if (placed == size) {
+                break;
+            }
+            // Taken, by another bucket or by a key of this one: undo and try the next displacement.
+            for (size_t i = 0; i < placed; i++) {
+                used[candidates[i]] = 0;
+            }
+        }
+        if (displacement == kAdStringTableMaxDisplacement) {
+            // Two keys with the same 64-bit hash.
+            errno = EINVAL;
+            goto done;
+        }
+        displacements[bucket] = displacement;
+        for (size_t i = 0; i < size; i++) {
+            slots[candidates[i]] = keys[i];
+        }
+    }
+    result = 0;
+
+done:
+    free(bucketStarts);
+    free(bucketKeys);
+    free(order);
+    free(used);
+    return result;
+}
+
+int AdStringTableCompile(const void *source, size_t length, AdStringTableDuplicateHandler handler, void *info,
+                         void **table, size_t *tableLength, unsigned *errorLine)
+{
+    AdStringParser parser;
+    uint32_t *duplicates = NULL, *displacements = NULL, *slots = NULL, *slotOfEntry = NULL;
+    uint64_t *hashes = NULL;
+    AdStringBuffer output = { NULL, 0, 0 }, strings = { NULL, 0, 0 };
+    size_t count, duplicateCount;
+    uint32_t bucketCount;
+    int result = -1, error = EINVAL;
+
+    memset(&parser, 0, sizeof(parser));
+    parser.line = 1;
+    if ((parser.text = AdStringDecodeSource(source, length, &parser.length)) == NULL) {
+        return -1;
+    }
+    errno = 0;
+    if (AdStringParserRun(&parser) != 0) {
+        error = errno == ENOMEM ? ENOMEM : EINVAL;
+        if (errorLine) {
+            *errorLine = parser.line;
+        }
+        goto done;
+    }
+    if (parser.count > UINT32_MAX / 16 || (duplicates = malloc(parser.count * sizeof(uint32_t) + 1)) == NULL) {
+        error = ENOMEM;
+        goto done;
+    }
+    count = AdStringRemoveDuplicates(&parser, handler, info, duplicates, &duplicateCount);
+    bucketCount = (uint32_t)(count / kAdStringTableKeysPerBucket + 1);
+    displacements = calloc(bucketCount, sizeof(uint32_t));
+    slots = malloc(count * sizeof(uint32_t) + 1);
+    slotOfEntry = malloc(count * sizeof(uint32_t) + 1);
+    hashes = malloc(count * sizeof(uint64_t) + 1);
+    if (displacements == NULL || slots == NULL || slotOfEntry == NULL || hashes == NULL) {
+        error = ENOMEM;
+        goto done;
+    }
+    for (size_t i = 0; i < count; i++) {
+        hashes[i] = AdStringTableHash(parser.strings.bytes + parser.entries[i].keyOffset, parser.entries[i].keyLength);
+    }
+    if (count > 0 && AdStringBuildPerfectHash(hashes, (uint32_t)count, bucketCount, displacements, slots) != 0) {
+        error = errno;
+        goto done;
+    }
+
+    // The strings of the kept entries only, in the order of the slots. A value equal to its key is the key.
+    {
+        size_t headerLength = kAdStringTableHeaderLength + 4 * (bucketCount + 4 * count + duplicateCount);
+
+        if (AdStringBufferReserve(&output, headerLength) != 0) {
+            error = ENOMEM;
+            goto done;
+        }
+        output.length = headerLength;
+        for (size_t slot = 0; slot < count; slot++) {
+            const AdStringSourceEntry *entry = &parser.entries[slots[slot]];
+            unsigned char *words = (unsigned char *)output.bytes + kAdStringTableHeaderLength + 4 * bucketCount + 16 * slot;
+            uint32_t keyOffset = (uint32_t)strings.length, valueOffset = keyOffset;
+
+            if (AdStringBufferAppend(&strings, parser.strings.bytes + entry->keyOffset, entry->keyLength + 1) != 0) {
+                error = ENOMEM;
+                goto done;
+            }
+            if (!AdStringSameString(parser.strings.bytes, entry->keyOffset, entry->keyLength, entry->valueOffset, entry->valueLength)) {
+                valueOffset = (uint32_t)strings.length;
+                if (AdStringBufferAppend(&strings, parser.strings.bytes + entry->valueOffset, entry->valueLength + 1) != 0) {
+                    error = ENOMEM;
+                    goto done;
+                }
+            }
+            AdStringTablePut32(words, keyOffset);
+            AdStringTablePut32(words + 4, entry->keyLength);
+            AdStringTablePut32(words + 8, valueOffset);
+            AdStringTablePut32(words + 12, entry->valueLength);
+            slotOfEntry[slots[slot]] = (uint32_t)slot;
+        }
+        if (strings.length > UINT32_MAX) {
+            error = ENOMEM;
+            goto done;
+        }
+        // The duplicates refer to entries, which are now in slots.
+        for (size_t i = 0; i < duplicateCount; i++) {
+            duplicates[i] = slotOfEntry[duplicates[i] & ~kAdStringTableConflict] | (duplicates[i] & kAdStringTableConflict);
+        }
+
+        AdStringTablePut32((unsigned char *)output.bytes, kAdStringTableMagic);
+        AdStringTablePut32((unsigned char *)output.bytes + 4, kAdStringTableVersion);
+        AdStringTablePut32((unsigned char *)output.bytes + 8, (uint32_t)count);
+        AdStringTablePut32((unsigned char *)output.bytes + 12, bucketCount);
+        AdStringTablePut32((unsigned char *)output.bytes + 16, (uint32_t)duplicateCount);
+        AdStringTablePut32((unsigned char *)output.bytes + 20, (uint32_t)strings.length);
+        AdStringTablePut32((unsigned char *)output.bytes + 24, 0);
+        AdStringTablePut32((unsigned char *)output.bytes + 28, 0);
+        for (uint32_t b = 0; b < bucketCount; b++) {
+            AdStringTablePut32((unsigned char *)output.bytes + kAdStringTableHeaderLength + 4 * b, displacements[b]);
+        }
+        for (size_t i = 0; i < duplicateCount; i++) {
+            AdStringTablePut32((unsigned char *)output.bytes + kAdStringTableHeaderLength + 4 * (bucketCount + 4 * count + i), duplicates[i]);
+        }
+        if (AdStringBufferAppend(&output, strings.bytes, strings.length) != 0) {
+            error = ENOMEM;
+            goto done;
+        }
+    }
+    *table = output.bytes;
+    *tableLength = output.length;
+    output.bytes = NULL;
+    result = 0;
+
+done:
+    free((char *)parser.text);
+    free(parser.strings.bytes);
+    free(parser.entries);
+    free(duplicates);
+    free(displacements);
+    free(slots);
+    free(slotOfEntry);
+    free(hashes);
+    free(strings.bytes);
+    free(output.bytes);
+    if (result != 0) {
+        errno = error;
+    }
+    return result;
+}
+
+// Table
+
+/** Checks the layout and every entry once, so that lookups can trust the table. */
+static int AdStringTableLoad(AdStringTable *table, const void *bytes, size_t length)
+{
+    const uint32_t *header = bytes;
+    uint64_t required;
+    uint32_t stringsLength;
+
+    if (((uintptr_t)bytes & 3) != 0 || length < kAdStringTableHeaderLength
+        || header[0] != kAdStringTableMagic || header[1] != kAdStringTableVersion || header[3] == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    table->bytes = bytes;
+    table->length = length;
+    table->count = header[2];
+    table->bucketCount = header[3];
+    table->duplicateCount = header[4];
+    stringsLength = header[5];
+    required = kAdStringTableHeaderLength + 4 * ((uint64_t)table->bucketCount + 4 * (uint64_t)table->count + table->duplicateCount) + stringsLength;
+    if (required != length || table->duplicateCount > table->count || (stringsLength > 0 && table->bytes[length - 1] != '\0')) {
+        errno = EINVAL;
+        return -1;
+    }
+    table->buckets = header + kAdStringTableHeaderLength / 4;
+    table->entries = table->buckets + table->bucketCount;
+    table->duplicates = table->entries + 4 * (size_t)table->count;
+    table->strings = (const char *)(table->duplicates + table->duplicateCount);
+    for (uint32_t i = 0; i < table->count; i++) {
+        const uint32_t *entry = table->entries + 4 * (size_t)i;
+
+        if ((uint64_t)entry[0] + entry[1] >= stringsLength || table->strings[entry[0] + entry[1]] != '\0'
+            || (uint64_t)entry[2] + entry[3] >= stringsLength || table->strings[entry[2] + entry[3]] != '\0') {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < table->duplicateCount; i++) {
+        if ((table->duplicates[i] & ~kAdStringTableConflict) >= table->count) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+AdStringTable *AdStringTableCreateWithBytes(const void *bytes, size_t length)
+{
+    AdStringTable *table = calloc(1, sizeof(AdStringTable));
+
+    if (table == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (AdStringTableLoad(table, bytes, length) != 0) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+AdStringTable *AdStringTableOpen(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    void *map = MAP_FAILED;
+    AdStringTable *table;
+    int error;
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0) {
+        error = errno;
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+    if (info.st_size >= kAdStringTableHeaderLength) {
+        map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    error = map == MAP_FAILED && info.st_size >= kAdStringTableHeaderLength ? errno : EINVAL;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = error;
+        return NULL;
+    }
+    table = AdStringTableCreateWithBytes(map, (size_t)info.st_size);
+    if (table == NULL) {
+        error = errno;
+        munmap(map, (size_t)info.st_size);
+        errno = error;
+        return NULL;
+    }
+    table->mapped = 1;
+    return table;
+}
+
+void AdStringTableClose(AdStringTable *table)
+{
+    if (table == NULL) {
+        return;
+    }
+    if (table->mapped) {
+        munmap((void *)table->bytes, table->length);
+    }
+    free(table);
+}
+
+size_t AdStringTableGetCount(const AdStringTable *table)
+{
+    return table->count;
+}
+
+const char *AdStringTableLookup(const AdStringTable *table, const char *key, size_t keyLength, size_t *valueLength)
+{
+    uint64_t hash;
+    const uint32_t *entry;
+
+    if (table->count == 0) {
+        return NULL;
+    }
+    hash = AdStringTableHash(key, keyLength);
+    entry = table->entries + 4 * (size_t)AdStringTableSlot(hash, table->buckets[AdStringTableBucket(hash, table->bucketCount)], table->count);
+    if (entry[1] != keyLength || memcmp(table->strings + entry[0], key, keyLength) != 0) {
+        return NULL;
+    }
+    if (valueLength) {
+        *valueLength = entry[3];
+    }
+    return table->strings + entry[2];
+}
+
+const char *AdStringTableLookupInTables(const AdStringTable *const *tables, size_t count, const char *key, size_t keyLength, size_t *valueLength)
+{
+    for (size_t i = 0; i < count; i++) {
+        const char *value = tables[i] ? AdStringTableLookup(tables[i], key, keyLength, valueLength) : NULL;
+
+        if (value) {
+            return value;
+        }
+    }
+    return NULL;
+}
+
+size_t AdStringTableGetDuplicateCount(const AdStringTable *table)
+{
+    return table->duplicateCount;
+}
+
+const char *AdStringTableGetDuplicate(const AdStringTable *table, size_t index, int *conflicting)
+{
+    uint32_t duplicate;
+
+    if (index >= table->duplicateCount) {
+        return NULL;
+    }
+    duplicate = table->duplicates[index];
+    if (conflicting) {
+        *conflicting = (duplicate & kAdStringTableConflict) != 0;
+    }
+    return table->strings + table->entries[4 * (size_t)(duplicate & ~kAdStringTableConflict)];
+}
@@ -0,0 +1,83 @@
+//
+//  AdStringTable.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Compiled string tables: the Localizable.strings of sas.bundle, looked up without parsing them.
+
+ A .strings file is text, UTF-16 in sas.bundle, parsed whole whenever one of its strings is
+ needed. At build time, tools/adstrings compiles each of them into a table next to it
+ (Localizable.adstrings in the same .lproj); at run time the table is mapped and its strings are
+ read in place:
+
+ - the keys are placed by a minimal perfect hash (hash and displace): the 64-bit FNV-1a hash of
+   the key picks a bucket, whose displacement picks the only slot the key can be in, so a lookup
+   hashes the key once and compares it once, whatever the number of strings;
+ - keys and values are UTF-8 and NUL terminated in the table, a lookup returns a pointer into the
+   mapping and allocates nothing;
+ - a lookup may go through several tables in order, the user's language then English for example.
+
+ A key defined twice keeps its last value, as for the .strings file. The duplicates are reported
+ by the compiler and recorded in the table, with whether their values differed.
+
+ Layout, little endian, the byte order of every iOS device:
+
+    header      magic "ADST", version, count, bucketCount, duplicateCount, stringsLength, 0, 0
+    buckets     uint32_t displacements[bucketCount]
+    entries     { keyOffset, keyLength, valueOffset, valueLength }[count], offsets in strings
+    duplicates  uint32_t entries[duplicateCount], with kAdStringTableConflict when values differed
+    strings     stringsLength bytes
+
+ This file is plain C. An open table is read only and may be used from any thread.
+ */
+
+#ifndef DemoSmart_AdStringTable_h
+#define DemoSmart_AdStringTable_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdStringTableVersion   1
+#define kAdStringTableConflict  0x80000000u
+
+/** A key defined again at line, first defined at firstLine. sameValue is 0 when the values differ, the last one is kept. */
+typedef void (*AdStringTableDuplicateHandler)(void *info, const char *key, unsigned line, unsigned firstLine, int sameValue);
+
+/** Compiles the text of a .strings file, UTF-16 with a byte order mark or UTF-8.
+
+ Returns 0 with the table in *table, to release with free(), or -1 with errno set to EINVAL and
+ the line of the syntax error in *errorLine (when not NULL), or ENOMEM.
+
+ @param handler Called for each duplicate key, may be NULL.
+ */
+int AdStringTableCompile(const void *source, size_t length, AdStringTableDuplicateHandler handler, void *info,
+                         void **table, size_t *tableLength, unsigned *errorLine);
+
+typedef struct AdStringTable AdStringTable;
+
+/** Maps a compiled table. Returns NULL with errno set, EINVAL when the file is not a valid table. */
+AdStringTable *AdStringTableOpen(const char *path);
+
+/** Reads a compiled table in memory, without copying it: the bytes must outlive the table. */
+AdStringTable *AdStringTableCreateWithBytes(const void *bytes, size_t length);
+
+void AdStringTableClose(AdStringTable *table);
+
+size_t AdStringTableGetCount(const AdStringTable *table);
+
+/** The value of the key, NUL terminated, valid until the table is closed, or NULL when the table does not have it. */
+const char *AdStringTableLookup(const AdStringTable *table, const char *key, size_t keyLength, size_t *valueLength);
+
+/** The value of the key in the first of the tables that has it. NULL tables are skipped. */
+const char *AdStringTableLookupInTables(const AdStringTable *const *tables, size_t count, const char *key, size_t keyLength, size_t *valueLength);
+
+size_t AdStringTableGetDuplicateCount(const AdStringTable *table);
+
+/** The key of a duplicate, with *conflicting set to 1 when its values differed in the source. */
+const char *AdStringTableGetDuplicate(const AdStringTable *table, size_t index, int *conflicting);
+
+#endif
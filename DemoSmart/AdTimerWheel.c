@@ -0,0 +1,259 @@
+//
+//  AdTimerWheel.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdTimerWheel.h"
+
+#include <stdlib.h>
+
+#define kAdTimerNumberBits  16
+#define kAdTimerNumberMask  ((1u << kAdTimerNumberBits) - 1)
+#define kAdTimerListFree    UINT32_MAX
+
+typedef struct {
+    uint64_t expiration;
+    void *context;
+    uint32_t previous;      /* entry numbers, 0 for none */
+    uint32_t next;
+    uint32_t list;          /* the slot, the expired list or kAdTimerListFree */
+    uint16_t generation;
+} AdTimerEntry;
+
+struct AdTimerWheel {
+    uint64_t now;
+    uint32_t mask;
+    uint32_t expired;       /* the list of expired timers waiting for their callback, after the slots */
+    uint32_t *heads;
+    AdTimerEntry *entries;  /* entries[0] is unused, so that 0 ends the lists */
+    uint32_t capacity;
+    uint32_t freeList;
+    uint32_t count;
+};
+
+// Lists
+
+static void AdTimerWheelLink(AdTimerWheel *wheel, uint32_t number, uint32_t list)
+{
+    AdTimerEntry *entry = &wheel->entries[number];
+
+    entry->list = list;
+    entry->previous = 0;
+    entry->next = wheel->heads[list];
+    if (entry->next) {
+        wheel->entries[entry->next].previous = number;
+    }
+    wheel->heads[list] = number;
+}
+
+static void AdTimerWheelUnlink(AdTimerWheel *wheel, uint32_t number)
+{
+    AdTimerEntry *entry = &wheel->entries[number];
+
+    if (entry->previous) {
+        wheel->entries[entry->previous].next = entry->next;
+    } else {
+        wheel->heads[entry->list] = entry->next;
+    }
+    if (entry->next) {
+        wheel->entries[entry->next].previous = entry->previous;
+    }
+}
+
+static void AdTimerWheelFree(AdTimerWheel *wheel, uint32_t number)
+{
+    AdTimerEntry *entry = &wheel->entries[number];
+
+    entry->list = kAdTimerListFree;
+    entry->generation++;
+    entry->context = NULL;
+    entry->next = wheel->freeList;
+    wheel->freeList = number;
+    wheel->count--;
+}
+
+/** The number of a pending timer, 0 if the identifier is stale. */
+static uint32_t AdTimerWheelLookup(const AdTimerWheel *wheel, AdTimer timer)
+{
+    uint32_t number = timer & kAdTimerNumberMask;
+
+    if (number == 0 || number >= wheel->capacity) {
+        return 0;
+    }
+    if (wheel->entries[number].list == kAdTimerListFree || wheel->entries[number].generation != (timer >> kAdTimerNumberBits)) {
+        return 0;
+    }
+    return number;
+}
+
+// Wheel
+
+AdTimerWheel *AdTimerWheelCreate(uint32_t slotCount)
+{
+    AdTimerWheel *wheel = calloc(1, sizeof(AdTimerWheel));
+    uint32_t slots = 1;
+
+    if (wheel == NULL) {
+        return NULL;
+    }
+    while (slots < slotCount && slots < (1u << 20)) {
+        slots <<= 1;
+    }
+    wheel->mask = slots - 1;
+    wheel->expired = slots;
+    wheel->heads = calloc((size_t)slots + 1, sizeof(uint32_t));
+    wheel->capacity = 1;
+    wheel->entries = calloc(1, sizeof(AdTimerEntry));
+    if (wheel->heads == NULL || wheel->entries == NULL) {
+        AdTimerWheelRelease(wheel);
+        return NULL;
+    }
+    return wheel;
+}
+
+void AdTimerWheelRelease(AdTimerWheel *wheel)
+{
+    if (wheel) {
+        free(wheel->heads);
+        free(wheel->entries);
+        free(wheel);
+    }
+}
+
+AdTimer AdTimerWheelSchedule(AdTimerWheel *wheel, uint64_t delay, void *context)
+{
+    AdTimerEntry *entry;
+    uint32_t number = wheel->freeList;
+
+    if (number) {
+        wheel->freeList = wheel->entries[number].next;
+    } else {
+        uint32_t capacity = wheel->capacity * 2;
+        AdTimerEntry *entries;
+
+        if (wheel->capacity > kAdTimerWheelMaxTimers) {
+            return kAdTimerNone;
+        }
+        if (capacity > kAdTimerWheelMaxTimers + 1) {
+            capacity = kAdTimerWheelMaxTimers + 1;
+        }
+        entries = realloc(wheel->entries, capacity * sizeof(AdTimerEntry));
+        if (entries == NULL) {
+            return kAdTimerNone;
+        }
+        for (uint32_t i = wheel->capacity; i < capacity; i++) {
+            entries[i].list = kAdTimerListFree;
+            entries[i].generation = 0;
+        }
+        wheel->entries = entries;
+        number = wheel->capacity;
+        // The new entries past the first one go to the free list.
+        for (uint32_t i = capacity - 1; i > number; i--) {
+            entries[i].next = wheel->freeList;
+            wheel->freeList = i;
+        }
+        wheel->capacity = capacity;
+    }
+
+    entry = &wheel->entries[number];
+    entry->expiration = wheel->now + (delay < 1 ? 1 : delay);
+    entry->context = context;
+    AdTimerWheelLink(wheel, number, (uint32_t)(entry->expiration & wheel->mask));
+    wheel->count++;
+    return ((AdTimer)entry->generation << kAdTimerNumberBits) | number;
+}
+
+int AdTimerWheelCancel(AdTimerWheel *wheel, AdTimer timer)
+{
+    uint32_t number = AdTimerWheelLookup(wheel, timer);
+
+    if (number == 0) {
+        return -1;
+    }
+    AdTimerWheelUnlink(wheel, number);
+    AdTimerWheelFree(wheel, number);
+    return 0;
+}
+
+/** Moves the timers of a slot that expired by now to the expired list. */
+static void AdTimerWheelCollect(AdTimerWheel *wheel, uint32_t slot)
+{
+    uint32_t number = wheel->heads[slot];
+
+    while (number) {
+        uint32_t next = wheel->entries[number].next;
+        if (wheel->entries[number].expiration <= wheel->now) {
+            AdTimerWheelUnlink(wheel, number);
+            AdTimerWheelLink(wheel, number, wheel->expired);
+        }
+        number = next;
+    }
+}
+
+static size_t AdTimerWheelFireExpired(AdTimerWheel *wheel, AdTimerWheelCallback callback, void *info)
+{
+    size_t fired = 0;
+
+    // Callbacks may cancel expired timers that are still waiting, so the list is read again each time.
+    while (wheel->heads[wheel->expired]) {
+        uint32_t number = wheel->heads[wheel->expired];
+        AdTimerEntry *entry = &wheel->entries[number];
+        AdTimer timer = ((AdTimer)entry->generation << kAdTimerNumberBits) | number;
+        void *context = entry->context;
+
+        AdTimerWheelUnlink(wheel, number);
+        AdTimerWheelFree(wheel, number);
+        callback(info, timer, context);
+        fired++;
+    }
+    return fired;
+}
+
+size_t AdTimerWheelAdvance(AdTimerWheel *wheel, uint64_t ticks, AdTimerWheelCallback callback, void *info)
+{
+    size_t fired = 0;
+
+    // Past a turn of the wheel every slot is visited once, rather than once per tick.
+    if (ticks > wheel->mask) {
+        wheel->now += ticks;
+        for (uint32_t slot = 0; slot <= wheel->mask; slot++) {
+            AdTimerWheelCollect(wheel, slot);
+        }
+        return AdTimerWheelFireExpired(wheel, callback, info);
+    }
+    for (uint64_t i = 0; i < ticks; i++) {
+        wheel->now++;
+        AdTimerWheelCollect(wheel, (uint32_t)(wheel->now & wheel->mask));
+        fired += AdTimerWheelFireExpired(wheel, callback, info);
+    }
+    return fired;
+}
+
+uint64_t AdTimerWheelNextExpiration(const AdTimerWheel *wheel)
+{
+    uint64_t next = kAdTimerWheelNoTimer;
+
+    for (uint32_t number = 1; number < wheel->capacity; number++) {
+        const AdTimerEntry *entry = &wheel->entries[number];
+        if (entry->list != kAdTimerListFree && entry->expiration < next) {
+            next = entry->expiration;
+        }
+    }
+    if (next == kAdTimerWheelNoTimer) {
+        return next;
+    }
+    return next > wheel->now ? next - wheel->now : 0;
+}
+
+uint64_t AdTimerWheelGetTime(const AdTimerWheel *wheel)
+{
+    return wheel->now;
+}
+
+uint32_t AdTimerWheelGetCount(const AdTimerWheel *wheel)
+{
+    return wheel->count;
+}
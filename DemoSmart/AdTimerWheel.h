@@ -0,0 +1,61 @@
+//
+//  AdTimerWheel.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Hashed timer wheel: many timers driven by one clock.
+
+ Time is counted in ticks, whose length is up to the caller. A timer due at tick t waits in slot
+ t % slotCount, so scheduling and cancelling are O(1) and advancing by a tick only visits the
+ timers of one slot. Timers further than a turn of the wheel stay in their slot until their tick
+ comes round.
+
+ The wheel has no thread and no clock of its own: the caller arms a single system timer for
+ AdTimerWheelNextExpiration ticks and advances the wheel by the ticks that really elapsed, so
+ timers due at the same tick fire in one wake-up.
+
+ This file is plain C. A wheel is not thread safe, callers serialize access.
+ */
+
+#ifndef DemoSmart_AdTimerWheel_h
+#define DemoSmart_AdTimerWheel_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdTimerWheelMaxTimers  65535
+#define kAdTimerNone            0
+#define kAdTimerWheelNoTimer    UINT64_MAX
+
+/** Identifies a scheduled timer. Identifiers of fired or cancelled timers are not reused right away, so a stale one is harmless. */
+typedef uint32_t AdTimer;
+
+/** Called for each expired timer. The callback may schedule and cancel timers, the expired one included. */
+typedef void (*AdTimerWheelCallback)(void *info, AdTimer timer, void *context);
+
+typedef struct AdTimerWheel AdTimerWheel;
+
+/** Returns NULL when out of memory. slotCount is rounded up to a power of two. */
+AdTimerWheel *AdTimerWheelCreate(uint32_t slotCount);
+void AdTimerWheelRelease(AdTimerWheel *wheel);
+
+/** Schedules a timer delay ticks from now, at least 1. Returns kAdTimerNone when out of memory or full. */
+AdTimer AdTimerWheelSchedule(AdTimerWheel *wheel, uint64_t delay, void *context);
+
+/** Returns 0 if the timer was pending, -1 if it already fired or was cancelled. */
+int AdTimerWheelCancel(AdTimerWheel *wheel, AdTimer timer);
+
+/** Advances the clock by the ticks elapsed since the last call, firing the timers that expired. Returns the number fired. */
+size_t AdTimerWheelAdvance(AdTimerWheel *wheel, uint64_t ticks, AdTimerWheelCallback callback, void *info);
+
+/** The number of ticks until the next timer expires, kAdTimerWheelNoTimer when none is pending. O(timers). */
+uint64_t AdTimerWheelNextExpiration(const AdTimerWheel *wheel);
+
+uint64_t AdTimerWheelGetTime(const AdTimerWheel *wheel);
+uint32_t AdTimerWheelGetCount(const AdTimerWheel *wheel);
+
+#endif
@@ -0,0 +1,897 @@
+//
+//  AdTrace.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdTrace.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define kAdTraceMagic           0x52544441u     /* "ADTR" */
+#define kAdTraceHeaderLength    16
+#define kAdTracePixelMaxLength  64              /* a 1x1 GIF is 43 bytes */
+#define kAdTraceKeyLength       2048            /* longer keys are allocated */
+
+const char *const kAdTraceVolatileParameters[] = {
+    "tmstp", "uid", "lat", "long", "hdg",                           /* the ad call, see AdCallURL.h */
+    "rnd", "random", "cb", "cachebuster", "ord", "timestamp",       /* the cache busters of the pixels */
+    NULL
+};
+
+static uint64_t AdTraceHash(const void *bytes, size_t length)
+{
+    const uint8_t *cursor = bytes;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ cursor[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static size_t AdTraceWriteVarint(uint8_t *buffer, uint64_t value)
+{
+    size_t length = 0;
+
+    while (value >= 0x80) {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+static size_t AdTraceReadVarint(const uint8_t *bytes, size_t length, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < length && i < 10; i++) {
+        result |= (uint64_t)(bytes[i] & 0x7f) << (7 * i);
+        if ((bytes[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// URLs
+
+const char *AdTraceKindName(AdTraceKind kind)
+{
+    switch (kind) {
+        case AdTraceKindAdCall: return "ad call";
+        case AdTraceKindCreative: return "creative";
+        case AdTraceKindPixel: return "pixel";
+        default: return "unknown";
+    }
+}
+
+/** The host of the URL, after its scheme, and in path the rest up to the query or fragment. */
+static const char *AdTraceSplitURL(const char *URL, size_t length, size_t *hostLength, const char **path, size_t *pathLength)
+{
+    const char *end = URL + length, *host = URL, *cursor;
+
+    for (cursor = URL; cursor + 2 < end && *cursor != '/' && *cursor != '?'; cursor++) {
+        if (cursor[0] == ':' && cursor[1] == '/' && cursor[2] == '/') {
+            host = cursor + 3;
+            break;
+        }
+    }
+    for (cursor = host; cursor < end && *cursor != '/' && *cursor != '?' && *cursor != '#'; cursor++) {
+    }
+    *hostLength = (size_t)(cursor - host);
+    *path = cursor;
+    for (; cursor < end && *cursor != '?' && *cursor != '#'; cursor++) {
+    }
+    *pathLength = (size_t)(cursor - *path);
+    return host;
+}
+
+AdTraceKind AdTraceClassify(const char *URL, uint16_t status, const char *contentType, size_t bodyLength)
+{
+    size_t hostLength, pathLength;
+    const char *path;
+
+    AdTraceSplitURL(URL, strlen(URL), &hostLength, &path, &pathLength);
+    while (pathLength > 0 && path[pathLength - 1] == '/') {
+        pathLength--;
+    }
+    if (pathLength >= 3 && memcmp(path + pathLength - 3, "/ac", 3) == 0) {
+        return AdTraceKindAdCall;
+    }
+    if (bodyLength == 0 || status == 204 || (status >= 300 && status < 400)
+        || (bodyLength <= kAdTracePixelMaxLength && contentType && strncasecmp(contentType, "image/", 6) == 0)) {
+        return AdTraceKindPixel;
+    }
+    return AdTraceKindCreative;
+}
+
+static void AdTraceAppendKey(char *buffer, size_t capacity, size_t *length, const char *bytes, size_t count, int lowercase)
+{
+    for (size_t i = 0; i < count; i++, (*length)++) {
+        if (*length + 1 < capacity) {
+            buffer[*length] = lowercase ? (char)tolower((unsigned char)bytes[i]) : bytes[i];
+        }
+    }
+}
+
+static int AdTraceIsVolatile(const char *name, size_t length)
+{
+    for (const char *const *parameter = kAdTraceVolatileParameters; *parameter; parameter++) {
+        if (strlen(*parameter) == length && memcmp(*parameter, name, length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** The host and path of the URL, with the query unless approximate. */
+static size_t AdTraceKey(const char *URL, size_t length, int approximate, char *buffer, size_t capacity)
+{
+    const char *end = URL + length, *host, *path;
+    size_t hostLength, pathLength, keyLength = 0;
+    int first = 1;
+
+    host = AdTraceSplitURL(URL, length, &hostLength, &path, &pathLength);
+    AdTraceAppendKey(buffer, capacity, &keyLength, host, hostLength, 1);
+    AdTraceAppendKey(buffer, capacity, &keyLength, pathLength ? path : "/", pathLength ? pathLength : 1, 0);
+    if (!approximate && path + pathLength < end && path[pathLength] == '?') {
+        const char *parameter = path + pathLength + 1, *queryEnd = memchr(parameter, '#', (size_t)(end - parameter));
+
+        for (queryEnd = queryEnd ? queryEnd : end; parameter < queryEnd;) {
+            const char *next = memchr(parameter, '&', (size_t)(queryEnd - parameter));
+            size_t parameterLength = (size_t)((next ? next : queryEnd) - parameter);
+            const char *equal = memchr(parameter, '=', parameterLength);
+
+            if (parameterLength > 0 && !AdTraceIsVolatile(parameter, equal ? (size_t)(equal - parameter) : parameterLength)) {
+                AdTraceAppendKey(buffer, capacity, &keyLength, first ? "?" : "&", 1, 0);
+                AdTraceAppendKey(buffer, capacity, &keyLength, parameter, parameterLength, 0);
+                first = 0;
+            }
+            parameter = next ? next + 1 : queryEnd;
+        }
+    }
+    if (keyLength < capacity) {
+        buffer[keyLength] = '\0';
+    } else if (capacity > 0) {
+        buffer[capacity - 1] = '\0';
+    }
+    return keyLength;
+}
+
+size_t AdTraceNormalizeURL(const char *URL, size_t length, char *buffer, size_t capacity)
+{
+    return AdTraceKey(URL, length, 0, buffer, capacity);
+}
+
+// Writing
+
+typedef struct {
+    uint64_t hash;
+    size_t length;
+    uint8_t *bytes;
+} AdTraceBody;
+
+struct AdTraceWriter {
+    FILE *file;
+    uint64_t previousStart;
+    char *previousURL;
+    size_t previousURLLength;
+    size_t previousURLCapacity;
+    AdTraceBody *bodies;        // the bodies already written, numbered in their order
+    size_t bodyCount;
+    size_t bodyCapacity;
+    uint32_t *slots;            // open addressing, body number + 1, 0 when empty
+    size_t slotCount;
+    uint8_t *record;
+    size_t recordCapacity;
+};
+
+AdTraceWriter *AdTraceWriterCreate(const char *path)
+{
+    AdTraceWriter *writer = calloc(1, sizeof(*writer));
+    uint8_t header[kAdTraceHeaderLength];
+    struct timeval now;
+    uint64_t startTime;
+    int error;
+
+    if (writer == NULL) {
+        return NULL;
+    }
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        error = errno;
+        free(writer);
+        errno = error;
+        return NULL;
+    }
+    gettimeofday(&now, NULL);
+    startTime = (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_usec;
+    for (int i = 0; i < 4; i++) {
+        header[i] = (uint8_t)(kAdTraceMagic >> (8 * i));
+        header[4 + i] = (uint8_t)(kAdTraceVersion >> (8 * i));
+    }
+    for (int i = 0; i < 8; i++) {
+        header[8 + i] = (uint8_t)(startTime >> (8 * i));
+    }
+    if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+        error = errno ? errno : EIO;
+        fclose(writer->file);
+        free(writer);
+        errno = error;
+        return NULL;
+    }
+    return writer;
+}
+
+/** The number of the body if it was already written, else remembers it and returns -1. */
+static long AdTraceWriterFindBody(AdTraceWriter *writer, const void *bytes, size_t length)
+{
+    uint64_t hash = AdTraceHash(bytes, length);
+    size_t slot;
+
+    if (writer->bodyCount + 1 > writer->slotCount / 2) {
+        size_t slotCount = writer->slotCount ? writer->slotCount * 2 : 64;
+        uint32_t *slots = calloc(slotCount, sizeof(uint32_t));
+
+        if (slots == NULL) {
+            return -2;
+        }
+        for (size_t i = 0; i < writer->bodyCount; i++) {
+            for (slot = writer->bodies[i].hash & (slotCount - 1); slots[slot]; slot = (slot + 1) & (slotCount - 1)) {
+            }
+            slots[slot] = (uint32_t)i + 1;
+        }
+        free(writer->slots);
+        writer->slots = slots;
+        writer->slotCount = slotCount;
+    }
+    for (slot = hash & (writer->slotCount - 1); writer->slots[slot]; slot = (slot + 1) & (writer->slotCount - 1)) {
+        const AdTraceBody *body = &writer->bodies[writer->slots[slot] - 1];
+
+        if (body->hash == hash && body->length == length && memcmp(body->bytes, bytes, length) == 0) {
+            return (long)(writer->slots[slot] - 1);
+        }
+    }
+    if (writer->bodyCount == writer->bodyCapacity) {
+        size_t capacity = writer->bodyCapacity ? writer->bodyCapacity * 2 : 16;
+        AdTraceBody *bodies = realloc(writer->bodies, capacity * sizeof(*bodies));
+
+        if (bodies == NULL) {
+            return -2;
+        }
+        writer->bodies = bodies;
+        writer->bodyCapacity = capacity;
+    }
+    writer->bodies[writer->bodyCount].bytes = malloc(length);
+    if (writer->bodies[writer->bodyCount].bytes == NULL) {
+        return -2;
+    }
+    memcpy(writer->bodies[writer->bodyCount].bytes, bytes, length);
+    writer->bodies[writer->bodyCount].hash = hash;
+    writer->bodies[writer->bodyCount].length = length;
+    writer->slots[slot] = (uint32_t)++writer->bodyCount;
+    return -1;
+}
+
+static size_t AdTraceWriteString(uint8_t *buffer, const char *string, size_t length)
+{
+    size_t written = AdTraceWriteVarint(buffer, length);
+
+    if (length > 0) {
+        memcpy(buffer + written, string, length);
+    }
+    return written + length;
+}
+
+int AdTraceWriterAppend(AdTraceWriter *writer, const AdTraceExchange *exchange)
+{
+    const char *contentType = exchange->contentType ? exchange->contentType : "";
+    const char *location = exchange->location ? exchange->location : "";
+    size_t methodLength, URLLength, shared = 0, capacity, length = 0, prefixLength;
+    uint8_t prefix[10];
+    long body = -1;
+
+    if (exchange->method == NULL || exchange->URL == NULL || (exchange->body == NULL && exchange->bodyLength > 0)
+        || exchange->kind >= AdTraceKindCount || exchange->start < writer->previousStart) {
+        errno = EINVAL;
+        return -1;
+    }
+    methodLength = strlen(exchange->method);
+    URLLength = strlen(exchange->URL);
+    capacity = 16 * 10 + methodLength + URLLength + strlen(contentType) + strlen(location) + exchange->bodyLength;
+    if (capacity > writer->recordCapacity) {
+        uint8_t *record = realloc(writer->record, capacity);
+
+        if (record == NULL) {
+            return -1;
+        }
+        writer->record = record;
+        writer->recordCapacity = capacity;
+    }
+    if (URLLength + 1 > writer->previousURLCapacity) {
+        char *previousURL = realloc(writer->previousURL, URLLength + 1);
+
+        if (previousURL == NULL) {
+            return -1;
+        }
+        writer->previousURL = previousURL;
+        writer->previousURLCapacity = URLLength + 1;
+    }
+    if (exchange->bodyLength > 0) {
+        body = AdTraceWriterFindBody(writer, exchange->body, exchange->bodyLength);
+        if (body == -2) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    while (shared < URLLength && shared < writer->previousURLLength && exchange->URL[shared] == writer->previousURL[shared]) {
+        shared++;
+    }
+
+    writer->record[length++] = (uint8_t)exchange->kind;
+    length += AdTraceWriteVarint(writer->record + length, exchange->start - writer->previousStart);
+    length += AdTraceWriteVarint(writer->record + length, exchange->firstByte);
+    length += AdTraceWriteVarint(writer->record + length, exchange->duration);
+    length += AdTraceWriteVarint(writer->record + length, exchange->status);
+    length += AdTraceWriteString(writer->record + length, exchange->method, methodLength);
+    length += AdTraceWriteVarint(writer->record + length, shared);
+    length += AdTraceWriteString(writer->record + length, exchange->URL + shared, URLLength - shared);
+    length += AdTraceWriteString(writer->record + length, contentType, strlen(contentType));
+    length += AdTraceWriteString(writer->record + length, location, strlen(location));
+    if (body >= 0) {
+        length += AdTraceWriteVarint(writer->record + length, (uint64_t)body + 1);
+    } else {
+        writer->record[length++] = 0;
+        length += AdTraceWriteString(writer->record + length, exchange->body, exchange->bodyLength);
+    }
+
+    prefixLength = AdTraceWriteVarint(prefix, length);
+    if (fwrite(prefix, 1, prefixLength, writer->file) != prefixLength || fwrite(writer->record, 1, length, writer->file) != length) {
+        errno = errno ? errno : EIO;
+        return -1;
+    }
+    memcpy(writer->previousURL, exchange->URL, URLLength + 1);
+    writer->previousURLLength = URLLength;
+    writer->previousStart = exchange->start;
+    return 0;
+}
+
+int AdTraceWriterFlush(AdTraceWriter *writer)
+{
+    return fflush(writer->file) == 0 ? 0 : -1;
+}
+
+int AdTraceWriterClose(AdTraceWriter *writer)
+{
+    int status;
+
+    if (writer == NULL) {
+        return 0;
+    }
+    status = fclose(writer->file) == 0 ? 0 : -1;
+    for (size_t i = 0; i < writer->bodyCount; i++) {
+        free(writer->bodies[i].bytes);
+    }
+    free(writer->bodies);
+    free(writer->slots);
+    free(writer->previousURL);
+    free(writer->record);
+    free(writer);
+    return status;
+}
+
+// Reading
+
+struct AdTrace {
+    const uint8_t *bytes;
+    size_t length;
+    uint64_t startTime;
+    AdTraceExchange *exchanges;
+    size_t count;
+    char *strings;              // the strings of the exchanges, NUL terminated
+    size_t *sessions;           // the first exchange of each session
+    size_t sessionCount;
+};
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} AdTraceArena;
+
+/** Appends the first prefixLength bytes of the string at prefixOffset in the arena, the bytes and a NUL. Returns the offset of the copy, or -1. */
+static long AdTraceArenaAppend(AdTraceArena *arena, size_t prefixOffset, size_t prefixLength, const void *bytes, size_t length)
+{
+    size_t offset = arena->length, needed = offset + prefixLength + length + 1;
+
+    if (needed > arena->capacity) {
+        size_t capacity = arena->capacity ? arena->capacity : 4096;
+        char *grown;
+
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        grown = realloc(arena->bytes, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        arena->bytes = grown;
+        arena->capacity = capacity;
+    }
+    memcpy(arena->bytes + offset, arena->bytes + prefixOffset, prefixLength);
+    memcpy(arena->bytes + offset + prefixLength, bytes, length);
+    arena->bytes[needed - 1] = '\0';
+    arena->length = needed;
+    return (long)offset;
+}
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+    int damaged;
+} AdTraceCursor;
+
+static uint64_t AdTraceCursorVarint(AdTraceCursor *cursor)
+{
+    uint64_t value = 0;
+    size_t used = AdTraceReadVarint(cursor->bytes + cursor->offset, cursor->length - cursor->offset, &value);
+
+    cursor->damaged |= used == 0;
+    cursor->offset += used;
+    return value;
+}
+
+static const uint8_t *AdTraceCursorBytes(AdTraceCursor *cursor, size_t *length)
+{
+    const uint8_t *bytes;
+
+    *length = (size_t)AdTraceCursorVarint(cursor);
+    if (cursor->damaged || *length > cursor->length - cursor->offset) {
+        cursor->damaged = 1;
+        *length = 0;
+        return cursor->bytes;
+    }
+    bytes = cursor->bytes + cursor->offset;
+    cursor->offset += *length;
+    return bytes;
+}
+
+/** Decodes the records. The strings of the exchanges hold offsets in the arena until the parsing is done. */
+static int AdTraceParse(AdTrace *trace, AdTraceArena *arena, size_t **stringOffsets)
+{
+    const uint8_t **bodies = NULL;
+    size_t *bodyLengths = NULL, bodyCount = 0, capacity = 0, offset = kAdTraceHeaderLength;
+    size_t previousURL = 0, previousURLLength = 0;
+    uint64_t start = 0;
+
+    while (offset < trace->length) {
+        AdTraceCursor cursor = { trace->bytes, trace->length, offset, 0 };
+        uint64_t recordLength = AdTraceCursorVarint(&cursor);
+        AdTraceExchange *exchange;
+        const uint8_t *method, *suffix, *contentType, *location;
+        size_t methodLength, shared, suffixLength, contentTypeLength, locationLength;
+        long strings[4];
+        uint64_t kind, body;
+
+        if (cursor.damaged || recordLength > trace->length - cursor.offset) {
+            break;      // the last record was cut short
+        }
+        cursor.length = cursor.offset + (size_t)recordLength;
+        offset = cursor.length;
+        if (trace->count == capacity) {
+            size_t newCapacity = capacity ? capacity * 2 : 64;
+            AdTraceExchange *exchanges = realloc(trace->exchanges, newCapacity * sizeof(*exchanges));
+            size_t *offsets = realloc(*stringOffsets, newCapacity * 4 * sizeof(size_t));
+
+            if (exchanges) {
+                trace->exchanges = exchanges;
+            }
+            if (offsets) {
+                *stringOffsets = offsets;
+            }
+            if (exchanges == NULL || offsets == NULL) {
+                goto failed;
+            }
+            capacity = newCapacity;
+        }
+        exchange = &trace->exchanges[trace->count];
+        memset(exchange, 0, sizeof(*exchange));
+
+        kind = cursor.offset < cursor.length ? cursor.bytes[cursor.offset++] : AdTraceKindCount;
+        start += AdTraceCursorVarint(&cursor);
+        exchange->firstByte = (uint32_t)AdTraceCursorVarint(&cursor);
+        exchange->duration = (uint32_t)AdTraceCursorVarint(&cursor);
+        exchange->status = (uint16_t)AdTraceCursorVarint(&cursor);
+        method = AdTraceCursorBytes(&cursor, &methodLength);
+        shared = (size_t)AdTraceCursorVarint(&cursor);
+        suffix = AdTraceCursorBytes(&cursor, &suffixLength);
+        contentType = AdTraceCursorBytes(&cursor, &contentTypeLength);
+        location = AdTraceCursorBytes(&cursor, &locationLength);
+        body = AdTraceCursorVarint(&cursor);
+        if (cursor.damaged || kind >= AdTraceKindCount || shared > previousURLLength || body > bodyCount) {
+            goto invalid;
+        }
+        exchange->kind = (AdTraceKind)kind;
+        exchange->start = start;
+        if (body > 0) {
+            exchange->body = bodies[body - 1];
+            exchange->bodyLength = bodyLengths[body - 1];
+        } else {
+            exchange->body = AdTraceCursorBytes(&cursor, &exchange->bodyLength);
+            if (cursor.damaged) {
+                goto invalid;
+            }
+            if (exchange->bodyLength > 0) {
+                if ((bodyCount & (bodyCount - 1)) == 0) {
+                    const uint8_t **grownBodies = realloc(bodies, (bodyCount ? bodyCount * 2 : 1) * sizeof(*bodies));
+                    size_t *grownLengths = realloc(bodyLengths, (bodyCount ? bodyCount * 2 : 1) * sizeof(*bodyLengths));
+
+                    if (grownBodies) {
+                        bodies = grownBodies;
+                    }
+                    if (grownLengths) {
+                        bodyLengths = grownLengths;
+                    }
+                    if (grownBodies == NULL || grownLengths == NULL) {
+                        goto failed;
+                    }
+                }
+                bodies[bodyCount] = exchange->body;
+                bodyLengths[bodyCount++] = exchange->bodyLength;
+            }
+        }
+        if (cursor.offset != cursor.length) {
+            goto invalid;
+        }
+
+        // The URL starts with the beginning of the previous one, already in the arena.
+        strings[0] = AdTraceArenaAppend(arena, 0, 0, method, methodLength);
+        strings[1] = AdTraceArenaAppend(arena, previousURL, shared, suffix, suffixLength);
+        strings[2] = AdTraceArenaAppend(arena, 0, 0, contentType, contentTypeLength);
+        strings[3] = AdTraceArenaAppend(arena, 0, 0, location, locationLength);
+        if (strings[0] < 0 || strings[1] < 0 || strings[2] < 0 || strings[3] < 0) {
+            goto failed;
+        }
+        for (int i = 0; i < 4; i++) {
+            (*stringOffsets)[trace->count * 4 + i] = (size_t)strings[i];
+        }
+        previousURL = (size_t)strings[1];
+        previousURLLength = shared + suffixLength;
+        trace->count++;
+    }
+    free(bodies);
+    free(bodyLengths);
+    return 0;
+
+invalid:
+    errno = EINVAL;
+failed:
+    free(bodies);
+    free(bodyLengths);
+    return -1;
+}
+
+AdTrace *AdTraceOpen(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    void *map = MAP_FAILED;
+    AdTrace *trace;
+    AdTraceArena arena = { NULL, 0, 0 };
+    size_t *stringOffsets = NULL;
+    int error;
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0) {
+        error = errno;
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+    if (info.st_size >= kAdTraceHeaderLength) {
+        map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    error = map == MAP_FAILED && info.st_size >= kAdTraceHeaderLength ? errno : EINVAL;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = error;
+        return NULL;
+    }
+    trace = calloc(1, sizeof(*trace));
+    if (trace == NULL) {
+        munmap(map, (size_t)info.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    trace->bytes = map;
+    trace->length = (size_t)info.st_size;
+    for (int i = 7; i >= 0; i--) {
+        trace->startTime = trace->startTime << 8 | trace->bytes[8 + i];
+    }
+    if (memcmp(trace->bytes, "ADTR", 4) != 0 || trace->bytes[4] != kAdTraceVersion || trace->bytes[5] || trace->bytes[6] || trace->bytes[7]) {
+        errno = EINVAL;
+        goto failed;
+    }
+    if (AdTraceParse(trace, &arena, &stringOffsets) != 0) {
+        goto failed;
+    }
+
+    trace->strings = arena.bytes;
+    arena.bytes = NULL;
+    trace->sessions = malloc((trace->count + 1) * sizeof(size_t));
+    if (trace->sessions == NULL) {
+        errno = ENOMEM;
+        goto failed;
+    }
+    for (size_t i = 0; i < trace->count; i++) {
+        AdTraceExchange *exchange = &trace->exchanges[i];
+
+        exchange->method = trace->strings + stringOffsets[i * 4];
+        exchange->URL = trace->strings + stringOffsets[i * 4 + 1];
+        exchange->contentType = trace->strings + stringOffsets[i * 4 + 2];
+        exchange->location = trace->strings + stringOffsets[i * 4 + 3];
+        if (i == 0 || exchange->kind == AdTraceKindAdCall) {
+            trace->sessions[trace->sessionCount++] = i;
+        }
+    }
+    free(stringOffsets);
+    return trace;
+
+failed:
+    error = errno;
+    free(arena.bytes);
+    free(stringOffsets);
+    AdTraceClose(trace);
+    errno = error;
+    return NULL;
+}
+
+void AdTraceClose(AdTrace *trace)
+{
+    if (trace == NULL) {
+        return;
+    }
+    munmap((void *)trace->bytes, trace->length);
+    free(trace->exchanges);
+    free(trace->strings);
+    free(trace->sessions);
+    free(trace);
+}
+
+uint64_t AdTraceGetStartTime(const AdTrace *trace)
+{
+    return trace->startTime;
+}
+
+size_t AdTraceGetCount(const AdTrace *trace)
+{
+    return trace->count;
+}
+
+const AdTraceExchange *AdTraceGetExchange(const AdTrace *trace, size_t index)
+{
+    return index < trace->count ? &trace->exchanges[index] : NULL;
+}
+
+size_t AdTraceGetSessionCount(const AdTrace *trace)
+{
+    return trace->sessionCount;
+}
+
+size_t AdTraceGetSession(const AdTrace *trace, size_t session, size_t *count)
+{
+    size_t first = trace->sessions[session];
+
+    *count = (session + 1 < trace->sessionCount ? trace->sessions[session + 1] : trace->count) - first;
+    return first;
+}
+
+// Replaying
+
+typedef struct {
+    uint64_t hash;
+    const char *key;
+    uint32_t exchange;
+    uint32_t groupLength;       // on the first entry of a group of the same key
+    uint32_t cursor;            // on the first entry of a group
+} AdTraceReplayEntry;
+
+typedef struct {
+    AdTraceReplayEntry *entries;
+    size_t count;
+} AdTraceReplayIndex;
+
+struct AdTraceReplayer {
+    const AdTrace *trace;
+    char *keys;
+    AdTraceReplayIndex exact;
+    AdTraceReplayIndex approximate;
+    AdTraceReplayStatistics statistics;
+};
+
+static int AdTraceReplayEntryCompare(const void *a, const void *b)
+{
+    const AdTraceReplayEntry *first = a, *second = b;
+    int order;
+
+    if (first->hash != second->hash) {
+        return first->hash < second->hash ? -1 : 1;
+    }
+    order = strcmp(first->key, second->key);
+    if (order != 0) {
+        return order;
+    }
+    return first->exchange < second->exchange ? -1 : first->exchange > second->exchange;
+}
+
+/** "METHOD key", written in buffer when it fits. Returns its length. */
+static size_t AdTraceRequestKey(const char *method, const char *URL, size_t length, int approximate, char *buffer, size_t capacity)
+{
+    size_t methodLength = strlen(method);
+
+    if (methodLength + 1 < capacity) {
+        memcpy(buffer, method, methodLength);
+        buffer[methodLength] = ' ';
+    }
+    return methodLength + 1 + AdTraceKey(URL, length, approximate, methodLength + 1 < capacity ? buffer + methodLength + 1 : buffer,
+                                         methodLength + 1 < capacity ? capacity - methodLength - 1 : 0);
+}
+
+static void AdTraceReplayIndexGroup(AdTraceReplayIndex *index)
+{
+    if (index->count > 1) {
+        qsort(index->entries, index->count, sizeof(*index->entries), AdTraceReplayEntryCompare);
+    }
+    for (size_t i = 0; i < index->count;) {
+        size_t j = i + 1;
+
+        while (j < index->count && index->entries[j].hash == index->entries[i].hash && strcmp(index->entries[j].key, index->entries[i].key) == 0) {
+            j++;
+        }
+        index->entries[i].groupLength = (uint32_t)(j - i);
+        i = j;
+    }
+}
+
+AdTraceReplayer *AdTraceReplayerCreate(const AdTrace *trace)
+{
+    AdTraceReplayer *replayer = calloc(1, sizeof(*replayer));
+    size_t capacity = 0, offset = 0;
+
+    if (replayer == NULL) {
+        return NULL;
+    }
+    replayer->trace = trace;
+    for (size_t i = 0; i < trace->count; i++) {
+        // A key is never longer than its URL and method, and a "/" for an empty path.
+        capacity += 2 * (strlen(trace->exchanges[i].method) + strlen(trace->exchanges[i].URL) + 3);
+    }
+    replayer->keys = malloc(capacity + 1);
+    replayer->exact.entries = calloc(trace->count + 1, sizeof(AdTraceReplayEntry));
+    replayer->approximate.entries = calloc(trace->count + 1, sizeof(AdTraceReplayEntry));
+    if (replayer->keys == NULL || replayer->exact.entries == NULL || replayer->approximate.entries == NULL) {
+        AdTraceReplayerRelease(replayer);
+        errno = ENOMEM;
+        return NULL;
+    }
+    for (size_t i = 0; i < trace->count; i++) {
+        const AdTraceExchange *exchange = &trace->exchanges[i];
+        size_t URLLength = strlen(exchange->URL);
+
+        for (int approximate = 0; approximate <= 1; approximate++) {
+            AdTraceReplayIndex *index = approximate ? &replayer->approximate : &replayer->exact;
+            AdTraceReplayEntry *entry = &index->entries[index->count++];
+            size_t length = AdTraceRequestKey(exchange->method, exchange->URL, URLLength, approximate, replayer->keys + offset, capacity + 1 - offset);
+
+            entry->key = replayer->keys + offset;
+            entry->hash = AdTraceHash(entry->key, length);
+            entry->exchange = (uint32_t)i;
+            offset += length + 1;
+        }
+    }
+    AdTraceReplayIndexGroup(&replayer->exact);
+    AdTraceReplayIndexGroup(&replayer->approximate);
+    return replayer;
+}
+
+void AdTraceReplayerRelease(AdTraceReplayer *replayer)
+{
+    if (replayer == NULL) {
+        return;
+    }
+    free(replayer->keys);
+    free(replayer->exact.entries);
+    free(replayer->approximate.entries);
+    free(replayer);
+}
+
+/** The first entry of the group of the key, NULL when there is none. */
+static AdTraceReplayEntry *AdTraceReplayIndexFind(const AdTraceReplayIndex *index, uint64_t hash, const char *key)
+{
+    size_t low = 0, high = index->count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (index->entries[middle].hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    while (low < index->count && index->entries[low].hash == hash) {
+        if (strcmp(index->entries[low].key, key) == 0) {
+            return &index->entries[low];
+        }
+        low += index->entries[low].groupLength;
+    }
+    return NULL;
+}
+
+const AdTraceExchange *AdTraceReplayerNext(AdTraceReplayer *replayer, const char *method, const char *URL, size_t length)
+{
+    char buffer[kAdTraceKeyLength], *key = buffer;
+    AdTraceReplayEntry *group = NULL;
+    uint32_t exchange;
+
+    for (int approximate = 0; approximate <= 1 && group == NULL; approximate++) {
+        size_t keyLength = AdTraceRequestKey(method, URL, length, approximate, buffer, sizeof(buffer));
+
+        if (keyLength >= sizeof(buffer)) {
+            key = malloc(keyLength + 1);
+            if (key == NULL) {
+                return NULL;
+            }
+            AdTraceRequestKey(method, URL, length, approximate, key, keyLength + 1);
+        }
+        group = AdTraceReplayIndexFind(approximate ? &replayer->approximate : &replayer->exact, AdTraceHash(key, keyLength), key);
+        if (key != buffer) {
+            free(key);
+            key = buffer;
+        }
+        if (group) {
+            approximate ? replayer->statistics.approximate++ : replayer->statistics.exact++;
+        }
+    }
+    if (group == NULL) {
+        replayer->statistics.missed++;
+        return NULL;
+    }
+    exchange = group[group->cursor].exchange;
+    group->cursor = (group->cursor + 1) % group->groupLength;
+    return &replayer->trace->exchanges[exchange];
+}
+
+void AdTraceReplayerReset(AdTraceReplayer *replayer)
+{
+    for (size_t i = 0; i < replayer->exact.count; i++) {
+        replayer->exact.entries[i].cursor = 0;
+    }
+    for (size_t i = 0; i < replayer->approximate.count; i++) {
+        replayer->approximate.entries[i].cursor = 0;
+    }
+    memset(&replayer->statistics, 0, sizeof(replayer->statistics));
+}
+
+AdTraceReplayStatistics AdTraceReplayerGetStatistics(const AdTraceReplayer *replayer)
+{
+    return replayer->statistics;
+}
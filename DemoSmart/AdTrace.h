@@ -0,0 +1,144 @@
+//
+//  AdTrace.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Traces of the ad traffic: the ad calls, creative downloads and pixel hits of a run of the app, with their timings, to replay them without the ad server.
+
+ A trace is written by the app while it talks to the real servers (see AdTraceURLProtocol) and
+ read back by the app, to replay the same ads offline, or by tools/adreplay, which serves it over
+ HTTP to tools/adload. Each exchange keeps what is needed to answer the request again: the status,
+ the Content-Type and Location, the body, when the request started and how long the first byte
+ and the whole body took.
+
+ The file is compact, an interstitial session takes a few hundred bytes once its creative has
+ been seen: the numbers are varints, each URL is stored as the length it shares with the previous
+ URL and the rest, and a body already in the trace is stored as its number. Each record starts
+ with its length, a trace cut short by a crash is read up to its last whole record.
+
+    header      magic "ADTR", version, recording start (microseconds since 1970), 16 bytes
+    records     { length, kind, start delta, first byte, duration, status, method, URL prefix
+                  and suffix, Content-Type, Location, body or number of a previous body }...
+
+ A session is an ad call and the exchanges that follow it until the next one: the creative it
+ returned, the pixels it fired. Exchanges before the first ad call make a session of their own.
+
+ Replaying matches a request with the recorded exchanges of the same method and URL, ignoring
+ the parameters that change at every call (kAdTraceVolatileParameters: the timestamp, the
+ location, the cache busters of the pixels). Exchanges with the same URL are answered in the
+ order they were recorded, starting over after the last. A request that matches none is answered
+ with an exchange of the same host and path, counted as approximate.
+
+ This file is plain C. A writer and a replayer are not thread safe, callers serialize access; an
+ open trace is read only and may be used from any thread.
+ */
+
+#ifndef DemoSmart_AdTrace_h
+#define DemoSmart_AdTrace_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define kAdTraceVersion     1
+
+typedef enum {
+    AdTraceKindAdCall,
+    AdTraceKindCreative,
+    AdTraceKindPixel,
+    AdTraceKindCount
+} AdTraceKind;
+
+typedef struct {
+    AdTraceKind kind;
+    uint16_t status;            /* 0 when the request failed without a response */
+    uint64_t start;             /* microseconds since the start of the recording */
+    uint32_t firstByte;         /* microseconds from the request to the response */
+    uint32_t duration;          /* microseconds from the request to the end of the body */
+    const char *method;
+    const char *URL;
+    const char *contentType;    /* "" when there is none */
+    const char *location;       /* the target of a redirection, "" when there is none */
+    const void *body;
+    size_t bodyLength;
+} AdTraceExchange;
+
+/** The query parameters left out when matching URLs, NULL terminated. */
+extern const char *const kAdTraceVolatileParameters[];
+
+/** The kind of an exchange from its URL and response: an ad call when the path is /ac, a pixel when the body is empty or a tiny image, else a creative. */
+AdTraceKind AdTraceClassify(const char *URL, uint16_t status, const char *contentType, size_t bodyLength);
+
+/** The URL as matched by the replay: host in lowercase and path, the query without its volatile parameters, no scheme nor fragment.
+
+ Returns the length of the key, written with a NUL in buffer when it fits in capacity.
+ */
+size_t AdTraceNormalizeURL(const char *URL, size_t length, char *buffer, size_t capacity);
+
+const char *AdTraceKindName(AdTraceKind kind);
+
+// Writing
+
+typedef struct AdTraceWriter AdTraceWriter;
+
+/** Creates the trace file, replacing an existing one. Returns NULL with errno set. */
+AdTraceWriter *AdTraceWriterCreate(const char *path);
+
+/** Appends an exchange. Its start must not be before the previous one's. Returns 0, or -1 with errno set. */
+int AdTraceWriterAppend(AdTraceWriter *writer, const AdTraceExchange *exchange);
+
+/** Writes the buffered records to the file. Returns 0, or -1 with errno set. */
+int AdTraceWriterFlush(AdTraceWriter *writer);
+
+/** Flushes and closes the file. Returns 0, or -1 with errno set when the last records could not be written. */
+int AdTraceWriterClose(AdTraceWriter *writer);
+
+// Reading
+
+typedef struct AdTrace AdTrace;
+
+/** Maps a trace. Returns NULL with errno set, EINVAL when the file is not a trace or a record is damaged. */
+AdTrace *AdTraceOpen(const char *path);
+
+void AdTraceClose(AdTrace *trace);
+
+/** The time the recording started, in microseconds since 1970. */
+uint64_t AdTraceGetStartTime(const AdTrace *trace);
+
+size_t AdTraceGetCount(const AdTrace *trace);
+
+/** The exchange at the index, in the order of the recording. The strings and the body are valid as long as the trace. */
+const AdTraceExchange *AdTraceGetExchange(const AdTrace *trace, size_t index);
+
+size_t AdTraceGetSessionCount(const AdTrace *trace);
+
+/** The index of the first exchange of the session, and in count the number of its exchanges. */
+size_t AdTraceGetSession(const AdTrace *trace, size_t session, size_t *count);
+
+// Replaying
+
+typedef struct {
+    uint64_t exact;
+    uint64_t approximate;       /* answered with an exchange of the same host and path */
+    uint64_t missed;
+} AdTraceReplayStatistics;
+
+typedef struct AdTraceReplayer AdTraceReplayer;
+
+/** Returns NULL with errno set. The trace must stay open as long as the replayer. */
+AdTraceReplayer *AdTraceReplayerCreate(const AdTrace *trace);
+
+void AdTraceReplayerRelease(AdTraceReplayer *replayer);
+
+/** The recorded exchange that answers the request, NULL when there is none. */
+const AdTraceExchange *AdTraceReplayerNext(AdTraceReplayer *replayer, const char *method, const char *URL, size_t length);
+
+/** Starts every URL over from its first exchange, and clears the statistics. */
+void AdTraceReplayerReset(AdTraceReplayer *replayer);
+
+AdTraceReplayStatistics AdTraceReplayerGetStatistics(const AdTraceReplayer *replayer);
+
+#endif
@@ -0,0 +1,66 @@
+//
+//  AdTraceURLProtocol.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "AdTrace.h"
+
+/**
+ Records the HTTP traffic of the app into an AdTrace, or answers it from one, to reproduce the ads without the ad server.
+
+ Registered as an NSURLProtocol, it sees the requests of the SDK and of the creatives' web views
+ as well as the app's own. When recording, each request is sent to the network and its exchange
+ appended to the trace once it ends: the response is not stored in the URL cache, so that every
+ request of the run reaches the trace. Redirections are recorded as exchanges of their own.
+
+ When replaying, nothing goes to the network: each request is answered with the recorded
+ exchange of the same method and URL (see AdTrace.h), after the recorded time to first byte and
+ duration multiplied by the time scale. A request the trace cannot answer fails as offline.
+
+ Launch the app with -AdTraceRecord path or -AdTraceReplay path (relative to Library/Caches) and
+ -AdTraceTimeScale x, or serve the trace to many clients with tools/adreplay.
+ */
+
+@interface AdTraceURLProtocol : NSURLProtocol
+
+/** Starts recording into the trace at path, replacing it, and stops a replay.
+
+ @return NO when the trace cannot be created.
+
+ */
+
++ (BOOL)startRecordingToPath:(NSString *)path;
+
+/** Starts answering the requests from the trace at path, and stops a recording.
+
+ @param timeScale Multiplies the recorded timings: 1 replays the recorded network, 0 answers at once.
+ @return NO when the trace cannot be read.
+
+ */
+
++ (BOOL)startReplayingFromPath:(NSString *)path timeScale:(double)timeScale;
+
+/** Writes the exchanges recorded so far to the trace.
+
+ */
+
++ (void)flush;
+
+/** Stops recording or replaying, the requests go to the network again.
+
+ */
+
++ (void)stop;
+
+/** The matches of the replay since it started.
+
+ */
+
++ (AdTraceReplayStatistics)replayStatistics;
+
+@end
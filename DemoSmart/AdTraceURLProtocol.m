@@ -0,0 +1,446 @@
+//
+//  AdTraceURLProtocol.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdTraceURLProtocol.h"
+
+#include <errno.h>
+#include <string.h>
+
+static NSString *const kAdTraceHandledKey = @"AdTraceURLProtocolHandled";
+
+typedef enum {
+    AdTraceModeOff,
+    AdTraceModeRecording,
+    AdTraceModeReplaying
+} AdTraceMode;
+
+/** An ended exchange of the recording, waiting for the ones that started before it. */
+@interface AdTraceRecordedExchange : NSObject
+
+@property (nonatomic, assign) uint64_t start;
+@property (nonatomic, assign) uint32_t firstByte;
+@property (nonatomic, assign) uint32_t duration;
+@property (nonatomic, assign) uint16_t status;
+@property (nonatomic, copy) NSString *method;
+@property (nonatomic, copy) NSString *URL;
+@property (nonatomic, copy) NSString *contentType;
+@property (nonatomic, copy) NSString *location;
+@property (nonatomic, strong) NSData *body;
+
+@end
+
+@implementation AdTraceRecordedExchange
+
+@end
+
+// The state of the recording and of the replay, on AdTraceQueue() but for the mode, which
+// canInitWithRequest: reads as is.
+static AdTraceMode AdTraceCurrentMode;
+static AdTraceWriter *AdTraceCurrentWriter;
+static NSUInteger AdTraceRecordingNumber;      // tells the exchanges of a recording from the next one's
+static NSTimeInterval AdTraceRecordingStart;   // system uptime
+static uint64_t AdTraceNextSequence;           // the number of the next exchange to start
+static uint64_t AdTraceNextAppended;           // the number of the first exchange not appended
+static uint64_t AdTraceLastStart;
+static NSMutableDictionary *AdTraceEnded;      // sequence -> AdTraceRecordedExchange, or NSNull when cancelled
+static AdTrace *AdTraceCurrentTrace;
+static AdTraceReplayer *AdTraceCurrentReplayer;
+static double AdTraceTimeScale = 1;
+
+static dispatch_queue_t AdTraceQueue(void)
+{
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.mobvalue.DemoSmart.AdTrace", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+static uint32_t AdTraceMicroseconds(NSTimeInterval interval)
+{
+    return interval <= 0 ? 0 : interval >= UINT32_MAX / 1e6 ? UINT32_MAX : (uint32_t)(interval * 1e6);
+}
+
+static void AdTraceAppend(AdTraceRecordedExchange *recorded)
+{
+    const char *URL = [recorded.URL UTF8String], *contentType = [recorded.contentType UTF8String] ?: "";
+    AdTraceExchange exchange;
+
+    exchange.kind = AdTraceClassify(URL, recorded.status, contentType, [recorded.body length]);
+    exchange.status = recorded.status;
+    exchange.start = MAX(recorded.start, AdTraceLastStart);     // a straggler of a flush, see AdTraceAppendEnded
+    exchange.firstByte = recorded.firstByte;
+    exchange.duration = recorded.duration;
+    exchange.method = [recorded.method UTF8String];
+    exchange.URL = URL;
+    exchange.contentType = contentType;
+    exchange.location = [recorded.location UTF8String] ?: "";
+    exchange.body = [recorded.body bytes];
+    exchange.bodyLength = [recorded.body length];
+    if (AdTraceWriterAppend(AdTraceCurrentWriter, &exchange) != 0) {
+        NSLog(@"AdTraceURLProtocol: cannot record %@: %s", recorded.URL, strerror(errno));
+        return;
+    }
+    AdTraceLastStart = exchange.start;
+}
+
+/** Appends the ended exchanges in the order they started. With force, the ones still running are
+ not waited for, and are appended when they end as if they had started then. */
+static void AdTraceAppendEnded(BOOL force)
+{
+    for (; AdTraceNextAppended < AdTraceNextSequence; AdTraceNextAppended++) {
+        NSNumber *key = @(AdTraceNextAppended);
+        id recorded = AdTraceEnded[key];
+
+        if (recorded == nil && !force) {
+            break;
+        }
+        if ([recorded isKindOfClass:[AdTraceRecordedExchange class]]) {
+            AdTraceAppend(recorded);
+        }
+        [AdTraceEnded removeObjectForKey:key];
+    }
+}
+
+/** Ends an exchange of the recording, nil when it was cancelled. */
+static void AdTraceEndExchange(NSUInteger recording, uint64_t sequence, AdTraceRecordedExchange *recorded)
+{
+    dispatch_async(AdTraceQueue(), ^{
+        if (recording != AdTraceRecordingNumber || AdTraceCurrentWriter == NULL) {
+            return;
+        }
+        if (sequence < AdTraceNextAppended) {
+            if (recorded) {
+                AdTraceAppend(recorded);
+            }
+            return;
+        }
+        AdTraceEnded[@(sequence)] = recorded ?: [NSNull null];
+        AdTraceAppendEnded(NO);
+    });
+}
+
+static void AdTraceStop(void)
+{
+    AdTraceCurrentMode = AdTraceModeOff;
+    if (AdTraceCurrentWriter) {
+        AdTraceAppendEnded(YES);
+        if (AdTraceWriterClose(AdTraceCurrentWriter) != 0) {
+            NSLog(@"AdTraceURLProtocol: cannot write the trace: %s", strerror(errno));
+        }
+        AdTraceCurrentWriter = NULL;
+        AdTraceEnded = nil;
+    }
+    AdTraceReplayerRelease(AdTraceCurrentReplayer);
+    AdTraceCurrentReplayer = NULL;
+    AdTraceClose(AdTraceCurrentTrace);
+    AdTraceCurrentTrace = NULL;
+}
+
+@interface AdTraceURLProtocol () <NSURLConnectionDataDelegate>
+
+@end
+
+@implementation AdTraceURLProtocol
+{
+    // Recording
+    NSURLConnection *_connection;
+    NSUInteger _recording;              // 0 when the request is not recorded
+    uint64_t _sequence;
+    NSTimeInterval _startTime;
+    NSTimeInterval _firstByteTime;
+    NSHTTPURLResponse *_response;
+    NSMutableData *_body;
+    BOOL _ended;
+    // Replay, copied from the trace, which may be closed before the timers fire
+    NSTimer *_timer;
+    NSHTTPURLResponse *_replayResponse; // nil when the trace has no answer
+    NSData *_replayBody;
+    NSURL *_redirectURL;
+    NSTimeInterval _firstByteDelay;
+    NSTimeInterval _bodyDelay;
+}
+
++ (void)initialize
+{
+    if (self == [AdTraceURLProtocol class]) {
+        [NSURLProtocol registerClass:self];
+    }
+}
+
++ (BOOL)startRecordingToPath:(NSString *)path
+{
+    __block BOOL started = NO;
+
+    dispatch_sync(AdTraceQueue(), ^{
+        AdTraceStop();
+        AdTraceCurrentWriter = AdTraceWriterCreate([path fileSystemRepresentation]);
+        if (AdTraceCurrentWriter == NULL) {
+            NSLog(@"AdTraceURLProtocol: cannot create %@: %s", path, strerror(errno));
+            return;
+        }
+        AdTraceRecordingNumber++;
+        AdTraceRecordingStart = [[NSProcessInfo processInfo] systemUptime];
+        AdTraceNextSequence = AdTraceNextAppended = AdTraceLastStart = 0;
+        AdTraceEnded = [NSMutableDictionary dictionary];
+        AdTraceCurrentMode = AdTraceModeRecording;
+        started = YES;
+    });
+    return started;
+}
+
++ (BOOL)startReplayingFromPath:(NSString *)path timeScale:(double)timeScale
+{
+    __block BOOL started = NO;
+
+    dispatch_sync(AdTraceQueue(), ^{
+        AdTraceStop();
+        AdTraceCurrentTrace = AdTraceOpen([path fileSystemRepresentation]);
+        AdTraceCurrentReplayer = AdTraceCurrentTrace ? AdTraceReplayerCreate(AdTraceCurrentTrace) : NULL;
+        if (AdTraceCurrentReplayer == NULL) {
+            NSLog(@"AdTraceURLProtocol: cannot replay %@: %s", path, strerror(errno));
+            AdTraceStop();
+            return;
+        }
+        AdTraceTimeScale = MAX(0, timeScale);
+        AdTraceCurrentMode = AdTraceModeReplaying;
+        started = YES;
+    });
+    return started;
+}
+
++ (void)flush
+{
+    dispatch_sync(AdTraceQueue(), ^{
+        if (AdTraceCurrentWriter) {
+            AdTraceAppendEnded(YES);
+            if (AdTraceWriterFlush(AdTraceCurrentWriter) != 0) {
+                NSLog(@"AdTraceURLProtocol: cannot write the trace: %s", strerror(errno));
+            }
+        }
+    });
+}
+
++ (void)stop
+{
+    dispatch_sync(AdTraceQueue(), ^{
+        AdTraceStop();
+    });
+}
+
++ (AdTraceReplayStatistics)replayStatistics
+{
+    __block AdTraceReplayStatistics statistics = { 0, 0, 0 };
+
+    dispatch_sync(AdTraceQueue(), ^{
+        if (AdTraceCurrentReplayer) {
+            statistics = AdTraceReplayerGetStatistics(AdTraceCurrentReplayer);
+        }
+    });
+    return statistics;
+}
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request
+{
+    NSString *scheme = [[[request URL] scheme] lowercaseString];
+
+    return AdTraceCurrentMode != AdTraceModeOff && ([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"])
+        && [NSURLProtocol propertyForKey:kAdTraceHandledKey inRequest:request] == nil;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
+- (void)startLoading
+{
+    __block AdTraceMode mode;
+
+    dispatch_sync(AdTraceQueue(), ^{
+        mode = AdTraceCurrentMode;
+        if (mode == AdTraceModeRecording) {
+            _recording = AdTraceRecordingNumber;
+            _sequence = AdTraceNextSequence++;
+            _startTime = [[NSProcessInfo processInfo] systemUptime];
+        } else if (mode == AdTraceModeReplaying) {
+            [self findReplayedExchange];
+        }
+    });
+    if (mode == AdTraceModeReplaying) {
+        _timer = [NSTimer timerWithTimeInterval:_firstByteDelay target:self selector:@selector(replayResponse) userInfo:nil repeats:NO];
+        [[NSRunLoop currentRunLoop] addTimer:_timer forMode:NSRunLoopCommonModes];
+    } else {
+        // Stopped since canInitWithRequest: the request goes to the network without being recorded.
+        NSMutableURLRequest *request = [self.request mutableCopy];
+
+        [NSURLProtocol setProperty:@YES forKey:kAdTraceHandledKey inRequest:request];
+        _connection = [NSURLConnection connectionWithRequest:request delegate:self];
+    }
+}
+
+- (void)stopLoading
+{
+    [_connection cancel];
+    _connection = nil;
+    [_timer invalidate];
+    _timer = nil;
+    if (_recording && !_ended) {
+        _ended = YES;
+        AdTraceEndExchange(_recording, _sequence, nil);
+    }
+}
+
+#pragma mark - Recording
+
+- (void)recordExchange
+{
+    NSTimeInterval now = [[NSProcessInfo processInfo] systemUptime];
+    AdTraceRecordedExchange *recorded;
+    NSDictionary *headers = [_response allHeaderFields];
+
+    if (_recording == 0 || _ended) {
+        return;
+    }
+    _ended = YES;
+    recorded = [[AdTraceRecordedExchange alloc] init];
+    recorded.start = (uint64_t)MAX(0, (_startTime - AdTraceRecordingStart) * 1e6);
+    recorded.firstByte = AdTraceMicroseconds(_response ? _firstByteTime - _startTime : now - _startTime);
+    recorded.duration = AdTraceMicroseconds(now - _startTime);
+    recorded.status = (uint16_t)[_response statusCode];
+    recorded.method = [self.request HTTPMethod] ?: @"GET";
+    recorded.URL = [[self.request URL] absoluteString];
+    recorded.contentType = headers[@"Content-Type"];
+    recorded.location = headers[@"Location"];
+    recorded.body = _body;
+    AdTraceEndExchange(_recording, _sequence, recorded);
+}
+
+- (NSURLRequest *)connection:(NSURLConnection *)connection willSendRequest:(NSURLRequest *)request redirectResponse:(NSURLResponse *)redirectResponse
+{
+    NSMutableURLRequest *redirect;
+
+    if (redirectResponse == nil) {
+        return request;
+    }
+    // The redirection is an exchange of its own: the client sends the new request, which comes through the protocol again.
+    _firstByteTime = [[NSProcessInfo processInfo] systemUptime];
+    _response = [redirectResponse isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)redirectResponse : nil;
+    [self recordExchange];
+    redirect = [request mutableCopy];
+    [NSURLProtocol removePropertyForKey:kAdTraceHandledKey inRequest:redirect];
+    [self.client URLProtocol:self wasRedirectedToRequest:redirect redirectResponse:redirectResponse];
+    [connection cancel];
+    _connection = nil;
+    [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil]];
+    return nil;
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSURLResponse *)response
+{
+    _firstByteTime = [[NSProcessInfo processInfo] systemUptime];
+    _response = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+    _body = [NSMutableData data];
+    // Not cached, so that the same request is recorded again.
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+}
+
+- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data
+{
+    [_body appendData:data];
+    [self.client URLProtocol:self didLoadData:data];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)connection
+{
+    _connection = nil;
+    [self recordExchange];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error
+{
+    _connection = nil;
+    _response = nil;        // recorded as a failure, whatever arrived
+    _body = nil;
+    [self recordExchange];
+    [self.client URLProtocol:self didFailWithError:error];
+}
+
+#pragma mark - Replay
+
+/** Copies the exchange that answers the request. On AdTraceQueue(). */
+- (void)findReplayedExchange
+{
+    NSURL *URL = [self.request URL];
+    const char *string = [[URL absoluteString] UTF8String];
+    const AdTraceExchange *exchange = AdTraceReplayerNext(AdTraceCurrentReplayer, [[self.request HTTPMethod] ?: @"GET" UTF8String], string, strlen(string));
+    NSMutableDictionary *headers = [NSMutableDictionary dictionary];
+
+    if (exchange == NULL) {
+        return;
+    }
+    if (exchange->contentType[0]) {
+        headers[@"Content-Type"] = @(exchange->contentType);
+    }
+    if (exchange->location[0]) {
+        headers[@"Location"] = @(exchange->location);
+        if (exchange->status >= 300 && exchange->status < 400) {
+            _redirectURL = [NSURL URLWithString:@(exchange->location) relativeToURL:URL];
+        }
+    }
+    headers[@"Content-Length"] = [NSString stringWithFormat:@"%lu", (unsigned long)exchange->bodyLength];
+    _replayResponse = [[NSHTTPURLResponse alloc] initWithURL:URL statusCode:exchange->status HTTPVersion:@"HTTP/1.1" headerFields:headers];
+    _replayBody = [NSData dataWithBytes:exchange->body length:exchange->bodyLength];
+    _firstByteDelay = (exchange->status ? exchange->firstByte : exchange->duration) * AdTraceTimeScale / 1e6;
+    _bodyDelay = exchange->duration > exchange->firstByte ? (exchange->duration - exchange->firstByte) * AdTraceTimeScale / 1e6 : 0;
+}
+
+- (void)replayResponse
+{
+    _timer = nil;
+    if (_replayResponse == nil) {
+        [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil]];
+        return;
+    }
+    if ([_replayResponse statusCode] == 0) {
+        [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil]];
+        return;
+    }
+    if (_redirectURL) {
+        NSMutableURLRequest *redirect = [self.request mutableCopy];
+
+        [redirect setURL:_redirectURL];
+        if ([_replayResponse statusCode] == 303) {
+            [redirect setHTTPMethod:@"GET"];
+            [redirect setHTTPBody:nil];
+        }
+        [self.client URLProtocol:self wasRedirectedToRequest:redirect redirectResponse:_replayResponse];
+        [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil]];
+        return;
+    }
+    [self.client URLProtocol:self didReceiveResponse:_replayResponse cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    if (_bodyDelay > 0 && [_replayBody length] > 0) {
+        _timer = [NSTimer timerWithTimeInterval:_bodyDelay target:self selector:@selector(replayBody) userInfo:nil repeats:NO];
+        [[NSRunLoop currentRunLoop] addTimer:_timer forMode:NSRunLoopCommonModes];
+    } else {
+        [self replayBody];
+    }
+}
+
+- (void)replayBody
+{
+    _timer = nil;
+    if ([_replayBody length] > 0) {
+        [self.client URLProtocol:self didLoadData:_replayBody];
+    }
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+@end
@@ -0,0 +1,101 @@
+//
+//  AdTrackingDispatcher.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SmartAdServerAd.h"
+
+typedef enum {
+    AdTrackingBeaconImpression,
+    AdTrackingBeaconClick
+} AdTrackingBeaconKind;
+
+/**
+ Delivers impression and click beacons of SmartAdServerAd objects in batches.
+
+ Beacons are written ahead to a journal file before being sent, so a crash or a kill of the app
+ does not lose them: pending beacons are sent again on the next launch (at-least-once delivery).
+ A beacon is identified by its insertionId, kind and URL, and is accepted only once.
+
+ Pending beacons are sent together when a batch is full or when the flush interval elapses, on
+ pipelined keep-alive requests so that beacons to the same host share one connection and one
+ radio wake-up. Failed beacons are retried with exponential backoff.
+
+ Use it for beacons the app fires itself, for example for ads displayed with displayThisAd:.
+ The SDK keeps firing the pixels of the ads it loads on its own.
+ */
+
+@interface AdTrackingDispatcher : NSObject
+
+/** The dispatcher journaling in Library/Caches/AdTracking.journal.
+
+ */
+
++ (AdTrackingDispatcher *)sharedDispatcher;
+
+/** Creates a dispatcher and replays the beacons left pending in the journal.
+
+ */
+
+- (id)initWithJournalPath:(NSString *)path;
+
+/** Number of pending beacons which triggers a flush, 8 by default.
+
+ */
+
+@property (nonatomic, assign) NSUInteger batchSize;
+
+/** The longest time a beacon waits for its batch, 10 seconds by default.
+
+ */
+
+@property (nonatomic, assign) NSTimeInterval flushInterval;
+
+/** Number of attempts after which a beacon is dropped, 8 by default.
+
+ */
+
+@property (nonatomic, assign) NSUInteger maxAttempts;
+
+/** The maximum number of requests in flight, 4 by default.
+
+ */
+
+@property (nonatomic, assign) NSUInteger maxConcurrentRequests;
+
+/** Queues impPixel (or impLandscapePixel) and the matching agency pixels of the ad.
+
+ */
+
+- (void)trackImpressionForAd:(SmartAdServerAd *)ad landscape:(BOOL)landscape;
+
+/** Queues countURL (or countLandscapeURL) of the ad.
+
+ */
+
+- (void)trackClickForAd:(SmartAdServerAd *)ad landscape:(BOOL)landscape;
+
+/** Queues a beacon.
+
+ @return NO if the same beacon was already queued or delivered, or if it could not be journaled.
+
+ */
+
+- (BOOL)enqueueURLs:(NSArray *)URLs insertionId:(NSInteger)insertionId kind:(AdTrackingBeaconKind)kind;
+
+/** Sends every pending beacon whose backoff has elapsed, without waiting for the batch to fill.
+
+ */
+
+- (void)flush;
+
+- (NSUInteger)pendingCount;
+
+- (NSUInteger)deliveredCount;
+
+@end
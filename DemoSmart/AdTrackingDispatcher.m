@@ -0,0 +1,409 @@
+//
+//  AdTrackingDispatcher.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdTrackingDispatcher.h"
+#import "AdLog.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static const NSTimeInterval kAdTrackingInitialBackoff = 2;
+static const NSTimeInterval kAdTrackingMaxBackoff = 600;
+static const NSTimeInterval kAdTrackingRequestTimeout = 20;
+static const NSUInteger kAdTrackingCompactionThreshold = 512;
+static const NSUInteger kAdTrackingRememberedKeys = 1000;
+
+@interface AdTrackingBeacon : NSObject
+
+@property (nonatomic, assign) unsigned long long sequence;
+@property (nonatomic, assign) NSInteger insertionId;
+@property (nonatomic, assign) AdTrackingBeaconKind kind;
+@property (nonatomic, strong) NSURL *URL;
+@property (nonatomic, assign) NSUInteger attempts;
+@property (nonatomic, assign) CFAbsoluteTime notBefore;
+@property (nonatomic, assign) BOOL inFlight;
+
+- (NSString *)key;
+
+@end
+
+@implementation AdTrackingBeacon
+
+- (NSString *)key
+{
+    return [NSString stringWithFormat:@"%ld %d %@", (long)self.insertionId, self.kind, [self.URL absoluteString]];
+}
+
+@end
+
+@implementation AdTrackingDispatcher
+{
+    NSString *_journalPath;
+    NSFileHandle *_journal;
+    NSUInteger _journalLines;
+    dispatch_queue_t _queue;
+    dispatch_source_t _timer;
+    CFAbsoluteTime _fireDate;
+    NSOperationQueue *_requestQueue;
+
+    unsigned long long _nextSequence;
+    NSMutableArray *_pending;
+    NSMutableSet *_keys;
+    NSMutableArray *_deliveredKeys;
+    NSUInteger _deliveredCount;
+}
+
++ (AdTrackingDispatcher *)sharedDispatcher
+{
+    static AdTrackingDispatcher *sharedDispatcher = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+        sharedDispatcher = [[AdTrackingDispatcher alloc] initWithJournalPath:[caches stringByAppendingPathComponent:@"AdTracking.journal"]];
+    });
+    return sharedDispatcher;
+}
+
+- (id)initWithJournalPath:(NSString *)path
+{
+    self = [super init];
+    if (self) {
+        _journalPath = [path copy];
+        _queue = dispatch_queue_create("com.mobvalue.DemoSmart.AdTrackingDispatcher", DISPATCH_QUEUE_SERIAL);
+        _requestQueue = [[NSOperationQueue alloc] init];
+        _pending = [NSMutableArray array];
+        _keys = [NSMutableSet set];
+        _deliveredKeys = [NSMutableArray array];
+        _nextSequence = 1;
+
+        self.batchSize = 8;
+        self.flushInterval = 10;
+        self.maxAttempts = 8;
+        self.maxConcurrentRequests = 4;
+
+        [self replayJournal];
+        if (![self compactJournal]) {
+            return nil;
+        }
+        if ([_pending count] > 0) {
+            [self scheduleFlushAfter:0];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+    [_journal closeFile];
+}
+
+- (void)setMaxConcurrentRequests:(NSUInteger)maxConcurrentRequests
+{
+    _maxConcurrentRequests = maxConcurrentRequests;
+    _requestQueue.maxConcurrentOperationCount = maxConcurrentRequests;
+}
+
+#pragma mark - Journal
+
+- (void)replayJournal
+{
+    NSString *contents = [NSString stringWithContentsOfFile:_journalPath encoding:NSUTF8StringEncoding error:NULL];
+    NSArray *lines = [contents componentsSeparatedByString:@"\n"];
+    NSMutableDictionary *enqueued = [NSMutableDictionary dictionary];
+
+    // The last line is empty, or torn by a crash while it was appended.
+    for (NSUInteger i = 0; i + 1 < [lines count]; i++) {
+        NSArray *fields = [lines[i] componentsSeparatedByString:@"\t"];
+        NSString *type = [fields count] > 0 ? fields[0] : nil;
+
+        if ([type isEqualToString:@"E"] && [fields count] == 5) {
+            AdTrackingBeacon *beacon = [[AdTrackingBeacon alloc] init];
+            beacon.sequence = strtoull([fields[1] UTF8String], NULL, 10);
+            beacon.insertionId = [fields[2] integerValue];
+            beacon.kind = [fields[3] intValue];
+            beacon.URL = [NSURL URLWithString:fields[4]];
+            if (beacon.URL) {
+                enqueued[@(beacon.sequence)] = beacon;
+                [_keys addObject:[beacon key]];
+            }
+            _nextSequence = MAX(_nextSequence, beacon.sequence + 1);
+        } else if ([type isEqualToString:@"D"] && [fields count] == 2) {
+            AdTrackingBeacon *beacon = enqueued[@(strtoull([fields[1] UTF8String], NULL, 10))];
+            if (beacon) {
+                [self rememberDeliveredKey:[beacon key]];
+                [enqueued removeObjectForKey:@(beacon.sequence)];
+            }
+        } else if ([type isEqualToString:@"K"] && [fields count] == 2) {
+            [self rememberDeliveredKey:fields[1]];
+        }
+    }
+    [_pending addObjectsFromArray:[[enqueued allValues] sortedArrayUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"sequence" ascending:YES]]]];
+}
+
+- (void)rememberDeliveredKey:(NSString *)key
+{
+    [_keys addObject:key];
+    [_deliveredKeys addObject:key];
+    if ([_deliveredKeys count] > kAdTrackingRememberedKeys) {
+        [_keys removeObject:_deliveredKeys[0]];
+        [_deliveredKeys removeObjectAtIndex:0];
+    }
+}
+
+/** Rewrites the journal with the pending beacons and the keys remembered for deduplication only. */
+- (BOOL)compactJournal
+{
+    NSMutableString *contents = [NSMutableString string];
+    NSString *temporaryPath = [_journalPath stringByAppendingPathExtension:@"tmp"];
+
+    for (NSString *key in _deliveredKeys) {
+        [contents appendFormat:@"K\t%@\n", key];
+    }
+    for (AdTrackingBeacon *beacon in _pending) {
+        [contents appendString:[self journalLineForBeacon:beacon]];
+    }
+
+    [_journal closeFile];
+    _journal = nil;
+    if (![contents writeToFile:temporaryPath atomically:NO encoding:NSUTF8StringEncoding error:NULL]
+        || rename([temporaryPath fileSystemRepresentation], [_journalPath fileSystemRepresentation]) != 0) {
+        NSLog(@"AdTrackingDispatcher: cannot write %@", _journalPath);
+        return NO;
+    }
+    _journal = [NSFileHandle fileHandleForWritingAtPath:_journalPath];
+    [_journal seekToEndOfFile];
+    _journalLines = [_deliveredKeys count] + [_pending count];
+    return _journal != nil;
+}
+
+- (NSString *)journalLineForBeacon:(AdTrackingBeacon *)beacon
+{
+    return [NSString stringWithFormat:@"E\t%llu\t%ld\t%d\t%@\n", beacon.sequence, (long)beacon.insertionId, beacon.kind, [beacon.URL absoluteString]];
+}
+
+- (void)appendToJournal:(NSString *)lines count:(NSUInteger)count synchronize:(BOOL)synchronize
+{
+    [_journal writeData:[lines dataUsingEncoding:NSUTF8StringEncoding]];
+    if (synchronize) {
+        [_journal synchronizeFile];
+    }
+    _journalLines += count;
+}
+
+#pragma mark - Queueing
+
+- (void)trackImpressionForAd:(SmartAdServerAd *)ad landscape:(BOOL)landscape
+{
+    NSMutableArray *URLs = [NSMutableArray array];
+    NSURL *pixel = landscape && ad.impLandscapePixel ? ad.impLandscapePixel : ad.impPixel;
+    NSArray *agencyPixels = landscape && [ad.agencyLandscapePixels count] ? ad.agencyLandscapePixels : ad.agencyPortraitPixels;
+
+    if (pixel) {
+        [URLs addObject:pixel];
+    }
+    for (id agencyPixel in agencyPixels) {
+        NSURL *URL = [agencyPixel isKindOfClass:[NSURL class]] ? agencyPixel : [NSURL URLWithString:[agencyPixel description]];
+        if (URL) {
+            [URLs addObject:URL];
+        }
+    }
+    [self enqueueURLs:URLs insertionId:ad.insertionId kind:AdTrackingBeaconImpression];
+}
+
+- (void)trackClickForAd:(SmartAdServerAd *)ad landscape:(BOOL)landscape
+{
+    NSURL *countURL = landscape && ad.countLandscapeURL ? ad.countLandscapeURL : ad.countURL;
+
+    if (countURL) {
+        [self enqueueURLs:@[countURL] insertionId:ad.insertionId kind:AdTrackingBeaconClick];
+    }
+}
+
+- (BOOL)enqueueURLs:(NSArray *)URLs insertionId:(NSInteger)insertionId kind:(AdTrackingBeaconKind)kind
+{
+    __block BOOL accepted = NO;
+
+    dispatch_sync(_queue, ^{
+        NSMutableArray *beacons = [NSMutableArray arrayWithCapacity:[URLs count]];
+        NSMutableString *lines = [NSMutableString string];
+
+        for (NSURL *URL in URLs) {
+            AdTrackingBeacon *beacon = [[AdTrackingBeacon alloc] init];
+            beacon.insertionId = insertionId;
+            beacon.kind = kind;
+            beacon.URL = URL;
+            if ([_keys containsObject:[beacon key]]) {
+                continue;
+            }
+            beacon.sequence = _nextSequence++;
+            [_keys addObject:[beacon key]];
+            [beacons addObject:beacon];
+            [lines appendString:[self journalLineForBeacon:beacon]];
+        }
+        if ([beacons count] == 0 || _journal == nil) {
+            return;
+        }
+
+        // Write ahead: the beacons are durable before anybody can send them.
+        [self appendToJournal:lines count:[beacons count] synchronize:YES];
+        [_pending addObjectsFromArray:beacons];
+        accepted = YES;
+
+        if ([self sendableCount] >= self.batchSize) {
+            [self sendBatch];
+        } else {
+            [self scheduleFlushAfter:self.flushInterval];
+        }
+    });
+    return accepted;
+}
+
+- (void)flush
+{
+    dispatch_async(_queue, ^{
+        [self sendBatch];
+    });
+}
+
+- (NSUInteger)pendingCount
+{
+    __block NSUInteger count;
+    dispatch_sync(_queue, ^{
+        count = [_pending count];
+    });
+    return count;
+}
+
+- (NSUInteger)deliveredCount
+{
+    __block NSUInteger count;
+    dispatch_sync(_queue, ^{
+        count = _deliveredCount;
+    });
+    return count;
+}
+
+#pragma mark - Sending
+
+- (NSUInteger)sendableCount
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSUInteger count = 0;
+
+    for (AdTrackingBeacon *beacon in _pending) {
+        if (!beacon.inFlight && beacon.notBefore <= now) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/** Arms the single flush timer, unless it is already armed to fire sooner. */
+- (void)scheduleFlushAfter:(NSTimeInterval)delay
+{
+    CFAbsoluteTime date = CFAbsoluteTimeGetCurrent() + delay;
+
+    if (_timer == nil) {
+        _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+        __weak AdTrackingDispatcher *weakSelf = self;
+        dispatch_source_set_event_handler(_timer, ^{
+            [weakSelf timerDidFire];
+        });
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(_timer);
+    }
+    if (_fireDate != 0 && _fireDate <= date) {
+        return;
+    }
+    _fireDate = date;
+    // A generous leeway lets the system coalesce this wake-up with others.
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                              DISPATCH_TIME_FOREVER, (uint64_t)(MAX(delay, 1) * 0.1 * NSEC_PER_SEC));
+}
+
+- (void)timerDidFire
+{
+    _fireDate = 0;
+    [self sendBatch];
+}
+
+- (void)sendBatch
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    CFAbsoluteTime nextAttempt = 0;
+    NSMutableArray *batch = [NSMutableArray array];
+
+    for (AdTrackingBeacon *beacon in _pending) {
+        if (beacon.inFlight) {
+            continue;
+        }
+        if (beacon.notBefore > now) {
+            nextAttempt = nextAttempt == 0 ? beacon.notBefore : MIN(nextAttempt, beacon.notBefore);
+            continue;
+        }
+        [batch addObject:beacon];
+    }
+
+    // Same host requests go out back to back so they are pipelined on one keep-alive connection.
+    [batch sortUsingComparator:^NSComparisonResult(AdTrackingBeacon *a, AdTrackingBeacon *b) {
+        return [[a.URL host] compare:[b.URL host] ?: @""];
+    }];
+    for (AdTrackingBeacon *beacon in batch) {
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:beacon.URL
+                                                               cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                                           timeoutInterval:kAdTrackingRequestTimeout];
+        [request setHTTPShouldUsePipelining:YES];
+        [request setHTTPShouldHandleCookies:YES];
+        [request setValue:@"keep-alive" forHTTPHeaderField:@"Connection"];
+        beacon.inFlight = YES;
+        beacon.attempts++;
+
+        [NSURLConnection sendAsynchronousRequest:request queue:_requestQueue completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+            NSInteger status = [response isKindOfClass:[NSHTTPURLResponse class]] ? [(NSHTTPURLResponse *)response statusCode] : 0;
+            BOOL delivered = error == nil && status >= 200 && status < 400;
+            dispatch_async(_queue, ^{
+                [self beacon:beacon didFinishWithSuccess:delivered];
+            });
+        }];
+    }
+
+    if (nextAttempt != 0) {
+        [self scheduleFlushAfter:MAX(nextAttempt - now, 0)];
+    }
+}
+
+- (void)beacon:(AdTrackingBeacon *)beacon didFinishWithSuccess:(BOOL)delivered
+{
+    beacon.inFlight = NO;
+
+    if (!delivered && beacon.attempts < self.maxAttempts) {
+        NSTimeInterval backoff = MIN(kAdTrackingInitialBackoff * pow(2, beacon.attempts - 1), kAdTrackingMaxBackoff);
+        // Jitter keeps retries from many devices from hitting the server in lockstep.
+        beacon.notBefore = CFAbsoluteTimeGetCurrent() + backoff * (0.5 + 0.5 * arc4random_uniform(1000) / 1000.0);
+        [self scheduleFlushAfter:beacon.notBefore - CFAbsoluteTimeGetCurrent()];
+        return;
+    }
+
+    if (delivered) {
+        _deliveredCount++;
+    } else {
+        AdLogWrite(AdLogEventBeaconDropped, (uint64_t)beacon.insertionId, (uint64_t)beacon.kind, beacon.attempts, NULL);
+    }
+    [_pending removeObject:beacon];
+    [self rememberDeliveredKey:[beacon key]];
+    [self appendToJournal:[NSString stringWithFormat:@"D\t%llu\n", beacon.sequence] count:1 synchronize:NO];
+
+    if (_journalLines > kAdTrackingCompactionThreshold && _journalLines > 2 * ([_pending count] + [_deliveredKeys count])) {
+        [self compactJournal];
+    }
+}
+
+@end
@@ -0,0 +1,106 @@
+//
+//  AdVideoPrefetcher.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SmartAdServerAd.h"
+
+/**
+ Downloads video creatives in chunks, with HTTP range requests, into a persistent sparse file cache.
+
+ A whole video is not worth downloading for a skippable ad most users skip. When the ad is received,
+ only its first prefixDuration seconds are fetched. While it plays, the next chunks are fetched just
+ in time, keeping readAheadDuration seconds ahead of the playback position, which is estimated from
+ the duration of the ad and the length of the file. When it stops (skipped, dismissed or over) the
+ rest is not fetched.
+
+    [[AdVideoPrefetcher sharedPrefetcher] prefetchAd:ad];
+    ...
+    [[AdVideoPrefetcher sharedPrefetcher] adDidStartPlaying:ad];
+    ...
+    [[AdVideoPrefetcher sharedPrefetcher] adDidStopPlaying:ad];
+
+ Each video is an AdRangeFile in Library/Caches/AdVideos, revalidated with If-Range when it is
+ prefetched again, so a cached video that changed on the server is downloaded again. A server
+ that ignores ranges gets a single request for the whole file. The cache is capped by
+ maximumCacheSize, least recently fetched videos first.
+
+ The SDK plays videos from their URL with its own player, so the cache only serves it once a video
+ is complete, through adWithCachedCreative:. tools/adrangestub and tools/advideoprefetch replay the
+ same prefetching against a local server.
+
+ Use the prefetcher from the main thread; the downloads and the files are handled on its own queue.
+ */
+
+@interface AdVideoPrefetcher : NSObject
+
++ (AdVideoPrefetcher *)sharedPrefetcher;
+
+/** The seconds of video fetched when the ad is prefetched, 3 by default.
+
+ */
+
+@property (nonatomic, assign) NSTimeInterval prefixDuration;
+
+/** The seconds of video kept fetched ahead of the playback position, 5 by default.
+
+ */
+
+@property (nonatomic, assign) NSTimeInterval readAheadDuration;
+
+/** The largest range requested at once, 256 KB by default.
+
+ */
+
+@property (nonatomic, assign) NSUInteger chunkLength;
+
+/** The size of the cache directory, 50 MB by default.
+
+ */
+
+@property (nonatomic, assign) unsigned long long maximumCacheSize;
+
+/** Fetches the first seconds of the video of the ad, nothing if the ad is not a video or they are cached.
+
+ */
+
+- (void)prefetchAd:(SmartAdServerAd *)ad;
+
+/** Starts fetching the video just in time, from the start of its playback.
+
+ */
+
+- (void)adDidStartPlaying:(SmartAdServerAd *)ad;
+
+/** Stops fetching the video. What was fetched stays cached.
+
+ */
+
+- (void)adDidStopPlaying:(SmartAdServerAd *)ad;
+
+/** Whether the whole video of the ad is cached.
+
+ */
+
+- (BOOL)hasCompleteVideoForAd:(SmartAdServerAd *)ad;
+
+/** A copy of the ad playing its cached video file, or the ad itself if the video is not complete.
+
+ */
+
+- (SmartAdServerAd *)adWithCachedCreative:(SmartAdServerAd *)ad;
+
+/** The bytes fetched at prefetch time, while playing, and those left unfetched because a video stopped early.
+
+ */
+
+- (unsigned long long)prefetchedBytes;
+- (unsigned long long)streamedBytes;
+- (unsigned long long)skippedBytes;
+
+@end
@@ -0,0 +1,399 @@
+//
+//  AdVideoPrefetcher.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdVideoPrefetcher.h"
+#import "AdBlobStore.h"
+#import "AdLog.h"
+#import "AdRangeFile.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const NSTimeInterval kAdVideoFetchTimeout = 20;
+static const NSTimeInterval kAdVideoPumpInterval = 1;
+static const NSTimeInterval kAdVideoDefaultDuration = 30;   // when the ad has none
+
+/** The state of one video, only used on the queue of the prefetcher. */
+@interface AdVideoDownload : NSObject
+
+@property (nonatomic, strong) NSURL *URL;
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, assign) AdRangeFile *file;
+@property (nonatomic, assign) NSTimeInterval duration;
+@property (nonatomic, assign) uint64_t insertionId;
+@property (nonatomic, assign) BOOL revalidated;     // a request was answered since the launch
+@property (nonatomic, assign) BOOL fetching;
+@property (nonatomic, assign) BOOL pumpScheduled;
+@property (nonatomic, assign) BOOL playing;
+@property (nonatomic, assign) CFAbsoluteTime playbackStartDate;
+
+@end
+
+@implementation AdVideoDownload
+
+- (void)dealloc
+{
+    AdRangeFileClose(_file);
+}
+
+@end
+
+@implementation AdVideoPrefetcher
+{
+    dispatch_queue_t _queue;
+    NSOperationQueue *_connectionQueue;
+    NSString *_directory;
+    NSMutableDictionary *_downloads;    // URL -> AdVideoDownload
+    unsigned long long _prefetchedBytes;
+    unsigned long long _streamedBytes;
+    unsigned long long _skippedBytes;
+}
+
++ (AdVideoPrefetcher *)sharedPrefetcher
+{
+    static AdVideoPrefetcher *sharedPrefetcher = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPrefetcher = [[AdVideoPrefetcher alloc] init];
+    });
+    return sharedPrefetcher;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+
+        _prefixDuration = 3;
+        _readAheadDuration = 5;
+        _chunkLength = 256 * 1024;
+        _maximumCacheSize = 50 * 1024 * 1024;
+        _queue = dispatch_queue_create("com.mobvalue.DemoSmart.AdVideoPrefetcher", DISPATCH_QUEUE_SERIAL);
+        _connectionQueue = [[NSOperationQueue alloc] init];
+        _connectionQueue.maxConcurrentOperationCount = 2;
+        _directory = [caches stringByAppendingPathComponent:@"AdVideos"];
+        _downloads = [NSMutableDictionary dictionary];
+        [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    return self;
+}
+
+#pragma mark - Playback
+
+- (void)prefetchAd:(SmartAdServerAd *)ad
+{
+    NSURL *URL = ad.creativeURL;
+    NSTimeInterval duration = ad.duration > 0 ? ad.duration : kAdVideoDefaultDuration;
+    uint64_t insertionId = (uint64_t)ad.insertionId;
+
+    if (![self isVideoURL:URL ofAd:ad]) {
+        return;
+    }
+    dispatch_async(_queue, ^{
+        AdVideoDownload *download = [self downloadForURL:URL];
+
+        if (download) {
+            download.duration = duration;
+            download.insertionId = insertionId;
+            [self pumpDownload:download];
+        }
+        [self trimCache];
+    });
+}
+
+- (void)adDidStartPlaying:(SmartAdServerAd *)ad
+{
+    NSURL *URL = ad.creativeURL;
+
+    if (![self isVideoURL:URL ofAd:ad]) {
+        return;
+    }
+    dispatch_async(_queue, ^{
+        AdVideoDownload *download = [self downloadForURL:URL];
+
+        if (download && !download.playing) {
+            download.playing = YES;
+            download.playbackStartDate = CFAbsoluteTimeGetCurrent();
+            [self pumpDownload:download];
+        }
+    });
+}
+
+- (void)adDidStopPlaying:(SmartAdServerAd *)ad
+{
+    NSURL *URL = ad.creativeURL;
+
+    if (![self isVideoURL:URL ofAd:ad]) {
+        return;
+    }
+    dispatch_async(_queue, ^{
+        AdVideoDownload *download = _downloads[URL];
+        uint64_t length, cached;
+
+        if (download == nil || !download.playing) {
+            return;
+        }
+        download.playing = NO;
+        length = AdRangeFileGetLength(download.file);
+        cached = AdRangeFileGetCachedBytes(download.file);
+        if (length > cached) {
+            _skippedBytes += length - cached;
+        }
+        AdLogWrite(AdLogEventVideoStopped, download.insertionId, (uint64_t)cached, (uint64_t)length, NULL);
+    });
+}
+
+- (BOOL)hasCompleteVideoForAd:(SmartAdServerAd *)ad
+{
+    __block BOOL complete = NO;
+    NSURL *URL = ad.creativeURL;
+
+    if (![self isVideoURL:URL ofAd:ad]) {
+        return NO;
+    }
+    dispatch_sync(_queue, ^{
+        AdVideoDownload *download = [self downloadForURL:URL];
+        complete = download && AdRangeFileIsComplete(download.file);
+    });
+    return complete;
+}
+
+- (SmartAdServerAd *)adWithCachedCreative:(SmartAdServerAd *)ad
+{
+    SmartAdServerAd *cachedAd;
+
+    if (![self hasCompleteVideoForAd:ad]) {
+        return ad;
+    }
+    cachedAd = [ad copy];
+    cachedAd.creativeURL = [NSURL fileURLWithPath:[self pathForURL:ad.creativeURL]];
+    return cachedAd;
+}
+
+- (unsigned long long)prefetchedBytes
+{
+    __block unsigned long long bytes;
+    dispatch_sync(_queue, ^{
+        bytes = _prefetchedBytes;
+    });
+    return bytes;
+}
+
+- (unsigned long long)streamedBytes
+{
+    __block unsigned long long bytes;
+    dispatch_sync(_queue, ^{
+        bytes = _streamedBytes;
+    });
+    return bytes;
+}
+
+- (unsigned long long)skippedBytes
+{
+    __block unsigned long long bytes;
+    dispatch_sync(_queue, ^{
+        bytes = _skippedBytes;
+    });
+    return bytes;
+}
+
+#pragma mark - Downloads
+
+- (BOOL)isVideoURL:(NSURL *)URL ofAd:(SmartAdServerAd *)ad
+{
+    return ad.creativeType == CreativeTypeVideo && URL && ![URL isFileURL];
+}
+
+/** The file of a video is named after the SHA-256 of its URL. */
+- (NSString *)pathForURL:(NSURL *)URL
+{
+    const char *string = [[URL absoluteString] UTF8String];
+    NSString *extension = [[URL path] pathExtension];
+    char name[kAdBlobHashStringLength];
+    AdBlobHash hash;
+    NSString *path;
+
+    AdBlobHashCompute(string, strlen(string), &hash);
+    AdBlobHashGetString(&hash, name);
+    path = [_directory stringByAppendingPathComponent:@(name)];
+    // The player picks the container from the extension of a file URL.
+    return [extension length] > 0 ? [path stringByAppendingPathExtension:extension] : path;
+}
+
+- (AdVideoDownload *)downloadForURL:(NSURL *)URL
+{
+    AdVideoDownload *download = _downloads[URL];
+
+    if (download == nil) {
+        NSString *path = [self pathForURL:URL];
+        AdRangeFile *file = AdRangeFileOpen([path fileSystemRepresentation]);
+
+        if (file == NULL) {
+            NSLog(@"AdVideoPrefetcher: cannot open %@: %s", path, strerror(errno));
+            return nil;
+        }
+        download = [[AdVideoDownload alloc] init];
+        download.URL = URL;
+        download.path = path;
+        download.file = file;
+        download.duration = kAdVideoDefaultDuration;
+        _downloads[URL] = download;
+    }
+    return download;
+}
+
+/** Requests the next missing chunk the video needs now: the prefix, then the read ahead window while it plays. */
+- (void)pumpDownload:(AdVideoDownload *)download
+{
+    AdRangeFile *file = download.file;
+    uint64_t length = AdRangeFileGetLength(file);
+    uint64_t start = 0, end = _chunkLength;
+    AdRange range;
+
+    if (download.fetching) {
+        return;
+    }
+    if (!download.revalidated && AdRangeFileGetAvailable(file, 0) > 0) {
+        // One byte with If-Range tells whether what is cached from an earlier launch is still current.
+        [self fetchRange:(AdRange){ 0, 1 } ofDownload:download];
+        return;
+    }
+    if (length > 0) {
+        double bytesPerSecond = (double)length / download.duration;
+
+        end = MAX((uint64_t)(_prefixDuration * bytesPerSecond), _chunkLength);
+        if (download.playing) {
+            start = (uint64_t)((CFAbsoluteTimeGetCurrent() - download.playbackStartDate) * bytesPerSecond);
+            end = MAX(end, start + (uint64_t)(_readAheadDuration * bytesPerSecond));
+        }
+    }
+    if (AdRangeFileGetNextMissing(file, start, end, _chunkLength, &range) == 0) {
+        [self fetchRange:range ofDownload:download];
+    } else if (download.playing && !AdRangeFileIsComplete(file) && !download.pumpScheduled) {
+        // The window is full, it moves with the playback.
+        download.pumpScheduled = YES;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kAdVideoPumpInterval * NSEC_PER_SEC)), _queue, ^{
+            download.pumpScheduled = NO;
+            if (download.playing) {
+                [self pumpDownload:download];
+            }
+        });
+    }
+}
+
+- (void)fetchRange:(AdRange)range ofDownload:(AdVideoDownload *)download
+{
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:download.URL cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                                       timeoutInterval:kAdVideoFetchTimeout];
+    const char *validator = AdRangeFileGetValidator(download.file);
+    BOOL playing = download.playing;
+
+    [request setValue:[NSString stringWithFormat:@"bytes=%llu-%llu", range.start, range.end - 1] forHTTPHeaderField:@"Range"];
+    if (validator[0] != '\0') {
+        [request setValue:@(validator) forHTTPHeaderField:@"If-Range"];
+    }
+    download.fetching = YES;
+    [NSURLConnection sendAsynchronousRequest:request queue:_connectionQueue completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+        dispatch_async(_queue, ^{
+            download.fetching = NO;
+            if (![self storeResponse:response data:data inDownload:download]) {
+                NSLog(@"AdVideoPrefetcher: cannot fetch %@ (%@): %@", download.URL, request.allHTTPHeaderFields[@"Range"], error ?: response);
+                return;
+            }
+            if (playing) {
+                _streamedBytes += [data length];
+            } else {
+                _prefetchedBytes += [data length];
+            }
+            download.revalidated = YES;
+            [self pumpDownload:download];
+        });
+    }];
+}
+
+/** Writes a 206 at its offset, or a whole 200 (no range support, or a new version of the video) from the start. */
+- (BOOL)storeResponse:(NSURLResponse *)response data:(NSData *)data inDownload:(AdVideoDownload *)download
+{
+    NSDictionary *headerFields;
+    NSString *validator;
+    unsigned long long offset = 0, total = [data length];
+    NSInteger statusCode;
+
+    if (![response isKindOfClass:[NSHTTPURLResponse class]] || data == nil) {
+        return NO;
+    }
+    statusCode = [(NSHTTPURLResponse *)response statusCode];
+    headerFields = [(NSHTTPURLResponse *)response allHeaderFields];
+    if (statusCode == 206) {
+        NSString *contentRange = headerFields[@"Content-Range"];
+
+        if (contentRange == nil || sscanf([contentRange UTF8String], "bytes %llu-%*[0-9]/%llu", &offset, &total) != 2) {
+            return NO;
+        }
+    } else if (statusCode != 200) {
+        return NO;
+    }
+    validator = headerFields[@"Etag"] ?: headerFields[@"ETag"] ?: headerFields[@"Last-Modified"];
+    if (validator) {
+        AdRangeFileSetValidator(download.file, [validator UTF8String]);
+    }
+    if (AdRangeFileSetLength(download.file, total) < 0 || AdRangeFileWrite(download.file, offset, [data bytes], [data length]) != 0) {
+        NSLog(@"AdVideoPrefetcher: cannot write %@: %s", download.path, strerror(errno));
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Cache
+
+/** Deletes the least recently fetched videos beyond maximumCacheSize, except those playing or being fetched. */
+- (void)trimCache
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSMutableArray *videos = [NSMutableArray array];
+    unsigned long long size = 0;
+
+    for (NSString *name in [fileManager contentsOfDirectoryAtPath:_directory error:NULL]) {
+        NSString *path = [_directory stringByAppendingPathComponent:name];
+        NSDictionary *attributes = [fileManager attributesOfItemAtPath:path error:NULL];
+
+        if ([name hasSuffix:@".ranges"] || [name hasSuffix:@".tmp"]) {
+            continue;
+        }
+        // The data files are sparse, but a video the cache holds is mostly fetched.
+        size += [attributes fileSize];
+        [videos addObject:@[ [attributes fileModificationDate] ?: [NSDate distantPast], path ]];
+    }
+    [videos sortUsingComparator:^NSComparisonResult(NSArray *video1, NSArray *video2) {
+        return [video1[0] compare:video2[0]];
+    }];
+    for (NSArray *video in videos) {
+        NSString *path = video[1];
+        AdVideoDownload *download = nil;
+
+        if (size <= _maximumCacheSize) {
+            break;
+        }
+        for (AdVideoDownload *candidate in [_downloads allValues]) {
+            if ([candidate.path isEqualToString:path]) {
+                download = candidate;
+            }
+        }
+        if (download.playing || download.fetching) {
+            continue;
+        }
+        size -= [[fileManager attributesOfItemAtPath:path error:NULL] fileSize];
+        if (download) {
+            [_downloads removeObjectForKey:download.URL];
+        }
+        AdRangeFileRemove([path fileSystemRepresentation]);
+    }
+}
+
+@end
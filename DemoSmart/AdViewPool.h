@@ -0,0 +1,98 @@
+//
+//  AdViewPool.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SASAdView.h"
+
+/**
+ Keeps ad views created ahead of time, so that a placement does not pay for the web view, the loader
+ and the controllers of a new SASAdView on the main thread when its content appears.
+
+ A kind of view is its class (SASInterstitialView or SASBannerView), its loader and whether it hides
+ the status bar. For each kind given a warm count, the pool creates the missing views while the main
+ run loop is idle, one per pass so that it never holds the run loop for more than one view, and not
+ while the user scrolls.
+
+    SASAdView *adView = [[AdViewPool sharedPool] dequeueViewOfClass:[SASInterstitialView class] frame:frame
+                                                              loader:SASLoaderActivityIndicatorStyleBlack hideStatusBar:YES];
+    ...
+    // Once it is dismissed:
+    [[AdViewPool sharedPool] recycleView:adView];
+
+ Idle views are capped by maximumCost. After a memory warning the pool stops warming until views are
+ dequeued again. Use the pool from the main thread.
+ */
+
+@interface AdViewPool : NSObject
+
++ (AdViewPool *)sharedPool;
+
+/** The estimated memory of the idle views the pool may keep, two full-screen views at the screen scale by default.
+
+ */
+
+@property (nonatomic, assign) NSUInteger maximumCost;
+
+/** Creates count views of the kind while the app is idle, and keeps that many idle views afterwards.
+
+ */
+
+- (void)setWarmCount:(NSUInteger)count forViewClass:(Class)viewClass loader:(SASLoader)loader hideStatusBar:(BOOL)hideStatusBar;
+
+/** Returns an idle view of the kind with the given frame, or a new one when there is none.
+
+ */
+
+- (SASAdView *)dequeueViewOfClass:(Class)viewClass frame:(CGRect)frame loader:(SASLoader)loader hideStatusBar:(BOOL)hideStatusBar;
+
+/** Removes the view from its superview, clears its delegate and keeps it for the next dequeue of its kind.
+
+ The view must come from dequeueViewOfClass:frame:loader:hideStatusBar: and be dismissed. It is released
+ instead when the pool is full.
+
+ */
+
+- (void)recycleView:(SASAdView *)adView;
+
+/** Releases idle views, the coldest kinds first, until their estimated memory is at most cost. Returns the bytes freed.
+
+ */
+
+- (NSUInteger)trimToCost:(NSUInteger)cost;
+
+/** Stops creating views until the next dequeue.
+
+ */
+
+- (void)suspendWarming;
+
+/** Call on memory warnings: releases every idle view and stops warming until the next dequeue.
+
+ AdMemoryMonitor calls it on every warning, after its own response.
+
+ */
+
+- (void)didReceiveMemoryWarning;
+
+/** The estimated memory of the idle views.
+
+ */
+
+- (NSUInteger)cost;
+
+- (NSUInteger)idleCount;
+
+/** Dequeues served by an idle view, and by a new view.
+
+ */
+
+- (NSUInteger)hitCount;
+- (NSUInteger)missCount;
+
+@end
@@ -0,0 +1,295 @@
+//
+//  AdViewPool.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "AdViewPool.h"
+
+// Full-screen views the idle views may weigh by default: the warm interstitial and the one being recycled.
+static const NSUInteger kAdViewPoolDefaultScreenfuls = 2;
+// The web view, the loader and the controllers of a view, besides its backing store.
+static const NSUInteger kAdViewPoolBaseViewCost = 256 * 1024;
+
+@interface AdViewPoolKind : NSObject
+
+@property (nonatomic, assign) Class viewClass;
+@property (nonatomic, assign) SASLoader loader;
+@property (nonatomic, assign) BOOL hideStatusBar;
+@property (nonatomic, assign) NSUInteger warmCount;
+@property (nonatomic, strong) NSMutableArray *idleViews;
+@property (nonatomic, strong) NSMutableArray *idleCosts;    // what each idle view was charged, a view resized since costs the same
+@property (nonatomic, assign) CFAbsoluteTime lastDequeueDate;
+
+@end
+
+@implementation AdViewPoolKind
+
+@end
+
+@implementation AdViewPool
+{
+    NSMutableDictionary *_kinds;
+    NSMapTable *_kindsByView;
+    CFRunLoopObserverRef _idleObserver;
+    BOOL _warmingSuspended;
+    NSUInteger _cost;
+    NSUInteger _hitCount;
+    NSUInteger _missCount;
+}
+
++ (AdViewPool *)sharedPool
+{
+    static AdViewPool *sharedPool = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPool = [[AdViewPool alloc] init];
+    });
+    return sharedPool;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _kinds = [NSMutableDictionary dictionary];
+        _kindsByView = [NSMapTable weakToStrongObjectsMapTable];
+        self.maximumCost = kAdViewPoolDefaultScreenfuls * [self costOfSize:[UIScreen mainScreen].bounds.size];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stopWarming];
+}
+
+#pragma mark - Kinds
+
+- (AdViewPoolKind *)kindForViewClass:(Class)viewClass loader:(SASLoader)loader hideStatusBar:(BOOL)hideStatusBar
+{
+    NSString *key = [NSString stringWithFormat:@"%@ %d %d", NSStringFromClass(viewClass), (int)loader, hideStatusBar];
+    AdViewPoolKind *kind = _kinds[key];
+
+    if (kind == nil) {
+        kind = [[AdViewPoolKind alloc] init];
+        kind.viewClass = viewClass;
+        kind.loader = loader;
+        kind.hideStatusBar = hideStatusBar;
+        kind.idleViews = [NSMutableArray array];
+        kind.idleCosts = [NSMutableArray array];
+        _kinds[key] = kind;
+    }
+    return kind;
+}
+
+/** The backing store of the view at the screen scale, plus its web view and controllers. */
+- (NSUInteger)costOfView:(UIView *)view
+{
+    return [self costOfSize:view.bounds.size];
+}
+
+- (NSUInteger)costOfSize:(CGSize)size
+{
+    CGFloat scale = [UIScreen mainScreen].scale;
+
+    return kAdViewPoolBaseViewCost + (NSUInteger)(size.width * scale * size.height * scale * 4);
+}
+
+- (SASAdView *)newViewOfKind:(AdViewPoolKind *)kind frame:(CGRect)frame
+{
+    SASAdView *adView = [[kind.viewClass alloc] initWithFrame:frame loader:kind.loader hideStatusBar:kind.hideStatusBar];
+
+    if (adView) {
+        [_kindsByView setObject:kind forKey:adView];
+    }
+    return adView;
+}
+
+- (void)addIdleView:(SASAdView *)adView cost:(NSUInteger)cost toKind:(AdViewPoolKind *)kind
+{
+    [kind.idleViews addObject:adView];
+    [kind.idleCosts addObject:@(cost)];
+    _cost += cost;
+}
+
+/** Takes the last idle view out of the pool. Returns the cost it was charged. */
+- (NSUInteger)removeLastIdleViewOfKind:(AdViewPoolKind *)kind
+{
+    NSUInteger cost = [[kind.idleCosts lastObject] unsignedIntegerValue];
+
+    [kind.idleViews removeLastObject];
+    [kind.idleCosts removeLastObject];
+    _cost -= cost;
+    return cost;
+}
+
+#pragma mark - Views
+
+- (void)setWarmCount:(NSUInteger)count forViewClass:(Class)viewClass loader:(SASLoader)loader hideStatusBar:(BOOL)hideStatusBar
+{
+    AdViewPoolKind *kind = [self kindForViewClass:viewClass loader:loader hideStatusBar:hideStatusBar];
+
+    kind.warmCount = count;
+    while ([kind.idleViews count] > count) {
+        [self removeLastIdleViewOfKind:kind];
+    }
+    [self startWarming];
+}
+
+- (SASAdView *)dequeueViewOfClass:(Class)viewClass frame:(CGRect)frame loader:(SASLoader)loader hideStatusBar:(BOOL)hideStatusBar
+{
+    AdViewPoolKind *kind = [self kindForViewClass:viewClass loader:loader hideStatusBar:hideStatusBar];
+    SASAdView *adView = [kind.idleViews lastObject];
+
+    kind.lastDequeueDate = CFAbsoluteTimeGetCurrent();
+    _warmingSuspended = NO;
+    if (adView == nil) {
+        _missCount++;
+        adView = [self newViewOfKind:kind frame:frame];
+    } else {
+        _hitCount++;
+        [self removeLastIdleViewOfKind:kind];
+        adView.frame = frame;
+    }
+    // Replace the view just taken when the run loop is next idle.
+    [self startWarming];
+    return adView;
+}
+
+- (void)recycleView:(SASAdView *)adView
+{
+    AdViewPoolKind *kind = [_kindsByView objectForKey:adView];
+    NSUInteger cost;
+
+    if (kind == nil || [kind.idleViews containsObject:adView]) {
+        return;
+    }
+    adView.delegate = nil;
+    [adView removeFromSuperview];
+    adView.hidden = NO;
+    adView.alpha = 1;
+    adView.transform = CGAffineTransformIdentity;
+
+    cost = [self costOfView:adView];
+    if ([kind.idleViews count] < MAX(kind.warmCount, 1) && _cost + cost <= self.maximumCost) {
+        [self addIdleView:adView cost:cost toKind:kind];
+    }
+}
+
+- (NSUInteger)trimToCost:(NSUInteger)cost
+{
+    NSArray *kinds = [[_kinds allValues] sortedArrayUsingComparator:^NSComparisonResult(AdViewPoolKind *kind1, AdViewPoolKind *kind2) {
+        return kind1.lastDequeueDate < kind2.lastDequeueDate ? NSOrderedAscending : kind1.lastDequeueDate > kind2.lastDequeueDate ? NSOrderedDescending : NSOrderedSame;
+    }];
+    NSUInteger freed = 0;
+
+    for (AdViewPoolKind *kind in kinds) {
+        while (_cost > cost && [kind.idleViews count] > 0) {
+            freed += [self removeLastIdleViewOfKind:kind];
+        }
+    }
+    return freed;
+}
+
+- (void)suspendWarming
+{
+    _warmingSuspended = YES;
+    [self stopWarming];
+}
+
+- (void)didReceiveMemoryWarning
+{
+    [self suspendWarming];
+    [self trimToCost:0];
+}
+
+#pragma mark - Warming
+
+- (AdViewPoolKind *)kindToWarm
+{
+    for (AdViewPoolKind *kind in [_kinds allValues]) {
+        if ([kind.idleViews count] < kind.warmCount) {
+            return kind;
+        }
+    }
+    return nil;
+}
+
+- (void)startWarming
+{
+    __weak AdViewPool *weakSelf = self;
+
+    if (_idleObserver || _warmingSuspended || [self kindToWarm] == nil) {
+        return;
+    }
+    // Before waiting, the run loop has nothing left to do. The default mode leaves out the tracking of scroll views.
+    _idleObserver = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting, true, 0, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+        [weakSelf warmOneView];
+    });
+    CFRunLoopAddObserver(CFRunLoopGetMain(), _idleObserver, kCFRunLoopDefaultMode);
+    CFRunLoopWakeUp(CFRunLoopGetMain());
+}
+
+- (void)stopWarming
+{
+    if (_idleObserver) {
+        CFRunLoopObserverInvalidate(_idleObserver);
+        CFRelease(_idleObserver);
+        _idleObserver = NULL;
+    }
+}
+
+- (void)warmOneView
+{
+    AdViewPoolKind *kind = [self kindToWarm];
+    CGRect frame = [UIScreen mainScreen].bounds;
+    NSUInteger cost = [self costOfSize:frame.size];
+    SASAdView *adView = nil;
+
+    if (kind && _cost + cost <= self.maximumCost) {
+        adView = [self newViewOfKind:kind frame:frame];
+    }
+    if (adView == nil) {
+        [self stopWarming];
+        return;
+    }
+    [self addIdleView:adView cost:cost toKind:kind];
+    if ([self kindToWarm]) {
+        // Come back on the next idle pass rather than sleeping.
+        CFRunLoopWakeUp(CFRunLoopGetMain());
+    } else {
+        [self stopWarming];
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)cost
+{
+    return _cost;
+}
+
+- (NSUInteger)idleCount
+{
+    NSUInteger count = 0;
+
+    for (AdViewPoolKind *kind in [_kinds allValues]) {
+        count += [kind.idleViews count];
+    }
+    return count;
+}
+
+- (NSUInteger)hitCount
+{
+    return _hitCount;
+}
+
+- (NSUInteger)missCount
+{
+    return _missCount;
+}
+
+@end
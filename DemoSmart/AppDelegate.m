@@ -7,26 +7,122 @@
 //
 
 #import "AppDelegate.h"
+#import "AdConnectionWarmer.h"
+#import "AdLifecycleMetrics.h"
+#import "AdLog.h"
+#import "AdMemoryMonitor.h"
+#import "AdTraceURLProtocol.h"
+#import "AdViewPool.h"
+#import "LaunchProfiler.h"
+#import "OfflineAdCache.h"
+#import "SASInterstitialView.h"
 #import "SmartAdServerView.h"
 #import "ViewController.h"
 
+#include <errno.h>
+
+// Launch with -LaunchAds NO to measure the launch without ads.
+static NSString * const kLaunchAdsDefaultsKey = @"LaunchAds";
+// Launch with -AdTraceRecord name to record the ad traffic, -AdTraceReplay name to replay it offline.
+static NSString * const kAdTraceRecordDefaultsKey = @"AdTraceRecord";
+static NSString * const kAdTraceReplayDefaultsKey = @"AdTraceReplay";
+static NSString * const kAdTraceTimeScaleDefaultsKey = @"AdTraceTimeScale";
+
+static NSString * const kAdBaseURL = @"http://mobile.smartadserver.com";
+
+static const size_t kAdLogMaxFileSize = 1024 * 1024;
+static const unsigned kAdLogMaxFiles = 4;
+
 @implementation AppDelegate
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions
 {
+    LaunchProfiler *profiler = [LaunchProfiler sharedProfiler];
+    [profiler markPhase:@"didFinishLaunching"];
+    
+    [[NSUserDefaults standardUserDefaults] registerDefaults:@{ kLaunchAdsDefaultsKey: @YES, kAdTraceTimeScaleDefaultsKey: @1 }];
+    profiler.adsEnabled = [[NSUserDefaults standardUserDefaults] boolForKey:kLaunchAdsDefaultsKey];
+    
     self.window = [[UIWindow alloc] initWithFrame:[[UIScreen mainScreen] bounds]];
     
-    [SmartAdServerView setSiteID:51901 baseURL:@"http://mobile.smartadserver.com"];
-	[SmartAdServerView enableLogging];
+    [self startAdTrace];
+    [SmartAdServerView setSiteID:51901 baseURL:kAdBaseURL];
+    // The ad server and the CDNs of the latest ads are resolved and connected to while the first ad call is prepared, nothing goes out when replaying.
+    if ([[[NSUserDefaults standardUserDefaults] stringForKey:kAdTraceReplayDefaultsKey] length] == 0) {
+        [[AdConnectionWarmer sharedWarmer] warmUpBaseURL:kAdBaseURL];
+    }
     
     ViewController *viewController = [[ViewController alloc] initWithNibName:@"ViewController" bundle:nil];
 	self.navigationController = [[UINavigationController alloc] initWithRootViewController:viewController];
 	self.navigationController.navigationBar.barStyle = UIBarStyleBlack;
+    
+    // The ad call leaves before the nib is loaded and the window laid out, and runs concurrently with them.
+    if (profiler.adsEnabled) {
+        [viewController loadInterstitialInView:self.navigationController.view];
+    }
+    
 	self.window.rootViewController = self.navigationController;
     [self.window makeKeyAndVisible];
+    [profiler markPhase:@"windowVisible"];
+    
+    // Nothing below is needed to show the first frame.
+    [profiler runAfterFirstFrame:^{
+        [self openAdLogWithLaunchPhases:profiler.phases];
+        // The next interstitial, or a hedged ad call, finds its view ready.
+        [[AdViewPool sharedPool] setWarmCount:1 forViewClass:[SASInterstitialView class] loader:SASLoaderActivityIndicatorStyleBlack hideStatusBar:YES];
+        // Trims the ad caches when the app goes to the background, memory warnings come through ViewController.
+        [AdMemoryMonitor sharedMonitor];
+        // Every downloaded ad is appended to the log of the offline cache, which only shrinks when compacted.
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+            [[OfflineAdCache sharedCache] evictExpiredAds];
+        });
+#ifdef DEBUG
+        [SmartAdServerView enableLogging];
+#endif
+    }];
     return YES;
 }
 
+/** Records or replays the ad traffic from the first ad call on, see AdTraceURLProtocol.h. The traces are in Library/Caches unless the path is absolute. */
+- (void)startAdTrace
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+    NSString *record = [defaults stringForKey:kAdTraceRecordDefaultsKey];
+    NSString *replay = [defaults stringForKey:kAdTraceReplayDefaultsKey];
+    
+    if ([replay length] > 0) {
+        [AdTraceURLProtocol startReplayingFromPath:[replay isAbsolutePath] ? replay : [caches stringByAppendingPathComponent:replay]
+                                         timeScale:[defaults doubleForKey:kAdTraceTimeScaleDefaultsKey]];
+    } else if ([record length] > 0) {
+        [AdTraceURLProtocol startRecordingToPath:[record isAbsolutePath] ? record : [caches stringByAppendingPathComponent:record]];
+    }
+}
+
+/** The ad events go to Library/Caches/Logs, see AdLog.h. Decode them with tools/adlogdecode. */
+- (void)openAdLogWithLaunchPhases:(NSArray *)phases
+{
+    NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+    NSString *directory = [caches stringByAppendingPathComponent:@"Logs"];
+    
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    if (AdLogOpen([directory fileSystemRepresentation], kAdLogMaxFileSize, kAdLogMaxFiles) != 0) {
+        NSLog(@"AppDelegate: cannot open the ad log in %@: %s", directory, strerror(errno));
+        return;
+    }
+    for (NSDictionary *phase in phases) {
+        AdLogWrite(AdLogEventLaunchPhase, (uint64_t)([phase[@"time"] doubleValue] * 1e6), 0, 0, [phase[@"phase"] UTF8String]);
+    }
+}
+
+/** Keeps the latest latency histograms in Library/Caches/AdLifecycleMetrics.plist, to be sent with the app statistics. */
+- (void)saveAdLifecycleMetrics
+{
+    NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+    
+    [[[AdLifecycleMetrics sharedMetrics] snapshot] writeToFile:[caches stringByAppendingPathComponent:@"AdLifecycleMetrics.plist"] atomically:YES];
+}
+
 - (void)applicationWillResignActive:(UIApplication *)application
 {
     // Sent when the application is about to move from active to inactive state. This can occur for certain types of temporary interruptions (such as an incoming phone call or SMS message) or when the user quits the application and it begins the transition to the background state.
@@ -37,11 +133,18 @@
 {
     // Use this method to release shared resources, save user data, invalidate timers, and store enough application state information to restore your application to its current state in case it is terminated later.
     // If your application supports background execution, this method is called instead of applicationWillTerminate: when the user quits.
+    AdLogFlush();
+    [AdTraceURLProtocol flush];
+    [self saveAdLifecycleMetrics];
+    [[OfflineAdCache sharedCache] evictExpiredAds];
+    [[OfflineAdCache sharedCache] sync];
 }
 
 - (void)applicationWillEnterForeground:(UIApplication *)application
 {
     // Called as part of the transition from the background to the inactive state; here you can undo many of the changes made on entering the background.
+    // The idle connections were closed in the background.
+    [[AdConnectionWarmer sharedWarmer] warmUp];
 }
 
 - (void)applicationDidBecomeActive:(UIApplication *)application
@@ -0,0 +1,65 @@
+//
+//  LaunchProfiler.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Times the phases of the launch, from the process start to the first frame on screen.
+
+ Phases are marked with markPhase: and measured from the process start time, so the time spent
+ before main() (dylib loading, +load methods) is part of the first phase. The first frame is the
+ first display refresh after the window was made visible.
+
+ Once the first frame is shown and the setup deferred after it has run, the launch is appended to a
+ short history kept in the user defaults (and logged in debug builds), with whether ads were loaded at launch, so launches with and without ads can be
+ compared on a device.
+ */
+
+@interface LaunchProfiler : NSObject
+
++ (LaunchProfiler *)sharedProfiler;
+
+/** Records the time elapsed since the process start under a phase name.
+
+ */
+
+- (void)markPhase:(NSString *)phase;
+
+/** Runs the block on the main thread once the first frame is on screen, or at once if it already is.
+
+ Use it for the setup that does not need to be done before the user sees the app.
+
+ */
+
+- (void)runAfterFirstFrame:(dispatch_block_t)block;
+
+/** Whether ads are loaded during this launch, recorded with the launch timings.
+
+ */
+
+@property (nonatomic, assign) BOOL adsEnabled;
+
+/** The phases of this launch, in order, as dictionaries with "phase" and "time" (seconds since the process start).
+
+ */
+
+@property (nonatomic, readonly) NSArray *phases;
+
+/** Seconds from the process start to the first frame, 0 until it is shown.
+
+ */
+
+@property (nonatomic, readonly) NSTimeInterval timeToFirstFrame;
+
+/** The last launches, oldest first, as dictionaries with "ads", "firstFrame" and "phases".
+
+ */
+
+- (NSArray *)recentLaunches;
+
+@end
@@ -0,0 +1,134 @@
+//
+//  LaunchProfiler.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "LaunchProfiler.h"
+
+#import <QuartzCore/QuartzCore.h>
+
+#include <sys/sysctl.h>
+#include <unistd.h>
+
+static NSString * const kLaunchProfilerLaunchesDefaultsKey = @"LaunchProfilerLaunches";
+static const NSUInteger kLaunchProfilerHistoryLength = 20;
+
+@implementation LaunchProfiler
+{
+    CFAbsoluteTime _processStart;
+    NSMutableArray *_phases;
+    NSMutableArray *_afterFirstFrame;
+    CADisplayLink *_displayLink;
+}
+
++ (LaunchProfiler *)sharedProfiler
+{
+    static LaunchProfiler *sharedProfiler = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedProfiler = [[LaunchProfiler alloc] init];
+    });
+    return sharedProfiler;
+}
+
+/** The process start time from the kernel, or now if it cannot be read. */
+static CFAbsoluteTime LaunchProfilerProcessStart(void)
+{
+    struct kinfo_proc info;
+    size_t length = sizeof(info);
+    int name[] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid() };
+
+    if (sysctl(name, 4, &info, &length, NULL, 0) != 0 || length == 0) {
+        return CFAbsoluteTimeGetCurrent();
+    }
+    return info.kp_proc.p_starttime.tv_sec + info.kp_proc.p_starttime.tv_usec / 1e6 - kCFAbsoluteTimeIntervalSince1970;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _processStart = LaunchProfilerProcessStart();
+        _phases = [NSMutableArray array];
+        _afterFirstFrame = [NSMutableArray array];
+        _adsEnabled = YES;
+    }
+    return self;
+}
+
+- (NSArray *)phases
+{
+    return [_phases copy];
+}
+
+- (void)markPhase:(NSString *)phase
+{
+    [_phases addObject:@{ @"phase": phase, @"time": @(CFAbsoluteTimeGetCurrent() - _processStart) }];
+}
+
+#pragma mark - First frame
+
+- (void)runAfterFirstFrame:(dispatch_block_t)block
+{
+    NSAssert([NSThread isMainThread], @"The launch is profiled on the main thread");
+
+    if (_timeToFirstFrame > 0) {
+        block();
+        return;
+    }
+    [_afterFirstFrame addObject:[block copy]];
+    if (_displayLink == nil) {
+        _displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayDidRefresh:)];
+        [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+}
+
+- (void)displayDidRefresh:(CADisplayLink *)displayLink
+{
+    NSArray *blocks = _afterFirstFrame;
+
+    [_displayLink invalidate];
+    _displayLink = nil;
+    _timeToFirstFrame = CFAbsoluteTimeGetCurrent() - _processStart;
+    [self markPhase:@"firstFrame"];
+
+    _afterFirstFrame = nil;
+    for (dispatch_block_t block in blocks) {
+        block();
+    }
+    [self markPhase:@"deferredSetup"];
+    [self recordLaunch];
+}
+
+#pragma mark - History
+
+- (void)recordLaunch
+{
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSMutableArray *launches = [[defaults arrayForKey:kLaunchProfilerLaunchesDefaultsKey] mutableCopy] ?: [NSMutableArray array];
+
+#ifdef DEBUG
+    NSMutableString *description = [NSMutableString string];
+
+    for (NSDictionary *phase in _phases) {
+        [description appendFormat:@" %@ %.1f ms", phase[@"phase"], [phase[@"time"] doubleValue] * 1e3];
+    }
+    NSLog(@"LaunchProfiler (ads %@):%@", self.adsEnabled ? @"on" : @"off", description);
+#endif
+
+    [launches addObject:@{ @"ads": @(self.adsEnabled), @"firstFrame": @(_timeToFirstFrame), @"phases": [_phases copy] }];
+    if ([launches count] > kLaunchProfilerHistoryLength) {
+        [launches removeObjectsInRange:NSMakeRange(0, [launches count] - kLaunchProfilerHistoryLength)];
+    }
+    [defaults setObject:launches forKey:kLaunchProfilerLaunchesDefaultsKey];
+}
+
+- (NSArray *)recentLaunches
+{
+    return [[NSUserDefaults standardUserDefaults] arrayForKey:kLaunchProfilerLaunchesDefaultsKey] ?: @[];
+}
+
+@end
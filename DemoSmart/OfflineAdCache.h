@@ -0,0 +1,91 @@
+//
+//  OfflineAdCache.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "SmartAdServerAd.h"
+#import "AdCache.h"
+
+/**
+ App side store for offline ads, keyed like the ad calls: (formatId, pageId, target).
+
+ Ads are kept as AdRecord entries in an AdCache, see AdCache.h for the file layout.
+ All methods are thread safe.
+ */
+
+@interface OfflineAdCache : NSObject
+
+/** The cache stored in Library/Caches/OfflineAds, limited to kOfflineAdCacheDefaultMaxEntries ads.
+
+ */
+
++ (OfflineAdCache *)sharedCache;
+
+/** Opens or creates a cache in the given directory, which is created if needed.
+
+ @param maxEntries The number of ads above which the soonest expiring ads are evicted, 0 for no limit.
+
+ */
+
+- (id)initWithDirectory:(NSString *)directory maxEntries:(NSUInteger)maxEntries;
+
+/** Stores an ad, replacing the ad previously stored for the same placement.
+
+ Ads without expirationDate never expire, they only leave the cache when it is full.
+
+ */
+
+- (BOOL)storeAd:(SmartAdServerAd *)ad formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Returns the stored ad for the placement if it has not expired yet.
+
+ */
+
+- (SmartAdServerAd *)adForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Returns the stored ad like adForFormatId:pageId:target:, without counting a hit or a miss.
+
+ For the lookups that do not display the ad, such as finding the ad a new one replaces, so that the statistics only count the ads served from the cache.
+
+ */
+
+- (SmartAdServerAd *)peekAdForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Whether a non expired ad is stored for the placement, without decoding it. Not counted as a hit or a miss.
+
+ */
+
+- (BOOL)hasAdForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+- (void)removeAdForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target;
+
+/** Evicts expired ads and compacts the log when more than half of it is dead.
+
+ @return The number of evicted ads.
+
+ */
+
+- (NSUInteger)evictExpiredAds;
+
+/** Flushes the index and the log to disk, before the app is suspended.
+
+ */
+
+- (void)sync;
+
+/** Hit, miss and eviction counters since the cache was opened or the counters were reset.
+
+ */
+
+- (AdCacheStatistics)statistics;
+
+- (void)resetStatistics;
+
+@end
+
+extern const NSUInteger kOfflineAdCacheDefaultMaxEntries;
@@ -0,0 +1,143 @@
+//
+//  OfflineAdCache.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "OfflineAdCache.h"
+#import "SmartAdServerAd+AdRecord.h"
+
+#include <errno.h>
+#include <string.h>
+
+const NSUInteger kOfflineAdCacheDefaultMaxEntries = 1000;
+
+@implementation OfflineAdCache
+{
+    AdCache *_cache;
+    AdRecordBuilder *_builder;
+}
+
++ (OfflineAdCache *)sharedCache
+{
+    static OfflineAdCache *sharedCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+        sharedCache = [[OfflineAdCache alloc] initWithDirectory:[caches stringByAppendingPathComponent:@"OfflineAds"]
+                                                     maxEntries:kOfflineAdCacheDefaultMaxEntries];
+    });
+    return sharedCache;
+}
+
+- (id)initWithDirectory:(NSString *)directory maxEntries:(NSUInteger)maxEntries
+{
+    self = [super init];
+    if (self) {
+        NSError *error = nil;
+        if (![[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:&error]) {
+            NSLog(@"OfflineAdCache: cannot create %@: %@", directory, error);
+            return nil;
+        }
+        _cache = AdCacheOpen([directory fileSystemRepresentation], (uint32_t)maxEntries);
+        _builder = AdRecordBuilderCreate();
+        if (_cache == NULL || _builder == NULL) {
+            NSLog(@"OfflineAdCache: cannot open %@: %s", directory, strerror(errno));
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    AdCacheClose(_cache);
+    AdRecordBuilderRelease(_builder);
+}
+
+- (BOOL)storeAd:(SmartAdServerAd *)ad formatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    const void *record;
+    size_t length;
+    int result = -1;
+
+    @synchronized(self) {
+        record = [ad writeAdRecordWithBuilder:_builder length:&length];
+        if (record) {
+            result = AdCachePut(_cache, formatId, [pageId UTF8String], [target UTF8String], record, length,
+                                [ad.expirationDate timeIntervalSince1970]);
+        }
+    }
+    return result == 0;
+}
+
+- (SmartAdServerAd *)adForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        const AdRecordHeader *record = AdCacheGet(_cache, formatId, [pageId UTF8String], [target UTF8String],
+                                                  [[NSDate date] timeIntervalSince1970]);
+        return record ? [SmartAdServerAd adWithAdRecord:record] : nil;
+    }
+}
+
+- (SmartAdServerAd *)peekAdForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        const AdRecordHeader *record = AdCachePeek(_cache, formatId, [pageId UTF8String], [target UTF8String],
+                                                   [[NSDate date] timeIntervalSince1970]);
+        return record ? [SmartAdServerAd adWithAdRecord:record] : nil;
+    }
+}
+
+- (BOOL)hasAdForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        return AdCachePeek(_cache, formatId, [pageId UTF8String], [target UTF8String], [[NSDate date] timeIntervalSince1970]) != NULL;
+    }
+}
+
+- (void)removeAdForFormatId:(NSInteger)formatId pageId:(NSString *)pageId target:(NSString *)target
+{
+    @synchronized(self) {
+        AdCacheRemove(_cache, formatId, [pageId UTF8String], [target UTF8String]);
+    }
+}
+
+- (NSUInteger)evictExpiredAds
+{
+    @synchronized(self) {
+        uint32_t evicted = AdCacheEvictExpired(_cache, [[NSDate date] timeIntervalSince1970]);
+        AdCacheStatistics statistics = AdCacheGetStatistics(_cache);
+        if (statistics.deadLength * 2 > statistics.logLength) {
+            AdCacheCompact(_cache);
+        }
+        return evicted;
+    }
+}
+
+- (void)sync
+{
+    @synchronized(self) {
+        if (AdCacheSync(_cache) != 0) {
+            NSLog(@"OfflineAdCache: cannot sync: %s", strerror(errno));
+        }
+    }
+}
+
+- (AdCacheStatistics)statistics
+{
+    @synchronized(self) {
+        return AdCacheGetStatistics(_cache);
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self) {
+        AdCacheResetCounters(_cache);
+    }
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  SmartAdServerAd+AdRecord.h
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "SmartAdServerAd.h"
+#import "AdRecord.h"
+
+/**
+ Converts a SmartAdServerAd to and from the flat binary layout described in AdRecord.h.
+
+ This replaces NSKeyedArchiver when ads are persisted: encoding does not build an object graph,
+ and a stored record can be inspected in place (see AdRecordGetString) before paying for
+ the SmartAdServerAd instance.
+ */
+
+@interface SmartAdServerAd (AdRecord)
+
+/** Encodes the ad with a builder owned by the caller, so that its buffers are reused across ads.
+
+ @return The record, owned by the builder until its next reset, or NULL if the ad could not be encoded.
+
+ */
+
+- (const void *)writeAdRecordWithBuilder:(AdRecordBuilder *)builder length:(size_t *)length;
+
+/** Encodes the ad into a new data object.
+
+ */
+
+- (NSData *)adRecordData;
+
+/** Creates an ad from a record, or returns nil if the bytes do not hold a valid record.
+
+ @param bytes The record, which must be 8 bytes aligned (mmap'd and malloc'd buffers always are).
+ @param length The number of readable bytes.
+
+ */
+
++ (instancetype)adWithAdRecordBytes:(const void *)bytes length:(size_t)length;
+
++ (instancetype)adWithAdRecord:(const AdRecordHeader *)record;
+
+@end
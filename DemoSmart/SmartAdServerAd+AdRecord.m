@@ -0,0 +1,238 @@
+//
+//  SmartAdServerAd+AdRecord.m
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import "SmartAdServerAd+AdRecord.h"
+
+#include <string.h>
+
+static int AdRecordSetObject(AdRecordBuilder *builder, AdRecordString field, id object)
+{
+    NSString *string = [object isKindOfClass:[NSURL class]] ? [object absoluteString] : object;
+    const char *bytes = [string UTF8String];
+    return AdRecordBuilderSetString(builder, field, bytes, bytes ? strlen(bytes) : 0);
+}
+
+static int AdRecordAddList(AdRecordBuilder *builder, AdRecordList list, NSArray *items)
+{
+    for (id item in items) {
+        NSString *string = [item isKindOfClass:[NSURL class]] ? [item absoluteString] : [item description];
+        const char *bytes = [string UTF8String];
+        if (bytes == NULL || AdRecordBuilderAddListItem(builder, list, bytes, strlen(bytes)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static BOOL AdRecordGetColor(UIColor *color, float rgba[4])
+{
+    CGFloat r, g, b, a, w;
+
+    if (color == nil) {
+        return NO;
+    }
+    if ([color getRed:&r green:&g blue:&b alpha:&a]) {
+        rgba[0] = r; rgba[1] = g; rgba[2] = b; rgba[3] = a;
+        return YES;
+    }
+    if ([color getWhite:&w alpha:&a]) {
+        rgba[0] = rgba[1] = rgba[2] = w; rgba[3] = a;
+        return YES;
+    }
+    return NO;
+}
+
+static NSString *AdRecordStringFromSlice(AdRecordSlice slice)
+{
+    if (slice.bytes == NULL) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:slice.bytes length:slice.length encoding:NSUTF8StringEncoding];
+}
+
+static NSURL *AdRecordURLFromSlice(AdRecordSlice slice)
+{
+    NSString *string = AdRecordStringFromSlice(slice);
+    return string ? [NSURL URLWithString:string] : nil;
+}
+
+static NSArray *AdRecordItemsFromList(const AdRecordHeader *record, AdRecordList list, BOOL strings)
+{
+    uint32_t count = AdRecordGetListCount(record, list);
+    NSMutableArray *items;
+    uint32_t i;
+
+    if (count == 0) {
+        return nil;
+    }
+    items = [NSMutableArray arrayWithCapacity:count];
+    for (i = 0; i < count; i++) {
+        AdRecordSlice slice = AdRecordGetListItem(record, list, i);
+        id item = strings ? AdRecordStringFromSlice(slice) : AdRecordURLFromSlice(slice);
+        if (item) {
+            [items addObject:item];
+        }
+    }
+    return items;
+}
+
+@implementation SmartAdServerAd (AdRecord)
+
+- (const void *)writeAdRecordWithBuilder:(AdRecordBuilder *)builder length:(size_t *)length
+{
+    AdRecordHeader *header;
+    uint32_t flags = 0;
+    int failed = 0;
+
+    AdRecordBuilderReset(builder);
+    header = AdRecordBuilderGetHeader(builder);
+
+    header->insertionId = self.insertionId;
+    if (self.expirationDate) {
+        header->expirationDate = [self.expirationDate timeIntervalSince1970];
+        flags |= AdRecordFlagHasExpirationDate;
+    }
+    header->duration = self.duration;
+    header->creativeType = self.creativeType;
+    header->skipPosition = self.skipPosition;
+    header->expandedHeight = self.expandedHeight;
+    header->expandedLandscapeHeight = self.expandedLandscapeHeight;
+    header->triggerHeight = self.triggerHeight;
+    header->triggerLandscapeHeight = self.triggerLandscapeHeight;
+    header->imageSize[0] = self.imageSize.width;
+    header->imageSize[1] = self.imageSize.height;
+    header->landscapeImageSize[0] = self.landscapeImageSize.width;
+    header->landscapeImageSize[1] = self.landscapeImageSize.height;
+    header->videoSize[0] = self.videoSize.width;
+    header->videoSize[1] = self.videoSize.height;
+
+    if (AdRecordGetColor(self.backgroundColor, header->backgroundColor)) flags |= AdRecordFlagHasBackgroundColor;
+    if (AdRecordGetColor(self.textColor, header->textColor))             flags |= AdRecordFlagHasTextColor;
+    if (self.expandedAtInit)                    flags |= AdRecordFlagExpandedAtInit;
+    if (self.expand)                            flags |= AdRecordFlagExpand;
+    if (self.navigationHasControls)             flags |= AdRecordFlagNavigationHasControls;
+    if (self.fromTop)                           flags |= AdRecordFlagFromTop;
+    if (self.transparentBackground)             flags |= AdRecordFlagTransparentBackground;
+    if (self.askConfirmationBeforeClosingApp)   flags |= AdRecordFlagAskConfirmationBeforeClosingApp;
+    if (self.videoAutoPlay)                     flags |= AdRecordFlagVideoAutoPlay;
+    if (self.skip)                              flags |= AdRecordFlagSkip;
+    if (self.redirectsToThirdParty)             flags |= AdRecordFlagRedirectsToThirdParty;
+    if (self.isSkipPositionDefined)             flags |= AdRecordFlagIsSkipPositionDefined;
+    if (self.isOffline)                         flags |= AdRecordFlagIsOffline;
+    if (self.isConnectionNeeded)                flags |= AdRecordFlagIsConnectionNeeded;
+    if (self.addStandardTrigger)                flags |= AdRecordFlagAddStandardTrigger;
+    if ([[self.agencyPortraitPixels lastObject] isKindOfClass:[NSString class]]
+        || [[self.agencyLandscapePixels lastObject] isKindOfClass:[NSString class]]) {
+        flags |= AdRecordFlagAgencyPixelsAreStrings;
+    }
+    header->flags = flags;
+
+    failed |= AdRecordSetObject(builder, AdRecordStringCreativeURL, self.creativeURL);
+    failed |= AdRecordSetObject(builder, AdRecordStringCreativeLandscapeURL, self.creativeLandscapeUrl);
+    failed |= AdRecordSetObject(builder, AdRecordStringRedirectURL, self.redirectURL);
+    failed |= AdRecordSetObject(builder, AdRecordStringRedirectLandscapeURL, self.redirectLandscapeURL);
+    failed |= AdRecordSetObject(builder, AdRecordStringCountURL, self.countURL);
+    failed |= AdRecordSetObject(builder, AdRecordStringCountLandscapeURL, self.countLandscapeURL);
+    failed |= AdRecordSetObject(builder, AdRecordStringImpPixel, self.impPixel);
+    failed |= AdRecordSetObject(builder, AdRecordStringImpLandscapePixel, self.impLandscapePixel);
+    failed |= AdRecordSetObject(builder, AdRecordStringText, self.text);
+    failed |= AdRecordSetObject(builder, AdRecordStringCreativeScript, self.creativeScript);
+    failed |= AdRecordSetObject(builder, AdRecordStringCreativeScriptURL, self.creativeScriptURL);
+    failed |= AdRecordAddList(builder, AdRecordListAgencyPortraitPixels, self.agencyPortraitPixels);
+    failed |= AdRecordAddList(builder, AdRecordListAgencyLandscapePixels, self.agencyLandscapePixels);
+
+    if (failed) {
+        return NULL;
+    }
+    return AdRecordBuilderFinish(builder, length);
+}
+
+- (NSData *)adRecordData
+{
+    AdRecordBuilder *builder = AdRecordBuilderCreate();
+    NSData *data = nil;
+    const void *bytes;
+    size_t length;
+
+    if (builder == NULL) {
+        return nil;
+    }
+    bytes = [self writeAdRecordWithBuilder:builder length:&length];
+    if (bytes) {
+        data = [NSData dataWithBytes:bytes length:length];
+    }
+    AdRecordBuilderRelease(builder);
+    return data;
+}
+
++ (instancetype)adWithAdRecordBytes:(const void *)bytes length:(size_t)length
+{
+    const AdRecordHeader *record = AdRecordValidate(bytes, length);
+    return record ? [self adWithAdRecord:record] : nil;
+}
+
++ (instancetype)adWithAdRecord:(const AdRecordHeader *)record
+{
+    SmartAdServerAd *ad = [[self alloc] init];
+    uint32_t flags = record->flags;
+
+    ad.insertionId = (NSInteger)record->insertionId;
+    if (flags & AdRecordFlagHasExpirationDate) {
+        ad.expirationDate = [NSDate dateWithTimeIntervalSince1970:record->expirationDate];
+    }
+    ad.duration = record->duration;
+    ad.creativeType = record->creativeType;
+    ad.skipPosition = record->skipPosition;
+    ad.expandedHeight = record->expandedHeight;
+    ad.expandedLandscapeHeight = record->expandedLandscapeHeight;
+    ad.triggerHeight = record->triggerHeight;
+    ad.triggerLandscapeHeight = record->triggerLandscapeHeight;
+    ad.imageSize = CGSizeMake(record->imageSize[0], record->imageSize[1]);
+    ad.landscapeImageSize = CGSizeMake(record->landscapeImageSize[0], record->landscapeImageSize[1]);
+    ad.videoSize = CGSizeMake(record->videoSize[0], record->videoSize[1]);
+
+    if (flags & AdRecordFlagHasBackgroundColor) {
+        const float *c = record->backgroundColor;
+        ad.backgroundColor = [UIColor colorWithRed:c[0] green:c[1] blue:c[2] alpha:c[3]];
+    }
+    if (flags & AdRecordFlagHasTextColor) {
+        const float *c = record->textColor;
+        ad.textColor = [UIColor colorWithRed:c[0] green:c[1] blue:c[2] alpha:c[3]];
+    }
+    ad.expandedAtInit = (flags & AdRecordFlagExpandedAtInit) != 0;
+    ad.expand = (flags & AdRecordFlagExpand) != 0;
+    ad.navigationHasControls = (flags & AdRecordFlagNavigationHasControls) != 0;
+    ad.fromTop = (flags & AdRecordFlagFromTop) != 0;
+    ad.transparentBackground = (flags & AdRecordFlagTransparentBackground) != 0;
+    ad.askConfirmationBeforeClosingApp = (flags & AdRecordFlagAskConfirmationBeforeClosingApp) != 0;
+    ad.videoAutoPlay = (flags & AdRecordFlagVideoAutoPlay) != 0;
+    ad.skip = (flags & AdRecordFlagSkip) != 0;
+    ad.redirectsToThirdParty = (flags & AdRecordFlagRedirectsToThirdParty) != 0;
+    ad.isSkipPositionDefined = (flags & AdRecordFlagIsSkipPositionDefined) != 0;
+    ad.isOffline = (flags & AdRecordFlagIsOffline) != 0;
+    ad.isConnectionNeeded = (flags & AdRecordFlagIsConnectionNeeded) != 0;
+    ad.addStandardTrigger = (flags & AdRecordFlagAddStandardTrigger) != 0;
+
+    ad.creativeURL = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringCreativeURL));
+    ad.creativeLandscapeUrl = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringCreativeLandscapeURL));
+    ad.redirectURL = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringRedirectURL));
+    ad.redirectLandscapeURL = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringRedirectLandscapeURL));
+    ad.countURL = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringCountURL));
+    ad.countLandscapeURL = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringCountLandscapeURL));
+    ad.impPixel = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringImpPixel));
+    ad.impLandscapePixel = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringImpLandscapePixel));
+    ad.text = AdRecordStringFromSlice(AdRecordGetString(record, AdRecordStringText));
+    ad.creativeScript = AdRecordStringFromSlice(AdRecordGetString(record, AdRecordStringCreativeScript));
+    ad.creativeScriptURL = AdRecordURLFromSlice(AdRecordGetString(record, AdRecordStringCreativeScriptURL));
+    ad.agencyPortraitPixels = AdRecordItemsFromList(record, AdRecordListAgencyPortraitPixels, (flags & AdRecordFlagAgencyPixelsAreStrings) != 0);
+    ad.agencyLandscapePixels = AdRecordItemsFromList(record, AdRecordListAgencyLandscapePixels, (flags & AdRecordFlagAgencyPixelsAreStrings) != 0);
+
+    return ad;
+}
+
+@end
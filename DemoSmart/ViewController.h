@@ -17,4 +17,15 @@
 
 @property (nonatomic, retain) SASInterstitialView *myInterstitial;
 
+/** Displays the interstitial of the page in the container, from the offline cache when possible.
+
+ A cached ad is displayed at once, while an ad call in the background replaces it in the cache for the next launch.
+
+ Called during the launch, before the window is made visible, so that the ad call runs while the
+ view hierarchy is set up.
+
+ */
+
+- (void)loadInterstitialInView:(UIView *)container;
+
 @end
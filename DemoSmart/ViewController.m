@@ -7,8 +7,35 @@
 //
 
 #import "ViewController.h"
+#import "AdConnectionWarmer.h"
+#import "AdCreativePipeline.h"
+#import "AdDeadlineLoader.h"
+#import "AdHTMLPreprocessor.h"
+#import "AdLifecycleMetrics.h"
+#import "AdLocalizedStrings.h"
+#import "AdLog.h"
+#import "AdMRAIDBridge.h"
+#import "AdMemoryMonitor.h"
+#import "AdPageCoordinator.h"
+#import "AdPlacementBreaker.h"
+#import "AdVideoPrefetcher.h"
+#import "AdViewPool.h"
+#import "LaunchProfiler.h"
+#import "OfflineAdCache.h"
 
-@interface ViewController ()
+static const NSInteger kInterstitialFormatId = 13534;
+static NSString * const kInterstitialPageId = @"374408";
+static const NSTimeInterval kInterstitialBudget = 2.5;
+
+@interface ViewController () <UIAlertViewDelegate>
+{
+    AdDeadlineLoader *_interstitialLoader;
+    SASInterstitialView *_refreshView;  // the call replacing a displayed cached ad, never on screen
+    SmartAdServerAd *_interstitialAd;   // the ad of _interstitial, once known
+    SmartAdServerAd *_replacedAd;       // replaced in the cache while displayed, its creatives released once it disappears
+    AdMRAIDBridge *_interstitialBridge;
+    NSURL *_confirmedURL;               // opened if the user confirms leaving the app
+}
 
 @end
 
@@ -18,20 +45,231 @@
 {
     [super viewDidLoad];
 	// Do any additional setup after loading the view, typically from a nib.
+}
+
+- (void)loadInterstitialInView:(UIView *)container
+{
+    SmartAdServerAd *cachedAd = [[OfflineAdCache sharedCache] peekAdForFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil];
+    __weak ViewController *weakSelf = self;
+    AdDeadlineLoaderViewFactory factory = ^SASAdView *{
+        SASInterstitialView *interstitial = (SASInterstitialView *)[[AdViewPool sharedPool] dequeueViewOfClass:[SASInterstitialView class] frame:container.bounds
+                                                                                                         loader:SASLoaderActivityIndicatorStyleBlack hideStatusBar:YES];
+        interstitial.delegate = weakSelf;
+        return interstitial;
+    };
     
-    _interstitial = [[SASInterstitialView alloc] initWithFrame:self.navigationController.view.bounds loader:SASLoaderActivityIndicatorStyleBlack hideStatusBar:YES];
-    
-    _interstitial.delegate = self;
-    
-    [_interstitial loadFormatId:13534 pageId:@"374408" master:YES target:nil];
+    // A cached ad whose creative is already stored is displayed right away, without waiting for the network.
+    if (cachedAd && ([[AdCreativePipeline sharedPipeline] hasCreativesForAd:cachedAd] || [[AdVideoPrefetcher sharedPrefetcher] hasCompleteVideoForAd:cachedAd]
+                     || [[AdHTMLPreprocessor sharedPreprocessor] hasDocumentForAd:cachedAd])) {
+        SmartAdServerAd *displayedAd;
+
+        // Counted as a hit of the cache only now that it is displayed.
+        cachedAd = [[OfflineAdCache sharedCache] adForFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil] ?: cachedAd;
+        displayedAd = [[AdVideoPrefetcher sharedPrefetcher] adWithCachedCreative:cachedAd];
+
+        displayedAd = [[AdHTMLPreprocessor sharedPreprocessor] adWithProcessedCreative:displayedAd];
+        _interstitialAd = cachedAd;
+        _interstitial = (SASInterstitialView *)factory();
+        [container addSubview:_interstitial];
+        [[AdLifecycleMetrics sharedMetrics] adView:_interstitial didStartLoadingFormatId:kInterstitialFormatId pageId:kInterstitialPageId];
+        [_interstitial displayThisAd:displayedAd];
+        [[LaunchProfiler sharedProfiler] markPhase:@"cachedInterstitial"];
+        AdLogWrite(AdLogEventCachedAdDisplayed, kInterstitialFormatId, (uint64_t)cachedAd.insertionId, 0, NULL);
+        [self refreshCachedInterstitial];
+        return;
+    }
     
-    [self.navigationController.view addSubview:_interstitial];
+    _interstitialLoader = [[AdDeadlineLoader alloc] initWithFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil budget:kInterstitialBudget];
+    [_interstitialLoader loadInView:container viewFactory:factory];
+    [[LaunchProfiler sharedProfiler] markPhase:@"adCallStarted"];
+}
+
+/** Sends the ad call the cached ad was displayed without, so that the next launch shows a fresher ad.
+
+ Its view is never added to the window: it is discarded once the ad data is stored in the cache.
+
+ */
+- (void)refreshCachedInterstitial
+{
+    if (![[AdPlacementBreaker sharedBreaker] shouldLoadFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil]) {
+        return;
+    }
+    _refreshView = [[SASInterstitialView alloc] initWithFrame:[UIScreen mainScreen].bounds loader:SASLoaderNone hideStatusBar:NO];
+    _refreshView.delegate = self;
+    [[AdPageCoordinator sharedCoordinator] loadAdView:_refreshView formatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil];
+    AdLogWrite(AdLogEventAdCallStarted, kInterstitialFormatId, 0, 0, NULL);
+}
+
+- (void)discardRefreshView
+{
+    [[AdPageCoordinator sharedCoordinator] removeAdView:_refreshView];
+    _refreshView.delegate = nil;
+    [_refreshView dismiss];
+    _refreshView = nil;
+}
+
+/** Keeps the latest ad so it can be shown offline, with its creative ready in the URL cache. */
+- (void)keepAdForOffline:(SmartAdServerAd *)adData
+{
+    SmartAdServerAd *previousAd;
+
+    // Only the first seconds of a video, the rest is fetched while it plays.
+    [[AdVideoPrefetcher sharedPrefetcher] prefetchAd:adData];
+    // Its CDNs are connected to at the next launch, before the ad call returns.
+    [[AdConnectionWarmer sharedWarmer] addHostsOfAd:adData];
+    if (adData.expirationDate == nil) {
+        return;
+    }
+    previousAd = [[OfflineAdCache sharedCache] peekAdForFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil];
+    if (previousAd && previousAd.insertionId != adData.insertionId) {
+        // The creative on screen still loads from the URL cache.
+        if (_interstitial && previousAd.insertionId == _interstitialAd.insertionId) {
+            _replacedAd = previousAd;
+        } else {
+            [[AdCreativePipeline sharedPipeline] releaseCreativesOfAd:previousAd];
+            [[AdHTMLPreprocessor sharedPreprocessor] removeDocumentForAd:previousAd];
+        }
+    }
+    [[OfflineAdCache sharedCache] storeAd:adData formatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil];
+    // The script is taken from the pipeline once stored, then processed with its assets for the next display.
+    [[AdCreativePipeline sharedPipeline] prefetchAd:adData completion:^(BOOL success) {
+        [[AdHTMLPreprocessor sharedPreprocessor] preprocessAd:adData completion:nil];
+    }];
 }
 
 - (void)didReceiveMemoryWarning
 {
     [super didReceiveMemoryWarning];
     // Dispose of any resources that can be recreated.
+    [[AdMemoryMonitor sharedMonitor] didReceiveMemoryWarning];
+}
+
+#pragma mark - SASAdViewDelegate
+
+- (void)adView:(SASAdView *)adView didDownloadAdData:(SmartAdServerAd *)adData
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidDownloadAdData:adView];
+    if (adView == _refreshView) {
+        [[AdPlacementBreaker sharedBreaker] reportOutcome:AdCallFilled forFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil];
+        AdLogWrite(AdLogEventAdDataReceived, kInterstitialFormatId, (uint64_t)adData.insertionId, 0, NULL);
+        [self discardRefreshView];
+        [self keepAdForOffline:adData];
+        return;
+    }
+    if (![_interstitialLoader adView:adView didDownloadAdData:adData]) {
+        return;
+    }
+    AdLogWrite(AdLogEventAdDataReceived, kInterstitialFormatId, (uint64_t)adData.insertionId, 0, NULL);
+    _interstitialAd = adData;
+    [self keepAdForOffline:adData];
+}
+
+- (void)adViewDidLoad:(SASAdView *)adView
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidLoad:adView];
+    if ([_interstitialLoader adViewDidLoad:adView]) {
+        _interstitial = (SASInterstitialView *)adView;
+        AdLogWrite(AdLogEventAdLoaded, kInterstitialFormatId, 0, 0, NULL);
+    }
+    if (adView == _interstitial && _interstitialAd) {
+        [[AdVideoPrefetcher sharedPrefetcher] adDidStartPlaying:_interstitialAd];
+    }
+    // The state of the ad is pushed to an HTML creative once per frame, instead of answering each of its calls.
+    if (adView == _interstitial && _interstitialBridge == nil) {
+        __weak ViewController *weakSelf = self;
+
+        _interstitialBridge = [[AdMRAIDBridge alloc] initWithWebView:[AdMRAIDBridge webViewInView:adView]];
+        [_interstitialBridge setHandler:^NSString *(NSString *argument) {
+            [weakSelf openCreativeURL:[NSURL URLWithString:argument]];
+            return nil;
+        } forMethod:@"open"];
+    }
+}
+
+- (void)adView:(SASAdView *)adView didFailToLoadWithError:(NSError *)error
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidFailToLoad:adView];
+    if (adView == _refreshView) {
+        [[AdPlacementBreaker sharedBreaker] reportError:error forFormatId:kInterstitialFormatId pageId:kInterstitialPageId target:nil];
+        [self discardRefreshView];
+        return;
+    }
+    if ([_interstitialLoader adView:adView didFailToLoadWithError:error]) {
+        AdLogWrite(AdLogEventAdFailed, kInterstitialFormatId, (uint64_t)[error code], 0, [[error localizedDescription] UTF8String]);
+    }
 }
 
-@end
\ No newline at end of file
+- (void)adViewDidDisappear:(SASAdView *)adView
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidDisappear:adView];
+    if (adView == _interstitial) {
+        if (_interstitialAd) {
+            [[AdVideoPrefetcher sharedPrefetcher] adDidStopPlaying:_interstitialAd];
+            _interstitialAd = nil;
+        }
+        if (_replacedAd) {
+            [[AdCreativePipeline sharedPipeline] releaseCreativesOfAd:_replacedAd];
+            [[AdHTMLPreprocessor sharedPreprocessor] removeDocumentForAd:_replacedAd];
+            _replacedAd = nil;
+        }
+        [_interstitialBridge invalidate];
+        _interstitialBridge = nil;
+        _interstitial = nil;
+        [[AdViewPool sharedPool] recycleView:adView];
+    }
+}
+
+- (void)adView:(SASAdView *)adView didExpandWithFrame:(CGRect)frame
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidExpand:adView];
+    [_interstitialBridge setNeedsUpdate];
+}
+
+- (void)adView:(SASAdView *)adView didCloseExpandWithFrame:(CGRect)frame
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidCloseExpand:adView];
+    [_interstitialBridge setNeedsUpdate];
+}
+
+- (void)adView:(SASAdView *)adView didResizeWithFrame:(CGRect)frame
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidResize:adView];
+    [_interstitialBridge setNeedsUpdate];
+}
+
+- (void)adView:(SASAdView *)adView didCloseResizeWithFrame:(CGRect)frame
+{
+    [[AdLifecycleMetrics sharedMetrics] adViewDidCloseResize:adView];
+}
+
+#pragma mark - Creative URLs
+
+/** Opens a URL of the creative, asking first when the ad wants a confirmation before leaving the app. */
+- (void)openCreativeURL:(NSURL *)URL
+{
+    AdLocalizedStrings *strings = [AdLocalizedStrings sharedStrings];
+
+    if (URL == nil) {
+        return;
+    }
+    if (!_interstitialAd.askConfirmationBeforeClosingApp) {
+        [[UIApplication sharedApplication] openURL:URL];
+        return;
+    }
+    _confirmedURL = URL;
+    [[[UIAlertView alloc] initWithTitle:[strings stringForKey:@"Leave Application?"]
+                                message:[strings stringForKey:@"Do you want to leave this application to open the advertisement?"]
+                               delegate:self cancelButtonTitle:[strings stringForKey:@"No"] otherButtonTitles:[strings stringForKey:@"Yes"], nil] show];
+}
+
+#pragma mark - UIAlertViewDelegate
+
+- (void)alertView:(UIAlertView *)alertView clickedButtonAtIndex:(NSInteger)buttonIndex
+{
+    if (buttonIndex != alertView.cancelButtonIndex && _confirmedURL) {
+        [[UIApplication sharedApplication] openURL:_confirmedURL];
+    }
+    _confirmedURL = nil;
+}
+
+@end
@@ -0,0 +1,200 @@
+//
+//  AdBenchmark.c
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdBenchmark.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+#define kAdBenchmarkMaxRepetitions 256
+
+const AdBenchmarkOptions AdBenchmarkDefaultOptions = { 0, 3, 15 };
+
+volatile uint64_t AdBenchmarkSink;
+
+void AdBenchmarkConsume(uint64_t value)
+{
+    AdBenchmarkSink += value;
+}
+
+static uint64_t AdBenchmarkNow(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/** Two-sided 97.5% quantile of Student's t distribution for the degrees of freedom. */
+static double AdBenchmarkStudentT(unsigned degrees)
+{
+    static const double table[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+
+    if (degrees < sizeof(table) / sizeof(table[0])) {
+        return table[degrees];
+    }
+    return degrees < 60 ? 2.000 : degrees < 120 ? 1.980 : 1.960;
+}
+
+static int AdBenchmarkCompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double AdBenchmarkTime(AdBenchmarkFunction function, void *context, uint64_t iterations)
+{
+    uint64_t start = AdBenchmarkNow();
+    function(context, iterations);
+    return (double)(AdBenchmarkNow() - start);
+}
+
+AdBenchmarkResult AdBenchmarkRun(const char *name, AdBenchmarkFunction function, void *context, const AdBenchmarkOptions *options)
+{
+    AdBenchmarkResult result;
+    double samples[kAdBenchmarkMaxRepetitions];
+    double sum = 0, squares = 0;
+    uint64_t iterations;
+    unsigned repetitions;
+
+    if (options == NULL) {
+        options = &AdBenchmarkDefaultOptions;
+    }
+    repetitions = options->repetitions < 2 ? 2 : options->repetitions > kAdBenchmarkMaxRepetitions ? kAdBenchmarkMaxRepetitions : options->repetitions;
+
+    // Doubles the iterations until a repetition lasts long enough for the clock to be precise.
+    iterations = options->iterations;
+    if (iterations == 0) {
+        iterations = 1;
+        while (AdBenchmarkTime(function, context, iterations) < kAdBenchmarkTargetTime * 1e9 && iterations < (UINT64_C(1) << 40)) {
+            iterations *= 2;
+        }
+    }
+    for (unsigned i = 0; i < options->warmups; i++) {
+        AdBenchmarkTime(function, context, iterations);
+    }
+    for (unsigned i = 0; i < repetitions; i++) {
+        samples[i] = AdBenchmarkTime(function, context, iterations) / iterations;
+        sum += samples[i];
+    }
+
+    memset(&result, 0, sizeof(result));
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    result.iterations = iterations;
+    result.repetitions = repetitions;
+    result.mean = sum / repetitions;
+    for (unsigned i = 0; i < repetitions; i++) {
+        squares += (samples[i] - result.mean) * (samples[i] - result.mean);
+    }
+    result.stddev = sqrt(squares / (repetitions - 1));
+    result.ci95 = AdBenchmarkStudentT(repetitions - 1) * result.stddev / sqrt(repetitions);
+    qsort(samples, repetitions, sizeof(double), AdBenchmarkCompareDoubles);
+    result.min = samples[0];
+    result.median = repetitions % 2 ? samples[repetitions / 2] : (samples[repetitions / 2 - 1] + samples[repetitions / 2]) / 2;
+    return result;
+}
+
+// Output
+
+void AdBenchmarkPrint(FILE *output, const AdBenchmarkResult *result)
+{
+    fprintf(output, "%-40s %12.1f ns/op  +- %-8.1f median %-10.1f min %-10.1f (%llu x %u)", result->name, result->mean,
+            result->ci95, result->median, result->min, (unsigned long long)result->iterations, result->repetitions);
+    if (result->bytes > 0 && result->mean > 0) {
+        fprintf(output, "  %.1f MB/s, %.0f op/s", result->bytes * 1e3 / result->mean, 1e9 / result->mean);
+    }
+    fprintf(output, "\n");
+}
+
+void AdBenchmarkWriteJSON(FILE *output, const char *suite, const AdBenchmarkResult *results, size_t count)
+{
+    fprintf(output, "{\"suite\": \"%s\", \"unit\": \"ns/op\", \"results\": [\n", suite);
+    for (size_t i = 0; i < count; i++) {
+        const AdBenchmarkResult *result = &results[i];
+        fprintf(output, "{\"name\": \"%s\", \"mean\": %.3f, \"median\": %.3f, \"stddev\": %.3f, \"ci95\": %.3f, \"min\": %.3f, "
+                "\"iterations\": %llu, \"repetitions\": %u, \"bytes\": %llu}%s\n", result->name, result->mean, result->median, result->stddev,
+                result->ci95, result->min, (unsigned long long)result->iterations, result->repetitions, (unsigned long long)result->bytes,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(output, "]}\n");
+}
+
+long AdBenchmarkReadJSON(const char *path, AdBenchmarkResult *results, size_t capacity)
+{
+    FILE *file = fopen(path, "r");
+    char line[512];
+    long count = 0;
+
+    if (file == NULL) {
+        return -1;
+    }
+    // Only reads back the layout written above, a result per line.
+    while (fgets(line, sizeof(line), file) && (size_t)count < capacity) {
+        AdBenchmarkResult *result = &results[count];
+        unsigned long long iterations, bytes = 0;
+
+        memset(result, 0, sizeof(AdBenchmarkResult));
+        if (sscanf(line, "{\"name\": \"%63[^\"]\", \"mean\": %lf, \"median\": %lf, \"stddev\": %lf, \"ci95\": %lf, \"min\": %lf, "
+                   "\"iterations\": %llu, \"repetitions\": %u, \"bytes\": %llu}", result->name, &result->mean, &result->median,
+                   &result->stddev, &result->ci95, &result->min, &iterations, &result->repetitions, &bytes) >= 8) {
+            result->iterations = iterations;
+            result->bytes = bytes;
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+unsigned AdBenchmarkCompare(FILE *output, const AdBenchmarkResult *results, size_t count,
+                            const AdBenchmarkResult *baseline, size_t baselineCount, double threshold)
+{
+    unsigned regressions = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const AdBenchmarkResult *result = &results[i];
+
+        for (size_t j = 0; j < baselineCount; j++) {
+            const AdBenchmarkResult *before = &baseline[j];
+            double change, slowdown;
+            const char *verdict = "";
+
+            if (strcmp(result->name, before->name) != 0 || before->mean <= 0) {
+                continue;
+            }
+            change = (result->mean - before->mean) / before->mean;
+            slowdown = result->mean - before->mean;
+            if (change > threshold && slowdown > result->ci95 + before->ci95) {
+                verdict = "  REGRESSION";
+                regressions++;
+            } else if (-change > threshold && -slowdown > result->ci95 + before->ci95) {
+                verdict = "  improvement";
+            }
+            fprintf(output, "%-40s %12.1f -> %-12.1f %+6.1f%%%s\n", result->name, before->mean, result->mean, change * 100, verdict);
+            break;
+        }
+    }
+    return regressions;
+}
@@ -0,0 +1,73 @@
+//
+//  AdBenchmark.h
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Micro-benchmark harness.
+
+ A benchmark is a function running an operation a given number of times. The harness first
+ calibrates that number so that one repetition lasts about kAdBenchmarkTargetTime, runs warmup
+ repetitions that are thrown away, then times the repetitions and reports the time per operation:
+ mean, median, standard deviation and the half width of the 95% confidence interval of the mean
+ (Student's t), so that two runs can be told apart from noise.
+
+ Results are written as JSON, one result per line, and AdBenchmarkCompare reads a previous run
+ back to flag regressions. This file is plain C and builds on Linux, see tools/adbench.c.
+ */
+
+#ifndef DemoSmartTests_AdBenchmark_h
+#define DemoSmartTests_AdBenchmark_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define kAdBenchmarkTargetTime      0.01    /* seconds per repetition */
+#define kAdBenchmarkNameLength      64
+
+typedef void (*AdBenchmarkFunction)(void *context, uint64_t iterations);
+
+typedef struct {
+    uint64_t iterations;    /* operations per repetition, 0 to calibrate */
+    unsigned warmups;
+    unsigned repetitions;
+} AdBenchmarkOptions;
+
+typedef struct {
+    char name[kAdBenchmarkNameLength];
+    uint64_t iterations;
+    unsigned repetitions;
+    double mean;            /* nanoseconds per operation */
+    double median;
+    double stddev;
+    double ci95;            /* the mean is within mean +- ci95 with 95% confidence */
+    double min;
+    uint64_t bytes;         /* processed per operation, for a throughput, 0 when not relevant */
+} AdBenchmarkResult;
+
+/** 3 warmups and 15 repetitions of a calibrated number of iterations. */
+extern const AdBenchmarkOptions AdBenchmarkDefaultOptions;
+
+AdBenchmarkResult AdBenchmarkRun(const char *name, AdBenchmarkFunction function, void *context, const AdBenchmarkOptions *options);
+
+/** Prints a result as one aligned line of text, with the throughput in MB/s when the result has bytes. */
+void AdBenchmarkPrint(FILE *output, const AdBenchmarkResult *result);
+
+void AdBenchmarkWriteJSON(FILE *output, const char *suite, const AdBenchmarkResult *results, size_t count);
+
+/** Reads results written by AdBenchmarkWriteJSON. Returns the number of results, or -1 if the file cannot be read. */
+long AdBenchmarkReadJSON(const char *path, AdBenchmarkResult *results, size_t capacity);
+
+/** Prints the change of each result against the baseline result of the same name. A slowdown is a regression
+ when it exceeds both the threshold (0.05 for 5%) and the confidence intervals. Returns the number of regressions. */
+unsigned AdBenchmarkCompare(FILE *output, const AdBenchmarkResult *results, size_t count,
+                            const AdBenchmarkResult *baseline, size_t baselineCount, double threshold);
+
+/** Keeps the compiler from removing the computation of a value. */
+void AdBenchmarkConsume(uint64_t value);
+
+#endif
@@ -0,0 +1,136 @@
+//
+//  AdBlobStoreTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdBlobStore.h"
+
+static NSString *AdBlobTestHashString(NSData *data)
+{
+    AdBlobHash hash;
+    char string[kAdBlobHashStringLength];
+
+    AdBlobHashCompute(data.bytes, data.length, &hash);
+    AdBlobHashGetString(&hash, string);
+    return @(string);
+}
+
+@interface AdBlobStoreTests : XCTestCase
+{
+    NSString *_directory;
+    AdBlobStore *_store;
+}
+
+@end
+
+@implementation AdBlobStoreTests
+
+- (void)setUp
+{
+    [super setUp];
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL]);
+    _store = AdBlobStoreOpen(_directory.fileSystemRepresentation);
+    XCTAssert(_store != NULL);
+}
+
+- (void)tearDown
+{
+    AdBlobStoreClose(_store);
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:NULL];
+    [super tearDown];
+}
+
+- (void)testHashMatchesTheSHA256Vectors
+{
+    XCTAssertEqualObjects(AdBlobTestHashString([NSData data]), @"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    XCTAssertEqualObjects(AdBlobTestHashString([@"abc" dataUsingEncoding:NSASCIIStringEncoding]),
+                          @"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    XCTAssertEqualObjects(AdBlobTestHashString([@"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq" dataUsingEncoding:NSASCIIStringEncoding]),
+                          @"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+- (void)testIdenticalContentIsStoredOnce
+{
+    const char creative[] = "<html><body>creative</body></html>";
+    AdBlobHash first, second;
+
+    XCTAssertEqual(AdBlobStorePut(_store, "http://cdn-a/creative.html", NULL, creative, sizeof(creative), &first), 0);
+    XCTAssertEqual(AdBlobStorePut(_store, "http://cdn-b/creative.html?insertion=2", NULL, creative, sizeof(creative), &second), 0);
+    XCTAssertEqual(memcmp(&first, &second, sizeof(first)), 0);
+
+    AdBlobStoreStatistics statistics = AdBlobStoreGetStatistics(_store);
+    XCTAssertEqual(statistics.blobCount, 1u);
+    XCTAssertEqual(statistics.URLCount, 2u);
+    XCTAssertEqual(statistics.storedBytes, (uint64_t)sizeof(creative));
+    XCTAssertEqual(statistics.logicalBytes, (uint64_t)(2 * sizeof(creative)));
+    XCTAssertEqual(statistics.dedupedPuts, (uint64_t)1);
+
+    char path[1024];
+    XCTAssertEqual(AdBlobStoreGetPath(_store, &first, path, sizeof(path)), 0);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:@(path)], [NSData dataWithBytes:creative length:sizeof(creative)]);
+}
+
+- (void)testKnownURLsAreRevalidatedWithTheirETag
+{
+    const char image[] = "GIF89a";
+    AdBlobHash stored, found;
+    const char *etag = NULL;
+
+    XCTAssertEqual(AdBlobStoreLookupURL(_store, "http://cdn/image.gif", &found, &etag), -1);
+    XCTAssertEqual(AdBlobStorePut(_store, "http://cdn/image.gif", "\"v1\"", image, sizeof(image), &stored), 0);
+    XCTAssertEqual(AdBlobStoreLookupURL(_store, "http://cdn/image.gif", &found, &etag), 0);
+    XCTAssertEqual(strcmp(etag, "\"v1\""), 0);
+    XCTAssertEqual(memcmp(&stored, &found, sizeof(found)), 0);
+
+    XCTAssertEqual(AdBlobStoreRevalidated(_store, "http://cdn/image.gif", &found), 0);
+    XCTAssertEqual(AdBlobStoreRevalidated(_store, "http://cdn/other.gif", &found), -1);
+    XCTAssertEqual(AdBlobStoreGetStatistics(_store).revalidatedBytes, (uint64_t)sizeof(image));
+}
+
+- (void)testBlobsStayUntilTheLastOwnerReleasesThem
+{
+    const char video[] = "ftypmp42";
+    AdBlobHash hash;
+
+    XCTAssertEqual(AdBlobStorePut(_store, "http://cdn/video.mp4", NULL, video, sizeof(video), &hash), 0);
+    XCTAssertEqual(AdBlobStoreRetain(_store, &hash, 101), 0);
+    XCTAssertEqual(AdBlobStoreRetain(_store, &hash, 101), 0);
+    XCTAssertEqual(AdBlobStoreRetain(_store, &hash, 102), 0);
+    XCTAssertEqual(AdBlobStoreGetReferenceCount(_store, &hash), 2u, @"One reference per owner");
+
+    XCTAssertEqual(AdBlobStoreReleaseOwner(_store, 101), 1u);
+    XCTAssertEqual(AdBlobStoreCollectGarbage(_store), 0u);
+    XCTAssertEqual(AdBlobStoreRelease(_store, &hash, 102), 0);
+    XCTAssertEqual(AdBlobStoreRelease(_store, &hash, 102), -1);
+    XCTAssertEqual(AdBlobStoreCollectGarbage(_store), 1u);
+
+    XCTAssertEqual(AdBlobStoreGetStatistics(_store).blobCount, 0u);
+    XCTAssertEqual(AdBlobStoreGetStatistics(_store).URLCount, 0u, @"The URLs go with their blob");
+    XCTAssertEqual(AdBlobStoreLookupURL(_store, "http://cdn/video.mp4", &hash, NULL), -1);
+}
+
+- (void)testReopeningReplaysTheJournal
+{
+    const char script[] = "mraid.js";
+    AdBlobHash hash;
+    const char *etag = NULL;
+
+    XCTAssertEqual(AdBlobStorePut(_store, "http://cdn/mraid.js", "W/\"7\"", script, sizeof(script), &hash), 0);
+    XCTAssertEqual(AdBlobStoreRetain(_store, &hash, 7), 0);
+    AdBlobStoreClose(_store);
+
+    _store = AdBlobStoreOpen(_directory.fileSystemRepresentation);
+    XCTAssert(_store != NULL);
+    XCTAssertEqual(AdBlobStoreLookupURL(_store, "http://cdn/mraid.js", &hash, &etag), 0);
+    XCTAssertEqual(strcmp(etag, "W/\"7\""), 0);
+    XCTAssertEqual(AdBlobStoreGetReferenceCount(_store, &hash), 1u);
+    XCTAssertEqual(AdBlobStoreCollectGarbage(_store), 0u);
+}
+
+@end
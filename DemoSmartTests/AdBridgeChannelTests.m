@@ -0,0 +1,129 @@
+//
+//  AdBridgeChannelTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdBridgeChannel.h"
+
+static int AdBridgeTestHandleCall(void *info, uint32_t callId, const char *method, const char *argument, char *result, size_t capacity)
+{
+    NSMutableArray *calls = (__bridge NSMutableArray *)info;
+
+    [calls addObject:[NSString stringWithFormat:@"%u %s %s", callId, method, argument]];
+    if (strcmp(method, "open") == 0) {
+        return 0;
+    }
+    snprintf(result, capacity, "\"%s\"\n", method);
+    return 1;
+}
+
+@interface AdBridgeChannelTests : XCTestCase
+{
+    AdBridgeChannel *_channel;
+    AdBridgeState _state;
+}
+
+@end
+
+@implementation AdBridgeChannelTests
+
+- (void)setUp
+{
+    [super setUp];
+    _channel = AdBridgeChannelCreate();
+    XCTAssert(_channel != NULL);
+    _state = (AdBridgeState){ 320, 480, 0, -1, 100 };
+}
+
+- (void)tearDown
+{
+    AdBridgeChannelRelease(_channel);
+    [super tearDown];
+}
+
+- (NSString *)flush
+{
+    const char *message = AdBridgeChannelFlush(_channel, NULL);
+
+    return message ? @(message) : nil;
+}
+
+- (void)testFirstMessageHasTheWholeStateThenOnlyChanges
+{
+    AdBridgeChannelSetState(_channel, &_state);
+    XCTAssertEqualObjects([self flush], @"{\"seq\":1,\"state\":{\"width\":320,\"height\":480,\"orientation\":0,\"heading\":-1,\"exposure\":100}}");
+    XCTAssertNil([self flush]);
+
+    _state.width = 480;
+    _state.height = 320;
+    _state.orientation = 90;
+    AdBridgeChannelSetState(_channel, &_state);
+    XCTAssert(AdBridgeChannelHasPendingMessage(_channel));
+    XCTAssertEqualObjects([self flush], @"{\"seq\":2,\"state\":{\"width\":480,\"height\":320,\"orientation\":90}}");
+
+    AdBridgeChannelReset(_channel);
+    XCTAssert([[self flush] rangeOfString:@"\"exposure\":100"].location != NSNotFound, @"A reloaded script gets everything again");
+}
+
+- (void)testUpdatesBetweenFlushesAreCoalesced
+{
+    AdBridgeChannelStatistics statistics;
+
+    AdBridgeChannelSetState(_channel, &_state);
+    [self flush];
+    for (int i = 0; i < 10; i++) {
+        _state.exposure = i * 10;
+        AdBridgeChannelSetState(_channel, &_state);
+    }
+    XCTAssertEqualObjects([self flush], @"{\"seq\":2,\"state\":{\"exposure\":90}}");
+    AdBridgeChannelGetStatistics(_channel, &statistics);
+    XCTAssertEqual(statistics.stateUpdates, (uint64_t)11);
+    XCTAssertEqual(statistics.messages, (uint64_t)2);
+}
+
+- (void)testHeadingIsSentPastItsResolution
+{
+    _state.heading = 10.2;
+    AdBridgeChannelSetState(_channel, &_state);
+    [self flush];
+
+    _state.heading = 10.9;
+    AdBridgeChannelSetState(_channel, &_state);
+    XCTAssertFalse(AdBridgeChannelHasPendingMessage(_channel));
+    _state.heading = 11.4;
+    AdBridgeChannelSetState(_channel, &_state);
+    XCTAssertEqualObjects([self flush], @"{\"seq\":2,\"state\":{\"heading\":11}}", @"Small moves add up");
+
+    _state.heading = 359.9;
+    AdBridgeChannelSetState(_channel, &_state);
+    [self flush];
+    _state.heading = 0.5;
+    AdBridgeChannelSetState(_channel, &_state);
+    XCTAssertFalse(AdBridgeChannelHasPendingMessage(_channel), @"359.9 and 0.5 are close");
+}
+
+- (void)testBatchedCallsAreAnsweredInTheNextMessage
+{
+    NSMutableArray *calls = [NSMutableArray array];
+    const char batch[] = "1\tgetHeading\t\n2\topen\thttp%3A%2F%2Fexample.com%2F%3Fa%3D1%26b%3D2\nnot a call\n3\tshare\t%C3%A9t%C3%A9\n";
+    AdBridgeChannelStatistics statistics;
+
+    AdBridgeChannelSetState(_channel, &_state);
+    [self flush];
+    XCTAssertEqual(AdBridgeChannelReceive(_channel, batch, sizeof(batch) - 1, AdBridgeTestHandleCall, (__bridge void *)calls), 3);
+    XCTAssertEqualObjects(calls, (@[@"1 getHeading ", @"2 open http://example.com/?a=1&b=2", @"3 share été"]));
+    XCTAssertEqualObjects([self flush], @"{\"seq\":2,\"results\":[[1,\"\\\"getHeading\\\"\\u000a\"],[3,\"\\\"share\\\"\\u000a\"]]}");
+    XCTAssertNil([self flush]);
+
+    AdBridgeChannelGetStatistics(_channel, &statistics);
+    XCTAssertEqual(statistics.calls, (uint64_t)3);
+    XCTAssertEqual(statistics.malformedCalls, (uint64_t)1);
+    XCTAssertEqual(statistics.results, (uint64_t)2);
+}
+
+@end
@@ -0,0 +1,177 @@
+//
+//  AdCacheTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdCache.h"
+#import "OfflineAdCache.h"
+#import "SmartAdServerAd+AdRecord.h"
+
+#include <stdio.h>
+
+static const int kAdCacheStressCount = 100000;
+
+@interface AdCacheTests : XCTestCase
+{
+    NSString *_directory;
+}
+
+@end
+
+@implementation AdCacheTests
+
+- (void)setUp
+{
+    [super setUp];
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:NULL];
+    [super tearDown];
+}
+
+- (SmartAdServerAd *)adWithInsertionId:(NSInteger)insertionId expiration:(NSTimeInterval)expiration
+{
+    SmartAdServerAd *ad = [[SmartAdServerAd alloc] init];
+    ad.insertionId = insertionId;
+    ad.expirationDate = [NSDate dateWithTimeIntervalSinceNow:expiration];
+    ad.creativeURL = [NSURL URLWithString:[NSString stringWithFormat:@"http://cdn.example.com/%ld.png", (long)insertionId]];
+    return ad;
+}
+
+- (void)testStoreAndLookup
+{
+    OfflineAdCache *cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:0];
+
+    XCTAssertTrue([cache storeAd:[self adWithInsertionId:1 expiration:3600] formatId:13534 pageId:@"374408" target:nil]);
+    XCTAssertTrue([cache storeAd:[self adWithInsertionId:2 expiration:3600] formatId:13534 pageId:@"374408" target:@"age=30"]);
+    XCTAssertEqual([cache adForFormatId:13534 pageId:@"374408" target:nil].insertionId, (NSInteger)1);
+    XCTAssertEqual([cache adForFormatId:13534 pageId:@"374408" target:@"age=30"].insertionId, (NSInteger)2);
+    XCTAssertNil([cache adForFormatId:13535 pageId:@"374408" target:nil]);
+
+    XCTAssertTrue([cache storeAd:[self adWithInsertionId:3 expiration:3600] formatId:13534 pageId:@"374408" target:nil]);
+    XCTAssertEqual([cache adForFormatId:13534 pageId:@"374408" target:nil].insertionId, (NSInteger)3, @"A new ad replaces the previous one");
+
+    [cache removeAdForFormatId:13534 pageId:@"374408" target:@"age=30"];
+    XCTAssertFalse([cache hasAdForFormatId:13534 pageId:@"374408" target:@"age=30"]);
+
+    XCTAssertEqual([cache statistics].hits, (uint64_t)3);
+    XCTAssertEqual([cache statistics].misses, (uint64_t)1, @"An existence check is not counted");
+}
+
+- (void)testPeekIsNotCounted
+{
+    OfflineAdCache *cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:0];
+
+    [cache storeAd:[self adWithInsertionId:1 expiration:3600] formatId:1 pageId:@"p" target:nil];
+    [cache storeAd:[self adWithInsertionId:2 expiration:-5] formatId:2 pageId:@"p" target:nil];
+    XCTAssertEqual([cache peekAdForFormatId:1 pageId:@"p" target:nil].insertionId, (NSInteger)1);
+    XCTAssertNil([cache peekAdForFormatId:2 pageId:@"p" target:nil]);
+    XCTAssertNil([cache peekAdForFormatId:3 pageId:@"p" target:nil]);
+    XCTAssertEqual([cache statistics].hits, (uint64_t)0);
+    XCTAssertEqual([cache statistics].misses, (uint64_t)0);
+    XCTAssertEqual([cache statistics].count, (uint32_t)2, @"A peek leaves the expired ad to the next get or eviction");
+
+    XCTAssertNil([cache adForFormatId:2 pageId:@"p" target:nil]);
+    XCTAssertEqual([cache statistics].misses, (uint64_t)1);
+    XCTAssertEqual([cache statistics].evictions, (uint64_t)1);
+}
+
+- (void)testExpiredAdsAreEvicted
+{
+    OfflineAdCache *cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:0];
+
+    [cache storeAd:[self adWithInsertionId:1 expiration:-10] formatId:1 pageId:@"p" target:nil];
+    [cache storeAd:[self adWithInsertionId:2 expiration:-5] formatId:2 pageId:@"p" target:nil];
+    [cache storeAd:[self adWithInsertionId:3 expiration:3600] formatId:3 pageId:@"p" target:nil];
+
+    XCTAssertEqual([cache evictExpiredAds], (NSUInteger)2);
+    XCTAssertEqual([cache statistics].evictions, (uint64_t)2);
+    XCTAssertEqual([cache statistics].count, (uint32_t)1);
+    XCTAssertNotNil([cache adForFormatId:3 pageId:@"p" target:nil]);
+}
+
+- (void)testEntryLimitEvictsSoonestExpiring
+{
+    OfflineAdCache *cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:2];
+
+    [cache storeAd:[self adWithInsertionId:1 expiration:300] formatId:1 pageId:@"p" target:nil];
+    [cache storeAd:[self adWithInsertionId:2 expiration:100] formatId:2 pageId:@"p" target:nil];
+    [cache storeAd:[self adWithInsertionId:3 expiration:200] formatId:3 pageId:@"p" target:nil];
+
+    XCTAssertFalse([cache hasAdForFormatId:2 pageId:@"p" target:nil]);
+    XCTAssertTrue([cache hasAdForFormatId:1 pageId:@"p" target:nil]);
+    XCTAssertTrue([cache hasAdForFormatId:3 pageId:@"p" target:nil]);
+}
+
+- (void)testReopenKeepsEntries
+{
+    OfflineAdCache *cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:0];
+    [cache storeAd:[self adWithInsertionId:42 expiration:3600] formatId:13534 pageId:@"374408" target:nil];
+    cache = nil;
+
+    cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:0];
+    XCTAssertEqual([cache adForFormatId:13534 pageId:@"374408" target:nil].insertionId, (NSInteger)42);
+}
+
+- (void)testStressBenchmark
+{
+    AdCache *cache = AdCacheOpen([_directory fileSystemRepresentation], 0);
+    AdRecordBuilder *builder = AdRecordBuilderCreate();
+    double now = [[NSDate date] timeIntervalSince1970];
+    CFAbsoluteTime start, put, get, reopen, evict;
+    char pageId[16], URL[64];
+    size_t length;
+    int i, hits = 0;
+
+    XCTAssertTrue(cache != NULL);
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (i = 0; i < kAdCacheStressCount; i++) {
+        const void *record;
+        AdRecordBuilderReset(builder);
+        AdRecordBuilderGetHeader(builder)->insertionId = i;
+        AdRecordBuilderSetString(builder, AdRecordStringCreativeURL, URL, snprintf(URL, sizeof(URL), "http://cdn.example.com/%d.png", i));
+        record = AdRecordBuilderFinish(builder, &length);
+        snprintf(pageId, sizeof(pageId), "%d", i % 1000);
+        AdCachePut(cache, i / 1000, pageId, NULL, record, length, now + i);
+    }
+    put = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (i = 0; i < kAdCacheStressCount; i++) {
+        snprintf(pageId, sizeof(pageId), "%d", i % 1000);
+        if (AdCacheGet(cache, i / 1000, pageId, NULL, now)) {
+            hits++;
+        }
+    }
+    get = CFAbsoluteTimeGetCurrent() - start;
+    XCTAssertEqual(hits, kAdCacheStressCount);
+    AdCacheClose(cache);
+
+    start = CFAbsoluteTimeGetCurrent();
+    cache = AdCacheOpen([_directory fileSystemRepresentation], 0);
+    XCTAssertTrue(AdCacheGet(cache, 99, "999", NULL, now) != NULL, @"Cold-start lookups work without a log scan");
+    reopen = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    XCTAssertEqual(AdCacheEvictExpired(cache, now + kAdCacheStressCount / 2 - 1), (uint32_t)kAdCacheStressCount / 2);
+    evict = CFAbsoluteTimeGetCurrent() - start;
+
+    NSLog(@"AdCache %d ads: put %.0f ns/ad, get %.0f ns/ad, reopen and first get %.2f ms, evict %.0f ns/ad, log %llu bytes",
+          kAdCacheStressCount, put * 1e9 / kAdCacheStressCount, get * 1e9 / kAdCacheStressCount, reopen * 1e3,
+          evict * 2e9 / kAdCacheStressCount, AdCacheGetStatistics(cache).logLength);
+
+    AdCacheClose(cache);
+    AdRecordBuilderRelease(builder);
+}
+
+@end
@@ -0,0 +1,71 @@
+//
+//  AdCallURLTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdCallURL.h"
+
+@interface AdCallURLTests : XCTestCase
+{
+    AdCallURLBuilder *_builder;
+}
+
+@end
+
+@implementation AdCallURLTests
+
+- (void)setUp
+{
+    [super setUp];
+    _builder = AdCallURLBuilderCreate("http://mobile.smartadserver.com", 51901);
+}
+
+- (void)tearDown
+{
+    AdCallURLBuilderRelease(_builder);
+    [super tearDown];
+}
+
+- (void)testURLMatchesStringFormatting
+{
+    AdCallTarget target = AdCallURLBuilderInternTarget(_builder, "age=32;gender=f");
+    AdCallParameters parameters = { 13534, "374408", 1, target, 1790000000000ull, 1, -48.8705699, 2.3034251, 271.55 };
+    NSString *expected = [NSString stringWithFormat:@"http://mobile.smartadserver.com/ac?siteid=51901&pgid=374408&fmtid=13534&visit=M"
+                          "&tmstp=1790000000000&tgt=age%%3D32%%3Bgender%%3Df&lat=%.6f&long=%.6f&hdg=%.1f", -48.8705699, 2.3034251, 271.55];
+    size_t length;
+    const char *URL = AdCallURLBuild(_builder, &parameters, &length);
+
+    XCTAssertEqualObjects(@(URL), expected);
+    XCTAssertEqual(length, strlen(URL));
+    XCTAssertNotNil([NSURL URLWithString:@(URL)]);
+}
+
+- (void)testSlaveCallsWithIdentifierAndNoLocation
+{
+    AdCallParameters parameters = { 13534, "374 408", 0, kAdCallTargetNone, 42, 0, 0, 0, -1 };
+
+    XCTAssertEqual(AdCallURLBuilderSetIdentifier(_builder, "9f86d081"), 0);
+    XCTAssertEqualObjects(@(AdCallURLBuild(_builder, &parameters, NULL)),
+                          @"http://mobile.smartadserver.com/ac?siteid=51901&uid=9f86d081&pgid=374%20408&fmtid=13534&visit=S&tmstp=42");
+}
+
+- (void)testTargetsAreInterned
+{
+    AdCallTarget first = AdCallURLBuilderInternTarget(_builder, "age=32");
+    char target[32];
+
+    XCTAssertEqual(AdCallURLBuilderInternTarget(_builder, NULL), (AdCallTarget)kAdCallTargetNone);
+    XCTAssertEqual(AdCallURLBuilderInternTarget(_builder, ""), (AdCallTarget)kAdCallTargetNone);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(target, sizeof(target), "page=%d", i);
+        XCTAssertEqual(AdCallURLBuilderInternTarget(_builder, target), (AdCallTarget)(i + 2));
+    }
+    XCTAssertEqual(AdCallURLBuilderInternTarget(_builder, "age=32"), first, @"Growing the table must keep the handles");
+}
+
+@end
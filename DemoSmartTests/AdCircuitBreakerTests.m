@@ -0,0 +1,153 @@
+//
+//  AdCircuitBreakerTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdCircuitBreaker.h"
+#import "AdPlacementBreaker.h"
+
+#include <errno.h>
+
+// Without jitter, the dates are exact.
+static const AdCircuitBreakerConfiguration kAdCircuitBreakerTestsConfiguration = { 3, 10, 40, 60, 30, 0 };
+
+@interface AdCircuitBreakerTests : XCTestCase
+{
+    AdCircuitBreaker *_breaker;
+}
+
+@end
+
+@implementation AdCircuitBreakerTests
+
+- (void)setUp
+{
+    [super setUp];
+    _breaker = AdCircuitBreakerCreate(&kAdCircuitBreakerTestsConfiguration, 1);
+    XCTAssert(_breaker != NULL);
+}
+
+- (void)tearDown
+{
+    AdCircuitBreakerRelease(_breaker);
+    [super tearDown];
+}
+
+- (void)failAt:(double)now
+{
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", now), 1);
+    XCTAssertEqual(AdCircuitBreakerReport(_breaker, 1, "p", "t", AdCallFailed, now), 0);
+}
+
+- (void)testNoFillIsCachedForItsPlacement
+{
+    double retryDate;
+
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 13534, "374408", NULL, 0, &retryDate), AdCircuitClosed);
+    XCTAssertEqual(retryDate, 0.0);
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 13534, "374408", NULL, 0), 1);
+    XCTAssertEqual(AdCircuitBreakerReport(_breaker, 13534, "374408", "", AdCallNoFill, 1), 0);
+
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 13534, "374408", "", 2, &retryDate), AdCircuitNoFill, @"NULL and \"\" are the same target");
+    XCTAssertEqual(retryDate, 61.0);
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 13534, "374408", NULL, 2), 0);
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 13534, "374408", "sport", 2, NULL), AdCircuitClosed, @"Another placement");
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 13535, "374408", NULL, 2, NULL), AdCircuitClosed);
+
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 13534, "374408", NULL, 61, &retryDate), AdCircuitClosed, @"Expired");
+    XCTAssertEqual(retryDate, 61.0);
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 13534, "374408", NULL, 61), 1);
+}
+
+- (void)testFailuresOpenTheBreakerWithADoublingBackoff
+{
+    double retryDate;
+
+    [self failAt:100];
+    [self failAt:100];
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 1, "p", "t", 100, NULL), AdCircuitClosed, @"Below the threshold");
+    [self failAt:100];
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 1, "p", "t", 101, &retryDate), AdCircuitOpen);
+    XCTAssertEqual(retryDate, 110.0);
+    XCTAssertEqual(AdCircuitBreakerReport(_breaker, 1, "p", "t", AdCallFailed, 102), 0);
+    AdCircuitBreakerGetState(_breaker, 1, "p", "t", 102, &retryDate);
+    XCTAssertEqual(retryDate, 110.0, @"A call that went before does not extend the backoff");
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", 105), 0);
+
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 1, "p", "t", 110, NULL), AdCircuitHalfOpen);
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", 110), 1, @"The probe");
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", 111), 0);
+    XCTAssertEqual(AdCircuitBreakerReport(_breaker, 1, "p", "t", AdCallFailed, 112), 0);
+    AdCircuitBreakerGetState(_breaker, 1, "p", "t", 112, &retryDate);
+    XCTAssertEqual(retryDate, 132.0);
+    [self failAt:132];
+    AdCircuitBreakerGetState(_breaker, 1, "p", "t", 132, &retryDate);
+    XCTAssertEqual(retryDate, 172.0);
+    [self failAt:172];
+    AdCircuitBreakerGetState(_breaker, 1, "p", "t", 172, &retryDate);
+    XCTAssertEqual(retryDate, 212.0, @"At most maximumOpenInterval");
+
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", 212), 1);
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", 241), 0);
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", "t", 242), 1, @"The first probe never reported");
+    XCTAssertEqual(AdCircuitBreakerReport(_breaker, 1, "p", "t", AdCallFilled, 243), 0);
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 1, "p", "t", 243, NULL), AdCircuitClosed);
+}
+
+- (void)testCountersGiveTheFillRateAndTheSkippedCalls
+{
+    AdCircuitStatistics statistics;
+
+    for (int i = 0; i < 4; i++) {
+        XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", NULL, i * 100), 1);
+        XCTAssertEqual(AdCircuitBreakerReport(_breaker, 1, "p", NULL, i % 2 ? AdCallNoFill : AdCallFilled, i * 100), 0);
+        XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 1, "p", NULL, i * 100 + 1), i % 2 ? 0 : 1);
+    }
+    XCTAssertEqual(AdCircuitBreakerAllow(_breaker, 2, "q", NULL, 0), 1);
+    statistics = AdCircuitBreakerGetStatistics(_breaker, 1, "p", NULL);
+    XCTAssertEqual(statistics.calls, (uint64_t)6);
+    XCTAssertEqual(statistics.fills, (uint64_t)2);
+    XCTAssertEqual(statistics.noFills, (uint64_t)2);
+    XCTAssertEqual(statistics.shortCircuits, (uint64_t)2);
+    XCTAssertEqual(AdCircuitBreakerGetStatistics(_breaker, 0, NULL, NULL).calls, (uint64_t)7, @"Every placement");
+
+    AdCircuitBreakerReset(_breaker);
+    XCTAssertEqual(AdCircuitBreakerGetState(_breaker, 1, "p", NULL, 301, NULL), AdCircuitClosed);
+    XCTAssertEqual(AdCircuitBreakerGetStatistics(_breaker, 1, "p", NULL).noFills, (uint64_t)2, @"The counters are kept");
+}
+
+- (void)testJitterSpreadsTheRetryDates
+{
+    AdCircuitBreakerConfiguration configuration = kAdCircuitBreakerTestsConfiguration;
+    double earliest = INFINITY, latest = 0, retryDate;
+    char pageId[16];
+
+    configuration.jitter = 0.5;
+    AdCircuitBreakerRelease(_breaker);
+    _breaker = AdCircuitBreakerCreate(&configuration, 42);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(pageId, sizeof(pageId), "%d", i);
+        XCTAssertEqual(AdCircuitBreakerReport(_breaker, i, pageId, NULL, AdCallNoFill, 0), 0);
+        XCTAssertEqual(AdCircuitBreakerGetState(_breaker, i, pageId, NULL, 0, &retryDate), AdCircuitNoFill);
+        earliest = MIN(earliest, retryDate);
+        latest = MAX(latest, retryDate);
+    }
+    XCTAssert(earliest >= 30 && earliest < 32 && latest <= 60 && latest > 58, @"%f to %f", earliest, latest);
+
+    configuration.jitter = 2;
+    XCTAssert(AdCircuitBreakerCreate(&configuration, 1) == NULL);
+    XCTAssertEqual(errno, EINVAL);
+}
+
+- (void)testURLErrorsAreFailuresAndOthersNoFills
+{
+    XCTAssertEqual([AdPlacementBreaker outcomeForError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]], AdCallFailed);
+    XCTAssertEqual([AdPlacementBreaker outcomeForError:[NSError errorWithDomain:@"SASErrorDomain" code:1 userInfo:nil]], AdCallNoFill);
+}
+
+@end
@@ -0,0 +1,190 @@
+//
+//  AdConnectionPoolTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdConnectionPool.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const AdConnectionPoolConfiguration kAdConnectionPoolTestsConfiguration = { 2, 3, 30 };
+
+@interface AdConnectionPoolTests : XCTestCase
+{
+    int _server;                    // on the loopback, an ephemeral port
+    uint16_t _port;
+    int _peers[8];                  // the ends on the server, closed in tearDown
+    unsigned _peerCount;
+    AdConnectionPool *_pool;
+}
+
+@end
+
+@implementation AdConnectionPoolTests
+
+- (void)setUp
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    [super setUp];
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    _server = socket(AF_INET, SOCK_STREAM, 0);
+    XCTAssertEqual(bind(_server, (struct sockaddr *)&address, sizeof(address)), 0);
+    XCTAssertEqual(listen(_server, 16), 0);
+    getsockname(_server, (struct sockaddr *)&address, &length);
+    _port = ntohs(address.sin_port);
+    _pool = AdConnectionPoolCreate(&kAdConnectionPoolTestsConfiguration);
+    XCTAssert(_pool != NULL);
+}
+
+- (void)tearDown
+{
+    AdConnectionPoolRelease(_pool);
+    for (unsigned i = 0; i < _peerCount; i++) {
+        close(_peers[i]);
+    }
+    close(_server);
+    [super tearDown];
+}
+
+/** A connection, and its end on the server in peer when not NULL. */
+- (int)openWithPeer:(int *)peer
+{
+    int fd = AdConnectionOpen("127.0.0.1", _port, 2, NULL), accepted = accept(_server, NULL, NULL);
+
+    XCTAssert(fd >= 0);
+    if (peer) {
+        *peer = accepted;
+    } else if (_peerCount < sizeof(_peers) / sizeof(_peers[0])) {
+        _peers[_peerCount++] = accepted;
+    }
+    return fd;
+}
+
+- (void)testOpenMeasuresThePhases
+{
+    AdConnectionTimings timings;
+    int fd = AdConnectionOpen("localhost", _port, 2, &timings);
+
+    XCTAssert(fd >= 0, @"%s", strerror(errno));
+    XCTAssert(timings.resolve >= 0 && timings.connect > 0 && timings.connect < 2);
+    XCTAssert(timings.addresses >= 1);
+    XCTAssert(strlen(timings.canonicalName) > 0);
+    close(fd);
+    close(accept(_server, NULL, NULL));
+
+    XCTAssertEqual(AdConnectionOpen("no-such-host.invalid", _port, 2, &timings), -1);
+    XCTAssertEqual(errno, EHOSTUNREACH);
+    XCTAssertEqual(timings.addresses, 0u);
+    XCTAssertEqual(strcmp(timings.canonicalName, "no-such-host.invalid"), 0);
+}
+
+- (void)testResolveDoesNotConnect
+{
+    AdConnectionTimings timings;
+
+    XCTAssertEqual(AdConnectionResolve("localhost", _port, &timings), 0, @"%s", strerror(errno));
+    XCTAssert(timings.resolve >= 0);
+    XCTAssertEqual(timings.connect, 0.0);
+    XCTAssertEqual(timings.addresses, 0u);
+    XCTAssert(strlen(timings.canonicalName) > 0);
+
+    XCTAssertEqual(AdConnectionResolve("no-such-host.invalid", _port, &timings), -1);
+    XCTAssertEqual(errno, EHOSTUNREACH);
+    XCTAssertEqual(strcmp(timings.canonicalName, "no-such-host.invalid"), 0);
+}
+
+- (void)testOpenReportsARefusedConnection
+{
+    uint16_t port = _port;
+
+    close(_server);
+    _server = -1;
+    XCTAssertEqual(AdConnectionOpen("127.0.0.1", port, 2, NULL), -1);
+    XCTAssertEqual(errno, ECONNREFUSED);
+}
+
+- (void)testTakeReturnsTheLatestOpenConnectionOfTheOrigin
+{
+    int first = [self openWithPeer:NULL], peer, second = [self openWithPeer:&peer];
+
+    XCTAssertEqual(AdConnectionPoolTake(_pool, "ads", _port, 0), -1);
+    XCTAssertEqual(errno, ENOENT);
+    XCTAssertEqual(AdConnectionPoolGive(_pool, first, "ads", _port, 1), 0);
+    XCTAssertEqual(AdConnectionPoolGive(_pool, second, "ads", _port, 2), 0);
+    XCTAssertEqual(AdConnectionPoolTake(_pool, "ads", _port + 1, 3), -1, @"Another origin");
+    XCTAssertEqual(AdConnectionPoolTake(_pool, "cdn", _port, 3), -1);
+    XCTAssertEqual(AdConnectionPoolTake(_pool, "ads", _port, 3), second);
+    XCTAssertEqual(AdConnectionPoolGive(_pool, second, "ads", _port, 4), 0);
+
+    close(peer);
+    usleep(10000);
+    XCTAssertEqual(AdConnectionPoolTake(_pool, "ads", _port, 5), first, @"Closed by the server");
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).serverCloses, (uint64_t)1);
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).reuses, (uint64_t)2);
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).idle, 0u);
+    close(first);
+}
+
+- (void)testIdleConnectionsAreEvicted
+{
+    XCTAssertEqual(AdConnectionPoolGetEvictionDate(_pool), 0.0);
+    XCTAssertEqual(AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "ads", _port, 10), 0);
+    XCTAssertEqual(AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "cdn", _port, 12), 0);
+    XCTAssertEqual(AdConnectionPoolGetEvictionDate(_pool), 40.0);
+
+    XCTAssertEqual(AdConnectionPoolEvict(_pool, 39), 0u);
+    XCTAssertEqual(AdConnectionPoolEvict(_pool, 40), 1u);
+    XCTAssertEqual(AdConnectionPoolGetEvictionDate(_pool), 42.0);
+    XCTAssertEqual(AdConnectionPoolTake(_pool, "cdn", _port, 42), -1, @"Never taken once idle for too long");
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).idleEvictions, (uint64_t)2);
+    XCTAssertEqual(AdConnectionPoolGetEvictionDate(_pool), 0.0);
+}
+
+- (void)testTheOldestConnectionsAreClosedToKeepTheLimits
+{
+    AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "ads", _port, 1);
+    AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "ads", _port, 2);
+    AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "ads", _port, 3);
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).idle, 2u, @"maxIdlePerOrigin");
+    XCTAssertEqual(AdConnectionPoolGetEvictionDate(_pool), 32.0);
+
+    AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "cdn", _port, 4);
+    AdConnectionPoolGive(_pool, [self openWithPeer:NULL], "pixel", _port, 5);
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).idle, 3u, @"maxIdle");
+    XCTAssertEqual(AdConnectionPoolGetStatistics(_pool).overflows, (uint64_t)2);
+    XCTAssertEqual(AdConnectionPoolGetEvictionDate(_pool), 33.0);
+
+    XCTAssertEqual(AdConnectionPoolGive(_pool, -1, "ads", _port, 6), -1);
+    XCTAssertEqual(errno, EINVAL);
+}
+
+- (void)testBadConfigurationsAreRefused
+{
+    AdConnectionPoolConfiguration configuration = kAdConnectionPoolTestsConfiguration;
+    AdConnectionPool *pool = AdConnectionPoolCreate(NULL);
+
+    XCTAssert(pool != NULL);
+    AdConnectionPoolRelease(pool);
+    configuration.maxIdlePerOrigin = 4;
+    XCTAssert(AdConnectionPoolCreate(&configuration) == NULL);
+    XCTAssertEqual(errno, EINVAL);
+    configuration.maxIdlePerOrigin = 1;
+    configuration.idleTimeout = 0;
+    XCTAssert(AdConnectionPoolCreate(&configuration) == NULL);
+    XCTAssertEqual(errno, EINVAL);
+}
+
+@end
@@ -0,0 +1,737 @@
+//
+//  AdCoreBenchmarks.c
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#include "AdCoreBenchmarks.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "AdBlobStore.h"
+#include "AdBridgeChannel.h"
+#include "AdCache.h"
+#include "AdCallURL.h"
+#include "AdHistogram.h"
+#include "AdLocationFeed.h"
+#include "AdLog.h"
+#include "AdPipeline.h"
+#include "AdRecord.h"
+#include "AdResponseParser.h"
+#include "AdStringTable.h"
+
+#define kAdCoreBenchmarkCacheEntries 10000
+#define kAdCoreBenchmarkSegmentSize  1460    /* the payload of a TCP segment on Ethernet */
+#define kAdCoreBenchmarkBlobSize     (64 * 1024)
+#define kAdCoreBenchmarkBlobURLs     64
+#define kAdCoreBenchmarkCreatives    32
+
+typedef struct {
+    unsigned char *pixels;          /* RGBA, as downloaded */
+    unsigned char *decoded;         /* premultiplied, as drawn */
+    size_t length;
+    uint64_t digest;                /* of the pixels, what the verify stage checks */
+} AdCoreBenchmarkCreative;
+
+typedef struct {
+    AdRecordBuilder *builder;
+    const void *record;
+    size_t recordLength;
+    AdCache *cache;
+    AdHistogram *histogram;
+    AdCallURLBuilder *URLBuilder;
+    AdCallTarget target;
+    AdResponseParser *parser;
+    char *response;
+    size_t responseLength;
+    AdBlobStore *blobStore;
+    unsigned char *blob;
+    char blobURLs[kAdCoreBenchmarkBlobURLs][48];
+    char pageIds[kAdCoreBenchmarkCacheEntries][8];
+    AdBridgeChannel *bridgeChannel;
+    AdLocationFeed *locationFeed;
+    void *stringTableBytes;
+    AdStringTable *stringTable;
+    AdCoreBenchmarkCreative *creatives;
+    size_t creativesLength;
+    AdPipeline *pipeline;
+    uint64_t pipelineFailures;
+} AdCoreBenchmarkContext;
+
+static const char AdCoreBenchmarkBridgeBatch[] = "1\tgetHeading\t\n2\tgetSize\t\n3\tisViewable\t\n4\ttrack\tframe%3D1\n"
+                                                 "5\tgetHeading\t\n6\tgetSize\t\n7\tisViewable\t\n8\ttrack\tframe%3D2\n";
+
+static const char AdCoreBenchmarkStrings[] = "\"Leave Application?\" = \"Quitter l'application ?\";\n"
+                                             "\"Do you want to leave this application to open the advertisement?\" = \"Voulez-vous quitter l'application ?\";\n"
+                                             "\"Open Maps?\" = \"Ouvrir l'application Plans ?\";\n\"Open iTunes?\" = \"Ouvrir iTunes\";\n"
+                                             "\"Could Not Open the URL\" = \"Impossible d'ouvrir la page\";\n"
+                                             "\"No\" = \"Non\";\n\"Yes\" = \"Oui\";\n\"Ok\" = \"Ok\";\n";
+
+static const char *const AdCoreBenchmarkStringKeys[] = {
+    "Leave Application?", "Do you want to leave this application to open the advertisement?", "Yes", "Open Safari?",
+};
+
+static const char AdCoreBenchmarkTarget[] = "age=32;gender=f;interests=sport,music";
+
+static const char *const AdCoreBenchmarkURLs[] = {
+    "http://cdn.example.com/creative/portrait.png",
+    "http://cdn.example.com/creative/landscape.png",
+    "http://www.example.com/landing",
+    "http://mobile.smartadserver.com/click?iid=1",
+    "http://mobile.smartadserver.com/imp?iid=1",
+};
+
+// AdRecord
+
+static const void *AdCoreBenchmarkBuildRecord(AdRecordBuilder *builder, int64_t insertionId, size_t *length)
+{
+    AdRecordHeader *header;
+
+    AdRecordBuilderReset(builder);
+    header = AdRecordBuilderGetHeader(builder);
+    header->insertionId = insertionId;
+    header->expirationDate = 1790000000;
+    header->imageSize[0] = 320;
+    header->imageSize[1] = 480;
+    for (int field = AdRecordStringCreativeURL; field <= AdRecordStringImpPixel; field++) {
+        const char *URL = AdCoreBenchmarkURLs[field % 5];
+        AdRecordBuilderSetString(builder, (AdRecordString)field, URL, strlen(URL));
+    }
+    AdRecordBuilderAddListItem(builder, AdRecordListAgencyPortraitPixels, "http://agency.example.com/p1", 28);
+    return AdRecordBuilderFinish(builder, length);
+}
+
+static void AdCoreBenchmarkRecordEncode(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+    size_t length;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdCoreBenchmarkBuildRecord(state->builder, (int64_t)i, &length);
+        AdBenchmarkConsume(length);
+    }
+}
+
+static void AdCoreBenchmarkRecordRead(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        const AdRecordHeader *record = AdRecordValidate(state->record, state->recordLength);
+        AdBenchmarkConsume(AdRecordGetString(record, AdRecordStringCreativeURL).length
+                           + AdRecordGetString(record, AdRecordStringImpPixel).length
+                           + AdRecordGetListItem(record, AdRecordListAgencyPortraitPixels, 0).length);
+    }
+}
+
+// AdCache
+
+static void AdCoreBenchmarkCacheHit(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t key = (uint32_t)((i * 7919) % kAdCoreBenchmarkCacheEntries);
+        AdBenchmarkConsume(AdCacheGet(state->cache, 13534, state->pageIds[key], NULL, 0) != NULL);
+    }
+}
+
+static void AdCoreBenchmarkCacheMiss(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t key = (uint32_t)((i * 7919) % kAdCoreBenchmarkCacheEntries);
+        AdBenchmarkConsume(AdCacheGet(state->cache, 13535, state->pageIds[key], NULL, 0) != NULL);
+    }
+}
+
+// AdCallURL
+
+static void AdCoreBenchmarkCallURLBuild(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+    AdCallParameters parameters = { 13534, "374408", 1, state->target, 0, 1, 48.870569, 2.303425, 271.5 };
+    size_t length;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        parameters.timestamp = 1790000000000u + i;
+        AdCallURLBuild(state->URLBuilder, &parameters, &length);
+        AdBenchmarkConsume(length);
+    }
+}
+
+/** The naive way, as a baseline: escapes the target and formats the whole URL on every call. */
+static void AdCoreBenchmarkCallURLFormat(void *context, uint64_t iterations)
+{
+    char escaped[3 * sizeof(AdCoreBenchmarkTarget)], URL[512];
+
+    (void)context;
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdCallURLEscape(escaped, AdCoreBenchmarkTarget, strlen(AdCoreBenchmarkTarget));
+        AdBenchmarkConsume((uint64_t)snprintf(URL, sizeof(URL), "%s/ac?siteid=%d&pgid=%s&fmtid=%d&visit=%c&tmstp=%llu&tgt=%s&lat=%.6f&long=%.6f&hdg=%.1f",
+                                              "http://mobile.smartadserver.com", 51901, "374408", 13534, 'M',
+                                              1790000000000ull + i, escaped, 48.870569, 2.303425, 271.5));
+    }
+}
+
+// AdResponseParser
+
+static void AdCoreBenchmarkResponseParse(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdResponseParserReset(state->parser);
+        for (size_t offset = 0; offset < state->responseLength; offset += kAdCoreBenchmarkSegmentSize) {
+            size_t length = state->responseLength - offset;
+            AdResponseParserFeed(state->parser, state->response + offset, length < kAdCoreBenchmarkSegmentSize ? length : kAdCoreBenchmarkSegmentSize);
+        }
+        AdBenchmarkConsume(AdResponseParserGetRecord(state->parser, NULL) != NULL);
+    }
+}
+
+static char *AdCoreBenchmarkReadFile(const char *directory, const char *name, size_t *length)
+{
+    char path[1024];
+    FILE *file;
+    char *bytes = NULL;
+    long size;
+
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        bytes = malloc((size_t)size);
+        if (bytes && fread(bytes, 1, (size_t)size, file) != (size_t)size) {
+            free(bytes);
+            bytes = NULL;
+        }
+        *length = (size_t)size;
+    }
+    fclose(file);
+    return bytes;
+}
+
+/** Runs the parse benchmark over each recorded response, fed a segment at a time as from the socket. */
+static size_t AdCoreBenchmarksRunResponses(AdCoreBenchmarkContext *state, const char *fixtures, const AdBenchmarkOptions *options,
+                                           AdBenchmarkResult *results, size_t capacity, FILE *progress)
+{
+    static const char *const names[] = { "AdResponseImage", "AdResponseHTML", "AdResponseVideo" };
+    size_t count = 0;
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]) && count < capacity; i++) {
+        char file[64], name[kAdBenchmarkNameLength];
+
+        snprintf(file, sizeof(file), "%s.json", names[i]);
+        state->response = AdCoreBenchmarkReadFile(fixtures, file, &state->responseLength);
+        if (state->response == NULL) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "AdResponseParser.%s", names[i] + strlen("AdResponse"));
+        results[count] = AdBenchmarkRun(name, AdCoreBenchmarkResponseParse, state, options);
+        results[count].bytes = state->responseLength;
+        if (progress) {
+            AdBenchmarkPrint(progress, &results[count]);
+        }
+        count++;
+        free(state->response);
+        state->response = NULL;
+    }
+    return count;
+}
+
+// AdHistogram and AdLog
+
+static void AdCoreBenchmarkHistogramRecord(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdHistogramRecord(state->histogram, (i * 2654435761u) % 5000000);
+    }
+}
+
+static void AdCoreBenchmarkLogWrite(void *context, uint64_t iterations)
+{
+    (void)context;
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdLogWrite(AdLogEventAdDataReceived, 13534, i, 0, NULL);
+        // Drained like the background thread would, so that the ring never fills and drops.
+        if ((i & 511) == 511) {
+            AdLogFlush();
+        }
+    }
+}
+
+// AdBlobStore
+
+/** The creative is already stored: every put hashes it and finds the blob, as for an image reused by many insertions. */
+static void AdCoreBenchmarkBlobPutDuplicate(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdBlobStorePut(state->blobStore, state->blobURLs[i % kAdCoreBenchmarkBlobURLs], "\"33a64df5\"", state->blob, kAdCoreBenchmarkBlobSize, NULL);
+    }
+}
+
+// AdBridgeChannel
+
+static int AdCoreBenchmarkBridgeHandleCall(void *info, uint32_t callId, const char *method, const char *argument, char *result, size_t capacity)
+{
+    (void)info;
+    (void)argument;
+    snprintf(result, capacity, "{\"id\":%u,\"method\":\"%s\"}", callId, method);
+    return 1;
+}
+
+/** A frame of a chatty creative: the sampled state, with a jittering heading, and a batch of 8 calls, answered in one message. */
+static void AdCoreBenchmarkBridgeExchange(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+    AdBridgeState bridgeState = { 320, 480, 0, 90, 100 };
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        bridgeState.heading = 90 + (double)(i % 8);
+        AdBridgeChannelSetState(state->bridgeChannel, &bridgeState);
+        AdBridgeChannelReceive(state->bridgeChannel, AdCoreBenchmarkBridgeBatch, sizeof(AdCoreBenchmarkBridgeBatch) - 1,
+                               AdCoreBenchmarkBridgeHandleCall, NULL);
+        AdBridgeChannelFlush(state->bridgeChannel, NULL);
+    }
+}
+
+// AdLocationFeed
+
+/** A fix jittering by a few meters at 60 Hz around a slow walk, read back by a consumer, as most are suppressed. */
+static void AdCoreBenchmarkLocationUpdate(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+    AdLocationSnapshot snapshot;
+    uint64_t versions = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        double jitter = (double)(i * 2654435761u % 64) * 1e-6;
+
+        AdLocationFeedUpdateLocation(state->locationFeed, 48.8566 + (double)i * 2e-6 + jitter, 2.3522 - jitter, 10, (double)i / 60);
+        AdLocationFeedRead(state->locationFeed, &snapshot);
+        versions += snapshot.version;
+    }
+    AdBenchmarkConsume(versions);
+}
+
+// AdStringTable
+
+/** The strings of a confirmation prompt, and a key the table does not have. */
+static void AdCoreBenchmarkStringLookup(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+    uint64_t found = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (size_t k = 0; k < sizeof(AdCoreBenchmarkStringKeys) / sizeof(AdCoreBenchmarkStringKeys[0]); k++) {
+            found += AdStringTableLookup(state->stringTable, AdCoreBenchmarkStringKeys[k], strlen(AdCoreBenchmarkStringKeys[k]), NULL) != NULL;
+        }
+    }
+    AdBenchmarkConsume(found);
+}
+
+// AdPipeline
+
+static uint64_t AdCoreBenchmarkDigest(const unsigned char *bytes, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int AdCoreBenchmarkPipelineVerify(void *item, void *context)
+{
+    AdCoreBenchmarkCreative *creative = item;
+
+    (void)context;
+    return AdCoreBenchmarkDigest(creative->pixels, creative->length) == creative->digest ? 0 : 1;
+}
+
+static int AdCoreBenchmarkPipelineDecode(void *item, void *context)
+{
+    AdCoreBenchmarkCreative *creative = item;
+
+    (void)context;
+    for (size_t p = 0; p + 3 < creative->length; p += 4) {
+        unsigned alpha = creative->pixels[p + 3];
+
+        for (int c = 0; c < 3; c++) {
+            creative->decoded[p + c] = (unsigned char)((creative->pixels[p + c] * alpha + 127) / 255);
+        }
+        creative->decoded[p + 3] = (unsigned char)alpha;
+    }
+    return 0;
+}
+
+static void AdCoreBenchmarkPipelineComplete(void *item, int status, void *context)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    (void)item;
+    if (status != 0) {
+        __atomic_fetch_add(&state->pipelineFailures, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/** Banners, with an MPU every 8, of noise with a varying alpha. Returns the bytes of the pixels, 0 on failure. */
+static size_t AdCoreBenchmarkCreateCreatives(AdCoreBenchmarkCreative *creatives)
+{
+    size_t total = 0;
+
+    for (uint32_t i = 0; i < kAdCoreBenchmarkCreatives; i++) {
+        AdCoreBenchmarkCreative *creative = &creatives[i];
+
+        creative->length = (i % 8 == 7 ? 300 * 250 : 320 * 50) * 4;
+        creative->pixels = malloc(creative->length);
+        creative->decoded = malloc(creative->length);
+        if (creative->pixels == NULL || creative->decoded == NULL) {
+            return 0;
+        }
+        for (size_t p = 0; p < creative->length; p++) {
+            creative->pixels[p] = (unsigned char)((p + i) * 2654435761u >> 24);
+        }
+        creative->digest = AdCoreBenchmarkDigest(creative->pixels, creative->length);
+        total += creative->length;
+    }
+    return total;
+}
+
+/** The creatives of the corpus in turn, verified then decoded by 2 workers a stage. The corpus is larger
+ than what the queues and workers can hold, so a creative has completed before it is submitted again.
+ */
+static void AdCoreBenchmarkPipelineCorpus(void *context, uint64_t iterations)
+{
+    AdCoreBenchmarkContext *state = context;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        AdPipelineSubmit(state->pipeline, &state->creatives[i % kAdCoreBenchmarkCreatives]);
+    }
+    AdPipelineDrain(state->pipeline);
+    AdBenchmarkConsume(__atomic_load_n(&state->pipelineFailures, __ATOMIC_RELAXED));
+}
+
+// Checks
+
+static unsigned AdCoreBenchmarkCheckFailure(FILE *output, const char *check, const char *reason)
+{
+    if (output) {
+        fprintf(output, "check %s FAILED: %s\n", check, reason);
+    }
+    return 1;
+}
+
+/** The strings of the round trip: a URL with UTF-8 for most fields, "" (set, but empty) for one, and the last one not set. */
+static const char *AdCoreBenchmarkCheckString(int field, char *buffer, size_t capacity)
+{
+    if (field == AdRecordStringCount - 1) {
+        return NULL;
+    }
+    if (field == AdRecordStringRedirectURL) {
+        return "";
+    }
+    snprintf(buffer, capacity, "%s?field=%d&q=caf\xc3\xa9", AdCoreBenchmarkURLs[field % 5], field);
+    return buffer;
+}
+
+static unsigned AdCoreBenchmarkCheckRecordRoundTrip(FILE *output)
+{
+    static const char *const portraitPixels[] = { "http://agency.example.com/p1", "http://agency.example.com/p2?a=1&b=2", "" };
+    const char *check = "AdRecord.roundTrip";
+    AdRecordBuilder *builder = AdRecordBuilderCreate();
+    AdRecordHeader expected, *header;
+    const AdRecordHeader *record;
+    char buffer[128];
+    const void *bytes;
+    char *copy;
+    size_t length;
+    unsigned failures = 0;
+
+    if (builder == NULL) {
+        return AdCoreBenchmarkCheckFailure(output, check, "cannot create the builder");
+    }
+    header = AdRecordBuilderGetHeader(builder);
+    header->flags = AdRecordFlagExpandedAtInit | AdRecordFlagNavigationHasControls;
+    header->insertionId = -9007199254740993LL;
+    header->expirationDate = 1790000000.25;
+    header->duration = 15.5f;
+    header->creativeType = 3;
+    header->skipPosition = 5;
+    header->expandedHeight = 250;
+    header->expandedLandscapeHeight = 180;
+    header->triggerHeight = 50;
+    header->triggerLandscapeHeight = 32;
+    header->imageSize[0] = 320;
+    header->imageSize[1] = 480;
+    header->landscapeImageSize[0] = 480;
+    header->landscapeImageSize[1] = 320;
+    header->videoSize[0] = 640;
+    header->videoSize[1] = 360;
+    for (int i = 0; i < 4; i++) {
+        header->backgroundColor[i] = (float)i / 4;
+        header->textColor[i] = 1 - (float)i / 8;
+    }
+    expected = *header;
+    for (int field = 0; field < AdRecordStringCount; field++) {
+        const char *string = AdCoreBenchmarkCheckString(field, buffer, sizeof(buffer));
+        AdRecordBuilderSetString(builder, (AdRecordString)field, string, string ? strlen(string) : 0);
+    }
+    for (uint32_t i = 0; i < sizeof(portraitPixels) / sizeof(portraitPixels[0]); i++) {
+        AdRecordBuilderAddListItem(builder, AdRecordListAgencyPortraitPixels, portraitPixels[i], strlen(portraitPixels[i]));
+    }
+    bytes = AdRecordBuilderFinish(builder, &length);
+    // Read from a copy, with the builder gone, as from a file.
+    copy = bytes ? malloc(length) : NULL;
+    if (copy) {
+        memcpy(copy, bytes, length);
+    }
+    AdRecordBuilderRelease(builder);
+    if (copy == NULL) {
+        return AdCoreBenchmarkCheckFailure(output, check, "cannot build the record");
+    }
+
+    record = AdRecordValidate(copy, length);
+    if (record == NULL) {
+        failures += AdCoreBenchmarkCheckFailure(output, check, "the record is not valid");
+        free(copy);
+        return failures;
+    }
+    if (record->totalLength != length || length % kAdRecordAlignment != 0) {
+        failures += AdCoreBenchmarkCheckFailure(output, check, "the length is not the total length, or not aligned");
+    }
+    if (record->flags != expected.flags || record->insertionId != expected.insertionId || record->expirationDate != expected.expirationDate
+        || record->duration != expected.duration || record->creativeType != expected.creativeType || record->skipPosition != expected.skipPosition
+        || record->expandedHeight != expected.expandedHeight || record->expandedLandscapeHeight != expected.expandedLandscapeHeight
+        || record->triggerHeight != expected.triggerHeight || record->triggerLandscapeHeight != expected.triggerLandscapeHeight
+        || memcmp(record->imageSize, expected.imageSize, sizeof(expected.imageSize)) != 0
+        || memcmp(record->landscapeImageSize, expected.landscapeImageSize, sizeof(expected.landscapeImageSize)) != 0
+        || memcmp(record->videoSize, expected.videoSize, sizeof(expected.videoSize)) != 0
+        || memcmp(record->backgroundColor, expected.backgroundColor, sizeof(expected.backgroundColor)) != 0
+        || memcmp(record->textColor, expected.textColor, sizeof(expected.textColor)) != 0) {
+        failures += AdCoreBenchmarkCheckFailure(output, check, "a scalar differs");
+    }
+    for (int field = 0; field < AdRecordStringCount; field++) {
+        const char *string = AdCoreBenchmarkCheckString(field, buffer, sizeof(buffer));
+        AdRecordSlice slice = AdRecordGetString(record, (AdRecordString)field);
+
+        if (string == NULL ? slice.bytes != NULL
+                           : slice.bytes == NULL || slice.length != strlen(string) || memcmp(slice.bytes, string, slice.length + 1) != 0) {
+            snprintf(buffer, sizeof(buffer), "string %d differs", field);
+            failures += AdCoreBenchmarkCheckFailure(output, check, buffer);
+        }
+    }
+    if (AdRecordGetListCount(record, AdRecordListAgencyPortraitPixels) != sizeof(portraitPixels) / sizeof(portraitPixels[0])
+        || AdRecordGetListCount(record, AdRecordListAgencyLandscapePixels) != 0
+        || AdRecordGetListItem(record, AdRecordListAgencyLandscapePixels, 0).bytes != NULL) {
+        failures += AdCoreBenchmarkCheckFailure(output, check, "a list count differs");
+    }
+    for (uint32_t i = 0; i < sizeof(portraitPixels) / sizeof(portraitPixels[0]); i++) {
+        AdRecordSlice item = AdRecordGetListItem(record, AdRecordListAgencyPortraitPixels, i);
+
+        if (item.bytes == NULL || item.length != strlen(portraitPixels[i]) || memcmp(item.bytes, portraitPixels[i], item.length + 1) != 0) {
+            snprintf(buffer, sizeof(buffer), "list item %u differs", i);
+            failures += AdCoreBenchmarkCheckFailure(output, check, buffer);
+        }
+    }
+    free(copy);
+    return failures;
+}
+
+/** Every truncation, and a record damaged in each of the ways AdRecordValidate looks for, must be refused. */
+static unsigned AdCoreBenchmarkCheckRecordDamage(FILE *output)
+{
+    const char *check = "AdRecord.rejectsDamage";
+    AdRecordBuilder *builder = AdRecordBuilderCreate();
+    AdRecordHeader *header;
+    const void *bytes;
+    char *copy = NULL;
+    size_t length;
+    unsigned failures = 0;
+    AdRecordSlot slot;
+
+    bytes = builder ? AdCoreBenchmarkBuildRecord(builder, 1, &length) : NULL;
+    copy = bytes ? malloc(length) : NULL;
+    if (copy == NULL) {
+        AdRecordBuilderRelease(builder);
+        return AdCoreBenchmarkCheckFailure(output, check, "cannot build the record");
+    }
+    memcpy(copy, bytes, length);
+    header = (AdRecordHeader *)copy;
+    for (size_t truncated = 0; truncated < length; truncated++) {
+        if (AdRecordValidate(copy, truncated) != NULL) {
+            failures += AdCoreBenchmarkCheckFailure(output, check, "a truncated record is accepted");
+            break;
+        }
+    }
+
+    header->magic ^= 1;
+    failures += AdRecordValidate(copy, length) != NULL ? AdCoreBenchmarkCheckFailure(output, check, "a bad magic is accepted") : 0;
+    header->magic ^= 1;
+    header->version = kAdRecordVersion + 1;
+    failures += AdRecordValidate(copy, length) != NULL ? AdCoreBenchmarkCheckFailure(output, check, "an unknown version is accepted") : 0;
+    header->version = kAdRecordVersion;
+    slot = header->strings[AdRecordStringCreativeURL];
+    header->strings[AdRecordStringCreativeURL].length += 4096;
+    failures += AdRecordValidate(copy, length) != NULL ? AdCoreBenchmarkCheckFailure(output, check, "an out of bounds string is accepted") : 0;
+    header->strings[AdRecordStringCreativeURL].length = slot.length - 1;
+    failures += AdRecordValidate(copy, length) != NULL ? AdCoreBenchmarkCheckFailure(output, check, "a string without its NUL is accepted") : 0;
+    header->strings[AdRecordStringCreativeURL] = slot;
+    slot = header->lists[AdRecordListAgencyPortraitPixels];
+    header->lists[AdRecordListAgencyPortraitPixels].offset = (uint32_t)length;
+    failures += AdRecordValidate(copy, length) != NULL ? AdCoreBenchmarkCheckFailure(output, check, "an out of bounds list is accepted") : 0;
+    header->lists[AdRecordListAgencyPortraitPixels] = slot;
+    if (AdRecordValidate(copy, length) == NULL) {
+        failures += AdCoreBenchmarkCheckFailure(output, check, "the repaired record is refused");
+    }
+    free(copy);
+    AdRecordBuilderRelease(builder);
+    return failures;
+}
+
+unsigned AdCoreBenchmarksCheck(FILE *output)
+{
+    const struct {
+        const char *name;
+        unsigned (*function)(FILE *output);
+    } checks[] = {
+        { "AdRecord.roundTrip", AdCoreBenchmarkCheckRecordRoundTrip },
+        { "AdRecord.rejectsDamage", AdCoreBenchmarkCheckRecordDamage },
+    };
+    unsigned failures = 0;
+
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        unsigned failed = checks[i].function(output);
+
+        if (output && failed == 0) {
+            fprintf(output, "check %s ok\n", checks[i].name);
+        }
+        failures += failed;
+    }
+    return failures;
+}
+
+// Suite
+
+size_t AdCoreBenchmarksRun(const char *directory, const char *fixtures, const AdBenchmarkOptions *options,
+                           AdBenchmarkResult *results, size_t capacity, FILE *progress)
+{
+    AdCoreBenchmarkContext *state = calloc(1, sizeof(AdCoreBenchmarkContext));
+    const struct {
+        const char *name;
+        AdBenchmarkFunction function;
+    } benchmarks[] = {
+        { "AdRecord.encode", AdCoreBenchmarkRecordEncode },
+        { "AdRecord.validateAndRead", AdCoreBenchmarkRecordRead },
+        { "AdCache.getHit", AdCoreBenchmarkCacheHit },
+        { "AdCache.getMiss", AdCoreBenchmarkCacheMiss },
+        { "AdCallURL.build", AdCoreBenchmarkCallURLBuild },
+        { "AdCallURL.snprintf", AdCoreBenchmarkCallURLFormat },
+        { "AdHistogram.record", AdCoreBenchmarkHistogramRecord },
+        { "AdLog.write", AdCoreBenchmarkLogWrite },
+        { "AdBlobStore.putDuplicate", AdCoreBenchmarkBlobPutDuplicate },
+        { "AdBridgeChannel.exchange", AdCoreBenchmarkBridgeExchange },
+        { "AdLocationFeed.updateAndRead", AdCoreBenchmarkLocationUpdate },
+        { "AdStringTable.lookup", AdCoreBenchmarkStringLookup },
+        { "AdPipeline.corpus", AdCoreBenchmarkPipelineCorpus },
+    };
+    const AdPipelineStage stages[] = {
+        { AdCoreBenchmarkPipelineVerify, NULL, 2, 4 },
+        { AdCoreBenchmarkPipelineDecode, NULL, 2, 4 },
+    };
+    size_t count = 0, length;
+
+    if (state == NULL) {
+        return 0;
+    }
+    state->builder = AdRecordBuilderCreate();
+    state->histogram = malloc(sizeof(AdHistogram));
+    state->cache = AdCacheOpen(directory, 0);
+    state->URLBuilder = AdCallURLBuilderCreate("http://mobile.smartadserver.com", 51901);
+    state->parser = AdResponseParserCreate();
+    state->blobStore = AdBlobStoreOpen(directory);
+    state->blob = malloc(kAdCoreBenchmarkBlobSize);
+    state->bridgeChannel = AdBridgeChannelCreate();
+    state->locationFeed = AdLocationFeedCreate(NULL);
+    state->creatives = calloc(kAdCoreBenchmarkCreatives, sizeof(AdCoreBenchmarkCreative));
+    state->creativesLength = state->creatives ? AdCoreBenchmarkCreateCreatives(state->creatives) : 0;
+    state->pipeline = AdPipelineCreate(stages, sizeof(stages) / sizeof(stages[0]), AdCoreBenchmarkPipelineComplete, state);
+    if (AdStringTableCompile(AdCoreBenchmarkStrings, sizeof(AdCoreBenchmarkStrings) - 1, NULL, NULL, &state->stringTableBytes, &length, NULL) == 0) {
+        state->stringTable = AdStringTableCreateWithBytes(state->stringTableBytes, length);
+    }
+    if (state->pipeline == NULL || state->creativesLength == 0 || state->stringTable == NULL || state->locationFeed == NULL || state->bridgeChannel == NULL || state->blobStore == NULL || state->blob == NULL || state->parser == NULL || state->URLBuilder == NULL || state->builder == NULL || state->histogram == NULL || state->cache == NULL || AdLogOpen(directory, 64 * 1024 * 1024, 1) != 0) {
+        goto done;
+    }
+    AdHistogramInit(state->histogram);
+    state->target = AdCallURLBuilderInternTarget(state->URLBuilder, AdCoreBenchmarkTarget);
+    for (uint32_t i = 0; i < kAdCoreBenchmarkCacheEntries; i++) {
+        size_t length;
+        const void *record = AdCoreBenchmarkBuildRecord(state->builder, i, &length);
+        snprintf(state->pageIds[i], sizeof(state->pageIds[i]), "%u", i);
+        AdCachePut(state->cache, 13534, state->pageIds[i], NULL, record, length, 0);
+    }
+    state->record = AdCoreBenchmarkBuildRecord(state->builder, 1, &state->recordLength);
+    for (uint32_t i = 0; i < kAdCoreBenchmarkBlobSize; i++) {
+        state->blob[i] = (unsigned char)(i * 2654435761u >> 24);
+    }
+    for (uint32_t i = 0; i < kAdCoreBenchmarkBlobURLs; i++) {
+        snprintf(state->blobURLs[i], sizeof(state->blobURLs[i]), "http://cdn.example.com/creative/%u.png", i);
+    }
+    AdBlobStorePut(state->blobStore, state->blobURLs[0], NULL, state->blob, kAdCoreBenchmarkBlobSize, NULL);
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]) && count < capacity; i++) {
+        // The encode benchmark reuses the builder that owns the record read by the next one.
+        if (benchmarks[i].function == AdCoreBenchmarkRecordRead) {
+            state->record = AdCoreBenchmarkBuildRecord(state->builder, 1, &state->recordLength);
+        }
+        results[count] = AdBenchmarkRun(benchmarks[i].name, benchmarks[i].function, state, options);
+        if (benchmarks[i].function == AdCoreBenchmarkBlobPutDuplicate) {
+            results[count].bytes = kAdCoreBenchmarkBlobSize;
+        } else if (benchmarks[i].function == AdCoreBenchmarkBridgeExchange) {
+            results[count].bytes = sizeof(AdCoreBenchmarkBridgeBatch) - 1;
+        } else if (benchmarks[i].function == AdCoreBenchmarkPipelineCorpus) {
+            results[count].bytes = state->creativesLength / kAdCoreBenchmarkCreatives;
+        }
+        if (progress) {
+            AdBenchmarkPrint(progress, &results[count]);
+        }
+        count++;
+    }
+    if (fixtures) {
+        count += AdCoreBenchmarksRunResponses(state, fixtures, options, results + count, capacity - count, progress);
+    }
+
+done:
+    AdLogClose();
+    AdCacheClose(state->cache);
+    AdBlobStoreClose(state->blobStore);
+    AdBridgeChannelRelease(state->bridgeChannel);
+    AdLocationFeedRelease(state->locationFeed);
+    AdStringTableClose(state->stringTable);
+    AdPipelineRelease(state->pipeline);
+    for (uint32_t i = 0; state->creatives && i < kAdCoreBenchmarkCreatives; i++) {
+        free(state->creatives[i].pixels);
+        free(state->creatives[i].decoded);
+    }
+    free(state->creatives);
+    free(state->stringTableBytes);
+    free(state->blob);
+    AdCallURLBuilderRelease(state->URLBuilder);
+    AdResponseParserRelease(state->parser);
+    AdRecordBuilderRelease(state->builder);
+    free(state->histogram);
+    free(state);
+    return count;
+}
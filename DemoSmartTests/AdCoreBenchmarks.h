@@ -0,0 +1,40 @@
+//
+//  AdCoreBenchmarks.h
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Benchmarks of the plain C cores of the app (AdRecord, AdCache, AdCallURL,
+ AdResponseParser, AdHistogram, AdLog, AdBlobStore, AdBridgeChannel, AdLocationFeed,
+ AdStringTable, AdPipeline).
+
+ They run the same in the test bundle (DemoSmartTests.m) and headless on Linux (tools/adbench.c).
+ */
+
+#ifndef DemoSmartTests_AdCoreBenchmarks_h
+#define DemoSmartTests_AdCoreBenchmarks_h
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "AdBenchmark.h"
+
+#define kAdCoreBenchmarkMaxCount 24
+
+/** Runs every core benchmark, with the files in an existing scratch directory. Returns the number of results.
+
+ @param fixtures The directory of the recorded AdResponse*.json responses, NULL to skip the parse benchmarks.
+ @param progress Each result is printed there as soon as it is known, may be NULL.
+ */
+size_t AdCoreBenchmarksRun(const char *directory, const char *fixtures, const AdBenchmarkOptions *options,
+                           AdBenchmarkResult *results, size_t capacity, FILE *progress);
+
+/** Checks that a record with every kind of field reads back the same after a round trip, and that
+ truncated or damaged records are refused. Returns the number of failures, each printed to output when not NULL.
+ */
+unsigned AdCoreBenchmarksCheck(FILE *output);
+
+#endif
@@ -0,0 +1,150 @@
+//
+//  AdDeadlineLoaderTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdDeadlineLoader.h"
+#import "AdPlacementBreaker.h"
+#import "OfflineAdCache.h"
+
+/** Records its calls instead of sending them, and never answers, as offline until the SDK timeout. */
+@interface AdDeadlineLoaderTestsView : SASAdView
+
+@property (nonatomic, assign) NSUInteger loads;
+@property (nonatomic, strong) SmartAdServerAd *displayedAd;
+@property (nonatomic, assign) BOOL dismissed;
+
+@end
+
+@implementation AdDeadlineLoaderTestsView
+
+- (void)loadFormatId:(NSInteger)formatId pageId:(NSString *)pageId master:(BOOL)isMaster target:(NSString *)target
+{
+    self.loads++;
+}
+
+- (void)loadFormatId:(NSInteger)formatId pageId:(NSString *)pageId master:(BOOL)isMaster target:(NSString *)target timeout:(float)timeout
+{
+    self.loads++;
+}
+
+- (void)displayThisAd:(SmartAdServerAd *)ad
+{
+    self.displayedAd = ad;
+}
+
+- (void)dismiss
+{
+    self.dismissed = YES;
+}
+
+@end
+
+@interface AdDeadlineLoaderTests : XCTestCase
+{
+    NSInteger _formatId;
+    NSString *_pageId;              // a placement of its own in the shared breaker and cache
+    UIView *_container;
+    NSMutableArray *_views;
+}
+
+@end
+
+@implementation AdDeadlineLoaderTests
+
+- (void)setUp
+{
+    SmartAdServerAd *ad = [[SmartAdServerAd alloc] init];
+
+    [super setUp];
+    _formatId = 13534;
+    _pageId = [[NSProcessInfo processInfo] globallyUniqueString];
+    _container = [[UIView alloc] initWithFrame:CGRectMake(0, 0, 320, 480)];
+    _views = [NSMutableArray array];
+    ad.insertionId = 1;
+    ad.expirationDate = [NSDate dateWithTimeIntervalSinceNow:3600];
+    ad.creativeURL = [NSURL URLWithString:@"http://cdn.example.com/1.png"];
+    XCTAssertTrue([[OfflineAdCache sharedCache] storeAd:ad formatId:_formatId pageId:_pageId target:nil]);
+}
+
+- (void)tearDown
+{
+    [[OfflineAdCache sharedCache] removeAdForFormatId:_formatId pageId:_pageId target:nil];
+    [super tearDown];
+}
+
+- (BOOL)waitUntil:(BOOL (^)(void))condition timeout:(NSTimeInterval)timeout
+{
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while (!condition()) {
+        if ([limit timeIntervalSinceNow] < 0) {
+            return NO;
+        }
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return YES;
+}
+
+/** Falls back to the cached ad 0.1 s in, long before the SDK timeout of the call. */
+- (AdDeadlineLoader *)load
+{
+    AdDeadlineLoader *loader = [[AdDeadlineLoader alloc] initWithFormatId:_formatId pageId:_pageId target:nil budget:0.5];
+    NSMutableArray *views = _views;
+
+    loader.displayMargin = 0.4;
+    loader.hedgingEnabled = NO;
+    [loader loadInView:_container viewFactory:^SASAdView *{
+        AdDeadlineLoaderTestsView *adView = [[AdDeadlineLoaderTestsView alloc] initWithFrame:CGRectMake(0, 0, 320, 50)];
+        [views addObject:adView];
+        return adView;
+    }];
+    XCTAssertTrue([self waitUntil:^BOOL{ return loader.adView != nil || loader.shortCircuited; } timeout:2]);
+    return loader;
+}
+
+- (void)testTheCallAbandonedForTheCachedAdIsReportedAsFailed
+{
+    AdDeadlineLoader *loader = [self load];
+    AdDeadlineLoaderTestsView *call = _views[0], *cached = _views[1];
+    AdCircuitStatistics statistics = [[AdPlacementBreaker sharedBreaker] statisticsForFormatId:_formatId pageId:_pageId target:nil];
+
+    XCTAssertTrue(loader.usedCachedAd);
+    XCTAssertEqual(loader.adView, (SASAdView *)cached);
+    XCTAssertEqual(cached.displayedAd.insertionId, (NSInteger)1);
+    XCTAssertEqual(call.loads, (NSUInteger)1);
+    XCTAssertTrue(call.dismissed, @"Its timeout will not be reported");
+    XCTAssertEqual(statistics.calls, (uint64_t)1);
+    XCTAssertEqual(statistics.failures, (uint64_t)1);
+
+    // Were it forwarded anyway, the failure is not counted twice.
+    XCTAssertFalse([loader adView:call didFailToLoadWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]]);
+    statistics = [[AdPlacementBreaker sharedBreaker] statisticsForFormatId:_formatId pageId:_pageId target:nil];
+    XCTAssertEqual(statistics.failures, (uint64_t)1);
+}
+
+- (void)testFallbacksOfflineOpenTheBreaker
+{
+    AdDeadlineLoader *loader;
+
+    // The default failure threshold.
+    for (int i = 0; i < 3; i++) {
+        loader = [self load];
+        XCTAssertTrue(loader.usedCachedAd);
+        XCTAssertFalse(loader.shortCircuited);
+    }
+    XCTAssertEqual([[AdPlacementBreaker sharedBreaker] stateForFormatId:_formatId pageId:_pageId target:nil retryDate:NULL], AdCircuitOpen);
+
+    [_views removeAllObjects];
+    loader = [self load];
+    XCTAssertTrue(loader.shortCircuited);
+    XCTAssertTrue(loader.usedCachedAd, @"Displayed at once");
+    XCTAssertEqual([_views count], (NSUInteger)1, @"No call");
+}
+
+@end
@@ -0,0 +1,112 @@
+//
+//  AdHTMLProcessorTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdHTMLProcessor.h"
+
+static const char *AdHTMLTestRewrite(void *info, const char *url, size_t length)
+{
+    NSMutableArray *urls = (__bridge NSMutableArray *)info;
+
+    [urls addObject:[[NSString alloc] initWithBytes:url length:length encoding:NSUTF8StringEncoding]];
+    return "file:///cache/asset";
+}
+
+@interface AdHTMLProcessorTests : XCTestCase
+
+@end
+
+@implementation AdHTMLProcessorTests
+
+- (NSString *)process:(NSString *)html options:(uint32_t)options statistics:(AdHTMLStatistics *)statistics
+{
+    return [self process:html options:options rewrite:NULL info:NULL statistics:statistics];
+}
+
+- (NSString *)process:(NSString *)html options:(uint32_t)options rewrite:(AdHTMLRewriteCallback)rewrite info:(void *)info
+           statistics:(AdHTMLStatistics *)statistics
+{
+    static const char bootstrap[] = "window.mraid={};";
+    AdHTMLProcessing processing = { options, bootstrap, sizeof(bootstrap) - 1, rewrite, info };
+    size_t length;
+    char *output = AdHTMLProcess(html.UTF8String, strlen(html.UTF8String), &processing, &length, statistics);
+    NSString *result;
+
+    XCTAssert(output != NULL);
+    XCTAssertEqual(strlen(output), length);
+    result = [NSString stringWithUTF8String:output];
+    free(output);
+    return result;
+}
+
+- (void)testWithoutOptionsTheDocumentIsUnchanged
+{
+    NSString *html = @"<html>\n  <!-- note -->\n  <script src=\"mraid.js\"></script>\n  <img src=a.png>\n</html>";
+
+    XCTAssertEqualObjects([self process:html options:0 statistics:NULL], html);
+}
+
+- (void)testMinifyCollapsesWhitespaceAndDropsComments
+{
+    AdHTMLStatistics statistics;
+    NSString *html = @"<div   class=\"a\"  >\n   Hello    <!-- note -->   world\n</div>\n<!--[if IE]><p>IE</p><![endif]-->";
+
+    XCTAssertEqualObjects([self process:html options:AdHTMLProcessMinify statistics:&statistics],
+                          @"<div class=\"a\"> Hello world </div> <!--[if IE]><p>IE</p><![endif]-->");
+    XCTAssertEqual(statistics.commentsRemoved, 1u, @"Conditional comments are kept");
+    XCTAssert(statistics.outputLength < statistics.inputLength);
+}
+
+- (void)testMinifyKeepsRawTextAsItIs
+{
+    NSString *html = @"<pre>  a\n   b  </pre>\n\n<script>var s = '<b>  x  </b>';  // <!-- -->\n</SCRIPT>\n<textarea> t  </textarea>";
+
+    XCTAssertEqualObjects([self process:html options:AdHTMLProcessMinify statistics:NULL],
+                          @"<pre>  a\n   b  </pre> <script>var s = '<b>  x  </b>';  // <!-- -->\n</SCRIPT> <textarea> t  </textarea>");
+}
+
+- (void)testMRAIDScriptIsInlined
+{
+    AdHTMLStatistics statistics;
+    NSString *html = @"<head><script type=\"text/javascript\" src=\"http://cdn.example.com/sdk/MRAID.js?v=2\"></script><script src=\"ad.js\"></script></head>";
+
+    XCTAssertEqualObjects([self process:html options:AdHTMLProcessInlineMRAID statistics:&statistics],
+                          @"<head><script>window.mraid={};</script><script src=\"ad.js\"></script></head>");
+    XCTAssertEqual(statistics.inlinedScripts, 1u);
+}
+
+- (void)testAssetURLsAreRewrittenButNotLinks
+{
+    AdHTMLStatistics statistics;
+    NSMutableArray *urls = [NSMutableArray array];
+    NSString *html = @"<link rel=stylesheet href='s.css?a=1&amp;b=2'><img src=\"i.png\"><video poster=p.jpg></video><a href=\"http://click\">go</a>"
+                      "<script src=\"mraid.js\"></script>";
+    NSString *output = [self process:html options:AdHTMLProcessRewriteURLs rewrite:AdHTMLTestRewrite info:(__bridge void *)urls statistics:&statistics];
+
+    XCTAssertEqualObjects(urls, (@[@"s.css?a=1&b=2", @"i.png", @"p.jpg"]), @"URLs are decoded, mraid.js is left to the SDK");
+    XCTAssertEqualObjects(output, @"<link rel=stylesheet href='file:///cache/asset'><img src=\"file:///cache/asset\"><video poster=\"file:///cache/asset\"></video>"
+                                   "<a href=\"http://click\">go</a><script src=\"mraid.js\"></script>");
+    XCTAssertEqual(statistics.rewrittenURLs, 3u);
+}
+
+- (void)testFixtureCreativeNeedsNoMRAIDRequest
+{
+    NSData *data = [NSData dataWithContentsOfFile:[[NSBundle bundleForClass:[self class]] pathForResource:@"AdResponseHTML" ofType:@"json"]];
+    NSDictionary *response = [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL];
+    NSString *script = response[@"creativeScript"];
+    AdHTMLStatistics statistics;
+
+    XCTAssert([script length] > 0);
+    NSString *output = [self process:script options:AdHTMLProcessMinify | AdHTMLProcessInlineMRAID statistics:&statistics];
+    XCTAssertEqual(statistics.inlinedScripts, 1u);
+    XCTAssert([output rangeOfString:@"</div>\n"].location == NSNotFound);
+    XCTAssert([output rangeOfString:@"mraid.js"].location == NSNotFound);
+}
+
+@end
@@ -0,0 +1,98 @@
+//
+//  AdHistogramTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdHistogram.h"
+#import "AdLifecycleMetrics.h"
+
+@interface AdHistogramTests : XCTestCase
+{
+    AdHistogram *_histogram;
+}
+
+@end
+
+@implementation AdHistogramTests
+
+- (void)setUp
+{
+    [super setUp];
+    _histogram = malloc(sizeof(AdHistogram));
+    AdHistogramInit(_histogram);
+}
+
+- (void)tearDown
+{
+    free(_histogram);
+    [super tearDown];
+}
+
+- (void)testPercentilesWithinBucketPrecision
+{
+    for (uint64_t value = 1; value <= 100000; value++) {
+        AdHistogramRecord(_histogram, value);
+    }
+
+    XCTAssertEqual(_histogram->count, (uint64_t)100000);
+    XCTAssertEqual(AdHistogramValueAtPercentile(_histogram, 0), (uint64_t)1);
+    XCTAssertEqual(AdHistogramValueAtPercentile(_histogram, 100), (uint64_t)100000);
+    XCTAssertEqualWithAccuracy((double)AdHistogramValueAtPercentile(_histogram, 50), 50000.0, 50000.0 / 32);
+    XCTAssertEqualWithAccuracy((double)AdHistogramValueAtPercentile(_histogram, 99), 99000.0, 99000.0 / 32);
+    XCTAssertEqualWithAccuracy(AdHistogramMean(_histogram), 50000.5, 0.01);
+
+    AdHistogramRecord(_histogram, UINT64_MAX);
+    XCTAssertEqual(_histogram->max, (uint64_t)kAdHistogramMaxValue, @"Values are clamped");
+}
+
+- (void)testEncodingRoundTrip
+{
+    uint8_t *buffer = malloc(kAdHistogramMaxEncodedLength);
+    AdHistogram *decoded = malloc(sizeof(AdHistogram));
+    size_t length;
+
+    AdHistogramRecord(_histogram, 180000);
+    AdHistogramRecord(_histogram, 240000);
+    AdHistogramRecord(_histogram, 2500000);
+    length = AdHistogramEncode(_histogram, buffer);
+
+    XCTAssertTrue(length < 32, @"%zu bytes", length);
+    XCTAssertEqual(AdHistogramDecode(decoded, buffer, length), length);
+    XCTAssertEqual(memcmp(decoded, _histogram, sizeof(AdHistogram)), 0);
+    for (size_t truncated = 0; truncated < length; truncated++) {
+        XCTAssertEqual(AdHistogramDecode(decoded, buffer, truncated), (size_t)0);
+    }
+    free(buffer);
+    free(decoded);
+}
+
+- (void)testLifecycleSnapshotSummary
+{
+    AdLifecycleMetrics *metrics = [[AdLifecycleMetrics alloc] init];
+    SASAdView *adView = [[SASAdView alloc] initWithFrame:CGRectMake(0, 0, 320, 50)];
+    NSDictionary *summary, *phase;
+
+    [metrics adView:adView didStartLoadingFormatId:13534 pageId:@"374408"];
+    [NSThread sleepForTimeInterval:0.02];
+    [metrics adViewDidDownloadAdData:adView];
+    [metrics adViewDidLoad:adView];
+    [metrics adViewDidDisappear:adView];
+    [metrics adViewDidDisappear:adView];
+
+    summary = [AdLifecycleMetrics summaryOfSnapshot:[metrics snapshot]];
+    phase = summary[@"13534/374408/requestToDownload"];
+    XCTAssertEqualObjects(phase[@"count"], @1);
+    XCTAssertTrue([phase[@"p50"] doubleValue] >= 20, @"%@", phase);
+    XCTAssertEqualObjects(summary[@"13534/374408/displayToDismiss"][@"count"], @1, @"A view is dismissed once");
+    XCTAssertNil(summary[@"13534/374408/requestToFailure"]);
+
+    [metrics reset];
+    XCTAssertEqual([[AdLifecycleMetrics summaryOfSnapshot:[metrics snapshot]] count], (NSUInteger)0);
+}
+
+@end
@@ -0,0 +1,158 @@
+//
+//  AdLocationFeedTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdLocationFeed.h"
+
+@interface AdLocationFeedTests : XCTestCase
+{
+    AdLocationFeed *_feed;
+}
+
+@end
+
+@implementation AdLocationFeedTests
+
+- (void)setUp
+{
+    [super setUp];
+    _feed = AdLocationFeedCreate(NULL);
+    XCTAssert(_feed != NULL);
+}
+
+- (void)tearDown
+{
+    AdLocationFeedRelease(_feed);
+    [super tearDown];
+}
+
+- (AdLocationSnapshot)snapshot
+{
+    AdLocationSnapshot snapshot;
+    AdLocationFeedRead(_feed, &snapshot);
+    return snapshot;
+}
+
+- (void)testFixesAreQuantizedAndSmallMovesSuppressed
+{
+    AdLocationSnapshot snapshot = [self snapshot];
+    AdLocationFeedStatistics statistics;
+
+    XCTAssertEqual(snapshot.version, (uint64_t)0);
+    XCTAssertFalse(snapshot.hasLocation);
+    XCTAssertEqual(snapshot.heading, -1.0);
+
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.85661, 2.35222, 10, 100), 1);
+    snapshot = [self snapshot];
+    XCTAssertEqual(snapshot.version, (uint64_t)1);
+    XCTAssertEqualWithAccuracy(snapshot.latitude, 48.857, 1e-9);
+    XCTAssertEqualWithAccuracy(snapshot.longitude, 2.352, 1e-9);
+    XCTAssert(snapshot.accuracy > 70, @"No better than the quantization");
+
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.8568, 2.3518, 5, 110), 0, @"Same cell");
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.8568, 2.3528, 5, 120), 0, @"One cell east, 73 m");
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.8590, 2.3522, 5, 130), 1);
+    XCTAssertEqual(AdLocationFeedGetVersion(_feed), (uint64_t)2);
+
+    AdLocationFeedGetStatistics(_feed, &statistics);
+    XCTAssertEqual(statistics.locationUpdates, (uint64_t)4);
+    XCTAssertEqual(statistics.forwarded, (uint64_t)2);
+    XCTAssertEqual(statistics.suppressedQuantized, (uint64_t)1);
+    XCTAssertEqual(statistics.suppressedDistance, (uint64_t)1);
+}
+
+- (void)testHeadingsBelowTheAngleAreSuppressedAcrossTheNorth
+{
+    XCTAssertEqual(AdLocationFeedUpdateHeading(_feed, 355.4, 100), 1);
+    XCTAssertEqual([self snapshot].heading, 355.0);
+    XCTAssertEqual(AdLocationFeedUpdateHeading(_feed, 3, 110), 0, @"8 degrees away");
+    XCTAssertEqual(AdLocationFeedUpdateHeading(_feed, 6, 120), 1);
+    XCTAssertEqual([self snapshot].heading, 6.0);
+    XCTAssertEqual(AdLocationFeedUpdateHeading(_feed, -1, 130), -1, @"Invalid for CoreLocation");
+}
+
+- (void)testUpdatesTooSoonAreDeferredToTheDeadline
+{
+    AdLocationFeedStatistics statistics;
+
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.857, 2.352, 10, 100), 1);
+    XCTAssertEqual(AdLocationFeedUpdateHeading(_feed, 90, 100.2), 0);
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.870, 2.352, 10, 100.4), 0);
+    XCTAssertEqual(AdLocationFeedUpdateHeading(_feed, 120, 100.6), 0);
+    XCTAssertEqualWithAccuracy(AdLocationFeedGetDeadline(_feed), 101, 1e-9);
+    XCTAssertEqual(AdLocationFeedPoll(_feed, 100.9), 0);
+    XCTAssertEqual(AdLocationFeedGetVersion(_feed), (uint64_t)1);
+
+    XCTAssertEqual(AdLocationFeedPoll(_feed, 101), 1, @"The last location and heading in one snapshot");
+    XCTAssertEqual([self snapshot].version, (uint64_t)2);
+    XCTAssertEqualWithAccuracy([self snapshot].latitude, 48.870, 1e-9);
+    XCTAssertEqual([self snapshot].heading, 120.0);
+    XCTAssertEqual(AdLocationFeedGetDeadline(_feed), 0.0);
+
+    // Back where it was published before its deadline: the deferred fix is dropped.
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.900, 2.352, 10, 101.5), 0);
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.870, 2.352, 10, 101.7), 0);
+    XCTAssertEqual(AdLocationFeedGetDeadline(_feed), 0.0);
+
+    AdLocationFeedGetStatistics(_feed, &statistics);
+    XCTAssertEqual(statistics.snapshots, (uint64_t)2);
+    XCTAssertEqual(statistics.suppressedRate, (uint64_t)2);
+    XCTAssertEqual(statistics.locationUpdates + statistics.headingUpdates,
+                   statistics.forwarded + statistics.suppressedQuantized + statistics.suppressedDistance
+                   + statistics.suppressedHeading + statistics.suppressedRate + statistics.invalid);
+}
+
+- (void)testInvalidInputIsRejected
+{
+    AdLocationFeedConfiguration configuration = AdLocationFeedDefaultConfiguration;
+    AdLocationFeedStatistics statistics;
+
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 91, 0, 10, 100), -1);
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, 48.857, 2.352, -1, 100), -1);
+    XCTAssertEqual(AdLocationFeedUpdateLocation(_feed, NAN, 2.352, 10, 100), -1);
+    AdLocationFeedGetStatistics(_feed, &statistics);
+    XCTAssertEqual(statistics.invalid, (uint64_t)3);
+    XCTAssertEqual(AdLocationFeedGetVersion(_feed), (uint64_t)0);
+
+    configuration.coordinateDecimals = 7;
+    XCTAssert(AdLocationFeedCreate(&configuration) == NULL);
+}
+
+- (void)testSnapshotsAreReadWholeWhilePublished
+{
+    AdLocationFeedConfiguration configuration = { 6, 1, 0, 0, 0 };
+    AdLocationFeed *feed = AdLocationFeedCreate(&configuration);
+    __block BOOL torn = NO;
+    __block BOOL done = NO;
+    dispatch_group_t group = dispatch_group_create();
+
+    for (int reader = 0; reader < 2; reader++) {
+        dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            AdLocationSnapshot snapshot;
+
+            while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+                AdLocationFeedRead(feed, &snapshot);
+                if (snapshot.hasLocation && fabs(snapshot.longitude * 2 - snapshot.latitude) > 1e-5) {
+                    torn = YES;
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 200000; i++) {
+        double latitude = (double)(i % 80000) / 1000;
+
+        AdLocationFeedUpdateLocation(feed, latitude, latitude / 2, 1, i);
+    }
+    __atomic_store_n(&done, YES, __ATOMIC_RELEASE);
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    XCTAssertFalse(torn);
+    AdLocationFeedRelease(feed);
+}
+
+@end
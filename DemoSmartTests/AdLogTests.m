@@ -0,0 +1,125 @@
+//
+//  AdLogTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdLog.h"
+
+#include <pthread.h>
+
+static const int kAdLogBenchmarkThreads = 8;
+static const int kAdLogBenchmarkEvents = 200000;
+
+static void *AdLogBenchmarkWriter(void *argument)
+{
+    for (int i = 0; i < kAdLogBenchmarkEvents; i++) {
+        AdLogWrite(AdLogEventAdDataReceived, 13534, (uint64_t)i, 0, NULL);
+    }
+    return argument;
+}
+
+@interface AdLogTests : XCTestCase
+{
+    NSString *_directory;
+}
+
+@end
+
+@implementation AdLogTests
+
+- (void)setUp
+{
+    [super setUp];
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+- (void)tearDown
+{
+    AdLogClose();
+    AdLogSetLevel(AdLogLevelInfo);
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:NULL];
+    [super tearDown];
+}
+
+- (NSString *)decodeFile:(NSString *)name count:(long *)count
+{
+    NSString *path = [_directory stringByAppendingPathComponent:@"decoded.txt"];
+    FILE *output = fopen([path fileSystemRepresentation], "w");
+
+    *count = AdLogDecodeFile([[_directory stringByAppendingPathComponent:name] fileSystemRepresentation], output);
+    fclose(output);
+    return [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
+}
+
+- (void)testDecodedEventsAreFormatted
+{
+    NSString *text;
+    long count;
+
+    XCTAssertEqual(AdLogOpen([_directory fileSystemRepresentation], 1024 * 1024, 2), 0);
+    AdLogWrite(AdLogEventAdFailed, 13534, (uint64_t)-1001, 0, "The request timed out.");
+    AdLogWrite(AdLogEventMessage, 1, 2, 3, "below the level");
+    AdLogWrite(AdLogEventLaunchPhase, 412000, 0, 0, "firstFrame");
+    AdLogClose();
+
+    text = [self decodeFile:@"AdLog.bin" count:&count];
+    XCTAssertEqual(count, 2L);
+    XCTAssertTrue([text rangeOfString:@"W AdFailed: ad failed, format 13534, error -1001 (The request timed out.)"].location != NSNotFound, @"%@", text);
+    XCTAssertTrue([text rangeOfString:@"I LaunchPhase: launch phase firstFrame at 412000 us"].location != NSNotFound, @"%@", text);
+}
+
+- (void)testFilesRotate
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    long count;
+
+    XCTAssertEqual(AdLogOpen([_directory fileSystemRepresentation], 16 * 1024, 3), 0);
+    for (int i = 0; i < 2000; i++) {
+        AdLogWrite(AdLogEventAdLoaded, (uint64_t)i, 0, 0, NULL);
+        if (i % 500 == 0) {
+            AdLogFlush();
+        }
+    }
+    AdLogClose();
+
+    XCTAssertTrue(AdLogGetStatistics().rotations > 0);
+    XCTAssertTrue([fileManager fileExistsAtPath:[_directory stringByAppendingPathComponent:@"AdLog.2.bin"]]);
+    XCTAssertFalse([fileManager fileExistsAtPath:[_directory stringByAppendingPathComponent:@"AdLog.3.bin"]]);
+    [self decodeFile:@"AdLog.1.bin" count:&count];
+    XCTAssertTrue(count > 0, @"Every rotated file starts with its own event table");
+}
+
+- (void)testContendedWritesBenchmark
+{
+    pthread_t threads[kAdLogBenchmarkThreads];
+    AdLogStatistics before, after;
+    CFAbsoluteTime start, elapsed;
+    uint64_t events = (uint64_t)kAdLogBenchmarkThreads * kAdLogBenchmarkEvents;
+
+    XCTAssertEqual(AdLogOpen([_directory fileSystemRepresentation], 64 * 1024 * 1024, 1), 0);
+    before = AdLogGetStatistics();
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (int i = 0; i < kAdLogBenchmarkThreads; i++) {
+        pthread_create(&threads[i], NULL, AdLogBenchmarkWriter, NULL);
+    }
+    for (int i = 0; i < kAdLogBenchmarkThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = CFAbsoluteTimeGetCurrent() - start;
+    AdLogClose();
+    after = AdLogGetStatistics();
+
+    XCTAssertEqual((after.written - before.written) + (after.dropped - before.dropped), events);
+    NSLog(@"AdLog %d threads: %.1f ns/event (wall time per event per thread), %llu written, %llu dropped by full rings",
+          kAdLogBenchmarkThreads, elapsed * 1e9 * kAdLogBenchmarkThreads / events,
+          after.written - before.written, after.dropped - before.dropped);
+}
+
+@end
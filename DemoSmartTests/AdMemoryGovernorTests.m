@@ -0,0 +1,125 @@
+//
+//  AdMemoryGovernorTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdMemoryGovernor.h"
+
+typedef struct {
+    size_t cost;
+    unsigned trimCount;
+} AdMemoryTestConsumer;
+
+static size_t AdMemoryTestCost(void *info)
+{
+    return ((AdMemoryTestConsumer *)info)->cost;
+}
+
+static size_t AdMemoryTestTrim(void *info, size_t cost)
+{
+    AdMemoryTestConsumer *consumer = info;
+    size_t freed = consumer->cost > cost ? consumer->cost - cost : 0;
+
+    consumer->cost -= freed;
+    consumer->trimCount++;
+    return freed;
+}
+
+@interface AdMemoryGovernorTests : XCTestCase
+{
+    AdMemoryGovernor *_governor;
+    AdMemoryTestConsumer _images;
+    AdMemoryTestConsumer _payloads;
+    AdMemoryTestConsumer _views;
+}
+
+@end
+
+@implementation AdMemoryGovernorTests
+
+- (void)setUp
+{
+    [super setUp];
+    AdMemoryConsumer images = { "images", AdMemoryTierDecodedImages, &_images, AdMemoryTestCost, AdMemoryTestTrim };
+    AdMemoryConsumer payloads = { "payloads", AdMemoryTierPrefetchedAds, &_payloads, AdMemoryTestCost, AdMemoryTestTrim };
+    AdMemoryConsumer views = { "views", AdMemoryTierPooledViews, &_views, AdMemoryTestCost, AdMemoryTestTrim };
+
+    _governor = AdMemoryGovernorCreate();
+    // Registered out of tier order: the tiers, not the registration, decide.
+    XCTAssertEqual(AdMemoryGovernorAddConsumer(_governor, &views), 0);
+    XCTAssertEqual(AdMemoryGovernorAddConsumer(_governor, &payloads), 0);
+    XCTAssertEqual(AdMemoryGovernorAddConsumer(_governor, &images), 0);
+    XCTAssertEqual(AdMemoryGovernorAddConsumer(_governor, &images), -1, @"Names are unique");
+
+    _images = (AdMemoryTestConsumer){ 300, 0 };
+    _payloads = (AdMemoryTestConsumer){ 300, 0 };
+    _views = (AdMemoryTestConsumer){ 400, 0 };
+}
+
+- (void)tearDown
+{
+    AdMemoryGovernorRelease(_governor);
+    [super tearDown];
+}
+
+- (void)testWarningTrimsDecodedImagesFirst
+{
+    AdMemoryResponse response = AdMemoryGovernorRespond(_governor, AdMemoryPressureWarning);
+
+    XCTAssertEqual(response.costBefore, (size_t)1000);
+    XCTAssertEqual(response.goal, (size_t)250);
+    XCTAssertEqual(response.freed, (size_t)250);
+    XCTAssertEqual(_images.cost, (size_t)50);
+    XCTAssertEqual(_payloads.trimCount, 0u, @"The goal is met by the first tier");
+    XCTAssertEqual(_views.trimCount, 0u);
+}
+
+- (void)testWarningNeverTrimsPooledViews
+{
+    _images.cost = 0;
+    _payloads.cost = 100;
+
+    AdMemoryResponse response = AdMemoryGovernorRespond(_governor, AdMemoryPressureWarning);
+    XCTAssertEqual(response.goal, (size_t)125);
+    XCTAssertEqual(response.freed, (size_t)100);
+    XCTAssertEqual(_views.cost, (size_t)400);
+    XCTAssertEqual(response.freedByTier[AdMemoryTierPrefetchedAds], (size_t)100);
+}
+
+- (void)testResponsesScaleWithThePressure
+{
+    AdMemoryResponse response = AdMemoryGovernorRespond(_governor, AdMemoryPressureUrgent);
+
+    XCTAssertEqual(response.freed, (size_t)500);
+    XCTAssertEqual(response.freedByTier[AdMemoryTierDecodedImages], (size_t)300);
+    XCTAssertEqual(response.freedByTier[AdMemoryTierPrefetchedAds], (size_t)200);
+    XCTAssertEqual(response.freedByTier[AdMemoryTierPooledViews], (size_t)0);
+
+    response = AdMemoryGovernorRespond(_governor, AdMemoryPressureCritical);
+    XCTAssertEqual(response.freed, (size_t)500);
+    XCTAssertEqual(AdMemoryGovernorGetCost(_governor, AdMemoryTierCount), (size_t)0);
+    XCTAssertEqual(AdMemoryGovernorGetFreedTotal(_governor), (uint64_t)1000);
+    XCTAssertEqual(AdMemoryGovernorGetResponseCount(_governor, AdMemoryPressureUrgent), (uint32_t)1);
+    XCTAssertEqual(AdMemoryGovernorGetResponseCount(_governor, AdMemoryPressureCritical), (uint32_t)1);
+
+    response = AdMemoryGovernorRespond(_governor, AdMemoryPressureNone);
+    XCTAssertEqual(response.freed, (size_t)0);
+}
+
+- (void)testRemovedConsumersAreNotTrimmed
+{
+    XCTAssertEqual(AdMemoryGovernorRemoveConsumer(_governor, "images"), 0);
+    XCTAssertEqual(AdMemoryGovernorRemoveConsumer(_governor, "images"), -1);
+    XCTAssertEqual(AdMemoryGovernorGetCost(_governor, AdMemoryTierCount), (size_t)700);
+
+    AdMemoryGovernorRespond(_governor, AdMemoryPressureCritical);
+    XCTAssertEqual(_images.trimCount, 0u);
+    XCTAssertEqual(_images.cost, (size_t)300);
+}
+
+@end
@@ -0,0 +1,133 @@
+//
+//  AdPageCoordinatorTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdPageCoordinator.h"
+
+/** Records its calls instead of sending them. */
+@interface AdPageCoordinatorTestsView : SASAdView
+
+@property (nonatomic, copy) NSString *pageId;
+@property (nonatomic, assign) BOOL master;
+@property (nonatomic, assign) float timeout;
+@property (nonatomic, assign) NSUInteger loads;
+
+@end
+
+@implementation AdPageCoordinatorTestsView
+
+- (void)loadFormatId:(NSInteger)formatId pageId:(NSString *)pageId master:(BOOL)isMaster target:(NSString *)target
+{
+    [self loadFormatId:formatId pageId:pageId master:isMaster target:target timeout:-1];
+}
+
+- (void)loadFormatId:(NSInteger)formatId pageId:(NSString *)pageId master:(BOOL)isMaster target:(NSString *)target timeout:(float)timeout
+{
+    self.pageId = pageId;
+    self.master = isMaster;
+    self.timeout = timeout;
+    self.loads++;
+}
+
+@end
+
+@interface AdPageCoordinatorTests : XCTestCase
+{
+    AdPageCoordinator *_coordinator;
+}
+
+@end
+
+@implementation AdPageCoordinatorTests
+
+- (void)setUp
+{
+    [super setUp];
+    _coordinator = [[AdPageCoordinator alloc] init];
+}
+
+- (AdPageCoordinatorTestsView *)view
+{
+    return [[AdPageCoordinatorTestsView alloc] initWithFrame:CGRectMake(0, 0, 320, 50)];
+}
+
+- (void)testOneMasterCallByPage
+{
+    AdPageCoordinatorTestsView *banner = [self view], *square = [self view], *other = [self view];
+
+    [_coordinator loadAdView:banner formatId:1 pageId:@"374408" target:nil];
+    [_coordinator loadAdView:other formatId:1 pageId:@"374409" target:nil timeout:5];
+    [_coordinator loadAdView:square formatId:2 pageId:@"374408" target:nil];
+    XCTAssertEqual(banner.loads, (NSUInteger)0, @"Not before the end of the turn");
+    [_coordinator flush];
+
+    XCTAssertEqual(banner.loads + square.loads + other.loads, (NSUInteger)3);
+    XCTAssertTrue(banner.master);
+    XCTAssertFalse(square.master);
+    XCTAssertTrue(other.master);
+    XCTAssertEqual(other.timeout, 5.0f);
+    XCTAssertEqual(_coordinator.pageCount, (NSUInteger)2);
+    XCTAssertEqual(_coordinator.callCount, (NSUInteger)3);
+}
+
+- (void)testViewsWithoutAPageIdMakeAPage
+{
+    AdPageCoordinatorTestsView *first = [self view], *second = [self view];
+
+    [_coordinator loadAdView:first formatId:1 pageId:nil target:nil];
+    [_coordinator loadAdView:second formatId:2 pageId:nil target:nil];
+    [_coordinator flush];
+
+    XCTAssertNil(first.pageId, @"Passed on as given");
+    XCTAssertTrue(first.master);
+    XCTAssertFalse(second.master);
+    XCTAssertEqual(_coordinator.pageCount, (NSUInteger)1);
+}
+
+- (void)testRepeatedCallsAreNotMasters
+{
+    AdPageCoordinatorTestsView *hedge = [self view], *banner = [self view];
+
+    [_coordinator loadRepeatedAdView:hedge formatId:1 pageId:@"374408" target:nil timeout:2];
+    [_coordinator flush];
+    XCTAssertEqual(hedge.loads, (NSUInteger)1);
+    XCTAssertFalse(hedge.master);
+    XCTAssertEqual(_coordinator.pageCount, (NSUInteger)0, @"The page was counted with the first call");
+
+    [_coordinator loadRepeatedAdView:hedge formatId:1 pageId:@"374408" target:nil timeout:2];
+    [_coordinator loadAdView:banner formatId:2 pageId:@"374408" target:nil];
+    [_coordinator flush];
+    XCTAssertFalse(hedge.master);
+    XCTAssertTrue(banner.master, @"Registered after a repeated call, still the master");
+    XCTAssertEqual(_coordinator.pageCount, (NSUInteger)1);
+}
+
+- (void)testRemovedViewsAreNotLoaded
+{
+    AdPageCoordinatorTestsView *removed = [self view], *kept = [self view];
+
+    [_coordinator loadAdView:removed formatId:1 pageId:@"374408" target:nil];
+    [_coordinator loadAdView:kept formatId:1 pageId:@"374409" target:nil];
+    [_coordinator removeAdView:removed];
+    [_coordinator flush];
+    XCTAssertEqual(removed.loads, (NSUInteger)0);
+    XCTAssertEqual(kept.loads, (NSUInteger)1);
+    XCTAssertEqual(_coordinator.pageCount, (NSUInteger)1);
+}
+
+- (void)testTheEndOfTheTurnFlushes
+{
+    AdPageCoordinatorTestsView *banner = [self view];
+
+    [_coordinator loadAdView:banner formatId:1 pageId:@"374408" target:nil];
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    XCTAssertEqual(banner.loads, (NSUInteger)1);
+}
+
+@end
@@ -0,0 +1,229 @@
+//
+//  AdPipelineTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdCreativePipeline.h"
+#import "AdPipeline.h"
+
+#include <errno.h>
+#include <libkern/OSAtomic.h>
+#include <unistd.h>
+
+static const int kAdPipelineCorpusAds = 40;
+
+typedef struct {
+    volatile int64_t sum;
+    volatile int32_t completed;
+    volatile int32_t failed;
+} AdPipelineTestTotals;
+
+static int AdPipelineTestRejectMultiplesOfSeven(void *item, void *context)
+{
+    return (intptr_t)item % 7 == 0 ? 5 : 0;
+}
+
+static int AdPipelineTestSlowStage(void *item, void *context)
+{
+    usleep(100);
+    return 0;
+}
+
+static void AdPipelineTestComplete(void *item, int status, void *context)
+{
+    AdPipelineTestTotals *totals = context;
+
+    if (status == 0) {
+        OSAtomicAdd64((int64_t)(intptr_t)item, &totals->sum);
+        OSAtomicIncrement32(&totals->completed);
+    } else {
+        OSAtomicIncrement32(&totals->failed);
+    }
+}
+
+@interface AdPipelineTests : XCTestCase
+{
+    NSString *_directory;
+}
+
+@end
+
+@implementation AdPipelineTests
+
+- (void)setUp
+{
+    [super setUp];
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:NULL];
+    [super tearDown];
+}
+
+- (void)testEveryItemCompletesOnce
+{
+    AdPipelineTestTotals totals = { 0, 0, 0 };
+    AdPipelineStage stages[] = {
+        { AdPipelineTestRejectMultiplesOfSeven, NULL, 2, 4 },
+        { AdPipelineTestSlowStage, NULL, 4, 4 },
+    };
+    AdPipeline *pipeline = AdPipelineCreate(stages, 2, AdPipelineTestComplete, &totals);
+    int64_t expected = 0;
+    AdPipelineStatistics statistics;
+
+    for (intptr_t i = 1; i <= 2000; i++) {
+        AdPipelineSubmit(pipeline, (void *)i);
+        expected += i % 7 ? i : 0;
+    }
+    AdPipelineDrain(pipeline);
+    statistics = AdPipelineGetStatistics(pipeline);
+
+    XCTAssertEqual(totals.sum, expected);
+    XCTAssertEqual(totals.failed, (int32_t)(2000 / 7));
+    XCTAssertEqual(statistics.completed + statistics.failed, (uint64_t)2000);
+    XCTAssertEqual(statistics.inFlight, (uint32_t)0);
+    XCTAssertTrue(statistics.stalls > 0, @"The slow stage holds back the first one");
+    AdPipelineRelease(pipeline);
+}
+
+- (void)testTrySubmitFailsWhenFull
+{
+    AdPipelineTestTotals totals = { 0, 0, 0 };
+    AdPipelineStage stage = { AdPipelineTestSlowStage, NULL, 1, 2 };
+    AdPipeline *pipeline = AdPipelineCreate(&stage, 1, AdPipelineTestComplete, &totals);
+    int rejected = 0;
+
+    for (intptr_t i = 0; i < 50; i++) {
+        if (AdPipelineTrySubmit(pipeline, (void *)i) == EAGAIN) {
+            rejected++;
+        }
+    }
+    AdPipelineRelease(pipeline);
+
+    XCTAssertTrue(rejected > 0);
+    XCTAssertEqual(totals.completed, (int32_t)(50 - rejected));
+}
+
+#pragma mark - Creatives
+
+- (NSURL *)writeCreativeNamed:(NSString *)name size:(CGSize)size
+{
+    NSString *path = [_directory stringByAppendingPathComponent:name];
+
+    UIGraphicsBeginImageContextWithOptions(size, YES, 1);
+    for (CGFloat y = 0; y < size.height; y += 10) {
+        [[UIColor colorWithHue:y / size.height saturation:0.8 brightness:0.9 alpha:1] setFill];
+        UIRectFill(CGRectMake(0, y, size.width, 10));
+    }
+    [UIImagePNGRepresentation(UIGraphicsGetImageFromCurrentImageContext()) writeToFile:path atomically:NO];
+    UIGraphicsEndImageContext();
+    return [NSURL fileURLWithPath:path];
+}
+
+/** Portrait and landscape interstitials and banners, the creatives served on the demo placements. */
+- (NSArray *)corpus
+{
+    NSMutableArray *ads = [NSMutableArray array];
+
+    for (int i = 0; i < kAdPipelineCorpusAds; i++) {
+        SmartAdServerAd *ad = [[SmartAdServerAd alloc] init];
+        BOOL banner = i % 2;
+
+        ad.creativeType = CreativeTypeImage;
+        ad.imageSize = banner ? CGSizeMake(320, 50) : CGSizeMake(320, 480);
+        ad.landscapeImageSize = banner ? CGSizeMake(480, 32) : CGSizeMake(480, 320);
+        ad.creativeURL = [self writeCreativeNamed:[NSString stringWithFormat:@"%d-portrait.png", i] size:CGSizeMake(ad.imageSize.width * 2, ad.imageSize.height * 2)];
+        ad.creativeLandscapeUrl = [self writeCreativeNamed:[NSString stringWithFormat:@"%d-landscape.png", i] size:CGSizeMake(ad.landscapeImageSize.width * 2, ad.landscapeImageSize.height * 2)];
+        [ads addObject:ad];
+    }
+    return ads;
+}
+
+- (void)testPrefetchDecodesAtDisplaySize
+{
+    AdCreativePipeline *pipeline = [[AdCreativePipeline alloc] initWithFetchWorkers:2 decodeWorkers:1 capacity:2];
+    SmartAdServerAd *ad = [[self corpus] firstObject];
+    SmartAdServerAd *broken = [[SmartAdServerAd alloc] init];
+    UIImage *image;
+
+    pipeline.decodesImages = YES;
+    broken.creativeType = CreativeTypeImage;
+    broken.creativeURL = [NSURL fileURLWithPath:[_directory stringByAppendingPathComponent:@"missing.png"]];
+
+    [pipeline prefetchAd:ad completion:nil];
+    [pipeline prefetchAd:broken completion:nil];
+    [pipeline waitUntilIdle];
+
+    image = [pipeline imageForURL:ad.creativeURL];
+    XCTAssertNotNil(image);
+    XCTAssertTrue(CGSizeEqualToSize(image.size, ad.imageSize));
+    XCTAssertTrue(CGSizeEqualToSize([pipeline imageForURL:ad.creativeLandscapeUrl].size, ad.landscapeImageSize));
+    XCTAssertNil([pipeline imageForURL:broken.creativeURL]);
+    XCTAssertEqual([pipeline statistics].completed, (uint64_t)2);
+    XCTAssertEqual([pipeline statistics].failed, (uint64_t)1);
+}
+
+- (void)testImagesAreNotDecodedByDefault
+{
+    AdCreativePipeline *pipeline = [[AdCreativePipeline alloc] initWithFetchWorkers:2 decodeWorkers:1 capacity:2];
+    SmartAdServerAd *ad = [[self corpus] firstObject];
+
+    [pipeline prefetchAd:ad completion:nil];
+    [pipeline waitUntilIdle];
+
+    XCTAssertEqual([pipeline statistics].completed, (uint64_t)2);
+    XCTAssertNil([pipeline imageForURL:ad.creativeURL]);
+    XCTAssertEqual([pipeline decodedImageCost], (NSUInteger)0);
+}
+
+- (void)testCorpusThroughputBenchmark
+{
+    NSArray *corpus = [self corpus];
+    NSMutableDictionary *serialAssets = [NSMutableDictionary dictionary];
+    AdCreativePipeline *pipeline = [[AdCreativePipeline alloc] initWithFetchWorkers:4 decodeWorkers:2 capacity:8];
+    CFAbsoluteTime start, serial, pipelined;
+    CGFloat scale = [UIScreen mainScreen].scale;
+
+    pipeline.decodesImages = YES;
+
+    // Baseline: what happens without the pipeline, one asset after the other.
+    start = CFAbsoluteTimeGetCurrent();
+    for (SmartAdServerAd *ad in corpus) {
+        NSArray *assets = @[ @[ ad.creativeURL, [NSValue valueWithCGSize:ad.imageSize] ],
+                             @[ ad.creativeLandscapeUrl, [NSValue valueWithCGSize:ad.landscapeImageSize] ] ];
+        for (NSArray *asset in assets) {
+            @autoreleasepool {
+                UIImage *image = [UIImage imageWithData:[NSData dataWithContentsOfURL:asset[0]]];
+                CGSize size = [asset[1] CGSizeValue];
+                UIGraphicsBeginImageContextWithOptions(size, NO, scale);
+                [image drawInRect:CGRectMake(0, 0, size.width, size.height)];
+                serialAssets[asset[0]] = UIGraphicsGetImageFromCurrentImageContext();
+                UIGraphicsEndImageContext();
+            }
+        }
+    }
+    serial = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (SmartAdServerAd *ad in corpus) {
+        [pipeline prefetchAd:ad completion:nil];
+    }
+    [pipeline waitUntilIdle];
+    pipelined = CFAbsoluteTimeGetCurrent() - start;
+
+    XCTAssertEqual([pipeline statistics].completed, (uint64_t)(2 * kAdPipelineCorpusAds));
+    XCTAssertEqual([serialAssets count], (NSUInteger)(2 * kAdPipelineCorpusAds));
+    NSLog(@"AdCreativePipeline %d creatives: serial %.1f assets/s, pipeline %.1f assets/s (x%.2f), %llu stalls",
+          2 * kAdPipelineCorpusAds, 2 * kAdPipelineCorpusAds / serial, 2 * kAdPipelineCorpusAds / pipelined,
+          serial / pipelined, [pipeline statistics].stalls);
+}
+
+@end
@@ -0,0 +1,120 @@
+//
+//  AdRangeFileTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdRangeFile.h"
+
+#define kAdRangeTestLength 4096
+
+@interface AdRangeFileTests : XCTestCase
+{
+    NSString *_path;
+    AdRangeFile *_file;
+    uint8_t _video[kAdRangeTestLength];
+}
+
+@end
+
+@implementation AdRangeFileTests
+
+- (void)setUp
+{
+    [super setUp];
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    _file = AdRangeFileOpen(_path.fileSystemRepresentation);
+    XCTAssert(_file != NULL);
+    for (int i = 0; i < kAdRangeTestLength; i++) {
+        _video[i] = (uint8_t)(i * 31 + 7);
+    }
+    XCTAssertEqual(AdRangeFileSetValidator(_file, "\"v1\""), 0);
+    XCTAssertEqual(AdRangeFileSetLength(_file, kAdRangeTestLength), 0);
+}
+
+- (void)tearDown
+{
+    AdRangeFileClose(_file);
+    AdRangeFileRemove(_path.fileSystemRepresentation);
+    [super tearDown];
+}
+
+- (void)testRangesMergeWhenTheyTouch
+{
+    XCTAssertEqual(AdRangeFileWrite(_file, 0, _video, 1000), 0);
+    XCTAssertEqual(AdRangeFileWrite(_file, 2000, _video + 2000, 500), 0);
+    XCTAssertEqual(AdRangeFileGetRangeCount(_file), 2u);
+    XCTAssertEqual(AdRangeFileGetAvailable(_file, 100), (uint64_t)900);
+    XCTAssertEqual(AdRangeFileGetAvailable(_file, 1000), (uint64_t)0);
+
+    XCTAssertEqual(AdRangeFileWrite(_file, 1000, _video + 1000, 1000), 0);
+    XCTAssertEqual(AdRangeFileGetRangeCount(_file), 1u);
+    XCTAssertEqual(AdRangeFileGetCachedBytes(_file), (uint64_t)2500);
+
+    uint8_t bytes[kAdRangeTestLength];
+    XCTAssertEqual(AdRangeFileRead(_file, 10, bytes, sizeof(bytes)), (ssize_t)2490, @"Reads stop at the first gap");
+    XCTAssertEqual(memcmp(bytes, _video + 10, 2490), 0);
+}
+
+- (void)testNextMissingFindsTheGapsInOrder
+{
+    AdRange range;
+
+    XCTAssertEqual(AdRangeFileWrite(_file, 500, _video + 500, 500), 0);
+    XCTAssertEqual(AdRangeFileGetNextMissing(_file, 0, 2000, 10000, &range), 0);
+    XCTAssertEqual(range.start, (uint64_t)0);
+    XCTAssertEqual(range.end, (uint64_t)500);
+    XCTAssertEqual(AdRangeFileGetNextMissing(_file, 600, 2000, 300, &range), 0);
+    XCTAssertEqual(range.start, (uint64_t)1000);
+    XCTAssertEqual(range.end, (uint64_t)1300, @"Clipped to the chunk");
+    XCTAssertEqual(AdRangeFileGetNextMissing(_file, 4000, UINT64_MAX, 10000, &range), 0);
+    XCTAssertEqual(range.end, (uint64_t)kAdRangeTestLength, @"Clipped to the length");
+    XCTAssertEqual(AdRangeFileGetNextMissing(_file, 500, 1000, 10000, &range), -1);
+}
+
+- (void)testFillingEveryGapCompletesTheFile
+{
+    AdRange range;
+
+    XCTAssertEqual(AdRangeFileWrite(_file, 1234, _video + 1234, 99), 0);
+    while (AdRangeFileGetNextMissing(_file, 0, UINT64_MAX, 512, &range) == 0) {
+        XCTAssertEqual(AdRangeFileWrite(_file, range.start, _video + range.start, (size_t)(range.end - range.start)), 0);
+    }
+    XCTAssertTrue(AdRangeFileIsComplete(_file));
+    XCTAssertEqual(AdRangeFileGetRangeCount(_file), 1u);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:_path], [NSData dataWithBytes:_video length:kAdRangeTestLength]);
+    XCTAssertEqual(AdRangeFileWrite(_file, kAdRangeTestLength - 1, _video, 2), -1, @"Past the length");
+}
+
+- (void)testRangesSurviveReopening
+{
+    XCTAssertEqual(AdRangeFileWrite(_file, 0, _video, 700), 0);
+    XCTAssertEqual(AdRangeFileWrite(_file, 3000, _video + 3000, 100), 0);
+    AdRangeFileClose(_file);
+
+    _file = AdRangeFileOpen(_path.fileSystemRepresentation);
+    XCTAssertEqual(AdRangeFileGetLength(_file), (uint64_t)kAdRangeTestLength);
+    XCTAssertEqual(strcmp(AdRangeFileGetValidator(_file), "\"v1\""), 0);
+    XCTAssertEqual(AdRangeFileGetRangeCount(_file), 2u);
+    XCTAssertEqual(AdRangeFileGetCachedBytes(_file), (uint64_t)800);
+}
+
+- (void)testAChangedCreativeDiscardsTheCachedBytes
+{
+    XCTAssertEqual(AdRangeFileWrite(_file, 0, _video, 700), 0);
+    XCTAssertEqual(AdRangeFileSetValidator(_file, "\"v1\""), 0);
+    XCTAssertEqual(AdRangeFileSetValidator(_file, "\"v2\""), 1);
+    XCTAssertEqual(AdRangeFileGetCachedBytes(_file), (uint64_t)0);
+    XCTAssertEqual(AdRangeFileGetLength(_file), (uint64_t)0);
+
+    XCTAssertEqual(AdRangeFileSetLength(_file, kAdRangeTestLength), 0);
+    XCTAssertEqual(AdRangeFileWrite(_file, 0, _video, 700), 0);
+    XCTAssertEqual(AdRangeFileSetLength(_file, 2 * kAdRangeTestLength), 1);
+    XCTAssertEqual(AdRangeFileGetCachedBytes(_file), (uint64_t)0);
+}
+
+@end
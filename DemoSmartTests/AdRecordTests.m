@@ -0,0 +1,168 @@
+//
+//  AdRecordTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "SmartAdServerAd+AdRecord.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const NSUInteger kAdRecordBenchmarkCount = 500;
+
+@interface AdRecordTests : XCTestCase
+
+@end
+
+@implementation AdRecordTests
+
+- (SmartAdServerAd *)sampleAdWithInsertionId:(NSInteger)insertionId
+{
+    SmartAdServerAd *ad = [[SmartAdServerAd alloc] init];
+    ad.insertionId = insertionId;
+    ad.expirationDate = [NSDate dateWithTimeIntervalSince1970:1790000000];
+    ad.duration = 8;
+    ad.creativeType = CreativeTypeHtml;
+    ad.skipPosition = SkipBottomLeft;
+    ad.skip = YES;
+    ad.isSkipPositionDefined = YES;
+    ad.askConfirmationBeforeClosingApp = YES;
+    ad.imageSize = CGSizeMake(320, 480);
+    ad.landscapeImageSize = CGSizeMake(480, 320);
+    ad.videoSize = CGSizeMake(640, 360);
+    ad.backgroundColor = [UIColor colorWithRed:0.25 green:0.5 blue:0.75 alpha:1];
+    ad.creativeURL = [NSURL URLWithString:@"http://cdn.example.com/creative/portrait.png"];
+    ad.creativeLandscapeUrl = [NSURL URLWithString:@"http://cdn.example.com/creative/landscape.png"];
+    ad.redirectURL = [NSURL URLWithString:@"http://www.example.com/landing"];
+    ad.countURL = [NSURL URLWithString:@"http://mobile.smartadserver.com/click?iid=1"];
+    ad.impPixel = [NSURL URLWithString:@"http://mobile.smartadserver.com/imp?iid=1"];
+    ad.impLandscapePixel = [NSURL URLWithString:@"http://mobile.smartadserver.com/imp?iid=1&o=l"];
+    ad.agencyPortraitPixels = @[[NSURL URLWithString:@"http://agency.example.com/p1"], [NSURL URLWithString:@"http://agency.example.com/p2"]];
+    ad.agencyLandscapePixels = @[[NSURL URLWithString:@"http://agency.example.com/l1"]];
+    ad.text = @"Découvrir";
+    ad.creativeScript = @"<html><body><script>document.write('hello');</script></body></html>";
+    ad.creativeScriptURL = [NSURL URLWithString:@"http://cdn.example.com/creative/index.html"];
+    return ad;
+}
+
+- (void)testRoundTrip
+{
+    SmartAdServerAd *ad = [self sampleAdWithInsertionId:4242];
+    NSData *data = [ad adRecordData];
+    SmartAdServerAd *decoded = [SmartAdServerAd adWithAdRecordBytes:[data bytes] length:[data length]];
+
+    XCTAssertNotNil(decoded, @"A freshly encoded record must validate");
+    XCTAssertEqual(decoded.insertionId, ad.insertionId);
+    XCTAssertEqualObjects(decoded.expirationDate, ad.expirationDate);
+    XCTAssertEqual(decoded.duration, ad.duration);
+    XCTAssertEqual(decoded.creativeType, ad.creativeType);
+    XCTAssertEqual(decoded.skipPosition, ad.skipPosition);
+    XCTAssertTrue(decoded.skip && decoded.isSkipPositionDefined && decoded.askConfirmationBeforeClosingApp);
+    XCTAssertFalse(decoded.expand || decoded.videoAutoPlay);
+    XCTAssertTrue(CGSizeEqualToSize(decoded.imageSize, ad.imageSize));
+    XCTAssertTrue(CGSizeEqualToSize(decoded.landscapeImageSize, ad.landscapeImageSize));
+    XCTAssertTrue(CGSizeEqualToSize(decoded.videoSize, ad.videoSize));
+    XCTAssertEqualObjects(decoded.creativeURL, ad.creativeURL);
+    XCTAssertEqualObjects(decoded.creativeLandscapeUrl, ad.creativeLandscapeUrl);
+    XCTAssertEqualObjects(decoded.redirectURL, ad.redirectURL);
+    XCTAssertNil(decoded.redirectLandscapeURL);
+    XCTAssertEqualObjects(decoded.countURL, ad.countURL);
+    XCTAssertEqualObjects(decoded.impPixel, ad.impPixel);
+    XCTAssertEqualObjects(decoded.impLandscapePixel, ad.impLandscapePixel);
+    XCTAssertEqualObjects(decoded.agencyPortraitPixels, ad.agencyPortraitPixels);
+    XCTAssertEqualObjects(decoded.agencyLandscapePixels, ad.agencyLandscapePixels);
+    XCTAssertEqualObjects(decoded.text, ad.text);
+    XCTAssertEqualObjects(decoded.creativeScript, ad.creativeScript);
+    XCTAssertEqualObjects(decoded.creativeScriptURL, ad.creativeScriptURL);
+    XCTAssertNil(decoded.textColor);
+}
+
+- (void)testFieldsAreReadableInPlace
+{
+    SmartAdServerAd *ad = [self sampleAdWithInsertionId:7];
+    NSData *data = [ad adRecordData];
+    const AdRecordHeader *record = AdRecordValidate([data bytes], [data length]);
+    AdRecordSlice script;
+
+    XCTAssertTrue(record != NULL);
+    script = AdRecordGetString(record, AdRecordStringCreativeScript);
+    XCTAssertTrue(script.bytes >= (const char *)[data bytes] && script.bytes < (const char *)[data bytes] + [data length], @"Strings must point into the record");
+    XCTAssertEqual(strcmp(script.bytes, [ad.creativeScript UTF8String]), 0);
+    XCTAssertEqual(AdRecordGetListCount(record, AdRecordListAgencyPortraitPixels), (uint32_t)2);
+    XCTAssertEqual(strcmp(AdRecordGetListItem(record, AdRecordListAgencyPortraitPixels, 1).bytes, "http://agency.example.com/p2"), 0);
+}
+
+- (void)testRejectsDamagedRecords
+{
+    NSData *data = [[self sampleAdWithInsertionId:1] adRecordData];
+    NSMutableData *damaged = [data mutableCopy];
+    AdRecordHeader *header = [damaged mutableBytes];
+
+    XCTAssertTrue(AdRecordValidate([data bytes], [data length] - 1) == NULL, @"Truncated records must be rejected");
+
+    header->strings[AdRecordStringCreativeScript].length += 4096;
+    XCTAssertTrue(AdRecordValidate([damaged bytes], [damaged length]) == NULL, @"Out of bounds slots must be rejected");
+
+    header = [damaged mutableBytes];
+    memcpy(header, [data bytes], sizeof(AdRecordHeader));
+    header->version = kAdRecordVersion + 1;
+    XCTAssertTrue(AdRecordValidate([damaged bytes], [damaged length]) == NULL, @"Unknown versions must be rejected");
+}
+
+- (void)testBenchmarkAgainstKeyedArchiver
+{
+    NSMutableArray *ads = [NSMutableArray arrayWithCapacity:kAdRecordBenchmarkCount];
+    AdRecordBuilder *builder = AdRecordBuilderCreate();
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:kAdRecordBenchmarkCount];
+    NSMutableArray *archives = [NSMutableArray arrayWithCapacity:kAdRecordBenchmarkCount];
+    CFAbsoluteTime start, recordEncode, recordDecode, archiveEncode, archiveDecode;
+    NSUInteger recordBytes = 0, archiveBytes = 0;
+    NSUInteger i;
+
+    for (i = 0; i < kAdRecordBenchmarkCount; i++) {
+        [ads addObject:[self sampleAdWithInsertionId:i]];
+    }
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (SmartAdServerAd *ad in ads) {
+        size_t length;
+        const void *bytes = [ad writeAdRecordWithBuilder:builder length:&length];
+        [records addObject:[NSData dataWithBytes:bytes length:length]];
+        recordBytes += length;
+    }
+    recordEncode = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSData *data in records) {
+        XCTAssertNotNil([SmartAdServerAd adWithAdRecordBytes:[data bytes] length:[data length]]);
+    }
+    recordDecode = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (SmartAdServerAd *ad in ads) {
+        NSData *data = [NSKeyedArchiver archivedDataWithRootObject:ad];
+        [archives addObject:data];
+        archiveBytes += [data length];
+    }
+    archiveEncode = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSData *data in archives) {
+        XCTAssertNotNil([NSKeyedUnarchiver unarchiveObjectWithData:data]);
+    }
+    archiveDecode = CFAbsoluteTimeGetCurrent() - start;
+
+    AdRecordBuilderRelease(builder);
+
+    NSLog(@"AdRecord      encode %.1f us/ad, decode %.1f us/ad, %lu bytes/ad",
+          recordEncode * 1e6 / kAdRecordBenchmarkCount, recordDecode * 1e6 / kAdRecordBenchmarkCount, (unsigned long)(recordBytes / kAdRecordBenchmarkCount));
+    NSLog(@"NSKeyedArchiver encode %.1f us/ad, decode %.1f us/ad, %lu bytes/ad",
+          archiveEncode * 1e6 / kAdRecordBenchmarkCount, archiveDecode * 1e6 / kAdRecordBenchmarkCount, (unsigned long)(archiveBytes / kAdRecordBenchmarkCount));
+}
+
+@end
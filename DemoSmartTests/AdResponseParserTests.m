@@ -0,0 +1,148 @@
+//
+//  AdResponseParserTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdResponseParser.h"
+#import "SmartAdServerAd+AdRecord.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const NSUInteger kAdResponseFuzzIterations = 20000;
+
+@interface AdResponseParserTests : XCTestCase
+{
+    AdResponseParser *_parser;
+}
+
+@end
+
+@implementation AdResponseParserTests
+
+- (void)setUp
+{
+    [super setUp];
+    _parser = AdResponseParserCreate();
+}
+
+- (void)tearDown
+{
+    AdResponseParserRelease(_parser);
+    [super tearDown];
+}
+
+- (NSData *)fixtureNamed:(NSString *)name
+{
+    return [NSData dataWithContentsOfFile:[[NSBundle bundleForClass:[self class]] pathForResource:name ofType:@"json"]];
+}
+
+- (AdResponseStatus)feed:(NSData *)data chunkSize:(NSUInteger)chunkSize
+{
+    AdResponseStatus status = AdResponseStatusNeedMore;
+
+    AdResponseParserReset(_parser);
+    for (NSUInteger offset = 0; offset < [data length] && status == AdResponseStatusNeedMore; offset += chunkSize) {
+        status = AdResponseParserFeed(_parser, (const char *)[data bytes] + offset, MIN(chunkSize, [data length] - offset));
+    }
+    return status;
+}
+
+- (void)testFixturesMatchJSONSerialization
+{
+    for (NSString *name in @[@"AdResponseImage", @"AdResponseHTML", @"AdResponseVideo"]) {
+        NSData *data = [self fixtureNamed:name];
+        NSDictionary *fields = [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL];
+        SmartAdServerAd *ad;
+        size_t length;
+        const AdRecordHeader *record;
+
+        XCTAssertEqual([self feed:data chunkSize:[data length]], AdResponseStatusComplete, @"%@", name);
+        record = AdResponseParserGetRecord(_parser, &length);
+        XCTAssertTrue(record != NULL && AdRecordValidate(record, length) == record, @"%@ must be a valid record in place", name);
+
+        ad = [SmartAdServerAd adWithAdRecord:record];
+        XCTAssertEqual(ad.insertionId, [fields[@"insertionId"] integerValue]);
+        XCTAssertEqualWithAccuracy([ad.expirationDate timeIntervalSince1970], [fields[@"expirationDate"] doubleValue], 0.001);
+        XCTAssertEqual(ad.creativeType, (CreativeType)[fields[@"creativeType"] intValue]);
+        XCTAssertEqual(ad.skip, [fields[@"skip"] boolValue]);
+        XCTAssertEqual(ad.imageSize.width, (CGFloat)[fields[@"imageSize"][0] doubleValue]);
+        XCTAssertEqualObjects([ad.creativeURL absoluteString], fields[@"creativeURL"]);
+        XCTAssertEqualObjects([ad.impPixel absoluteString], fields[@"impPixel"]);
+        XCTAssertEqualObjects(ad.text, fields[@"text"]);
+        XCTAssertEqualObjects(ad.creativeScript, fields[@"creativeScript"], @"Escapes, surrogate pairs included, are decoded");
+        XCTAssertEqual([ad.agencyPortraitPixels count], [fields[@"agencyPortraitPixels"] count]);
+    }
+}
+
+- (void)testEverySplitGivesTheSameRecord
+{
+    NSData *data = [self fixtureNamed:@"AdResponseImage"];
+    NSData *expected;
+    size_t length;
+    const AdRecordHeader *record;
+
+    XCTAssertEqual([self feed:data chunkSize:[data length]], AdResponseStatusComplete);
+    record = AdResponseParserGetRecord(_parser, &length);
+    expected = [NSData dataWithBytes:record length:length];
+
+    for (NSUInteger chunkSize = 1; chunkSize < [data length]; chunkSize++) {
+        XCTAssertEqual([self feed:data chunkSize:chunkSize], AdResponseStatusComplete);
+        record = AdResponseParserGetRecord(_parser, &length);
+        XCTAssertEqualObjects([[SmartAdServerAd adWithAdRecord:record] adRecordData], [[SmartAdServerAd adWithAdRecord:[expected bytes]] adRecordData],
+                              @"Chunks of %lu bytes", (unsigned long)chunkSize);
+    }
+}
+
+- (void)testMalformedResponses
+{
+    NSArray *responses = @[@"[]", @"{\"a\" 1}", @"{\"a\":tru}", @"{\"a\":01}", @"{\"a\":\"\\x\"}", @"{\"a\":1,}", @"{\"a\":[1}",
+                           @"{\"text\":\"\x01\"}", @"{\"a\":-}"];
+    NSMutableString *deep = [NSMutableString stringWithString:@"{\"a\":"];
+
+    for (NSString *response in responses) {
+        XCTAssertEqual([self feed:[response dataUsingEncoding:NSUTF8StringEncoding] chunkSize:1], AdResponseStatusError, @"%@", response);
+    }
+    for (int i = 0; i < kAdResponseMaxDepth; i++) {
+        [deep appendString:@"["];
+    }
+    XCTAssertEqual([self feed:[deep dataUsingEncoding:NSUTF8StringEncoding] chunkSize:7], AdResponseStatusError);
+    XCTAssertEqual(AdResponseParserGetErrorOffset(_parser), (size_t)(5 + kAdResponseMaxDepth - 1));
+}
+
+- (void)testFuzzedResponses
+{
+    NSArray *fixtures = @[[self fixtureNamed:@"AdResponseImage"], [self fixtureNamed:@"AdResponseHTML"], [self fixtureNamed:@"AdResponseVideo"]];
+    static const char tokens[] = "{}[]\",:\\u0123456789eE.-+tfn ";
+    NSUInteger complete = 0;
+
+    srandom(42);
+    for (NSUInteger i = 0; i < kAdResponseFuzzIterations; i++) {
+        NSMutableData *data = [fixtures[i % [fixtures count]] mutableCopy];
+        int mutations = 1 + (int)(random() % 8);
+
+        for (int j = 0; j < mutations; j++) {
+            NSUInteger position = (NSUInteger)random() % [data length];
+            char byte = random() % 2 ? tokens[random() % (sizeof(tokens) - 1)] : (char)random();
+            switch (random() % 3) {
+                case 0: [data replaceBytesInRange:NSMakeRange(position, 1) withBytes:&byte]; break;
+                case 1: [data replaceBytesInRange:NSMakeRange(position, 1) withBytes:NULL length:0]; break;
+                default: [data replaceBytesInRange:NSMakeRange(position, 0) withBytes:&byte length:1]; break;
+            }
+        }
+        if ([self feed:data chunkSize:1 + (NSUInteger)random() % 1500] == AdResponseStatusComplete) {
+            size_t length;
+            const AdRecordHeader *record = AdResponseParserGetRecord(_parser, &length);
+            XCTAssertTrue(AdRecordValidate(record, length) == record, @"Iteration %lu", (unsigned long)i);
+            complete++;
+        }
+    }
+    XCTAssertTrue(complete > 0, @"Some mutations keep the response valid");
+}
+
+@end
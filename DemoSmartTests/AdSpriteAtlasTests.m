@@ -0,0 +1,166 @@
+//
+//  AdSpriteAtlasTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <UIKit/UIKit.h>
+
+#import "AdSpriteAtlas.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+@interface AdSpriteAtlasTests : XCTestCase
+{
+    NSString *_path;
+}
+
+@end
+
+@implementation AdSpriteAtlasTests
+
+- (void)setUp
+{
+    [super setUp];
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"AdSpriteAtlasTests.adatlas"];
+}
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:NULL];
+    [super tearDown];
+}
+
+- (NSString *)imagesDirectory
+{
+    return [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:@"sas.bundle/images"];
+}
+
+- (AdSpriteAtlas *)openBuiltAtlasWithScale:(uint32_t)scale
+{
+    NSString *name = scale == 1 ? @"sprites.adatlas" : [NSString stringWithFormat:@"sprites@%ux.adatlas", scale];
+
+    return AdSpriteAtlasOpen([[[self imagesDirectory] stringByAppendingPathComponent:name] fileSystemRepresentation]);
+}
+
+- (void)testBuiltAtlasesHoldTheImagesOfSASBundle
+{
+    NSArray *names = @[@"back-icon", @"forward-icon", @"loader", @"mraid_close_button", @"mute-button", @"skip-button", @"unmute-button"];
+
+    for (uint32_t scale = 1; scale <= 2; scale++) {
+        AdSpriteAtlas *atlas = [self openBuiltAtlasWithScale:scale];
+
+        XCTAssert(atlas != NULL, @"The @%ux atlas is written by the build phase", scale);
+        XCTAssertEqual(AdSpriteAtlasGetScale(atlas), scale);
+        XCTAssertEqual(AdSpriteAtlasGetCount(atlas), [names count]);
+        for (NSString *name in names) {
+            NSString *file = scale == 1 ? name : [name stringByAppendingFormat:@"@%ux", scale];
+            CGImageRef image = [[UIImage imageWithContentsOfFile:[[[self imagesDirectory] stringByAppendingPathComponent:file] stringByAppendingPathExtension:@"png"]] CGImage];
+            AdSpriteRect rect;
+
+            XCTAssertEqual(AdSpriteAtlasFind(atlas, [name UTF8String], &rect), 0, @"%@", name);
+            XCTAssertEqual((size_t)rect.width, CGImageGetWidth(image), @"%@", file);
+            XCTAssertEqual((size_t)rect.height, CGImageGetHeight(image), @"%@", file);
+        }
+        AdSpriteAtlasClose(atlas);
+    }
+}
+
+- (void)testPixelsArePremultipliedBGRA
+{
+    AdSpriteAtlas *atlas = [self openBuiltAtlasWithScale:2];
+    CGImageRef image = [[UIImage imageWithContentsOfFile:[[self imagesDirectory] stringByAppendingPathComponent:@"back-icon@2x.png"]] CGImage];
+    size_t width = CGImageGetWidth(image), height = CGImageGetHeight(image), bytesPerRow;
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, width * 4, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    const uint8_t *drawn, *pixels = AdSpriteAtlasGetPixels(atlas, NULL, NULL, &bytesPerRow);
+    NSUInteger differences = 0;
+    AdSpriteRect rect;
+
+    XCTAssertEqual(AdSpriteAtlasFind(atlas, "back-icon", &rect), 0);
+    CGContextSetBlendMode(context, kCGBlendModeCopy);
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), image);
+    drawn = CGBitmapContextGetData(context);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width * 4; x++) {
+            differences += abs(drawn[y * width * 4 + x] - pixels[(rect.y + y) * bytesPerRow + rect.x * 4 + x]) > 1;
+        }
+    }
+    XCTAssertEqual(differences, (NSUInteger)0, @"The atlas has the pixels Core Graphics decodes, to the rounding");
+    CGContextRelease(context);
+    CGColorSpaceRelease(colorSpace);
+    AdSpriteAtlasClose(atlas);
+}
+
+- (void)testWrittenSpritesAreFoundWithTheirPixels
+{
+    uint32_t red[6], green[12], blue[1];
+    AdSpriteSource sources[] = { { "red", 3, 2, red }, { "blue", 1, 1, blue }, { "green", 4, 3, green } };
+    AdSpriteRect rects[3];
+    const uint8_t *pixels;
+    uint32_t width, height;
+    size_t bytesPerRow;
+    AdSpriteAtlas *atlas;
+
+    for (int i = 0; i < 12; i++) {
+        green[i] = 0xff00ff00;
+        red[i % 6] = 0xffff0000;
+    }
+    blue[0] = 0x800000ff;
+    XCTAssertEqual(AdSpriteAtlasWrite([_path fileSystemRepresentation], sources, 3, 2, 1), 0);
+    atlas = AdSpriteAtlasOpen([_path fileSystemRepresentation]);
+    XCTAssert(atlas != NULL);
+    XCTAssertEqual(AdSpriteAtlasGetScale(atlas), 2u);
+    XCTAssertEqual(AdSpriteAtlasGetCount(atlas), (size_t)3);
+    XCTAssertEqualObjects(@(AdSpriteAtlasGetSprite(atlas, 0, NULL)), @"blue", @"In the order of the names");
+    XCTAssertEqualObjects(@(AdSpriteAtlasGetSprite(atlas, 2, NULL)), @"red");
+    XCTAssert(AdSpriteAtlasGetSprite(atlas, 3, NULL) == NULL);
+
+    pixels = AdSpriteAtlasGetPixels(atlas, &width, &height, &bytesPerRow);
+    XCTAssertEqual((uintptr_t)pixels % (uintptr_t)getpagesize(), (uintptr_t)0, @"The pixels start on a page");
+    for (int i = 0; i < 3; i++) {
+        XCTAssertEqual(AdSpriteAtlasFind(atlas, sources[i].name, &rects[i]), 0);
+        XCTAssertEqual(rects[i].width, sources[i].width);
+        XCTAssertEqual(rects[i].height, sources[i].height);
+        XCTAssert(rects[i].x >= 1 && rects[i].y >= 1 && rects[i].x + rects[i].width < width + 1 && rects[i].y + rects[i].height < height + 1);
+        for (uint32_t y = 0; y < rects[i].height; y++) {
+            XCTAssertEqual(memcmp(pixels + (rects[i].y + y) * bytesPerRow + rects[i].x * 4, (const uint8_t *)sources[i].pixels + y * sources[i].width * 4,
+                                  sources[i].width * 4), 0, @"%s", sources[i].name);
+        }
+        XCTAssertEqual(*(const uint32_t *)(pixels + (rects[i].y - 1) * bytesPerRow + (rects[i].x - 1) * 4), 0u, @"Transparent padding");
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = i + 1; j < 3; j++) {
+            XCTAssert(rects[i].x + rects[i].width < rects[j].x || rects[j].x + rects[j].width < rects[i].x
+                      || rects[i].y + rects[i].height < rects[j].y || rects[j].y + rects[j].height < rects[i].y, @"Separated by the padding");
+        }
+    }
+    XCTAssertEqual(AdSpriteAtlasFind(atlas, "yellow", NULL), -1);
+    XCTAssertEqual(errno, ENOENT);
+    AdSpriteAtlasClose(atlas);
+}
+
+- (void)testInvalidInputsAreRejected
+{
+    uint32_t pixel = 0;
+    AdSpriteSource duplicates[] = { { "a", 1, 1, &pixel }, { "a", 1, 1, &pixel } };
+    NSData *atlas;
+
+    XCTAssertEqual(AdSpriteAtlasWrite([_path fileSystemRepresentation], duplicates, 2, 1, 1), -1);
+    XCTAssertEqual(errno, EEXIST);
+    duplicates[1].width = 0;
+    XCTAssertEqual(AdSpriteAtlasWrite([_path fileSystemRepresentation], duplicates, 2, 1, 1), -1);
+    XCTAssertEqual(errno, EINVAL);
+
+    XCTAssertEqual(AdSpriteAtlasWrite([_path fileSystemRepresentation], duplicates, 1, 1, 1), 0);
+    atlas = [NSData dataWithContentsOfFile:_path];
+    [[atlas subdataWithRange:NSMakeRange(0, [atlas length] - 1)] writeToFile:_path atomically:YES];
+    XCTAssert(AdSpriteAtlasOpen([_path fileSystemRepresentation]) == NULL);
+    XCTAssertEqual(errno, EINVAL);
+}
+
+@end
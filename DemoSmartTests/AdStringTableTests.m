@@ -0,0 +1,151 @@
+//
+//  AdStringTableTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdStringTable.h"
+
+#include <errno.h>
+
+static void AdStringTableTestRecordDuplicate(void *info, const char *key, unsigned line, unsigned firstLine, int sameValue)
+{
+    [(__bridge NSMutableArray *)info addObject:[NSString stringWithFormat:@"%@ %u %u %d", @(key), line, firstLine, sameValue]];
+}
+
+@interface AdStringTableTests : XCTestCase
+{
+    NSMutableArray *_compiledTables;    // the bytes of the tables created by the test
+}
+
+@end
+
+@implementation AdStringTableTests
+
+- (void)setUp
+{
+    [super setUp];
+    _compiledTables = [NSMutableArray array];
+}
+
+- (NSString *)sourcePathForLocalization:(NSString *)localization
+{
+    return [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:
+            [NSString stringWithFormat:@"sas.bundle/%@.lproj/Localizable.strings", localization]];
+}
+
+/** The table of the source, NULL when it does not compile. Its bytes are kept until the end of the test. */
+- (AdStringTable *)tableWithSource:(NSData *)source duplicates:(NSMutableArray *)duplicates
+{
+    void *bytes;
+    size_t length;
+    NSData *table;
+
+    if (AdStringTableCompile([source bytes], [source length], AdStringTableTestRecordDuplicate, (__bridge void *)duplicates, &bytes, &length, NULL) != 0) {
+        return NULL;
+    }
+    table = [NSData dataWithBytesNoCopy:bytes length:length freeWhenDone:YES];
+    [_compiledTables addObject:table];
+    return AdStringTableCreateWithBytes([table bytes], [table length]);
+}
+
+- (NSString *)lookup:(NSString *)key inTable:(const AdStringTable *)table
+{
+    const char *value = AdStringTableLookup(table, [key UTF8String], strlen([key UTF8String]), NULL);
+
+    return value ? @(value) : nil;
+}
+
+- (void)testSASBundleStringsCompileWithTheirDuplicates
+{
+    NSMutableArray *duplicates = [NSMutableArray array];
+    AdStringTable *table = [self tableWithSource:[NSData dataWithContentsOfFile:[self sourcePathForLocalization:@"fr"]] duplicates:duplicates];
+    int conflicting = -1;
+
+    XCTAssert(table != NULL);
+    XCTAssertEqual(AdStringTableGetCount(table), (size_t)21);
+    XCTAssertEqualObjects([self lookup:@"Leave Application?" inTable:table], @"Quitter l'application ?");
+    XCTAssertEqualObjects([self lookup:@"Open iTunes?" inTable:table], @"Ouvrir iTunes");
+    XCTAssertNil([self lookup:@"Leave application?" inTable:table]);
+
+    XCTAssertEqualObjects(duplicates, (@[@"Do you want to leave this application to open the advertisement? 35 3 0", @"Leave Application? 33 1 1"]));
+    XCTAssertEqual(AdStringTableGetDuplicateCount(table), (size_t)2);
+    XCTAssertEqualObjects(@(AdStringTableGetDuplicate(table, 0, &conflicting)), @"Do you want to leave this application to open the advertisement?");
+    XCTAssertEqual(conflicting, 1);
+    XCTAssertEqualObjects(@(AdStringTableGetDuplicate(table, 1, &conflicting)), @"Leave Application?");
+    XCTAssertEqual(conflicting, 0);
+    XCTAssertEqualObjects([self lookup:@"Do you want to leave this application to open the advertisement?" inTable:table],
+                          @"Voulez-vous quitter cette application pour voir cette publicité ?", @"The last definition is kept");
+    AdStringTableClose(table);
+}
+
+- (void)testLookupFallsBackThroughTheTables
+{
+    AdStringTable *french = [self tableWithSource:[@"\"Yes\" = \"Oui\";" dataUsingEncoding:NSUTF8StringEncoding] duplicates:nil];
+    AdStringTable *english = [self tableWithSource:[NSData dataWithContentsOfFile:[self sourcePathForLocalization:@"en"]] duplicates:nil];
+    const AdStringTable *tables[] = { NULL, french, english };
+
+    XCTAssertEqualObjects(@(AdStringTableLookupInTables(tables, 3, "Yes", 3, NULL)), @"Oui");
+    XCTAssertEqualObjects(@(AdStringTableLookupInTables(tables, 3, "Ok", 2, NULL)), @"Ok");
+    XCTAssert(AdStringTableLookupInTables(tables, 3, "Maybe", 5, NULL) == NULL);
+    AdStringTableClose(french);
+    AdStringTableClose(english);
+}
+
+- (void)testSyntaxOfStringsFiles
+{
+    NSString *source = @"/* A comment\n on two lines */\n\"tab\" = \"a\\tb \\\"quoted\\\"\";\n// line comment\nunquoted.key = value;\n"
+                       @"\"alone\";\n\"escape\" = \"\\U00e9t\\U00e9 \\UD83D\\UDE00\";\n";
+    AdStringTable *table = [self tableWithSource:[source dataUsingEncoding:NSUTF16StringEncoding] duplicates:nil];
+    const char *invalid = "\"a\" = \"b\";\n\n\"c\" = ;";
+    unsigned errorLine = 0;
+    void *bytes;
+    size_t length;
+
+    XCTAssert(table != NULL, @"UTF-16 with a byte order mark");
+    XCTAssertEqualObjects([self lookup:@"tab" inTable:table], @"a\tb \"quoted\"");
+    XCTAssertEqualObjects([self lookup:@"unquoted.key" inTable:table], @"value");
+    XCTAssertEqualObjects([self lookup:@"alone" inTable:table], @"alone");
+    XCTAssertEqualObjects([self lookup:@"escape" inTable:table], @"été 😀");
+    AdStringTableClose(table);
+
+    XCTAssertEqual(AdStringTableCompile(invalid, strlen(invalid), NULL, NULL, &bytes, &length, &errorLine), -1);
+    XCTAssertEqual(errno, EINVAL);
+    XCTAssertEqual(errorLine, 3u);
+}
+
+- (void)testBuiltTablesAreTheCompiledSources
+{
+    for (NSString *localization in @[@"en", @"fr"]) {
+        NSString *path = [[[self sourcePathForLocalization:localization] stringByDeletingPathExtension] stringByAppendingPathExtension:@"adstrings"];
+        NSData *source = [NSData dataWithContentsOfFile:[self sourcePathForLocalization:localization]];
+        AdStringTable *table = AdStringTableOpen([path fileSystemRepresentation]);
+        void *bytes;
+        size_t length;
+
+        XCTAssert(table != NULL, @"%@ is written by the build phase", path);
+        XCTAssertEqual(AdStringTableCompile([source bytes], [source length], NULL, NULL, &bytes, &length, NULL), 0);
+        XCTAssertEqualObjects([NSData dataWithContentsOfFile:path], [NSData dataWithBytesNoCopy:bytes length:length freeWhenDone:YES]);
+        AdStringTableClose(table);
+    }
+}
+
+- (void)testInvalidTablesAreRejected
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"AdStringTableTests.adstrings"];
+    void *bytes;
+    size_t length;
+
+    XCTAssertEqual(AdStringTableCompile("\"a\" = \"b\";", 10, NULL, NULL, &bytes, &length, NULL), 0);
+    [[NSData dataWithBytes:bytes length:length - 1] writeToFile:path atomically:YES];
+    XCTAssert(AdStringTableOpen([path fileSystemRepresentation]) == NULL);
+    XCTAssertEqual(errno, EINVAL);
+    free(bytes);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+@end
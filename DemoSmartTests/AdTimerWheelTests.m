@@ -0,0 +1,141 @@
+//
+//  AdTimerWheelTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdTimerWheel.h"
+
+#include <stdlib.h>
+
+static const NSUInteger kAdTimerWheelTestTimers = 5000;
+
+typedef struct {
+    uint64_t dueTime;
+    AdTimer timer;
+    BOOL fired;
+    BOOL cancelled;
+} AdTimerWheelTestTimer;
+
+typedef struct {
+    AdTimerWheel *wheel;
+    AdTimerWheelTestTimer *timers;
+    NSUInteger count;
+    NSUInteger fired;
+    NSUInteger lateOrEarly;
+    NSUInteger cancelledFromCallback;
+} AdTimerWheelTestState;
+
+static void AdTimerWheelTestDidExpire(void *info, AdTimer timer, void *context)
+{
+    AdTimerWheelTestState *state = info;
+    AdTimerWheelTestTimer *testTimer = context;
+
+    if (testTimer == NULL) {
+        return;
+    }
+    if (testTimer->dueTime != AdTimerWheelGetTime(state->wheel) || testTimer->timer != timer || testTimer->fired || testTimer->cancelled) {
+        state->lateOrEarly++;
+    }
+    testTimer->fired = YES;
+    state->fired++;
+
+    // Callbacks may cancel other timers, even ones that expired at the same tick.
+    AdTimerWheelTestTimer *other = &state->timers[(NSUInteger)random() % state->count];
+    if (random() % 3 == 0 && !other->fired && !other->cancelled && AdTimerWheelCancel(state->wheel, other->timer) == 0) {
+        other->cancelled = YES;
+        state->cancelledFromCallback++;
+    }
+}
+
+@interface AdTimerWheelTests : XCTestCase
+{
+    AdTimerWheel *_wheel;
+}
+
+@end
+
+@implementation AdTimerWheelTests
+
+- (void)setUp
+{
+    [super setUp];
+    _wheel = AdTimerWheelCreate(60);
+}
+
+- (void)tearDown
+{
+    AdTimerWheelRelease(_wheel);
+    [super tearDown];
+}
+
+- (void)testTimersFireAtTheirTick
+{
+    AdTimerWheelTestTimer *timers = calloc(kAdTimerWheelTestTimers, sizeof(AdTimerWheelTestTimer));
+    AdTimerWheelTestState state = { _wheel, timers, kAdTimerWheelTestTimers, 0, 0, 0 };
+    NSUInteger wakeUps = 0;
+
+    srandom(7);
+    for (NSUInteger i = 0; i < kAdTimerWheelTestTimers; i++) {
+        uint64_t delay = 1 + (uint64_t)random() % 1000;
+        timers[i].dueTime = delay;
+        timers[i].timer = AdTimerWheelSchedule(_wheel, delay, &timers[i]);
+        XCTAssertTrue(timers[i].timer != kAdTimerNone);
+    }
+    XCTAssertEqual(AdTimerWheelGetCount(_wheel), (uint32_t)kAdTimerWheelTestTimers);
+
+    // Driven the way a run loop timer drives it: sleep until the next expiration.
+    while (AdTimerWheelGetCount(_wheel) > 0) {
+        uint64_t next = AdTimerWheelNextExpiration(_wheel);
+        XCTAssertTrue(next >= 1);
+        AdTimerWheelAdvance(_wheel, next, AdTimerWheelTestDidExpire, &state);
+        wakeUps++;
+    }
+    XCTAssertEqual(state.lateOrEarly, (NSUInteger)0);
+    XCTAssertEqual(state.fired + state.cancelledFromCallback, kAdTimerWheelTestTimers);
+    XCTAssertTrue(wakeUps <= 1000, @"Timers due at the same tick fire in one wake-up");
+    XCTAssertEqual(AdTimerWheelNextExpiration(_wheel), (uint64_t)kAdTimerWheelNoTimer);
+    free(timers);
+}
+
+- (void)testCancelAndStaleIdentifiers
+{
+    AdTimer first = AdTimerWheelSchedule(_wheel, 10, NULL);
+    AdTimer second;
+
+    XCTAssertEqual(AdTimerWheelCancel(_wheel, first), 0);
+    XCTAssertEqual(AdTimerWheelCancel(_wheel, first), -1, @"A timer is cancelled once");
+    second = AdTimerWheelSchedule(_wheel, 10, NULL);
+    XCTAssertTrue(second != first, @"A reused entry gets a new identifier");
+    XCTAssertEqual(AdTimerWheelCancel(_wheel, first), -1, @"The stale identifier does not cancel the new timer");
+    XCTAssertEqual(AdTimerWheelGetCount(_wheel), (uint32_t)1);
+    XCTAssertEqual(AdTimerWheelCancel(_wheel, kAdTimerNone), -1);
+}
+
+- (void)testAdvancingPastATurnOfTheWheel
+{
+    for (uint64_t i = 0; i < 100; i++) {
+        AdTimerWheelSchedule(_wheel, 1 + i * 7, NULL);
+    }
+    XCTAssertEqual(AdTimerWheelNextExpiration(_wheel), (uint64_t)1);
+    XCTAssertEqual(AdTimerWheelAdvance(_wheel, 350, AdTimerWheelTestDidExpire, NULL), (size_t)50);
+    XCTAssertEqual(AdTimerWheelNextExpiration(_wheel), (uint64_t)1);
+    XCTAssertEqual(AdTimerWheelAdvance(_wheel, 100000, AdTimerWheelTestDidExpire, NULL), (size_t)50);
+    XCTAssertEqual(AdTimerWheelGetTime(_wheel), (uint64_t)100350);
+    XCTAssertEqual(AdTimerWheelGetCount(_wheel), (uint32_t)0);
+}
+
+- (void)testCapacity
+{
+    for (NSUInteger i = 0; i < kAdTimerWheelMaxTimers; i++) {
+        XCTAssertTrue(AdTimerWheelSchedule(_wheel, i, NULL) != kAdTimerNone);
+    }
+    XCTAssertEqual(AdTimerWheelSchedule(_wheel, 1, NULL), (AdTimer)kAdTimerNone);
+    XCTAssertEqual(AdTimerWheelAdvance(_wheel, kAdTimerWheelMaxTimers, AdTimerWheelTestDidExpire, NULL), (size_t)kAdTimerWheelMaxTimers);
+}
+
+@end
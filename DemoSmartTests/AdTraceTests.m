@@ -0,0 +1,202 @@
+//
+//  AdTraceTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdTrace.h"
+#import "AdTraceURLProtocol.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+static const char kAdTraceTestsGIF[43] = "GIF89a\1\0\1\0\x80\0\0\0\0\0\xff\xff\xff!\xf9\4\1\0\0\0\0,\0\0\0\0\1\0\1\0\0\2\2D\1\0;";
+
+@interface AdTraceTests : XCTestCase
+{
+    NSString *_path;
+    char _creative[2000];
+}
+
+@end
+
+@implementation AdTraceTests
+
+- (void)setUp
+{
+    [super setUp];
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"AdTraceTests.adtrace"];
+    memset(_creative, 'x', sizeof(_creative));
+}
+
+- (void)tearDown
+{
+    [AdTraceURLProtocol stop];
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:NULL];
+    [super tearDown];
+}
+
+/** Three sessions of the interstitial of ViewController: the ad call, its creative, an impression pixel and a redirected one. */
+- (void)writeTrace
+{
+    AdTraceWriter *writer = AdTraceWriterCreate([_path fileSystemRepresentation]);
+    const char *response = "{\"insertionId\":1}";
+    char URL[256], pixel[256];
+
+    XCTAssert(writer != NULL);
+    for (int session = 0; session < 3; session++) {
+        uint64_t start = (uint64_t)session * 1000000;
+
+        snprintf(URL, sizeof(URL), "http://mobile.smartadserver.com/ac?siteid=51901&pgid=374408&fmtid=13534&visit=M&tmstp=%d", 1000 + session);
+        snprintf(pixel, sizeof(pixel), "http://Pixel.Example.com/imp?iid=1&rnd=%d", session);
+        AdTraceExchange exchanges[] = {
+            { AdTraceKindAdCall, 200, start, 80000, 90000, "GET", URL, "application/json", "", response, strlen(response) },
+            { AdTraceKindCreative, 200, start + 100000, 30000, 120000, "GET", "http://cdn.example.com/creative.jpg", "image/jpeg", "", _creative, sizeof(_creative) },
+            { AdTraceKindPixel, 200, start + 300000, 20000, 20000, "GET", pixel, "image/gif", "", kAdTraceTestsGIF, sizeof(kAdTraceTestsGIF) },
+            { AdTraceKindPixel, 302, start + 300001, 10000, 10000, "GET", "http://track.example.com/r?x=1", NULL, "http://pixel.example.com/imp?iid=1", NULL, 0 }
+        };
+
+        for (int i = 0; i < 4; i++) {
+            XCTAssertEqual(AdTraceWriterAppend(writer, &exchanges[i]), 0);
+        }
+    }
+    AdTraceExchange early = { AdTraceKindPixel, 200, 5, 0, 0, "GET", "http://a/", NULL, NULL, NULL, 0 };
+    XCTAssertEqual(AdTraceWriterAppend(writer, &early), -1, @"Starts before the previous exchange");
+    XCTAssertEqual(errno, EINVAL);
+    XCTAssertEqual(AdTraceWriterClose(writer), 0);
+}
+
+- (void)testExchangesAreReadBackWithTheirSessions
+{
+    const AdTraceExchange *exchange;
+    AdTrace *trace;
+    size_t count;
+
+    [self writeTrace];
+    XCTAssert([[[NSFileManager defaultManager] attributesOfItemAtPath:_path error:NULL] fileSize] < 2 * sizeof(_creative) + 512,
+              @"The creative is stored once, the URLs share their prefixes");
+    trace = AdTraceOpen([_path fileSystemRepresentation]);
+    XCTAssert(trace != NULL);
+    XCTAssertEqual(AdTraceGetCount(trace), (size_t)12);
+    XCTAssertEqual(AdTraceGetSessionCount(trace), (size_t)3);
+    XCTAssertEqual(AdTraceGetSession(trace, 1, &count), (size_t)4);
+    XCTAssertEqual(count, (size_t)4);
+
+    exchange = AdTraceGetExchange(trace, 5);
+    XCTAssertEqual(exchange->kind, AdTraceKindCreative);
+    XCTAssertEqual(exchange->status, (uint16_t)200);
+    XCTAssertEqual(exchange->start, (uint64_t)1100000);
+    XCTAssertEqual(exchange->firstByte, (uint32_t)30000);
+    XCTAssertEqual(exchange->duration, (uint32_t)120000);
+    XCTAssertEqualObjects(@(exchange->contentType), @"image/jpeg");
+    XCTAssertEqual(exchange->bodyLength, sizeof(_creative));
+    XCTAssertEqual(memcmp(exchange->body, _creative, sizeof(_creative)), 0);
+    XCTAssertEqualObjects(@(AdTraceGetExchange(trace, 8)->URL), @"http://mobile.smartadserver.com/ac?siteid=51901&pgid=374408&fmtid=13534&visit=M&tmstp=1002");
+
+    exchange = AdTraceGetExchange(trace, 7);
+    XCTAssertEqual(exchange->status, (uint16_t)302);
+    XCTAssertEqualObjects(@(exchange->location), @"http://pixel.example.com/imp?iid=1");
+    XCTAssertEqualObjects(@(exchange->contentType), @"");
+    XCTAssertEqual(exchange->bodyLength, (size_t)0);
+    XCTAssert(AdTraceGetExchange(trace, 12) == NULL);
+    AdTraceClose(trace);
+}
+
+- (void)testURLsAreNormalizedWithoutVolatileParameters
+{
+    const char *URL = "HTTPS://Mobile.SmartAdServer.com/ac?siteid=1&tmstp=5&lat=4&pgid=2#frag";
+    char key[256];
+
+    XCTAssertEqual(AdTraceNormalizeURL(URL, strlen(URL), key, sizeof(key)), strlen("mobile.smartadserver.com/ac?siteid=1&pgid=2"));
+    XCTAssertEqualObjects(@(key), @"mobile.smartadserver.com/ac?siteid=1&pgid=2");
+    XCTAssertEqual(AdTraceNormalizeURL("http://a.com", 12, key, sizeof(key)), (size_t)6);
+    XCTAssertEqualObjects(@(key), @"a.com/");
+    XCTAssertEqual(AdTraceNormalizeURL("http://a.com/xyz?q=1", 20, key, 4), (size_t)13, @"The length even when it does not fit");
+
+    XCTAssertEqual(AdTraceClassify("http://mobile.smartadserver.com/ac?siteid=1", 200, "application/json", 17), AdTraceKindAdCall);
+    XCTAssertEqual(AdTraceClassify("http://cdn.example.com/creative.jpg", 200, "image/jpeg", 2000), AdTraceKindCreative);
+    XCTAssertEqual(AdTraceClassify("http://pixel.example.com/imp", 200, "image/gif", sizeof(kAdTraceTestsGIF)), AdTraceKindPixel);
+}
+
+- (void)testReplayAnswersInTheRecordedOrderThenByHostAndPath
+{
+    AdTrace *trace;
+    AdTraceReplayer *replayer;
+    AdTraceReplayStatistics statistics;
+    const char *URL = "https://mobile.smartadserver.com/ac?siteid=51901&pgid=374408&fmtid=13534&visit=M&tmstp=999999";
+
+    [self writeTrace];
+    trace = AdTraceOpen([_path fileSystemRepresentation]);
+    replayer = AdTraceReplayerCreate(trace);
+    XCTAssert(replayer != NULL);
+    for (size_t i = 0; i < 4; i++) {
+        XCTAssert(AdTraceReplayerNext(replayer, "GET", URL, strlen(URL)) == AdTraceGetExchange(trace, i % 3 * 4), @"The ad calls in turn, whatever their timestamp");
+    }
+    URL = "http://mobile.smartadserver.com/ac?siteid=51901&pgid=999&fmtid=13534";
+    XCTAssert(AdTraceReplayerNext(replayer, "GET", URL, strlen(URL)) == AdTraceGetExchange(trace, 0), @"An ad call of the same path");
+    XCTAssert(AdTraceReplayerNext(replayer, "POST", URL, strlen(URL)) == NULL);
+    URL = "http://pixel.example.com/imp?iid=1&rnd=77";
+    XCTAssert(AdTraceReplayerNext(replayer, "GET", URL, strlen(URL)) == AdTraceGetExchange(trace, 2));
+
+    statistics = AdTraceReplayerGetStatistics(replayer);
+    XCTAssertEqual(statistics.exact, (uint64_t)5);
+    XCTAssertEqual(statistics.approximate, (uint64_t)1);
+    XCTAssertEqual(statistics.missed, (uint64_t)1);
+    AdTraceReplayerReset(replayer);
+    XCTAssertEqual(AdTraceReplayerGetStatistics(replayer).exact, (uint64_t)0);
+    AdTraceReplayerRelease(replayer);
+    AdTraceClose(trace);
+}
+
+- (void)testTruncatedTraceKeepsItsWholeRecords
+{
+    unsigned long long size;
+    AdTrace *trace;
+    FILE *file;
+
+    [self writeTrace];
+    size = [[[NSFileManager defaultManager] attributesOfItemAtPath:_path error:NULL] fileSize];
+    XCTAssertEqual(truncate([_path fileSystemRepresentation], (off_t)size - 3), 0);
+    trace = AdTraceOpen([_path fileSystemRepresentation]);
+    XCTAssert(trace != NULL, @"As after a crash while recording");
+    XCTAssertEqual(AdTraceGetCount(trace), (size_t)11);
+    AdTraceClose(trace);
+
+    file = fopen([_path fileSystemRepresentation], "r+b");
+    fseek(file, 17, SEEK_SET);
+    fputc(9, file);
+    fclose(file);
+    XCTAssert(AdTraceOpen([_path fileSystemRepresentation]) == NULL, @"A damaged record");
+    XCTAssertEqual(errno, EINVAL);
+}
+
+- (void)testURLProtocolAnswersFromTheTrace
+{
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://cdn.example.com/creative.jpg"]];
+    NSHTTPURLResponse *response;
+    NSError *error;
+    NSData *data;
+
+    [self writeTrace];
+    XCTAssert([AdTraceURLProtocol startReplayingFromPath:_path timeScale:0]);
+    data = [NSURLConnection sendSynchronousRequest:request returningResponse:&response error:&error];
+    XCTAssertEqual([response statusCode], (NSInteger)200);
+    XCTAssertEqualObjects([response MIMEType], @"image/jpeg");
+    XCTAssertEqualObjects(data, [NSData dataWithBytes:_creative length:sizeof(_creative)]);
+
+    request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://track.example.com/r?x=1"]];
+    data = [NSURLConnection sendSynchronousRequest:request returningResponse:&response error:&error];
+    XCTAssertEqualObjects([[response URL] absoluteString], @"http://pixel.example.com/imp?iid=1", @"The redirection is followed in the trace");
+    XCTAssertEqual([data length], sizeof(kAdTraceTestsGIF));
+
+    request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://unknown.example.com/"]];
+    XCTAssertNil([NSURLConnection sendSynchronousRequest:request returningResponse:&response error:&error]);
+    XCTAssertEqual([error code], (NSInteger)NSURLErrorNotConnectedToInternet);
+    XCTAssertEqual([AdTraceURLProtocol replayStatistics].missed, (uint64_t)1);
+}
+
+@end
@@ -0,0 +1,354 @@
+//
+//  AdTrackingDispatcherTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdTrackingDispatcher.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define kAdTrackingStubMaxHits          4096
+#define kAdTrackingStubRequestMaxLength 8192
+
+// Stub server
+
+/**
+ A beacon server on the loopback, like the stubs of tools/: HTTP/1.1 with keep-alive and pipelining,
+ an empty answer with AdTrackingStubStatus to every GET, and the path and arrival date of each
+ request kept, for the hit counts and the latency of each beacon.
+ */
+
+typedef struct {
+    char path[128];
+    CFAbsoluteTime date;
+} AdTrackingStubHit;
+
+static pthread_mutex_t AdTrackingStubLock = PTHREAD_MUTEX_INITIALIZER;
+static AdTrackingStubHit AdTrackingStubHits[kAdTrackingStubMaxHits];
+static unsigned AdTrackingStubHitCount;
+static volatile int AdTrackingStubStatus;
+static volatile int AdTrackingStubStopped;
+
+static int AdTrackingStubWriteAll(int fd, const void *bytes, size_t length)
+{
+    const char *cursor = bytes;
+
+    while (length > 0) {
+        ssize_t count = write(fd, cursor, length);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return -1;
+        }
+        cursor += count;
+        length -= (size_t)count;
+    }
+    return 0;
+}
+
+/** Answers the requests of a connection until the client closes it. */
+static void *AdTrackingStubServe(void *argument)
+{
+    int client = (int)(intptr_t)argument;
+    char request[kAdTrackingStubRequestMaxLength + 1], path[128], response[128];
+    size_t length = 0;
+
+    request[0] = '\0';
+    for (;;) {
+        char *end = strstr(request, "\r\n\r\n");
+        int status = AdTrackingStubStatus;
+
+        if (end == NULL) {
+            ssize_t count = length < kAdTrackingStubRequestMaxLength ? read(client, request + length, kAdTrackingStubRequestMaxLength - length) : 0;
+
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                break;
+            }
+            length += (size_t)count;
+            request[length] = '\0';
+            continue;
+        }
+        if (sscanf(request, "GET %127s", path) == 1) {
+            pthread_mutex_lock(&AdTrackingStubLock);
+            if (AdTrackingStubHitCount < kAdTrackingStubMaxHits) {
+                strcpy(AdTrackingStubHits[AdTrackingStubHitCount].path, path);
+                AdTrackingStubHits[AdTrackingStubHitCount].date = CFAbsoluteTimeGetCurrent();
+                AdTrackingStubHitCount++;
+            }
+            pthread_mutex_unlock(&AdTrackingStubLock);
+        }
+        snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n", status, status < 400 ? "OK" : "Failed");
+        if (AdTrackingStubWriteAll(client, response, strlen(response)) != 0) {
+            break;
+        }
+        // A pipelined request may already follow this one.
+        end += 4;
+        length -= (size_t)(end - request);
+        memmove(request, end, length + 1);
+    }
+    close(client);
+    return NULL;
+}
+
+static void *AdTrackingStubAccept(void *argument)
+{
+    int server = (int)(intptr_t)argument;
+    struct pollfd polled = { server, POLLIN, 0 };
+
+    while (!AdTrackingStubStopped) {
+        pthread_t thread;
+        int client;
+
+        if (poll(&polled, 1, 50) <= 0) {
+            continue;
+        }
+        client = accept(server, NULL, NULL);
+        if (client >= 0 && pthread_create(&thread, NULL, AdTrackingStubServe, (void *)(intptr_t)client) == 0) {
+            pthread_detach(thread);
+        } else if (client >= 0) {
+            close(client);
+        }
+    }
+    return NULL;
+}
+
+/** The number of requests for the path, and the date of the index-th one in date when not NULL. */
+static unsigned AdTrackingStubHitsOfPath(const char *path, unsigned index, CFAbsoluteTime *date)
+{
+    unsigned hits = 0;
+
+    pthread_mutex_lock(&AdTrackingStubLock);
+    for (unsigned i = 0; i < AdTrackingStubHitCount; i++) {
+        if (strcmp(AdTrackingStubHits[i].path, path) == 0) {
+            if (hits == index && date) {
+                *date = AdTrackingStubHits[i].date;
+            }
+            hits++;
+        }
+    }
+    pthread_mutex_unlock(&AdTrackingStubLock);
+    return hits;
+}
+
+@interface AdTrackingDispatcherTests : XCTestCase
+{
+    NSString *_directory;
+    NSString *_journalPath;
+    int _server;
+    uint16_t _port;
+    uint16_t _refusedPort;          // nothing listens there
+    pthread_t _acceptThread;
+}
+
+@end
+
+@implementation AdTrackingDispatcherTests
+
+- (void)setUp
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int refused;
+
+    [super setUp];
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    _journalPath = [_directory stringByAppendingPathComponent:@"AdTracking.journal"];
+
+    AdTrackingStubHitCount = 0;
+    AdTrackingStubStatus = 204;
+    AdTrackingStubStopped = 0;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    _server = socket(AF_INET, SOCK_STREAM, 0);
+    XCTAssertEqual(bind(_server, (struct sockaddr *)&address, sizeof(address)), 0);
+    XCTAssertEqual(listen(_server, 16), 0);
+    getsockname(_server, (struct sockaddr *)&address, &length);
+    _port = ntohs(address.sin_port);
+    XCTAssertEqual(pthread_create(&_acceptThread, NULL, AdTrackingStubAccept, (void *)(intptr_t)_server), 0);
+
+    address.sin_port = 0;
+    refused = socket(AF_INET, SOCK_STREAM, 0);
+    bind(refused, (struct sockaddr *)&address, sizeof(address));
+    getsockname(refused, (struct sockaddr *)&address, &length);
+    _refusedPort = ntohs(address.sin_port);
+    close(refused);
+}
+
+- (void)tearDown
+{
+    AdTrackingStubStopped = 1;
+    pthread_join(_acceptThread, NULL);
+    close(_server);
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:NULL];
+    [super tearDown];
+}
+
+- (NSURL *)URLWithPath:(NSString *)path
+{
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%u%@", _port, path]];
+}
+
+- (unsigned)hitsOfPath:(NSString *)path
+{
+    return AdTrackingStubHitsOfPath([path UTF8String], 0, NULL);
+}
+
+/** Whether the condition became true within the timeout. */
+- (BOOL)waitUntil:(BOOL (^)(void))condition timeout:(NSTimeInterval)timeout
+{
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while (!condition()) {
+        if ([limit timeIntervalSinceNow] < 0) {
+            return NO;
+        }
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return YES;
+}
+
+- (AdTrackingDispatcher *)dispatcher
+{
+    AdTrackingDispatcher *dispatcher = [[AdTrackingDispatcher alloc] initWithJournalPath:_journalPath];
+
+    dispatcher.flushInterval = 60;
+    return dispatcher;
+}
+
+#pragma mark - Journal
+
+- (void)testPendingBeaconsAreReplayedAfterACrash
+{
+    // What the app leaves when it dies while appending a line: /b and /c enqueued and never delivered.
+    NSString *journal = [NSString stringWithFormat:@"K\t7 0 %@\nE\t1\t1\t0\t%@\nE\t2\t1\t0\t%@\nD\t1\nE\t3\t2\t1\t%@\nE\t4\t2\t1\t%@",
+                         [self URLWithPath:@"/old"], [self URLWithPath:@"/a"], [self URLWithPath:@"/b"], [self URLWithPath:@"/c"],
+                         [[self URLWithPath:@"/torn"] absoluteString]];
+    AdTrackingDispatcher *dispatcher;
+
+    XCTAssertTrue([journal writeToFile:_journalPath atomically:NO encoding:NSUTF8StringEncoding error:NULL]);
+    dispatcher = [self dispatcher];
+    XCTAssertNotNil(dispatcher);
+    XCTAssertTrue([self waitUntil:^BOOL { return [dispatcher deliveredCount] == 2; } timeout:5], @"Sent at once, without waiting for the flush interval");
+    XCTAssertEqual([dispatcher pendingCount], (NSUInteger)0);
+    XCTAssertEqual([self hitsOfPath:@"/b"], 1u);
+    XCTAssertEqual([self hitsOfPath:@"/c"], 1u);
+    XCTAssertEqual([self hitsOfPath:@"/a"], 0u, @"Delivered before the crash");
+    XCTAssertEqual([self hitsOfPath:@"/torn"], 0u, @"The last line was not terminated");
+
+    XCTAssertFalse([dispatcher enqueueURLs:@[[self URLWithPath:@"/a"]] insertionId:1 kind:AdTrackingBeaconImpression]);
+    XCTAssertFalse([dispatcher enqueueURLs:@[[self URLWithPath:@"/old"]] insertionId:7 kind:AdTrackingBeaconImpression]);
+    XCTAssertTrue([dispatcher enqueueURLs:@[[self URLWithPath:@"/torn"]] insertionId:2 kind:AdTrackingBeaconClick]);
+}
+
+- (void)testTheJournalIsCompactedWhenOpened
+{
+    NSMutableString *journal = [NSMutableString string];
+    NSString *contents;
+    NSArray *lines;
+    AdTrackingDispatcher *dispatcher;
+
+    for (unsigned i = 1; i <= 600; i++) {
+        [journal appendFormat:@"E\t%u\t%u\t0\t%@\nD\t%u\n", i, i, [self URLWithPath:[NSString stringWithFormat:@"/%u", i]], i];
+    }
+    // Still pending, and failing for a while.
+    [journal appendFormat:@"E\t601\t601\t0\thttp://127.0.0.1:%u/601\n", _refusedPort];
+    XCTAssertTrue([journal writeToFile:_journalPath atomically:NO encoding:NSUTF8StringEncoding error:NULL]);
+
+    dispatcher = [self dispatcher];
+    contents = [NSString stringWithContentsOfFile:_journalPath encoding:NSUTF8StringEncoding error:NULL];
+    lines = [[contents substringToIndex:[contents length] - 1] componentsSeparatedByString:@"\n"];
+    XCTAssertEqual([lines count], (NSUInteger)601, @"A key for each delivered beacon, and the pending one");
+    XCTAssertTrue([lines[0] hasPrefix:@"K\t1 0 "]);
+    XCTAssertTrue([[lines lastObject] hasPrefix:@"E\t601\t601\t0\t"]);
+    XCTAssertEqual([dispatcher pendingCount], (NSUInteger)1);
+    XCTAssertFalse([dispatcher enqueueURLs:@[[self URLWithPath:@"/42"]] insertionId:42 kind:AdTrackingBeaconImpression], @"Still deduplicated");
+}
+
+#pragma mark - Delivery
+
+- (void)testDuplicatesAreRefused
+{
+    AdTrackingDispatcher *dispatcher = [self dispatcher];
+    NSURL *pixel = [self URLWithPath:@"/imp"], *agencyPixel = [self URLWithPath:@"/agency"];
+
+    XCTAssertTrue([dispatcher enqueueURLs:@[pixel, agencyPixel] insertionId:1 kind:AdTrackingBeaconImpression]);
+    XCTAssertFalse([dispatcher enqueueURLs:@[pixel, agencyPixel] insertionId:1 kind:AdTrackingBeaconImpression]);
+    XCTAssertTrue([dispatcher enqueueURLs:@[pixel] insertionId:1 kind:AdTrackingBeaconClick], @"Another kind");
+    XCTAssertTrue([dispatcher enqueueURLs:@[pixel] insertionId:2 kind:AdTrackingBeaconImpression], @"Another insertion");
+    XCTAssertEqual([dispatcher pendingCount], (NSUInteger)4);
+
+    [dispatcher flush];
+    XCTAssertTrue([self waitUntil:^BOOL { return [dispatcher deliveredCount] == 4; } timeout:5]);
+    XCTAssertEqual([self hitsOfPath:@"/imp"], 3u);
+    XCTAssertEqual([self hitsOfPath:@"/agency"], 1u);
+    XCTAssertFalse([dispatcher enqueueURLs:@[pixel] insertionId:1 kind:AdTrackingBeaconImpression], @"Delivered beacons are remembered");
+
+    dispatcher = nil;
+    dispatcher = [self dispatcher];
+    XCTAssertFalse([dispatcher enqueueURLs:@[pixel] insertionId:1 kind:AdTrackingBeaconImpression], @"Across launches");
+    XCTAssertEqual([dispatcher pendingCount], (NSUInteger)0);
+}
+
+- (void)testBeaconsWaitForTheirBatch
+{
+    AdTrackingDispatcher *dispatcher = [self dispatcher];
+    CFAbsoluteTime enqueued, delivered = 0;
+
+    dispatcher.batchSize = 3;
+    dispatcher.flushInterval = 0.5;
+    enqueued = CFAbsoluteTimeGetCurrent();
+    [dispatcher enqueueURLs:@[[self URLWithPath:@"/alone"]] insertionId:1 kind:AdTrackingBeaconImpression];
+    XCTAssertTrue([self waitUntil:^BOOL { return [self hitsOfPath:@"/alone"] == 1; } timeout:5]);
+    AdTrackingStubHitsOfPath("/alone", 0, &delivered);
+    XCTAssertTrue(delivered - enqueued >= 0.45, @"Waited %.3f s for the flush interval", delivered - enqueued);
+
+    enqueued = CFAbsoluteTimeGetCurrent();
+    [dispatcher enqueueURLs:@[[self URLWithPath:@"/1"], [self URLWithPath:@"/2"], [self URLWithPath:@"/3"]] insertionId:2 kind:AdTrackingBeaconImpression];
+    XCTAssertTrue([self waitUntil:^BOOL { return [dispatcher deliveredCount] == 4; } timeout:5]);
+    for (NSString *path in @[@"/1", @"/2", @"/3"]) {
+        AdTrackingStubHitsOfPath([path UTF8String], 0, &delivered);
+        XCTAssertTrue(delivered - enqueued < 0.4, @"%@ took %.3f s with its batch full", path, delivered - enqueued);
+    }
+}
+
+- (void)testFailedBeaconsBackOffUntilDropped
+{
+    AdTrackingDispatcher *dispatcher = [self dispatcher];
+    CFAbsoluteTime first = 0, second = 0, third = 0;
+
+    AdTrackingStubStatus = 503;
+    dispatcher.maxAttempts = 3;
+    [dispatcher enqueueURLs:@[[self URLWithPath:@"/failing"]] insertionId:1 kind:AdTrackingBeaconImpression];
+    [dispatcher flush];
+    XCTAssertTrue([self waitUntil:^BOOL { return [self hitsOfPath:@"/failing"] == 3; } timeout:10]);
+    XCTAssertTrue([self waitUntil:^BOOL { return [dispatcher pendingCount] == 0; } timeout:2], @"Dropped after maxAttempts");
+    XCTAssertEqual([dispatcher deliveredCount], (NSUInteger)0);
+
+    // 2 s then 4 s, with a jitter of up to half of each.
+    AdTrackingStubHitsOfPath("/failing", 0, &first);
+    AdTrackingStubHitsOfPath("/failing", 1, &second);
+    AdTrackingStubHitsOfPath("/failing", 2, &third);
+    XCTAssertTrue(second - first >= 0.95 && second - first < 2.5, @"%.3f s", second - first);
+    XCTAssertTrue(third - second >= 1.95 && third - second < 4.5, @"%.3f s", third - second);
+    XCTAssertFalse([dispatcher enqueueURLs:@[[self URLWithPath:@"/failing"]] insertionId:1 kind:AdTrackingBeaconImpression], @"Not queued again once dropped");
+}
+
+@end
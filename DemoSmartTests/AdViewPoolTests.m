@@ -0,0 +1,83 @@
+//
+//  AdViewPoolTests.m
+//  DemoSmartTests
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "AdViewPool.h"
+#import "SASInterstitialView.h"
+
+@interface AdViewPoolTests : XCTestCase
+{
+    AdViewPool *_pool;              // with the default maximum cost
+    CGRect _screenBounds;
+}
+
+@end
+
+@implementation AdViewPoolTests
+
+- (void)setUp
+{
+    [super setUp];
+    _pool = [[AdViewPool alloc] init];
+    _screenBounds = [UIScreen mainScreen].bounds;
+}
+
+- (void)tearDown
+{
+    _pool = nil;
+    [super tearDown];
+}
+
+- (BOOL)waitUntil:(BOOL (^)(void))condition timeout:(NSTimeInterval)timeout
+{
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while (!condition()) {
+        if ([limit timeIntervalSinceNow] < 0) {
+            return NO;
+        }
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return YES;
+}
+
+- (SASAdView *)dequeueFullScreenView
+{
+    return [_pool dequeueViewOfClass:[SASInterstitialView class] frame:_screenBounds loader:SASLoaderActivityIndicatorStyleBlack hideStatusBar:YES];
+}
+
+- (void)testFullScreenViewIsWarmedUnderTheDefaultCap
+{
+    AdViewPool *pool = _pool;
+    SASAdView *adView;
+
+    [pool setWarmCount:1 forViewClass:[SASInterstitialView class] loader:SASLoaderActivityIndicatorStyleBlack hideStatusBar:YES];
+    XCTAssertTrue([self waitUntil:^BOOL{ return [pool idleCount] == 1; } timeout:2]);
+    XCTAssertLessThanOrEqual([pool cost], pool.maximumCost);
+
+    adView = [self dequeueFullScreenView];
+    XCTAssertNotNil(adView);
+    XCTAssertEqual([pool hitCount], (NSUInteger)1);
+    XCTAssertTrue(CGRectEqualToRect(adView.frame, _screenBounds));
+}
+
+- (void)testFullScreenViewIsRecycledUnderTheDefaultCap
+{
+    SASAdView *adView = [self dequeueFullScreenView];
+
+    XCTAssertEqual([_pool missCount], (NSUInteger)1);
+    [adView dismiss];
+    [_pool recycleView:adView];
+    XCTAssertEqual([_pool idleCount], (NSUInteger)1);
+
+    XCTAssertEqual([self dequeueFullScreenView], adView);
+    XCTAssertEqual([_pool hitCount], (NSUInteger)1);
+}
+
+@end
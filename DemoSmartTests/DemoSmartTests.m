@@ -8,27 +8,332 @@
 
 #import <XCTest/XCTest.h>
 
+#import "AdBenchmark.h"
+#import "AdCallURL.h"
+#import "AdCoreBenchmarks.h"
+#import "AdResponseParser.h"
+#import "AdSpriteImages.h"
+#import "AdTrackingDispatcher.h"
+#import "OfflineAdCache.h"
+#import "SmartAdServerAd+AdRecord.h"
+
+#define kDemoSmartBenchmarkMaxCount 64
+
+typedef void (^DemoSmartBenchmarkBlock)(uint64_t iterations);
+
+/** Results of every test of the suite, written as JSON once the suite has run. */
+static AdBenchmarkResult DemoSmartBenchmarkResults[kDemoSmartBenchmarkMaxCount];
+static size_t DemoSmartBenchmarkCount;
+
+static void DemoSmartBenchmarkRunBlock(void *context, uint64_t iterations)
+{
+    DemoSmartBenchmarkBlock block = (__bridge DemoSmartBenchmarkBlock)context;
+    block(iterations);
+}
+
+/**
+ Benchmarks of the ad paths the app depends on.
+
+ Each result is logged, and the whole suite is written to DemoSmartBenchmarks.json in the
+ temporary directory, for tools/adbench.c --baseline to compare against. The C cores run the
+ same benchmarks headless on Linux with tools/adbench.c.
+ */
 @interface DemoSmartTests : XCTestCase
+{
+    NSString *_directory;
+}
 
 @end
 
 @implementation DemoSmartTests
 
++ (void)tearDown
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"DemoSmartBenchmarks.json"];
+    FILE *file = fopen([path fileSystemRepresentation], "w");
+
+    if (file) {
+        AdBenchmarkWriteJSON(file, "DemoSmartTests", DemoSmartBenchmarkResults, DemoSmartBenchmarkCount);
+        fclose(file);
+        NSLog(@"Benchmark results written to %@", path);
+    }
+    [super tearDown];
+}
+
 - (void)setUp
 {
     [super setUp];
-    // Put setup code here. This method is called before the invocation of each test method in the class.
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
 }
 
 - (void)tearDown
 {
-    // Put teardown code here. This method is called after the invocation of each test method in the class.
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:NULL];
     [super tearDown];
 }
 
-- (void)testExample
+#pragma mark - Helpers
+
+- (void)addResult:(AdBenchmarkResult)result
 {
-    XCTFail(@"No implementation for \"%s\"", __PRETTY_FUNCTION__);
+    NSLog(@"%-40s %10.1f ns/op +- %.1f (median %.1f, %llu x %u)%@", result.name, result.mean, result.ci95, result.median,
+          (unsigned long long)result.iterations, result.repetitions,
+          result.bytes > 0 ? [NSString stringWithFormat:@" %.1f MB/s", result.bytes * 1e3 / result.mean] : @"");
+    if (DemoSmartBenchmarkCount < kDemoSmartBenchmarkMaxCount) {
+        DemoSmartBenchmarkResults[DemoSmartBenchmarkCount++] = result;
+    }
+}
+
+- (void)measure:(const char *)name bytes:(uint64_t)bytes block:(DemoSmartBenchmarkBlock)block
+{
+    // A block runs a whole repetition, so that the trampoline is not part of the time per operation.
+    AdBenchmarkResult result = AdBenchmarkRun(name, DemoSmartBenchmarkRunBlock, (__bridge void *)block, NULL);
+    result.bytes = bytes;
+    [self addResult:result];
+}
+
+- (void)measure:(const char *)name block:(DemoSmartBenchmarkBlock)block
+{
+    [self measure:name bytes:0 block:block];
+}
+
+- (SmartAdServerAd *)sampleAdWithInsertionId:(NSInteger)insertionId
+{
+    SmartAdServerAd *ad = [[SmartAdServerAd alloc] init];
+    ad.insertionId = insertionId;
+    ad.expirationDate = [NSDate dateWithTimeIntervalSinceNow:3600];
+    ad.creativeType = CreativeTypeImage;
+    ad.imageSize = CGSizeMake(320, 480);
+    ad.creativeURL = [NSURL URLWithString:@"http://cdn.example.com/creative/portrait.png"];
+    ad.creativeLandscapeUrl = [NSURL URLWithString:@"http://cdn.example.com/creative/landscape.png"];
+    ad.redirectURL = [NSURL URLWithString:@"http://www.example.com/landing"];
+    ad.countURL = [NSURL URLWithString:@"http://mobile.smartadserver.com/click?iid=1"];
+    ad.impPixel = [NSURL URLWithString:@"http://mobile.smartadserver.com/imp?iid=1"];
+    ad.agencyPortraitPixels = @[[NSURL URLWithString:@"http://agency.example.com/p1"]];
+    return ad;
+}
+
+#pragma mark - Benchmarks
+
+- (void)testCoreChecks
+{
+    XCTAssertEqual(AdCoreBenchmarksCheck(NULL), 0u, @"Run tools/adbench --check for the failures");
+}
+
+- (void)testCoreBenchmarks
+{
+    AdBenchmarkResult results[kAdCoreBenchmarkMaxCount];
+    NSString *fixtures = [[NSBundle bundleForClass:[self class]] resourcePath];
+    size_t count = AdCoreBenchmarksRun([_directory fileSystemRepresentation], [fixtures fileSystemRepresentation], NULL, results, kAdCoreBenchmarkMaxCount, NULL);
+
+    XCTAssertTrue(count > 0, @"The core benchmarks could not be set up");
+    for (size_t i = 0; i < count; i++) {
+        [self addResult:results[i]];
+    }
+}
+
+- (void)testAdCallURLBenchmark
+{
+    NSString *baseURL = @"http://mobile.smartadserver.com";
+    NSString *target = @"age=32;gender=f;interests=sport,music";
+    AdCallURLBuilder *builder = AdCallURLBuilderCreate([baseURL UTF8String], 51901);
+    AdCallParameters parameters = { 13534, "374408", 1, AdCallURLBuilderInternTarget(builder, [target UTF8String]), 0, 1, 48.870569, 2.303425, 271.5 };
+
+    // The URL loadFormatId:pageId:master:target: sends, built the naive way as a baseline.
+    [self measure:"AdCallURL.stringWithFormat" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                NSString *escaped = CFBridgingRelease(CFURLCreateStringByAddingPercentEscapes(NULL, (__bridge CFStringRef)target, NULL,
+                                                                                             CFSTR(":/?#[]@!$&'()*+,;="), kCFStringEncodingUTF8));
+                NSString *string = [NSString stringWithFormat:@"%@/ac?siteid=%d&pgid=%@&fmtid=%d&visit=%c&tmstp=%llu&tgt=%@&lat=%.6f&long=%.6f&hdg=%.1f",
+                                    baseURL, 51901, @"374408", 13534, 'M', 1790000000000ull + i, escaped, 48.870569, 2.303425, 271.5];
+                AdBenchmarkConsume([[NSURL URLWithString:string] hash]);
+            }
+        }
+    }];
+    [self measure:"AdCallURL.buildToNSURL" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdCallParameters call = parameters;
+                size_t length;
+                const char *URL;
+
+                call.timestamp = 1790000000000ull + i;
+                URL = AdCallURLBuild(builder, &call, &length);
+                AdBenchmarkConsume([CFBridgingRelease(CFURLCreateWithBytes(NULL, (const UInt8 *)URL, (CFIndex)length, kCFStringEncodingASCII, NULL)) hash]);
+            }
+        }
+    }];
+    AdCallURLBuilderRelease(builder);
+}
+
+- (void)testAdRecordVersusKeyedArchiverBenchmark
+{
+    SmartAdServerAd *ad = [self sampleAdWithInsertionId:4242];
+    NSData *record = [ad adRecordData];
+    NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:ad];
+    AdRecordBuilder *builder = AdRecordBuilderCreate();
+
+    [self measure:"SmartAdServerAd.encodeAdRecord" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            size_t length;
+            [ad writeAdRecordWithBuilder:builder length:&length];
+            AdBenchmarkConsume(length);
+        }
+    }];
+    [self measure:"SmartAdServerAd.decodeAdRecord" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdBenchmarkConsume([SmartAdServerAd adWithAdRecordBytes:[record bytes] length:[record length]].insertionId);
+            }
+        }
+    }];
+    [self measure:"SmartAdServerAd.encodeKeyedArchive" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdBenchmarkConsume([[NSKeyedArchiver archivedDataWithRootObject:ad] length]);
+            }
+        }
+    }];
+    [self measure:"SmartAdServerAd.decodeKeyedArchive" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdBenchmarkConsume([(SmartAdServerAd *)[NSKeyedUnarchiver unarchiveObjectWithData:archive] insertionId]);
+            }
+        }
+    }];
+    AdRecordBuilderRelease(builder);
+}
+
+- (void)testAdResponseParserBenchmark
+{
+    NSData *response = [NSData dataWithContentsOfFile:[[NSBundle bundleForClass:[self class]] pathForResource:@"AdResponseImage" ofType:@"json"]];
+    AdResponseParser *parser = AdResponseParserCreate();
+
+    XCTAssertNotNil(response);
+    // Both produce the SmartAdServerAd, the parse benchmarks of the core suite stop at the record.
+    [self measure:"SmartAdServerAd.fromJSONSerialization" bytes:[response length] block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                NSDictionary *fields = [NSJSONSerialization JSONObjectWithData:response options:0 error:NULL];
+                SmartAdServerAd *ad = [[SmartAdServerAd alloc] init];
+                ad.insertionId = [fields[@"insertionId"] integerValue];
+                ad.expirationDate = [NSDate dateWithTimeIntervalSince1970:[fields[@"expirationDate"] doubleValue]];
+                ad.creativeURL = [NSURL URLWithString:fields[@"creativeURL"]];
+                ad.redirectURL = [NSURL URLWithString:fields[@"redirectURL"]];
+                ad.countURL = [NSURL URLWithString:fields[@"countURL"]];
+                ad.impPixel = [NSURL URLWithString:fields[@"impPixel"]];
+                AdBenchmarkConsume(ad.insertionId);
+            }
+        }
+    }];
+    [self measure:"SmartAdServerAd.fromAdResponseParser" bytes:[response length] block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdResponseParserReset(parser);
+                AdResponseParserFeed(parser, [response bytes], [response length]);
+                AdBenchmarkConsume([SmartAdServerAd adWithAdRecord:AdResponseParserGetRecord(parser, NULL)].insertionId);
+            }
+        }
+    }];
+    AdResponseParserRelease(parser);
+}
+
+- (void)testOfflineAdCacheBenchmark
+{
+    OfflineAdCache *cache = [[OfflineAdCache alloc] initWithDirectory:_directory maxEntries:0];
+    NSMutableArray *pageIds = [NSMutableArray arrayWithCapacity:1000];
+
+    for (NSInteger i = 0; i < 1000; i++) {
+        NSString *pageId = [NSString stringWithFormat:@"%ld", (long)i];
+        [cache storeAd:[self sampleAdWithInsertionId:i] formatId:13534 pageId:pageId target:nil];
+        [pageIds addObject:pageId];
+    }
+
+    [self measure:"OfflineAdCache.hasAd" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            AdBenchmarkConsume([cache hasAdForFormatId:13534 pageId:pageIds[(i * 7919) % 1000] target:nil]);
+        }
+    }];
+    [self measure:"OfflineAdCache.adForFormatId" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdBenchmarkConsume([cache adForFormatId:13534 pageId:pageIds[(i * 7919) % 1000] target:nil].insertionId);
+            }
+        }
+    }];
+}
+
+- (void)testTrackingDispatcherBenchmark
+{
+    AdTrackingDispatcher *dispatcher = [[AdTrackingDispatcher alloc] initWithJournalPath:[_directory stringByAppendingPathComponent:@"beacons.journal"]];
+    NSArray *URLs = @[[NSURL URLWithString:@"http://mobile.smartadserver.com/imp?iid=1"], [NSURL URLWithString:@"http://agency.example.com/p1"]];
+    __block NSInteger insertionId = 0;
+
+    // Nothing is sent while measuring: only the journaling and the deduplication of the beacons are timed.
+    dispatcher.batchSize = NSUIntegerMax;
+    dispatcher.flushInterval = 3600;
+    [self measure:"AdTrackingDispatcher.enqueueURLs" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            AdBenchmarkConsume([dispatcher enqueueURLs:URLs insertionId:++insertionId kind:AdTrackingBeaconImpression]);
+        }
+    }];
+    XCTAssertTrue([dispatcher pendingCount] > 0);
+}
+
+- (void)testLocalizableStringsBenchmark
+{
+    NSBundle *bundle = [NSBundle bundleWithPath:[[NSBundle mainBundle] pathForResource:@"sas" ofType:@"bundle"]];
+    NSArray *keys = [[NSDictionary dictionaryWithContentsOfFile:[bundle pathForResource:@"Localizable" ofType:@"strings"]] allKeys];
+
+    XCTAssertTrue([keys count] > 0, @"The SDK strings are missing from the bundle");
+    [self measure:"NSBundle.localizedString" block:^(uint64_t iterations) {
+        NSUInteger count = [keys count];
+        for (uint64_t i = 0; i < iterations; i++) {
+            AdBenchmarkConsume([[bundle localizedStringForKey:keys[i % count] value:nil table:nil] length]);
+        }
+    }];
+}
+
+
+- (void)testSpriteImagesFirstDisplayBenchmark
+{
+    NSString *directory = [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:@"sas.bundle/images"];
+    NSArray *names = @[@"back-icon", @"forward-icon", @"loader", @"mraid_close_button", @"mute-button", @"skip-button", @"unmute-button"];
+    CGFloat scale = [[UIScreen mainScreen] scale];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, 256, 256, 8, 0, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    void (^draw)(UIImage *) = ^(UIImage *image) {
+        CGContextDrawImage(context, CGRectMake(0, 0, CGImageGetWidth(image.CGImage), CGImageGetHeight(image.CGImage)), image.CGImage);
+    };
+
+    XCTAssertTrue([[[AdSpriteImages alloc] initWithDirectory:directory scale:scale] scale] > 0, @"The atlases are missing from the bundle");
+    // Each iteration shows the seven images as on a launch: from their PNGs, or from a freshly mapped atlas.
+    [self measure:"UIImage.firstDisplayFromPNGs" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                for (NSString *name in names) {
+                    draw([UIImage imageWithContentsOfFile:[directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"png"]]]);
+                }
+                AdBenchmarkConsume(*(const uint8_t *)CGBitmapContextGetData(context));
+            }
+        }
+    }];
+    [self measure:"AdSpriteImages.firstDisplay" block:^(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                AdSpriteImages *images = [[AdSpriteImages alloc] initWithDirectory:directory scale:scale];
+
+                for (NSString *name in names) {
+                    draw([images imageNamed:name]);
+                }
+                AdBenchmarkConsume(*(const uint8_t *)CGBitmapContextGetData(context));
+            }
+        }
+    }];
+    CGContextRelease(context);
+    CGColorSpaceRelease(colorSpace);
 }
 
 @end
@@ -0,0 +1,498 @@
+//
+//  adatlas.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Packs the PNGs of a directory into one AdSpriteAtlas per scale, and measures what it saves.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adatlas tools/adatlas.c DemoSmart/AdSpriteAtlas.c -lz
+    ./adatlas DemoSmart/sdk/sas.bundle/images output-directory
+    ./adatlas --dump sprites@2x.adatlas
+    ./adatlas --bench DemoSmart/sdk/sas.bundle/images output-directory
+
+ name.png goes into sprites.adatlas under the name "name", name@2x.png into sprites@2x.adatlas,
+ and so on for each scale. The PNGs are decoded here, with zlib: 8 bits per sample, not
+ interlaced, any color type, converted to the premultiplied BGRA of the atlas. The "Pack sprite
+ atlases" build phase of the app runs it on sas.bundle/images, the atlases going next to the
+ PNGs in the built sas.bundle.
+
+ --dump prints the manifest of an atlas as JSON. --bench times the first display of every sprite
+ of each scale: reading and decoding its PNG, against mapping the atlas of the scale and touching
+ the rows of the sprite in it. Both start from files in the page cache, so the difference is the
+ decoding and the system calls, not the disk.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "AdSpriteAtlas.h"
+
+#define kAtlasMaximumImages     64
+#define kAtlasMaximumScale      3
+#define kAtlasPadding           1
+#define kAtlasBenchIterations   200
+
+typedef struct {
+    char name[256];
+    char path[4096];
+    uint32_t scale;
+} AtlasImage;
+
+// PNG
+
+static uint32_t PNGRead32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | (uint32_t)bytes[3];
+}
+
+static void *AtlasReadFile(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *bytes = NULL;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0
+        && (bytes = malloc((size_t)size + 1)) != NULL && fread(bytes, 1, (size_t)size, file) == (size_t)size) {
+        *length = (size_t)size;
+    } else {
+        free(bytes);
+        bytes = NULL;
+        errno = errno ? errno : EIO;
+    }
+    fclose(file);
+    return bytes;
+}
+
+static uint8_t PNGPaeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/** Undoes the filters of the rows, in place. Returns -1 on an unknown filter. */
+static int PNGUnfilter(uint8_t *data, uint32_t height, size_t rowLength, unsigned pixelLength)
+{
+    const uint8_t *previous = NULL;
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t *row = data + y * (rowLength + 1) + 1;
+        uint8_t filter = row[-1];
+
+        for (size_t i = 0; i < rowLength; i++) {
+            uint8_t left = i >= pixelLength ? row[i - pixelLength] : 0;
+            uint8_t up = previous ? previous[i] : 0;
+            uint8_t upLeft = previous && i >= pixelLength ? previous[i - pixelLength] : 0;
+
+            switch (filter) {
+                case 0: break;
+                case 1: row[i] += left; break;
+                case 2: row[i] += up; break;
+                case 3: row[i] += (uint8_t)((left + up) / 2); break;
+                case 4: row[i] += PNGPaeth(left, up, upLeft); break;
+                default: return -1;
+            }
+        }
+        previous = row;
+    }
+    return 0;
+}
+
+/** Decodes a PNG into premultiplied BGRA. Returns NULL with errno set, EINVAL when the PNG is invalid or not supported. */
+static uint8_t *PNGDecode(const uint8_t *bytes, size_t length, uint32_t *width, uint32_t *height)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    uint8_t palette[256][4], depth = 0, colorType = 0, interlace = 0;
+    uint8_t *compressed = NULL, *data = NULL, *pixels = NULL;
+    size_t compressedLength = 0, offset = sizeof(signature), rowLength, dataLength;
+    unsigned channels, paletteCount = 0;
+    uLongf inflatedLength;
+    int ended = 0;
+
+    memset(palette, 0xff, sizeof(palette));
+    *width = *height = 0;
+    if (length < sizeof(signature) || memcmp(bytes, signature, sizeof(signature)) != 0) {
+        goto invalid;
+    }
+    while (!ended) {
+        uint32_t chunkLength;
+        const uint8_t *type, *chunk;
+
+        if (length - offset < 12 || (chunkLength = PNGRead32(bytes + offset)) > length - offset - 12) {
+            goto invalid;
+        }
+        type = bytes + offset + 4;
+        chunk = type + 4;
+        if (crc32(0, type, chunkLength + 4) != PNGRead32(chunk + chunkLength)) {
+            goto invalid;
+        }
+        if (memcmp(type, "IHDR", 4) == 0 && chunkLength == 13) {
+            *width = PNGRead32(chunk);
+            *height = PNGRead32(chunk + 4);
+            depth = chunk[8];
+            colorType = chunk[9];
+            interlace = chunk[12];
+        } else if (memcmp(type, "PLTE", 4) == 0 && chunkLength % 3 == 0 && chunkLength <= 768) {
+            paletteCount = chunkLength / 3;
+            for (unsigned i = 0; i < paletteCount; i++) {
+                memcpy(palette[i], chunk + 3 * i, 3);
+            }
+        } else if (memcmp(type, "tRNS", 4) == 0 && colorType == 3) {
+            for (unsigned i = 0; i < chunkLength && i < 256; i++) {
+                palette[i][3] = chunk[i];
+            }
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            uint8_t *grown = realloc(compressed, compressedLength + chunkLength + 1);
+
+            if (grown == NULL) {
+                goto failed;
+            }
+            compressed = grown;
+            memcpy(compressed + compressedLength, chunk, chunkLength);
+            compressedLength += chunkLength;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            ended = 1;
+        } else if (memcmp(type, "CgBI", 4) == 0 || !(type[0] & 0x20)) {
+            goto invalid;       /* Xcode's crushed PNGs, or a critical chunk this decoder does not know */
+        }
+        offset += (size_t)chunkLength + 12;
+    }
+
+    switch (colorType) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: goto invalid;
+    }
+    if (depth != 8 || interlace != 0 || *width == 0 || *height == 0 || *width > 4096 || *height > 4096
+        || compressed == NULL || (colorType == 3 && paletteCount == 0)) {
+        goto invalid;
+    }
+    rowLength = (size_t)*width * channels;
+    dataLength = (rowLength + 1) * *height;
+    data = malloc(dataLength);
+    pixels = malloc((size_t)*width * *height * 4);
+    if (data == NULL || pixels == NULL) {
+        goto failed;
+    }
+    inflatedLength = (uLongf)dataLength;
+    if (uncompress(data, &inflatedLength, compressed, (uLong)compressedLength) != Z_OK || inflatedLength != dataLength
+        || PNGUnfilter(data, *height, rowLength, channels) != 0) {
+        goto invalid;
+    }
+
+    for (uint32_t y = 0; y < *height; y++) {
+        const uint8_t *row = data + y * (rowLength + 1) + 1;
+        uint8_t *pixel = pixels + (size_t)y * *width * 4;
+
+        for (uint32_t x = 0; x < *width; x++, pixel += 4) {
+            const uint8_t *sample = row + (size_t)x * channels;
+            unsigned r, g, b, a;
+
+            switch (colorType) {
+                case 0: r = g = b = sample[0]; a = 255; break;
+                case 2: r = sample[0]; g = sample[1]; b = sample[2]; a = 255; break;
+                case 3: r = palette[sample[0]][0]; g = palette[sample[0]][1]; b = palette[sample[0]][2]; a = palette[sample[0]][3]; break;
+                case 4: r = g = b = sample[0]; a = sample[1]; break;
+                default: r = sample[0]; g = sample[1]; b = sample[2]; a = sample[3]; break;
+            }
+            pixel[0] = (uint8_t)((b * a + 127) / 255);
+            pixel[1] = (uint8_t)((g * a + 127) / 255);
+            pixel[2] = (uint8_t)((r * a + 127) / 255);
+            pixel[3] = (uint8_t)a;
+        }
+    }
+    free(compressed);
+    free(data);
+    return pixels;
+
+invalid:
+    errno = EINVAL;
+failed:
+    free(compressed);
+    free(data);
+    free(pixels);
+    return NULL;
+}
+
+static uint8_t *PNGDecodeFile(const char *path, uint32_t *width, uint32_t *height)
+{
+    size_t length;
+    uint8_t *bytes = AtlasReadFile(path, &length), *pixels;
+    int error;
+
+    if (bytes == NULL) {
+        return NULL;
+    }
+    pixels = PNGDecode(bytes, length, width, height);
+    error = errno;
+    free(bytes);
+    errno = error;
+    return pixels;
+}
+
+// Images
+
+static int AtlasCompareImages(const void *a, const void *b)
+{
+    return strcmp(((const AtlasImage *)a)->name, ((const AtlasImage *)b)->name);
+}
+
+/** The PNGs of the directory, with their names and scales, in the order of the names. Returns -1 with errno set. */
+static int AtlasListImages(const char *directory, AtlasImage *images, size_t *count)
+{
+    DIR *listing = opendir(directory);
+    struct dirent *entry;
+
+    *count = 0;
+    if (listing == NULL) {
+        return -1;
+    }
+    while ((entry = readdir(listing)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        AtlasImage *image = &images[*count];
+        char *suffix;
+
+        if (length <= 4 || strcmp(entry->d_name + length - 4, ".png") != 0) {
+            continue;
+        }
+        if (*count == kAtlasMaximumImages || length >= sizeof(image->name)) {
+            closedir(listing);
+            errno = E2BIG;
+            return -1;
+        }
+        memcpy(image->name, entry->d_name, length - 4);
+        image->name[length - 4] = '\0';
+        image->scale = 1;
+        suffix = strrchr(image->name, '@');
+        if (suffix && suffix[1] >= '1' && suffix[1] <= '0' + kAtlasMaximumScale && strcmp(suffix + 2, "x") == 0) {
+            image->scale = (uint32_t)(suffix[1] - '0');
+            *suffix = '\0';
+        }
+        snprintf(image->path, sizeof(image->path), "%s/%s", directory, entry->d_name);
+        (*count)++;
+    }
+    closedir(listing);
+    qsort(images, *count, sizeof(*images), AtlasCompareImages);
+    return 0;
+}
+
+static void AtlasPathForScale(char *path, size_t size, const char *directory, uint32_t scale)
+{
+    if (scale == 1) {
+        snprintf(path, size, "%s/sprites.adatlas", directory);
+    } else {
+        snprintf(path, size, "%s/sprites@%ux.adatlas", directory, scale);
+    }
+}
+
+static int AtlasPack(const char *input, const char *output)
+{
+    AtlasImage images[kAtlasMaximumImages];
+    size_t count;
+
+    if (AtlasListImages(input, images, &count) != 0) {
+        fprintf(stderr, "%s: %s\n", input, strerror(errno));
+        return 1;
+    }
+    for (uint32_t scale = 1; scale <= kAtlasMaximumScale; scale++) {
+        AdSpriteSource sources[kAtlasMaximumImages];
+        size_t sourceCount = 0, area = 0;
+        char path[4096];
+        int status = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            AdSpriteSource *source = &sources[sourceCount];
+
+            if (images[i].scale != scale) {
+                continue;
+            }
+            source->name = images[i].name;
+            source->pixels = PNGDecodeFile(images[i].path, &source->width, &source->height);
+            if (source->pixels == NULL) {
+                fprintf(stderr, "%s: error: %s\n", images[i].path, errno == EINVAL ? "not a PNG this tool decodes (8 bits, not interlaced)" : strerror(errno));
+                status = 1;
+                break;
+            }
+            area += (size_t)source->width * source->height;
+            sourceCount++;
+        }
+        if (status == 0 && sourceCount > 0) {
+            AdSpriteAtlas *atlas;
+            uint32_t width, height;
+
+            AtlasPathForScale(path, sizeof(path), output, scale);
+            if (AdSpriteAtlasWrite(path, sources, sourceCount, scale, kAtlasPadding) != 0 || (atlas = AdSpriteAtlasOpen(path)) == NULL) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                status = 1;
+            } else {
+                AdSpriteAtlasGetPixels(atlas, &width, &height, NULL);
+                printf("%s: %zu sprites in %ux%u, %.0f%% used\n", path, sourceCount, width, height, 100.0 * area / ((double)width * height));
+                AdSpriteAtlasClose(atlas);
+            }
+        }
+        for (size_t i = 0; i < sourceCount; i++) {
+            free((void *)sources[i].pixels);
+        }
+        if (status != 0) {
+            return status;
+        }
+    }
+    return 0;
+}
+
+static int AtlasDump(const char *path)
+{
+    AdSpriteAtlas *atlas = AdSpriteAtlasOpen(path);
+    uint32_t width, height;
+    size_t bytesPerRow;
+
+    if (atlas == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    AdSpriteAtlasGetPixels(atlas, &width, &height, &bytesPerRow);
+    printf("{\n  \"scale\": %u, \"width\": %u, \"height\": %u, \"bytesPerRow\": %zu,\n  \"sprites\": {\n",
+           AdSpriteAtlasGetScale(atlas), width, height, bytesPerRow);
+    for (size_t i = 0; i < AdSpriteAtlasGetCount(atlas); i++) {
+        AdSpriteRect rect;
+        const char *name = AdSpriteAtlasGetSprite(atlas, i, &rect);
+
+        printf("    \"%s\": { \"x\": %u, \"y\": %u, \"width\": %u, \"height\": %u }%s\n", name, rect.x, rect.y, rect.width, rect.height,
+               i + 1 < AdSpriteAtlasGetCount(atlas) ? "," : "");
+    }
+    printf("  }\n}\n");
+    AdSpriteAtlasClose(atlas);
+    return 0;
+}
+
+// Benchmark
+
+static double AtlasNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static int AtlasCompareDoubles(const void *a, const void *b)
+{
+    double first = *(const double *)a, second = *(const double *)b;
+
+    return (first > second) - (first < second);
+}
+
+static int AtlasBench(const char *input, const char *output)
+{
+    AtlasImage images[kAtlasMaximumImages];
+    static double decoding[kAtlasBenchIterations], mapping[kAtlasBenchIterations];
+    volatile uint32_t checksum = 0;
+    size_t count;
+
+    if (AtlasListImages(input, images, &count) != 0) {
+        fprintf(stderr, "%s: %s\n", input, strerror(errno));
+        return 1;
+    }
+    for (uint32_t scale = 1; scale <= kAtlasMaximumScale; scale++) {
+        char path[4096];
+        size_t sprites = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            sprites += images[i].scale == scale;
+        }
+        if (sprites == 0) {
+            continue;
+        }
+        AtlasPathForScale(path, sizeof(path), output, scale);
+        for (int iteration = 0; iteration < kAtlasBenchIterations; iteration++) {
+            AdSpriteAtlas *atlas;
+            double start = AtlasNow();
+
+            for (size_t i = 0; i < count; i++) {
+                uint32_t width, height;
+                uint8_t *pixels;
+
+                if (images[i].scale != scale) {
+                    continue;
+                }
+                if ((pixels = PNGDecodeFile(images[i].path, &width, &height)) == NULL) {
+                    fprintf(stderr, "%s: %s\n", images[i].path, strerror(errno));
+                    return 1;
+                }
+                checksum += pixels[(size_t)width * height * 2];
+                free(pixels);
+            }
+            decoding[iteration] = AtlasNow() - start;
+
+            start = AtlasNow();
+            if ((atlas = AdSpriteAtlasOpen(path)) == NULL) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                return 1;
+            }
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t *pixels;
+                size_t bytesPerRow;
+                AdSpriteRect rect;
+
+                if (images[i].scale != scale) {
+                    continue;
+                }
+                if (AdSpriteAtlasFind(atlas, images[i].name, &rect) != 0) {
+                    fprintf(stderr, "%s: no sprite %s\n", path, images[i].name);
+                    AdSpriteAtlasClose(atlas);
+                    return 1;
+                }
+                pixels = AdSpriteAtlasGetPixels(atlas, NULL, NULL, &bytesPerRow);
+                for (uint32_t y = 0; y < rect.height; y++) {
+                    checksum += pixels[(rect.y + y) * bytesPerRow + rect.x * 4];
+                }
+            }
+            AdSpriteAtlasClose(atlas);
+            mapping[iteration] = AtlasNow() - start;
+        }
+        qsort(decoding, kAtlasBenchIterations, sizeof(double), AtlasCompareDoubles);
+        qsort(mapping, kAtlasBenchIterations, sizeof(double), AtlasCompareDoubles);
+        printf("@%ux, %zu sprites, median of %d: PNGs %.1f us, atlas %.1f us (%.1fx)\n", scale, sprites, kAtlasBenchIterations,
+               decoding[kAtlasBenchIterations / 2] * 1e6, mapping[kAtlasBenchIterations / 2] * 1e6,
+               decoding[kAtlasBenchIterations / 2] / mapping[kAtlasBenchIterations / 2]);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "--dump") == 0) {
+        return AtlasDump(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "--bench") == 0) {
+        return AtlasBench(argv[2], argv[3]);
+    }
+    if (argc == 3 && argv[1][0] != '-') {
+        return AtlasPack(argv[1], argv[2]);
+    }
+    fprintf(stderr, "usage: %s images-directory output-directory\n"
+                    "       %s --dump sprites.adatlas\n"
+                    "       %s --bench images-directory atlas-directory\n", argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,125 @@
+//
+//  adbench.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Runs the benchmarks of the C cores headless, without a device or a simulator.
+
+    cc -std=gnu99 -O2 -I DemoSmart -I DemoSmartTests -o adbench tools/adbench.c \
+        DemoSmartTests/AdBenchmark.c DemoSmartTests/AdCoreBenchmarks.c \
+        DemoSmart/AdRecord.c DemoSmart/AdCache.c DemoSmart/AdCallURL.c DemoSmart/AdResponseParser.c \
+        DemoSmart/AdHistogram.c DemoSmart/AdLog.c DemoSmart/AdBlobStore.c DemoSmart/AdBridgeChannel.c \
+        DemoSmart/AdLocationFeed.c DemoSmart/AdStringTable.c DemoSmart/AdPipeline.c -lpthread -lm
+    ./adbench --json before.json
+    ./adbench --baseline before.json
+
+ Run it from the root of the repository, or pass --fixtures with the directory of the recorded
+ ad responses (DemoSmartTests) for the parse benchmarks.
+
+ The round trip and damage checks of the records run first, headless as well; --check runs only
+ them. The exit status is 1 when one of them fails:
+
+    ./adbench --check
+
+ With --baseline, the exit status is 1 when a benchmark is slower than in the baseline by more
+ than the threshold (5% by default) and by more than the confidence intervals of both runs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AdBenchmark.h"
+#include "AdCoreBenchmarks.h"
+
+static void AdBenchRemoveDirectory(const char *directory)
+{
+    char command[512];
+
+    snprintf(command, sizeof(command), "rm -rf '%s'", directory);
+    if (system(command) != 0) {
+        fprintf(stderr, "cannot remove %s\n", directory);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    AdBenchmarkResult results[kAdCoreBenchmarkMaxCount], baseline[kAdCoreBenchmarkMaxCount];
+    AdBenchmarkOptions options = AdBenchmarkDefaultOptions;
+    const char *JSONPath = NULL, *baselinePath = NULL, *fixtures = "DemoSmartTests";
+    double threshold = 0.05;
+    char directory[] = "/tmp/adbench.XXXXXX";
+    size_t count;
+    long baselineCount = 0;
+    int status = 0, checkOnly = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            JSONPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]) / 100;
+        } else if (strcmp(argv[i], "--fixtures") == 0 && i + 1 < argc) {
+            fixtures = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0) {
+            checkOnly = 1;
+        } else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            options.repetitions = (unsigned)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--json out.json] [--baseline old.json] [--threshold percent] [--fixtures dir] [--repetitions n] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (AdCoreBenchmarksCheck(stdout) > 0) {
+        return 1;
+    }
+    if (checkOnly) {
+        return 0;
+    }
+    printf("\n");
+    if (baselinePath) {
+        baselineCount = AdBenchmarkReadJSON(baselinePath, baseline, kAdCoreBenchmarkMaxCount);
+        if (baselineCount < 0) {
+            fprintf(stderr, "%s: cannot read the baseline\n", baselinePath);
+            return 2;
+        }
+    }
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    count = AdCoreBenchmarksRun(directory, fixtures, &options, results, kAdCoreBenchmarkMaxCount, stdout);
+    AdBenchRemoveDirectory(directory);
+    if (count == 0) {
+        fprintf(stderr, "the benchmarks could not be set up\n");
+        return 2;
+    }
+
+    if (JSONPath) {
+        FILE *file = fopen(JSONPath, "w");
+        if (file == NULL) {
+            perror(JSONPath);
+            return 2;
+        }
+        AdBenchmarkWriteJSON(file, "core", results, count);
+        fclose(file);
+    }
+    if (baselinePath) {
+        unsigned regressions;
+
+        printf("\n");
+        regressions = AdBenchmarkCompare(stdout, results, count, baseline, (size_t)baselineCount, threshold);
+        if (regressions > 0) {
+            printf("%u regression%s\n", regressions, regressions > 1 ? "s" : "");
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,137 @@
+//
+//  adblobdedupe.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Measures how much an AdBlobStore saves on a recorded corpus of creative downloads.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adblobdedupe tools/adblobdedupe.c DemoSmart/AdBlobStore.c
+    ./adblobdedupe [--store directory] corpus...
+
+ A corpus is a directory of downloaded creatives, one file per download, for example the
+ fsCachedData directory of the NSURLCache of the app (Library/Caches/com.mobvalue.DemoSmart)
+ copied from a device after a few days of prefetching. Every file is put in a fresh store, in a
+ temporary directory unless --store is given, under its path as URL.
+
+ It prints the number of downloads and of distinct blobs, the bytes downloaded and stored, the dedupe
+ ratio (downloaded / stored) and the put throughput.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdBlobStore.h"
+
+static AdBlobStore *DedupeStore;
+static unsigned long DedupeFiles;
+static unsigned long DedupeFailures;
+static unsigned long long DedupeBytes;
+static double DedupePutSeconds;
+
+static double DedupeNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int DedupeVisit(const char *path, const struct stat *info, int type, struct FTW *ftw)
+{
+    char *bytes;
+    int fd;
+    ssize_t length = 0;
+    double start;
+
+    (void)ftw;
+    if (type != FTW_F || !S_ISREG(info->st_mode) || info->st_size == 0) {
+        return 0;
+    }
+    fd = open(path, O_RDONLY);
+    bytes = fd >= 0 ? malloc((size_t)info->st_size) : NULL;
+    while (bytes && length < info->st_size) {
+        ssize_t count = read(fd, bytes + length, (size_t)(info->st_size - length));
+        if (count <= 0) {
+            break;
+        }
+        length += count;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (bytes == NULL || length != info->st_size) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        DedupeFailures++;
+        free(bytes);
+        return 0;
+    }
+
+    start = DedupeNow();
+    if (AdBlobStorePut(DedupeStore, path, NULL, bytes, (size_t)length, NULL) != 0) {
+        fprintf(stderr, "%s: cannot store: %s\n", path, strerror(errno));
+        DedupeFailures++;
+    } else {
+        DedupePutSeconds += DedupeNow() - start;
+        DedupeFiles++;
+        DedupeBytes += (unsigned long long)length;
+    }
+    free(bytes);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char temporary[] = "/tmp/adblobdedupe.XXXXXX";
+    const char *directory = NULL;
+    AdBlobStoreStatistics statistics;
+    int first = 1;
+
+    if (argc > 2 && strcmp(argv[1], "--store") == 0) {
+        directory = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [--store directory] corpus...\n", argv[0]);
+        return 2;
+    }
+    if (directory == NULL && (directory = mkdtemp(temporary)) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    DedupeStore = AdBlobStoreOpen(directory);
+    if (DedupeStore == NULL) {
+        fprintf(stderr, "%s: %s\n", directory, strerror(errno));
+        return 1;
+    }
+    for (int i = first; i < argc; i++) {
+        if (nftw(argv[i], DedupeVisit, 32, FTW_PHYS) != 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+            DedupeFailures++;
+        }
+    }
+
+    statistics = AdBlobStoreGetStatistics(DedupeStore);
+    printf("downloads   %lu\n", DedupeFiles);
+    printf("blobs       %u\n", statistics.blobCount);
+    printf("downloaded  %llu bytes\n", DedupeBytes);
+    printf("stored      %llu bytes\n", (unsigned long long)statistics.storedBytes);
+    printf("dedupe      %.2fx, %llu duplicate downloads\n", statistics.storedBytes ? (double)DedupeBytes / (double)statistics.storedBytes : 0.0,
+           (unsigned long long)statistics.dedupedPuts);
+    printf("put         %.1f MB/s\n", DedupePutSeconds > 0 ? (double)DedupeBytes / DedupePutSeconds / 1e6 : 0.0);
+    printf("store       %s\n", directory);
+    AdBlobStoreClose(DedupeStore);
+    return DedupeFailures > 0;
+}
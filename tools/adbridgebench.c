@@ -0,0 +1,275 @@
+//
+//  adbridgebench.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Measures the round trips and the throughput of the MRAID bridge channel, headless, without a web view.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adbridgebench tools/adbridgebench.c DemoSmart/AdBridgeChannel.c -lm
+    ./adbridgebench [--frames N] [--getters N] [--calls N] [--crossing us]
+
+ A C stand-in plays AdBridge.js: it keeps the mirror of the state from the messages, queues the
+ calls of a chatty creative and drains them on exchange. Every frame the creative reads getters
+ (heading, size, viewability) and makes calls expecting a result, while the heading jitters like
+ a compass at 60 Hz and the exposure changes now and then. Two bridges are compared:
+
+ - per call, as an SDK bridge answering each call: a navigation carries the call and an
+   evaluation brings its result back, two crossings per getter or call;
+ - batched, with AdBridgeChannel: one exchange per frame, plus the navigation telling that calls
+   are waiting. The getters read the mirror.
+
+ The encoding, decoding and handling are measured; a crossing of the web view, which dominates on
+ a device, is counted and charged --crossing microseconds (250 by default, measure yours with
+ Instruments). The cost per frame is compared with the 16.7 ms budget of a 60 Hz display.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "AdBridgeChannel.h"
+
+#define kBenchFrameBudget   16667.0     /* microseconds, at 60 Hz */
+#define kBenchQueueLength   65536
+
+/** The stand-in of AdBridge.js. */
+typedef struct {
+    double width, height, heading, exposure, orientation;
+    char queue[kBenchQueueLength];
+    size_t queueLength;
+    unsigned nextCallId;
+    unsigned pendingCallbacks;
+    unsigned long resultsReceived;
+    unsigned long messagesApplied;
+} BenchScript;
+
+typedef struct {
+    unsigned long crossings;
+    unsigned long bytes;
+    double handlingMicroseconds;
+} BenchRun;
+
+static double BenchNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e6 + (double)now.tv_nsec / 1e3;
+}
+
+/** A number member of the message, kept when it is absent. */
+static void BenchScriptApplyNumber(const char *message, const char *name, double *value)
+{
+    char key[32];
+    const char *found;
+
+    snprintf(key, sizeof(key), "\"%s\":", name);
+    found = strstr(message, key);
+    if (found) {
+        *value = strtod(found + strlen(key), NULL);
+    }
+}
+
+/** AdBridge.exchange(message): applies the state and the results, returns the drained calls. */
+static const char *BenchScriptExchange(BenchScript *script, const char *message, size_t *length)
+{
+    static char drained[kBenchQueueLength];
+
+    if (message) {
+        const char *results = strstr(message, "\"results\":[");
+
+        BenchScriptApplyNumber(message, "width", &script->width);
+        BenchScriptApplyNumber(message, "height", &script->height);
+        BenchScriptApplyNumber(message, "orientation", &script->orientation);
+        BenchScriptApplyNumber(message, "heading", &script->heading);
+        BenchScriptApplyNumber(message, "exposure", &script->exposure);
+        // Each result is an array in the results array, the results of the benchmark hold no bracket.
+        for (const char *cursor = results ? results + 11 : NULL; cursor && (cursor = strstr(cursor, "[")) != NULL; cursor++) {
+            script->resultsReceived++;
+            script->pendingCallbacks--;
+        }
+        script->messagesApplied++;
+    }
+    memcpy(drained, script->queue, script->queueLength);
+    *length = script->queueLength;
+    script->queueLength = 0;
+    return drained;
+}
+
+/** AdBridge.call(method, argument, callback). Returns 1 when the queue was empty, the script then signals the native side. */
+static int BenchScriptCall(BenchScript *script, const char *method, const char *argument)
+{
+    int wasEmpty = script->queueLength == 0;
+    int length = snprintf(script->queue + script->queueLength, kBenchQueueLength - script->queueLength, "%u\t%s\t%s\n",
+                          script->nextCallId++, method, argument);
+
+    if (length > 0 && (size_t)length < kBenchQueueLength - script->queueLength) {
+        script->queueLength += (size_t)length;
+        script->pendingCallbacks++;
+    }
+    return wasEmpty;
+}
+
+// Native side
+
+typedef struct {
+    const AdBridgeState *state;
+} BenchNative;
+
+static int BenchHandleCall(void *info, uint32_t callId, const char *method, const char *argument, char *result, size_t capacity)
+{
+    const BenchNative *native = info;
+
+    (void)callId;
+    (void)argument;
+    if (strcmp(method, "getHeading") == 0) {
+        snprintf(result, capacity, "%.0f", native->state->heading);
+    } else if (strcmp(method, "getSize") == 0) {
+        snprintf(result, capacity, "{\"width\":%g,\"height\":%g}", native->state->width, native->state->height);
+    } else if (strcmp(method, "isViewable") == 0) {
+        snprintf(result, capacity, "%s", native->state->exposure > 0 ? "true" : "false");
+    } else {
+        snprintf(result, capacity, "{\"ok\":true,\"method\":\"%s\"}", method);
+    }
+    return 1;
+}
+
+/** The native state of a frame: a compass jittering around a slow turn, the ad scrolled now and then. */
+static void BenchStateAtFrame(unsigned frame, AdBridgeState *state)
+{
+    state->width = 320;
+    state->height = 480;
+    state->orientation = 0;
+    state->heading = fmod(90 + frame * 0.05 + 0.6 * sin(frame * 1.7), 360);
+    state->exposure = (frame / 120) % 4 == 3 ? 50 : 100;
+}
+
+static const char *const BenchGetters[] = { "getHeading", "getSize", "isViewable" };
+
+static BenchRun BenchRunPerCall(unsigned frames, unsigned getters, unsigned calls)
+{
+    AdBridgeChannel *channel = AdBridgeChannelCreate();
+    BenchScript *script = calloc(1, sizeof(BenchScript));
+    AdBridgeState state;
+    BenchNative native = { &state };
+    BenchRun run = { 0, 0, 0 };
+    double start = BenchNow();
+
+    for (unsigned frame = 0; frame < frames; frame++) {
+        BenchStateAtFrame(frame, &state);
+        AdBridgeChannelSetState(channel, &state);
+        for (unsigned i = 0; i < getters + calls; i++) {
+            const char *batch, *message;
+            size_t batchLength, messageLength = 0;
+
+            // The navigation carries the call, the evaluation brings its result back.
+            BenchScriptCall(script, i < getters ? BenchGetters[i % 3] : "track", "frame");
+            batch = BenchScriptExchange(script, NULL, &batchLength);
+            AdBridgeChannelReceive(channel, batch, batchLength, BenchHandleCall, &native);
+            message = AdBridgeChannelFlush(channel, &messageLength);
+            run.crossings += 2;
+            run.bytes += batchLength + messageLength;
+            BenchScriptExchange(script, message, &batchLength);
+        }
+    }
+    run.handlingMicroseconds = BenchNow() - start;
+    AdBridgeChannelRelease(channel);
+    free(script);
+    return run;
+}
+
+static BenchRun BenchRunBatched(unsigned frames, unsigned getters, unsigned calls, double *headingError)
+{
+    AdBridgeChannel *channel = AdBridgeChannelCreate();
+    BenchScript *script = calloc(1, sizeof(BenchScript));
+    AdBridgeState state;
+    BenchNative native = { &state };
+    BenchRun run = { 0, 0, 0 };
+    double start = BenchNow(), error = 0, lag;
+    volatile double sink = 0;
+
+    for (unsigned frame = 0; frame < frames; frame++) {
+        const char *batch, *message;
+        size_t batchLength, messageLength = 0;
+        int signaled = 0;
+
+        // The creative: getters from the mirror, calls queued.
+        for (unsigned i = 0; i < getters; i++) {
+            sink += i % 3 == 0 ? script->heading : i % 3 == 1 ? script->width : script->exposure;
+        }
+        for (unsigned i = 0; i < calls; i++) {
+            signaled |= BenchScriptCall(script, "track", "frame");
+        }
+        run.crossings += (unsigned long)signaled;
+
+        // The native frame: sample, one exchange if something is pending.
+        BenchStateAtFrame(frame, &state);
+        AdBridgeChannelSetState(channel, &state);
+        if (signaled || AdBridgeChannelHasPendingMessage(channel)) {
+            message = AdBridgeChannelFlush(channel, &messageLength);
+            batch = BenchScriptExchange(script, message, &batchLength);
+            AdBridgeChannelReceive(channel, batch, batchLength, BenchHandleCall, &native);
+            run.crossings++;
+            run.bytes += batchLength + messageLength;
+        }
+        lag = fabs(script->heading - state.heading);
+        error = fmax(error, lag > 180 ? 360 - lag : lag);
+    }
+    run.handlingMicroseconds = BenchNow() - start;
+    *headingError = error;
+    AdBridgeChannelRelease(channel);
+    free(script);
+    (void)sink;
+    return run;
+}
+
+static void BenchPrint(const char *name, const BenchRun *run, unsigned frames, unsigned operations, double crossingCost)
+{
+    double perFrame = (run->handlingMicroseconds + run->crossings * crossingCost) / frames;
+
+    printf("%-9s %8.2f crossings/frame %9.0f bytes/frame %7.2f us handling/frame %9.1f us/frame %6.1f%% of the frame budget %10.0f calls/s\n",
+           name, (double)run->crossings / frames, (double)run->bytes / frames, run->handlingMicroseconds / frames, perFrame,
+           100 * perFrame / kBenchFrameBudget, operations * 1e6 / perFrame);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned frames = 36000, getters = 6, calls = 2;
+    double crossingCost = 250, headingError;
+    BenchRun perCall, batched;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--getters") == 0 && i + 1 < argc) {
+            getters = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+            calls = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--crossing") == 0 && i + 1 < argc) {
+            crossingCost = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--getters N] [--calls N] [--crossing us]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames == 0) {
+        return 2;
+    }
+
+    printf("%u frames, %u getters and %u calls per frame, %.0f us per crossing\n", frames, getters, calls, crossingCost);
+    perCall = BenchRunPerCall(frames, getters, calls);
+    batched = BenchRunBatched(frames, getters, calls, &headingError);
+    BenchPrint("per call", &perCall, frames, getters + calls, crossingCost);
+    BenchPrint("batched", &batched, frames, getters + calls, crossingCost);
+    printf("round trip of a call: per call within the frame, batched on the next exchange (one frame, %.1f ms)\n", kBenchFrameBudget / 1e3);
+    printf("largest heading lag of the mirror: %.1f degrees (resolution %.1f)\n", headingError, kAdBridgeHeadingResolution);
+    return 0;
+}
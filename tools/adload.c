@@ -0,0 +1,518 @@
+//
+//  adload.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Drives simulated ad sessions from a recorded AdTrace against tools/adreplay, to measure the throughput and tail latency of the ad stack reproducibly.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adload tools/adload.c DemoSmart/AdTrace.c DemoSmart/AdTimerWheel.c DemoSmart/AdHistogram.c
+    ./adreplay --time-scale 0.1 trace.adtrace &
+    ./adload [--host A.B.C.D] [--port N] [--rate sessions/s] [--duration s] [--concurrency N] [--time-scale X] trace.adtrace
+
+ The sessions of the trace (see AdTrace.h) are started in turn at --rate per second, whatever the
+ responses take: the arrivals are open loop, as the users of the app are, so a slow server makes
+ the sessions pile up instead of slowing the load down. Each session has its own keep-alive
+ connection and sends its requests in the order and at the offsets they were recorded, multiplied
+ by --time-scale, each one after the response to the previous one. The requests use the absolute
+ URL of the trace, as to a proxy, so the replay finds the recorded host.
+
+ The latencies are measured from the time a request was due, not from the time it could be sent,
+ so a request that waits for the previous response counts the wait. The report gives, per kind of
+ exchange, the percentiles of the latencies, the responses whose status is not the recorded one,
+ and for the sessions their durations, the connection errors and the arrivals shed because
+ --concurrency sessions were already running. The connections are closed with a reset, so a long
+ run does not exhaust the ports in TIME_WAIT.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdHistogram.h"
+#include "AdTimerWheel.h"
+#include "AdTrace.h"
+
+#define kLoadMaxConcurrency     16384
+#define kLoadHeadersLength      2048
+#define kLoadDrainSeconds       10
+#define kLoadRequestFormat      "%s %s HTTP/1.1\r\nHost: %.*s\r\nContent-Length: 0\r\n\r\n"
+
+typedef enum {
+    LoadSessionWaiting,         // for the time of its next request
+    LoadSessionConnecting,
+    LoadSessionSending,
+    LoadSessionReceiving
+} LoadSessionState;
+
+typedef struct {
+    int active;
+    int fd;
+    uint32_t generation;        // tells a timer of a finished session from one of the next
+    LoadSessionState state;
+    size_t first;               // the index of the first exchange of the session in the trace
+    size_t count;
+    size_t next;
+    uint64_t start;             // microseconds, as the due times
+    uint64_t due;
+    char *request;
+    size_t requestLength;
+    size_t requestSent;
+    char headers[kLoadHeadersLength + 1];
+    size_t headersLength;
+    int headersDone;
+    unsigned status;
+    size_t contentLength;
+    size_t bodyReceived;
+    int closeAfter;
+} LoadSession;
+
+static AdTrace *LoadTrace;
+static AdTimerWheel *LoadWheel;
+static LoadSession *LoadSessions;
+static size_t LoadConcurrency = 4096;
+static struct sockaddr_in LoadAddress;
+static double LoadTimeScale = 1;
+static uint64_t LoadClockStart;
+static volatile sig_atomic_t LoadStopped;
+
+static AdHistogram LoadLatencies[AdTraceKindCount], LoadSessionDurations;
+static unsigned long long LoadExchanges[AdTraceKindCount], LoadMismatches[AdTraceKindCount], LoadLate[AdTraceKindCount];
+static unsigned long long LoadStarted, LoadCompleted, LoadShed, LoadErrors, LoadBytesReceived;
+static size_t LoadActive;
+
+static void LoadStop(int signal)
+{
+    (void)signal;
+    LoadStopped = 1;
+}
+
+/** Microseconds since the start of the run. */
+static uint64_t LoadNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000 - LoadClockStart;
+}
+
+// Sessions
+
+static void LoadCloseConnection(LoadSession *session)
+{
+    if (session->fd >= 0) {
+        struct linger linger = { 1, 0 };
+
+        setsockopt(session->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+        close(session->fd);
+        session->fd = -1;
+    }
+}
+
+static void LoadEndSession(LoadSession *session, int completed)
+{
+    LoadCloseConnection(session);
+    free(session->request);
+    session->request = NULL;
+    session->active = 0;
+    session->generation++;
+    LoadActive--;
+    if (completed) {
+        LoadCompleted++;
+        AdHistogramRecord(&LoadSessionDurations, LoadNow() - session->start);
+    } else {
+        LoadErrors++;
+    }
+}
+
+static int LoadConnect(LoadSession *session)
+{
+    int yes = 1;
+
+    session->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (session->fd < 0) {
+        return -1;
+    }
+    fcntl(session->fd, F_SETFL, fcntl(session->fd, F_GETFL) | O_NONBLOCK);
+    setsockopt(session->fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    if (connect(session->fd, (struct sockaddr *)&LoadAddress, sizeof(LoadAddress)) != 0 && errno != EINPROGRESS) {
+        return -1;
+    }
+    session->state = LoadSessionConnecting;
+    return 0;
+}
+
+/** Writes what the socket takes of the request. Returns -1 when the connection failed. */
+static int LoadSend(LoadSession *session)
+{
+    while (session->requestSent < session->requestLength) {
+        ssize_t written = write(session->fd, session->request + session->requestSent, session->requestLength - session->requestSent);
+
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+        session->requestSent += (size_t)written;
+    }
+    session->state = LoadSessionReceiving;
+    return 0;
+}
+
+/** Sends the next request of the session, connecting first when the previous response closed the connection. */
+static int LoadStartExchange(LoadSession *session)
+{
+    const AdTraceExchange *exchange = AdTraceGetExchange(LoadTrace, session->first + session->next);
+    const char *host = strstr(exchange->URL, "://");
+    int hostLength, length;
+
+    host = host ? host + 3 : exchange->URL;
+    hostLength = (int)strcspn(host, "/?#");
+    free(session->request);
+    length = snprintf(NULL, 0, kLoadRequestFormat, exchange->method, exchange->URL, hostLength, host);
+    session->request = malloc((size_t)length + 1);
+    if (session->request == NULL) {
+        return -1;
+    }
+    snprintf(session->request, (size_t)length + 1, kLoadRequestFormat, exchange->method, exchange->URL, hostLength, host);
+    session->requestLength = (size_t)length;
+    session->requestSent = 0;
+    session->headersLength = session->bodyReceived = session->contentLength = 0;
+    session->headersDone = session->closeAfter = 0;
+    session->status = 0;
+    if (session->fd < 0) {
+        return LoadConnect(session);
+    }
+    session->state = LoadSessionSending;
+    return LoadSend(session);
+}
+
+static void LoadSchedule(LoadSession *session)
+{
+    const AdTraceExchange *first = AdTraceGetExchange(LoadTrace, session->first);
+    const AdTraceExchange *exchange = AdTraceGetExchange(LoadTrace, session->first + session->next);
+    uint64_t now = LoadNow();
+
+    session->due = session->start + (uint64_t)((double)(exchange->start - first->start) * LoadTimeScale);
+    session->state = LoadSessionWaiting;
+    if (session->due > now) {
+        uintptr_t context = (uintptr_t)(session - LoadSessions) | (uintptr_t)session->generation << 16;
+        uint64_t ticks = (session->due + 999) / 1000 - AdTimerWheelGetTime(LoadWheel);   // the wheel may lag behind now
+
+        if (AdTimerWheelSchedule(LoadWheel, ticks, (void *)context) != kAdTimerNone) {
+            return;
+        }
+    } else if (session->next > 0) {
+        LoadLate[exchange->kind]++;     // due before the previous response ended
+    }
+    if (LoadStartExchange(session) != 0) {
+        LoadEndSession(session, 0);
+    }
+}
+
+/** Records the response, then schedules the next request or ends the session. */
+static void LoadFinishExchange(LoadSession *session)
+{
+    const AdTraceExchange *exchange = AdTraceGetExchange(LoadTrace, session->first + session->next);
+
+    LoadExchanges[exchange->kind]++;
+    AdHistogramRecord(&LoadLatencies[exchange->kind], LoadNow() - session->due);
+    if (session->status != exchange->status) {
+        LoadMismatches[exchange->kind]++;
+    }
+    if (session->closeAfter || exchange->status == 0) {
+        LoadCloseConnection(session);
+    }
+    if (++session->next == session->count) {
+        LoadEndSession(session, 1);
+    } else {
+        LoadSchedule(session);
+    }
+}
+
+/** Parses the status line and the headers once they are whole. Returns -1 when they are not HTTP. */
+static int LoadParseHeaders(LoadSession *session, const char *method)
+{
+    const char *line;
+
+    if (sscanf(session->headers, "HTTP/1.%*d %u", &session->status) != 1) {
+        return -1;
+    }
+    for (line = strstr(session->headers, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+            session->contentLength = strtoul(line + 17, NULL, 10);
+        } else if (strncasecmp(line + 2, "Connection: close", 17) == 0) {
+            session->closeAfter = 1;
+        }
+    }
+    if (strcmp(method, "HEAD") == 0 || session->status == 204 || session->status == 304) {
+        session->contentLength = 0;
+    }
+    session->headersDone = 1;
+    return 0;
+}
+
+/** Reads the response. Returns -1 when the connection failed. */
+static int LoadReceive(LoadSession *session)
+{
+    const AdTraceExchange *exchange = AdTraceGetExchange(LoadTrace, session->first + session->next);
+    char buffer[65536];
+
+    for (;;) {
+        ssize_t count = read(session->fd, buffer, sizeof(buffer));
+        size_t used = 0;
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (count == 0 && exchange->status == 0 && session->headersLength == 0) {
+            LoadFinishExchange(session);    // the replay of a failed request
+            return 0;
+        }
+        if (count <= 0) {
+            return -1;
+        }
+        LoadBytesReceived += (uint64_t)count;
+        if (!session->headersDone) {
+            char *end;
+
+            used = (size_t)count < kLoadHeadersLength - session->headersLength ? (size_t)count : kLoadHeadersLength - session->headersLength;
+            memcpy(session->headers + session->headersLength, buffer, used);
+            session->headersLength += used;
+            session->headers[session->headersLength] = '\0';
+            end = strstr(session->headers, "\r\n\r\n");
+            if (end == NULL) {
+                if (session->headersLength == kLoadHeadersLength) {
+                    return -1;
+                }
+                continue;
+            }
+            // What follows the headers in this read is the start of the body.
+            used -= session->headersLength - (size_t)(end + 4 - session->headers);
+            if (LoadParseHeaders(session, exchange->method) != 0) {
+                return -1;
+            }
+        }
+        session->bodyReceived += (size_t)count - used;
+        if (session->bodyReceived >= session->contentLength) {
+            LoadFinishExchange(session);
+            return 0;
+        }
+    }
+}
+
+static void LoadTimerFired(void *info, AdTimer timer, void *context)
+{
+    uintptr_t value = (uintptr_t)context;
+    LoadSession *session = &LoadSessions[value & 0xffff];
+
+    (void)info;
+    (void)timer;
+    if (!session->active || session->generation != (uint32_t)(value >> 16)) {
+        return;
+    }
+    if (LoadStartExchange(session) != 0) {
+        LoadEndSession(session, 0);
+    }
+}
+
+static void LoadStartSession(void)
+{
+    size_t sessionCount = AdTraceGetSessionCount(LoadTrace);
+
+    for (size_t i = 0; i < LoadConcurrency; i++) {
+        LoadSession *session = &LoadSessions[i];
+
+        if (!session->active) {
+            session->active = 1;
+            session->fd = -1;
+            session->first = AdTraceGetSession(LoadTrace, LoadStarted % sessionCount, &session->count);
+            session->next = 0;
+            session->start = LoadNow();
+            LoadStarted++;
+            LoadActive++;
+            LoadSchedule(session);
+            return;
+        }
+    }
+    LoadShed++;
+}
+
+// Report
+
+static void LoadPrintHistogram(const char *name, const AdHistogram *histogram, unsigned long long count)
+{
+    printf("%-10s %9llu %9.2f %9.2f %9.2f %9.2f %9.2f", name, count,
+           AdHistogramValueAtPercentile(histogram, 50) / 1000.0, AdHistogramValueAtPercentile(histogram, 90) / 1000.0,
+           AdHistogramValueAtPercentile(histogram, 99) / 1000.0, AdHistogramValueAtPercentile(histogram, 99.9) / 1000.0,
+           AdHistogramValueAtPercentile(histogram, 100) / 1000.0);
+}
+
+static void LoadReport(double seconds)
+{
+    printf("%llu sessions started in %.1f s (%.0f/s), %llu completed, %llu connection errors, %llu shed, %zu unfinished; %llu bytes received\n",
+           LoadStarted, seconds, LoadStarted / seconds, LoadCompleted, LoadErrors, LoadShed, LoadActive, LoadBytesReceived);
+    printf("%-10s %9s %9s %9s %9s %9s %9s %11s %6s\n", "ms", "count", "p50", "p90", "p99", "p99.9", "max", "mismatches", "late");
+    for (int kind = 0; kind < AdTraceKindCount; kind++) {
+        LoadPrintHistogram(AdTraceKindName((AdTraceKind)kind), &LoadLatencies[kind], LoadExchanges[kind]);
+        printf(" %11llu %6llu\n", LoadMismatches[kind], LoadLate[kind]);
+    }
+    LoadPrintHistogram("session", &LoadSessionDurations, LoadCompleted);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static struct pollfd fds[kLoadMaxConcurrency];
+    static LoadSession *polled[kLoadMaxConcurrency];
+    const char *path = NULL, *host = "127.0.0.1";
+    double rate = 1000, duration = 10, seconds;
+    int port = 8089;
+    struct sigaction action;
+    uint64_t end;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            LoadConcurrency = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc) {
+            LoadTimeScale = strtod(argv[++i], NULL);
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    memset(&LoadAddress, 0, sizeof(LoadAddress));
+    LoadAddress.sin_family = AF_INET;
+    LoadAddress.sin_port = htons((uint16_t)port);
+    if (path == NULL || rate <= 0 || duration <= 0 || LoadTimeScale < 0 || LoadConcurrency == 0 || LoadConcurrency > kLoadMaxConcurrency
+        || inet_pton(AF_INET, host, &LoadAddress.sin_addr) != 1) {
+        fprintf(stderr, "usage: %s [--host A.B.C.D] [--port N] [--rate sessions/s] [--duration s] [--concurrency N (at most %d)] [--time-scale X] trace.adtrace\n",
+                argv[0], kLoadMaxConcurrency);
+        return 2;
+    }
+    LoadTrace = AdTraceOpen(path);
+    LoadWheel = AdTimerWheelCreate(1024);
+    LoadSessions = calloc(LoadConcurrency, sizeof(*LoadSessions));
+    if (LoadTrace == NULL || LoadWheel == NULL || LoadSessions == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (AdTraceGetSessionCount(LoadTrace) == 0) {
+        fprintf(stderr, "%s: no exchanges\n", path);
+        return 1;
+    }
+    for (int kind = 0; kind < AdTraceKindCount; kind++) {
+        AdHistogramInit(&LoadLatencies[kind]);
+    }
+    AdHistogramInit(&LoadSessionDurations);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = LoadStop;
+    sigaction(SIGINT, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    LoadClockStart = 0;
+    LoadClockStart = LoadNow();
+    end = (uint64_t)(duration * 1000000);
+    // The arrivals stop at the end of the duration, then the running sessions have a while to finish.
+    while (!LoadStopped && (LoadNow() < end || (LoadActive > 0 && LoadNow() < end + kLoadDrainSeconds * 1000000))) {
+        uint64_t now = LoadNow();
+        nfds_t count = 0;
+
+        if (now < end) {
+            while (LoadStarted + LoadShed < (unsigned long long)((double)now * rate / 1000000) + 1) {
+                LoadStartSession();
+            }
+        }
+        if (now / 1000 > AdTimerWheelGetTime(LoadWheel)) {
+            AdTimerWheelAdvance(LoadWheel, now / 1000 - AdTimerWheelGetTime(LoadWheel), LoadTimerFired, NULL);
+        }
+        for (size_t i = 0; i < LoadConcurrency; i++) {
+            LoadSession *session = &LoadSessions[i];
+
+            if (session->active && session->fd >= 0 && session->state != LoadSessionWaiting) {
+                fds[count].fd = session->fd;
+                fds[count].events = session->state == LoadSessionReceiving ? POLLIN : POLLOUT;
+                polled[count++] = session;
+            }
+        }
+        if (poll(fds, count, 1) < 0 && errno != EINTR) {
+            perror("adload");
+            break;
+        }
+        for (nfds_t i = 0; i < count; i++) {
+            LoadSession *session = polled[i];
+            int status = 0;
+
+            if (fds[i].revents == 0 || !session->active || session->fd != fds[i].fd) {
+                continue;
+            }
+            if (session->state == LoadSessionConnecting) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+
+                if (getsockopt(session->fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+                    status = -1;
+                } else {
+                    session->state = LoadSessionSending;
+                }
+            }
+            if (status == 0 && session->state == LoadSessionSending) {
+                status = LoadSend(session);
+            } else if (status == 0 && session->state == LoadSessionReceiving) {
+                status = LoadReceive(session);
+            }
+            if (status != 0) {
+                LoadEndSession(session, 0);
+            }
+        }
+    }
+
+    seconds = (double)(LoadNow() < end ? LoadNow() : end) / 1000000;
+    LoadReport(seconds);
+    for (size_t i = 0; i < LoadConcurrency; i++) {
+        if (LoadSessions[i].active) {
+            LoadCloseConnection(&LoadSessions[i]);
+            free(LoadSessions[i].request);
+        }
+    }
+    free(LoadSessions);
+    AdTimerWheelRelease(LoadWheel);
+    AdTraceClose(LoadTrace);
+    return 0;
+}
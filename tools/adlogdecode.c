@@ -0,0 +1,38 @@
+//
+//  adlogdecode.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Prints AdLog files as text, one line per event.
+
+    cc -std=gnu99 -I DemoSmart -o adlogdecode tools/adlogdecode.c DemoSmart/AdLog.c -lpthread
+    ./adlogdecode AdLog.2.bin AdLog.1.bin AdLog.bin
+
+ The files of a device are in Library/Caches/Logs of the app container. Pass the rotated files
+ from the oldest (highest number) to AdLog.bin to read the events in order.
+ */
+
+#include <stdio.h>
+
+#include "AdLog.h"
+
+int main(int argc, char *argv[])
+{
+    int status = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s file...\n", argv[0]);
+        return 2;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (AdLogDecodeFile(argv[i], stdout) < 0) {
+            fprintf(stderr, "%s: not an AdLog file\n", argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
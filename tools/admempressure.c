@@ -0,0 +1,184 @@
+//
+//  admempressure.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Drives an AdMemoryGovernor with synthetic consumers and random memory pressure, away from a device.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o admempressure tools/admempressure.c DemoSmart/AdMemoryGovernor.c
+    ./admempressure [--steps N] [--seed N] [--verbose]
+
+ Each consumer holds real heap blocks of the size of a decoded image, a payload or an ad view, and
+ grows between pressure events the way the caches of the app grow while ads are shown. After every
+ response the driver checks that the goal was met when the allowed tiers held enough, that a tier
+ was only trimmed once the tiers before it were empty, and that the bytes reported freed were
+ released. It prints the bytes freed per level and tier, and exits with 1 if a check failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AdMemoryGovernor.h"
+
+#define kSyntheticMaxBlocks 256
+
+typedef struct {
+    const char *name;
+    AdMemoryTier tier;
+    size_t blockSize;
+    void *blocks[kSyntheticMaxBlocks];
+    size_t sizes[kSyntheticMaxBlocks];
+    unsigned count;
+} SyntheticConsumer;
+
+static size_t SyntheticCost(void *info)
+{
+    SyntheticConsumer *consumer = info;
+    size_t cost = 0;
+
+    for (unsigned i = 0; i < consumer->count; i++) {
+        cost += consumer->sizes[i];
+    }
+    return cost;
+}
+
+/** Frees the oldest blocks first, like the caches of the app. */
+static size_t SyntheticTrim(void *info, size_t cost)
+{
+    SyntheticConsumer *consumer = info;
+    size_t held = SyntheticCost(consumer);
+    size_t freed = 0;
+    unsigned dropped = 0;
+
+    while (dropped < consumer->count && held - freed > cost) {
+        freed += consumer->sizes[dropped];
+        free(consumer->blocks[dropped]);
+        dropped++;
+    }
+    memmove(consumer->blocks, consumer->blocks + dropped, (consumer->count - dropped) * sizeof(void *));
+    memmove(consumer->sizes, consumer->sizes + dropped, (consumer->count - dropped) * sizeof(size_t));
+    consumer->count -= dropped;
+    return freed;
+}
+
+static void SyntheticGrow(SyntheticConsumer *consumer)
+{
+    size_t size = consumer->blockSize / 2 + (size_t)rand() % consumer->blockSize;
+
+    if (consumer->count == kSyntheticMaxBlocks) {
+        return;
+    }
+    consumer->blocks[consumer->count] = malloc(size);
+    if (consumer->blocks[consumer->count]) {
+        // Touch the pages so the blocks are resident, as decoded bitmaps are.
+        memset(consumer->blocks[consumer->count], 0xA5, size);
+        consumer->sizes[consumer->count++] = size;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *levels[] = { "none", "warning", "urgent", "critical" };
+    static const AdMemoryTier deepest[] = { AdMemoryTierDecodedImages, AdMemoryTierPrefetchedAds, AdMemoryTierPooledViews, AdMemoryTierPooledViews };
+    SyntheticConsumer consumers[] = {
+        { .name = "decodedImages", .tier = AdMemoryTierDecodedImages, .blockSize = 600 * 1024 },
+        { .name = "thumbnails", .tier = AdMemoryTierDecodedImages, .blockSize = 40 * 1024 },
+        { .name = "scripts", .tier = AdMemoryTierPrefetchedAds, .blockSize = 30 * 1024 },
+        { .name = "URLCache", .tier = AdMemoryTierPrefetchedAds, .blockSize = 120 * 1024 },
+        { .name = "viewPool", .tier = AdMemoryTierPooledViews, .blockSize = 1000 * 1024 },
+    };
+    const unsigned consumerCount = sizeof(consumers) / sizeof(consumers[0]);
+    unsigned long steps = 1000;
+    unsigned seed = 1;
+    int verbose = 0;
+    unsigned failures = 0;
+    unsigned long long freedByLevel[4][AdMemoryTierCount];
+    unsigned long responses[4];
+    AdMemoryGovernor *governor = AdMemoryGovernorCreate();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "usage: %s [--steps N] [--seed N] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (governor == NULL) {
+        perror("AdMemoryGovernorCreate");
+        return 1;
+    }
+    srand(seed);
+    memset(freedByLevel, 0, sizeof(freedByLevel));
+    memset(responses, 0, sizeof(responses));
+    for (unsigned i = 0; i < consumerCount; i++) {
+        AdMemoryConsumer consumer = { consumers[i].name, consumers[i].tier, &consumers[i], SyntheticCost, SyntheticTrim };
+        AdMemoryGovernorAddConsumer(governor, &consumer);
+    }
+
+    for (unsigned long step = 0; step < steps; step++) {
+        AdMemoryPressure pressure;
+        AdMemoryResponse response;
+        size_t allowed = 0, after;
+
+        for (unsigned i = 0; i < consumerCount; i++) {
+            for (int grow = rand() % 4; grow > 0; grow--) {
+                SyntheticGrow(&consumers[i]);
+            }
+        }
+        // Mostly warnings, a few critical events, as on a device.
+        pressure = (AdMemoryPressure)(rand() % 10 < 6 ? AdMemoryPressureWarning : rand() % 3 < 2 ? AdMemoryPressureUrgent : AdMemoryPressureCritical);
+        for (AdMemoryTier tier = AdMemoryTierDecodedImages; tier <= deepest[pressure]; tier++) {
+            allowed += AdMemoryGovernorGetCost(governor, tier);
+        }
+
+        response = AdMemoryGovernorRespond(governor, pressure);
+        after = AdMemoryGovernorGetCost(governor, AdMemoryTierCount);
+        responses[pressure]++;
+        for (AdMemoryTier tier = AdMemoryTierDecodedImages; tier < AdMemoryTierCount; tier++) {
+            freedByLevel[pressure][tier] += response.freedByTier[tier];
+            if (response.freedByTier[tier] > 0 && tier > deepest[pressure]) {
+                fprintf(stderr, "step %lu: %s pressure trimmed tier %d\n", step, levels[pressure], tier);
+                failures++;
+            }
+            if (tier > AdMemoryTierDecodedImages && response.freedByTier[tier] > 0 && AdMemoryGovernorGetCost(governor, tier - 1) > 0) {
+                fprintf(stderr, "step %lu: tier %d trimmed before tier %d was empty\n", step, tier, tier - 1);
+                failures++;
+            }
+        }
+        if (response.freed < response.goal && response.freed < allowed) {
+            fprintf(stderr, "step %lu: freed %zu of a %zu goal, %zu were allowed\n", step, response.freed, response.goal, allowed);
+            failures++;
+        }
+        if (response.costBefore - response.freed != after) {
+            fprintf(stderr, "step %lu: %zu held after freeing %zu of %zu\n", step, after, response.freed, response.costBefore);
+            failures++;
+        }
+        if (verbose) {
+            printf("%5lu %-8s held %9zu goal %9zu freed %9zu (%zu %zu %zu)\n", step, levels[pressure], response.costBefore, response.goal,
+                   response.freed, response.freedByTier[0], response.freedByTier[1], response.freedByTier[2]);
+        }
+    }
+
+    printf("%-8s %9s %14s %14s %14s\n", "level", "responses", "images", "prefetched", "views");
+    for (int level = AdMemoryPressureWarning; level <= AdMemoryPressureCritical; level++) {
+        printf("%-8s %9lu %14llu %14llu %14llu\n", levels[level], responses[level],
+               freedByLevel[level][0], freedByLevel[level][1], freedByLevel[level][2]);
+    }
+    printf("freed %llu bytes in %lu steps, %u failed checks\n", (unsigned long long)AdMemoryGovernorGetFreedTotal(governor), steps, failures);
+
+    for (unsigned i = 0; i < consumerCount; i++) {
+        SyntheticTrim(&consumers[i], 0);
+    }
+    AdMemoryGovernorRelease(governor);
+    return failures > 0;
+}
@@ -0,0 +1,356 @@
+//
+//  adpagecalls.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Measures how long the ad calls of a page take as AdPageCoordinator sends them, and as views loading themselves would.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adpagecalls tools/adpagecalls.c DemoSmart/AdConnectionPool.c DemoSmart/AdHistogram.c
+    ./adreplay --setup-delay 100 --time-scale 1 trace.adtrace &
+    ./adpagecalls [--server host:port] [--pages N] [--connections N] [--turn ms] [--warm] [--timeout s] http://host[:port]/ac?...
+
+ Each URL is the ad call of a placement of the page, the ad calls of a trace for adreplay. A page
+ is sent in three ways, --pages times each:
+
+ - coalesced, as AdPageCoordinator sends them: all the calls at once, back to back;
+ - spread, as views that load themselves in their own run loop turn: one call every --turn ms,
+   a frame (17 ms) by default;
+ - sequential, as views waiting for each other: each call once the previous response is in.
+
+ The calls go over at most --connections keep-alive connections, 4 by default as the URL loading
+ system opens to a host, one request at a time on each. The connections of a page are closed after
+ it, so every page pays for the setup of its connections, unless --warm keeps them for the next one.
+
+ With --server, the requests are sent there with the absolute URL, as to a proxy, so adreplay finds
+ the recorded host: the round trip of the network is its --setup-delay for a new connection and the
+ recorded time to first byte, scaled by --time-scale, for each call. The report gives by way the
+ percentiles of the page latency, from the first call due to the last response, and of the latency
+ of each call, from the time it was due.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdConnectionPool.h"
+#include "AdHistogram.h"
+
+#define kPageMaxCalls           64
+#define kPageMaxConnections     16
+#define kPageHeadersLength      8192
+
+typedef enum {
+    PageCoalesced,
+    PageSpread,
+    PageSequential,
+    PageWayCount
+} PageWay;
+
+typedef struct {
+    const char *URL;
+    char host[kAdConnectionHostLength];
+    uint16_t port;
+    const char *path;
+} PageCall;
+
+typedef struct {
+    int fd;
+    int busy;
+    size_t call;
+    char headers[kPageHeadersLength + 1];
+    size_t length;
+    size_t bodyExpected;        // SIZE_MAX until the headers are in
+    size_t bodyReceived;
+    int keepAlive;
+} PageConnection;
+
+static const char *const PageWayNames[PageWayCount] = { "coalesced", "spread", "sequential" };
+
+static PageCall PageCalls[kPageMaxCalls];
+static size_t PageCallCount;
+static char PageServerHost[kAdConnectionHostLength];
+static uint16_t PageServerPort;
+static double PageTimeout = 10;
+static AdHistogram PageLatencies[PageWayCount], PageCallLatencies[PageWayCount];
+static unsigned long long PageErrors[PageWayCount], PageConnectionsOpened[PageWayCount];
+
+static double PageNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/** Splits http://host[:port]/path. Returns 0, or -1 when the URL is not plain HTTP. */
+static int PageParseURL(const char *string, PageCall *call)
+{
+    const char *host = string + strlen("http://"), *end;
+    size_t length;
+
+    if (strncasecmp(string, "http://", strlen("http://")) != 0) {
+        return -1;
+    }
+    end = host + strcspn(host, ":/?");
+    length = (size_t)(end - host);
+    if (length == 0 || length >= sizeof(call->host)) {
+        return -1;
+    }
+    memcpy(call->host, host, length);
+    call->host[length] = '\0';
+    call->port = 80;
+    if (*end == ':') {
+        call->port = (uint16_t)strtoul(end + 1, NULL, 10);
+        end += strcspn(end, "/?");
+    }
+    call->URL = string;
+    call->path = *end ? end : "/";
+    return 0;
+}
+
+static void PageClose(PageConnection *connection)
+{
+    if (connection->fd >= 0) {
+        close(connection->fd);
+    }
+    connection->fd = -1;
+    connection->busy = 0;
+}
+
+/** Sends the call on the connection, opened first if needed. Returns 0, or -1 when the connection failed. */
+static int PageSend(PageConnection *connection, size_t index, PageWay way)
+{
+    const PageCall *call = &PageCalls[index];
+    char request[kPageHeadersLength];
+    int length;
+
+    if (connection->fd < 0) {
+        connection->fd = AdConnectionOpen(PageServerPort ? PageServerHost : call->host, PageServerPort ? PageServerPort : call->port, PageTimeout, NULL);
+        if (connection->fd < 0) {
+            return -1;
+        }
+        PageConnectionsOpened[way]++;
+    }
+    length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s:%u\r\nUser-Agent: adpagecalls\r\n\r\n",
+                      PageServerPort ? call->URL : call->path, call->host, call->port);
+    if (length < 0 || (size_t)length >= sizeof(request) || send(connection->fd, request, (size_t)length, 0) != length) {
+        PageClose(connection);
+        return -1;
+    }
+    connection->busy = 1;
+    connection->call = index;
+    connection->length = 0;
+    connection->bodyExpected = SIZE_MAX;
+    connection->bodyReceived = 0;
+    connection->keepAlive = 1;
+    return 0;
+}
+
+/** Reads what arrived. Returns 1 once the response is in whole, 0 while it is not, -1 when the connection failed. */
+static int PageReceive(PageConnection *connection)
+{
+    char buffer[16384];
+    ssize_t count;
+
+    if (connection->bodyExpected == SIZE_MAX) {
+        const char *end, *header;
+
+        count = recv(connection->fd, connection->headers + connection->length, kPageHeadersLength - connection->length, 0);
+        if (count <= 0) {
+            return count < 0 && errno == EINTR ? 0 : -1;
+        }
+        connection->length += (size_t)count;
+        connection->headers[connection->length] = '\0';
+        end = strstr(connection->headers, "\r\n\r\n");
+        if (end == NULL) {
+            return connection->length == kPageHeadersLength ? -1 : 0;
+        }
+        connection->bodyExpected = 0;
+        connection->keepAlive = strncmp(connection->headers, "HTTP/1.0", 8) != 0;
+        for (header = strstr(connection->headers, "\r\n"); header && header < end; header = strstr(header + 2, "\r\n")) {
+            if (strncasecmp(header + 2, "Content-Length:", strlen("Content-Length:")) == 0) {
+                connection->bodyExpected = strtoul(header + 2 + strlen("Content-Length:"), NULL, 10);
+            } else if (strncasecmp(header + 2, "Connection: close", strlen("Connection: close")) == 0) {
+                connection->keepAlive = 0;
+            }
+        }
+        connection->bodyReceived = connection->length - (size_t)(end + 4 - connection->headers);
+    } else {
+        count = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (count <= 0) {
+            return count < 0 && errno == EINTR ? 0 : -1;
+        }
+        connection->bodyReceived += (size_t)count;
+    }
+    return connection->bodyReceived >= connection->bodyExpected;
+}
+
+/** Sends the calls of a page the given way and waits for every response. */
+static void PageRun(PageWay way, PageConnection *connections, size_t connectionCount, double turn, int warm)
+{
+    double due[kPageMaxCalls], start = PageNow(), last = start;
+    size_t next = 0, completed = 0;
+
+    for (size_t i = 0; i < PageCallCount; i++) {
+        due[i] = way == PageCoalesced ? start : way == PageSpread ? start + turn * (double)i : i == 0 ? start : HUGE_VAL;
+    }
+    while (completed < PageCallCount) {
+        struct pollfd fds[kPageMaxConnections];
+        double now = PageNow(), wait = 1;
+        int timeout;
+
+        if (now - start > PageTimeout) {
+            PageErrors[way] += PageCallCount - completed;
+            for (size_t c = 0; c < connectionCount; c++) {
+                PageClose(&connections[c]);
+            }
+            break;
+        }
+        // The calls due go out in order, on the first idle connection, opened if it is not yet.
+        while (next < PageCallCount && due[next] <= now) {
+            size_t c = 0;
+
+            while (c < connectionCount && connections[c].busy) {
+                c++;
+            }
+            if (c == connectionCount) {
+                break;
+            }
+            if (PageSend(&connections[c], next, way) != 0) {
+                PageErrors[way]++;
+                completed++;
+                if (next + 1 < PageCallCount && way == PageSequential) {
+                    due[next + 1] = PageNow();
+                }
+            }
+            next++;
+        }
+        if (next < PageCallCount && due[next] > now) {
+            wait = due[next] - now;
+        }
+        for (size_t c = 0; c < connectionCount; c++) {
+            fds[c].fd = connections[c].busy ? connections[c].fd : -1;
+            fds[c].events = POLLIN;
+            fds[c].revents = 0;
+        }
+        timeout = (int)(wait * 1000) + 1;
+        if (poll(fds, (nfds_t)connectionCount, timeout) <= 0) {
+            continue;
+        }
+        for (size_t c = 0; c < connectionCount; c++) {
+            PageConnection *connection = &connections[c];
+            int status;
+
+            if (!(fds[c].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            status = PageReceive(connection);
+            if (status == 0) {
+                continue;
+            }
+            now = PageNow();
+            if (status < 0) {
+                PageErrors[way]++;
+                PageClose(connection);
+            } else {
+                AdHistogramRecord(&PageCallLatencies[way], (uint64_t)((now - due[connection->call]) * 1e6));
+                connection->busy = 0;
+                if (!connection->keepAlive) {
+                    PageClose(connection);
+                }
+            }
+            if (way == PageSequential && connection->call + 1 < PageCallCount) {
+                due[connection->call + 1] = now;
+            }
+            last = now;
+            completed++;
+        }
+    }
+    AdHistogramRecord(&PageLatencies[way], (uint64_t)((last - start) * 1e6));
+    for (size_t c = 0; c < connectionCount && !warm; c++) {
+        PageClose(&connections[c]);
+    }
+}
+
+static void PagePrintHistogram(const char *name, const AdHistogram *histogram)
+{
+    printf("  %-14s %6" PRIu64 "  p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms  max %8.2f ms\n", name, histogram->count,
+           AdHistogramValueAtPercentile(histogram, 50) / 1e3, AdHistogramValueAtPercentile(histogram, 90) / 1e3,
+           AdHistogramValueAtPercentile(histogram, 99) / 1e3, histogram->max / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    PageConnection connections[kPageMaxConnections];
+    unsigned long pages = 20, connectionCount = 4;
+    double turn = 0.017;
+    int warm = 0, valid = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            const char *server = argv[++i], *colon = strrchr(server, ':');
+
+            valid = colon && colon > server && (size_t)(colon - server) < sizeof(PageServerHost);
+            if (valid) {
+                memcpy(PageServerHost, server, (size_t)(colon - server));
+                PageServerPort = (uint16_t)strtoul(colon + 1, NULL, 10);
+            }
+        } else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+            pages = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            connectionCount = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--turn") == 0 && i + 1 < argc) {
+            turn = strtod(argv[++i], NULL) / 1e3;
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            PageTimeout = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--warm") == 0) {
+            warm = 1;
+        } else if (argv[i][0] != '-' && PageCallCount < kPageMaxCalls && PageParseURL(argv[i], &PageCalls[PageCallCount]) == 0) {
+            PageCallCount++;
+        } else {
+            valid = 0;
+        }
+    }
+    if (!valid || PageCallCount == 0 || pages == 0 || connectionCount == 0 || connectionCount > kPageMaxConnections || !(turn >= 0) || !(PageTimeout > 0)) {
+        fprintf(stderr, "usage: %s [--server host:port] [--pages N] [--connections N] [--turn ms] [--warm] [--timeout s] http://host[:port]/ac?...\n", argv[0]);
+        return 2;
+    }
+    for (size_t c = 0; c < kPageMaxConnections; c++) {
+        connections[c].fd = -1;
+        connections[c].busy = 0;
+    }
+
+    for (int way = 0; way < PageWayCount; way++) {
+        AdHistogramInit(&PageLatencies[way]);
+        AdHistogramInit(&PageCallLatencies[way]);
+        for (unsigned long page = 0; page < pages; page++) {
+            PageRun((PageWay)way, connections, connectionCount, turn, warm);
+        }
+        for (size_t c = 0; c < connectionCount; c++) {
+            PageClose(&connections[c]);
+        }
+    }
+
+    printf("%lu pages of %zu calls on %lu %s connections, a turn of %.1f ms:\n", pages, PageCallCount, connectionCount, warm ? "warm" : "new", turn * 1e3);
+    for (int way = 0; way < PageWayCount; way++) {
+        printf("%s: %llu connections opened, %llu errors\n", PageWayNames[way], PageConnectionsOpened[way], PageErrors[way]);
+        PagePrintHistogram("page", &PageLatencies[way]);
+        PagePrintHistogram("call", &PageCallLatencies[way]);
+    }
+    return 0;
+}
@@ -0,0 +1,322 @@
+//
+//  adrangestub.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ A local HTTP server that answers byte range requests, to exercise the video prefetching away from a CDN.
+
+    cc -std=gnu99 -O2 -o adrangestub tools/adrangestub.c
+    ./adrangestub [--port N] [--rate bytes/s] [--no-ranges] directory
+
+ It serves the files of the directory over HTTP/1.1, one connection at a time, with Connection: close:
+
+ - GET and HEAD, with an ETag made of the size and modification time and a Last-Modified;
+ - Range: bytes=a-b, a- and -n, answered 206 with Content-Range, or 416 past the end;
+ - If-Range: the whole file (200) if the validator no longer matches;
+ - --rate throttles the bodies to a cellular-like bandwidth, --no-ranges ignores Range as some CDNs do.
+
+ Each request is logged with its range and the bytes sent; the totals are printed on SIGINT. Run it
+ on the Mac, and point the creativeURL of a video ad (or tools/advideoprefetch) at
+ http://localhost:PORT/file.mp4.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define kStubRequestMaxLength   8192
+#define kStubBufferLength       (64 * 1024)
+
+static const char *StubRoot;
+static uint64_t StubRate;
+static int StubIgnoresRanges;
+static volatile sig_atomic_t StubStopped;
+static unsigned long StubRequests;
+static unsigned long long StubBytesSent;
+
+static void StubStop(int signal)
+{
+    (void)signal;
+    StubStopped = 1;
+}
+
+static int StubWriteAll(int fd, const void *bytes, size_t length)
+{
+    const char *cursor = bytes;
+
+    while (length > 0) {
+        ssize_t count = write(fd, cursor, length);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return -1;
+        }
+        cursor += count;
+        length -= (size_t)count;
+    }
+    return 0;
+}
+
+static void StubSendStatus(int client, int status, const char *reason)
+{
+    char response[256];
+    int length = snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status, reason);
+
+    StubWriteAll(client, response, (size_t)length);
+    printf("%d %s\n", status, reason);
+}
+
+/** The value of a header of the request, copied into value, or NULL. */
+static const char *StubHeader(const char *request, const char *name, char *value, size_t capacity)
+{
+    size_t nameLength = strlen(name);
+
+    for (const char *line = strstr(request, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        const char *start = line + 2;
+
+        if (strncasecmp(start, name, nameLength) == 0 && start[nameLength] == ':') {
+            const char *end = strstr(start, "\r\n");
+            size_t length;
+
+            start += nameLength + 1;
+            while (*start == ' ') {
+                start++;
+            }
+            length = (size_t)(end - start);
+            if (length >= capacity) {
+                length = capacity - 1;
+            }
+            memcpy(value, start, length);
+            value[length] = '\0';
+            return value;
+        }
+    }
+    return NULL;
+}
+
+/** Parses a single range against the length. Returns 1 and sets [first, last], 0 if it cannot be satisfied, -1 if it is not understood. */
+static int StubParseRange(const char *range, uint64_t length, uint64_t *first, uint64_t *last)
+{
+    char *end;
+
+    if (strncmp(range, "bytes=", 6) != 0 || strchr(range, ',')) {
+        return -1;
+    }
+    range += 6;
+    if (*range == '-') {
+        uint64_t suffix = strtoull(range + 1, &end, 10);
+
+        if (end == range + 1 || suffix == 0 || length == 0) {
+            return 0;
+        }
+        *first = suffix < length ? length - suffix : 0;
+        *last = length - 1;
+        return 1;
+    }
+    *first = strtoull(range, &end, 10);
+    if (end == range || *end != '-') {
+        return -1;
+    }
+    *last = end[1] ? strtoull(end + 1, NULL, 10) : UINT64_MAX;
+    if (*first >= length || *last < *first) {
+        return 0;
+    }
+    if (*last >= length) {
+        *last = length - 1;
+    }
+    return 1;
+}
+
+static void StubSendBody(int client, int fd, uint64_t offset, uint64_t length)
+{
+    static char buffer[kStubBufferLength];
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t sent = 0; sent < length;) {
+        size_t chunk = length - sent < sizeof(buffer) ? (size_t)(length - sent) : sizeof(buffer);
+        ssize_t count = pread(fd, buffer, chunk, (off_t)(offset + sent));
+
+        if (count <= 0 || StubWriteAll(client, buffer, (size_t)count) != 0) {
+            return;
+        }
+        sent += (uint64_t)count;
+        StubBytesSent += (uint64_t)count;
+        if (StubRate > 0) {
+            double elapsed, due = (double)sent / (double)StubRate;
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            elapsed = (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+            if (due > elapsed) {
+                struct timespec pause = { (time_t)(due - elapsed), (long)((due - elapsed - (double)(time_t)(due - elapsed)) * 1e9) };
+
+                nanosleep(&pause, NULL);
+            }
+        }
+    }
+}
+
+static void StubServe(int client)
+{
+    char request[kStubRequestMaxLength + 1];
+    char method[8], target[1024], path[2048], header[256], etag[64], lastModified[64], response[1024];
+    size_t length = 0;
+    uint64_t first = 0, last = 0;
+    int partial = 0, fd;
+    struct stat info;
+    struct tm modified;
+
+    while (length < kStubRequestMaxLength && (length < 4 || memcmp(request + length - 4, "\r\n\r\n", 4) != 0)) {
+        ssize_t count = read(client, request + length, kStubRequestMaxLength - length);
+
+        if (count <= 0) {
+            return;
+        }
+        length += (size_t)count;
+        request[length] = '\0';
+    }
+    StubRequests++;
+    if (sscanf(request, "%7s %1023s", method, target) != 2 || strstr(target, "..")) {
+        StubSendStatus(client, 400, "Bad Request");
+        return;
+    }
+    target[strcspn(target, "?")] = '\0';
+    printf("%s %s ", method, target);
+    if (strcmp(method, "GET") != 0 && strcmp(method, "HEAD") != 0) {
+        StubSendStatus(client, 405, "Method Not Allowed");
+        return;
+    }
+    snprintf(path, sizeof(path), "%s%s", StubRoot, target);
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        StubSendStatus(client, 404, "Not Found");
+        return;
+    }
+    snprintf(etag, sizeof(etag), "\"%" PRIx64 "-%" PRIx64 "\"", (uint64_t)info.st_size, (uint64_t)info.st_mtime);
+    gmtime_r(&info.st_mtime, &modified);
+    strftime(lastModified, sizeof(lastModified), "%a, %d %b %Y %H:%M:%S GMT", &modified);
+
+    if (!StubIgnoresRanges && StubHeader(request, "Range", header, sizeof(header))) {
+        char validator[256];
+        // A stale If-Range asks for the whole new file instead of a piece of it.
+        int current = StubHeader(request, "If-Range", validator, sizeof(validator)) == NULL
+            || strcmp(validator, etag) == 0 || strcmp(validator, lastModified) == 0;
+
+        if (current) {
+            int parsed = StubParseRange(header, (uint64_t)info.st_size, &first, &last);
+
+            if (parsed == 0) {
+                length = (size_t)snprintf(response, sizeof(response), "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%" PRIu64 "\r\n"
+                                          "Content-Length: 0\r\nConnection: close\r\n\r\n", (uint64_t)info.st_size);
+                StubWriteAll(client, response, length);
+                printf("%s 416\n", header);
+                close(fd);
+                return;
+            }
+            partial = parsed == 1;
+            printf("%s ", header);
+        }
+    }
+    if (!partial) {
+        first = 0;
+        last = info.st_size > 0 ? (uint64_t)info.st_size - 1 : 0;
+    }
+
+    length = (size_t)snprintf(response, sizeof(response), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %" PRIu64 "\r\n"
+                              "Accept-Ranges: %s\r\nETag: %s\r\nLast-Modified: %s\r\n",
+                              partial ? "206 Partial Content" : "200 OK", strstr(target, ".mp4") ? "video/mp4" : "application/octet-stream",
+                              info.st_size > 0 ? last - first + 1 : 0, StubIgnoresRanges ? "none" : "bytes", etag, lastModified);
+    if (partial) {
+        length += (size_t)snprintf(response + length, sizeof(response) - length, "Content-Range: bytes %" PRIu64 "-%" PRIu64 "/%" PRIu64 "\r\n",
+                                   first, last, (uint64_t)info.st_size);
+    }
+    length += (size_t)snprintf(response + length, sizeof(response) - length, "Connection: close\r\n\r\n");
+    StubWriteAll(client, response, length);
+    if (strcmp(method, "GET") == 0 && info.st_size > 0) {
+        StubSendBody(client, fd, first, last - first + 1);
+    }
+    printf("%d %" PRIu64 " bytes\n", partial ? 206 : 200, strcmp(method, "GET") == 0 && info.st_size > 0 ? last - first + 1 : 0);
+    fflush(stdout);
+    close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_in address;
+    struct sigaction action;
+    int port = 8088, server, reuse = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            StubRate = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--no-ranges") == 0) {
+            StubIgnoresRanges = 1;
+        } else if (argv[i][0] != '-' && StubRoot == NULL) {
+            StubRoot = argv[i];
+        } else {
+            StubRoot = NULL;
+            break;
+        }
+    }
+    if (StubRoot == NULL) {
+        fprintf(stderr, "usage: %s [--port N] [--rate bytes/s] [--no-ranges] directory\n", argv[0]);
+        return 2;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = StubStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    server = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (server < 0 || bind(server, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server, 16) != 0) {
+        perror("adrangestub");
+        return 1;
+    }
+    printf("serving %s on http://localhost:%d/\n", StubRoot, port);
+    fflush(stdout);
+
+    while (!StubStopped) {
+        int client = accept(server, NULL, NULL);
+
+        if (client < 0) {
+            continue;
+        }
+        StubServe(client);
+        close(client);
+    }
+    printf("%lu requests, %llu body bytes sent\n", StubRequests, StubBytesSent);
+    close(server);
+    return 0;
+}
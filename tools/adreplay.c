@@ -0,0 +1,539 @@
+//
+//  adreplay.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Serves a recorded AdTrace over HTTP, so the ad stack can be exercised and loaded without the ad server.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adreplay tools/adreplay.c DemoSmart/AdTrace.c DemoSmart/AdTimerWheel.c
+    ./adreplay [--port N] [--time-scale X] [--setup-delay ms] [--verbose] trace.adtrace
+    ./adreplay --dump trace.adtrace
+
+ Each request is answered with the recorded exchange of its method and URL (see AdTrace.h): its
+ status, Content-Type, Location and body. The host is the Host header, or the URL of the request
+ line when the server is used as an HTTP proxy. The response headers are sent after the recorded
+ time to first byte and the body after the recorded duration, both multiplied by --time-scale: 1
+ replays the recorded network, 0 answers at once to measure the throughput of the client. An
+ exchange recorded without a response closes the connection after its duration. A request the
+ trace cannot answer gets a 404.
+
+ --setup-delay holds the requests of each new connection for that long before reading them, as the
+ TCP and TLS handshakes of a distant server would: tools/adwarmup measures what pre-connecting saves.
+
+ The connections are kept alive and served by a single thread, with poll and an AdTimerWheel of
+ 1 ms ticks for the delays, so thousands of them can wait for their response at once. The counts
+ of the replay are printed on SIGINT. tools/adload drives it with simulated sessions.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdTimerWheel.h"
+#include "AdTrace.h"
+
+#define kReplayMaxClients       4096
+#define kReplayRequestMaxLength 8192
+#define kReplayHeadersLength    1024
+
+typedef struct {
+    int fd;
+    int settingUp;              // for --setup-delay, the requests are not read yet
+    uint32_t generation;        // tells a timer of a closed connection from one of the next
+    char request[kReplayRequestMaxLength + 1];
+    size_t requestLength;
+    size_t consumed;            // the length of the request being answered, body included
+    int responding;
+    const AdTraceExchange *exchange;
+    int timerPending;           // for the time of the first byte, or of the end of the body
+    int headersQueued;
+    int bodyReleased;
+    int keepAlive;
+    int headOnly;
+    char headers[kReplayHeadersLength];
+    size_t headersLength;
+    size_t headersSent;
+    size_t bodySent;
+} ReplayClient;
+
+static AdTrace *ReplayTrace;
+static AdTraceReplayer *ReplayReplayer;
+static AdTimerWheel *ReplayWheel;
+static ReplayClient ReplayClients[kReplayMaxClients];
+static double ReplayTimeScale = 1;
+static uint32_t ReplaySetupDelay;          // milliseconds
+static int ReplayVerbose;
+static volatile sig_atomic_t ReplayStopped;
+static unsigned long long ReplayRequests, ReplayResponses[AdTraceKindCount], ReplayNotFound, ReplayFailures, ReplayBytesSent, ReplayConnections;
+
+static void ReplayStop(int signal)
+{
+    (void)signal;
+    ReplayStopped = 1;
+}
+
+static uint64_t ReplayNowMilliseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static const char *ReplayReason(unsigned status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return status < 300 ? "OK" : status < 400 ? "Redirect" : status < 500 ? "Client Error" : "Server Error";
+    }
+}
+
+/** The value of a header of the request, copied into value, or NULL. */
+static const char *ReplayHeader(const char *request, const char *name, char *value, size_t capacity)
+{
+    size_t nameLength = strlen(name);
+
+    for (const char *line = strstr(request, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        const char *start = line + 2;
+
+        if (strncasecmp(start, name, nameLength) == 0 && start[nameLength] == ':') {
+            const char *end = strstr(start, "\r\n");
+            size_t length;
+
+            start += nameLength + 1;
+            while (*start == ' ') {
+                start++;
+            }
+            length = (size_t)(end - start);
+            if (length >= capacity) {
+                length = capacity - 1;
+            }
+            memcpy(value, start, length);
+            value[length] = '\0';
+            return value;
+        }
+    }
+    return NULL;
+}
+
+// Connections
+
+static void ReplayClose(ReplayClient *client)
+{
+    close(client->fd);
+    client->fd = -1;
+    client->generation++;
+}
+
+static void ReplaySchedule(ReplayClient *client, uint32_t microseconds)
+{
+    uint64_t ticks = (uint64_t)((double)microseconds * ReplayTimeScale / 1000 + 0.5);
+    uintptr_t context = (uintptr_t)(client - ReplayClients) | (uintptr_t)client->generation << 16;
+
+    client->timerPending = ticks > 0 && AdTimerWheelSchedule(ReplayWheel, ticks, (void *)context) != kAdTimerNone;
+}
+
+static void ReplayQueueHeaders(ReplayClient *client, unsigned status, const char *contentType, const char *location, size_t bodyLength)
+{
+    int length = snprintf(client->headers, sizeof(client->headers), "HTTP/1.1 %u %s\r\nContent-Length: %zu\r\n", status, ReplayReason(status), bodyLength);
+
+    if (contentType && contentType[0]) {
+        length += snprintf(client->headers + length, sizeof(client->headers) - (size_t)length, "Content-Type: %s\r\n", contentType);
+    }
+    if (location && location[0] && (size_t)length < sizeof(client->headers)) {
+        length += snprintf(client->headers + length, sizeof(client->headers) - (size_t)length, "Location: %s\r\n", location);
+    }
+    if ((size_t)length < sizeof(client->headers)) {
+        length += snprintf(client->headers + length, sizeof(client->headers) - (size_t)length, "Connection: %s\r\n\r\n", client->keepAlive ? "keep-alive" : "close");
+    }
+    client->headersLength = (size_t)length < sizeof(client->headers) ? (size_t)length : sizeof(client->headers) - 1;
+    client->headersSent = 0;
+    client->headersQueued = 1;
+}
+
+static int ReplayHasOutput(const ReplayClient *client)
+{
+    return client->headersSent < client->headersLength
+        || (client->bodyReleased && !client->headOnly && client->exchange && client->bodySent < client->exchange->bodyLength);
+}
+
+/** Parses the request at the start of the buffer when it is whole, and finds the exchange that answers it. */
+static void ReplayStartResponse(ReplayClient *client)
+{
+    char method[16], target[kReplayRequestMaxLength], version[16], host[256], value[64], URL[kReplayRequestMaxLength + 300];
+    char *end = strstr(client->request, "\r\n\r\n");
+    size_t headerLength, bodyLength = 0;
+
+    if (end == NULL) {
+        return;
+    }
+    headerLength = (size_t)(end + 4 - client->request);
+    if (ReplayHeader(client->request, "Content-Length", value, sizeof(value))) {
+        bodyLength = strtoul(value, NULL, 10);
+    }
+    if (client->requestLength < headerLength + bodyLength && headerLength + bodyLength <= kReplayRequestMaxLength) {
+        return;     // the rest of the body is still coming
+    }
+    ReplayRequests++;
+    client->responding = 1;
+    client->consumed = headerLength + bodyLength <= client->requestLength ? headerLength + bodyLength : client->requestLength;
+    client->exchange = NULL;
+    client->headersQueued = client->bodyReleased = client->headOnly = 0;
+    client->headersLength = client->headersSent = client->bodySent = 0;
+    if (sscanf(client->request, "%15s %8191s %15s", method, target, version) != 3) {
+        client->keepAlive = 0;
+        ReplayQueueHeaders(client, 400, NULL, NULL, 0);
+        return;
+    }
+    client->keepAlive = strcmp(version, "HTTP/1.0") != 0
+        && !(ReplayHeader(client->request, "Connection", value, sizeof(value)) && strcasecmp(value, "close") == 0);
+    client->headOnly = strcmp(method, "HEAD") == 0;
+    if (target[0] == '/') {
+        snprintf(URL, sizeof(URL), "http://%s%s", ReplayHeader(client->request, "Host", host, sizeof(host)) ? host : "localhost", target);
+    } else {
+        snprintf(URL, sizeof(URL), "%s", target);
+    }
+    client->exchange = AdTraceReplayerNext(ReplayReplayer, client->headOnly ? "GET" : method, URL, strlen(URL));
+    if (ReplayVerbose) {
+        printf("%s %s -> %s\n", method, URL, client->exchange ? AdTraceKindName(client->exchange->kind) : "404");
+    }
+    if (client->exchange == NULL) {
+        ReplayNotFound++;
+        ReplayQueueHeaders(client, 404, NULL, NULL, 0);
+        return;
+    }
+    ReplayResponses[client->exchange->kind]++;
+    ReplaySchedule(client, client->exchange->status ? client->exchange->firstByte : client->exchange->duration);
+}
+
+/** Queues what is due, writes what the socket takes and goes on with the next request. Returns -1 when the connection is to be closed. */
+static int ReplayAdvance(ReplayClient *client)
+{
+    while (client->responding) {
+        const AdTraceExchange *exchange = client->exchange;
+
+        if (exchange && !client->timerPending && !client->headersQueued) {
+            if (exchange->status == 0) {
+                ReplayFailures++;
+                return -1;
+            }
+            ReplayQueueHeaders(client, exchange->status, exchange->contentType, exchange->location, exchange->bodyLength);
+            if (!client->headOnly && exchange->bodyLength > 0 && exchange->duration > exchange->firstByte) {
+                ReplaySchedule(client, exchange->duration - exchange->firstByte);
+            }
+        }
+        if (client->headersQueued && !client->timerPending) {
+            client->bodyReleased = 1;
+        }
+        while (ReplayHasOutput(client)) {
+            struct iovec parts[2];
+            int count = 0;
+            ssize_t written;
+
+            if (client->headersSent < client->headersLength) {
+                parts[count].iov_base = client->headers + client->headersSent;
+                parts[count++].iov_len = client->headersLength - client->headersSent;
+            }
+            if (client->bodyReleased && !client->headOnly && exchange && client->bodySent < exchange->bodyLength) {
+                parts[count].iov_base = (char *)exchange->body + client->bodySent;
+                parts[count++].iov_len = exchange->bodyLength - client->bodySent;
+            }
+            written = writev(client->fd, parts, count);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return 0;
+            }
+            if (written <= 0) {
+                return -1;
+            }
+            ReplayBytesSent += (uint64_t)written;
+            if (client->headersSent < client->headersLength) {
+                size_t headers = client->headersLength - client->headersSent;
+
+                headers = headers < (size_t)written ? headers : (size_t)written;
+                client->headersSent += headers;
+                written -= (ssize_t)headers;
+            }
+            client->bodySent += (size_t)written;
+        }
+        if (client->timerPending || !client->bodyReleased) {
+            return 0;
+        }
+        if (!client->keepAlive) {
+            return -1;
+        }
+        // The response is complete: the next request, maybe already received, is answered.
+        memmove(client->request, client->request + client->consumed, client->requestLength - client->consumed + 1);
+        client->requestLength -= client->consumed;
+        client->consumed = 0;
+        client->responding = 0;
+        ReplayStartResponse(client);
+    }
+    return 0;
+}
+
+static int ReplayRead(ReplayClient *client)
+{
+    for (;;) {
+        ssize_t count;
+
+        if (client->requestLength == kReplayRequestMaxLength) {
+            return -1;
+        }
+        count = read(client->fd, client->request + client->requestLength, kReplayRequestMaxLength - client->requestLength);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (count <= 0) {
+            return -1;
+        }
+        client->requestLength += (size_t)count;
+        client->request[client->requestLength] = '\0';
+    }
+    if (!client->responding) {
+        ReplayStartResponse(client);
+        return ReplayAdvance(client);
+    }
+    return 0;
+}
+
+static void ReplayTimerFired(void *info, AdTimer timer, void *context)
+{
+    uintptr_t value = (uintptr_t)context;
+    ReplayClient *client = &ReplayClients[value & 0xffff];
+
+    (void)info;
+    (void)timer;
+    if (client->fd < 0 || client->generation != (uint32_t)(value >> 16)) {
+        return;     // closed while waiting
+    }
+    if (client->settingUp) {
+        client->settingUp = 0;
+        if (ReplayRead(client) != 0) {
+            ReplayClose(client);
+        }
+        return;
+    }
+    client->timerPending = 0;
+    if (ReplayAdvance(client) != 0) {
+        ReplayClose(client);
+    }
+}
+
+static void ReplayAccept(int server)
+{
+    for (;;) {
+        int fd = accept(server, NULL, NULL), noDelay = 1;
+        ReplayClient *client = NULL;
+
+        if (fd < 0) {
+            return;
+        }
+        for (size_t i = 0; i < kReplayMaxClients; i++) {
+            if (ReplayClients[i].fd < 0) {
+                client = &ReplayClients[i];
+                break;
+            }
+        }
+        if (client == NULL) {
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        client->fd = fd;
+        client->requestLength = client->consumed = 0;
+        client->responding = client->timerPending = 0;
+        client->settingUp = ReplaySetupDelay > 0
+            && AdTimerWheelSchedule(ReplayWheel, ReplaySetupDelay, (void *)((uintptr_t)(client - ReplayClients) | (uintptr_t)client->generation << 16)) != kAdTimerNone;
+        ReplayConnections++;
+    }
+}
+
+// Tool
+
+static int ReplayDump(const char *path)
+{
+    AdTrace *trace = AdTraceOpen(path);
+
+    if (trace == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    printf("%zu exchanges in %zu sessions\n", AdTraceGetCount(trace), AdTraceGetSessionCount(trace));
+    for (size_t i = 0; i < AdTraceGetCount(trace); i++) {
+        const AdTraceExchange *exchange = AdTraceGetExchange(trace, i);
+
+        printf("%10.3f s  %-8s %3u  %7.1f ms  %7.1f ms  %7zu bytes  %s %s%s%s\n", exchange->start / 1e6, AdTraceKindName(exchange->kind),
+               exchange->status, exchange->firstByte / 1e3, exchange->duration / 1e3, exchange->bodyLength, exchange->method, exchange->URL,
+               exchange->location[0] ? " -> " : "", exchange->location);
+    }
+    AdTraceClose(trace);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct pollfd fds[kReplayMaxClients + 1];
+    static ReplayClient *polled[kReplayMaxClients + 1];
+    const char *path = NULL;
+    struct sockaddr_in address;
+    struct sigaction action;
+    int port = 8089, server, reuse = 1;
+    uint64_t start;
+    AdTraceReplayStatistics statistics;
+
+    if (argc == 3 && strcmp(argv[1], "--dump") == 0) {
+        return ReplayDump(argv[2]);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc) {
+            ReplayTimeScale = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--setup-delay") == 0 && i + 1 < argc) {
+            ReplaySetupDelay = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            ReplayVerbose = 1;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || ReplayTimeScale < 0) {
+        fprintf(stderr, "usage: %s [--port N] [--time-scale X] [--setup-delay ms] [--verbose] trace.adtrace\n"
+                        "       %s --dump trace.adtrace\n", argv[0], argv[0]);
+        return 2;
+    }
+    ReplayTrace = AdTraceOpen(path);
+    ReplayReplayer = ReplayTrace ? AdTraceReplayerCreate(ReplayTrace) : NULL;
+    ReplayWheel = AdTimerWheelCreate(1024);
+    if (ReplayReplayer == NULL || ReplayWheel == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    for (size_t i = 0; i < kReplayMaxClients; i++) {
+        ReplayClients[i].fd = -1;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ReplayStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    server = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (server < 0 || bind(server, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server, 1024) != 0) {
+        perror("adreplay");
+        return 1;
+    }
+    fcntl(server, F_SETFL, fcntl(server, F_GETFL) | O_NONBLOCK);
+    printf("replaying %zu exchanges of %s on http://localhost:%d/, time scale %g, setup delay %u ms\n", AdTraceGetCount(ReplayTrace), path, port,
+           ReplayTimeScale, ReplaySetupDelay);
+    fflush(stdout);
+
+    start = ReplayNowMilliseconds();
+    while (!ReplayStopped) {
+        nfds_t count = 1;
+        uint64_t elapsed;
+
+        fds[0].fd = server;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < kReplayMaxClients; i++) {
+            ReplayClient *client = &ReplayClients[i];
+
+            if (client->fd >= 0) {
+                fds[count].fd = client->fd;
+                fds[count].events = client->settingUp ? 0 : (short)(POLLIN | (ReplayHasOutput(client) ? POLLOUT : 0));
+                polled[count++] = client;
+            }
+        }
+        if (poll(fds, count, AdTimerWheelGetCount(ReplayWheel) > 0 ? 1 : 100) < 0 && errno != EINTR) {
+            perror("adreplay");
+            break;
+        }
+        elapsed = ReplayNowMilliseconds() - start;
+        if (elapsed > AdTimerWheelGetTime(ReplayWheel)) {
+            AdTimerWheelAdvance(ReplayWheel, elapsed - AdTimerWheelGetTime(ReplayWheel), ReplayTimerFired, NULL);
+        }
+        for (nfds_t i = 1; i < count; i++) {
+            ReplayClient *client = polled[i];
+            int status = 0;
+
+            if (client->fd != fds[i].fd || fds[i].revents == 0) {
+                continue;
+            }
+            if (fds[i].revents & (POLLERR | POLLNVAL) || (client->settingUp && (fds[i].revents & POLLHUP))) {
+                status = -1;
+            }
+            if (status == 0 && (fds[i].revents & (POLLIN | POLLHUP))) {
+                status = ReplayRead(client);
+            }
+            if (status == 0 && (fds[i].revents & POLLOUT)) {
+                status = ReplayAdvance(client);
+            }
+            if (status != 0) {
+                ReplayClose(client);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            ReplayAccept(server);
+        }
+    }
+
+    statistics = AdTraceReplayerGetStatistics(ReplayReplayer);
+    printf("%llu connections, %llu requests: %llu ad calls, %llu creatives, %llu pixels, %llu not found, %llu failures replayed\n",
+           ReplayConnections, ReplayRequests, ReplayResponses[AdTraceKindAdCall], ReplayResponses[AdTraceKindCreative],
+           ReplayResponses[AdTraceKindPixel], ReplayNotFound, ReplayFailures);
+    printf("%" PRIu64 " exact, %" PRIu64 " approximate, %" PRIu64 " missed; %llu bytes sent\n",
+           statistics.exact, statistics.approximate, statistics.missed, ReplayBytesSent);
+    close(server);
+    AdTimerWheelRelease(ReplayWheel);
+    AdTraceReplayerRelease(ReplayReplayer);
+    AdTraceClose(ReplayTrace);
+    return 0;
+}
@@ -0,0 +1,192 @@
+//
+//  adstrings.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Compiles a Localizable.strings file into an AdStringTable, and reads compiled tables back.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adstrings tools/adstrings.c DemoSmart/AdStringTable.c
+    ./adstrings [--strict] Localizable.strings Localizable.adstrings
+    ./adstrings --dump Localizable.adstrings
+    ./adstrings --lookup Localizable.adstrings... -- key...
+
+ The "Compile string tables" build phase of the app runs it on every .lproj of sas.bundle, the
+ tables going next to the sources in the built sas.bundle. A duplicate key is reported as a
+ warning in the format of the compilers, which Xcode shows on the line of the .strings file; with
+ --strict, duplicates with different values fail the build.
+
+ --lookup goes through the tables in order, as the app does with the user's language first.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AdStringTable.h"
+
+typedef struct {
+    const char *path;
+    unsigned duplicates;
+    unsigned conflicts;
+} StringsSource;
+
+static void StringsReportDuplicate(void *info, const char *key, unsigned line, unsigned firstLine, int sameValue)
+{
+    StringsSource *source = info;
+
+    fprintf(stderr, "%s:%u: warning: \"%s\" is already defined at line %u%s\n", source->path, line, key, firstLine,
+            sameValue ? " with the same value" : ", with another value: this one is kept");
+    source->duplicates++;
+    source->conflicts += !sameValue;
+}
+
+static void *StringsReadFile(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    char *bytes = NULL;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0
+        && (bytes = malloc((size_t)size + 1)) != NULL && fread(bytes, 1, (size_t)size, file) == (size_t)size) {
+        *length = (size_t)size;
+    } else {
+        free(bytes);
+        bytes = NULL;
+        errno = errno ? errno : EIO;
+    }
+    fclose(file);
+    return bytes;
+}
+
+/** Writes next to the output then renames, a failed build does not leave half a table. */
+static int StringsWriteFile(const char *path, const void *bytes, size_t length)
+{
+    char temporary[4096];
+    FILE *file;
+
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    file = fopen(temporary, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    if (fwrite(bytes, 1, length, file) != length || fclose(file) != 0) {
+        remove(temporary);
+        return -1;
+    }
+    return rename(temporary, path);
+}
+
+static int StringsCompile(const char *input, const char *output, int strict)
+{
+    StringsSource source = { input, 0, 0 };
+    size_t length, tableLength;
+    unsigned errorLine = 0;
+    void *bytes = StringsReadFile(input, &length), *table;
+
+    if (bytes == NULL) {
+        fprintf(stderr, "%s: %s\n", input, strerror(errno));
+        return 1;
+    }
+    if (AdStringTableCompile(bytes, length, StringsReportDuplicate, &source, &table, &tableLength, &errorLine) != 0) {
+        if (errno == EINVAL && errorLine > 0) {
+            fprintf(stderr, "%s:%u: error: expected \"key\" = \"value\";\n", input, errorLine);
+        } else {
+            fprintf(stderr, "%s: %s\n", input, strerror(errno));
+        }
+        free(bytes);
+        return 1;
+    }
+    free(bytes);
+    if (strict && source.conflicts > 0) {
+        fprintf(stderr, "%s: error: %u keys defined with different values\n", input, source.conflicts);
+        free(table);
+        return 1;
+    }
+    if (StringsWriteFile(output, table, tableLength) != 0) {
+        fprintf(stderr, "%s: %s\n", output, strerror(errno));
+        free(table);
+        return 1;
+    }
+    printf("%s: %zu bytes, %u duplicates\n", output, tableLength, source.duplicates);
+    free(table);
+    return 0;
+}
+
+static int StringsDump(const char *path)
+{
+    AdStringTable *table = AdStringTableOpen(path);
+    size_t count;
+
+    if (table == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    count = AdStringTableGetCount(table);
+    printf("%zu strings, %zu duplicates\n", count, AdStringTableGetDuplicateCount(table));
+    for (size_t i = 0; i < AdStringTableGetDuplicateCount(table); i++) {
+        int conflicting;
+        const char *key = AdStringTableGetDuplicate(table, i, &conflicting);
+
+        printf("duplicate%s: \"%s\" = \"%s\"\n", conflicting ? " (different values)" : "", key, AdStringTableLookup(table, key, strlen(key), NULL));
+    }
+    AdStringTableClose(table);
+    return 0;
+}
+
+static int StringsLookup(int argc, char *argv[])
+{
+    AdStringTable *tables[16];
+    size_t count = 0;
+    int i = 0, status = 0;
+
+    for (; i < argc && strcmp(argv[i], "--") != 0; i++) {
+        if (count == sizeof(tables) / sizeof(tables[0]) || (tables[count] = AdStringTableOpen(argv[i])) == NULL) {
+            fprintf(stderr, "%s: %s\n", argv[i], count == sizeof(tables) / sizeof(tables[0]) ? "too many tables" : strerror(errno));
+            status = 1;
+            goto done;
+        }
+        count++;
+    }
+    for (i++; i < argc; i++) {
+        const char *value = AdStringTableLookupInTables((const AdStringTable *const *)tables, count, argv[i], strlen(argv[i]), NULL);
+
+        printf("%s\n", value ? value : argv[i]);
+        status |= value == NULL;
+    }
+
+done:
+    while (count > 0) {
+        AdStringTableClose(tables[--count]);
+    }
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "--dump") == 0) {
+        return StringsDump(argv[2]);
+    }
+    if (argc > 2 && strcmp(argv[1], "--lookup") == 0) {
+        return StringsLookup(argc - 2, argv + 2);
+    }
+    if (argc == 4 && strcmp(argv[1], "--strict") == 0) {
+        return StringsCompile(argv[2], argv[3], 1);
+    }
+    if (argc == 3 && argv[1][0] != '-') {
+        return StringsCompile(argv[1], argv[2], 0);
+    }
+    fprintf(stderr, "usage: %s [--strict] input.strings output.adstrings\n"
+                    "       %s --dump table.adstrings\n"
+                    "       %s --lookup table.adstrings... -- key...\n", argv[0], argv[0], argv[0]);
+    return 2;
+}
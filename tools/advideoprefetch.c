@@ -0,0 +1,375 @@
+//
+//  advideoprefetch.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Replays the chunked video prefetching of AdVideoPrefetcher against an HTTP server, away from a device.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o advideoprefetch tools/advideoprefetch.c DemoSmart/AdRangeFile.c
+    ./adrangestub --rate 250000 fixtures &
+    ./advideoprefetch [--duration S] [--prefix S] [--watch S] [--chunk N] [--cache path] [--source file] http://localhost:8088/spot.mp4
+
+ With the same parameters as the app (a 3 s prefix, 256 KB chunks, 5 s of read ahead), it:
+
+ 1. prefetches the first --prefix seconds with range requests, and reports how long that took, the
+    time to the first frame of an interstitial displayed right after;
+ 2. plays --watch seconds (all of --duration by default), keeping the read ahead window filled one
+    second of playback at a time, and counts the seconds the window was not filled in time (stalls);
+ 3. reports the bytes fetched against the length of the video, what a skip saved.
+
+ The cache (a temporary file unless --cache is given) persists: a second run with the same --cache
+ only revalidates it with a one byte request. With --source the cached bytes are compared with the file the server serves, and
+ the exit status is 1 if they differ.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdRangeFile.h"
+
+#define kPrefetchHeaderMaxLength    8192
+#define kPrefetchBufferLength       (64 * 1024)
+
+typedef struct {
+    char host[256];
+    char port[8];
+    char path[1024];
+} PrefetchURL;
+
+static uint64_t PrefetchFetchedBytes;
+static unsigned long PrefetchRequests;
+
+static double PrefetchNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int PrefetchParseURL(const char *string, PrefetchURL *url)
+{
+    const char *host, *path, *colon;
+    size_t length;
+
+    if (strncmp(string, "http://", 7) != 0) {
+        return -1;
+    }
+    host = string + 7;
+    path = strchr(host, '/');
+    if (path == NULL) {
+        path = host + strlen(host);
+    }
+    colon = memchr(host, ':', (size_t)(path - host));
+    length = (size_t)((colon ? colon : path) - host);
+    if (length == 0 || length >= sizeof(url->host)) {
+        return -1;
+    }
+    memcpy(url->host, host, length);
+    url->host[length] = '\0';
+    snprintf(url->port, sizeof(url->port), "%.*s", colon ? (int)(path - colon - 1) : 2, colon ? colon + 1 : "80");
+    snprintf(url->path, sizeof(url->path), "%s", *path ? path : "/");
+    return 0;
+}
+
+static int PrefetchConnect(const PrefetchURL *url)
+{
+    struct addrinfo hints, *addresses, *address;
+    int fd = -1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(url->host, url->port, &hints, &addresses) != 0) {
+        return -1;
+    }
+    for (address = addresses; address && fd < 0; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+/** The value of a response header, copied into value, or NULL. */
+static const char *PrefetchHeader(const char *headers, const char *name, char *value, size_t capacity)
+{
+    size_t nameLength = strlen(name);
+
+    for (const char *line = strstr(headers, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        const char *start = line + 2;
+
+        if (strncasecmp(start, name, nameLength) == 0 && start[nameLength] == ':') {
+            size_t length = strcspn(start + nameLength + 1, "\r");
+
+            start += nameLength + 1;
+            while (*start == ' ') {
+                start++;
+                length--;
+            }
+            snprintf(value, capacity, "%.*s", (int)length, start);
+            return value;
+        }
+    }
+    return NULL;
+}
+
+/** Requests [range.start, range.end) with If-Range and writes what comes back into the file, at the offset it is for.
+
+ The file learns the length and validator of the video from the first answer; a changed validator
+ discards what was cached. Returns 0, or -1 if the request failed.
+ */
+static int PrefetchFetch(const PrefetchURL *url, AdRangeFile *file, AdRange range)
+{
+    static char buffer[kPrefetchBufferLength];
+    char request[2048], headers[kPrefetchHeaderMaxLength + 1], value[256];
+    size_t headerLength = 0, pending;
+    uint64_t offset = 0, total = 0;
+    int fd = PrefetchConnect(url), status = 0, length;
+    char *body;
+
+    if (fd < 0) {
+        return -1;
+    }
+    length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\nRange: bytes=%" PRIu64 "-%" PRIu64 "\r\n",
+                      url->path, url->host, range.start, range.end - 1);
+    if (AdRangeFileGetValidator(file)[0] != '\0') {
+        length += snprintf(request + length, sizeof(request) - (size_t)length, "If-Range: %s\r\n", AdRangeFileGetValidator(file));
+    }
+    length += snprintf(request + length, sizeof(request) - (size_t)length, "Connection: close\r\n\r\n");
+    if (write(fd, request, (size_t)length) != length) {
+        close(fd);
+        return -1;
+    }
+    PrefetchRequests++;
+
+    while ((body = headerLength ? strstr(headers, "\r\n\r\n") : NULL) == NULL) {
+        ssize_t count = headerLength < kPrefetchHeaderMaxLength ? read(fd, headers + headerLength, kPrefetchHeaderMaxLength - headerLength) : -1;
+
+        if (count <= 0) {
+            close(fd);
+            return -1;
+        }
+        headerLength += (size_t)count;
+        headers[headerLength] = '\0';
+    }
+    body += 4;
+    pending = headerLength - (size_t)(body - headers);
+    sscanf(headers, "HTTP/%*s %d", &status);
+
+    if (status == 206 && PrefetchHeader(headers, "Content-Range", value, sizeof(value))) {
+        if (sscanf(value, "bytes %" SCNu64 "-%*[0-9]/%" SCNu64, &offset, &total) != 2) {
+            close(fd);
+            return -1;
+        }
+    } else if (status == 200 && PrefetchHeader(headers, "Content-Length", value, sizeof(value))) {
+        // No range support, or a new version of the file: the whole of it follows, and is kept
+        // rather than asked for again from the start for each chunk.
+        total = strtoull(value, NULL, 10);
+    } else {
+        close(fd);
+        return -1;
+    }
+    if (PrefetchHeader(headers, "ETag", value, sizeof(value)) || PrefetchHeader(headers, "Last-Modified", value, sizeof(value))) {
+        AdRangeFileSetValidator(file, value);
+    }
+    if (AdRangeFileSetLength(file, total) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    memmove(buffer, body, pending);
+    for (;;) {
+        ssize_t count;
+
+        if (pending > 0) {
+            if (AdRangeFileWrite(file, offset, buffer, pending) != 0) {
+                close(fd);
+                return -1;
+            }
+            offset += pending;
+            PrefetchFetchedBytes += pending;
+            pending = 0;
+        }
+        count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        pending = (size_t)count;
+    }
+    close(fd);
+    return 0;
+}
+
+/** Fetches the missing chunks of [start, end). Returns 0, or -1 if a request failed. */
+static int PrefetchFill(const PrefetchURL *url, AdRangeFile *file, uint64_t start, uint64_t end, uint64_t chunk)
+{
+    AdRange range;
+
+    while (AdRangeFileGetNextMissing(file, start, end, chunk, &range) == 0) {
+        if (PrefetchFetch(url, file, range) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int PrefetchVerify(AdRangeFile *file, const char *source)
+{
+    static char cached[kPrefetchBufferLength], original[kPrefetchBufferLength];
+    FILE *stream = fopen(source, "rb");
+    uint64_t offset = 0, checked = 0;
+    int mismatches = 0;
+
+    if (stream == NULL) {
+        perror(source);
+        return -1;
+    }
+    while (offset < AdRangeFileGetLength(file)) {
+        ssize_t count = AdRangeFileRead(file, offset, cached, sizeof(cached));
+
+        if (count <= 0) {
+            AdRange gap;
+
+            if (AdRangeFileGetNextMissing(file, offset, UINT64_MAX, UINT64_MAX, &gap) != 0) {
+                break;
+            }
+            offset = gap.end;
+            continue;
+        }
+        if (fseeko(stream, (off_t)offset, SEEK_SET) != 0 || fread(original, 1, (size_t)count, stream) != (size_t)count
+            || memcmp(cached, original, (size_t)count) != 0) {
+            if (mismatches++ == 0) {
+                fprintf(stderr, "cached bytes differ from %s from around %" PRIu64 "\n", source, offset);
+            }
+        }
+        offset += (uint64_t)count;
+        checked += (uint64_t)count;
+    }
+    fclose(stream);
+    printf("verified    %" PRIu64 " cached bytes against %s, %d mismatches\n", checked, source, mismatches);
+    return mismatches ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char temporary[] = "/tmp/advideoprefetch.XXXXXX";
+    const char *cachePath = NULL, *source = NULL, *string = NULL;
+    double duration = 15, prefix = 3, watch = -1, readAhead = 5;
+    uint64_t chunk = 256 * 1024, length, bytesPerSecond, prefixFetched;
+    unsigned stalls = 0;
+    double start, prefixTime;
+    PrefetchURL url;
+    AdRangeFile *file;
+    int failed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+            prefix = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watch = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+            source = argv[++i];
+        } else if (argv[i][0] != '-' && string == NULL) {
+            string = argv[i];
+        } else {
+            string = NULL;
+            break;
+        }
+    }
+    if (string == NULL || PrefetchParseURL(string, &url) != 0 || duration <= 0 || chunk == 0) {
+        fprintf(stderr, "usage: %s [--duration S] [--prefix S] [--watch S] [--chunk N] [--cache path] [--source file] http://host[:port]/path\n", argv[0]);
+        return 2;
+    }
+    if (watch < 0 || watch > duration) {
+        watch = duration;
+    }
+    if (cachePath == NULL) {
+        int fd = mkstemp(temporary);
+
+        if (fd < 0) {
+            perror("mkstemp");
+            return 1;
+        }
+        close(fd);
+        cachePath = temporary;
+    }
+    file = AdRangeFileOpen(cachePath);
+    if (file == NULL) {
+        perror(cachePath);
+        return 1;
+    }
+
+    // Prefetch: the first chunk tells the length, the prefix follows from the duration. When it is
+    // cached already, a one byte request with If-Range checks that the video did not change.
+    start = PrefetchNow();
+    if (AdRangeFileGetAvailable(file, 0) > 0) {
+        AdRange first = { 0, 1 };
+
+        failed |= PrefetchFetch(&url, file, first);
+    }
+    if (failed || PrefetchFill(&url, file, 0, chunk, chunk) != 0 || AdRangeFileGetLength(file) == 0) {
+        fprintf(stderr, "%s: the first chunk could not be fetched\n", string);
+        AdRangeFileClose(file);
+        return 1;
+    }
+    length = AdRangeFileGetLength(file);
+    bytesPerSecond = (uint64_t)((double)length / duration) + 1;
+    failed |= PrefetchFill(&url, file, 0, (uint64_t)(prefix * (double)bytesPerSecond), chunk);
+    prefixTime = PrefetchNow() - start;
+    prefixFetched = PrefetchFetchedBytes;
+
+    // Playback, one second at a time: the window must hold the next readAhead seconds when the second starts.
+    for (double second = 0; second < watch && !failed; second++) {
+        double deadline = PrefetchNow() + 1;
+        uint64_t playhead = (uint64_t)(second * (double)bytesPerSecond);
+
+        failed |= PrefetchFill(&url, file, playhead, playhead + (uint64_t)(readAhead * (double)bytesPerSecond), chunk);
+        if (AdRangeFileGetAvailable(file, playhead) < (uint64_t)bytesPerSecond && playhead + (uint64_t)bytesPerSecond < length) {
+            stalls++;
+        }
+        if (PrefetchNow() > deadline && second > 0) {
+            stalls++;
+        }
+    }
+
+    printf("video       %" PRIu64 " bytes, %.1f s, %" PRIu64 " bytes/s\n", length, duration, bytesPerSecond);
+    printf("prefix      %.1f s, %" PRIu64 " bytes fetched in %.0f ms\n", prefix, prefixFetched, prefixTime * 1000);
+    printf("watched     %.1f s, %u stalls\n", watch, stalls);
+    printf("fetched     %" PRIu64 " bytes in %lu requests, %.0f%% of the video\n", PrefetchFetchedBytes, PrefetchRequests,
+           100.0 * (double)PrefetchFetchedBytes / (double)length);
+    printf("cached      %" PRIu64 " bytes in %u ranges%s\n", AdRangeFileGetCachedBytes(file), AdRangeFileGetRangeCount(file),
+           AdRangeFileIsComplete(file) ? ", complete" : "");
+    printf("cache       %s\n", cachePath);
+    if (source && PrefetchVerify(file, source) != 0) {
+        failed = 1;
+    }
+    AdRangeFileClose(file);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+//
+//  adwarmup.c
+//  DemoSmart
+//
+//  Created by Samuel on 16/10/26.
+//  Copyright (c) 2026 Mobvalue. All rights reserved.
+//
+
+/**
+ Measures what resolving and connecting to the ad hosts ahead of the requests saves, with an AdConnectionPool.
+
+    cc -std=gnu99 -O2 -I DemoSmart -o adwarmup tools/adwarmup.c DemoSmart/AdConnectionPool.c DemoSmart/AdHistogram.c
+    ./adreplay --setup-delay 150 trace.adtrace &
+    ./adwarmup [--requests N] [--interval ms] [--idle-timeout s] [--timeout s] [--cold] [--verbose] http://host[:port]/path...
+
+ Each origin of the URLs is warmed up first, as AdConnectionWarmer does when the site ID is set: its
+ host is resolved, a connection opened and a HEAD / sent over it, so that the server is done with
+ the setup of the connection, and the connection is given to the pool. The resolution, connection
+ and HEAD times are printed by origin with the canonical name of the host. --cold skips the warm-up.
+
+ Then --requests rounds of GETs, one by URL, are sent --interval apart: each takes a connection of
+ the pool or opens one, and gives it back once its response is read whole, unless it was
+ Connection: close. The pool is evicted before each round, so an interval above --idle-timeout
+ shows the cost of the evictions. A request that fails on a connection of the pool, closed by the
+ server meanwhile, is sent again on a new one, as the URL loading system does.
+
+ The report gives the percentiles of the time to first byte and of the whole response of the
+ requests that reused a connection and of those that opened one, the time to open included. Point
+ it at adreplay with --setup-delay, which holds the first request of each connection like a distant
+ TLS server, or at the ad server itself. Plain HTTP only: the TLS handshake of https is left to the
+ URL loading system on the device.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdConnectionPool.h"
+#include "AdHistogram.h"
+
+#define kWarmupMaxURLs          64
+#define kWarmupHeadersLength    16384
+
+typedef struct {
+    char host[kAdConnectionHostLength];
+    uint16_t port;
+    const char *path;
+} WarmupURL;
+
+typedef struct {
+    int status;
+    int keepAlive;
+    double firstByte;           // seconds since the request was sent
+} WarmupResponse;
+
+static WarmupURL WarmupURLs[kWarmupMaxURLs];
+static size_t WarmupURLCount;
+static double WarmupTimeout = 5;
+static int WarmupVerbose;
+static AdHistogram WarmupFirstBytes[2], WarmupDurations[2];     // cold, reused
+static unsigned long long WarmupRetries, WarmupErrors;
+
+static double WarmupNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/** Splits http://host[:port]/path. Returns 0, or -1 when the URL is not plain HTTP. */
+static int WarmupParseURL(const char *string, WarmupURL *URL)
+{
+    const char *host = string + strlen("http://"), *end;
+    size_t length;
+
+    if (strncasecmp(string, "http://", strlen("http://")) != 0) {
+        return -1;
+    }
+    end = host + strcspn(host, ":/");
+    length = (size_t)(end - host);
+    if (length == 0 || length >= sizeof(URL->host)) {
+        return -1;
+    }
+    memcpy(URL->host, host, length);
+    URL->host[length] = '\0';
+    URL->port = 80;
+    if (*end == ':') {
+        URL->port = (uint16_t)strtoul(end + 1, NULL, 10);
+        end += strcspn(end, "/");
+    }
+    URL->path = *end ? end : "/";
+    return 0;
+}
+
+/** Sends the request and reads its response whole. Returns 0, or -1 with errno set when the connection failed. */
+static int WarmupExchange(int fd, const char *method, const WarmupURL *URL, WarmupResponse *response)
+{
+    char buffer[kWarmupHeadersLength + 1];
+    size_t length = 0, bodyLength = 0, received;
+    const char *headersEnd = NULL, *header;
+    double sent;
+    int request, hasLength = 0;
+    ssize_t count;
+
+    request = snprintf(buffer, sizeof(buffer), "%s %s HTTP/1.1\r\nHost: %s:%u\r\nUser-Agent: adwarmup\r\n\r\n", method, URL->path, URL->host, URL->port);
+    if (request < 0 || (size_t)request >= sizeof(buffer) || send(fd, buffer, (size_t)request, 0) != request) {
+        return -1;
+    }
+    sent = WarmupNow();
+    response->firstByte = 0;
+    while (headersEnd == NULL) {
+        count = recv(fd, buffer + length, kWarmupHeadersLength - length, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0 || (length += (size_t)count) == kWarmupHeadersLength) {
+            errno = count < 0 ? errno : ECONNRESET;
+            return -1;
+        }
+        if (response->firstByte == 0) {
+            response->firstByte = WarmupNow() - sent;
+        }
+        buffer[length] = '\0';
+        headersEnd = strstr(buffer, "\r\n\r\n");
+    }
+    response->status = atoi(buffer + strcspn(buffer, " "));
+    response->keepAlive = strncmp(buffer, "HTTP/1.0", 8) != 0;
+    for (header = strstr(buffer, "\r\n"); header && header < headersEnd; header = strstr(header + 2, "\r\n")) {
+        if (strncasecmp(header + 2, "Content-Length:", strlen("Content-Length:")) == 0) {
+            bodyLength = strtoul(header + 2 + strlen("Content-Length:"), NULL, 10);
+            hasLength = 1;
+        } else if (strncasecmp(header + 2, "Connection: close", strlen("Connection: close")) == 0) {
+            response->keepAlive = 0;
+        }
+    }
+    if (strcmp(method, "HEAD") == 0) {
+        bodyLength = 0;
+    } else if (!hasLength) {
+        bodyLength = SIZE_MAX;      // to the end of the connection, which cannot be kept
+        response->keepAlive = 0;
+    }
+    received = length - (size_t)(headersEnd + 4 - buffer);
+    while (received < bodyLength) {
+        count = recv(fd, buffer, kWarmupHeadersLength, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count == 0 && bodyLength == SIZE_MAX) {
+            break;
+        }
+        if (count <= 0) {
+            errno = count < 0 ? errno : ECONNRESET;
+            return -1;
+        }
+        received += (size_t)count;
+    }
+    return 0;
+}
+
+static int WarmupOpen(const WarmupURL *URL, AdConnectionTimings *timings)
+{
+    struct timeval timeout = { (time_t)WarmupTimeout, (suseconds_t)((WarmupTimeout - (time_t)WarmupTimeout) * 1e6) };
+    int fd = AdConnectionOpen(URL->host, URL->port, WarmupTimeout, timings);
+
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+    return fd;
+}
+
+static void WarmupWarmUp(AdConnectionPool *pool, double start)
+{
+    for (size_t i = 0; i < WarmupURLCount; i++) {
+        const WarmupURL *URL = &WarmupURLs[i];
+        WarmupURL root = *URL;
+        AdConnectionTimings timings;
+        WarmupResponse response;
+        double sent;
+        int fd, duplicate = 0;
+
+        for (size_t j = 0; j < i; j++) {
+            duplicate |= WarmupURLs[j].port == URL->port && strcmp(WarmupURLs[j].host, URL->host) == 0;
+        }
+        if (duplicate) {
+            continue;
+        }
+        fd = WarmupOpen(URL, &timings);
+        if (fd < 0) {
+            printf("warm-up %s:%u failed after %.1f ms: %s\n", URL->host, URL->port, (timings.resolve + timings.connect) * 1e3, strerror(errno));
+            continue;
+        }
+        root.path = "/";
+        sent = WarmupNow();
+        if (WarmupExchange(fd, "HEAD", &root, &response) != 0) {
+            printf("warm-up %s:%u: HEAD failed: %s\n", URL->host, URL->port, strerror(errno));
+            close(fd);
+            continue;
+        }
+        printf("warm-up %s:%u  resolve %7.2f ms  connect %7.2f ms (%u addresses)  HEAD %7.2f ms  %s%s\n", URL->host, URL->port,
+               timings.resolve * 1e3, timings.connect * 1e3, timings.addresses, (WarmupNow() - sent) * 1e3,
+               strcmp(timings.canonicalName, URL->host) ? "CNAME " : "", strcmp(timings.canonicalName, URL->host) ? timings.canonicalName : "");
+        if (response.keepAlive) {
+            AdConnectionPoolGive(pool, fd, URL->host, URL->port, WarmupNow() - start);
+        } else {
+            close(fd);
+        }
+    }
+}
+
+static void WarmupRequest(AdConnectionPool *pool, const WarmupURL *URL, double start)
+{
+    double requested = WarmupNow();
+    int fd = AdConnectionPoolTake(pool, URL->host, URL->port, requested - start), reused = fd >= 0;
+    AdConnectionTimings timings;
+    WarmupResponse response;
+    double opened;
+
+    memset(&timings, 0, sizeof(timings));
+    if (fd < 0) {
+        fd = WarmupOpen(URL, &timings);
+    }
+    opened = WarmupNow();
+    if (fd >= 0 && WarmupExchange(fd, "GET", URL, &response) != 0) {
+        close(fd);
+        fd = -1;
+        if (reused) {
+            // Closed by the server after the pool checked it.
+            WarmupRetries++;
+            reused = 0;
+            fd = WarmupOpen(URL, &timings);
+            opened = WarmupNow();
+            if (fd >= 0 && WarmupExchange(fd, "GET", URL, &response) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    if (fd < 0) {
+        WarmupErrors++;
+        printf("GET %s:%u%s failed: %s\n", URL->host, URL->port, URL->path, strerror(errno));
+        return;
+    }
+    AdHistogramRecord(&WarmupFirstBytes[reused], (uint64_t)((opened - requested + response.firstByte) * 1e6));
+    AdHistogramRecord(&WarmupDurations[reused], (uint64_t)((WarmupNow() - requested) * 1e6));
+    if (WarmupVerbose) {
+        printf("GET %s:%u%s  %d  %s  open %7.2f ms (resolve %.2f, connect %.2f)  first byte %7.2f ms  total %7.2f ms\n", URL->host, URL->port,
+               URL->path, response.status, reused ? "reused" : "opened", (opened - requested) * 1e3, timings.resolve * 1e3, timings.connect * 1e3,
+               response.firstByte * 1e3, (WarmupNow() - requested) * 1e3);
+    }
+    if (response.keepAlive) {
+        AdConnectionPoolGive(pool, fd, URL->host, URL->port, WarmupNow() - start);
+    } else {
+        close(fd);
+    }
+}
+
+static void WarmupPrintHistogram(const char *name, const AdHistogram *histogram)
+{
+    printf("  %-22s %6" PRIu64 "  p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms  max %8.2f ms\n", name, histogram->count,
+           AdHistogramValueAtPercentile(histogram, 50) / 1e3, AdHistogramValueAtPercentile(histogram, 90) / 1e3,
+           AdHistogramValueAtPercentile(histogram, 99) / 1e3, histogram->max / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    AdConnectionPoolConfiguration configuration = AdConnectionPoolDefaultConfiguration;
+    AdConnectionPool *pool;
+    AdConnectionPoolStatistics statistics;
+    unsigned long requests = 10, interval = 100;
+    int cold = 0;
+    double start;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requests = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            configuration.idleTimeout = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            WarmupTimeout = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--cold") == 0) {
+            cold = 1;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            WarmupVerbose = 1;
+        } else if (argv[i][0] != '-' && WarmupURLCount < kWarmupMaxURLs && WarmupParseURL(argv[i], &WarmupURLs[WarmupURLCount]) == 0) {
+            WarmupURLCount++;
+        } else {
+            WarmupURLCount = 0;
+            break;
+        }
+    }
+    pool = AdConnectionPoolCreate(&configuration);
+    if (WarmupURLCount == 0 || pool == NULL || !(WarmupTimeout > 0)) {
+        fprintf(stderr, "usage: %s [--requests N] [--interval ms] [--idle-timeout s] [--timeout s] [--cold] [--verbose] http://host[:port]/path...\n", argv[0]);
+        return 2;
+    }
+    AdHistogramInit(&WarmupFirstBytes[0]);
+    AdHistogramInit(&WarmupFirstBytes[1]);
+    AdHistogramInit(&WarmupDurations[0]);
+    AdHistogramInit(&WarmupDurations[1]);
+
+    start = WarmupNow();
+    if (!cold) {
+        WarmupWarmUp(pool, start);
+    }
+    for (unsigned long round = 0; round < requests; round++) {
+        struct timespec pause = { (time_t)(interval / 1000), (long)(interval % 1000) * 1000000 };
+
+        if (round > 0) {
+            nanosleep(&pause, NULL);
+        }
+        AdConnectionPoolEvict(pool, WarmupNow() - start);
+        for (size_t i = 0; i < WarmupURLCount; i++) {
+            WarmupRequest(pool, &WarmupURLs[i], start);
+        }
+    }
+
+    statistics = AdConnectionPoolGetStatistics(pool);
+    printf("%lu rounds of %zu requests, %s:\n", requests, WarmupURLCount, cold ? "cold" : "warmed up");
+    WarmupPrintHistogram("first byte, reused", &WarmupFirstBytes[1]);
+    WarmupPrintHistogram("first byte, opened", &WarmupFirstBytes[0]);
+    WarmupPrintHistogram("response, reused", &WarmupDurations[1]);
+    WarmupPrintHistogram("response, opened", &WarmupDurations[0]);
+    printf("pool: %" PRIu64 " reuses, %" PRIu64 " misses, %" PRIu64 " evicted idle, %" PRIu64 " closed by the server, %" PRIu64 " overflows; "
+           "%llu retries, %llu errors\n", statistics.reuses, statistics.misses, statistics.idleEvictions, statistics.serverCloses,
+           statistics.overflows, WarmupRetries, WarmupErrors);
+    AdConnectionPoolRelease(pool);
+    return WarmupErrors > 0;
+}